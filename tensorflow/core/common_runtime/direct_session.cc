@@ -40,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/common_runtime/static_schedule_executor.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -1403,6 +1404,8 @@ Status DirectSession::CreateExecutors(
     params.device = device;
     params.session_metadata = session_metadata;
     params.function_library = lib;
+    params.use_static_memory_plan =
+        options_.config.experimental().use_static_memory_plan();
     auto opseg = device->op_segment();
     params.create_kernel =
         [this, lib, opseg](const std::shared_ptr<const NodeProperties>& props,
@@ -1446,8 +1449,17 @@ Status DirectSession::CreateExecutors(
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
-    TF_RETURN_IF_ERROR(
-        NewExecutor(executor_type, params, *partition_graph, &item->executor));
+    const int static_schedule_warmup_steps =
+        options_.config.experimental().static_schedule_warmup_steps();
+    if (static_schedule_warmup_steps > 0 &&
+        (executor_type.empty() || executor_type == "DEFAULT")) {
+      TF_RETURN_IF_ERROR(NewStaticScheduleExecutor(
+          params, *partition_graph, static_schedule_warmup_steps,
+          &item->executor));
+    } else {
+      TF_RETURN_IF_ERROR(NewExecutor(executor_type, params, *partition_graph,
+                                     &item->executor));
+    }
     if (!options_.config.experimental().disable_output_partition_graphs() ||
         options_.config.graph_options().build_cost_model() > 0) {
       item->graph = std::move(partition_graph);
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -27,6 +28,7 @@ limitations under the License.
 #include "absl/types/optional.h"
 #include "tensorflow/core/activity_watcher/activity.h"
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/entry.h"
 #include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
@@ -35,7 +37,10 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/common_runtime/work_stealing_queue.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -48,6 +53,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_segment.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_reference.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/edgeset.h"
@@ -62,6 +68,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -90,6 +97,11 @@ namespace {
 // 1-D, 0 element tensor.
 static const Tensor* const kEmptyTensor = new Tensor;
 
+// The executor state and queue slot of the work-stealing worker running on the
+// current thread, if any. See `ExecutorState::RunWorker`.
+thread_local const void* current_worker_executor = nullptr;
+thread_local int current_worker_slot = -1;
+
 // Helper routines for collecting step stats.
 namespace nodestats {
 inline int64_t NowInNsec() { return EnvTime::NowNanos(); }
@@ -145,13 +157,65 @@ struct KernelTimer {
 typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
 typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
 
+// Keeps the work-stealing queues of finished steps so that later steps of the
+// same executor reuse them, instead of allocating a queue per core each.
+// Steps that run concurrently take different sets of queues, so the cache
+// holds at most as many sets as the executor has run steps at once.
+template <typename T>
+class WorkStealingQueueCache {
+ public:
+  using Queues = std::vector<std::unique_ptr<WorkStealingQueue<T>>>;
+
+  // Returns `num_queues` empty queues, which are those of a finished step if
+  // there is one.
+  Queues Get(int num_queues) {
+    Queues queues;
+    {
+      mutex_lock l(mu_);
+      if (!free_.empty()) {
+        queues = std::move(free_.back());
+        free_.pop_back();
+      }
+    }
+    queues.reserve(num_queues);
+    while (queues.size() < static_cast<size_t>(num_queues)) {
+      queues.push_back(
+          std::make_unique<WorkStealingQueue<T>>(/*initial_capacity=*/16));
+    }
+    return queues;
+  }
+
+  // Returns the queues of a finished step, all of which must be empty.
+  void Put(Queues queues) {
+    for (const auto& queue : queues) {
+      DCHECK(queue->Empty());
+    }
+    mutex_lock l(mu_);
+    free_.push_back(std::move(queues));
+  }
+
+ private:
+  mutex mu_;
+  std::vector<Queues> free_ TF_GUARDED_BY(mu_);
+};
+
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  explicit ExecutorImpl(const LocalExecutorParams& p,
+                        bool work_stealing = false)
+      : immutable_state_(p), work_stealing_(work_stealing) {}
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
     kernel_stats_.Initialize(immutable_state_.graph_view());
+    // Without control flow, every node runs once per step, and the lifetimes
+    // of the tensors follow from the graph.
+    if (immutable_state_.params().use_static_memory_plan &&
+        !immutable_state_.requires_control_flow_support()) {
+      Device* device = immutable_state_.params().device;
+      memory_planner_ = std::make_unique<StaticMemoryPlanner>(
+          graph, device->GetAllocator(AllocatorAttributes()));
+    }
     return OkStatus();
   }
 
@@ -210,6 +274,15 @@ class ExecutorImpl : public Executor {
       cost_estimate.store(new_estimate, std::memory_order_relaxed);
     }
 
+    // The number of bytes that the last step carved out of its step arena,
+    // which is used to size the arena of the next step.
+    size_t step_arena_bytes() const {
+      return step_arena_bytes_.load(std::memory_order_relaxed);
+    }
+    void set_step_arena_bytes(size_t bytes) {
+      step_arena_bytes_.store(bytes, std::memory_order_relaxed);
+    }
+
    private:
     // Initial time (in CPU cycles) we expect an operation to take.  Used to
     // determine whether an operation should be place in a threadpool.
@@ -221,10 +294,22 @@ class ExecutorImpl : public Executor {
     std::vector<bool> is_expensive_;
     // std::unique_ptr<std::atomic<bool>[]> is_expensive_;
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
+    std::atomic<size_t> step_arena_bytes_{0};
   };
 
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  // If true, ready nodes are scheduled through per-worker work-stealing
+  // queues. See `ExecutorState::RunWorker`.
+  const bool work_stealing_;
+  // The work-stealing queues of finished steps, for each propagator that
+  // supports the work-stealing mode.
+  WorkStealingQueueCache<PropagatorState::TaggedNode> ws_queue_cache_;
+  WorkStealingQueueCache<SimplePropagatorState::TaggedNode>
+      simple_ws_queue_cache_;
+  // If not null, records the sizes of the outputs during the first step, and
+  // then provides a static memory plan for the later ones.
+  std::unique_ptr<StaticMemoryPlanner> memory_planner_;
 
   ExecutorImpl(const ExecutorImpl&) = delete;
   void operator=(const ExecutorImpl&) = delete;
@@ -282,9 +367,13 @@ class ExecutorImpl : public Executor {
 template <class PropagatorStateType>
 class ExecutorState {
  public:
-  ExecutorState(const Executor::Args& args,
-                const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+  ExecutorState(
+      const Executor::Args& args,
+      const ImmutableExecutorState& immutable_state_,
+      ExecutorImpl::KernelStats* kernel_stats_,
+      StaticMemoryPlanner* memory_planner,
+      WorkStealingQueueCache<typename PropagatorStateType::TaggedNode>*
+          ws_queue_cache = nullptr);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -320,6 +409,11 @@ class ExecutorState {
                        AllocatorAttributeVec* input_alloc_attrs,
                        bool* is_input_dead);
 
+  // Replaces the value of "entry" with a copy if it was allocated from the
+  // step arena. Used for the inputs of _Send and _Retval nodes, which escape
+  // the step, so that they do not keep an arena chunk alive.
+  Status CopyOutOfStepArena(Entry* entry);
+
   // After item->kernel computation is done, processes its outputs.
   Status ProcessOutputs(const NodeItem& item, OpKernelContext* ctx,
                         Entry* outputs, NodeExecStatsInterface* stats);
@@ -346,6 +440,40 @@ class ExecutorState {
   template <typename Closure>
   void RunTask(Closure&& c, int sample_rate = 0);
 
+  // Work-stealing mode.
+  //
+  // Instead of dispatching ready nodes to `runner_` one closure at a time, up
+  // to `ws_queues_.size()` worker closures run on `runner_`, each owning one
+  // queue while it runs. A worker pushes the nodes that it makes ready onto
+  // its own queue and pops them in LIFO order, which keeps consumers on the
+  // thread that produced their inputs. Once its queue runs dry, it steals the
+  // oldest nodes from the other queues, and exits when there is nothing left
+  // to steal. The expensive/inexpensive heuristics of `ScheduleReady` are not
+  // used in this mode.
+
+  // Queues the nodes in `*ready` for the workers, starting workers as needed.
+  void WorkStealingScheduleReady(TaggedNodeSeq* ready,
+                                 TaggedNodeReadyQueue* inline_ready);
+
+  // Moves a node from the current worker's queue, another worker's queue or
+  // `ws_overflow_` to `inline_ready`. Returns false if none was found.
+  bool WorkStealingNext(TaggedNodeReadyQueue* inline_ready);
+
+  // Starts a worker on `runner_`, which owns queue `slot` if it is not -1 and
+  // otherwise claims a free queue if there is one.
+  void SpawnWorker(int slot);
+  void RunWorker(int slot);
+
+  // Releases a reference on `ws_refs_`, and finishes the step if it was the
+  // last one.
+  void WorkStealingUnref();
+
+  // Returns the index of a queue not owned by any worker, or -1.
+  int ClaimSlotLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(ws_mu_);
+
+  // Called once all nodes are done.
+  void AllNodesDone();
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
@@ -397,6 +525,16 @@ class ExecutorState {
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
+  const bool work_stealing_;
+  // If not null, the arena from which the step allocates tensors with default
+  // attributes. The step's reference is released in the destructor.
+  StepArenaAllocator* step_arena_ = nullptr;
+  StaticMemoryPlanner* const memory_planner_;
+  // If not null, the allocations of the step that follow the static memory
+  // plan. The step's reference is released in the destructor.
+  StaticMemoryPlan::Step* memory_plan_step_ = nullptr;
+  // If true, the sizes of the outputs are recorded for `memory_planner_`.
+  bool record_outputs_ = false;
 
   PropagatorStateType propagator_;
 
@@ -413,12 +551,33 @@ class ExecutorState {
 
   mutex mu_;
   Status status_ TF_GUARDED_BY(mu_);
+
+  // State for the work-stealing mode. `ws_queues_` is only populated in that
+  // mode, with queues taken from `ws_queue_cache_` and returned to it when the
+  // step is done.
+  WorkStealingQueueCache<TaggedNode>* const ws_queue_cache_;
+  typename WorkStealingQueueCache<TaggedNode>::Queues ws_queues_;
+  // One reference for each running worker, plus one that is released once all
+  // nodes are done. The step finishes when the count drops to zero, so that no
+  // worker touches this state after it is deleted.
+  std::atomic<int64_t> ws_refs_{1};
+  std::atomic<int> ws_num_free_slots_{0};
+  std::atomic<int64_t> ws_overflow_size_{0};
+  mutex ws_mu_;
+  // Queues not owned by any worker.
+  std::vector<int> ws_free_slots_ TF_GUARDED_BY(ws_mu_);
+  // Nodes made ready outside of a worker while every queue was owned. Running
+  // workers drain it before they exit.
+  std::deque<TaggedNode> ws_overflow_ TF_GUARDED_BY(ws_mu_);
 };
 
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats,
+    StaticMemoryPlanner* memory_planner,
+    WorkStealingQueueCache<typename PropagatorStateType::TaggedNode>*
+        ws_queue_cache)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -446,13 +605,49 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
       run_all_kernels_inline_(args.run_all_kernels_inline),
+      work_stealing_(ws_queue_cache != nullptr &&
+                     !args.run_all_kernels_inline),
+      memory_planner_(memory_planner),
       propagator_(immutable_state, step_id_, vlog_),
-      num_outstanding_ops_(0) {
+      num_outstanding_ops_(0),
+      ws_queue_cache_(ws_queue_cache) {
   if (args.user_intra_op_threadpool != nullptr) {
     Device* device = immutable_state_.params().device;
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (work_stealing_) {
+    const int num_slots = std::max(1, port::MaxParallelism());
+    ws_queues_ = ws_queue_cache_->Get(num_slots);
+    mutex_lock l(ws_mu_);
+    for (int i = num_slots - 1; i >= 0; --i) {
+      ws_free_slots_.push_back(i);
+    }
+    ws_num_free_slots_ = num_slots;
+  }
+  // The arena frees nothing before the end of the step, so it is only used
+  // when every node runs once per step. A loop would grow it with every
+  // iteration.
+  StepArenaAllocatorMgr* step_arena_mgr =
+      immutable_state_.params().device->GetStepArenaAllocatorMgr();
+  if (step_arena_mgr != nullptr &&
+      !immutable_state_.requires_control_flow_support()) {
+    step_arena_ = step_arena_mgr->NewArena(kernel_stats_->step_arena_bytes());
+  }
+  if (memory_planner_ != nullptr) {
+    std::shared_ptr<StaticMemoryPlan> plan = memory_planner_->plan();
+    if (plan != nullptr) {
+      // Outputs that do not fit the plan are allocated like any other tensor.
+      Allocator* fallback_allocator = step_arena_;
+      if (fallback_allocator == nullptr) {
+        fallback_allocator = immutable_state_.params().device->GetAllocator(
+            AllocatorAttributes());
+      }
+      memory_plan_step_ = plan->StartStep(fallback_allocator);
+    } else {
+      record_outputs_ = memory_planner_->recording();
+    }
+  }
 }
 
 template <class PropagatorStateType>
@@ -461,6 +656,15 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
     device_context_->Unref();
   }
   delete slice_reader_cache_;
+  if (memory_plan_step_ != nullptr) {
+    memory_plan_step_->EndStep();
+  }
+  if (step_arena_ != nullptr) {
+    kernel_stats_->set_step_arena_bytes(step_arena_->EndStep());
+  }
+  if (!ws_queues_.empty()) {
+    ws_queue_cache_->Put(std::move(ws_queues_));
+  }
 }
 
 template <class PropagatorStateType>
@@ -616,6 +820,9 @@ Status ExecutorState<PropagatorStateType>::ProcessSync(
     device->Compute(op_kernel, &ctx);
   }
   nodestats::SetOpEnd(stats);
+  if (TF_PREDICT_FALSE(record_outputs_) && ctx.status().ok()) {
+    memory_planner_->RecordOutputs(item.node_id, &ctx);
+  }
   if (outputs->size() < item.num_outputs) outputs->resize(item.num_outputs);
   s = ProcessOutputs(item, &ctx, outputs->data(), stats);
   nodestats::SetMemory(stats, &ctx);
@@ -697,7 +904,7 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
       outputs.clear();
       const bool completed = NodeDone(s, &ready, stats, nullptr);
       delete state;
-      if (completed) ScheduleFinish();
+      if (completed) AllNodesDone();
     };
 
     immutable_state_.params().device->ComputeAsync(async_kernel, &state->ctx,
@@ -756,6 +963,7 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
   }
   params->start_time_usecs = start_time_usecs_;
   params->deadline = deadline_;
+  params->step_arena_allocator = step_arena_;
   params->log_memory = log_memory_;
   params->rendezvous = rendezvous_;
   params->collective_executor = collective_executor_;
@@ -804,7 +1012,8 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
   bool completed = false;
   int64_t last_iter_num = -1;
   std::unique_ptr<profiler::TraceMeConsumer> iteration_scope;
-  while (!inline_ready->empty()) {
+  while (!inline_ready->empty() ||
+         (work_stealing_ && WorkStealingNext(inline_ready))) {
     TaggedNode tagged_node = inline_ready->front();
 
     int64_t current_iter_num = tagged_node.get_iter_num();
@@ -912,6 +1121,10 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
       params->frame_iter = propagator_.GetFrameAndIter(tagged_node);
       params->is_input_dead = is_input_dead;
       params->output_attr_array = item.output_attrs();
+      if (memory_plan_step_ != nullptr) {
+        params->output_allocator_array =
+            memory_plan_step_->output_allocators(item.node_id);
+      }
       params->forward_from_array = item.forward_from();
       params->outputs_required_array = item.outputs_required.get();
       params->inputs = *inputs;
@@ -962,7 +1175,7 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
   }  // while !inline_ready.empty()
 
   // This thread of computation is done if completed = true.
-  if (completed) ScheduleFinish();
+  if (completed) AllNodesDone();
 }
 
 template <class PropagatorStateType>
@@ -1010,6 +1223,10 @@ Status ExecutorState<PropagatorStateType>::PrepareInputs(
               errors::InvalidArgument(i, "-th input expects a ref type"),
               item.kernel->def());
         }
+        if (TF_PREDICT_FALSE(step_arena_ != nullptr &&
+                             item.is_send_or_retval)) {
+          TF_RETURN_IF_ERROR(CopyOutOfStepArena(entry));
+        }
         inp->mutex_if_ref = nullptr;
         inp->tensor = entry->val.get();
         break;
@@ -1080,6 +1297,25 @@ Status ExecutorState<PropagatorStateType>::PrepareInputs(
   return OkStatus();
 }
 
+template <class PropagatorStateType>
+Status ExecutorState<PropagatorStateType>::CopyOutOfStepArena(Entry* entry) {
+  Tensor* tensor = entry->val.get();
+  if (!tensor->IsInitialized() || tensor->TotalBytes() == 0 ||
+      !step_arena_->Contains(DMAHelper::base(tensor))) {
+    return OkStatus();
+  }
+  Tensor copy(immutable_state_.params().device->GetAllocator(entry->alloc_attr),
+              tensor->dtype(), tensor->shape());
+  if (!copy.IsInitialized()) {
+    return errors::ResourceExhausted("OOM when copying tensor with shape ",
+                                     tensor->shape().DebugString(),
+                                     " out of the step arena");
+  }
+  tensor::DeepCopy(*tensor, &copy);
+  *tensor = std::move(copy);
+  return OkStatus();
+}
+
 template <class PropagatorStateType>
 Status ExecutorState<PropagatorStateType>::ProcessOutputs(
     const NodeItem& item, OpKernelContext* ctx, Entry* outputs,
@@ -1278,7 +1514,9 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     scheduled_nsec = nodestats::NowInNsec();
   }
 
-  if (run_all_kernels_inline_) {
+  if (work_stealing_) {
+    WorkStealingScheduleReady(ready, inline_ready);
+  } else if (run_all_kernels_inline_) {
     if (inline_ready == nullptr) {
       // Schedule all ready kernels from a single closure. This ensure that,
       // regardless of the `runner_` implementation, all kernels will run
@@ -1371,6 +1609,156 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::WorkStealingScheduleReady(
+    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready) {
+  if (current_worker_executor == this) {
+    WorkStealingQueue<TaggedNode>* queue =
+        ws_queues_[current_worker_slot].get();
+    auto it = ready->begin();
+    if (inline_ready != nullptr && inline_ready->empty()) {
+      // Run one of the nodes next on this thread without going through the
+      // queue.
+      inline_ready->push_back(*it);
+      ++it;
+    }
+    for (; it != ready->end(); ++it) {
+      queue->Push(*it);
+    }
+    // Start a helper if there is enough work to share. Helpers start more
+    // helpers when they steal from a queue that is still not empty.
+    if (queue->Size() > 1 &&
+        ws_num_free_slots_.load(std::memory_order_relaxed) > 0) {
+      SpawnWorker(/*slot=*/-1);
+    }
+    return;
+  }
+
+  // Not on a worker of this executor, e.g. when scheduling the root nodes or
+  // when an asynchronous kernel completes: take a free queue, fill it and hand
+  // it over to a new worker.
+  int slot;
+  {
+    mutex_lock l(ws_mu_);
+    slot = ClaimSlotLocked();
+    if (slot < 0) {
+      for (auto& tagged_node : *ready) {
+        ws_overflow_.push_back(tagged_node);
+      }
+      ws_overflow_size_.store(ws_overflow_.size(), std::memory_order_release);
+      return;
+    }
+  }
+  for (auto& tagged_node : *ready) {
+    ws_queues_[slot]->Push(tagged_node);
+  }
+  const int num_helpers =
+      std::min<int64_t>(ready->size() - 1,
+                        ws_num_free_slots_.load(std::memory_order_relaxed));
+  // The first worker may run every node and finish the step before the
+  // helpers are spawned, so hold a reference on the step until they are.
+  ws_refs_.fetch_add(1, std::memory_order_relaxed);
+  SpawnWorker(slot);
+  for (int i = 0; i < num_helpers; ++i) {
+    SpawnWorker(/*slot=*/-1);
+  }
+  WorkStealingUnref();
+}
+
+template <class PropagatorStateType>
+bool ExecutorState<PropagatorStateType>::WorkStealingNext(
+    TaggedNodeReadyQueue* inline_ready) {
+  const int slot = current_worker_slot;
+  DCHECK_EQ(current_worker_executor, this);
+  absl::optional<TaggedNode> tagged_node = ws_queues_[slot]->PopBottom();
+  const int num_slots = ws_queues_.size();
+  for (int i = 1; i < num_slots && !tagged_node.has_value(); ++i) {
+    WorkStealingQueue<TaggedNode>* victim =
+        ws_queues_[(slot + i) % num_slots].get();
+    tagged_node = victim->Steal();
+    if (tagged_node.has_value() && !victim->Empty() &&
+        ws_num_free_slots_.load(std::memory_order_relaxed) > 0) {
+      SpawnWorker(/*slot=*/-1);
+    }
+  }
+  if (!tagged_node.has_value() &&
+      ws_overflow_size_.load(std::memory_order_acquire) > 0) {
+    mutex_lock l(ws_mu_);
+    if (!ws_overflow_.empty()) {
+      tagged_node = ws_overflow_.front();
+      ws_overflow_.pop_front();
+      ws_overflow_size_.store(ws_overflow_.size(), std::memory_order_release);
+    }
+  }
+  if (!tagged_node.has_value()) return false;
+  inline_ready->push_back(*tagged_node);
+  return true;
+}
+
+template <class PropagatorStateType>
+int ExecutorState<PropagatorStateType>::ClaimSlotLocked() {
+  if (ws_free_slots_.empty()) return -1;
+  const int slot = ws_free_slots_.back();
+  ws_free_slots_.pop_back();
+  ws_num_free_slots_.store(ws_free_slots_.size(), std::memory_order_relaxed);
+  return slot;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::SpawnWorker(int slot) {
+  ws_refs_.fetch_add(1, std::memory_order_relaxed);
+  RunTask([this, slot]() { RunWorker(slot); });
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RunWorker(int slot) {
+  // Workers of another executor may be running further up this thread's
+  // stack, e.g. if `runner_` runs closures inline.
+  const void* const parent_executor = current_worker_executor;
+  const int parent_slot = current_worker_slot;
+  while (true) {
+    if (slot < 0) {
+      mutex_lock l(ws_mu_);
+      slot = ClaimSlotLocked();
+      if (slot < 0) break;
+    }
+    current_worker_executor = this;
+    current_worker_slot = slot;
+    TaggedNodeReadyQueue inline_ready;
+    ProcessInline(&inline_ready,
+                  stats_collector_ ? nodestats::NowInNsec() : 0);
+
+    // Nodes may have been added to `ws_overflow_` after this worker last
+    // checked it. Once the slot is released, whoever adds nodes will find a
+    // free queue instead.
+    mutex_lock l(ws_mu_);
+    if (!ws_overflow_.empty()) continue;
+    ws_free_slots_.push_back(slot);
+    ws_num_free_slots_.store(ws_free_slots_.size(), std::memory_order_relaxed);
+    break;
+  }
+  current_worker_executor = parent_executor;
+  current_worker_slot = parent_slot;
+  WorkStealingUnref();
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::WorkStealingUnref() {
+  if (ws_refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    ScheduleFinish();
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::AllNodesDone() {
+  if (work_stealing_ &&
+      ws_refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    // The last worker to exit will finish the step.
+    return;
+  }
+  ScheduleFinish();
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Checks condition to decide if needs to invoke Finish(). If there are
@@ -1398,6 +1786,9 @@ void ExecutorState<PropagatorStateType>::Finish() {
   auto done_cb = std::move(done_cb_);
   auto runner = std::move(runner_);
   mu_.unlock();
+  if (record_outputs_ && status.ok()) {
+    memory_planner_->FinishRecording();
+  }
   int64_t trace_id = trace_id_;
   int64_t step_id = step_id_;
   CHECK(done_cb != nullptr);
@@ -1509,15 +1900,20 @@ void ExecutorState<PropagatorStateType>::Finish() {
 
 void ExecutorImpl::RunAsyncInternal(const Args& args, DoneCallback done) {
   if (OpOrderDeterminismRequired()) {
-    (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+    // The ordered ready queue is only honored when nodes run inline, so the
+    // work-stealing mode is not used here.
+    (new ExecutorState<OrderedPropagatorState>(
+         args, immutable_state_, &kernel_stats_, memory_planner_.get()))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(
+         args, immutable_state_, &kernel_stats_, memory_planner_.get(),
+         work_stealing_ ? &ws_queue_cache_ : nullptr))
         ->RunAsync(std::move(done));
   } else {
-    (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+    (new ExecutorState<SimplePropagatorState>(
+         args, immutable_state_, &kernel_stats_, memory_planner_.get(),
+         work_stealing_ ? &simple_ws_queue_cache_ : nullptr))
         ->RunAsync(std::move(done));
   }
 }
@@ -1556,6 +1952,8 @@ class DefaultExecutorRegistrar {
     Factory* factory = new Factory;
     ExecutorFactory::Register("", factory);
     ExecutorFactory::Register("DEFAULT", factory);
+    ExecutorFactory::Register("WORK_STEALING_EXECUTOR",
+                              new WorkStealingFactory);
   }
 
  private:
@@ -1568,6 +1966,17 @@ class DefaultExecutorRegistrar {
       return OkStatus();
     }
   };
+
+  class WorkStealingFactory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl = std::make_unique<ExecutorImpl>(params,
+                                                 /*work_stealing=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return OkStatus();
+    }
+  };
 };
 static DefaultExecutorRegistrar registrar;
 
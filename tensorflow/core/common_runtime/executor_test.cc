@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
@@ -78,7 +79,8 @@ class ExecutorTest : public ::testing::Test {
   }
 
   // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
+  void Create(std::unique_ptr<const Graph> graph,
+              const string& executor_type = "") {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
@@ -93,7 +95,13 @@ class ExecutorTest : public ::testing::Test {
     };
     rendez_ = NewLocalRendezvous();
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    if (executor_type.empty()) {
+      TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    } else {
+      std::unique_ptr<Executor> executor;
+      TF_CHECK_OK(NewExecutor(executor_type, params, *graph, &executor));
+      exec_ = executor.release();
+    }
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
@@ -266,6 +274,52 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "WORK_STEALING_EXECUTOR");
+  Rendezvous::Args args;
+  for (int step = 0; step < 10; ++step) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, RandomTreeStepArena) {
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_cpu_step_arena_allocator(
+      true);
+  device_ = DeviceFactory::NewDevice("CPU", options,
+                                     "/job:localhost/replica:0/task:0");
+  ASSERT_NE(nullptr, device_->GetStepArenaAllocatorMgr());
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  Rendezvous::Args args;
+  // The output of every step is sent through the rendezvous, so the executor
+  // copies it out of the step's arena.
+  std::vector<Tensor> outs;
+  for (int step = 0; step < 10; ++step) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(step), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    outs.push_back(out);
+  }
+  for (int step = 0; step < 10; ++step) {
+    EXPECT_EQ(4096.0 * step, V(outs[step]));
+  }
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -494,6 +548,41 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+// Create a graph where one node fans out to 'width' no-ops, which all fan in
+// to a single node, and run it with the default executor (when
+// 'work_stealing' is 0) or the work-stealing executor.
+static void BM_FanOutFanIn(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const bool work_stealing = state.range(1) != 0;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* root = test::graph::NoOp(g, {});
+  std::vector<Node*> fan_out;
+  fan_out.reserve(width);
+  for (int i = 0; i < width; ++i) {
+    fan_out.push_back(test::graph::NoOp(g, {root}));
+  }
+  test::graph::NoOp(g, fan_out);
+
+  FixupSourceAndSinkEdges(g);
+  test::Benchmark("cpu", g, /*options=*/nullptr, /*init=*/nullptr,
+                  /*rendez=*/nullptr,
+                  work_stealing ? "WORK_STEALING_EXECUTOR" : "",
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+
+  state.SetLabel(work_stealing ? "work stealing" : "default");
+  state.SetItemsProcessed(static_cast<int64_t>(width + 2) *
+                          state.iterations());
+}
+
+BENCHMARK(BM_FanOutFanIn)
+    ->UseRealTime()
+    ->ArgPair(1000, 0)
+    ->ArgPair(1000, 1)
+    ->ArgPair(10000, 0)
+    ->ArgPair(10000, 1);
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
@@ -75,6 +75,7 @@ struct NodeItem {
   bool is_initialization_op : 1;  // True iff IsInitializationOp(node)
   bool is_recv_or_switch : 1;     // True iff IsRecv(node) || IsSwitch(node)
   bool is_next_iteration : 1;     // True iff IsNextIteration(node)
+  bool is_send_or_retval : 1;     // True iff IsSend(node) || node->IsRetval()
   bool is_noop : 1;  // True iff item->kernel->type_string_view() == "NoOp")
   bool
       is_any_consumer_merge_or_control_trigger : 1;  // True iff the destination
@@ -99,6 +99,8 @@ Benchmark::Benchmark(const string& device, Graph* g,
   LocalExecutorParams params;
   params.device = device_;
   params.function_library = flr_;
+  params.use_static_memory_plan =
+      options->config.experimental().use_static_memory_plan();
   params.create_kernel = [this, graph_def_version](
                              const std::shared_ptr<const NodeProperties>& props,
                              OpKernel** kernel) {
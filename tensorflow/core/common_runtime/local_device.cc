@@ -120,6 +120,9 @@ LocalDevice::LocalDevice(const SessionOptions& options,
     use_global_threadpool_ = false;
   }
 
+  const bool numa_affinity =
+      options.config.experimental().use_numa_affinity() ||
+      options.config.experimental().numa_aware_cpu_devices();
   if (use_global_threadpool_) {
     // All ThreadPoolDevices in the process associated with the same
     // NUMA node will share a single fixed sized threadpool for numerical
@@ -129,7 +132,7 @@ LocalDevice::LocalDevice(const SessionOptions& options,
         *new gtl::InlinedVector<LocalDevice::EigenThreadPoolInfo*, 4>;
 
     mutex_lock l(global_tp_mu);
-    if (options.config.experimental().use_numa_affinity()) {
+    if (numa_affinity) {
       int numa_node = attributes.locality().numa_node();
       int num_numa_nodes = port::NUMANumNodes();
       DCHECK_LT(numa_node, num_numa_nodes);
@@ -153,9 +156,15 @@ LocalDevice::LocalDevice(const SessionOptions& options,
   } else {
     // Each LocalDevice owns a separate ThreadPoolDevice for numerical
     // computations.
-    // TODO(tucker): NUMA for these too?
-    owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(
-        options, port::kNUMANoAffinity, nullptr));
+    if (numa_affinity) {
+      const int numa_node = attributes.locality().numa_node();
+      owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(
+          options, numa_node,
+          ProcessState::singleton()->GetCPUAllocator(numa_node)));
+    } else {
+      owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(
+          options, port::kNUMANoAffinity, nullptr));
+    }
     tp_info = owned_tp_info_.get();
   }
 
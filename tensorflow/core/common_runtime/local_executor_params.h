@@ -50,6 +50,11 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // Whether the executor places the outputs of the nodes of graphs without
+  // control flow in a single buffer per step, at offsets planned from the
+  // sizes and lifetimes that the first step observed.
+  bool use_static_memory_plan = false;
 };
 
 }  // end namespace tensorflow
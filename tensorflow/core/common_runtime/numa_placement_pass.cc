@@ -0,0 +1,158 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/numa_placement_pass.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// Union-find over node ids.
+class Components {
+ public:
+  explicit Components(int n) : parent_(n) {
+    std::iota(parent_.begin(), parent_.end(), 0);
+  }
+
+  int Find(int x) {
+    while (parent_[x] != x) {
+      parent_[x] = parent_[parent_[x]];
+      x = parent_[x];
+    }
+    return x;
+  }
+
+  void Union(int a, int b) {
+    a = Find(a);
+    b = Find(b);
+    if (a != b) parent_[std::max(a, b)] = std::min(a, b);
+  }
+
+ private:
+  std::vector<int> parent_;
+};
+
+}  // namespace
+
+Status NumaPlacementPass::Run(const GraphOptimizationPassOptions& options) {
+  if (options.session_options == nullptr ||
+      !options.session_options->config.experimental()
+           .numa_aware_cpu_devices() ||
+      options.graph == nullptr || options.device_set == nullptr ||
+      options.is_function_graph) {
+    return OkStatus();
+  }
+
+  // The first CPU device of every NUMA node.
+  std::map<int, const Device*> devices_by_numa_node;
+  for (const Device* device : options.device_set->devices()) {
+    if (device->device_type() != DEVICE_CPU) {
+      VLOG(1) << "Not spreading subgraphs across NUMA nodes because of device "
+              << device->name();
+      return OkStatus();
+    }
+    devices_by_numa_node.emplace(device->attributes().locality().numa_node(),
+                                 device);
+  }
+  if (devices_by_numa_node.size() < 2) return OkStatus();
+
+  Graph* graph = options.graph->get();
+  Components components(graph->num_node_ids());
+  for (const Edge* e : graph->edges()) {
+    if (e->src()->IsOp() && e->dst()->IsOp()) {
+      components.Union(e->src()->id(), e->dst()->id());
+    }
+  }
+  absl::flat_hash_map<string, int> ids_by_name;
+  for (const Node* n : graph->op_nodes()) {
+    ids_by_name[n->name()] = n->id();
+  }
+  absl::flat_hash_map<string, int> ids_by_shared_name;
+  for (const Node* n : graph->op_nodes()) {
+    std::vector<string> colocation_groups;
+    if (TryGetNodeAttr(n->attrs(), kColocationAttrName, &colocation_groups)) {
+      for (const string& group : colocation_groups) {
+        if (!absl::StartsWith(group, kColocationGroupPrefix)) continue;
+        auto it = ids_by_name.find(
+            group.substr(strlen(kColocationGroupPrefix)));
+        if (it != ids_by_name.end()) components.Union(n->id(), it->second);
+      }
+    }
+    string shared_name;
+    if (TryGetNodeAttr(n->attrs(), "shared_name", &shared_name) &&
+        !shared_name.empty()) {
+      auto it = ids_by_shared_name.emplace(shared_name, n->id()).first;
+      components.Union(n->id(), it->second);
+    }
+  }
+
+  // The nodes of every subgraph, indexed by the smallest id in the subgraph.
+  std::vector<std::vector<Node*>> subgraphs(graph->num_node_ids());
+  std::vector<bool> placed(graph->num_node_ids(), false);
+  for (Node* n : graph->op_nodes()) {
+    const int root = components.Find(n->id());
+    subgraphs[root].push_back(n);
+    if (!n->requested_device().empty() ||
+        !n->assigned_device_name().empty()) {
+      placed[root] = true;
+    }
+  }
+  std::vector<int> roots;
+  for (size_t i = 0; i < subgraphs.size(); ++i) {
+    if (!subgraphs[i].empty() && !placed[i]) roots.push_back(i);
+  }
+  if (roots.size() < 2) return OkStatus();
+  std::stable_sort(roots.begin(), roots.end(), [&subgraphs](int a, int b) {
+    return subgraphs[a].size() > subgraphs[b].size();
+  });
+
+  std::vector<const Device*> devices;
+  for (const auto& it : devices_by_numa_node) devices.push_back(it.second);
+  std::vector<int64_t> num_nodes(devices.size(), 0);
+  for (int root : roots) {
+    const int d = std::min_element(num_nodes.begin(), num_nodes.end()) -
+                  num_nodes.begin();
+    for (Node* n : subgraphs[root]) {
+      n->set_requested_device(devices[d]->name());
+    }
+    num_nodes[d] += subgraphs[root].size();
+  }
+  VLOG(1) << "Spread " << roots.size() << " independent subgraphs across "
+          << devices.size() << " NUMA nodes";
+  return OkStatus();
+}
+
+// Runs after the passes that lower functional ops, so that it sees the nodes
+// that they add.
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::PRE_PLACEMENT, 40,
+                      NumaPlacementPass);
+
+}  // namespace tensorflow
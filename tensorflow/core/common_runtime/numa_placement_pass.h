@@ -0,0 +1,44 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_NUMA_PLACEMENT_PASS_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_NUMA_PLACEMENT_PASS_H_
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+
+namespace tensorflow {
+
+// Spreads independent subgraphs across the CPU devices of different NUMA
+// nodes, when `ConfigProto.Experimental.numa_aware_cpu_devices` is set.
+//
+// Two nodes belong to the same subgraph if they are connected by a data or
+// control edge, if one is colocated with the other, or if both refer to the
+// same shared resource through their `shared_name` attribute. Subgraphs with
+// a node that already has a requested or assigned device are left alone. The
+// others are assigned, from the largest to the smallest, to the device whose
+// NUMA node has the fewest nodes so far, by setting the requested device of
+// their nodes. The placer then keeps each subgraph, and the tensors that it
+// allocates, on one NUMA node.
+//
+// Does nothing unless the session has only CPU devices, on at least two NUMA
+// nodes.
+class NumaPlacementPass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_NUMA_PLACEMENT_PASS_H_
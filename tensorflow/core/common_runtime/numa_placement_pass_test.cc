@@ -0,0 +1,177 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/numa_placement_pass.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+class FakeDevice : public Device {
+ public:
+  explicit FakeDevice(const DeviceAttributes& device_attributes)
+      : Device(nullptr, device_attributes) {}
+
+  Status Sync() override { return errors::Unimplemented("FakeDevice::Sync()"); }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override { return nullptr; }
+
+  static std::unique_ptr<Device> Make(const string& name, const string& type,
+                                      int numa_node) {
+    DeviceAttributes device_attributes;
+    device_attributes.set_name(name);
+    device_attributes.set_device_type(type);
+    device_attributes.mutable_locality()->set_numa_node(numa_node);
+    return std::make_unique<FakeDevice>(device_attributes);
+  }
+};
+
+constexpr char kCpu0[] = "/job:a/replica:0/task:0/device:CPU:0";
+constexpr char kCpu1[] = "/job:a/replica:0/task:0/device:CPU:1";
+
+class NumaPlacementPassTest : public ::testing::Test {
+ protected:
+  NumaPlacementPassTest() : graph_(new Graph(OpRegistry::Global())) {
+    AddDevice(kCpu0, DEVICE_CPU, /*numa_node=*/0);
+    AddDevice(kCpu1, DEVICE_CPU, /*numa_node=*/1);
+    session_options_.config.mutable_experimental()->set_numa_aware_cpu_devices(
+        true);
+  }
+
+  void AddDevice(const string& name, const string& type, int numa_node) {
+    devices_.push_back(FakeDevice::Make(name, type, numa_node));
+    device_set_.AddDevice(devices_.back().get());
+  }
+
+  // Adds a chain of `length` nodes, and returns them.
+  std::vector<Node*> AddChain(int length) {
+    Tensor t(DT_FLOAT, TensorShape({}));
+    t.scalar<float>()() = 1.0f;
+    std::vector<Node*> chain = {test::graph::Constant(graph_.get(), t)};
+    while (chain.size() < static_cast<size_t>(length)) {
+      chain.push_back(test::graph::Identity(graph_.get(), chain.back()));
+    }
+    return chain;
+  }
+
+  Status Run() {
+    GraphOptimizationPassOptions options;
+    options.session_options = &session_options_;
+    options.device_set = &device_set_;
+    options.graph = &graph_;
+    return NumaPlacementPass().Run(options);
+  }
+
+  // Returns the device that all nodes of `nodes` request, or "mixed".
+  static string RequestedDevice(const std::vector<Node*>& nodes) {
+    const string& device = nodes[0]->requested_device();
+    for (const Node* n : nodes) {
+      if (n->requested_device() != device) return "mixed";
+    }
+    return device;
+  }
+
+  std::vector<std::unique_ptr<Device>> devices_;
+  DeviceSet device_set_;
+  SessionOptions session_options_;
+  std::unique_ptr<Graph> graph_;
+};
+
+TEST_F(NumaPlacementPassTest, SpreadsIndependentSubgraphs) {
+  std::vector<Node*> a = AddChain(4);
+  std::vector<Node*> b = AddChain(3);
+  std::vector<Node*> c = AddChain(1);
+  TF_ASSERT_OK(Run());
+
+  // The largest subgraph goes first, and the smallest one goes to the NUMA
+  // node with the fewest nodes.
+  EXPECT_EQ(kCpu0, RequestedDevice(a));
+  EXPECT_EQ(kCpu1, RequestedDevice(b));
+  EXPECT_EQ(kCpu1, RequestedDevice(c));
+}
+
+TEST_F(NumaPlacementPassTest, KeepsColocatedAndSharedNodesTogether) {
+  std::vector<Node*> a = AddChain(2);
+  std::vector<Node*> b = AddChain(2);
+  std::vector<Node*> c = AddChain(2);
+  std::vector<Node*> d = AddChain(2);
+  b[0]->AddAttr(kColocationAttrName,
+                std::vector<string>{strings::StrCat(kColocationGroupPrefix,
+                                                    a[1]->name())});
+  c[1]->AddAttr("shared_name", "table");
+  d[0]->AddAttr("shared_name", "table");
+  TF_ASSERT_OK(Run());
+
+  EXPECT_EQ(RequestedDevice(a), RequestedDevice(b));
+  EXPECT_EQ(RequestedDevice(c), RequestedDevice(d));
+  EXPECT_NE(RequestedDevice(a), RequestedDevice(c));
+  EXPECT_NE("mixed", RequestedDevice(a));
+  EXPECT_NE("mixed", RequestedDevice(c));
+}
+
+TEST_F(NumaPlacementPassTest, LeavesPlacedSubgraphsAlone) {
+  std::vector<Node*> a = AddChain(3);
+  a[1]->set_requested_device(kCpu1);
+  std::vector<Node*> b = AddChain(2);
+  std::vector<Node*> c = AddChain(2);
+  TF_ASSERT_OK(Run());
+
+  EXPECT_EQ("", a[0]->requested_device());
+  EXPECT_EQ(kCpu1, a[1]->requested_device());
+  EXPECT_EQ("", a[2]->requested_device());
+  EXPECT_NE(RequestedDevice(b), RequestedDevice(c));
+}
+
+TEST_F(NumaPlacementPassTest, NoOpWithNonCpuDevices) {
+  AddDevice("/job:a/replica:0/task:0/device:GPU:0", DEVICE_GPU,
+            /*numa_node=*/0);
+  std::vector<Node*> a = AddChain(2);
+  std::vector<Node*> b = AddChain(2);
+  TF_ASSERT_OK(Run());
+
+  EXPECT_EQ("", RequestedDevice(a));
+  EXPECT_EQ("", RequestedDevice(b));
+}
+
+TEST_F(NumaPlacementPassTest, NoOpUnlessEnabled) {
+  session_options_.config.mutable_experimental()->set_numa_aware_cpu_devices(
+      false);
+  std::vector<Node*> a = AddChain(2);
+  std::vector<Node*> b = AddChain(2);
+  TF_ASSERT_OK(Run());
+
+  EXPECT_EQ("", RequestedDevice(a));
+  EXPECT_EQ("", RequestedDevice(b));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,395 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int64_t kAlignment = Allocator::kAllocatorAlignment;
+
+int64_t RoundUp(int64_t num_bytes) {
+  return (num_bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+bool LifetimesOverlap(const TensorLifetime& a, const TensorLifetime& b) {
+  return a.first_use <= b.last_use && b.first_use <= a.last_use;
+}
+
+}  // namespace
+
+std::vector<int64_t> AssignTensorOffsets(
+    const std::vector<TensorLifetime>& tensors, int64_t* total_bytes) {
+  const int num_tensors = tensors.size();
+  std::vector<int> order(num_tensors);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&tensors](int a, int b) {
+    return tensors[a].size > tensors[b].size;
+  });
+
+  std::vector<int64_t> offsets(num_tensors, -1);
+  // The placed tensors, ordered by offset.
+  std::vector<int> placed;
+  placed.reserve(num_tensors);
+  *total_bytes = 0;
+  for (int t : order) {
+    const int64_t size = RoundUp(tensors[t].size);
+    int64_t best_offset = -1;
+    int64_t best_gap = std::numeric_limits<int64_t>::max();
+    // The end of the last placed tensor that is alive at the same time as `t`
+    // and precedes the current candidate gap.
+    int64_t gap_start = 0;
+    for (int p : placed) {
+      if (!LifetimesOverlap(tensors[t], tensors[p])) continue;
+      const int64_t gap = offsets[p] - gap_start;
+      if (gap >= size && gap < best_gap) {
+        best_offset = gap_start;
+        best_gap = gap;
+      }
+      gap_start = std::max(gap_start, offsets[p] + RoundUp(tensors[p].size));
+    }
+    if (best_offset < 0) best_offset = gap_start;
+    offsets[t] = best_offset;
+    *total_bytes = std::max(*total_bytes, best_offset + size);
+    placed.insert(std::upper_bound(placed.begin(), placed.end(), t,
+                                   [&offsets](int a, int b) {
+                                     return offsets[a] < offsets[b];
+                                   }),
+                  t);
+  }
+  return offsets;
+}
+
+StaticMemoryPlan::StaticMemoryPlan(std::vector<int> output_start,
+                                   std::vector<int> output_slot,
+                                   const std::vector<TensorLifetime>& slots,
+                                   Allocator* base_allocator)
+    : output_start_(std::move(output_start)),
+      output_slot_(std::move(output_slot)),
+      base_allocator_(base_allocator) {
+  const std::vector<int64_t> offsets =
+      AssignTensorOffsets(slots, &total_bytes_);
+  const int num_slots = slots.size();
+  slots_.resize(num_slots);
+  for (int i = 0; i < num_slots; ++i) {
+    slots_[i].offset = offsets[i];
+    slots_[i].size = slots[i].size;
+  }
+
+  // Find the pairs of slots whose memory overlaps, which are the ones that
+  // must not be in use at the same time.
+  std::vector<int> by_offset(num_slots);
+  std::iota(by_offset.begin(), by_offset.end(), 0);
+  std::sort(by_offset.begin(), by_offset.end(), [&offsets](int a, int b) {
+    return offsets[a] < offsets[b];
+  });
+  std::vector<std::vector<int>> overlaps(num_slots);
+  for (int i = 0; i < num_slots; ++i) {
+    const Slot& a = slots_[by_offset[i]];
+    for (int j = i + 1; j < num_slots; ++j) {
+      const Slot& b = slots_[by_offset[j]];
+      if (b.offset >= a.offset + RoundUp(a.size)) break;
+      overlaps[by_offset[i]].push_back(by_offset[j]);
+      overlaps[by_offset[j]].push_back(by_offset[i]);
+    }
+  }
+  for (int i = 0; i < num_slots; ++i) {
+    slots_[i].overlaps_start = overlaps_.size();
+    overlaps_.insert(overlaps_.end(), overlaps[i].begin(), overlaps[i].end());
+    slots_[i].overlaps_end = overlaps_.size();
+  }
+}
+
+StaticMemoryPlan::~StaticMemoryPlan() {
+  mutex_lock l(mu_);
+  for (char* buffer : cached_buffers_) {
+    base_allocator_->DeallocateRaw(buffer);
+  }
+}
+
+StaticMemoryPlan::Step* StaticMemoryPlan::StartStep(
+    Allocator* fallback_allocator) {
+  char* buffer = TakeBuffer();
+  if (buffer == nullptr) return nullptr;
+  return new Step(shared_from_this(), buffer, fallback_allocator);
+}
+
+char* StaticMemoryPlan::TakeBuffer() {
+  {
+    mutex_lock l(mu_);
+    if (!cached_buffers_.empty()) {
+      char* buffer = cached_buffers_.back();
+      cached_buffers_.pop_back();
+      return buffer;
+    }
+  }
+  return static_cast<char*>(
+      base_allocator_->AllocateRaw(kAlignment, total_bytes_));
+}
+
+void StaticMemoryPlan::ReturnBuffer(char* buffer) {
+  {
+    mutex_lock l(mu_);
+    if (cached_buffers_.size() < static_cast<size_t>(kMaxCachedBuffers)) {
+      cached_buffers_.push_back(buffer);
+      return;
+    }
+  }
+  base_allocator_->DeallocateRaw(buffer);
+}
+
+// Allocates the output that is planned at one slot.
+class StaticMemoryPlan::Step::SlotAllocator : public Allocator {
+ public:
+  std::string Name() override { return "static_memory_plan"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return step_->AllocateSlot(slot_, alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override { step_->DeallocateSlot(slot_, ptr); }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return step_->fallback_allocator_->GetMemoryType();
+  }
+
+ private:
+  friend class Step;
+
+  Step* step_ = nullptr;
+  int slot_ = -1;
+};
+
+StaticMemoryPlan::Step::Step(std::shared_ptr<StaticMemoryPlan> plan,
+                             char* buffer, Allocator* fallback_allocator)
+    : plan_(std::move(plan)),
+      buffer_(buffer),
+      fallback_allocator_(fallback_allocator) {
+  const int num_slots = plan_->num_slots();
+  slot_allocators_.reset(new SlotAllocator[num_slots]);
+  in_use_.reset(new std::atomic<bool>[num_slots]);
+  for (int i = 0; i < num_slots; ++i) {
+    slot_allocators_[i].step_ = this;
+    slot_allocators_[i].slot_ = i;
+    in_use_[i].store(false, std::memory_order_relaxed);
+  }
+  output_allocators_.resize(plan_->output_slot_.size());
+  for (size_t i = 0; i < output_allocators_.size(); ++i) {
+    const int slot = plan_->output_slot_[i];
+    output_allocators_[i] = slot < 0 ? nullptr : &slot_allocators_[slot];
+  }
+}
+
+StaticMemoryPlan::Step::~Step() { plan_->ReturnBuffer(buffer_); }
+
+void StaticMemoryPlan::Step::EndStep() {
+  metrics::UpdateStaticMemoryPlanAllocations(
+      num_planned_.load(std::memory_order_relaxed),
+      num_fallback_.load(std::memory_order_relaxed));
+  Unref();
+}
+
+void* StaticMemoryPlan::Step::AllocateSlot(int slot, size_t alignment,
+                                           size_t num_bytes) {
+  const Slot& s = plan_->slots_[slot];
+  if (static_cast<int64_t>(num_bytes) <= s.size &&
+      alignment <= Allocator::kAllocatorAlignment &&
+      !in_use_[slot].exchange(true)) {
+    // A slot that overlaps with this one is still in use if the tensor in it
+    // lives longer than planned. Both this check and the one of a concurrent
+    // allocation of an overlapping slot are sequentially consistent, so at
+    // most one of them succeeds.
+    bool conflict = false;
+    for (int i = s.overlaps_start; i < s.overlaps_end; ++i) {
+      if (in_use_[plan_->overlaps_[i]].load()) {
+        conflict = true;
+        break;
+      }
+    }
+    if (!conflict) {
+      Ref();
+      num_planned_.fetch_add(1, std::memory_order_relaxed);
+      return buffer_ + s.offset;
+    }
+    in_use_[slot].store(false);
+  }
+  void* ptr = fallback_allocator_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) return nullptr;
+  Ref();
+  num_fallback_.fetch_add(1, std::memory_order_relaxed);
+  return ptr;
+}
+
+void StaticMemoryPlan::Step::DeallocateSlot(int slot, void* ptr) {
+  if (ptr == buffer_ + plan_->slots_[slot].offset) {
+    in_use_[slot].store(false);
+  } else {
+    fallback_allocator_->DeallocateRaw(ptr);
+  }
+  Unref();
+}
+
+StaticMemoryPlanner::StaticMemoryPlanner(const Graph& graph,
+                                         Allocator* base_allocator)
+    : base_allocator_(base_allocator) {
+  const int num_node_ids = graph.num_node_ids();
+  output_start_.assign(num_node_ids, -1);
+  input_start_.assign(num_node_ids, -1);
+  int num_outputs = 0;
+  int num_inputs = 0;
+  for (const Node* n : graph.nodes()) {
+    output_start_[n->id()] = num_outputs;
+    input_start_[n->id()] = num_inputs;
+    num_outputs += n->num_outputs();
+    num_inputs += n->num_inputs();
+  }
+
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  std::vector<int> position(num_node_ids, -1);
+  for (size_t i = 0; i < order.size(); ++i) {
+    position[order[i]->id()] = i;
+  }
+
+  output_node_.resize(num_outputs);
+  first_use_.resize(num_outputs);
+  escapes_.assign(num_outputs, false);
+  for (const Node* n : graph.nodes()) {
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      const int output = output_start_[n->id()] + i;
+      output_node_[output] = n->id();
+      first_use_[output] = position[n->id()];
+      // The tensors of arguments and received values come from outside the
+      // step.
+      if (n->IsArg() || n->IsRecv()) escapes_[output] = true;
+    }
+  }
+  last_use_ = first_use_;
+  input_source_.assign(num_inputs, -1);
+  for (const Edge* e : graph.edges()) {
+    if (e->IsControlEdge()) continue;
+    const Node* dst = e->dst();
+    const int output = output_start_[e->src()->id()] + e->src_output();
+    input_source_[input_start_[dst->id()] + e->dst_input()] = output;
+    last_use_[output] = std::max(last_use_[output], position[dst->id()]);
+    if (dst->IsRetval() || dst->IsSend()) escapes_[output] = true;
+  }
+
+  sizes_.reset(new std::atomic<int64_t>[num_outputs]);
+  aliases_.reset(new std::atomic<int>[num_outputs]);
+  for (int i = 0; i < num_outputs; ++i) {
+    sizes_[i].store(0, std::memory_order_relaxed);
+    aliases_[i].store(-1, std::memory_order_relaxed);
+  }
+}
+
+std::shared_ptr<StaticMemoryPlan> StaticMemoryPlanner::plan() const {
+  tf_shared_lock l(mu_);
+  return plan_;
+}
+
+bool StaticMemoryPlanner::recording() const {
+  tf_shared_lock l(mu_);
+  return recording_;
+}
+
+void StaticMemoryPlanner::RecordOutputs(int node_id, OpKernelContext* ctx) {
+  const int output_start = output_start_[node_id];
+  const int input_start = input_start_[node_id];
+  const OpKernelContext::Params* params = ctx->params();
+  for (int i = 0; i < ctx->num_outputs(); ++i) {
+    if (IsRefType(ctx->expected_output_dtype(i))) continue;
+    const Tensor* t = ctx->mutable_output(i);
+    if (t == nullptr || !DataTypeCanUseMemcpy(t->dtype()) ||
+        t->TotalBytes() == 0) {
+      continue;
+    }
+    int alias = -1;
+    for (size_t j = 0; j < params->inputs.size(); ++j) {
+      const Tensor* input = params->inputs[j].tensor;
+      if (input != nullptr && t->SharesBufferWith(*input)) {
+        alias = input_source_[input_start + j];
+        break;
+      }
+    }
+    const int output = output_start + i;
+    aliases_[output].store(alias, std::memory_order_relaxed);
+    const int64_t size = t->TotalBytes();
+    int64_t recorded = sizes_[output].load(std::memory_order_relaxed);
+    while (size > recorded &&
+           !sizes_[output].compare_exchange_weak(recorded, size,
+                                                 std::memory_order_relaxed)) {
+    }
+  }
+}
+
+void StaticMemoryPlanner::FinishRecording() {
+  mutex_lock l(mu_);
+  if (!recording_) return;
+  recording_ = false;
+
+  // An output that shares the buffer of an input keeps the output that first
+  // allocated the buffer alive, and makes it escape if it escapes itself.
+  const int num_outputs = last_use_.size();
+  std::vector<int> last_use = last_use_;
+  std::vector<bool> escapes = escapes_;
+  for (int i = 0; i < num_outputs; ++i) {
+    int root = i;
+    while (aliases_[root].load(std::memory_order_relaxed) >= 0) {
+      root = aliases_[root].load(std::memory_order_relaxed);
+    }
+    last_use[root] = std::max(last_use[root], last_use_[i]);
+    if (escapes_[i]) escapes[root] = true;
+  }
+
+  std::vector<int> output_start(output_start_.size(), -1);
+  std::vector<int> output_slot(num_outputs, -1);
+  std::vector<TensorLifetime> slots;
+  int64_t unplanned_bytes = 0;
+  for (int i = 0; i < num_outputs; ++i) {
+    const int64_t size = sizes_[i].load(std::memory_order_relaxed);
+    if (size == 0 || aliases_[i].load(std::memory_order_relaxed) >= 0 ||
+        escapes[i] || first_use_[i] < 0) {
+      continue;
+    }
+    output_start[output_node_[i]] = output_start_[output_node_[i]];
+    output_slot[i] = slots.size();
+    slots.push_back({size, first_use_[i], last_use[i]});
+    unplanned_bytes += RoundUp(size);
+  }
+  if (slots.empty()) {
+    VLOG(1) << "No output can follow a static memory plan";
+    return;
+  }
+  plan_ = std::make_shared<StaticMemoryPlan>(
+      std::move(output_start), std::move(output_slot), slots, base_allocator_);
+  VLOG(1) << "Planned " << slots.size() << " of " << num_outputs
+          << " outputs in " << plan_->total_bytes() << " bytes, instead of "
+          << unplanned_bytes << " bytes";
+}
+
+}  // namespace tensorflow
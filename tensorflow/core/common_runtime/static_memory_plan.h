@@ -0,0 +1,207 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// The size of a tensor, and the positions in an execution order of the node
+// that produces it and of its last consumer.
+struct TensorLifetime {
+  int64_t size;
+  int first_use;
+  int last_use;
+};
+
+// Assigns every tensor an offset in a single buffer, such that tensors whose
+// lifetimes overlap do not share memory, and returns the offsets. Offsets are
+// multiples of `Allocator::kAllocatorAlignment`, and `*total_bytes` is set to
+// the size of the buffer.
+//
+// Like TF Lite's `ArenaPlanner`, tensors are placed in decreasing order of
+// size, each in the smallest gap between the already placed tensors with
+// overlapping lifetimes that can hold it.
+std::vector<int64_t> AssignTensorOffsets(
+    const std::vector<TensorLifetime>& tensors, int64_t* total_bytes);
+
+// A preassigned placement for some of the outputs of the nodes of a graph in
+// a single buffer per step. Immutable, except for the cache of buffers that
+// finished steps hand back to later ones.
+class StaticMemoryPlan
+    : public std::enable_shared_from_this<StaticMemoryPlan> {
+ public:
+  class Step;
+
+  // `output_start[id]` is the index of the first output of node `id` in
+  // `output_slot`, or -1 if none of its outputs is planned. `output_slot` maps
+  // every output to the index of its entry in `slots`, or to -1 if it is not
+  // planned. Buffers are allocated from `base_allocator`.
+  StaticMemoryPlan(std::vector<int> output_start, std::vector<int> output_slot,
+                   const std::vector<TensorLifetime>& slots,
+                   Allocator* base_allocator);
+  ~StaticMemoryPlan();
+
+  // Returns the state of a new step, holding one reference, or nullptr if the
+  // buffer cannot be allocated. Allocations that do not fit the plan are
+  // served by `fallback_allocator`, which must outlive them.
+  Step* StartStep(Allocator* fallback_allocator);
+
+  int num_slots() const { return slots_.size(); }
+  // The size of the buffer of each step.
+  int64_t total_bytes() const { return total_bytes_; }
+
+ private:
+  struct Slot {
+    int64_t offset;
+    int64_t size;
+    // The slots whose memory overlaps with this one, at
+    // `overlaps_[overlaps_start, overlaps_end)`.
+    int overlaps_start;
+    int overlaps_end;
+  };
+
+  char* TakeBuffer();
+  void ReturnBuffer(char* buffer);
+
+  // Maximum number of buffers kept for reuse by later steps.
+  static constexpr int kMaxCachedBuffers = 4;
+
+  const std::vector<int> output_start_;
+  const std::vector<int> output_slot_;
+  std::vector<Slot> slots_;
+  std::vector<int> overlaps_;
+  int64_t total_bytes_ = 0;
+  Allocator* const base_allocator_;
+
+  mutex mu_;
+  std::vector<char*> cached_buffers_ TF_GUARDED_BY(mu_);
+
+  StaticMemoryPlan(const StaticMemoryPlan&) = delete;
+  void operator=(const StaticMemoryPlan&) = delete;
+};
+
+// The allocations of one step that follows a `StaticMemoryPlan`.
+//
+// Every planned output has its own allocator, which places the output at its
+// offset in the step's buffer. Since kernels may forward an input buffer to
+// an output, a tensor can live longer than the plan assumed. An allocator
+// therefore only uses its slot if none of the slots that overlap with it is
+// in use, and otherwise, or if the requested size exceeds the planned one,
+// falls back to the fallback allocator.
+//
+// The step is reference counted, and each allocation holds a reference, so
+// that the buffer stays alive while any tensor in it escapes the step.
+class StaticMemoryPlan::Step : public core::RefCounted {
+ public:
+  // Returns the allocators of the outputs of node `node_id`, indexed by output
+  // number, or nullptr if none of them is planned. An entry is nullptr for an
+  // output that is not planned.
+  Allocator* const* output_allocators(int node_id) const {
+    const int start = plan_->output_start_[node_id];
+    return start < 0 ? nullptr : &output_allocators_[start];
+  }
+
+  // Reports the allocations of the step and releases the caller's reference.
+  void EndStep();
+
+ private:
+  friend class StaticMemoryPlan;
+  class SlotAllocator;
+
+  Step(std::shared_ptr<StaticMemoryPlan> plan, char* buffer,
+       Allocator* fallback_allocator);
+  ~Step() override;
+
+  void* AllocateSlot(int slot, size_t alignment, size_t num_bytes);
+  void DeallocateSlot(int slot, void* ptr);
+
+  const std::shared_ptr<StaticMemoryPlan> plan_;
+  char* const buffer_;
+  Allocator* const fallback_allocator_;
+  std::unique_ptr<SlotAllocator[]> slot_allocators_;
+  std::unique_ptr<std::atomic<bool>[]> in_use_;
+  std::vector<Allocator*> output_allocators_;
+  std::atomic<int64_t> num_planned_{0};
+  std::atomic<int64_t> num_fallback_{0};
+};
+
+// Builds a `StaticMemoryPlan` for the graph of one executor, from the sizes of
+// the outputs that the kernels allocate during a step.
+//
+// The execution order of the plan is a topological order of the graph. A
+// tensor lives until its last consumer runs, or until the last consumer of an
+// output that the recorded step found to share its buffer. Outputs that are
+// fetched or sent to another device outlive the step, and are not planned.
+class StaticMemoryPlanner {
+ public:
+  StaticMemoryPlanner(const Graph& graph, Allocator* base_allocator);
+
+  // Returns the plan, or nullptr if it is not built yet, or if no output
+  // could be planned.
+  std::shared_ptr<StaticMemoryPlan> plan() const;
+
+  // Returns true while sizes are being recorded.
+  bool recording() const;
+
+  // Records the sizes of the outputs of node `node_id` that `ctx` allocated.
+  // Thread-safe.
+  void RecordOutputs(int node_id, OpKernelContext* ctx);
+
+  // Builds the plan from the sizes recorded so far. Must be called after a
+  // step that recorded outputs completes successfully.
+  void FinishRecording();
+
+ private:
+  Allocator* const base_allocator_;
+  // `output_start_[id]` is the index of the first output of node `id` in the
+  // per-output vectors below.
+  std::vector<int> output_start_;
+  // `input_start_[id]` is the index of the first input of node `id` in
+  // `input_source_`, which holds the output that feeds every input, or -1.
+  std::vector<int> input_start_;
+  std::vector<int> input_source_;
+  // For every output, the node that produces it, the positions of that node
+  // and of its last consumer in a topological order, and whether it escapes
+  // the step.
+  std::vector<int> output_node_;
+  std::vector<int> first_use_;
+  std::vector<int> last_use_;
+  std::vector<bool> escapes_;
+
+  std::unique_ptr<std::atomic<int64_t>[]> sizes_;
+  // The output whose buffer an output shares, or -1.
+  std::unique_ptr<std::atomic<int>[]> aliases_;
+
+  mutable mutex mu_;
+  bool recording_ TF_GUARDED_BY(mu_) = true;
+  std::shared_ptr<StaticMemoryPlan> plan_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLAN_H_
@@ -0,0 +1,304 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_plan.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+using ::tensorflow::monitoring::testing::CellReader;
+
+constexpr char kAllocationsMetric[] =
+    "/tensorflow/core/static_memory_plan_allocations";
+
+// Checks that tensors with overlapping lifetimes do not share memory.
+void ExpectValidOffsets(const std::vector<TensorLifetime>& tensors,
+                        const std::vector<int64_t>& offsets,
+                        int64_t total_bytes) {
+  ASSERT_EQ(tensors.size(), offsets.size());
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    EXPECT_EQ(0, offsets[i] % Allocator::kAllocatorAlignment);
+    EXPECT_LE(offsets[i] + tensors[i].size, total_bytes);
+    for (size_t j = i + 1; j < tensors.size(); ++j) {
+      if (tensors[i].last_use < tensors[j].first_use ||
+          tensors[j].last_use < tensors[i].first_use) {
+        continue;
+      }
+      EXPECT_TRUE(offsets[i] + tensors[i].size <= offsets[j] ||
+                  offsets[j] + tensors[j].size <= offsets[i])
+          << "tensors " << i << " and " << j << " overlap";
+    }
+  }
+}
+
+TEST(AssignTensorOffsetsTest, DisjointLifetimesShareMemory) {
+  // A chain, where every tensor is consumed by the node that produces the
+  // next one.
+  std::vector<TensorLifetime> tensors = {
+      {100, 0, 1}, {200, 1, 2}, {100, 2, 3}, {200, 3, 4}};
+  int64_t total_bytes;
+  std::vector<int64_t> offsets = AssignTensorOffsets(tensors, &total_bytes);
+  ExpectValidOffsets(tensors, offsets, total_bytes);
+  EXPECT_EQ(std::vector<int64_t>({256, 0, 256, 0}), offsets);
+  EXPECT_EQ(384, total_bytes);
+}
+
+TEST(AssignTensorOffsetsTest, FillsGaps) {
+  // The largest tensors are placed first, and the small one that lives
+  // between them goes into the gap that the first one leaves.
+  std::vector<TensorLifetime> tensors = {
+      {1000, 0, 1}, {1000, 0, 5}, {64, 2, 3}, {500, 4, 5}};
+  int64_t total_bytes;
+  std::vector<int64_t> offsets = AssignTensorOffsets(tensors, &total_bytes);
+  ExpectValidOffsets(tensors, offsets, total_bytes);
+  EXPECT_EQ(2048, total_bytes);
+  EXPECT_EQ(offsets[0], offsets[2]);
+}
+
+TEST(AssignTensorOffsetsTest, RandomLifetimes) {
+  random::PhiloxRandom philox(testing::RandomSeed(), 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<TensorLifetime> tensors;
+  int64_t sum_bytes = 0;
+  for (int i = 0; i < 200; ++i) {
+    const int first_use = rnd.Uniform(100);
+    tensors.push_back({static_cast<int64_t>(1 + rnd.Uniform(4096)), first_use,
+                       first_use + static_cast<int>(rnd.Uniform(10))});
+    sum_bytes += tensors.back().size;
+  }
+  int64_t total_bytes;
+  std::vector<int64_t> offsets = AssignTensorOffsets(tensors, &total_bytes);
+  ExpectValidOffsets(tensors, offsets, total_bytes);
+  EXPECT_LT(total_bytes, sum_bytes);
+}
+
+// A plan for two single-output nodes whose outputs share memory.
+std::shared_ptr<StaticMemoryPlan> TwoSlotPlan() {
+  return std::make_shared<StaticMemoryPlan>(
+      std::vector<int>{0, 1}, std::vector<int>{0, 1},
+      std::vector<TensorLifetime>{{64, 0, 0}, {64, 1, 1}}, cpu_allocator());
+}
+
+TEST(StaticMemoryPlanTest, FallsBackWhileOverlappingSlotIsInUse) {
+  CellReader<int64_t> allocations(kAllocationsMetric);
+  std::shared_ptr<StaticMemoryPlan> plan = TwoSlotPlan();
+  EXPECT_EQ(64, plan->total_bytes());
+  StaticMemoryPlan::Step* step = plan->StartStep(cpu_allocator());
+  ASSERT_NE(nullptr, step);
+  Allocator* a0 = step->output_allocators(0)[0];
+  Allocator* a1 = step->output_allocators(1)[0];
+
+  Tensor t0(a0, DT_FLOAT, TensorShape({16}));
+  t0.flat<float>().setConstant(1.0f);
+  // The first tensor lives longer than planned.
+  Tensor t1(a1, DT_FLOAT, TensorShape({16}));
+  t1.flat<float>().setConstant(2.0f);
+  EXPECT_NE(t0.data(), t1.data());
+  EXPECT_EQ(1.0f, t0.flat<float>()(15));
+
+  void* planned = t0.data();
+  t0 = Tensor();
+  t1 = Tensor();
+  Tensor t2(a1, DT_FLOAT, TensorShape({16}));
+  EXPECT_EQ(planned, t2.data());
+  // Larger than planned.
+  Tensor t3(a0, DT_FLOAT, TensorShape({32}));
+  EXPECT_NE(planned, t3.data());
+  t2 = Tensor();
+  t3 = Tensor();
+  step->EndStep();
+
+  EXPECT_EQ(2, allocations.Delta("planned"));
+  EXPECT_EQ(2, allocations.Delta("fallback"));
+}
+
+TEST(StaticMemoryPlanTest, EscapedTensorOutlivesStep) {
+  std::shared_ptr<StaticMemoryPlan> plan = TwoSlotPlan();
+  StaticMemoryPlan::Step* step = plan->StartStep(cpu_allocator());
+  Tensor escaped(step->output_allocators(0)[0], DT_FLOAT, TensorShape({16}));
+  escaped.flat<float>().setConstant(42.0f);
+  step->EndStep();
+
+  // The buffer holding `escaped` is not handed to the next step.
+  StaticMemoryPlan::Step* next_step = plan->StartStep(cpu_allocator());
+  Tensor next(next_step->output_allocators(0)[0], DT_FLOAT, TensorShape({16}));
+  next.flat<float>().setZero();
+  EXPECT_NE(escaped.data(), next.data());
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(42.0f, escaped.flat<float>()(i));
+  }
+  next = Tensor();
+  next_step->EndStep();
+  escaped = Tensor();
+}
+
+// Builds a graph where `width` chains of `depth` square matrix products start
+// from `in`, and are summed.
+void BuildMatMulChains(int width, int depth, int dim, Node* in, Graph* g,
+                       Node** out) {
+  Tensor w(DT_FLOAT, TensorShape({dim, dim}));
+  // Multiplying by `w` preserves a matrix whose entries are all equal.
+  w.flat<float>().setConstant(1.0f / dim);
+  std::vector<Node*> chains;
+  for (int i = 0; i < width; ++i) {
+    Node* n = in;
+    for (int j = 0; j < depth; ++j) {
+      n = test::graph::Matmul(g, n, test::graph::Constant(g, w), false, false);
+    }
+    chains.push_back(n);
+  }
+  while (chains.size() > 1) {
+    Node* n = test::graph::Add(g, chains[chains.size() - 2], chains.back());
+    chains.pop_back();
+    chains.back() = n;
+  }
+  *out = chains.back();
+}
+
+class StaticMemoryPlanExecutorTest : public ::testing::Test {
+ protected:
+  StaticMemoryPlanExecutorTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:localhost/replica:0/task:0")),
+        thread_pool_(Env::Default(), "static_memory_plan_test", 4) {}
+
+  void Create(std::unique_ptr<const Graph> graph) {
+    const int version = graph->versions().producer();
+    LocalExecutorParams params;
+    params.device = device_.get();
+    params.use_static_memory_plan = true;
+    params.create_kernel =
+        [this, version](const std::shared_ptr<const NodeProperties>& props,
+                        OpKernel** kernel) {
+          return CreateNonCachedKernel(device_.get(), nullptr, props, version,
+                                       kernel);
+        };
+    params.delete_kernel = [](OpKernel* kernel) {
+      DeleteNonCachedKernel(kernel);
+    };
+    TF_CHECK_OK(NewExecutor("", params, *graph, &exec_));
+  }
+
+  Status Run(const Tensor& arg, Tensor* retval) {
+    FunctionCallFrame call_frame({arg.dtype()}, {DT_FLOAT});
+    TF_RETURN_IF_ERROR(call_frame.SetArgs({arg}));
+    Executor::Args args;
+    args.call_frame = &call_frame;
+    args.runner = [this](std::function<void()> fn) {
+      thread_pool_.Schedule(std::move(fn));
+    };
+    TF_RETURN_IF_ERROR(exec_->Run(args));
+    std::vector<Tensor> retvals;
+    TF_RETURN_IF_ERROR(call_frame.ConsumeRetvals(&retvals, false));
+    *retval = retvals[0];
+    return OkStatus();
+  }
+
+  std::unique_ptr<Device> device_;
+  thread::ThreadPool thread_pool_;
+  std::unique_ptr<Executor> exec_;
+};
+
+TEST_F(StaticMemoryPlanExecutorTest, MatMulChains) {
+  CellReader<int64_t> allocations(kAllocationsMetric);
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* out;
+  BuildMatMulChains(/*width=*/4, /*depth=*/8, /*dim=*/8,
+                    test::graph::Arg(g.get(), 0, DT_FLOAT), g.get(), &out);
+  test::graph::Retval(g.get(), 0, out);
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g));
+
+  // The first step records the sizes of the outputs, and the others follow
+  // the plan.
+  for (int step = 0; step < 5; ++step) {
+    Tensor in(DT_FLOAT, TensorShape({8, 8}));
+    in.flat<float>().setConstant(step);
+    Tensor out;
+    TF_ASSERT_OK(Run(in, &out));
+    Tensor expected(DT_FLOAT, TensorShape({8, 8}));
+    expected.flat<float>().setConstant(4 * step);
+    test::ExpectTensorNear<float>(expected, out, 1e-5);
+  }
+  // The matrix products of the chains are planned, except for the one that
+  // the sums forward to the fetched output.
+  EXPECT_GT(allocations.Delta("planned"), 0);
+}
+
+// Runs `width` chains of `depth` matrix products per step, with or without a
+// static memory plan, and reports the peak memory and the number of
+// allocations of the CPU allocator per step.
+static void BM_MatMulChains(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool use_plan = state.range(2) != 0;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor in(DT_FLOAT, TensorShape({64, 64}));
+  in.flat<float>().setConstant(1.0f);
+  Node* out;
+  BuildMatMulChains(width, depth, /*dim=*/64, test::graph::Constant(g, in), g,
+                    &out);
+  FixupSourceAndSinkEdges(g);
+
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_static_memory_plan(use_plan);
+  EnableCPUAllocatorStats();
+  cpu_allocator()->ClearStats();
+  test::Benchmark("cpu", g, &options, /*init=*/nullptr, /*rendez=*/nullptr,
+                  /*executor_type=*/"", /*old_benchmark_api=*/false)
+      .Run(state);
+  absl::optional<AllocatorStats> stats = cpu_allocator()->GetStats();
+  if (stats.has_value() && state.iterations() > 0) {
+    state.counters["peak_bytes"] = stats->peak_bytes_in_use;
+    state.counters["allocs_per_step"] =
+        static_cast<double>(stats->num_allocs) / state.iterations();
+  }
+  DisableCPUAllocatorStats();
+  state.SetLabel(use_plan ? "static_memory_plan" : "dynamic");
+}
+
+BENCHMARK(BM_MatMulChains)
+    ->UseRealTime()
+    ->Args({1, 32, 0})
+    ->Args({1, 32, 1})
+    ->Args({8, 8, 0})
+    ->Args({8, 8, 1});
+
+}  // namespace
+}  // namespace tensorflow
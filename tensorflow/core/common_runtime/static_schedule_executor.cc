@@ -0,0 +1,743 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_schedule_executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/entry.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
+#include "tensorflow/core/common_runtime/graph_constructor.h"
+#include "tensorflow/core/common_runtime/renamed_device.h"
+#include "tensorflow/core/common_runtime/single_threaded_executor.h"
+#include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+
+std::vector<std::vector<int>> ComputeStaticSchedule(
+    const std::vector<std::vector<int>>& successors,
+    const std::vector<int64_t>& costs, int max_threads,
+    int64_t cross_thread_cost) {
+  const int num_nodes = costs.size();
+  std::vector<std::vector<int>> predecessors(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    for (int s : successors[i]) {
+      predecessors[s].push_back(i);
+    }
+  }
+
+  // Successors come after their predecessors, so a reverse pass computes the
+  // bottom levels.
+  std::vector<int64_t> bottom_level(num_nodes);
+  for (int i = num_nodes - 1; i >= 0; --i) {
+    int64_t max_successor_level = 0;
+    for (int s : successors[i]) {
+      max_successor_level = std::max(max_successor_level, bottom_level[s]);
+    }
+    bottom_level[i] = std::max<int64_t>(costs[i], 1) + max_successor_level;
+  }
+
+  // Costs are positive, so a node's bottom level exceeds those of its
+  // successors and this order is also topological.
+  std::vector<int> order(num_nodes);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&bottom_level](int a, int b) {
+    return bottom_level[a] > bottom_level[b];
+  });
+
+  max_threads = std::max(max_threads, 1);
+  std::vector<std::vector<int>> threads(max_threads);
+  std::vector<int64_t> thread_ready(max_threads, 0);
+  std::vector<int64_t> finish(num_nodes, 0);
+  std::vector<int> thread_of(num_nodes, -1);
+  for (int i : order) {
+    int best_thread = -1;
+    int64_t best_start = 0;
+    for (int t = 0; t < max_threads; ++t) {
+      int64_t start = thread_ready[t];
+      for (int p : predecessors[i]) {
+        start = std::max(
+            start, finish[p] + (thread_of[p] == t ? 0 : cross_thread_cost));
+      }
+      if (best_thread < 0 || start < best_start) {
+        best_thread = t;
+        best_start = start;
+      }
+      // Threads are filled in order, and all idle threads are equivalent.
+      if (threads[t].empty()) break;
+    }
+    threads[best_thread].push_back(i);
+    thread_of[i] = best_thread;
+    finish[i] = best_start + std::max<int64_t>(costs[i], 1);
+    thread_ready[best_thread] = finish[i];
+  }
+
+  threads.erase(std::remove_if(threads.begin(), threads.end(),
+                               [](const std::vector<int>& thread) {
+                                 return thread.empty();
+                               }),
+                threads.end());
+  return threads;
+}
+
+namespace {
+
+typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
+typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
+
+static const string& kStaticScheduleExecutor =
+    *new string("STATIC_SCHEDULE_EXECUTOR");
+
+// The number of warm-up steps of the "STATIC_SCHEDULE_EXECUTOR" executor type.
+constexpr int kDefaultWarmupSteps = 10;
+
+// One in this many replayed steps runs on the default executor, to measure
+// the step time that the static schedule is compared against.
+constexpr int64_t kProbeInterval = 1000;
+
+// The estimated cost of handing a value to a node on another thread, which
+// may have to be resumed through the runner, in nanoseconds.
+constexpr int64_t kCrossThreadCostNanos = 2000;
+
+// A compiled static schedule.
+struct StaticPlan {
+  struct NodeState {
+    // The kernel object. Not owned.
+    //
+    // This pointer is managed by `params_.create_kernel()` and
+    // `params_.delete_kernel()`.
+    OpKernel* kernel = nullptr;
+
+    // The range of elements in the flat `StaticStep::inputs` vector that
+    // corresponds to the inputs of `kernel`, as in the single-threaded
+    // executor.
+    size_t input_start_index = 0;
+    size_t num_inputs = 0;
+
+    size_t num_outputs = 0;
+
+    // For the `j`th output of `kernel`, `output_locations[j]` contains the
+    // locations in the flat `inputs` vector to which that output must be
+    // copied.
+    std::vector<std::vector<size_t>> output_locations;
+
+    // Memory space information for each output of `kernel`.
+    std::vector<AllocatorAttributes> output_alloc_attrs;
+
+    // The thread that runs this node, and the node's position in that
+    // thread's sequence.
+    int thread = -1;
+    size_t position = 0;
+
+    // The number of distinct predecessors that run on other threads.
+    int num_remote_inputs = 0;
+
+    // The distinct successors that run on other threads.
+    std::vector<int> remote_successors;
+  };
+
+  // All nodes, in topological order.
+  std::vector<NodeState> nodes;
+
+  // The indices of the nodes run by each thread, in execution order.
+  std::vector<std::vector<int>> threads;
+
+  size_t total_num_inputs = 0;
+
+  // Memory space information for each element of the flat `inputs` vector.
+  std::vector<AllocatorAttributes> input_alloc_attrs;
+};
+
+// The state of one step that replays a `StaticPlan`. The thread that finishes
+// last deletes it.
+struct StaticStep {
+  StaticStep(const StaticPlan& plan, const Executor::Args& args,
+             Executor::DoneCallback done)
+      : plan(plan),
+        args(args),
+        runner(args.runner),
+        done(std::move(done)),
+        inputs(plan.total_num_inputs),
+        pending(new std::atomic<int>[plan.nodes.size()]),
+        num_running_threads(plan.threads.size()) {}
+
+  const StaticPlan& plan;
+  const Executor::Args args;
+  Executor::Args::Runner runner;
+  Executor::DoneCallback done;
+
+  Device* device = nullptr;
+  std::unique_ptr<Device> user_device;
+  DeviceContext* device_context = nullptr;
+  uint64 start_time_usecs = 0;
+
+  // The inputs of every node. See `SingleThreadedExecutorImpl::Run()`.
+  std::vector<Entry> inputs;
+
+  // For a node with remote inputs, one more than the number of those inputs
+  // that are not yet available. The thread that runs the node and the threads
+  // that produce its remote inputs each decrement it once; whichever brings it
+  // to zero runs the node.
+  std::unique_ptr<std::atomic<int>[]> pending;
+
+  std::atomic<int> num_running_threads;
+  std::atomic<bool> aborted{false};
+
+  mutex mu;
+  Status status TF_GUARDED_BY(mu);
+};
+
+class StaticScheduleExecutorImpl : public Executor {
+ public:
+  StaticScheduleExecutorImpl(const LocalExecutorParams& params,
+                             int warmup_steps)
+      : params_(params), warmup_steps_(warmup_steps) {}
+
+  ~StaticScheduleExecutorImpl() override {
+    if (plan_ != nullptr) {
+      for (const StaticPlan::NodeState& node : plan_->nodes) {
+        params_.delete_kernel(node.kernel);
+      }
+    }
+  }
+
+  Status Initialize(const Graph& graph) {
+    Executor* dynamic_executor;
+    TF_RETURN_IF_ERROR(NewLocalExecutor(params_, graph, &dynamic_executor));
+    dynamic_executor_.reset(dynamic_executor);
+
+    Status s = CheckSupported(graph);
+    if (!s.ok()) {
+      VLOG(1) << "Not recording a static schedule: " << s;
+      return OkStatus();
+    }
+    mutex_lock l(mu_);
+    graph_ = std::make_unique<Graph>(graph.flib_def());
+    CopyGraph(graph, graph_.get());
+    cost_nanos_.resize(graph_->num_node_ids());
+    for (const Node* n : graph_->op_nodes()) {
+      node_ids_[n->name()] = n->id();
+    }
+    recording_ = true;
+    return OkStatus();
+  }
+
+ private:
+  void RunAsyncInternal(const Args& args, DoneCallback done) override {
+    if (args.stats_collector == nullptr) {
+      const StaticPlan* plan = published_plan_.load(std::memory_order_acquire);
+      if (plan != nullptr) {
+        const int64_t step =
+            num_replayed_steps_.fetch_add(1, std::memory_order_relaxed);
+        if (step % kProbeInterval != kProbeInterval - 1) {
+          RunStatic(*plan, args, std::move(done));
+        } else {
+          RunProbe(args, std::move(done));
+        }
+        return;
+      }
+      if (recording_.load(std::memory_order_relaxed)) {
+        RunWarmup(args, std::move(done));
+        return;
+      }
+    }
+    dynamic_executor_->RunAsync(args, std::move(done));
+  }
+
+  Status CheckSupported(const Graph& graph) const {
+    if (params_.device->device_type() != DEVICE_CPU) {
+      return errors::Unimplemented(
+          "Static schedules are only supported on CPU devices, but got ",
+          params_.device->device_type());
+    }
+    for (const Node* n : graph.op_nodes()) {
+      TF_RETURN_IF_ERROR(ValidateOpIsSafeForSyncExecution(
+          *n, /*allow_control_flow_sync_execution=*/false));
+    }
+    return OkStatus();
+  }
+
+  // Runs a step on the default executor and records the cost of its nodes.
+  void RunWarmup(const Args& args, DoneCallback done) {
+    auto* step_stats = new StepStats;
+    auto* collector = new StepStatsCollector(step_stats);
+    Args warmup_args = args;
+    warmup_args.stats_collector = collector;
+    dynamic_executor_->RunAsync(
+        warmup_args, [this, step_stats, collector,
+                      done = std::move(done)](const Status& s) {
+          collector->Finalize();
+          delete collector;
+          if (s.ok()) RecordCosts(*step_stats);
+          delete step_stats;
+          done(s);
+        });
+  }
+
+  void RecordCosts(const StepStats& step_stats) {
+    mutex_lock l(mu_);
+    if (!recording_.load(std::memory_order_relaxed)) return;
+    for (const DeviceStepStats& device_stats : step_stats.dev_stats()) {
+      for (const NodeExecStats& node_stats : device_stats.node_stats()) {
+        auto it = node_ids_.find(node_stats.node_name());
+        if (it == node_ids_.end()) continue;
+        int64_t nanos =
+            node_stats.op_end_rel_nanos() - node_stats.op_start_rel_nanos();
+        if (nanos <= 0) {
+          nanos = (node_stats.op_end_rel_micros() -
+                   node_stats.op_start_rel_micros()) *
+                  1000;
+        }
+        cost_nanos_[it->second] += std::max<int64_t>(nanos, 0);
+      }
+    }
+    if (++num_recorded_steps_ < warmup_steps_) return;
+
+    recording_ = false;
+    Status s = Compile();
+    if (!s.ok()) {
+      VLOG(1) << "Not replaying a static schedule: " << s;
+    }
+    graph_.reset();
+  }
+
+  Status Compile() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    std::vector<Node*> ordered_nodes;
+    GetReversePostOrder(*graph_, &ordered_nodes);
+    std::vector<const Node*> nodes;
+    nodes.reserve(ordered_nodes.size());
+    absl::flat_hash_map<const Node*, int> node_index;
+    for (const Node* n : ordered_nodes) {
+      if (!n->IsOp()) continue;
+      node_index[n] = nodes.size();
+      nodes.push_back(n);
+    }
+
+    auto plan = std::make_unique<StaticPlan>();
+    plan->nodes.resize(nodes.size());
+    auto kernel_cleanup = gtl::MakeCleanup([this, &plan] {
+      for (const StaticPlan::NodeState& node : plan->nodes) {
+        if (node.kernel != nullptr) params_.delete_kernel(node.kernel);
+      }
+    });
+
+    std::vector<std::vector<int>> successors(nodes.size());
+    std::vector<int64_t> costs(nodes.size());
+    size_t num_inputs = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const Node* n = nodes[i];
+      StaticPlan::NodeState& node = plan->nodes[i];
+      TF_RETURN_IF_ERROR(params_.create_kernel(n->properties(), &node.kernel));
+      if (node.kernel->AsAsync() != nullptr) {
+        return errors::Unimplemented("Node ", n->name(),
+                                     " has an asynchronous kernel");
+      }
+      node.input_start_index = num_inputs;
+      node.num_inputs = n->num_inputs();
+      node.num_outputs = n->num_outputs();
+      num_inputs += node.num_inputs;
+
+      costs[i] = std::max<int64_t>(
+          cost_nanos_[n->id()] / num_recorded_steps_, 1);
+      for (const Edge* e : n->out_edges()) {
+        if (e->dst()->IsOp()) successors[i].push_back(node_index[e->dst()]);
+      }
+      std::sort(successors[i].begin(), successors[i].end());
+      successors[i].erase(
+          std::unique(successors[i].begin(), successors[i].end()),
+          successors[i].end());
+    }
+
+    // Build the mapping from each node output to the input slots of its
+    // consumers, and the memory space information of each slot.
+    plan->total_num_inputs = num_inputs;
+    plan->input_alloc_attrs.resize(num_inputs);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      StaticPlan::NodeState& node = plan->nodes[i];
+      node.output_locations.resize(node.num_outputs);
+      node.output_alloc_attrs.resize(node.num_outputs);
+      for (size_t out = 0; out < node.num_outputs; ++out) {
+        if (node.kernel->output_memory_types()[out] == HOST_MEMORY) {
+          node.output_alloc_attrs[out].set_on_host(true);
+        }
+      }
+      for (const Edge* e : nodes[i]->out_edges()) {
+        if (e->IsControlEdge() || !e->dst()->IsOp()) continue;
+        const size_t location =
+            plan->nodes[node_index[e->dst()]].input_start_index +
+            e->dst_input();
+        node.output_locations[e->src_output()].push_back(location);
+        plan->input_alloc_attrs[location] =
+            node.output_alloc_attrs[e->src_output()];
+      }
+    }
+
+    plan->threads = ComputeStaticSchedule(
+        successors, costs, port::MaxParallelism(), kCrossThreadCostNanos);
+    for (size_t t = 0; t < plan->threads.size(); ++t) {
+      for (size_t position = 0; position < plan->threads[t].size();
+           ++position) {
+        StaticPlan::NodeState& node = plan->nodes[plan->threads[t][position]];
+        node.thread = t;
+        node.position = position;
+      }
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      for (int s : successors[i]) {
+        if (plan->nodes[s].thread != plan->nodes[i].thread) {
+          plan->nodes[i].remote_successors.push_back(s);
+          ++plan->nodes[s].num_remote_inputs;
+        }
+      }
+    }
+
+    VLOG(1) << "Compiled a static schedule of " << nodes.size()
+            << " nodes on " << plan->threads.size() << " threads for "
+            << params_.device->name();
+    kernel_cleanup.release();
+    plan_ = std::move(plan);
+    published_plan_.store(plan_.get(), std::memory_order_release);
+    return OkStatus();
+  }
+
+  void RunStatic(const StaticPlan& plan, const Args& args,
+                 DoneCallback done) {
+    auto* step = new StaticStep(plan, args, std::move(done));
+    step->start_time_usecs = Env::Default()->NowMicros();
+    step->device = params_.device;
+    if (args.user_intra_op_threadpool != nullptr) {
+      step->user_device = RenamedDevice::NewRenamedDevice(
+          step->device->name(), step->device, /*owns_underlying=*/false,
+          /*isolate_session_state=*/false, args.user_intra_op_threadpool);
+      step->device = step->user_device.get();
+    }
+    step->device->TryGetDeviceContext(&step->device_context).IgnoreError();
+    for (size_t i = 0; i < plan.nodes.size(); ++i) {
+      if (plan.nodes[i].num_remote_inputs > 0) {
+        step->pending[i].store(plan.nodes[i].num_remote_inputs + 1,
+                               std::memory_order_relaxed);
+      }
+    }
+
+    if (args.run_all_kernels_inline || plan.threads.size() <= 1) {
+      // Run all nodes in topological order on this thread, without any
+      // synchronization.
+      OpKernelContext::Params params;
+      InitParams(step, &params);
+      TensorValueVec node_inputs;
+      AllocatorAttributeVec input_alloc_attrs;
+      for (const StaticPlan::NodeState& node : plan.nodes) {
+        RunNode(step, node, &params, &node_inputs, &input_alloc_attrs);
+      }
+      FinishStep(step);
+      return;
+    }
+
+    // `step` may be deleted as soon as the last thread is started.
+    const int num_threads = plan.threads.size();
+    for (int t = 0; t < num_threads; ++t) {
+      args.runner([this, step, t]() {
+        RunThread(step, t, /*position=*/0, /*resumed=*/false);
+      });
+    }
+  }
+
+  // Runs the nodes of `thread` from `position` on, until the thread either
+  // finishes or reaches a node whose remote inputs are not all available.
+  // `resumed` is true if the remote inputs of the node at `position` are known
+  // to be available.
+  void RunThread(StaticStep* step, int thread, size_t position, bool resumed) {
+    const StaticPlan& plan = step->plan;
+    const std::vector<int>& thread_nodes = plan.threads[thread];
+    OpKernelContext::Params params;
+    InitParams(step, &params);
+    TensorValueVec node_inputs;
+    AllocatorAttributeVec input_alloc_attrs;
+    for (; position < thread_nodes.size(); ++position) {
+      const int i = thread_nodes[position];
+      const StaticPlan::NodeState& node = plan.nodes[i];
+      if (node.num_remote_inputs > 0 && !resumed &&
+          step->pending[i].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        // The thread that produces the last remote input resumes this thread
+        // at this node.
+        return;
+      }
+      resumed = false;
+      RunNode(step, node, &params, &node_inputs, &input_alloc_attrs);
+      for (int s : node.remote_successors) {
+        if (step->pending[s].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          const int successor_thread = plan.nodes[s].thread;
+          const size_t successor_position = plan.nodes[s].position;
+          step->runner([this, step, successor_thread, successor_position]() {
+            RunThread(step, successor_thread, successor_position,
+                      /*resumed=*/true);
+          });
+        }
+      }
+    }
+    if (step->num_running_threads.fetch_sub(1, std::memory_order_acq_rel) ==
+        1) {
+      FinishStep(step);
+    }
+  }
+
+  // Prepares the parameters that are the same for all kernels of a step.
+  void InitParams(StaticStep* step, OpKernelContext::Params* params) {
+    const Args& args = step->args;
+    params->step_id = args.step_id;
+    params->start_time_usecs = args.start_time_usecs;
+    params->deadline = args.deadline;
+    params->device = step->device;
+    params->log_memory = false;
+    params->rendezvous = args.rendezvous;
+    params->session_state = args.session_state;
+    params->session_metadata = params_.session_metadata;
+    params->tensor_store = args.tensor_store;
+    params->cancellation_manager = args.cancellation_manager;
+    params->call_frame = args.call_frame;
+    params->function_library = params_.function_library;
+    params->resource_manager = step->device->resource_manager();
+    params->step_container = args.step_container;
+    params->collective_executor = args.collective_executor;
+    params->stack_trace = args.stack_trace;
+    params->slice_reader_cache = nullptr;
+    params->runner = &step->runner;
+    params->run_all_kernels_inline = args.run_all_kernels_inline;
+    params->stats_collector = nullptr;
+    params->executor_type = &kStaticScheduleExecutor;
+    // The graph has no control flow.
+    params->frame_iter = FrameAndIter(0, 0);
+    params->is_input_dead = false;
+    params->op_device_context = step->device_context;
+    params->forward_from_array = nullptr;
+  }
+
+  void RunNode(StaticStep* step, const StaticPlan::NodeState& node,
+               OpKernelContext::Params* params, TensorValueVec* node_inputs,
+               AllocatorAttributeVec* input_alloc_attrs) {
+    Entry* inputs = step->inputs.data() + node.input_start_index;
+    if (step->aborted.load(std::memory_order_relaxed)) {
+      // Some inputs may be missing. Only release the ones that are present.
+      for (size_t j = 0; j < node.num_inputs; ++j) {
+        inputs[j].ClearVal();
+      }
+      return;
+    }
+
+    node_inputs->clear();
+    node_inputs->resize(node.num_inputs);
+    input_alloc_attrs->clear();
+    input_alloc_attrs->resize(node.num_inputs);
+    for (size_t j = 0; j < node.num_inputs; ++j) {
+      Entry& input = inputs[j];
+      switch (input.state) {
+        case Entry::State::HAS_CONST_TENSOR:
+          (*node_inputs)[j].tensor = const_cast<Tensor*>(input.const_tensor);
+          break;
+        case Entry::State::HAS_VALUE:
+          (*node_inputs)[j].tensor = input.val.get();
+          break;
+        default:
+          DCHECK(false) << "Input did not have a valid value.";
+      }
+      (*input_alloc_attrs)[j] =
+          step->plan.input_alloc_attrs[node.input_start_index + j];
+    }
+    params->inputs = *node_inputs;
+    params->input_alloc_attrs = *input_alloc_attrs;
+    params->op_kernel = node.kernel;
+    params->output_attr_array = node.output_alloc_attrs.data();
+    OpKernelContext ctx(params, node.num_outputs);
+    step->device->Compute(node.kernel, &ctx);
+
+    for (size_t j = 0; j < node.num_inputs; ++j) {
+      inputs[j].ClearVal();
+    }
+    if (!ctx.status().ok()) {
+      Abort(step, ctx.status());
+      return;
+    }
+
+    // Forward the outputs of the kernel to the inputs of its consumers.
+    for (size_t j = 0; j < node.num_outputs; ++j) {
+      TensorValue val = ctx.release_output(j);
+      const std::vector<size_t>& locations = node.output_locations[j];
+      for (size_t k = 0; k < locations.size(); ++k) {
+        Entry& input = step->inputs[locations[k]];
+        input.state = Entry::State::HAS_VALUE;
+        if (val.tensor == nullptr) {
+          input.val.Init(Tensor(node.kernel->output_type(j)));
+        } else if (k + 1 < locations.size()) {
+          input.val.Init(*val.tensor);
+        } else {
+          // Move the tensor to the last consumer to avoid copying it.
+          input.val.Init(std::move(*val.tensor));
+        }
+      }
+      delete val.tensor;
+    }
+  }
+
+  void Abort(StaticStep* step, const Status& s) {
+    {
+      mutex_lock l(step->mu);
+      if (!step->status.ok()) return;
+      step->status = s;
+      step->aborted.store(true, std::memory_order_relaxed);
+    }
+    VLOG(1) << "[" << params_.device->name()
+            << "] Static schedule start aborting: " << s;
+    const Args& args = step->args;
+    if (args.rendezvous != nullptr) {
+      args.rendezvous->StartAbort(s);
+    }
+    if (args.cancellation_manager != nullptr) {
+      args.cancellation_manager->StartCancelWithStatus(s);
+    } else if (args.collective_executor != nullptr) {
+      args.collective_executor->StartAbort(s);
+    }
+  }
+
+  void FinishStep(StaticStep* step) {
+    Status status;
+    {
+      mutex_lock l(step->mu);
+      status = step->status;
+    }
+    if (status.ok() && step->args.sync_on_finish) {
+      status = step->device->Sync();
+    }
+    if (step->device_context != nullptr) {
+      step->device_context->Unref();
+    }
+    const uint64 step_time_usecs =
+        Env::Default()->NowMicros() - step->start_time_usecs;
+    DoneCallback done = std::move(step->done);
+    delete step;
+
+    metrics::UpdateStaticScheduleStepTime(/*replayed=*/true, step_time_usecs);
+    replayed_time_usecs_.fetch_add(step_time_usecs, std::memory_order_relaxed);
+    num_replayed_steps_since_probe_.fetch_add(1, std::memory_order_relaxed);
+    done(status);
+  }
+
+  // Runs a step on the default executor to measure the step time that the
+  // static schedule saves against.
+  void RunProbe(const Args& args, DoneCallback done) {
+    const uint64 start_time_usecs = Env::Default()->NowMicros();
+    dynamic_executor_->RunAsync(args, [this, start_time_usecs,
+                                       done = std::move(done)](
+                                          const Status& s) {
+      const uint64 step_time_usecs =
+          Env::Default()->NowMicros() - start_time_usecs;
+      metrics::UpdateStaticScheduleStepTime(/*replayed=*/false,
+                                            step_time_usecs);
+      const int64_t replayed_time_usecs =
+          replayed_time_usecs_.exchange(0, std::memory_order_relaxed);
+      const int64_t num_replayed_steps =
+          num_replayed_steps_since_probe_.exchange(0,
+                                                   std::memory_order_relaxed);
+      if (s.ok() && num_replayed_steps > 0) {
+        const double mean_replayed_time_usecs =
+            static_cast<double>(replayed_time_usecs) / num_replayed_steps;
+        VLOG(1) << "[" << params_.device->name() << "] Static schedule: "
+                << mean_replayed_time_usecs << "us per step, "
+                << step_time_usecs << "us with dynamic scheduling";
+        if (step_time_usecs > mean_replayed_time_usecs) {
+          metrics::UpdateStaticScheduleSavingTime(static_cast<uint64>(
+              (step_time_usecs - mean_replayed_time_usecs) *
+              num_replayed_steps));
+        }
+      }
+      done(s);
+    });
+  }
+
+  const LocalExecutorParams params_;
+  const int warmup_steps_;
+
+  // Runs the warm-up steps and any steps that the static schedule does not
+  // support.
+  std::unique_ptr<Executor> dynamic_executor_;
+
+  mutex mu_;
+  // True while warm-up steps record node costs.
+  std::atomic<bool> recording_{false};
+  // A copy of the graph, kept until the schedule is compiled.
+  std::unique_ptr<Graph> graph_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<string, int> node_ids_ TF_GUARDED_BY(mu_);
+  // The total recorded cost of each node of `graph_`, indexed by node id.
+  std::vector<int64_t> cost_nanos_ TF_GUARDED_BY(mu_);
+  int num_recorded_steps_ TF_GUARDED_BY(mu_) = 0;
+
+  std::unique_ptr<StaticPlan> plan_;
+  std::atomic<const StaticPlan*> published_plan_{nullptr};
+
+  std::atomic<int64_t> num_replayed_steps_{0};
+  std::atomic<int64_t> num_replayed_steps_since_probe_{0};
+  std::atomic<int64_t> replayed_time_usecs_{0};
+};
+
+class StaticScheduleExecutorRegistrar {
+ public:
+  StaticScheduleExecutorRegistrar() {
+    ExecutorFactory::Register(kStaticScheduleExecutor, new Factory());
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      return NewStaticScheduleExecutor(params, graph, kDefaultWarmupSteps,
+                                       out_executor);
+    }
+  };
+};
+static StaticScheduleExecutorRegistrar registrar;
+
+}  // namespace
+
+Status NewStaticScheduleExecutor(const LocalExecutorParams& params,
+                                 const Graph& graph, int warmup_steps,
+                                 std::unique_ptr<Executor>* executor) {
+  if (warmup_steps <= 0) {
+    return errors::InvalidArgument(
+        "The number of warm-up steps must be positive, but got ",
+        warmup_steps);
+  }
+  auto impl =
+      std::make_unique<StaticScheduleExecutorImpl>(params, warmup_steps);
+  TF_RETURN_IF_ERROR(impl->Initialize(graph));
+  *executor = std::move(impl);
+  return OkStatus();
+}
+
+}  // namespace tensorflow
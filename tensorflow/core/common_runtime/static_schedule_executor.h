@@ -0,0 +1,74 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_SCHEDULE_EXECUTOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_SCHEDULE_EXECUTOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/local_executor_params.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+
+// Creates a new `Executor` for `graph` that replays a recorded static schedule
+// once the graph has run a few times.
+//
+// The first `warmup_steps` steps run on the default executor with a private
+// `StepStatsCollector`, which records the cost of every node. The executor
+// then assigns the nodes to threads with critical-path-first list scheduling
+// (see `ComputeStaticSchedule()`) and runs every later step by executing each
+// thread's nodes in order. Only edges between nodes on different threads need
+// any synchronization, which is a single atomic decrement per edge, so the
+// per-step overhead of the dynamic executor's `PendingCounts` bookkeeping and
+// ready queues is avoided.
+//
+// Graphs that the schedule cannot express keep running on the default
+// executor. These are graphs on non-CPU devices, graphs with control flow or
+// reference-typed edges (see `ValidateOpIsSafeForSyncExecution()`), and graphs
+// with asynchronous kernels such as `_Recv`. Steps that request their own
+// `Executor::Args::stats_collector` (e.g. traced `RunOptions`) also run on the
+// default executor so that they report complete step stats.
+//
+// Step times are exported through the
+// "/tensorflow/core/static_schedule_step_time_usecs" metric. To keep the
+// reported savings current, one in every 1000 replayed steps runs on the
+// default executor instead.
+Status NewStaticScheduleExecutor(const LocalExecutorParams& params,
+                                 const Graph& graph, int warmup_steps,
+                                 std::unique_ptr<Executor>* executor);
+
+// Assigns the nodes of a DAG to at most `max_threads` threads.
+//
+// Nodes are numbered in topological order; `successors[i]` lists the nodes
+// that depend on node `i` and `costs[i]` is its estimated cost. A consumer on
+// a different thread than its producer pays an extra `cross_thread_cost`.
+//
+// Nodes are considered in decreasing order of their bottom level (the cost of
+// the longest path from the node to an exit), and each is assigned to the
+// thread on which it can start the earliest. Returns the nodes of each
+// non-empty thread in execution order, which is a topological order.
+std::vector<std::vector<int>> ComputeStaticSchedule(
+    const std::vector<std::vector<int>>& successors,
+    const std::vector<int64_t>& costs, int max_threads,
+    int64_t cross_thread_cost);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_SCHEDULE_EXECUTOR_H_
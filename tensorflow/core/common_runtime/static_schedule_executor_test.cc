@@ -0,0 +1,232 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_schedule_executor.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(ComputeStaticScheduleTest, IndependentChainsRunInParallel) {
+  // 0 -> 2 -> 4 and 1 -> 3 -> 5.
+  std::vector<std::vector<int>> successors = {{2}, {3}, {4}, {5}, {}, {}};
+  std::vector<int64_t> costs(6, 1000);
+  std::vector<std::vector<int>> threads = ComputeStaticSchedule(
+      successors, costs, /*max_threads=*/4, /*cross_thread_cost=*/10);
+  ASSERT_EQ(2, threads.size());
+  EXPECT_EQ((std::vector<int>{0, 2, 4}), threads[0]);
+  EXPECT_EQ((std::vector<int>{1, 3, 5}), threads[1]);
+}
+
+TEST(ComputeStaticScheduleTest, CheapFanOutStaysOnOneThread) {
+  // 0 fans out to 1, 2 and 3, which fan in to 4. Handing any node to another
+  // thread costs more than running it.
+  std::vector<std::vector<int>> successors = {{1, 2, 3}, {4}, {4}, {4}, {}};
+  std::vector<int64_t> costs(5, 10);
+  std::vector<std::vector<int>> threads = ComputeStaticSchedule(
+      successors, costs, /*max_threads=*/4, /*cross_thread_cost=*/1000);
+  ASSERT_EQ(1, threads.size());
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), threads[0]);
+}
+
+TEST(ComputeStaticScheduleTest, CriticalPathFirst) {
+  // 0 fans out to a short node 1 and a long chain 2 -> 3. On a single thread
+  // the long chain is scheduled first.
+  std::vector<std::vector<int>> successors = {{1, 2}, {}, {3}, {}};
+  std::vector<int64_t> costs = {1, 10, 1, 100};
+  std::vector<std::vector<int>> threads = ComputeStaticSchedule(
+      successors, costs, /*max_threads=*/1, /*cross_thread_cost=*/0);
+  ASSERT_EQ(1, threads.size());
+  EXPECT_EQ((std::vector<int>{0, 2, 3, 1}), threads[0]);
+}
+
+class StaticScheduleExecutorTest : public ::testing::Test {
+ protected:
+  StaticScheduleExecutorTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:localhost/replica:0/task:0")),
+        thread_pool_(Env::Default(), "static_schedule_test", 4) {}
+
+  void Create(std::unique_ptr<const Graph> graph, int warmup_steps) {
+    const int version = graph->versions().producer();
+    LocalExecutorParams params;
+    params.device = device_.get();
+    params.create_kernel =
+        [this, version](const std::shared_ptr<const NodeProperties>& props,
+                        OpKernel** kernel) {
+          return CreateNonCachedKernel(device_.get(), nullptr, props, version,
+                                       kernel);
+        };
+    params.delete_kernel = [](OpKernel* kernel) {
+      DeleteNonCachedKernel(kernel);
+    };
+    TF_CHECK_OK(
+        NewStaticScheduleExecutor(params, *graph, warmup_steps, &exec_));
+  }
+
+  Status Run(const Tensor& arg, Tensor* retval) {
+    FunctionCallFrame call_frame({arg.dtype()}, {DT_FLOAT});
+    TF_RETURN_IF_ERROR(call_frame.SetArgs({arg}));
+    Executor::Args args;
+    args.call_frame = &call_frame;
+    args.runner = [this](std::function<void()> fn) {
+      thread_pool_.Schedule(std::move(fn));
+    };
+    TF_RETURN_IF_ERROR(exec_->Run(args));
+    std::vector<Tensor> retvals;
+    TF_RETURN_IF_ERROR(call_frame.ConsumeRetvals(&retvals, false));
+    *retval = retvals[0];
+    return OkStatus();
+  }
+
+  std::unique_ptr<Device> device_;
+  thread::ThreadPool thread_pool_;
+  std::unique_ptr<Executor> exec_;
+};
+
+// Builds a graph that adds `n` copies of its argument in a random tree.
+void BuildTree(int n, Graph* g) {
+  Node* in = test::graph::Arg(g, 0, DT_FLOAT);
+  std::vector<Node*> nodes;
+  for (int i = 0; i < n; ++i) {
+    nodes.push_back(test::graph::Identity(g, in));
+  }
+  random::PhiloxRandom philox(testing::RandomSeed(), 17);
+  random::SimplePhilox rnd(&philox);
+  while (nodes.size() > 1) {
+    int x = rnd.Uniform(nodes.size());
+    Node* in0 = nodes[x];
+    nodes[x] = nodes.back();
+    nodes.pop_back();
+    x = rnd.Uniform(nodes.size());
+    nodes[x] = test::graph::Add(g, in0, nodes[x]);
+  }
+  test::graph::Retval(g, 0, nodes.back());
+  FixupSourceAndSinkEdges(g);
+}
+
+TEST_F(StaticScheduleExecutorTest, RandomTree) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(1024, g.get());
+  Create(std::move(g), /*warmup_steps=*/2);
+  // The first two steps record the schedule and the others replay it.
+  for (int step = 0; step < 10; ++step) {
+    Tensor out;
+    TF_ASSERT_OK(Run(test::AsScalar<float>(step), &out));
+    EXPECT_EQ(1024.0f * step, out.scalar<float>()());
+  }
+}
+
+TEST_F(StaticScheduleExecutorTest, OpError) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* in = test::graph::Arg(g.get(), 0, DT_FLOAT);
+  Node* one = test::graph::Constant(g.get(), test::AsTensor<float>({1, 1, 1}));
+  Node* sum = test::graph::Add(g.get(), test::graph::Identity(g.get(), in),
+                               test::graph::Identity(g.get(), one));
+  test::graph::Retval(g.get(), 0, sum);
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g), /*warmup_steps=*/1);
+
+  for (int step = 0; step < 3; ++step) {
+    Tensor out;
+    TF_ASSERT_OK(Run(test::AsTensor<float>({1, 2, 3}), &out));
+    test::ExpectTensorEqual<float>(test::AsTensor<float>({2, 3, 4}), out);
+
+    // Incompatible shapes fail the step without affecting later steps.
+    Status s = Run(test::AsTensor<float>({1, 2}), &out);
+    EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  }
+}
+
+TEST_F(StaticScheduleExecutorTest, ControlFlowRunsDynamically) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* in = test::graph::Arg(g.get(), 0, DT_FLOAT);
+  Node* pred = test::graph::Constant(g.get(), test::AsScalar<bool>(true));
+  Node* sw = test::graph::Switch(g.get(), in, pred);
+  test::graph::Retval(g.get(), 0, sw, /*in_index=*/1);
+  FixupSourceAndSinkEdges(g.get());
+  Create(std::move(g), /*warmup_steps=*/1);
+
+  for (int step = 0; step < 3; ++step) {
+    Tensor out;
+    TF_ASSERT_OK(Run(test::AsScalar<float>(step), &out));
+    EXPECT_EQ(step, out.scalar<float>()());
+  }
+}
+
+// Runs a graph where one node fans out to `width` independent chains of
+// `depth` additions, which fan in to a final sum, with the default executor or
+// the static schedule executor.
+static void BM_FanOutFanIn(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool static_schedule = state.range(2) != 0;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* root = test::graph::Constant(g, test::AsScalar<float>(1));
+  std::vector<Node*> chains;
+  for (int i = 0; i < width; ++i) {
+    Node* n = root;
+    for (int j = 0; j < depth; ++j) {
+      n = test::graph::Add(g, n, root);
+    }
+    chains.push_back(n);
+  }
+  while (chains.size() > 1) {
+    Node* n = test::graph::Add(g, chains[chains.size() - 2], chains.back());
+    chains.pop_back();
+    chains.back() = n;
+  }
+  FixupSourceAndSinkEdges(g);
+
+  test::Benchmark("cpu", g, /*options=*/nullptr, /*init=*/nullptr,
+                  /*rendez=*/nullptr,
+                  static_schedule ? "STATIC_SCHEDULE_EXECUTOR" : "",
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetLabel(static_schedule ? "static" : "dynamic");
+  state.SetItemsProcessed(static_cast<int64_t>(width) * (depth + 1) *
+                          state.iterations());
+}
+
+BENCHMARK(BM_FanOutFanIn)
+    ->UseRealTime()
+    ->Args({16, 16, 0})
+    ->Args({16, 16, 1})
+    ->Args({256, 4, 0})
+    ->Args({256, 4, 1});
+
+}  // namespace
+}  // namespace tensorflow
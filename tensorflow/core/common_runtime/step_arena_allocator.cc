@@ -0,0 +1,222 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+// A contiguous block of memory from which allocations are carved out in
+// order. Every allocation is preceded by a pointer to its chunk.
+struct StepArenaAllocatorMgr::Chunk {
+  Chunk(Allocator* base_allocator, char* data, size_t capacity)
+      : base_allocator(base_allocator), data(data), capacity(capacity) {}
+
+  Allocator* const base_allocator;
+  char* const data;
+  const size_t capacity;
+  // Offset of the first free byte. May exceed `capacity` once the chunk is
+  // full.
+  std::atomic<size_t> offset{0};
+  // One reference for each live allocation, plus one that the arena releases
+  // at the end of the step.
+  std::atomic<int64_t> refs{1};
+};
+
+StepArenaAllocatorMgr::~StepArenaAllocatorMgr() {
+  mutex_lock l(mu_);
+  for (Chunk* chunk : cached_chunks_) {
+    FreeChunk(chunk);
+  }
+}
+
+StepArenaAllocator* StepArenaAllocatorMgr::NewArena(size_t initial_bytes) {
+  return new StepArenaAllocator(this, initial_bytes);
+}
+
+StepArenaAllocatorMgr::Chunk* StepArenaAllocatorMgr::TakeChunk(
+    size_t min_bytes) {
+  {
+    mutex_lock l(mu_);
+    // Reuse the smallest cached chunk that is large enough.
+    auto best = cached_chunks_.end();
+    for (auto it = cached_chunks_.begin(); it != cached_chunks_.end(); ++it) {
+      if ((*it)->capacity < min_bytes) continue;
+      if (best == cached_chunks_.end() || (*it)->capacity < (*best)->capacity) {
+        best = it;
+      }
+    }
+    if (best != cached_chunks_.end()) {
+      Chunk* chunk = *best;
+      cached_chunks_.erase(best);
+      return chunk;
+    }
+  }
+  void* data =
+      base_allocator_->AllocateRaw(Allocator::kAllocatorAlignment, min_bytes);
+  if (data == nullptr) return nullptr;
+  return new Chunk(base_allocator_, static_cast<char*>(data), min_bytes);
+}
+
+void StepArenaAllocatorMgr::ReturnChunk(Chunk* chunk) {
+  chunk->offset.store(0, std::memory_order_relaxed);
+  chunk->refs.store(1, std::memory_order_relaxed);
+  mutex_lock l(mu_);
+  cached_chunks_.push_back(chunk);
+  if (cached_chunks_.size() > static_cast<size_t>(kMaxCachedChunks)) {
+    // Keep the largest chunks, which are the ones later steps ask for.
+    auto smallest = std::min_element(
+        cached_chunks_.begin(), cached_chunks_.end(),
+        [](Chunk* a, Chunk* b) { return a->capacity < b->capacity; });
+    FreeChunk(*smallest);
+    cached_chunks_.erase(smallest);
+  }
+}
+
+void StepArenaAllocatorMgr::FreeChunk(Chunk* chunk) {
+  chunk->base_allocator->DeallocateRaw(chunk->data);
+  delete chunk;
+}
+
+StepArenaAllocator::~StepArenaAllocator() {
+  {
+    mutex_lock l(mu_);
+    DCHECK(chunks_.empty()) << "EndStep() was not called";
+  }
+  mgr_->Unref();
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  // Chunks and allocation sizes are multiples of kAllocatorAlignment, so only
+  // larger alignments need padding.
+  const size_t padding =
+      alignment > kAllocatorAlignment ? alignment - kAllocatorAlignment : 0;
+  const size_t size = kAllocatorAlignment + padding +
+                      (num_bytes + kAllocatorAlignment - 1) /
+                          kAllocatorAlignment * kAllocatorAlignment;
+  Chunk* chunk = current_.load(std::memory_order_acquire);
+  while (true) {
+    if (chunk != nullptr) {
+      const size_t offset =
+          chunk->offset.fetch_add(size, std::memory_order_relaxed);
+      if (offset + size <= chunk->capacity) {
+        chunk->refs.fetch_add(1, std::memory_order_relaxed);
+        num_allocs_.fetch_add(1, std::memory_order_relaxed);
+        uintptr_t address = reinterpret_cast<uintptr_t>(chunk->data) + offset +
+                            kAllocatorAlignment;
+        if (padding > 0) {
+          address = (address + alignment - 1) & ~(alignment - 1);
+        }
+        void* ptr = reinterpret_cast<void*>(address);
+        reinterpret_cast<Chunk**>(ptr)[-1] = chunk;
+        return ptr;
+      }
+    }
+    chunk = Grow(chunk, size);
+    if (chunk == nullptr) return nullptr;
+  }
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  Chunk* chunk = reinterpret_cast<Chunk**>(ptr)[-1];
+  if (chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // The step has ended and this was the last allocation that escaped it
+    // from `chunk`, which can now be reused by a later step.
+    mgr_->ReturnChunk(chunk);
+    Unref();
+  }
+}
+
+StepArenaAllocator::Chunk* StepArenaAllocator::Grow(Chunk* full,
+                                                   size_t min_bytes) {
+  mutex_lock l(mu_);
+  Chunk* current = current_.load(std::memory_order_relaxed);
+  if (current != full) return current;
+  size_t capacity = std::max(min_bytes, kMinChunkBytes);
+  if (chunks_.empty()) {
+    capacity = std::max(capacity, initial_bytes_);
+  } else {
+    capacity = std::max(capacity, 2 * chunks_.back()->capacity);
+  }
+  Chunk* chunk = mgr_->TakeChunk(capacity);
+  if (chunk == nullptr) return nullptr;
+  chunks_.push_back(chunk);
+  current_.store(chunk, std::memory_order_release);
+  return chunk;
+}
+
+size_t StepArenaAllocator::EndStep() {
+  std::vector<Chunk*> chunks;
+  {
+    mutex_lock l(mu_);
+    chunks.swap(chunks_);
+    current_.store(nullptr, std::memory_order_relaxed);
+  }
+  size_t bytes_used = 0;
+  int num_escaped = 0;
+  for (Chunk* chunk : chunks) {
+    bytes_used += std::min(chunk->offset.load(std::memory_order_relaxed),
+                           chunk->capacity);
+    // A chunk that outlives the step keeps the arena alive, because its
+    // allocations are deallocated through the arena. Take that reference
+    // before releasing the step's, after which the chunk may be freed at any
+    // time.
+    Ref();
+    if (chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Unref();
+      mgr_->ReturnChunk(chunk);
+    } else {
+      ++num_escaped;
+    }
+  }
+  VLOG(2) << "Step arena used " << bytes_used << " bytes in " << chunks.size()
+          << " chunks, of which " << num_escaped << " outlive the step";
+  Unref();
+  return bytes_used;
+}
+
+bool StepArenaAllocator::Contains(const void* ptr) {
+  const char* p = static_cast<const char*>(ptr);
+  mutex_lock l(mu_);
+  for (Chunk* chunk : chunks_) {
+    if (p >= chunk->data && p < chunk->data + chunk->capacity) return true;
+  }
+  return false;
+}
+
+absl::optional<AllocatorStats> StepArenaAllocator::GetStats() {
+  AllocatorStats stats;
+  stats.num_allocs = num_allocs_.load(std::memory_order_relaxed);
+  mutex_lock l(mu_);
+  for (Chunk* chunk : chunks_) {
+    stats.bytes_in_use += std::min(
+        chunk->offset.load(std::memory_order_relaxed), chunk->capacity);
+    stats.bytes_reserved += chunk->capacity;
+  }
+  stats.peak_bytes_in_use = stats.bytes_in_use;
+  stats.peak_bytes_reserved = stats.bytes_reserved;
+  return stats;
+}
+
+AllocatorMemoryType StepArenaAllocator::GetMemoryType() const {
+  return base_allocator_->GetMemoryType();
+}
+
+}  // namespace tensorflow
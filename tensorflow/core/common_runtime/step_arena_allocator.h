@@ -0,0 +1,139 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+class StepArenaAllocator;
+
+// At most one of these exists per device. Creates the step arenas of the
+// device and caches the chunks of finished steps for reuse by later ones.
+//
+// Every arena holds a reference on its manager, so that chunks released after
+// the device is gone can still be returned.
+class StepArenaAllocatorMgr : public core::RefCounted {
+ public:
+  // Chunks are allocated from `base_allocator`, which must outlive every
+  // tensor allocated from an arena.
+  explicit StepArenaAllocatorMgr(Allocator* base_allocator)
+      : base_allocator_(base_allocator) {}
+
+  // Returns a new arena for one step, holding one reference. The first chunk
+  // of the arena holds at least `initial_bytes`, which is typically the
+  // `EndStep()` result of a previous step of the same graph.
+  StepArenaAllocator* NewArena(size_t initial_bytes);
+
+  Allocator* base_allocator() const { return base_allocator_; }
+
+ private:
+  friend class StepArenaAllocator;
+  struct Chunk;
+
+  ~StepArenaAllocatorMgr() override;
+
+  // Returns a chunk of at least `min_bytes`, or nullptr if out of memory.
+  Chunk* TakeChunk(size_t min_bytes);
+  // Makes `chunk`, which holds no live allocations, available for reuse.
+  void ReturnChunk(Chunk* chunk);
+  static void FreeChunk(Chunk* chunk);
+
+  // Maximum number of chunks kept for reuse, which bounds the memory held
+  // between steps when several steps run concurrently.
+  static constexpr int kMaxCachedChunks = 4;
+
+  Allocator* const base_allocator_;
+  mutex mu_;
+  std::vector<Chunk*> cached_chunks_ TF_GUARDED_BY(mu_);
+};
+
+// An allocator for the tensors of one step that carves them out of a few
+// large chunks, and frees them all at once when the step ends.
+//
+// DeallocateRaw() does not make memory available for reuse within the step.
+// At `EndStep()`, the chunks that no longer hold a live allocation are handed
+// back to the `StepArenaAllocatorMgr`. A chunk that still holds a tensor that
+// escaped the step, such as one stored in a resource, stays alive until that
+// tensor is deallocated, and is then handed back as well. The executor copies
+// tensors that are sent or returned out of the arena, so that fetched outputs
+// do not hold on to chunks. The arena itself is reference counted, and stays
+// alive for as long as any of its chunks does.
+//
+// AllocateRaw() and DeallocateRaw() are thread-safe.
+class StepArenaAllocator : public Allocator, public core::RefCounted {
+ public:
+  std::string Name() override { return "step_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+  absl::optional<AllocatorStats> GetStats() override;
+  AllocatorMemoryType GetMemoryType() const override;
+
+  // Ends the step: releases the chunks without live allocations, and the
+  // caller's reference. Returns the number of bytes the step carved out of
+  // the arena. Must be called once, after the last allocation of the step.
+  size_t EndStep();
+
+  // Returns true if `ptr` points into memory allocated from this arena during
+  // the current step. Must be called before `EndStep()`.
+  bool Contains(const void* ptr);
+
+ private:
+  friend class StepArenaAllocatorMgr;
+  using Chunk = StepArenaAllocatorMgr::Chunk;
+
+  StepArenaAllocator(StepArenaAllocatorMgr* mgr, size_t initial_bytes)
+      : mgr_(mgr),
+        base_allocator_(mgr->base_allocator()),
+        initial_bytes_(initial_bytes) {
+    mgr_->Ref();
+  }
+  ~StepArenaAllocator() override;
+
+  // Installs a new chunk that can hold `min_bytes`, unless another thread
+  // already replaced `full`. Returns the current chunk.
+  Chunk* Grow(Chunk* full, size_t min_bytes);
+
+  // Minimum size of a chunk, so that a step without a size hint does not
+  // start with many small ones.
+  static constexpr size_t kMinChunkBytes = 64 << 10;
+
+  // Holds a reference, released in the destructor.
+  StepArenaAllocatorMgr* const mgr_;
+  Allocator* const base_allocator_;
+  const size_t initial_bytes_;
+  std::atomic<Chunk*> current_{nullptr};
+  std::atomic<int64_t> num_allocs_{0};
+  mutex mu_;
+  std::vector<Chunk*> chunks_ TF_GUARDED_BY(mu_);
+
+  StepArenaAllocator(const StepArenaAllocator&) = delete;
+  void operator=(const StepArenaAllocator&) = delete;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,185 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(StepArenaAllocatorTest, ReusesChunksAcrossSteps) {
+  core::RefCountPtr<StepArenaAllocatorMgr> mgr(
+      new StepArenaAllocatorMgr(cpu_allocator()));
+
+  StepArenaAllocator* arena = mgr->NewArena(/*initial_bytes=*/0);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 10; ++i) {
+    void* ptr = arena->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) %
+                     Allocator::kAllocatorAlignment);
+    std::memset(ptr, i, 100);
+    ptrs.push_back(ptr);
+  }
+  // Allocations are carved out in order, each after a header.
+  for (int i = 1; i < 10; ++i) {
+    EXPECT_EQ(static_cast<char*>(ptrs[i - 1]) + 192, ptrs[i]);
+  }
+  for (void* ptr : ptrs) arena->DeallocateRaw(ptr);
+  const size_t bytes_used = arena->EndStep();
+  EXPECT_EQ(size_t{10 * 192}, bytes_used);
+
+  // The next step gets the chunk of the previous one back.
+  arena = mgr->NewArena(bytes_used);
+  void* ptr = arena->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  EXPECT_EQ(ptrs[0], ptr);
+  arena->DeallocateRaw(ptr);
+  arena->EndStep();
+}
+
+TEST(StepArenaAllocatorTest, GrowsBeyondInitialSize) {
+  core::RefCountPtr<StepArenaAllocatorMgr> mgr(
+      new StepArenaAllocatorMgr(cpu_allocator()));
+  StepArenaAllocator* arena = mgr->NewArena(/*initial_bytes=*/0);
+  std::vector<void*> ptrs;
+  int64_t total_bytes = 0;
+  for (size_t num_bytes = 1; num_bytes <= (1 << 20); num_bytes *= 2) {
+    void* ptr = arena->AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+    ASSERT_NE(nullptr, ptr);
+    std::memset(ptr, 0xab, num_bytes);
+    ptrs.push_back(ptr);
+    total_bytes += num_bytes;
+  }
+  absl::optional<AllocatorStats> stats = arena->GetStats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(static_cast<int64_t>(ptrs.size()), stats->num_allocs);
+  EXPECT_GE(stats->bytes_in_use, total_bytes);
+  EXPECT_GE(stats->bytes_reserved, stats->bytes_in_use);
+  for (void* ptr : ptrs) arena->DeallocateRaw(ptr);
+  EXPECT_EQ(stats->bytes_in_use, static_cast<int64_t>(arena->EndStep()));
+}
+
+TEST(StepArenaAllocatorTest, LargeAlignment) {
+  core::RefCountPtr<StepArenaAllocatorMgr> mgr(
+      new StepArenaAllocatorMgr(cpu_allocator()));
+  StepArenaAllocator* arena = mgr->NewArena(/*initial_bytes=*/0);
+  for (size_t alignment : {1, 16, 64, 256, 4096}) {
+    void* ptr = arena->AllocateRaw(alignment, 10);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) % alignment);
+    arena->DeallocateRaw(ptr);
+  }
+  arena->EndStep();
+}
+
+TEST(StepArenaAllocatorTest, EscapedTensorOutlivesStep) {
+  core::RefCountPtr<StepArenaAllocatorMgr> mgr(
+      new StepArenaAllocatorMgr(cpu_allocator()));
+  StepArenaAllocator* arena = mgr->NewArena(/*initial_bytes=*/0);
+  Tensor temp(arena, DT_FLOAT, TensorShape({16}));
+  Tensor fetched(arena, DT_FLOAT, TensorShape({16}));
+  fetched.flat<float>().setConstant(42.0f);
+  const void* first_chunk_data = temp.data();
+  temp = Tensor();
+  arena->EndStep();
+
+  // The chunk holding `fetched` is not handed to the next step.
+  StepArenaAllocator* next_arena = mgr->NewArena(/*initial_bytes=*/0);
+  Tensor next(next_arena, DT_FLOAT, TensorShape({16}));
+  next.flat<float>().setZero();
+  EXPECT_NE(fetched.data(), next.data());
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(42.0f, fetched.flat<float>()(i));
+  }
+  const void* second_chunk_data = next.data();
+  next = Tensor();
+  next_arena->EndStep();
+
+  // Releasing the last tensor hands its chunk back for reuse, so that both
+  // chunks are now available.
+  fetched = Tensor();
+  StepArenaAllocator* last_arena = mgr->NewArena(/*initial_bytes=*/0);
+  Tensor first(last_arena, DT_FLOAT, TensorShape({16}));
+  StepArenaAllocator* other_arena = mgr->NewArena(/*initial_bytes=*/0);
+  Tensor second(other_arena, DT_FLOAT, TensorShape({16}));
+  EXPECT_TRUE((first.data() == first_chunk_data &&
+               second.data() == second_chunk_data) ||
+              (first.data() == second_chunk_data &&
+               second.data() == first_chunk_data));
+  first = Tensor();
+  second = Tensor();
+  last_arena->EndStep();
+  other_arena->EndStep();
+}
+
+TEST(StepArenaAllocatorTest, Contains) {
+  core::RefCountPtr<StepArenaAllocatorMgr> mgr(
+      new StepArenaAllocatorMgr(cpu_allocator()));
+  StepArenaAllocator* arena = mgr->NewArena(/*initial_bytes=*/0);
+  Tensor in_arena(arena, DT_FLOAT, TensorShape({16}));
+  Tensor outside(cpu_allocator(), DT_FLOAT, TensorShape({16}));
+  EXPECT_TRUE(arena->Contains(in_arena.data()));
+  EXPECT_FALSE(arena->Contains(outside.data()));
+  in_arena = Tensor();
+  arena->EndStep();
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentAllocations) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocations = 1000;
+  core::RefCountPtr<StepArenaAllocatorMgr> mgr(
+      new StepArenaAllocatorMgr(cpu_allocator()));
+  StepArenaAllocator* arena = mgr->NewArena(/*initial_bytes=*/0);
+  std::vector<std::vector<uint8_t*>> ptrs(kNumThreads);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < kNumThreads; ++t) {
+      threads.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "allocator", [arena, t, &ptrs]() {
+            for (int i = 0; i < kNumAllocations; ++i) {
+              const size_t num_bytes = 1 + (i * 37) % 1000;
+              auto* ptr = static_cast<uint8_t*>(arena->AllocateRaw(
+                  Allocator::kAllocatorAlignment, num_bytes));
+              CHECK(ptr != nullptr);
+              std::memset(ptr, t, num_bytes);
+              ptrs[t].push_back(ptr);
+            }
+          }));
+    }
+  }
+  // No two allocations overlap.
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kNumAllocations; ++i) {
+      const size_t num_bytes = 1 + (i * 37) % 1000;
+      for (size_t j = 0; j < num_bytes; ++j) {
+        ASSERT_EQ(t, ptrs[t][i][j]) << "thread " << t << " allocation " << i;
+      }
+      arena->DeallocateRaw(ptrs[t][i]);
+    }
+  }
+  arena->EndStep();
+}
+
+}  // namespace
+}  // namespace tensorflow
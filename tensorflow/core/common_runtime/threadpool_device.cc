@@ -41,6 +41,9 @@ info. It does not have any negative impact on performance. */
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/types.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session_options.h"
@@ -62,6 +65,25 @@ ThreadPoolDevice::ThreadPoolDevice(const SessionOptions& options,
                                name, DEVICE_CPU, memory_limit, locality)),
       allocator_(allocator),
       scoped_allocator_mgr_(new ScopedAllocatorMgr(name)) {
+  if (options.config.experimental().use_cpu_step_arena_allocator()) {
+    step_arena_mgr_.reset(new StepArenaAllocatorMgr(allocator_));
+  }
+  if (options.config.experimental().numa_aware_cpu_devices() &&
+      port::NUMAEnabled() && port::NUMANumNodes() > 1) {
+    // Executors of graphs placed on this device schedule their kernels on
+    // threads of the device's NUMA node, rather than on the session's
+    // inter-op thread pool.
+    const int numa_node = locality.numa_node();
+    int num_threads = options.config.inter_op_parallelism_threads();
+    if (num_threads <= 0) num_threads = port::MaxParallelism(numa_node);
+    ThreadOptions thread_options;
+    thread_options.numa_node = numa_node;
+    inter_op_thread_pool_ = std::make_unique<thread::ThreadPool>(
+        options.env, thread_options, strings::StrCat("numa_", numa_node),
+        num_threads, !options.config.experimental().disable_thread_spinning(),
+        /*allocator=*/nullptr);
+    set_tensorflow_device_thread_pool(inter_op_thread_pool_.get());
+  }
   auto s = NodeFileWriter::GetNodeFileWriterIfEnabled(name, env());
   if (!s.ok()) {
     LOG(ERROR) << s.status();
@@ -19,6 +19,8 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/local_device.h"
 #include "tensorflow/core/common_runtime/node_file_writer.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 
 namespace tensorflow {
 
@@ -36,6 +38,9 @@ class ThreadPoolDevice : public LocalDevice {
   ScopedAllocatorMgr* GetScopedAllocatorMgr() const override {
     return scoped_allocator_mgr_.get();
   }
+  StepArenaAllocatorMgr* GetStepArenaAllocatorMgr() const override {
+    return step_arena_mgr_.get();
+  }
   Status MakeTensorFromProto(const TensorProto& tensor_proto,
                              const AllocatorAttributes alloc_attrs,
                              Tensor* tensor) override;
@@ -55,6 +60,11 @@ class ThreadPoolDevice : public LocalDevice {
 
   Allocator* allocator_;  // Not owned
   std::unique_ptr<ScopedAllocatorMgr> scoped_allocator_mgr_;
+  // Only set if the session options enable per-step arenas.
+  core::RefCountPtr<StepArenaAllocatorMgr> step_arena_mgr_;
+  // Only set if the session options ask for NUMA-aware devices, and the
+  // platform has several NUMA nodes.
+  std::unique_ptr<thread::ThreadPool> inter_op_thread_pool_;
   NodeFileWriter* node_file_writer_ = nullptr;  // not owned
 };
 
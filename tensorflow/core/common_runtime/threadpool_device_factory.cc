@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <vector>
 
 // Register a factory that provides CPU devices.
@@ -38,15 +39,20 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
   Status CreateDevices(const SessionOptions& options, const string& name_prefix,
                        std::vector<std::unique_ptr<Device>>* devices) override {
     int num_numa_nodes = port::NUMANumNodes();
-    int n = 1;
+    const bool numa_aware_devices =
+        options.config.experimental().numa_aware_cpu_devices();
+    // One device per NUMA node, so that independent subgraphs can be placed
+    // on different nodes.
+    int n = numa_aware_devices ? num_numa_nodes : 1;
     auto iter = options.config.device_count().find("CPU");
     if (iter != options.config.device_count().end()) {
-      n = iter->second;
+      n = numa_aware_devices ? std::max(n, iter->second) : iter->second;
     }
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/device:CPU:", i);
       std::unique_ptr<ThreadPoolDevice> tpd;
-      if (options.config.experimental().use_numa_affinity()) {
+      if (options.config.experimental().use_numa_affinity() ||
+          numa_aware_devices) {
         int numa_node = i % num_numa_nodes;
         if (numa_node != i) {
           LOG(INFO) << "Only " << num_numa_nodes
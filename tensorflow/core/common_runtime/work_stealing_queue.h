@@ -0,0 +1,189 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "absl/types/optional.h"
+
+namespace tensorflow {
+
+// A Chase-Lev work-stealing deque of trivially copyable values.
+//
+// The single owner thread pushes and pops at the bottom end in LIFO order,
+// while any number of other threads may concurrently steal from the top end in
+// FIFO order. Push and PopBottom are wait-free in the common case and Steal is
+// lock-free. The buffer grows as needed; retired buffers are kept alive until
+// the queue is destroyed since a concurrent thief may still be reading them.
+//
+// The memory orderings follow "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (Lê et al., PPoPP 2013). Values are stored as arrays of
+// relaxed atomic words, so that a thief reading a slot that the owner is
+// overwriting is not a data race; such a torn value is always discarded
+// because the thief then fails to claim it.
+//
+// Ownership may move between threads provided the hand-off itself
+// synchronizes (e.g. through a mutex or a thread pool queue).
+template <typename T>
+class WorkStealingQueue {
+ public:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "WorkStealingQueue requires a trivially copyable type");
+
+  explicit WorkStealingQueue(int64_t initial_capacity = 64)
+      : top_(0), bottom_(0) {
+    int64_t capacity = 1;
+    while (capacity < initial_capacity) capacity <<= 1;
+    buffers_.emplace_back(new Buffer(capacity));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+  }
+
+  // Appends `value` at the bottom end. Must only be called by the owner.
+  void Push(const T& value) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (b - t > buffer->capacity() - 1) {
+      buffer = Grow(buffer, t, b);
+    }
+    buffer->Put(b, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // Removes and returns the most recently pushed value, or nullopt if the
+  // queue is empty. Must only be called by the owner.
+  absl::optional<T> PopBottom() {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      // Empty.
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return absl::nullopt;
+    }
+    absl::optional<T> value = buffer->Get(b);
+    if (t == b) {
+      // Last element: race against thieves for it.
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        value = absl::nullopt;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  // Removes and returns the least recently pushed value, or nullopt if the
+  // queue is empty or the value was concurrently claimed by another thread.
+  // May be called by any thread.
+  absl::optional<T> Steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) return absl::nullopt;
+    Buffer* buffer = buffer_.load(std::memory_order_acquire);
+    absl::optional<T> value = buffer->Get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return absl::nullopt;
+    }
+    return value;
+  }
+
+  // Returns an estimate of the number of values in the queue. Exact when
+  // called by the owner with no concurrent thieves.
+  int64_t Size() const {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+ private:
+  static constexpr size_t kWordsPerValue =
+      (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  // A circular array of values, indexed modulo its power-of-two capacity.
+  class Buffer {
+   public:
+    explicit Buffer(int64_t capacity)
+        : mask_(capacity - 1),
+          words_(new std::atomic<uint64_t>[capacity * kWordsPerValue]) {}
+
+    int64_t capacity() const { return mask_ + 1; }
+
+    void Put(int64_t index, const T& value) {
+      uint64_t words[kWordsPerValue] = {};
+      std::memcpy(words, &value, sizeof(T));
+      std::atomic<uint64_t>* slot = &words_[(index & mask_) * kWordsPerValue];
+      for (size_t i = 0; i < kWordsPerValue; ++i) {
+        slot[i].store(words[i], std::memory_order_relaxed);
+      }
+    }
+
+    T Get(int64_t index) const {
+      uint64_t words[kWordsPerValue];
+      const std::atomic<uint64_t>* slot =
+          &words_[(index & mask_) * kWordsPerValue];
+      for (size_t i = 0; i < kWordsPerValue; ++i) {
+        words[i] = slot[i].load(std::memory_order_relaxed);
+      }
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+      std::memcpy(&storage, words, sizeof(T));
+      return *reinterpret_cast<const T*>(&storage);
+    }
+
+   private:
+    const int64_t mask_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+  };
+
+  // Replaces `buffer`, which holds the values in [top, bottom), by one of
+  // twice its capacity. Only called by the owner.
+  Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom) {
+    buffers_.emplace_back(new Buffer(buffer->capacity() * 2));
+    Buffer* grown = buffers_.back().get();
+    for (int64_t i = top; i < bottom; ++i) {
+      grown->Put(i, buffer->Get(i));
+    }
+    buffer_.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  alignas(64) std::atomic<int64_t> top_;
+  alignas(64) std::atomic<int64_t> bottom_;
+  std::atomic<Buffer*> buffer_;
+  // All buffers ever allocated, the last one being current. Only modified by
+  // the owner.
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
+  WorkStealingQueue(const WorkStealingQueue&) = delete;
+  void operator=(const WorkStealingQueue&) = delete;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
@@ -0,0 +1,102 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_queue.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+struct Item {
+  const void* ptr;
+  int64_t value;
+  bool flag;
+};
+
+TEST(WorkStealingQueue, OwnerIsLifoThiefIsFifo) {
+  WorkStealingQueue<Item> queue(/*initial_capacity=*/2);
+  EXPECT_TRUE(queue.Empty());
+  EXPECT_FALSE(queue.PopBottom().has_value());
+  EXPECT_FALSE(queue.Steal().has_value());
+
+  // Pushing more items than the initial capacity grows the buffer.
+  for (int64_t i = 0; i < 10; ++i) {
+    queue.Push(Item{nullptr, i, i % 2 == 0});
+  }
+  EXPECT_EQ(10, queue.Size());
+
+  EXPECT_EQ(9, queue.PopBottom()->value);
+  EXPECT_EQ(0, queue.Steal()->value);
+  EXPECT_EQ(1, queue.Steal()->value);
+  EXPECT_EQ(8, queue.PopBottom()->value);
+  EXPECT_EQ(6, queue.Size());
+  for (int64_t i = 7; i >= 2; --i) {
+    absl::optional<Item> item = queue.PopBottom();
+    ASSERT_TRUE(item.has_value());
+    EXPECT_EQ(i, item->value);
+    EXPECT_EQ(i % 2 == 0, item->flag);
+  }
+  EXPECT_TRUE(queue.Empty());
+  EXPECT_FALSE(queue.PopBottom().has_value());
+}
+
+TEST(WorkStealingQueue, ConcurrentThieves) {
+  constexpr int64_t kNumItems = 100000;
+  constexpr int kNumThieves = 4;
+  WorkStealingQueue<Item> queue(/*initial_capacity=*/4);
+  std::vector<std::atomic<int>> seen(kNumItems);
+  for (auto& s : seen) s = 0;
+  std::atomic<bool> done_pushing{false};
+
+  {
+    std::vector<std::unique_ptr<Thread>> thieves;
+    for (int t = 0; t < kNumThieves; ++t) {
+      thieves.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "thief", [&queue, &seen, &done_pushing]() {
+            while (true) {
+              const bool done = done_pushing.load();
+              absl::optional<Item> item = queue.Steal();
+              if (item.has_value()) {
+                seen[item->value]++;
+              } else if (done && queue.Empty()) {
+                break;
+              }
+            }
+          }));
+    }
+    for (int64_t i = 0; i < kNumItems; ++i) {
+      queue.Push(Item{nullptr, i, false});
+      if (i % 3 == 0) {
+        absl::optional<Item> item = queue.PopBottom();
+        if (item.has_value()) seen[item->value]++;
+      }
+    }
+    done_pushing = true;
+  }
+
+  // Every item was taken exactly once, either by the owner or by a thief.
+  for (int64_t i = 0; i < kNumItems; ++i) {
+    EXPECT_EQ(1, seen[i].load()) << "item " << i;
+  }
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,128 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/bounded_memory_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+
+BoundedMemoryCache::BoundedMemoryCache(int64_t budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+std::shared_ptr<BoundedMemoryCache> BoundedMemoryCache::GetOrCreate(
+    uint64 key, int64_t budget_bytes) {
+  using Registry =
+      absl::flat_hash_map<std::pair<uint64, int64_t>,
+                          std::weak_ptr<BoundedMemoryCache>>;
+  static mutex* mu = new mutex();
+  static Registry* caches = new Registry();
+
+  mutex_lock l(*mu);
+  // Drop the entries of the caches that have been destroyed.
+  for (auto it = caches->begin(); it != caches->end();) {
+    if (it->second.expired()) {
+      caches->erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  std::weak_ptr<BoundedMemoryCache>& entry =
+      (*caches)[std::make_pair(key, budget_bytes)];
+  std::shared_ptr<BoundedMemoryCache> cache = entry.lock();
+  if (!cache) {
+    cache = std::make_shared<BoundedMemoryCache>(budget_bytes);
+    entry = cache;
+  }
+  return cache;
+}
+
+void BoundedMemoryCache::Insert(int64_t index,
+                                const std::vector<Tensor>& element) {
+  const int64_t bytes = GetTotalBytes(element);
+  if (bytes > budget_bytes_) {
+    return;
+  }
+  mutex_lock l(mu_);
+  if (entries_.contains(index)) {
+    return;
+  }
+  EvictLocked(bytes);
+  Entry& entry = entries_[index];
+  entry.element = element;
+  entry.bytes = bytes;
+  clock_.push_back(index);
+  bytes_ += bytes;
+}
+
+bool BoundedMemoryCache::Lookup(int64_t index, std::vector<Tensor>* element) {
+  mutex_lock l(mu_);
+  auto it = entries_.find(index);
+  if (it == entries_.end()) {
+    return false;
+  }
+  it->second.referenced = true;
+  *element = it->second.element;
+  return true;
+}
+
+void BoundedMemoryCache::SetNumElements(int64_t num_elements) {
+  mutex_lock l(mu_);
+  num_elements_ = num_elements;
+}
+
+int64_t BoundedMemoryCache::num_elements() {
+  tf_shared_lock l(mu_);
+  return num_elements_;
+}
+
+int64_t BoundedMemoryCache::size() {
+  tf_shared_lock l(mu_);
+  return entries_.size();
+}
+
+int64_t BoundedMemoryCache::bytes() {
+  tf_shared_lock l(mu_);
+  return bytes_;
+}
+
+void BoundedMemoryCache::EvictLocked(int64_t bytes) {
+  while (bytes_ + bytes > budget_bytes_ && !clock_.empty()) {
+    const int64_t index = clock_.front();
+    clock_.pop_front();
+    auto it = entries_.find(index);
+    DCHECK(it != entries_.end());
+    if (it->second.referenced) {
+      // Give the element a second chance.
+      it->second.referenced = false;
+      clock_.push_back(index);
+      continue;
+    }
+    bytes_ -= it->second.bytes;
+    entries_.erase(it);
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,109 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_BOUNDED_MEMORY_CACHE_H_
+#define TENSORFLOW_CORE_DATA_BOUNDED_MEMORY_CACHE_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// An in-memory cache of the elements of a dataset, indexed by their position
+// in the dataset, which holds at most `budget_bytes` bytes of tensor data.
+//
+// Unlike `MemoryCache`, an element can be read as soon as it is inserted, so
+// iterators can read the cache while another iterator is filling it, and the
+// dataset does not need to fit in memory. When an insertion would exceed the
+// budget, elements are evicted with the clock algorithm: the clock hand visits
+// the elements in insertion order, and evicts the first one that has not been
+// looked up since the hand last passed it.
+//
+// `GetOrCreate()` shares a cache among all the datasets of a process that
+// cache the same input, e.g. the datasets of concurrent training and
+// evaluation jobs. The cache is destroyed once the last of them releases it.
+//
+// This class is thread-safe.
+class BoundedMemoryCache {
+ public:
+  explicit BoundedMemoryCache(int64_t budget_bytes);
+
+  BoundedMemoryCache(const BoundedMemoryCache&) = delete;
+  BoundedMemoryCache& operator=(const BoundedMemoryCache&) = delete;
+
+  // Returns the cache of the process registered under `key` and
+  // `budget_bytes`, creating it if it does not exist. `key` identifies the
+  // cached input, e.g. its dataset graph hash.
+  static std::shared_ptr<BoundedMemoryCache> GetOrCreate(uint64 key,
+                                                         int64_t budget_bytes);
+
+  // Inserts the element at `index`, evicting other elements as needed. Does
+  // nothing if the element is already cached or is larger than the budget.
+  void Insert(int64_t index, const std::vector<Tensor>& element);
+
+  // Looks up the element at `index`. Returns false if it is not cached.
+  bool Lookup(int64_t index, std::vector<Tensor>* element);
+
+  // Records that the cached dataset has `num_elements` elements.
+  void SetNumElements(int64_t num_elements);
+
+  // Returns the number of elements of the cached dataset, or
+  // `kUnknownCardinality` if no iterator has reached its end yet.
+  int64_t num_elements();
+
+  // Returns the number of cached elements.
+  int64_t size();
+
+  // Returns the bytes of the cached elements.
+  int64_t bytes();
+
+  int64_t budget_bytes() const { return budget_bytes_; }
+
+ private:
+  struct Entry {
+    std::vector<Tensor> element;
+    int64_t bytes = 0;
+    // Whether the element has been looked up since the clock hand last
+    // passed it.
+    bool referenced = false;
+  };
+
+  // Evicts elements until `bytes` more bytes fit in the budget.
+  void EvictLocked(int64_t bytes) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t budget_bytes_;
+
+  mutex mu_;
+  absl::flat_hash_map<int64_t, Entry> entries_ TF_GUARDED_BY(mu_);
+  // Indices of the cached elements, in the order in which the clock hand
+  // visits them. The hand is at the front.
+  std::deque<int64_t> clock_ TF_GUARDED_BY(mu_);
+  int64_t bytes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t num_elements_ TF_GUARDED_BY(mu_) = kUnknownCardinality;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_BOUNDED_MEMORY_CACHE_H_
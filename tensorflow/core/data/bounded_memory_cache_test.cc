@@ -0,0 +1,119 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/bounded_memory_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Each element is a single int64 scalar, i.e. 8 bytes.
+constexpr int64_t kElementBytes = 8;
+
+std::vector<Tensor> Element(int64_t value) {
+  return {test::AsScalar<int64_t>(value)};
+}
+
+bool Contains(BoundedMemoryCache& cache, int64_t index) {
+  std::vector<Tensor> element;
+  return cache.Lookup(index, &element);
+}
+
+TEST(BoundedMemoryCacheTest, InsertAndLookup) {
+  BoundedMemoryCache cache(/*budget_bytes=*/10 * kElementBytes);
+  for (int64_t i = 0; i < 5; ++i) {
+    cache.Insert(i, Element(i));
+  }
+  EXPECT_EQ(cache.size(), 5);
+  EXPECT_EQ(cache.bytes(), 5 * kElementBytes);
+  for (int64_t i = 0; i < 5; ++i) {
+    std::vector<Tensor> element;
+    ASSERT_TRUE(cache.Lookup(i, &element));
+    test::ExpectEqual(element[0], test::AsScalar<int64_t>(i));
+  }
+  EXPECT_FALSE(Contains(cache, 5));
+}
+
+TEST(BoundedMemoryCacheTest, StaysWithinBudget) {
+  BoundedMemoryCache cache(/*budget_bytes=*/4 * kElementBytes);
+  for (int64_t i = 0; i < 10; ++i) {
+    cache.Insert(i, Element(i));
+    EXPECT_LE(cache.bytes(), 4 * kElementBytes);
+  }
+  EXPECT_EQ(cache.size(), 4);
+  // Without lookups, the clock evicts the oldest elements first.
+  for (int64_t i = 0; i < 6; ++i) {
+    EXPECT_FALSE(Contains(cache, i));
+  }
+  for (int64_t i = 6; i < 10; ++i) {
+    EXPECT_TRUE(Contains(cache, i));
+  }
+}
+
+TEST(BoundedMemoryCacheTest, ReferencedElementsGetASecondChance) {
+  BoundedMemoryCache cache(/*budget_bytes=*/3 * kElementBytes);
+  for (int64_t i = 0; i < 3; ++i) {
+    cache.Insert(i, Element(i));
+  }
+  EXPECT_TRUE(Contains(cache, 0));
+  cache.Insert(3, Element(3));
+  EXPECT_TRUE(Contains(cache, 0));
+  EXPECT_FALSE(Contains(cache, 1));
+  EXPECT_TRUE(Contains(cache, 2));
+  EXPECT_TRUE(Contains(cache, 3));
+}
+
+TEST(BoundedMemoryCacheTest, SkipsElementsLargerThanBudget) {
+  BoundedMemoryCache cache(/*budget_bytes=*/kElementBytes);
+  cache.Insert(0, Element(0));
+  cache.Insert(1, {test::AsTensor<int64_t>({1, 2})});
+  EXPECT_TRUE(Contains(cache, 0));
+  EXPECT_FALSE(Contains(cache, 1));
+}
+
+TEST(BoundedMemoryCacheTest, NumElements) {
+  BoundedMemoryCache cache(/*budget_bytes=*/kElementBytes);
+  EXPECT_EQ(cache.num_elements(), kUnknownCardinality);
+  cache.SetNumElements(7);
+  EXPECT_EQ(cache.num_elements(), 7);
+}
+
+TEST(BoundedMemoryCacheTest, GetOrCreateSharesCaches) {
+  std::shared_ptr<BoundedMemoryCache> cache =
+      BoundedMemoryCache::GetOrCreate(/*key=*/1, /*budget_bytes=*/100);
+  EXPECT_EQ(BoundedMemoryCache::GetOrCreate(/*key=*/1, /*budget_bytes=*/100),
+            cache);
+  EXPECT_NE(BoundedMemoryCache::GetOrCreate(/*key=*/2, /*budget_bytes=*/100),
+            cache);
+  EXPECT_NE(BoundedMemoryCache::GetOrCreate(/*key=*/1, /*budget_bytes=*/200),
+            cache);
+
+  cache->Insert(0, Element(0));
+  cache.reset();
+  // The cache is destroyed with its last reference.
+  cache = BoundedMemoryCache::GetOrCreate(/*key=*/1, /*budget_bytes=*/100);
+  EXPECT_EQ(cache->size(), 0);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,146 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/read_ahead_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/platform/env_time.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data {
+
+ReadAheadFile::ReadAheadFile(std::unique_ptr<RandomAccessFile> file,
+                             int64_t block_size, int64_t num_blocks,
+                             Runner runner, ReadCallback read_callback)
+    : file_(std::move(file)),
+      block_size_(block_size),
+      num_blocks_(std::max<int64_t>(num_blocks, 1)),
+      runner_(std::move(runner)),
+      read_callback_(std::move(read_callback)) {
+  DCHECK_GT(block_size_, 0);
+}
+
+ReadAheadFile::~ReadAheadFile() {
+  mutex_lock l(mu_);
+  while (num_in_flight_ > 0) {
+    cond_var_.wait(l);
+  }
+}
+
+Status ReadAheadFile::Name(StringPiece* result) const {
+  return file_->Name(result);
+}
+
+Status ReadAheadFile::Read(uint64 offset, size_t n, StringPiece* result,
+                           char* scratch) const {
+  size_t num_read = 0;
+  Status status;
+  while (num_read < n) {
+    const uint64 position = offset + num_read;
+    const int64_t index = position / block_size_;
+    std::shared_ptr<const Block> block = GetBlock(index);
+    if (!block->status.ok()) {
+      status = block->status;
+      break;
+    }
+    const size_t block_offset = position - index * block_size_;
+    if (block_offset >= block->data.size()) {
+      // End of file.
+      break;
+    }
+    const size_t num_bytes =
+        std::min(n - num_read, block->data.size() - block_offset);
+    memcpy(scratch + num_read, block->data.data() + block_offset, num_bytes);
+    num_read += num_bytes;
+  }
+  *result = StringPiece(scratch, num_read);
+  if (status.ok() && num_read < n) {
+    return errors::OutOfRange("Read less bytes than requested");
+  }
+  return status;
+}
+
+std::shared_ptr<const ReadAheadFile::Block> ReadAheadFile::GetBlock(
+    int64_t index) const {
+  mutex_lock l(mu_);
+  // Drop the blocks outside of the read-ahead window. Reads that are still in
+  // flight complete into blocks that nobody waits for.
+  blocks_.erase(blocks_.begin(), blocks_.lower_bound(index));
+  blocks_.erase(blocks_.lower_bound(index + num_blocks_), blocks_.end());
+  if (index >= end_block_) {
+    auto block = std::make_shared<Block>();
+    block->done = true;
+    return block;
+  }
+  const int64_t end = std::min(index + num_blocks_, end_block_);
+  for (int64_t i = index; i < end; ++i) {
+    if (blocks_.count(i) == 0) {
+      ReadBlockLocked(i);
+    }
+  }
+  std::shared_ptr<Block> block = blocks_[index];
+  while (!block->done) {
+    cond_var_.wait(l);
+  }
+  return block;
+}
+
+void ReadAheadFile::ReadBlockLocked(int64_t index) const {
+  auto block = std::make_shared<Block>();
+  blocks_[index] = block;
+  if (num_in_flight_++ == 0) {
+    busy_since_nanos_ = EnvTime::NowNanos();
+  }
+  runner_([this, index, block]() {
+    std::string data(block_size_, '\0');
+    StringPiece result;
+    Status status =
+        file_->Read(index * block_size_, block_size_, &result, &data[0]);
+    // A short read is expected at the end of the file.
+    if (errors::IsOutOfRange(status)) {
+      status = OkStatus();
+    }
+    if (result.data() == data.data()) {
+      data.resize(result.size());
+    } else {
+      data.assign(result.data(), result.size());
+    }
+
+    mutex_lock l(mu_);
+    const int64_t num_bytes = data.size();
+    if (status.ok() && num_bytes < block_size_) {
+      end_block_ = std::min(end_block_, index + 1);
+    }
+    block->status = std::move(status);
+    block->data = std::move(data);
+    block->done = true;
+    const uint64 now = EnvTime::NowNanos();
+    if (read_callback_ && block->status.ok()) {
+      read_callback_(num_bytes, now - busy_since_nanos_);
+    }
+    busy_since_nanos_ = now;
+    --num_in_flight_;
+    cond_var_.notify_all();
+  });
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,109 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_READ_AHEAD_FILE_H_
+#define TENSORFLOW_CORE_DATA_READ_AHEAD_FILE_H_
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A `RandomAccessFile` that keeps up to `num_blocks` reads of `block_size`
+// bytes in flight ahead of the last read offset, so that a sequential reader
+// does not wait for the storage device on every buffer refill.
+//
+// The reads are issued through `runner`, which decides where the blocking
+// reads of the underlying file run (e.g. a thread pool sized to the number of
+// outstanding reads).
+//
+// Reads that move backwards are served correctly, but discard the blocks that
+// have been read ahead.
+class ReadAheadFile : public RandomAccessFile {
+ public:
+  using Runner = std::function<void(std::function<void()>)>;
+
+  // Called after each block is read, with the number of bytes read and the
+  // time in nanoseconds since the previous call during which at least one
+  // read was in flight. The callback runs with an internal lock held, so it
+  // must be cheap and must not call back into the file.
+  using ReadCallback =
+      std::function<void(int64_t num_bytes, int64_t busy_nanos)>;
+
+  ReadAheadFile(std::unique_ptr<RandomAccessFile> file, int64_t block_size,
+                int64_t num_blocks, Runner runner,
+                ReadCallback read_callback = nullptr);
+
+  // Waits for the reads in flight.
+  ~ReadAheadFile() override;
+
+  ReadAheadFile(const ReadAheadFile&) = delete;
+  ReadAheadFile& operator=(const ReadAheadFile&) = delete;
+
+  Status Name(StringPiece* result) const override;
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override;
+
+ private:
+  struct Block {
+    bool done = false;
+    Status status;
+    std::string data;
+  };
+
+  // Returns the block at `index` once it has been read, after issuing the
+  // reads of the blocks that follow it.
+  std::shared_ptr<const Block> GetBlock(int64_t index) const
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Issues the read of the block at `index`.
+  void ReadBlockLocked(int64_t index) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const std::unique_ptr<RandomAccessFile> file_;
+  const int64_t block_size_;
+  const int64_t num_blocks_;
+  const Runner runner_;
+  const ReadCallback read_callback_;
+
+  mutable mutex mu_;
+  mutable condition_variable cond_var_;
+  // Blocks that are read or being read, by index.
+  mutable std::map<int64_t, std::shared_ptr<Block>> blocks_
+      TF_GUARDED_BY(mu_);
+  // Index of the first block past the end of the file, once it is known.
+  mutable int64_t end_block_ TF_GUARDED_BY(mu_) =
+      std::numeric_limits<int64_t>::max();
+  mutable int64_t num_in_flight_ TF_GUARDED_BY(mu_) = 0;
+  // Start of the time that has not been reported to `read_callback_`, while
+  // reads are in flight.
+  mutable uint64 busy_since_nanos_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_READ_AHEAD_FILE_H_
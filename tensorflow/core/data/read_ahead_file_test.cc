@@ -0,0 +1,172 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/read_ahead_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// A file in memory that counts its reads, and fails the reads at or after
+// `error_offset`.
+class StringFile : public RandomAccessFile {
+ public:
+  StringFile(std::string contents, std::atomic<int>* num_reads,
+             uint64 error_offset = std::numeric_limits<uint64>::max())
+      : contents_(std::move(contents)),
+        num_reads_(num_reads),
+        error_offset_(error_offset) {}
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    ++*num_reads_;
+    if (offset >= error_offset_) {
+      return errors::DataLoss("Corrupted block at ", offset);
+    }
+    const size_t num_bytes =
+        offset < contents_.size() ? std::min(n, contents_.size() - offset) : 0;
+    memcpy(scratch, contents_.data() + offset, num_bytes);
+    *result = StringPiece(scratch, num_bytes);
+    if (num_bytes < n) {
+      return errors::OutOfRange("Read less bytes than requested");
+    }
+    return OkStatus();
+  }
+
+ private:
+  const std::string contents_;
+  std::atomic<int>* const num_reads_;
+  const uint64 error_offset_;
+};
+
+std::string MakeContents(int size) {
+  std::string contents(size, '\0');
+  for (int i = 0; i < size; ++i) {
+    contents[i] = 'a' + i % 26;
+  }
+  return contents;
+}
+
+class ReadAheadFileTest : public ::testing::Test {
+ protected:
+  ReadAheadFileTest() : thread_pool_(Env::Default(), "read_ahead_test", 4) {}
+
+  std::unique_ptr<ReadAheadFile> MakeFile(
+      std::unique_ptr<RandomAccessFile> file, int64_t block_size,
+      int64_t num_blocks) {
+    return std::make_unique<ReadAheadFile>(
+        std::move(file), block_size, num_blocks,
+        [this](std::function<void()> fn) {
+          thread_pool_.Schedule(std::move(fn));
+        },
+        [this](int64_t num_bytes, int64_t busy_nanos) {
+          bytes_read_ += num_bytes;
+          EXPECT_GE(busy_nanos, 0);
+        });
+  }
+
+  thread::ThreadPool thread_pool_;
+  std::atomic<int64_t> bytes_read_{0};
+  std::atomic<int> num_reads_{0};
+};
+
+TEST_F(ReadAheadFileTest, SequentialReads) {
+  const std::string contents = MakeContents(1000);
+  auto file = MakeFile(std::make_unique<StringFile>(contents, &num_reads_),
+                       /*block_size=*/64, /*num_blocks=*/4);
+  std::string result;
+  char scratch[37];
+  Status status;
+  while (status.ok()) {
+    StringPiece chunk;
+    status = file->Read(result.size(), sizeof(scratch), &chunk, scratch);
+    result.append(chunk.data(), chunk.size());
+  }
+  EXPECT_TRUE(errors::IsOutOfRange(status)) << status;
+  EXPECT_EQ(contents, result);
+  file.reset();
+  // Every block is read once, and reading ahead stops within a window of the
+  // end of the file.
+  EXPECT_GE(num_reads_, 16);
+  EXPECT_LE(num_reads_, 16 + 3);
+  EXPECT_EQ(1000, bytes_read_);
+}
+
+TEST_F(ReadAheadFileTest, KeepsBlocksInFlight) {
+  auto file =
+      MakeFile(std::make_unique<StringFile>(MakeContents(1000), &num_reads_),
+               /*block_size=*/10, /*num_blocks=*/8);
+  char scratch[1];
+  StringPiece result;
+  TF_ASSERT_OK(file->Read(0, 1, &result, scratch));
+  EXPECT_EQ("a", result);
+  file.reset();
+  EXPECT_EQ(8, num_reads_);
+}
+
+TEST_F(ReadAheadFileTest, RandomReads) {
+  const std::string contents = MakeContents(5000);
+  auto file = MakeFile(std::make_unique<StringFile>(contents, &num_reads_),
+                       /*block_size=*/128, /*num_blocks=*/3);
+  random::PhiloxRandom philox(testing::RandomSeed(), 17);
+  random::SimplePhilox rnd(&philox);
+  char scratch[300];
+  for (int i = 0; i < 200; ++i) {
+    const uint64 offset = rnd.Uniform(5100);
+    const size_t n = 1 + rnd.Uniform(sizeof(scratch));
+    StringPiece result;
+    Status status = file->Read(offset, n, &result, scratch);
+    const std::string expected =
+        offset < contents.size() ? contents.substr(offset, n) : "";
+    EXPECT_EQ(expected, result);
+    if (expected.size() < n) {
+      EXPECT_TRUE(errors::IsOutOfRange(status)) << status;
+    } else {
+      TF_EXPECT_OK(status);
+    }
+  }
+}
+
+TEST_F(ReadAheadFileTest, ReturnsReadErrors) {
+  auto file = MakeFile(std::make_unique<StringFile>(MakeContents(1000),
+                                                    &num_reads_,
+                                                    /*error_offset=*/100),
+                       /*block_size=*/50, /*num_blocks=*/4);
+  char scratch[80];
+  StringPiece result;
+  TF_ASSERT_OK(file->Read(0, 80, &result, scratch));
+  // The read stops at the failed block.
+  Status status = file->Read(80, 80, &result, scratch);
+  EXPECT_TRUE(errors::IsDataLoss(status)) << status;
+  EXPECT_EQ(20, result.size());
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
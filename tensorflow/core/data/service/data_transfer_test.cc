@@ -14,19 +14,33 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/data_transfer.h"
 
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/shm_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace data {
@@ -112,6 +126,210 @@ TEST(DataTransferTest, CopyGetElementResult) {
             result.EstimatedMemoryUsageBytes());
 }
 
+#if defined(__linux__)
+// Starts a shm data transfer server which serves `element`, and connects a
+// client to it.
+class ShmDataTransferTest : public ::testing::Test {
+ protected:
+  void Start(std::vector<Tensor> element,
+             int64_t ring_size_bytes = kDefaultShmRingSizeBytes,
+             Status status = OkStatus()) {
+    element_ = std::move(element);
+    status_ = status;
+    TF_ASSERT_OK(CreateShmDataTransferServer(
+        [this](const GetElementRequest* request, GetElementResult* result) {
+          TF_RETURN_IF_ERROR(status_);
+          result->components = element_;
+          result->element_index = request->task_id();
+          return OkStatus();
+        },
+        ring_size_bytes, &server_));
+    TF_ASSERT_OK(server_->Start());
+    TF_ASSERT_OK(DataTransferClient::Build(
+        kShmTransferProtocol,
+        {/*protocol=*/"grpc",
+         /*address=*/absl::StrCat("localhost:", server_->Port())},
+        &client_));
+    StatusOr<std::string> compatibility_info = server_->GetCompatibilityInfo();
+    TF_ASSERT_OK(compatibility_info.status());
+    TF_ASSERT_OK(client_->CheckCompatibility(*compatibility_info));
+  }
+
+  GetElementResult GetElement(int64_t task_id) {
+    GetElementRequest request;
+    request.set_task_id(task_id);
+    GetElementResult result;
+    TF_EXPECT_OK(client_->GetElement(request, result));
+    EXPECT_EQ(result.element_index, task_id);
+    EXPECT_FALSE(result.end_of_sequence);
+    return result;
+  }
+
+  std::vector<Tensor> element_;
+  Status status_;
+  std::shared_ptr<DataTransferServer> server_;
+  std::unique_ptr<DataTransferClient> client_;
+};
+
+TEST_F(ShmDataTransferTest, GetElement) {
+  Start({test::AsTensor<int64_t>({1, 2, 3}, TensorShape({3})),
+         test::AsScalar<tstring>("hello"),
+         test::AsTensor<float>(std::vector<float>(), TensorShape({0, 2}))});
+  for (int64_t i = 0; i < 10; ++i) {
+    GetElementResult result = GetElement(i);
+    ASSERT_EQ(result.components.size(), element_.size());
+    for (size_t j = 0; j < element_.size(); ++j) {
+      test::ExpectEqual(result.components[j], element_[j]);
+    }
+  }
+}
+
+TEST_F(ShmDataTransferTest, GetCompressedElement) {
+  CompressedElement compressed;
+  compressed.set_data("compressed data");
+  Tensor tensor(DT_VARIANT, TensorShape({}));
+  tensor.scalar<Variant>()() = compressed;
+  Start({tensor});
+
+  GetElementResult result = GetElement(0);
+  ASSERT_EQ(result.components.size(), 1);
+  const CompressedElement* received =
+      result.components[0].scalar<Variant>()().get<CompressedElement>();
+  ASSERT_NE(received, nullptr);
+  EXPECT_EQ(received->data(), "compressed data");
+}
+
+TEST_F(ShmDataTransferTest, RingFull) {
+  // The ring fits one tensor, so the tensors received while `held` is alive
+  // are sent over the socket, and the ring is reused once it is released.
+  Start({test::AsTensor<int32_t>(std::vector<int32_t>(150, 7))},
+        /*ring_size_bytes=*/1024);
+  GetElementResult held = GetElement(0);
+  for (int64_t i = 1; i < 5; ++i) {
+    GetElementResult result = GetElement(i);
+    test::ExpectEqual(result.components[0], element_[0]);
+  }
+  test::ExpectEqual(held.components[0], element_[0]);
+  held = GetElementResult();
+  for (int64_t i = 5; i < 10; ++i) {
+    GetElementResult result = GetElement(i);
+    test::ExpectEqual(result.components[0], element_[0]);
+  }
+}
+
+TEST_F(ShmDataTransferTest, ServerError) {
+  Start({test::AsScalar<int64_t>(0)}, kDefaultShmRingSizeBytes,
+        errors::NotFound("Task not found"));
+  GetElementRequest request;
+  GetElementResult result;
+  Status s = client_->GetElement(request, result);
+  EXPECT_TRUE(errors::IsNotFound(s)) << s;
+  EXPECT_EQ(s.message(), "Task not found");
+}
+
+TEST_F(ShmDataTransferTest, IncompatibleHost) {
+  Start({test::AsScalar<int64_t>(0)});
+  Status s = client_->CheckCompatibility("another-host-boot-id");
+  EXPECT_TRUE(errors::IsFailedPrecondition(s)) << s;
+}
+
+TEST_F(ShmDataTransferTest, Cancel) {
+  Start({test::AsScalar<int64_t>(0)});
+  client_->TryCancel();
+  GetElementRequest request;
+  GetElementResult result;
+  Status s = client_->GetElement(request, result);
+  EXPECT_TRUE(errors::IsCancelled(s)) << s;
+}
+
+TEST_F(ShmDataTransferTest, OversizedRequest) {
+  Start({test::AsScalar<int64_t>(0)});
+  // Connects to the server directly, and sends the size of a request larger
+  // than the server accepts. The server closes the connection instead of
+  // allocating the request.
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  const std::string name = absl::StrCat("tf_data_shm/", server_->Port());
+  std::memcpy(address.sun_path + 1, name.data(), name.size());
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address),
+                    offsetof(sockaddr_un, sun_path) + 1 + name.size()),
+            0);
+  char ring_size[sizeof(uint64_t)];
+  ASSERT_EQ(recv(fd, ring_size, sizeof(ring_size), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(ring_size)));
+  const char request_size[sizeof(uint64_t)] = {'\xff', '\xff', '\xff', '\xff',
+                                               '\xff', '\xff', '\xff', '\x7f'};
+  ASSERT_EQ(send(fd, request_size, sizeof(request_size), MSG_NOSIGNAL),
+            static_cast<ssize_t>(sizeof(request_size)));
+  char byte;
+  EXPECT_EQ(recv(fd, &byte, 1, 0), 0);
+  close(fd);
+
+  // Other connections are still served.
+  GetElement(0);
+}
+
+TEST(ShmDataTransferClientTest, InvalidAddress) {
+  std::unique_ptr<DataTransferClient> client;
+  Status s = DataTransferClient::Build(
+      kShmTransferProtocol, {/*protocol=*/"grpc", /*address=*/"localhost"},
+      &client);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+// Measures the serialization cost of the gRPC data transfer protocol, which
+// copies each element into a `GetElementResponse` and parses it back.
+void BM_GrpcSerialization(::testing::benchmark::State& state) {
+  const int64_t num_bytes = state.range(0);
+  Tensor tensor(DT_UINT8, TensorShape({num_bytes}));
+  tensor.flat<uint8_t>().setConstant(1);
+  for (auto s : state) {
+    GetElementResponse response;
+    tensor.AsProtoTensorContent(
+        response.mutable_uncompressed()->add_components());
+    std::string serialized = response.SerializeAsString();
+    GetElementResponse parsed;
+    CHECK(parsed.ParseFromString(serialized));
+    Tensor result;
+    CHECK(result.FromProto(parsed.uncompressed().components(0)));
+  }
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+}
+
+// Measures end-to-end transfers of the shm data transfer protocol.
+void BM_ShmTransfer(::testing::benchmark::State& state) {
+  const int64_t num_bytes = state.range(0);
+  Tensor tensor(DT_UINT8, TensorShape({num_bytes}));
+  tensor.flat<uint8_t>().setConstant(1);
+  std::shared_ptr<DataTransferServer> server;
+  TF_CHECK_OK(CreateShmDataTransferServer(
+      [&tensor](const GetElementRequest* request, GetElementResult* result) {
+        result->components = {tensor};
+        return OkStatus();
+      },
+      kDefaultShmRingSizeBytes, &server));
+  TF_CHECK_OK(server->Start());
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build(
+      kShmTransferProtocol,
+      {/*protocol=*/"grpc",
+       /*address=*/absl::StrCat("localhost:", server->Port())},
+      &client));
+  GetElementRequest request;
+  for (auto s : state) {
+    GetElementResult result;
+    TF_CHECK_OK(client->GetElement(request, result));
+  }
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+}
+
+BENCHMARK(BM_GrpcSerialization)->Arg(1 << 10)->Arg(1 << 20)->Arg(16 << 20);
+BENCHMARK(BM_ShmTransfer)->Arg(1 << 10)->Arg(1 << 20)->Arg(16 << 20);
+#endif  // defined(__linux__)
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -0,0 +1,777 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_transfer.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/raw_coding.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+#if defined(__linux__)
+
+// Slots of the ring, and the tensors in them, are aligned to this many bytes.
+constexpr uint64_t kShmAlignment = 64;
+constexpr char kSocketNamePrefix[] = "tf_data_shm/";
+constexpr int kMaxSocketIds = 1 << 30;
+constexpr int kMaxBindAttempts = 10;
+constexpr char kBootIdFile[] = "/proc/sys/kernel/random/boot_id";
+// Maximum sizes of the messages received by the server and the client. Requests
+// only hold a few ids, and protos can't be parsed from more than 2GB.
+constexpr uint64_t kMaxRequestBytes = 64 << 10;
+constexpr uint64_t kMaxResponseBytes = std::numeric_limits<int32_t>::max();
+
+// Header of a slot of the ring. The client sets `released` when it destroys the
+// tensor in the slot, after which the server may reuse the slot.
+struct SlotHeader {
+  uint64_t size = 0;
+  std::atomic<uint32_t> released = 0;
+};
+static_assert(sizeof(SlotHeader) <= kShmAlignment);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+uint64_t RoundUp(uint64_t value) {
+  return (value + kShmAlignment - 1) / kShmAlignment * kShmAlignment;
+}
+
+// Returns an identifier of the host, to check that the server and the client
+// can share memory.
+StatusOr<std::string> BootId() {
+  std::string boot_id;
+  TF_RETURN_IF_ERROR(ReadFileToString(Env::Default(), kBootIdFile, &boot_id));
+  return std::string(absl::StripAsciiWhitespace(boot_id));
+}
+
+// Returns the address of the socket of the server with id `id`, in the
+// abstract socket namespace.
+sockaddr_un SocketAddress(int id, socklen_t& length) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  const std::string name = absl::StrCat(kSocketNamePrefix, id);
+  // The leading null byte of `sun_path` selects the abstract namespace.
+  std::memcpy(address.sun_path + 1, name.data(), name.size());
+  length = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+  return address;
+}
+
+Status SendAll(int socket, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errors::IOError("Failed to send to shm data transfer socket",
+                             errno);
+    }
+    data += sent;
+    size -= sent;
+  }
+  return OkStatus();
+}
+
+Status ReceiveAll(int socket, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t received = recv(socket, data, size, 0);
+    if (received == 0) {
+      return errors::Unavailable("The shm data transfer socket was closed.");
+    }
+    if (received < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errors::IOError(
+          "Failed to receive from shm data transfer socket", errno);
+    }
+    data += received;
+    size -= received;
+  }
+  return OkStatus();
+}
+
+// Messages are sent as their size (fixed64) followed by their serialization.
+Status SendMessage(int socket, const protobuf::MessageLite& message) {
+  std::string buffer;
+  core::PutFixed64(&buffer, message.ByteSizeLong());
+  if (!message.AppendToString(&buffer)) {
+    return errors::Internal("Failed to serialize ", message.GetTypeName());
+  }
+  return SendAll(socket, buffer.data(), buffer.size());
+}
+
+// Messages larger than `max_size` bytes are rejected before they are read.
+Status ReceiveMessage(int socket, uint64_t max_size,
+                      protobuf::MessageLite& message) {
+  char size[sizeof(uint64_t)];
+  TF_RETURN_IF_ERROR(ReceiveAll(socket, size, sizeof(size)));
+  const uint64_t message_size = core::DecodeFixed64(size);
+  if (message_size > max_size) {
+    return errors::DataLoss("Received a ", message.GetTypeName(), " of ",
+                            message_size, " bytes, more than the maximum of ",
+                            max_size, " bytes.");
+  }
+  std::string buffer(message_size, '\0');
+  TF_RETURN_IF_ERROR(ReceiveAll(socket, buffer.data(), buffer.size()));
+  if (!message.ParseFromString(buffer)) {
+    return errors::DataLoss("Failed to parse ", message.GetTypeName());
+  }
+  return OkStatus();
+}
+
+// A memory-mapped memfd, shared by the server and a client.
+class SharedMemory {
+ public:
+  static StatusOr<std::shared_ptr<SharedMemory>> Create(uint64_t size) {
+    int fd = syscall(SYS_memfd_create, "tf_data_shm", MFD_CLOEXEC);
+    if (fd < 0) {
+      return errors::IOError("Failed to create memfd", errno);
+    }
+    if (ftruncate(fd, size) != 0) {
+      const int error = errno;
+      close(fd);
+      return errors::IOError("Failed to resize memfd", error);
+    }
+    return Map(fd, size);
+  }
+
+  // Maps `size` bytes of `fd`, taking ownership of `fd`.
+  static StatusOr<std::shared_ptr<SharedMemory>> Map(int fd, uint64_t size) {
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                      /*offset=*/0);
+    if (base == MAP_FAILED) {
+      const int error = errno;
+      close(fd);
+      return errors::IOError("Failed to map memfd", error);
+    }
+    return absl::WrapUnique(
+        new SharedMemory(fd, static_cast<char*>(base), size));
+  }
+
+  ~SharedMemory() {
+    munmap(base_, size_);
+    close(fd_);
+  }
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  int fd() const { return fd_; }
+  char* base() const { return base_; }
+  uint64_t size() const { return size_; }
+  SlotHeader* slot(uint64_t offset) const {
+    return reinterpret_cast<SlotHeader*>(base_ + offset);
+  }
+
+ private:
+  SharedMemory(int fd, char* base, uint64_t size)
+      : fd_(fd), base_(base), size_(size) {}
+
+  const int fd_;
+  char* const base_;
+  const uint64_t size_;
+};
+
+// Sends `memory` to the client, as a file descriptor and a size.
+Status SendSharedMemory(int socket, const SharedMemory& memory) {
+  char size[sizeof(uint64_t)];
+  core::EncodeFixed64(size, memory.size());
+  iovec iov = {size, sizeof(size)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr message = {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  cmsghdr* header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(int));
+  const int fd = memory.fd();
+  std::memcpy(CMSG_DATA(header), &fd, sizeof(int));
+  if (sendmsg(socket, &message, MSG_NOSIGNAL) != sizeof(size)) {
+    return errors::IOError("Failed to send shm data transfer ring", errno);
+  }
+  return OkStatus();
+}
+
+StatusOr<std::shared_ptr<SharedMemory>> ReceiveSharedMemory(int socket) {
+  char size[sizeof(uint64_t)];
+  iovec iov = {size, sizeof(size)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr message = {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  if (recvmsg(socket, &message, MSG_CMSG_CLOEXEC) != sizeof(size)) {
+    return errors::Unavailable("Failed to receive shm data transfer ring.");
+  }
+  cmsghdr* header = CMSG_FIRSTHDR(&message);
+  if (header == nullptr || header->cmsg_level != SOL_SOCKET ||
+      header->cmsg_type != SCM_RIGHTS) {
+    return errors::Unavailable("Failed to receive shm data transfer ring.");
+  }
+  int fd;
+  std::memcpy(&fd, CMSG_DATA(header), sizeof(int));
+  return SharedMemory::Map(fd, core::DecodeFixed64(size));
+}
+
+// The server's view of a ring. Allocates slots at `head_`, and reclaims the
+// released slots at `tail_`. Both offsets grow monotonically, and wrap around
+// the ring modulo its size.
+class RingWriter {
+ public:
+  explicit RingWriter(std::shared_ptr<SharedMemory> memory)
+      : memory_(std::move(memory)) {}
+
+  // Returns the offset of `size` bytes for a tensor, or nullopt if the ring is
+  // full.
+  std::optional<uint64_t> Allocate(uint64_t size) {
+    Reclaim();
+    const uint64_t capacity = memory_->size();
+    const uint64_t slot_size = RoundUp(kShmAlignment + size);
+    const uint64_t position = head_ % capacity;
+    // Tensors are contiguous, so slots that would cross the end of the ring
+    // start at the beginning instead, and the end of the ring is padded.
+    if (position + slot_size > capacity &&
+        (slot_size > position ||
+         !AddSlot(capacity - position, /*released=*/true))) {
+      return std::nullopt;
+    }
+    const uint64_t offset = head_ % capacity;
+    if (!AddSlot(slot_size, /*released=*/false)) {
+      return std::nullopt;
+    }
+    return offset + kShmAlignment;
+  }
+
+  char* data(uint64_t offset) const { return memory_->base() + offset; }
+
+ private:
+  // Advances `tail_` past the slots released by the client.
+  void Reclaim() {
+    while (tail_ < head_) {
+      SlotHeader* slot = memory_->slot(tail_ % memory_->size());
+      if (!slot->released.load(std::memory_order_acquire)) {
+        return;
+      }
+      tail_ += slot->size;
+    }
+  }
+
+  bool AddSlot(uint64_t slot_size, bool released) {
+    if (slot_size > memory_->size() - (head_ - tail_)) {
+      return false;
+    }
+    SlotHeader* slot =
+        new (memory_->slot(head_ % memory_->size())) SlotHeader();
+    slot->size = slot_size;
+    slot->released.store(released, std::memory_order_relaxed);
+    head_ += slot_size;
+    return true;
+  }
+
+  const std::shared_ptr<SharedMemory> memory_;
+  uint64_t head_ = 0;
+  uint64_t tail_ = 0;
+};
+
+// A tensor buffer in the ring of a client. Releases its slot when destroyed.
+class ShmTensorBuffer : public TensorBuffer {
+ public:
+  ShmTensorBuffer(std::shared_ptr<SharedMemory> memory, uint64_t offset,
+                  size_t size)
+      : TensorBuffer(memory->base() + offset),
+        memory_(std::move(memory)),
+        offset_(offset),
+        size_(size) {}
+
+  ~ShmTensorBuffer() override {
+    memory_->slot(offset_ - kShmAlignment)
+        ->released.store(1, std::memory_order_release);
+  }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("ShmDataTransfer");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<SharedMemory> memory_;
+  const uint64_t offset_;
+  const size_t size_;
+};
+
+class ShmDataTransferServer : public DataTransferServer {
+ public:
+  ShmDataTransferServer(GetElementT get_element, int64_t ring_size_bytes)
+      : get_element_(std::move(get_element)),
+        ring_size_bytes_(RoundUp(std::max<int64_t>(ring_size_bytes, 1))) {}
+
+  ~ShmDataTransferServer() override {
+    std::vector<std::unique_ptr<Connection>> connections;
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      for (const auto& connection : connections_) {
+        shutdown(connection->socket, SHUT_RDWR);
+      }
+      connections.swap(connections_);
+    }
+    if (listen_socket_ >= 0) {
+      shutdown(listen_socket_, SHUT_RDWR);
+    }
+    accept_thread_.reset();
+    connections.clear();
+    if (listen_socket_ >= 0) {
+      close(listen_socket_);
+    }
+  }
+
+  Status Start() override {
+    listen_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_socket_ < 0) {
+      return errors::IOError("Failed to create shm data transfer socket",
+                             errno);
+    }
+    for (int attempt = 0; attempt < kMaxBindAttempts && id_ == 0; ++attempt) {
+      const int id = 1 + random::New64() % (kMaxSocketIds - 1);
+      socklen_t length;
+      sockaddr_un address = SocketAddress(id, length);
+      if (bind(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+               length) == 0) {
+        id_ = id;
+      } else if (errno != EADDRINUSE) {
+        return errors::IOError("Failed to bind shm data transfer socket",
+                               errno);
+      }
+    }
+    if (id_ == 0) {
+      return errors::Unavailable(
+          "Failed to find a free shm data transfer socket.");
+    }
+    if (listen(listen_socket_, SOMAXCONN) != 0) {
+      return errors::IOError("Failed to listen on shm data transfer socket",
+                             errno);
+    }
+    accept_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        /*thread_options=*/{}, /*name=*/"tf_data_shm_accept",
+        [this]() { AcceptConnections(); }));
+    return OkStatus();
+  }
+
+  int Port() const override { return id_; }
+
+  StatusOr<std::string> GetCompatibilityInfo() const override {
+    return BootId();
+  }
+
+ private:
+  struct Connection {
+    ~Connection() {
+      thread.reset();
+      close(socket);
+    }
+
+    int socket = -1;
+    std::atomic<bool> done = false;
+    std::unique_ptr<Thread> thread;
+  };
+
+  void AcceptConnections() {
+    while (true) {
+      const int socket = accept4(listen_socket_, /*addr=*/nullptr,
+                                 /*addrlen=*/nullptr, SOCK_CLOEXEC);
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        if (socket >= 0) {
+          close(socket);
+        }
+        return;
+      }
+      if (socket < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        LOG(ERROR) << "Failed to accept shm data transfer connection: "
+                   << errors::IOError("accept", errno);
+        return;
+      }
+      // The abstract socket is reachable by every user of the host, so only
+      // the processes of the server's own user are served.
+      ucred credentials;
+      socklen_t credentials_length = sizeof(credentials);
+      if (getsockopt(socket, SOL_SOCKET, SO_PEERCRED, &credentials,
+                     &credentials_length) != 0) {
+        LOG(WARNING) << "Rejected shm data transfer connection: "
+                     << errors::IOError("getsockopt(SO_PEERCRED)", errno);
+        close(socket);
+        continue;
+      }
+      if (credentials.uid != geteuid()) {
+        LOG(WARNING) << "Rejected shm data transfer connection from uid "
+                     << credentials.uid << ", which is not the uid "
+                     << geteuid() << " of the server.";
+        close(socket);
+        continue;
+      }
+      // Drops the connections of the clients that have disconnected.
+      connections_.erase(
+          std::remove_if(connections_.begin(), connections_.end(),
+                         [](const std::unique_ptr<Connection>& connection) {
+                           return connection->done.load();
+                         }),
+          connections_.end());
+      auto connection = std::make_unique<Connection>();
+      connection->socket = socket;
+      Connection* connection_ptr = connection.get();
+      connection->thread = absl::WrapUnique(Env::Default()->StartThread(
+          /*thread_options=*/{}, /*name=*/"tf_data_shm_connection",
+          [this, connection_ptr]() { Serve(*connection_ptr); }));
+      connections_.push_back(std::move(connection));
+    }
+  }
+
+  void Serve(Connection& connection) {
+    Status s = ServeRequests(connection.socket);
+    VLOG(2) << "Closed shm data transfer connection: " << s;
+    connection.done = true;
+  }
+
+  // Serves the requests of a client until it disconnects.
+  Status ServeRequests(int socket) {
+    TF_ASSIGN_OR_RETURN(std::shared_ptr<SharedMemory> memory,
+                        SharedMemory::Create(ring_size_bytes_));
+    TF_RETURN_IF_ERROR(SendSharedMemory(socket, *memory));
+    RingWriter ring(memory);
+    while (true) {
+      GetElementRequest request;
+      TF_RETURN_IF_ERROR(ReceiveMessage(socket, kMaxRequestBytes, request));
+      GetElementResult result;
+      ShmGetElementResponse response;
+      Status s = get_element_(&request, &result);
+      if (s.ok()) {
+        s = WriteElement(std::move(result), ring, response);
+      }
+      if (!s.ok()) {
+        response.Clear();
+        response.set_status_code(s.raw_code());
+        response.set_status_message(std::string(s.message()));
+      }
+      TF_RETURN_IF_ERROR(SendMessage(socket, response));
+    }
+  }
+
+  // Writes `result` to `response`, copying the tensors that fit in `ring`.
+  Status WriteElement(GetElementResult result, RingWriter& ring,
+                      ShmGetElementResponse& response) {
+    response.set_element_index(result.element_index);
+    response.set_end_of_sequence(result.end_of_sequence);
+    response.set_skip_task(result.skip);
+    std::vector<Tensor>& element = result.components;
+    if (element.size() == 1 && element[0].dtype() == DT_VARIANT &&
+        TensorShapeUtils::IsScalar(element[0].shape())) {
+      Variant& variant = element[0].scalar<Variant>()();
+      CompressedElement* compressed = variant.get<CompressedElement>();
+      if (compressed == nullptr) {
+        return errors::FailedPrecondition(
+            "Expected dataset to produce a CompressedElement variant tensor, "
+            "but it produced ",
+            variant.TypeName());
+      }
+      *response.mutable_compressed() = std::move(*compressed);
+      return OkStatus();
+    }
+    for (const Tensor& tensor : element) {
+      ShmGetElementResponse::Component* component =
+          response.add_components();
+      absl::string_view data;
+      std::optional<uint64_t> offset;
+      if (DataTypeCanUseMemcpy(tensor.dtype())) {
+        data = tensor.tensor_data();
+        if (!data.empty()) {
+          offset = ring.Allocate(data.size());
+        }
+      }
+      if (!offset.has_value()) {
+        tensor.AsProtoTensorContent(component->mutable_tensor());
+        continue;
+      }
+      std::memcpy(ring.data(*offset), data.data(), data.size());
+      component->mutable_tensor()->set_dtype(tensor.dtype());
+      tensor.shape().AsProto(
+          component->mutable_tensor()->mutable_tensor_shape());
+      component->set_in_ring(true);
+      component->set_offset(*offset);
+    }
+    return OkStatus();
+  }
+
+  const GetElementT get_element_;
+  const uint64_t ring_size_bytes_;
+
+  int listen_socket_ = -1;
+  int id_ = 0;
+  std::unique_ptr<Thread> accept_thread_;
+
+  mutex mu_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::vector<std::unique_ptr<Connection>> connections_ TF_GUARDED_BY(mu_);
+};
+
+class ShmDataTransferClient : public DataTransferClient {
+ public:
+  // Connects to the server at `address`, whose port is the id of the server's
+  // socket.
+  static StatusOr<std::unique_ptr<ShmDataTransferClient>> Connect(
+      absl::string_view address) {
+    const size_t colon = address.rfind(':');
+    int id;
+    if (colon == absl::string_view::npos ||
+        !absl::SimpleAtoi(address.substr(colon + 1), &id)) {
+      return errors::InvalidArgument("Invalid shm data transfer address ",
+                                     address, "; expected <host>:<port>.");
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return errors::IOError("Failed to create shm data transfer socket",
+                             errno);
+    }
+    socklen_t length;
+    sockaddr_un socket_address = SocketAddress(id, length);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&socket_address), length) !=
+        0) {
+      const int error = errno;
+      close(fd);
+      return errors::IOError(
+          absl::StrCat("Failed to connect to shm data transfer server ",
+                       address),
+          error);
+    }
+    StatusOr<std::shared_ptr<SharedMemory>> memory = ReceiveSharedMemory(fd);
+    if (!memory.ok()) {
+      close(fd);
+      return memory.status();
+    }
+    VLOG(2) << "Create ShmDataTransferClient for worker " << address << ".";
+    return absl::WrapUnique(
+        new ShmDataTransferClient(fd, *std::move(memory)));
+  }
+
+  ~ShmDataTransferClient() override { close(socket_); }
+
+  Status GetElement(const GetElementRequest& req,
+                    GetElementResult& result) override {
+    VLOG(3) << "GetElement for task " << req.task_id() << " from shm worker "
+            << "server.";
+    mutex_lock l(mu_);
+    if (cancelled_) {
+      return errors::Cancelled("Client was cancelled.");
+    }
+    int64_t start_time_us = Env::Default()->NowMicros();
+    ShmGetElementResponse resp;
+    Status s = SendMessage(socket_, req);
+    if (s.ok()) {
+      s = ReceiveMessage(socket_, kMaxResponseBytes, resp);
+    }
+    if (!s.ok()) {
+      if (cancelled_) {
+        return errors::Cancelled("Client was cancelled.");
+      }
+      return s;
+    }
+    int64_t end_time_us = Env::Default()->NowMicros();
+    metrics::RecordTFDataServiceGetElementDuration(kShmTransferProtocol,
+                                                   end_time_us - start_time_us);
+    if (resp.status_code() != 0) {
+      return Status(static_cast<absl::StatusCode>(resp.status_code()),
+                    resp.status_message());
+    }
+    result.element_index = resp.element_index();
+    result.end_of_sequence = resp.end_of_sequence();
+    result.skip = resp.skip_task();
+    if (resp.has_compressed()) {
+      Tensor tensor(DT_VARIANT, TensorShape{});
+      tensor.scalar<Variant>()() = std::move(*resp.mutable_compressed());
+      result.components.push_back(tensor);
+      return OkStatus();
+    }
+    for (const ShmGetElementResponse::Component& component :
+         resp.components()) {
+      if (!component.in_ring()) {
+        result.components.emplace_back();
+        if (!result.components.back().FromProto(component.tensor())) {
+          return errors::Internal("Failed to parse tensor.");
+        }
+        continue;
+      }
+      const DataType dtype = component.tensor().dtype();
+      TensorShape shape;
+      TF_RETURN_IF_ERROR(TensorShape::BuildTensorShape(
+          component.tensor().tensor_shape(), &shape));
+      const uint64_t size = shape.num_elements() * DataTypeSize(dtype);
+      if (component.offset() < kShmAlignment ||
+          component.offset() + size > ring_->size()) {
+        return errors::DataLoss("Invalid shm data transfer ring offset ",
+                                component.offset(), ".");
+      }
+      core::RefCountPtr<TensorBuffer> buffer(
+          new ShmTensorBuffer(ring_, component.offset(), size));
+      result.components.push_back(Tensor(dtype, shape, std::move(buffer)));
+    }
+    return OkStatus();
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel ShmDataTransferClient.";
+    cancelled_ = true;
+    // Unblocks the request in progress, if any.
+    shutdown(socket_, SHUT_RDWR);
+  }
+
+  StatusOr<std::string> GetCompatibilityInfo() const override {
+    return BootId();
+  }
+
+  Status CheckCompatibility(
+      const std::string& server_compatibility_info) const override {
+    TF_ASSIGN_OR_RETURN(std::string boot_id, BootId());
+    if (boot_id != server_compatibility_info) {
+      return errors::FailedPrecondition(
+          "The shm data transfer protocol requires the tf.data service worker "
+          "to run on the same host as the client.");
+    }
+    return OkStatus();
+  }
+
+ private:
+  ShmDataTransferClient(int socket, std::shared_ptr<SharedMemory> ring)
+      : socket_(socket), ring_(std::move(ring)) {}
+
+  const int socket_;
+  const std::shared_ptr<SharedMemory> ring_;
+  std::atomic<bool> cancelled_ = false;
+  // Serializes the requests, which share the socket.
+  mutex mu_;
+};
+
+#endif  // defined(__linux__)
+
+Status CreateShmDataTransferClient(DataTransferClient::Config config,
+                                   std::unique_ptr<DataTransferClient>* out) {
+#if defined(__linux__)
+  TF_ASSIGN_OR_RETURN(*out, ShmDataTransferClient::Connect(config.address));
+  return OkStatus();
+#else
+  return errors::Unimplemented(
+      "The shm data transfer protocol is only supported on Linux.");
+#endif  // defined(__linux__)
+}
+
+class ShmTransferServerRegistrar {
+ public:
+  ShmTransferServerRegistrar() {
+    DataTransferServer::Register(
+        kShmTransferProtocol,
+        [](DataTransferServer::GetElementT get_element,
+           std::shared_ptr<DataTransferServer>* out) {
+          return CreateShmDataTransferServer(
+              std::move(get_element), kDefaultShmRingSizeBytes, out);
+        });
+  }
+};
+static ShmTransferServerRegistrar shm_server_registrar;
+
+class ShmTransferClientRegistrar {
+ public:
+  ShmTransferClientRegistrar() {
+    DataTransferClient::Register(kShmTransferProtocol,
+                                 CreateShmDataTransferClient);
+  }
+};
+static ShmTransferClientRegistrar shm_client_registrar;
+
+}  // namespace
+
+Status CreateShmDataTransferServer(DataTransferServer::GetElementT get_element,
+                                   int64_t ring_size_bytes,
+                                   std::shared_ptr<DataTransferServer>* out) {
+#if defined(__linux__)
+  *out = std::make_shared<ShmDataTransferServer>(std::move(get_element),
+                                                 ring_size_bytes);
+  return OkStatus();
+#else
+  return errors::Unimplemented(
+      "The shm data transfer protocol is only supported on Linux.");
+#endif  // defined(__linux__)
+}
+
+}  // namespace data
+}  // namespace tensorflow
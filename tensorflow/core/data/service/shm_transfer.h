@@ -0,0 +1,55 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+
+// Data transfer protocol for clients on the same host as the tf.data service
+// worker. Elements are not serialized: the worker copies the content of each
+// tensor once into a shared-memory ring buffer, and the client's tensors alias
+// the ring until they are destroyed. Only the element metadata is sent over a
+// Unix domain socket.
+//
+// Each client connection gets its own ring of `ring_size_bytes`, backed by a
+// memfd that the server passes to the client over the socket. Tensors that do
+// not fit in the ring, and tensors whose dtype can't be memcpy'd (e.g. strings
+// and compressed elements), are sent over the socket instead.
+//
+// The server's `Port()` is the id of its socket, so workers advertise the
+// server with a `data_transfer_address` such as "localhost:%port%". Clients on
+// other hosts fail the compatibility check, and fall back to gRPC. The server
+// only accepts connections from processes of its own user. The protocol is only
+// supported on Linux.
+constexpr const char kShmTransferProtocol[] = "shm";
+constexpr int64_t kDefaultShmRingSizeBytes = 256 << 20;  // 256MB
+
+// Creates a shared-memory data transfer server. The server registered under
+// `kShmTransferProtocol` uses `kDefaultShmRingSizeBytes`.
+Status CreateShmDataTransferServer(DataTransferServer::GetElementT get_element,
+                                   int64_t ring_size_bytes,
+                                   std::shared_ptr<DataTransferServer>* out);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
@@ -0,0 +1,684 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/snapshot/columnar_chunk.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/raw_coding.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+#include "tsl/platform/snappy.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/tstring.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using Column = experimental::ColumnarChunkFooter::Column;
+
+// Dictionary-encodes integer columns with at most this many distinct values.
+constexpr int64_t kMaxDictionarySize = 1 << 16;
+
+// Size of the footer size and of the trailing magic.
+constexpr uint64_t kTrailerSize = sizeof(uint64_t) + kColumnarChunkMagic.size();
+
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool IsInteger(DataType dtype) {
+  return dtype == DT_INT32 || dtype == DT_INT64;
+}
+
+// Returns the values of an integer column in its `RAW` encoding.
+std::vector<int64_t> IntegerValues(DataType dtype, absl::string_view raw) {
+  std::vector<int64_t> values;
+  if (dtype == DT_INT32) {
+    values.resize(raw.size() / sizeof(int32_t));
+    for (size_t i = 0; i < values.size(); ++i) {
+      int32_t value;
+      std::memcpy(&value, raw.data() + i * sizeof(int32_t), sizeof(int32_t));
+      values[i] = value;
+    }
+  } else {
+    values.resize(raw.size() / sizeof(int64_t));
+    std::memcpy(values.data(), raw.data(), values.size() * sizeof(int64_t));
+  }
+  return values;
+}
+
+// Appends `value` to `raw`, the `RAW` encoding of an integer column.
+void AppendInteger(DataType dtype, int64_t value, std::string& raw) {
+  if (dtype == DT_INT32) {
+    const int32_t value32 = static_cast<int32_t>(value);
+    raw.append(reinterpret_cast<const char*>(&value32), sizeof(int32_t));
+  } else {
+    raw.append(reinterpret_cast<const char*>(&value), sizeof(int64_t));
+  }
+}
+
+std::string DeltaEncode(const std::vector<int64_t>& values) {
+  std::string encoded;
+  uint64_t previous = 0;
+  for (int64_t value : values) {
+    // Wraps around on overflow, which `DeltaDecode` reverses.
+    core::PutVarint64(&encoded, ZigZagEncode(static_cast<int64_t>(
+                                    static_cast<uint64_t>(value) - previous)));
+    previous = static_cast<uint64_t>(value);
+  }
+  return encoded;
+}
+
+// Returns an empty string if there are more than `kMaxDictionarySize` distinct
+// values.
+std::string DictionaryEncode(const std::vector<int64_t>& values) {
+  absl::flat_hash_map<int64_t, uint64_t> dictionary;
+  std::vector<int64_t> dictionary_values;
+  std::string indices;
+  for (int64_t value : values) {
+    auto [it, inserted] = dictionary.try_emplace(value, dictionary.size());
+    if (inserted) {
+      if (static_cast<int64_t>(dictionary.size()) > kMaxDictionarySize) {
+        return "";
+      }
+      dictionary_values.push_back(value);
+    }
+    core::PutVarint64(&indices, it->second);
+  }
+  std::string encoded;
+  core::PutVarint64(&encoded, dictionary_values.size());
+  for (int64_t value : dictionary_values) {
+    core::PutVarint64(&encoded, ZigZagEncode(value));
+  }
+  encoded.append(indices);
+  return encoded;
+}
+
+absl::Status CorruptColumnError() {
+  return absl::DataLossError("Corrupted tf.data snapshot columnar chunk.");
+}
+
+absl::StatusOr<std::string> DeltaDecode(DataType dtype, absl::string_view data,
+                                        uint64_t num_values) {
+  std::string raw;
+  raw.reserve(num_values * DataTypeSize(dtype));
+  uint64_t previous = 0;
+  for (uint64_t i = 0; i < num_values; ++i) {
+    uint64_t delta;
+    if (!core::GetVarint64(&data, &delta)) {
+      return CorruptColumnError();
+    }
+    previous += static_cast<uint64_t>(ZigZagDecode(delta));
+    AppendInteger(dtype, static_cast<int64_t>(previous), raw);
+  }
+  return raw;
+}
+
+absl::StatusOr<std::string> DictionaryDecode(DataType dtype,
+                                             absl::string_view data,
+                                             uint64_t num_values) {
+  uint64_t dictionary_size;
+  if (!core::GetVarint64(&data, &dictionary_size) ||
+      dictionary_size > kMaxDictionarySize) {
+    return CorruptColumnError();
+  }
+  std::vector<int64_t> dictionary(dictionary_size);
+  for (int64_t& value : dictionary) {
+    uint64_t encoded;
+    if (!core::GetVarint64(&data, &encoded)) {
+      return CorruptColumnError();
+    }
+    value = ZigZagDecode(encoded);
+  }
+  std::string raw;
+  raw.reserve(num_values * DataTypeSize(dtype));
+  for (uint64_t i = 0; i < num_values; ++i) {
+    uint64_t index;
+    if (!core::GetVarint64(&data, &index) || index >= dictionary_size) {
+      return CorruptColumnError();
+    }
+    AppendInteger(dtype, dictionary[index], raw);
+  }
+  return raw;
+}
+
+// A tensor buffer that aliases a memory-mapped chunk file, and keeps the
+// mapping alive.
+class MemoryRegionBuffer : public TensorBuffer {
+ public:
+  MemoryRegionBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("ColumnarChunkReader");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
+}  // namespace
+
+absl::StatusOr<bool> IsColumnarChunk(const std::string& filename, Env* env) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  char scratch[kColumnarChunkMagic.size()];
+  absl::string_view magic;
+  absl::Status status = file->Read(/*offset=*/0, kColumnarChunkMagic.size(),
+                                   &magic, scratch);
+  if (absl::IsOutOfRange(status)) {
+    return false;
+  }
+  TF_RETURN_IF_ERROR(status);
+  return magic == kColumnarChunkMagic;
+}
+
+ColumnarChunkWriter::ColumnarChunkWriter(const std::string& filename,
+                                         int64_t row_group_size_bytes)
+    : filename_(filename), row_group_size_bytes_(row_group_size_bytes) {}
+
+ColumnarChunkWriter::~ColumnarChunkWriter() {
+  absl::Status status = Close();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to close tf.data snapshot columnar chunk "
+               << filename_ << ": " << status;
+  }
+}
+
+absl::Status ColumnarChunkWriter::Initialize(Env* env) {
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename_, &dest_));
+  return Append(kColumnarChunkMagic, /*align=*/false).status();
+}
+
+absl::Status ColumnarChunkWriter::WriteTensors(
+    const std::vector<Tensor>& tensors) {
+  if (footer_.num_elements() == 0) {
+    for (const Tensor& tensor : tensors) {
+      footer_.add_dtypes(tensor.dtype());
+    }
+    components_.resize(tensors.size());
+  }
+  if (tensors.size() != components_.size()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Failed to write tf.data snapshot columnar chunk ", filename_,
+        ": Expected elements with ", components_.size(),
+        " components, got ", tensors.size(), "."));
+  }
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    if (tensors[i].dtype() != footer_.dtypes(i)) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Failed to write tf.data snapshot columnar chunk ", filename_,
+          ": Expected component ", i, " to have dtype ",
+          DataTypeString(static_cast<DataType>(footer_.dtypes(i))), ", got ",
+          DataTypeString(tensors[i].dtype()), "."));
+    }
+    components_[i].push_back(tensors[i]);
+    buffered_bytes_ += tensors[i].TotalBytes();
+  }
+  footer_.set_num_elements(footer_.num_elements() + 1);
+  if (buffered_bytes_ >= row_group_size_bytes_) {
+    return WriteRowGroup();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkWriter::Sync() {
+  TF_RETURN_IF_ERROR(WriteRowGroup());
+  return dest_->Sync();
+}
+
+absl::Status ColumnarChunkWriter::Close() {
+  if (dest_ == nullptr) {
+    return absl::OkStatus();
+  }
+  TF_RETURN_IF_ERROR(WriteRowGroup());
+  const std::string footer = footer_.SerializeAsString();
+  TF_RETURN_IF_ERROR(Append(footer, /*align=*/false).status());
+  std::string trailer;
+  core::PutFixed64(&trailer, footer.size());
+  trailer.append(kColumnarChunkMagic.data(), kColumnarChunkMagic.size());
+  TF_RETURN_IF_ERROR(Append(trailer, /*align=*/false).status());
+  TF_RETURN_IF_ERROR(dest_->Close());
+  dest_ = nullptr;
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkWriter::WriteRowGroup() {
+  if (components_.empty() || components_[0].empty()) {
+    return absl::OkStatus();
+  }
+  experimental::ColumnarChunkFooter::RowGroup* row_group =
+      footer_.add_row_groups();
+  row_group->set_num_elements(components_[0].size());
+  for (size_t i = 0; i < components_.size(); ++i) {
+    TF_RETURN_IF_ERROR(WriteColumn(static_cast<DataType>(footer_.dtypes(i)),
+                                   components_[i],
+                                   *row_group->add_columns()));
+    components_[i].clear();
+  }
+  buffered_bytes_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkWriter::WriteColumn(
+    DataType dtype, const std::vector<Tensor>& tensors, Column& column) {
+  std::string raw;
+  if (DataTypeCanUseMemcpy(dtype)) {
+    for (const Tensor& tensor : tensors) {
+      absl::string_view data = tensor.tensor_data();
+      raw.append(data.data(), data.size());
+    }
+  } else if (dtype == DT_STRING) {
+    for (const Tensor& tensor : tensors) {
+      for (const tstring& value : tensor.unaligned_flat<tstring>()) {
+        core::PutVarint64(&raw, value.size());
+        raw.append(value.data(), value.size());
+      }
+    }
+  } else {
+    for (const Tensor& tensor : tensors) {
+      TensorProto proto;
+      tensor.AsProtoTensorContent(&proto);
+      const std::string serialized = proto.SerializeAsString();
+      core::PutVarint64(&raw, serialized.size());
+      raw.append(serialized);
+    }
+    column.set_encoding(Column::TENSOR_PROTO);
+    column.set_raw_size(raw.size());
+    TF_ASSIGN_OR_RETURN(uint64_t offset, Append(raw, /*align=*/true));
+    column.set_offset(offset);
+    column.set_size(raw.size());
+    return absl::OkStatus();
+  }
+
+  bool uniform_shape = true;
+  for (const Tensor& tensor : tensors) {
+    uniform_shape &= (tensor.shape() == tensors[0].shape());
+  }
+  column.set_uniform_shape(uniform_shape);
+  if (uniform_shape) {
+    tensors[0].shape().AsProto(column.mutable_shape());
+  } else {
+    std::string shapes;
+    for (const Tensor& tensor : tensors) {
+      core::PutVarint64(&shapes, tensor.dims());
+      for (int64_t dim : tensor.shape().dim_sizes()) {
+        core::PutVarint64(&shapes, dim);
+      }
+    }
+    TF_ASSIGN_OR_RETURN(uint64_t shapes_offset,
+                        Append(shapes, /*align=*/false));
+    column.set_shapes_offset(shapes_offset);
+    column.set_shapes_size(shapes.size());
+  }
+
+  // Keeps the mmappable `RAW` encoding unless another encoding saves at least
+  // an eighth of the column.
+  column.set_encoding(Column::RAW);
+  column.set_raw_size(raw.size());
+  std::string encoded;
+  auto consider = [&](Column::Encoding encoding, std::string candidate) {
+    const size_t best_size =
+        encoded.empty() ? raw.size() - raw.size() / 8 : encoded.size();
+    if (!candidate.empty() && candidate.size() < best_size) {
+      column.set_encoding(encoding);
+      encoded = std::move(candidate);
+    }
+  };
+  if (IsInteger(dtype)) {
+    const std::vector<int64_t> values = IntegerValues(dtype, raw);
+    consider(Column::DELTA, DeltaEncode(values));
+    consider(Column::DICTIONARY, DictionaryEncode(values));
+  }
+  std::string compressed;
+  if (tsl::port::Snappy_Compress(raw.data(), raw.size(), &compressed)) {
+    consider(Column::SNAPPY, std::move(compressed));
+  }
+
+  const std::string& data = encoded.empty() ? raw : encoded;
+  TF_ASSIGN_OR_RETURN(uint64_t offset, Append(data, /*align=*/true));
+  column.set_offset(offset);
+  column.set_size(data.size());
+  return absl::OkStatus();
+}
+
+absl::StatusOr<uint64_t> ColumnarChunkWriter::Append(absl::string_view data,
+                                                     bool align) {
+  if (align && offset_ % kColumnarChunkAlignment != 0) {
+    const std::string padding(
+        kColumnarChunkAlignment - offset_ % kColumnarChunkAlignment, '\0');
+    TF_RETURN_IF_ERROR(dest_->Append(padding));
+    offset_ += padding.size();
+  }
+  const uint64_t offset = offset_;
+  TF_RETURN_IF_ERROR(dest_->Append(data));
+  offset_ += data.size();
+  return offset;
+}
+
+ColumnarChunkReader::ColumnarChunkReader(const std::string& filename,
+                                         const DataTypeVector& dtypes,
+                                         const std::vector<int64_t>& projection)
+    : filename_(filename), dtypes_(dtypes), projection_(projection) {
+  if (projection_.empty()) {
+    for (int64_t i = 0; i < static_cast<int64_t>(dtypes_.size()); ++i) {
+      projection_.push_back(i);
+    }
+  }
+}
+
+absl::Status ColumnarChunkReader::Initialize(Env* env) {
+  for (int64_t component : projection_) {
+    if (component < 0 || component >= static_cast<int64_t>(dtypes_.size())) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Failed to read tf.data snapshot columnar chunk ", filename_,
+          ": Projected component ", component, " is out of range [0, ",
+          dtypes_.size(), ")."));
+    }
+  }
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  if (env->NewReadOnlyMemoryRegionFromFile(filename_, &region).ok()) {
+    region_ = std::move(region);
+  } else {
+    TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
+  }
+  TF_RETURN_IF_ERROR(ReadFooter(env));
+  if (footer_.num_elements() > 0 &&
+      footer_.dtypes_size() != static_cast<int64_t>(dtypes_.size())) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Failed to read tf.data snapshot columnar chunk ", filename_,
+        ": Expected ", dtypes_.size(), " components, got ",
+        footer_.dtypes_size(), "."));
+  }
+  for (int64_t i = 0; i < footer_.dtypes_size(); ++i) {
+    if (footer_.dtypes(i) != dtypes_[i]) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Failed to read tf.data snapshot columnar chunk ", filename_,
+          ": Expected component ", i, " to have dtype ",
+          DataTypeString(dtypes_[i]), ", got ",
+          DataTypeString(static_cast<DataType>(footer_.dtypes(i))), "."));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkReader::ReadFooter(Env* env) {
+  uint64_t file_size = 0;
+  if (region_ != nullptr) {
+    file_size = region_->length();
+  } else {
+    TF_RETURN_IF_ERROR(env->GetFileSize(filename_, &file_size));
+  }
+  if (file_size < kColumnarChunkMagic.size() + kTrailerSize) {
+    return CorruptColumnError();
+  }
+  std::string scratch;
+  TF_ASSIGN_OR_RETURN(absl::string_view trailer,
+                      Read(file_size - kTrailerSize, kTrailerSize, scratch));
+  if (trailer.substr(sizeof(uint64_t)) != kColumnarChunkMagic) {
+    return CorruptColumnError();
+  }
+  const uint64_t footer_size = core::DecodeFixed64(trailer.data());
+  if (footer_size > file_size - kColumnarChunkMagic.size() - kTrailerSize) {
+    return CorruptColumnError();
+  }
+  TF_ASSIGN_OR_RETURN(
+      absl::string_view footer,
+      Read(file_size - kTrailerSize - footer_size, footer_size, scratch));
+  if (!footer_.ParseFromArray(footer.data(), footer.size())) {
+    return CorruptColumnError();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkReader::ReadTensors(
+    std::vector<Tensor>* read_tensors) {
+  while (next_element_ >= row_group_num_elements_) {
+    if (next_row_group_ >= footer_.row_groups_size()) {
+      return absl::OutOfRangeError("End of tf.data snapshot columnar chunk.");
+    }
+    TF_RETURN_IF_ERROR(ReadRowGroup(next_row_group_++));
+  }
+  read_tensors->clear();
+  read_tensors->reserve(columns_.size());
+  for (std::vector<Tensor>& column : columns_) {
+    read_tensors->push_back(std::move(column[next_element_]));
+  }
+  ++next_element_;
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkReader::SkipRecords(int64_t num_records) {
+  while (num_records > 0) {
+    const int64_t remaining = row_group_num_elements_ - next_element_;
+    if (num_records <= remaining) {
+      next_element_ += num_records;
+      return absl::OkStatus();
+    }
+    num_records -= remaining;
+    next_element_ = row_group_num_elements_;
+    while (next_row_group_ < footer_.row_groups_size() &&
+           footer_.row_groups(next_row_group_).num_elements() <= num_records) {
+      num_records -= footer_.row_groups(next_row_group_++).num_elements();
+    }
+    if (num_records == 0) {
+      return absl::OkStatus();
+    }
+    if (next_row_group_ >= footer_.row_groups_size()) {
+      return absl::OutOfRangeError("End of tf.data snapshot columnar chunk.");
+    }
+    TF_RETURN_IF_ERROR(ReadRowGroup(next_row_group_++));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkReader::ReadRowGroup(int64_t index) {
+  const experimental::ColumnarChunkFooter::RowGroup& row_group =
+      footer_.row_groups(index);
+  if (row_group.columns_size() != static_cast<int64_t>(dtypes_.size())) {
+    return CorruptColumnError();
+  }
+  columns_.resize(projection_.size());
+  for (size_t i = 0; i < projection_.size(); ++i) {
+    columns_[i].clear();
+    TF_RETURN_IF_ERROR(ReadColumn(projection_[i], row_group.num_elements(),
+                                  row_group.columns(projection_[i]),
+                                  columns_[i]));
+  }
+  row_group_num_elements_ = row_group.num_elements();
+  next_element_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarChunkReader::ReadColumn(int64_t component,
+                                             int64_t num_elements,
+                                             const Column& column,
+                                             std::vector<Tensor>& tensors) {
+  const DataType dtype = dtypes_[component];
+  std::string scratch;
+  TF_ASSIGN_OR_RETURN(absl::string_view data,
+                      Read(column.offset(), column.size(), scratch));
+  bytes_read_ += column.size();
+  tensors.reserve(num_elements);
+
+  if (column.encoding() == Column::TENSOR_PROTO) {
+    for (int64_t i = 0; i < num_elements; ++i) {
+      uint64_t size;
+      TensorProto proto;
+      if (!core::GetVarint64(&data, &size) || size > data.size() ||
+          !proto.ParseFromArray(data.data(), size)) {
+        return CorruptColumnError();
+      }
+      data.remove_prefix(size);
+      Tensor tensor;
+      if (!tensor.FromProto(proto)) {
+        return CorruptColumnError();
+      }
+      tensors.push_back(std::move(tensor));
+    }
+    return absl::OkStatus();
+  }
+
+  std::vector<TensorShape> shapes;
+  if (column.uniform_shape()) {
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(TensorShape::BuildTensorShape(column.shape(), &shape));
+    shapes.assign(num_elements, shape);
+  } else {
+    std::string shapes_scratch;
+    TF_ASSIGN_OR_RETURN(
+        absl::string_view encoded_shapes,
+        Read(column.shapes_offset(), column.shapes_size(), shapes_scratch));
+    bytes_read_ += column.shapes_size();
+    for (int64_t i = 0; i < num_elements; ++i) {
+      uint64_t rank;
+      if (!core::GetVarint64(&encoded_shapes, &rank)) {
+        return CorruptColumnError();
+      }
+      std::vector<int64_t> dims(rank);
+      for (int64_t& dim : dims) {
+        uint64_t encoded_dim;
+        if (!core::GetVarint64(&encoded_shapes, &encoded_dim)) {
+          return CorruptColumnError();
+        }
+        dim = static_cast<int64_t>(encoded_dim);
+      }
+      TensorShape shape;
+      TF_RETURN_IF_ERROR(TensorShape::BuildTensorShape(dims, &shape));
+      shapes.push_back(std::move(shape));
+    }
+  }
+
+  // Decodes the column into its `RAW` encoding. `RAW` columns are not copied.
+  std::string decoded;
+  const uint64_t num_values =
+      DataTypeCanUseMemcpy(dtype) ? column.raw_size() / DataTypeSize(dtype) : 0;
+  switch (column.encoding()) {
+    case Column::RAW:
+      break;
+    case Column::SNAPPY: {
+      size_t size;
+      if (!tsl::port::Snappy_GetUncompressedLength(data.data(), data.size(),
+                                                   &size) ||
+          size != column.raw_size()) {
+        return CorruptColumnError();
+      }
+      decoded.resize(size);
+      if (!tsl::port::Snappy_Uncompress(data.data(), data.size(),
+                                        decoded.data())) {
+        return CorruptColumnError();
+      }
+      break;
+    }
+    case Column::DELTA: {
+      TF_ASSIGN_OR_RETURN(decoded, DeltaDecode(dtype, data, num_values));
+      break;
+    }
+    case Column::DICTIONARY: {
+      TF_ASSIGN_OR_RETURN(decoded, DictionaryDecode(dtype, data, num_values));
+      break;
+    }
+    default:
+      return CorruptColumnError();
+  }
+  const bool aliases_file =
+      column.encoding() == Column::RAW && region_ != nullptr;
+  absl::string_view raw = column.encoding() == Column::RAW ? data : decoded;
+
+  for (const TensorShape& shape : shapes) {
+    if (dtype == DT_STRING) {
+      Tensor tensor(DT_STRING, shape);
+      for (tstring& value : tensor.unaligned_flat<tstring>()) {
+        uint64_t size;
+        if (!core::GetVarint64(&raw, &size) || size > raw.size()) {
+          return CorruptColumnError();
+        }
+        value.assign(raw.data(), size);
+        raw.remove_prefix(size);
+      }
+      tensors.push_back(std::move(tensor));
+      continue;
+    }
+    const size_t size = shape.num_elements() * DataTypeSize(dtype);
+    if (size > raw.size()) {
+      return CorruptColumnError();
+    }
+    if (aliases_file && reinterpret_cast<uintptr_t>(raw.data()) %
+                                Allocator::kAllocatorAlignment ==
+                            0) {
+      core::RefCountPtr<TensorBuffer> buffer(
+          new MemoryRegionBuffer(region_, raw.data(), size));
+      tensors.push_back(Tensor(dtype, shape, std::move(buffer)));
+    } else {
+      Tensor tensor(dtype, shape);
+      std::memcpy(const_cast<char*>(tensor.tensor_data().data()), raw.data(),
+                  size);
+      tensors.push_back(std::move(tensor));
+    }
+    raw.remove_prefix(size);
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<absl::string_view> ColumnarChunkReader::Read(
+    uint64_t offset, uint64_t size, std::string& scratch) {
+  if (region_ != nullptr) {
+    if (offset + size > region_->length()) {
+      return CorruptColumnError();
+    }
+    return absl::string_view(
+        static_cast<const char*>(region_->data()) + offset, size);
+  }
+  scratch.resize(size);
+  absl::string_view result;
+  TF_RETURN_IF_ERROR(file_->Read(offset, size, &result, scratch.data()));
+  return result;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,175 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_COLUMNAR_CHUNK_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_COLUMNAR_CHUNK_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/file_system.h"
+
+namespace tensorflow {
+namespace data {
+
+// A columnar snapshot chunk is laid out as:
+//
+// - magic (8 bytes)
+// - row group 0
+//   - column 0: [shapes], data
+//   - ...
+//   - column <num_components - 1>
+// - ...
+// - row group <num_row_groups - 1>
+// - footer: `ColumnarChunkFooter` proto
+// - footer size (fixed64)
+// - magic (8 bytes)
+//
+// Each column stores one component of the elements of its row group, encoded
+// as described by `ColumnarChunkFooter.Column.Encoding`. The data of every
+// column starts at a multiple of `kColumnarChunkAlignment` bytes, so the
+// tensors of uncompressed columns can alias a memory-mapped file.
+inline constexpr absl::string_view kColumnarChunkMagic = "TFDCOL01";
+inline constexpr int64_t kColumnarChunkAlignment = 64;
+inline constexpr int64_t kDefaultRowGroupSizeBytes = 64 << 20;  // 64MB
+
+// Returns true if `filename` is a columnar chunk, and false if it is in
+// another format (e.g. TFRecord).
+absl::StatusOr<bool> IsColumnarChunk(const std::string& filename, Env* env);
+
+// Writes snapshot elements in the columnar chunk format. Elements are buffered
+// until they reach `row_group_size_bytes`, then written as a row group. All
+// elements must have the same number of components and dtypes.
+class ColumnarChunkWriter : public snapshot_util::Writer {
+ public:
+  explicit ColumnarChunkWriter(
+      const std::string& filename,
+      int64_t row_group_size_bytes = kDefaultRowGroupSizeBytes);
+  ~ColumnarChunkWriter() override;
+  ColumnarChunkWriter(const ColumnarChunkWriter&) = delete;
+  ColumnarChunkWriter& operator=(const ColumnarChunkWriter&) = delete;
+
+  absl::Status Initialize(Env* env) override;
+
+  absl::Status WriteTensors(const std::vector<Tensor>& tensors) override;
+
+  // Writes the buffered elements as a row group and flushes the file.
+  absl::Status Sync() override;
+
+  // Writes the buffered elements and the footer. It is a no-op if the writer
+  // is already closed.
+  absl::Status Close() override;
+
+ private:
+  // Writes the buffered elements as a row group.
+  absl::Status WriteRowGroup();
+
+  // Encodes and writes `tensors`, one component of the buffered elements.
+  absl::Status WriteColumn(DataType dtype, const std::vector<Tensor>& tensors,
+                           experimental::ColumnarChunkFooter::Column& column);
+
+  // Appends `data` to the file, after padding the file to
+  // `kColumnarChunkAlignment` bytes if `align` is true. Returns the offset of
+  // `data`.
+  absl::StatusOr<uint64_t> Append(absl::string_view data, bool align);
+
+  const std::string filename_;
+  const int64_t row_group_size_bytes_;
+
+  std::unique_ptr<WritableFile> dest_;
+  uint64_t offset_ = 0;
+  experimental::ColumnarChunkFooter footer_;
+
+  // Components of the buffered elements: `components_[i][j]` is component `i`
+  // of element `j`.
+  std::vector<std::vector<Tensor>> components_;
+  int64_t buffered_bytes_ = 0;
+};
+
+// Reads snapshot elements written by `ColumnarChunkWriter`. If `projection` is
+// non-empty, only reads the components at these indices, in this order, and
+// skips the data of the other components. Uncompressed columns of local files
+// are memory-mapped, and their tensors alias the file when they are aligned.
+class ColumnarChunkReader : public snapshot_util::Reader {
+ public:
+  ColumnarChunkReader(const std::string& filename, const DataTypeVector& dtypes,
+                      const std::vector<int64_t>& projection = {});
+
+  absl::Status Initialize(Env* env) override;
+
+  // Reads the next element into `read_tensors`. Returns OutOfRange at the end
+  // of the chunk.
+  absl::Status ReadTensors(std::vector<Tensor>* read_tensors) override;
+
+  // Skips `num_records` elements, without decoding the skipped row groups.
+  absl::Status SkipRecords(int64_t num_records) override;
+
+  // Returns the number of elements in the chunk.
+  int64_t num_elements() const { return footer_.num_elements(); }
+
+  // Returns the number of bytes read.
+  uint64_t BytesRead() const { return bytes_read_; }
+
+ private:
+  absl::Status ReadFooter(Env* env);
+
+  // Decodes the projected columns of row group `index`.
+  absl::Status ReadRowGroup(int64_t index);
+
+  // Decodes the column of component `component` into `tensors`.
+  absl::Status ReadColumn(
+      int64_t component, int64_t num_elements,
+      const experimental::ColumnarChunkFooter::Column& column,
+      std::vector<Tensor>& tensors);
+
+  // Returns `size` bytes of the file at `offset`. `scratch` holds the bytes if
+  // the file is not memory-mapped.
+  absl::StatusOr<absl::string_view> Read(uint64_t offset, uint64_t size,
+                                         std::string& scratch);
+
+  const std::string filename_;
+  const DataTypeVector dtypes_;
+  std::vector<int64_t> projection_;
+
+  // The memory-mapped file, or nullptr if the file system does not support
+  // memory mapping, in which case columns are read from `file_`.
+  std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  std::unique_ptr<RandomAccessFile> file_;
+  experimental::ColumnarChunkFooter footer_;
+
+  // Index of the next row group to decode.
+  int64_t next_row_group_ = 0;
+  // Projected components of the decoded row group: `columns_[i][j]` is
+  // component `projection_[i]` of element `j`.
+  std::vector<std::vector<Tensor>> columns_;
+  int64_t row_group_num_elements_ = 0;
+  // Index of the next element of the decoded row group.
+  int64_t next_element_ = 0;
+  uint64_t bytes_read_ = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_COLUMNAR_CHUNK_H_
@@ -0,0 +1,222 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/snapshot/columnar_chunk.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/status_matchers.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/tstring.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tsl::testing::IsOkAndHolds;
+using ::tsl::testing::StatusIs;
+
+std::string LocalTempFilename() {
+  std::string path;
+  CHECK(Env::Default()->LocalTempFilename(&path));
+  return path;
+}
+
+// Returns an element with an int64 counter, a string, a float vector, and an
+// int32 vector whose length varies.
+std::vector<Tensor> TestElement(int64_t i) {
+  std::vector<int32_t> ragged(i % 3, static_cast<int32_t>(i));
+  return {test::AsScalar<int64_t>(100 + i),
+          test::AsScalar<tstring>(i % 2 == 0 ? "even" : "odd"),
+          test::AsTensor<float>({i * 0.5f, i * 1.5f}),
+          test::AsTensor<int32_t>(ragged)};
+}
+
+const DataTypeVector& TestDtypes() {
+  static const DataTypeVector* dtypes =
+      new DataTypeVector{DT_INT64, DT_STRING, DT_FLOAT, DT_INT32};
+  return *dtypes;
+}
+
+absl::Status WriteChunk(const std::string& filename, int64_t num_elements,
+                        int64_t row_group_size_bytes) {
+  ColumnarChunkWriter writer(filename, row_group_size_bytes);
+  TF_RETURN_IF_ERROR(writer.Initialize(Env::Default()));
+  for (int64_t i = 0; i < num_elements; ++i) {
+    TF_RETURN_IF_ERROR(writer.WriteTensors(TestElement(i)));
+  }
+  return writer.Close();
+}
+
+void ExpectElement(const std::vector<Tensor>& element, int64_t i) {
+  std::vector<Tensor> expected = TestElement(i);
+  ASSERT_EQ(element.size(), expected.size());
+  for (size_t j = 0; j < element.size(); ++j) {
+    test::ExpectEqual(element[j], expected[j]);
+  }
+}
+
+using ColumnarChunkTest = ::testing::TestWithParam<int64_t>;
+
+TEST_P(ColumnarChunkTest, ReadWrite) {
+  const int64_t row_group_size_bytes = GetParam();
+  const std::string filename = LocalTempFilename();
+  TF_ASSERT_OK(WriteChunk(filename, /*num_elements=*/100,
+                          row_group_size_bytes));
+
+  ColumnarChunkReader reader(filename, TestDtypes());
+  TF_ASSERT_OK(reader.Initialize(Env::Default()));
+  EXPECT_EQ(reader.num_elements(), 100);
+  for (int64_t i = 0; i < 100; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(reader.ReadTensors(&element));
+    ExpectElement(element, i);
+  }
+  std::vector<Tensor> element;
+  EXPECT_THAT(reader.ReadTensors(&element),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_GT(reader.BytesRead(), 0);
+}
+
+TEST_P(ColumnarChunkTest, Projection) {
+  const std::string filename = LocalTempFilename();
+  TF_ASSERT_OK(WriteChunk(filename, /*num_elements=*/10, GetParam()));
+
+  ColumnarChunkReader reader(filename, TestDtypes(), /*projection=*/{3, 0});
+  TF_ASSERT_OK(reader.Initialize(Env::Default()));
+  for (int64_t i = 0; i < 10; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(reader.ReadTensors(&element));
+    std::vector<Tensor> expected = TestElement(i);
+    ASSERT_EQ(element.size(), 2);
+    test::ExpectEqual(element[0], expected[3]);
+    test::ExpectEqual(element[1], expected[0]);
+  }
+}
+
+TEST_P(ColumnarChunkTest, SkipRecords) {
+  const std::string filename = LocalTempFilename();
+  TF_ASSERT_OK(WriteChunk(filename, /*num_elements=*/20, GetParam()));
+
+  ColumnarChunkReader reader(filename, TestDtypes());
+  TF_ASSERT_OK(reader.Initialize(Env::Default()));
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(reader.SkipRecords(5));
+  TF_ASSERT_OK(reader.ReadTensors(&element));
+  ExpectElement(element, 5);
+  TF_ASSERT_OK(reader.SkipRecords(10));
+  TF_ASSERT_OK(reader.ReadTensors(&element));
+  ExpectElement(element, 16);
+  EXPECT_THAT(reader.SkipRecords(10), StatusIs(absl::StatusCode::kOutOfRange));
+}
+
+INSTANTIATE_TEST_SUITE_P(RowGroupSizes, ColumnarChunkTest,
+                         ::testing::Values(1, 100, kDefaultRowGroupSizeBytes));
+
+TEST(ColumnarChunkTest, EmptyChunk) {
+  const std::string filename = LocalTempFilename();
+  TF_ASSERT_OK(WriteChunk(filename, /*num_elements=*/0,
+                          kDefaultRowGroupSizeBytes));
+
+  ColumnarChunkReader reader(filename, TestDtypes());
+  TF_ASSERT_OK(reader.Initialize(Env::Default()));
+  EXPECT_EQ(reader.num_elements(), 0);
+  std::vector<Tensor> element;
+  EXPECT_THAT(reader.ReadTensors(&element),
+              StatusIs(absl::StatusCode::kOutOfRange));
+}
+
+TEST(ColumnarChunkTest, CompressesIntegersAndStrings) {
+  const std::string filename = LocalTempFilename();
+  ColumnarChunkWriter writer(filename);
+  TF_ASSERT_OK(writer.Initialize(Env::Default()));
+  for (int64_t i = 0; i < 10000; ++i) {
+    TF_ASSERT_OK(writer.WriteTensors(
+        {test::AsScalar<int64_t>(i), test::AsScalar<tstring>("label")}));
+  }
+  TF_ASSERT_OK(writer.Close());
+
+  // The raw columns would take 10000 * 8 bytes and 10000 * 6 bytes.
+  uint64_t file_size = 0;
+  TF_ASSERT_OK(Env::Default()->GetFileSize(filename, &file_size));
+  EXPECT_LT(file_size, 10000 * 3);
+
+  ColumnarChunkReader reader(filename, {DT_INT64, DT_STRING});
+  TF_ASSERT_OK(reader.Initialize(Env::Default()));
+  for (int64_t i = 0; i < 10000; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(reader.ReadTensors(&element));
+    test::ExpectEqual(element[0], test::AsScalar<int64_t>(i));
+    test::ExpectEqual(element[1], test::AsScalar<tstring>("label"));
+  }
+}
+
+TEST(ColumnarChunkTest, IsColumnarChunk) {
+  const std::string columnar_filename = LocalTempFilename();
+  TF_ASSERT_OK(WriteChunk(columnar_filename, /*num_elements=*/1,
+                          kDefaultRowGroupSizeBytes));
+  EXPECT_THAT(IsColumnarChunk(columnar_filename, Env::Default()),
+              IsOkAndHolds(true));
+
+  const std::string tfrecord_filename = LocalTempFilename();
+  snapshot_util::TFRecordWriter tfrecord_writer(tfrecord_filename,
+                                                /*compression_type=*/"");
+  TF_ASSERT_OK(tfrecord_writer.Initialize(Env::Default()));
+  TF_ASSERT_OK(tfrecord_writer.WriteTensors(TestElement(0)));
+  TF_ASSERT_OK(tfrecord_writer.Close());
+  EXPECT_THAT(IsColumnarChunk(tfrecord_filename, Env::Default()),
+              IsOkAndHolds(false));
+}
+
+TEST(ColumnarChunkTest, InconsistentElements) {
+  ColumnarChunkWriter writer(LocalTempFilename());
+  TF_ASSERT_OK(writer.Initialize(Env::Default()));
+  TF_ASSERT_OK(writer.WriteTensors({test::AsScalar<int64_t>(0)}));
+  EXPECT_THAT(writer.WriteTensors({test::AsScalar<int32_t>(0)}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(writer.WriteTensors(
+                  {test::AsScalar<int64_t>(0), test::AsScalar<int64_t>(0)}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ColumnarChunkTest, WrongDtypes) {
+  const std::string filename = LocalTempFilename();
+  TF_ASSERT_OK(WriteChunk(filename, /*num_elements=*/1,
+                          kDefaultRowGroupSizeBytes));
+  ColumnarChunkReader reader(filename, {DT_INT64});
+  EXPECT_THAT(reader.Initialize(Env::Default()),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ColumnarChunkTest, ProjectionOutOfRange) {
+  const std::string filename = LocalTempFilename();
+  TF_ASSERT_OK(WriteChunk(filename, /*num_elements=*/1,
+                          kDefaultRowGroupSizeBytes));
+  ColumnarChunkReader reader(filename, TestDtypes(), /*projection=*/{4});
+  EXPECT_THAT(reader.Initialize(Env::Default()),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -21,6 +21,7 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/service/snapshot/columnar_chunk.h"
 #include "tensorflow/core/data/snapshot_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/path.h"
+#include "tsl/platform/statusor.h"
 #include "tsl/platform/tstring.h"
 
 namespace tensorflow {
@@ -128,10 +130,24 @@ class SnapshotChunkDatasetOp::Dataset : public DatasetBase {
     ~Iterator() override { RecordBytesRead(); }
 
     absl::Status Initialize(IteratorContext* ctx) override {
-      reader_ = std::make_unique<snapshot_util::TFRecordReader>(
-          TranslateFileName(dataset()->chunk_file_), dataset()->compression_,
-          dataset()->dtypes_, kTFRecordReaderOutputBufferSize);
-      return reader_->Initialize(ctx->env());
+      // Chunks are either TFRecord files or columnar chunks, depending on how
+      // the snapshot was written.
+      const std::string chunk_file = TranslateFileName(dataset()->chunk_file_);
+      TF_ASSIGN_OR_RETURN(bool columnar,
+                          IsColumnarChunk(chunk_file, ctx->env()));
+      if (columnar) {
+        columnar_reader_ = std::make_unique<ColumnarChunkReader>(
+            chunk_file, dataset()->dtypes_);
+        TF_RETURN_IF_ERROR(columnar_reader_->Initialize(ctx->env()));
+        reader_ = columnar_reader_.get();
+        return absl::OkStatus();
+      }
+      tfrecord_reader_ = std::make_unique<snapshot_util::TFRecordReader>(
+          chunk_file, dataset()->compression_, dataset()->dtypes_,
+          kTFRecordReaderOutputBufferSize);
+      TF_RETURN_IF_ERROR(tfrecord_reader_->Initialize(ctx->env()));
+      reader_ = tfrecord_reader_.get();
+      return absl::OkStatus();
     }
 
    protected:
@@ -167,24 +183,28 @@ class SnapshotChunkDatasetOp::Dataset : public DatasetBase {
     }
 
    private:
-    // TODO(b/250921378): Optimize this to not parse every single element. We
-    // may consider switching the data format to ArrayRecords so we can use the
-    // index to jump straight to the starting record.
+    // TODO(b/250921378): Optimize this to not parse every single element of
+    // TFRecord chunks. Columnar chunks skip whole row groups without decoding
+    // them.
     absl::Status AdvanceToStartIndex(IteratorContext* ctx) {
-      for (int64_t i = 0; i < start_index_; ++i) {
-        std::vector<Tensor> unused;
-        TF_RETURN_IF_ERROR(reader_->ReadTensors(&unused));
-      }
-      return absl::OkStatus();
+      return reader_->SkipRecords(start_index_);
     }
 
     void RecordBytesRead() {
-      uint64_t bytes_read = reader_->BytesRead();
+      uint64_t bytes_read = 0;
+      if (tfrecord_reader_ != nullptr) {
+        bytes_read = tfrecord_reader_->BytesRead();
+      } else if (columnar_reader_ != nullptr) {
+        bytes_read = columnar_reader_->BytesRead();
+      }
       metrics::GetTFDataBytesReadCounter(kSnapshotChunkDataset)
           ->IncrementBy(bytes_read);
     }
 
-    std::unique_ptr<snapshot_util::TFRecordReader> reader_;
+    std::unique_ptr<snapshot_util::TFRecordReader> tfrecord_reader_;
+    std::unique_ptr<ColumnarChunkReader> columnar_reader_;
+    // The reader of the chunk, i.e. one of the readers above.
+    snapshot_util::Reader* reader_ = nullptr;
     int64_t start_index_ = 0;
   };
 
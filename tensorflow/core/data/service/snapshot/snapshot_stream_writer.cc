@@ -30,6 +30,7 @@ limitations under the License.
 #include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
 #include "tensorflow/core/data/service/common.h"
+#include "tensorflow/core/data/service/snapshot/columnar_chunk.h"
 #include "tensorflow/core/data/service/snapshot/file_utils.h"
 #include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/service/snapshot/utils.h"
@@ -146,13 +147,22 @@ absl::Status SnapshotStreamWriter::WriteChunk() {
   std::string uncommitted_chunk_file_path =
       tsl::io::JoinPath(params_.UncommittedChunksDirectory(),
                         absl::StrCat("chunk_", chunk_index_));
-  snapshot_util::TFRecordWriter writer(
-      TranslateFileName(uncommitted_chunk_file_path), params_.compression);
-  TF_RETURN_IF_ERROR(writer.Initialize(params_.env));
+  std::unique_ptr<snapshot_util::Writer> writer;
+  if (params_.columnar_chunks) {
+    auto columnar_writer = std::make_unique<ColumnarChunkWriter>(
+        TranslateFileName(uncommitted_chunk_file_path));
+    TF_RETURN_IF_ERROR(columnar_writer->Initialize(params_.env));
+    writer = std::move(columnar_writer);
+  } else {
+    auto tfrecord_writer = std::make_unique<snapshot_util::TFRecordWriter>(
+        TranslateFileName(uncommitted_chunk_file_path), params_.compression);
+    TF_RETURN_IF_ERROR(tfrecord_writer->Initialize(params_.env));
+    writer = std::move(tfrecord_writer);
+  }
   while (ShouldWriteRecord()) {
-    TF_RETURN_IF_ERROR(WriteRecord(writer));
+    TF_RETURN_IF_ERROR(WriteRecord(*writer));
   }
-  TF_RETURN_IF_ERROR(writer.Close());
+  TF_RETURN_IF_ERROR(writer->Close());
   chunk_file_to_num_elements_[absl::StrCat("chunk_", chunk_index_)] =
       chunk_num_elements_;
   if (ShouldCommit()) {
@@ -218,8 +228,7 @@ bool SnapshotStreamWriter::ShouldWriteRecord() const TF_LOCKS_EXCLUDED(mu_) {
          !end_of_sequence_ && completed_.ok();
 }
 
-absl::Status SnapshotStreamWriter::WriteRecord(
-    snapshot_util::TFRecordWriter& writer) {
+absl::Status SnapshotStreamWriter::WriteRecord(snapshot_util::Writer& writer) {
   std::vector<Tensor> element;
   TF_RETURN_IF_ERROR(iterator_->GetNext(element, end_of_sequence_));
   if (end_of_sequence_) {
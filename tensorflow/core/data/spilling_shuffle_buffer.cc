@@ -0,0 +1,350 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/spilling_shuffle_buffer.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kMemory[] = "memory";
+constexpr char kPending[] = "pending";
+constexpr char kChunk[] = "chunk";
+constexpr char kNumChunks[] = "num_chunks";
+constexpr char kNumElements[] = "num_elements";
+constexpr char kFilename[] = "filename";
+constexpr char kOffset[] = "offset";
+
+// Returns a number in [0, n) drawn from two 32-bit samples of `generator`.
+template <typename Generator>
+uint64 Uniform(Generator& generator, uint64 n) {
+  const uint64 hi = generator();
+  const uint64 lo = generator();
+  return ((hi << 32) | lo) % n;
+}
+
+Status ReadSpilledElement(io::RecordReader& reader, uint64* offset,
+                          std::vector<Tensor>* element) {
+  tstring record;
+  TF_RETURN_IF_ERROR(reader.ReadRecord(offset, &record));
+  CompressedElement compressed;
+  if (!compressed.ParseFromArray(record.data(), record.size())) {
+    return errors::DataLoss(
+        "Failed to parse an element spilled by the shuffle buffer.");
+  }
+  element->clear();
+  return UncompressElement(compressed, element);
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<SpillingShuffleBuffer>> SpillingShuffleBuffer::Create(
+    Env* env, const Options& options) {
+  if (options.spill_directory.empty()) {
+    return errors::InvalidArgument(
+        "A spilling shuffle buffer requires a spill directory.");
+  }
+  if (options.chunk_size_bytes <= 0) {
+    return errors::InvalidArgument(
+        "The chunk size of a spilling shuffle buffer must be positive, got ",
+        options.chunk_size_bytes, ".");
+  }
+  std::string directory =
+      io::JoinPath(options.spill_directory,
+                   absl::StrCat("shuffle_buffer_", env->NowMicros(), "_",
+                                random::New64()));
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(directory));
+  return absl::WrapUnique(
+      new SpillingShuffleBuffer(env, options, std::move(directory)));
+}
+
+SpillingShuffleBuffer::SpillingShuffleBuffer(Env* env, const Options& options,
+                                             std::string directory)
+    : env_(env), options_(options), directory_(std::move(directory)) {}
+
+SpillingShuffleBuffer::~SpillingShuffleBuffer() {
+  ReleaseMemory(memory_bytes_);
+  chunks_.clear();
+  int64_t undeleted_files = 0;
+  int64_t undeleted_dirs = 0;
+  Status s =
+      env_->DeleteRecursively(directory_, &undeleted_files, &undeleted_dirs);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to delete shuffle buffer spill directory "
+                 << directory_ << ": " << s;
+  }
+}
+
+Status SpillingShuffleBuffer::Push(std::vector<Tensor> element, uint64 seed) {
+  random::PhiloxRandom philox(seed);
+  Generator generator(&philox);
+  TF_RETURN_IF_ERROR(SpillOverBudget(generator));
+  const int64_t bytes = GetTotalBytes(element);
+  if (ReserveMemory(bytes)) {
+    memory_bytes_ += bytes;
+    memory_.push_back(std::move(element));
+    return OkStatus();
+  }
+  return AddToPending(std::move(element), generator);
+}
+
+Status SpillingShuffleBuffer::Pop(uint64 seed, std::vector<Tensor>* element) {
+  DCHECK_GT(size(), 0);
+  random::PhiloxRandom philox(seed);
+  Generator generator(&philox);
+  TF_RETURN_IF_ERROR(SpillOverBudget(generator));
+  uint64 index = Uniform(generator, size());
+  if (index < memory_.size()) {
+    std::swap(memory_[index], memory_.back());
+    *element = std::move(memory_.back());
+    memory_.pop_back();
+    const int64_t bytes = GetTotalBytes(*element);
+    memory_bytes_ -= bytes;
+    ReleaseMemory(bytes);
+    return OkStatus();
+  }
+  index -= memory_.size();
+  if (index < pending_.size()) {
+    std::swap(pending_[index], pending_.back());
+    *element = std::move(pending_.back());
+    pending_.pop_back();
+    pending_bytes_ -= GetTotalBytes(*element);
+    return OkStatus();
+  }
+  index -= pending_.size();
+  for (auto it = chunks_.begin(); it != chunks_.end(); ++it) {
+    if (index >= static_cast<uint64>(it->num_elements)) {
+      index -= it->num_elements;
+      continue;
+    }
+    TF_RETURN_IF_ERROR(ReadSpilledElement(*it->reader, &it->offset, element));
+    --it->num_elements;
+    --num_spilled_elements_;
+    if (it->num_elements == 0) {
+      const std::string filename = it->filename;
+      chunks_.erase(it);
+      TF_RETURN_IF_ERROR(env_->DeleteFile(filename));
+    }
+    return OkStatus();
+  }
+  return errors::Internal("Shuffle buffer index ", index,
+                          " is out of range for ", size(), " elements.");
+}
+
+Status SpillingShuffleBuffer::Save(IteratorStateWriter* writer,
+                                   const std::string& key_prefix) {
+  TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+      writer, absl::StrCat(key_prefix, kColon, kMemory), memory_));
+  TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+      writer, absl::StrCat(key_prefix, kColon, kPending), pending_));
+  TF_RETURN_IF_ERROR(
+      writer->WriteScalar(key_prefix, kNumChunks, chunks_.size()));
+  if (chunks_.empty()) {
+    return OkStatus();
+  }
+  // The chunks are deleted as they drain, so the checkpoint refers to copies
+  // of them rather than to the chunks themselves.
+  const std::string checkpoint_directory =
+      io::JoinPath(options_.spill_directory,
+                   absl::StrCat("checkpoint_", env_->NowMicros(), "_",
+                                random::New64()));
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(checkpoint_directory));
+  int64_t chunk_index = 0;
+  for (const Chunk& chunk : chunks_) {
+    const std::string chunk_prefix =
+        absl::StrCat(key_prefix, kColon, kChunk, "_", chunk_index);
+    const std::string filename = io::JoinPath(
+        checkpoint_directory, absl::StrCat(kChunk, "_", chunk_index++));
+    TF_RETURN_IF_ERROR(env_->CopyFile(chunk.filename, filename));
+    TF_RETURN_IF_ERROR(writer->WriteScalar(chunk_prefix, kFilename, filename));
+    TF_RETURN_IF_ERROR(writer->WriteScalar(
+        chunk_prefix, kOffset, static_cast<int64_t>(chunk.offset)));
+    TF_RETURN_IF_ERROR(
+        writer->WriteScalar(chunk_prefix, kNumElements, chunk.num_elements));
+  }
+  return OkStatus();
+}
+
+Status SpillingShuffleBuffer::Restore(IteratorContext* ctx,
+                                      IteratorStateReader* reader,
+                                      const std::string& key_prefix) {
+  DCHECK_EQ(size(), 0);
+  std::vector<std::vector<Tensor>> memory;
+  TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+      ctx, reader, absl::StrCat(key_prefix, kColon, kMemory), &memory));
+  TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+      ctx, reader, absl::StrCat(key_prefix, kColon, kPending), &pending_));
+  for (const auto& element : pending_) {
+    pending_bytes_ += GetTotalBytes(element);
+  }
+  // The saved in-memory elements keep their positions as long as they still
+  // fit in memory; the others join the pending chunk.
+  for (auto& element : memory) {
+    const int64_t bytes = GetTotalBytes(element);
+    if (ReserveMemory(bytes)) {
+      memory_bytes_ += bytes;
+      memory_.push_back(std::move(element));
+    } else {
+      pending_bytes_ += bytes;
+      pending_.push_back(std::move(element));
+    }
+  }
+
+  int64_t num_chunks;
+  TF_RETURN_IF_ERROR(reader->ReadScalar(key_prefix, kNumChunks, &num_chunks));
+  for (int64_t chunk_index = 0; chunk_index < num_chunks; ++chunk_index) {
+    const std::string chunk_prefix =
+        absl::StrCat(key_prefix, kColon, kChunk, "_", chunk_index);
+    tstring saved_filename;
+    int64_t offset;
+    int64_t num_elements;
+    TF_RETURN_IF_ERROR(
+        reader->ReadScalar(chunk_prefix, kFilename, &saved_filename));
+    TF_RETURN_IF_ERROR(reader->ReadScalar(chunk_prefix, kOffset, &offset));
+    TF_RETURN_IF_ERROR(
+        reader->ReadScalar(chunk_prefix, kNumElements, &num_elements));
+    Status s = env_->FileExists(saved_filename);
+    if (!s.ok()) {
+      return errors::FailedPrecondition(
+          "Failed to restore the shuffle buffer: its spilled chunk ",
+          saved_filename, " is not available (", s.message(),
+          "). A checkpoint of a spilling shuffle buffer refers to copies of its "
+          "chunks in the spill directory, and can only be restored where "
+          "those copies are kept.");
+    }
+    // The restored chunk is drained and deleted, so it is read from a copy
+    // that leaves the checkpoint restorable.
+    std::string filename = NewChunkFilename();
+    TF_RETURN_IF_ERROR(env_->CopyFile(saved_filename, filename));
+    TF_RETURN_IF_ERROR(AddChunk(std::move(filename), offset, num_elements));
+  }
+  return OkStatus();
+}
+
+bool SpillingShuffleBuffer::ReserveMemory(int64_t bytes) {
+  if (options_.max_in_memory_elements >= 0 &&
+      static_cast<int64_t>(memory_.size()) >=
+          options_.max_in_memory_elements) {
+    return false;
+  }
+  return !options_.ram_budget_manager ||
+         options_.ram_budget_manager->RequestSpillableBytes(bytes);
+}
+
+void SpillingShuffleBuffer::ReleaseMemory(int64_t bytes) {
+  if (options_.ram_budget_manager) {
+    options_.ram_budget_manager->RequestSpillableBytes(-bytes);
+  }
+}
+
+Status SpillingShuffleBuffer::SpillOverBudget(Generator& generator) {
+  if (!options_.ram_budget_manager) {
+    return OkStatus();
+  }
+  // Other buffers share the spillable budget, so the excess is checked again
+  // after each element.
+  while (!memory_.empty() &&
+         options_.ram_budget_manager->SpillableBytesOverBudget() > 0) {
+    std::swap(memory_[Uniform(generator, memory_.size())], memory_.back());
+    std::vector<Tensor> element = std::move(memory_.back());
+    memory_.pop_back();
+    const int64_t bytes = GetTotalBytes(element);
+    memory_bytes_ -= bytes;
+    ReleaseMemory(bytes);
+    TF_RETURN_IF_ERROR(AddToPending(std::move(element), generator));
+  }
+  return OkStatus();
+}
+
+Status SpillingShuffleBuffer::AddToPending(std::vector<Tensor> element,
+                                           Generator& generator) {
+  pending_bytes_ += GetTotalBytes(element);
+  pending_.push_back(std::move(element));
+  if (pending_bytes_ < options_.chunk_size_bytes) {
+    return OkStatus();
+  }
+  return SpillPending(generator);
+}
+
+Status SpillingShuffleBuffer::SpillPending(Generator& generator) {
+  for (int64_t i = pending_.size() - 1; i > 0; --i) {
+    std::swap(pending_[i], pending_[Uniform(generator, i + 1)]);
+  }
+  TF_RETURN_IF_ERROR(WriteChunk(
+      pending_.size(), [this](int64_t index, std::vector<Tensor>* element) {
+        *element = std::move(pending_[index]);
+        return OkStatus();
+      }));
+  pending_.clear();
+  pending_bytes_ = 0;
+  return OkStatus();
+}
+
+Status SpillingShuffleBuffer::WriteChunk(
+    int64_t num_elements,
+    const std::function<Status(int64_t, std::vector<Tensor>*)>& get_element) {
+  std::string filename = NewChunkFilename();
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env_->NewWritableFile(filename, &file));
+  io::RecordWriter writer(file.get());
+  std::vector<Tensor> element;
+  for (int64_t i = 0; i < num_elements; ++i) {
+    TF_RETURN_IF_ERROR(get_element(i, &element));
+    CompressedElement compressed;
+    TF_RETURN_IF_ERROR(CompressElement(element, &compressed));
+    TF_RETURN_IF_ERROR(writer.WriteRecord(compressed.SerializeAsString()));
+  }
+  TF_RETURN_IF_ERROR(writer.Close());
+  TF_RETURN_IF_ERROR(file->Close());
+  return AddChunk(std::move(filename), /*offset=*/0, num_elements);
+}
+
+Status SpillingShuffleBuffer::AddChunk(std::string filename, uint64 offset,
+                                       int64_t num_elements) {
+  Chunk chunk;
+  chunk.filename = std::move(filename);
+  chunk.offset = offset;
+  chunk.num_elements = num_elements;
+  TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(chunk.filename, &chunk.file));
+  chunk.reader = std::make_unique<io::RecordReader>(chunk.file.get());
+  num_spilled_elements_ += num_elements;
+  chunks_.push_back(std::move(chunk));
+  return OkStatus();
+}
+
+std::string SpillingShuffleBuffer::NewChunkFilename() {
+  return io::JoinPath(directory_,
+                      absl::StrCat(kChunk, "_", next_chunk_index_++));
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,196 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SPILLING_SHUFFLE_BUFFER_H_
+#define TENSORFLOW_CORE_DATA_SPILLING_SHUFFLE_BUFFER_H_
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A shuffle buffer that keeps part of its elements in memory and spills the
+// rest to local disk.
+//
+// Elements are kept in memory while there is room for them, i.e. while there
+// are fewer than `max_in_memory_elements` in memory and the RAM budget manager
+// (if any) grants their bytes. The other elements are collected into a pending
+// chunk, which is shuffled and written to its own file of snappy-compressed
+// records once it reaches `chunk_size_bytes`. Each pop picks one of the
+// buffered elements uniformly at random across memory, the pending chunk and
+// the spilled chunks; an element of a spilled chunk is popped by reading the
+// next record of that chunk, which is uniform because the chunk was shuffled
+// before it was written.
+//
+// When the RAM budget manager reports that the in-memory elements no longer fit
+// in the budget, e.g. because the autotuner grew the other buffers of the
+// pipeline, the next `Push()` or `Pop()` moves random in-memory elements to the
+// pending chunk until the excess bytes are released.
+//
+// All random choices are derived from the seeds passed to `Push()` and `Pop()`,
+// so that an iterator that restores a saved buffer and passes the same seeds
+// produces the same elements.
+//
+// This class is not thread-safe.
+class SpillingShuffleBuffer {
+ public:
+  struct Options {
+    // Directory in which the buffer creates its own subdirectory for the
+    // spilled chunks. The subdirectory is deleted with the buffer. `Save()`
+    // also copies the spilled chunks to a new `checkpoint_*` subdirectory,
+    // which is kept for the checkpoint to refer to.
+    std::string spill_directory;
+    // Maximum number of elements kept in memory, or -1 for no limit other than
+    // the RAM budget.
+    int64_t max_in_memory_elements = -1;
+    // Spilled elements are written to disk in chunks of about this many bytes
+    // of uncompressed tensor data.
+    int64_t chunk_size_bytes = 64 << 20;
+    // If set, the bytes of the in-memory elements are requested from the
+    // manager as spillable bytes.
+    std::shared_ptr<model::RamBudgetManager> ram_budget_manager;
+  };
+
+  // Creates an empty buffer and its subdirectory of `spill_directory`.
+  static StatusOr<std::unique_ptr<SpillingShuffleBuffer>> Create(
+      Env* env, const Options& options);
+
+  // Deletes the spilled chunks and returns the bytes of the in-memory elements
+  // to the RAM budget manager.
+  ~SpillingShuffleBuffer();
+
+  SpillingShuffleBuffer(const SpillingShuffleBuffer&) = delete;
+  SpillingShuffleBuffer& operator=(const SpillingShuffleBuffer&) = delete;
+
+  // Adds `element` to the buffer. `seed` seeds the random choices made by the
+  // call.
+  Status Push(std::vector<Tensor> element, uint64 seed);
+
+  // Removes an element chosen uniformly at random from the buffer and stores
+  // it in `element`. `seed` seeds the random choices made by the call.
+  //
+  // REQUIRES: size() > 0
+  Status Pop(uint64 seed, std::vector<Tensor>* element);
+
+  // The total number of buffered elements.
+  int64_t size() const {
+    return memory_.size() + pending_.size() + num_spilled_elements_;
+  }
+
+  // The number of elements held in memory, outside of the pending chunk.
+  int64_t num_in_memory_elements() const { return memory_.size(); }
+
+  // The number of elements in the pending chunk and the spilled chunks.
+  int64_t num_spilled_elements() const {
+    return pending_.size() + num_spilled_elements_;
+  }
+
+  // Writes the buffered elements, in a layout from which `Restore()` rebuilds
+  // the buffer with every element at the same position. The spilled chunks are
+  // not written to `writer`: they are copied to a new subdirectory of the spill
+  // directory, and `writer` records the names of the copies.
+  Status Save(IteratorStateWriter* writer, const std::string& key_prefix);
+
+  // Restores the elements saved by `Save()` into this buffer, which must be
+  // empty. Returns a `FailedPrecondition` error if the chunk copies made by
+  // `Save()` no longer exist, e.g. because the checkpoint is restored on
+  // another machine.
+  Status Restore(IteratorContext* ctx, IteratorStateReader* reader,
+                 const std::string& key_prefix);
+
+ private:
+  using Generator = random::SingleSampleAdapter<random::PhiloxRandom>;
+
+  // A shuffled chunk of spilled elements, of which the elements from byte
+  // `offset` on have not been popped yet. The chunk stays open for as long as
+  // it has elements. Its reader is unbuffered, so that each pop reads one
+  // record with positional reads however the draws interleave the chunks.
+  struct Chunk {
+    std::string filename;
+    uint64 offset = 0;
+    int64_t num_elements = 0;
+    std::unique_ptr<RandomAccessFile> file;
+    std::unique_ptr<io::RecordReader> reader;
+  };
+
+  SpillingShuffleBuffer(Env* env, const Options& options,
+                        std::string directory);
+
+  // Returns whether an element of `bytes` bytes can be added to `memory_`, in
+  // which case its bytes have been granted by the RAM budget manager.
+  bool ReserveMemory(int64_t bytes);
+  void ReleaseMemory(int64_t bytes);
+
+  // Moves random in-memory elements to the pending chunk until the bytes that
+  // the RAM budget manager reports over budget are released.
+  Status SpillOverBudget(Generator& generator);
+
+  // Adds `element` to the pending chunk, and writes the chunk to disk if it is
+  // full.
+  Status AddToPending(std::vector<Tensor> element, Generator& generator);
+
+  // Shuffles the pending chunk and writes it to disk.
+  Status SpillPending(Generator& generator);
+
+  // Writes a new chunk of `num_elements` elements, the i-th of which is
+  // produced by `get_element(i, element)`.
+  Status WriteChunk(
+      int64_t num_elements,
+      const std::function<Status(int64_t, std::vector<Tensor>*)>& get_element);
+
+  // Opens the chunk in `filename` and adds it to `chunks_`, with its next
+  // element at byte `offset`.
+  Status AddChunk(std::string filename, uint64 offset, int64_t num_elements);
+
+  // Returns the name of a new chunk file in `directory_`.
+  std::string NewChunkFilename();
+
+  Env* const env_;
+  const Options options_;
+  const std::string directory_;
+
+  std::vector<std::vector<Tensor>> memory_;
+  // Bytes of the elements in `memory_`.
+  int64_t memory_bytes_ = 0;
+
+  std::vector<std::vector<Tensor>> pending_;
+  // Bytes of the elements in `pending_`.
+  int64_t pending_bytes_ = 0;
+
+  std::list<Chunk> chunks_;
+  // Number of elements left in `chunks_`.
+  int64_t num_spilled_elements_ = 0;
+  int64_t next_chunk_index_ = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SPILLING_SHUFFLE_BUFFER_H_
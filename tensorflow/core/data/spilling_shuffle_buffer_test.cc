@@ -0,0 +1,279 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/spilling_shuffle_buffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/test_utils.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tsl/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::testing::SizeIs;
+using ::testing::UnorderedElementsAreArray;
+
+// Each element is a single int64 scalar, i.e. 8 bytes.
+constexpr int64_t kElementBytes = 8;
+
+std::string SpillDirectory() {
+  std::string directory = io::JoinPath(testing::TmpDir(), "spill");
+  TF_CHECK_OK(Env::Default()->RecursivelyCreateDir(directory));
+  return directory;
+}
+
+std::vector<std::string> SpillDirectoryChildren(const std::string& directory) {
+  std::vector<std::string> children;
+  TF_CHECK_OK(Env::Default()->GetChildren(directory, &children));
+  return children;
+}
+
+std::unique_ptr<SpillingShuffleBuffer> CreateBuffer(
+    const SpillingShuffleBuffer::Options& options) {
+  auto buffer = SpillingShuffleBuffer::Create(Env::Default(), options);
+  TF_CHECK_OK(buffer.status());
+  return std::move(buffer).value();
+}
+
+std::vector<int64_t> PopAll(SpillingShuffleBuffer& buffer, uint64 seed) {
+  std::vector<int64_t> values;
+  while (buffer.size() > 0) {
+    std::vector<Tensor> element;
+    TF_CHECK_OK(buffer.Pop(seed++, &element));
+    CHECK_EQ(element.size(), 1);
+    values.push_back(element[0].scalar<int64_t>()());
+  }
+  return values;
+}
+
+std::vector<int64_t> Range(int64_t n) {
+  std::vector<int64_t> values(n);
+  for (int64_t i = 0; i < n; ++i) {
+    values[i] = i;
+  }
+  return values;
+}
+
+TEST(SpillingShuffleBufferTest, PopsEveryElementOnce) {
+  SpillingShuffleBuffer::Options options;
+  options.spill_directory = SpillDirectory();
+  options.max_in_memory_elements = 10;
+  options.chunk_size_bytes = 7 * kElementBytes;
+  auto buffer = CreateBuffer(options);
+  for (int64_t i = 0; i < 100; ++i) {
+    TF_ASSERT_OK(buffer->Push({test::AsScalar<int64_t>(i)}, /*seed=*/i));
+  }
+  EXPECT_EQ(buffer->size(), 100);
+  EXPECT_EQ(buffer->num_in_memory_elements(), 10);
+  EXPECT_EQ(buffer->num_spilled_elements(), 90);
+
+  std::vector<int64_t> values = PopAll(*buffer, /*seed=*/1000);
+  EXPECT_THAT(values, UnorderedElementsAreArray(Range(100)));
+  EXPECT_NE(values, Range(100));
+}
+
+TEST(SpillingShuffleBufferTest, InterleavedPushAndPop) {
+  SpillingShuffleBuffer::Options options;
+  options.spill_directory = SpillDirectory();
+  options.max_in_memory_elements = 4;
+  options.chunk_size_bytes = 3 * kElementBytes;
+  auto buffer = CreateBuffer(options);
+  std::vector<int64_t> values;
+  for (int64_t i = 0; i < 200; ++i) {
+    TF_ASSERT_OK(buffer->Push({test::AsScalar<int64_t>(i)}, /*seed=*/i));
+    if (buffer->size() > 20) {
+      std::vector<Tensor> element;
+      TF_ASSERT_OK(buffer->Pop(/*seed=*/i, &element));
+      values.push_back(element[0].scalar<int64_t>()());
+    }
+  }
+  std::vector<int64_t> rest = PopAll(*buffer, /*seed=*/1000);
+  values.insert(values.end(), rest.begin(), rest.end());
+  EXPECT_THAT(values, UnorderedElementsAreArray(Range(200)));
+}
+
+TEST(SpillingShuffleBufferTest, ReadsInterleavedChunks) {
+  SpillingShuffleBuffer::Options options;
+  options.spill_directory = SpillDirectory();
+  options.max_in_memory_elements = 0;
+  options.chunk_size_bytes = 3 * kElementBytes;
+  auto buffer = CreateBuffer(options);
+  for (int64_t i = 0; i < 300; ++i) {
+    TF_ASSERT_OK(buffer->Push({test::AsScalar<int64_t>(i)}, /*seed=*/i));
+  }
+  EXPECT_EQ(buffer->num_spilled_elements(), 300);
+  // Draws interleave the 100 chunks, each of which is read at the offset of
+  // its next element.
+  EXPECT_THAT(PopAll(*buffer, /*seed=*/1000),
+              UnorderedElementsAreArray(Range(300)));
+}
+
+TEST(SpillingShuffleBufferTest, DeletesSpilledChunks) {
+  const std::string directory = SpillDirectory();
+  const int64_t num_children = SpillDirectoryChildren(directory).size();
+  SpillingShuffleBuffer::Options options;
+  options.spill_directory = directory;
+  options.max_in_memory_elements = 0;
+  options.chunk_size_bytes = kElementBytes;
+  {
+    auto buffer = CreateBuffer(options);
+    for (int64_t i = 0; i < 10; ++i) {
+      TF_ASSERT_OK(buffer->Push({test::AsScalar<int64_t>(i)}, /*seed=*/i));
+    }
+    EXPECT_EQ(buffer->num_spilled_elements(), 10);
+    EXPECT_THAT(SpillDirectoryChildren(directory), SizeIs(num_children + 1));
+  }
+  EXPECT_THAT(SpillDirectoryChildren(directory), SizeIs(num_children));
+}
+
+TEST(SpillingShuffleBufferTest, InMemoryBytesWithinRamBudget) {
+  auto ram_budget_manager =
+      std::make_shared<model::RamBudgetManager>(10 * kElementBytes);
+  SpillingShuffleBuffer::Options options;
+  options.spill_directory = SpillDirectory();
+  options.chunk_size_bytes = 5 * kElementBytes;
+  options.ram_budget_manager = ram_budget_manager;
+  auto buffer = CreateBuffer(options);
+  for (int64_t i = 0; i < 30; ++i) {
+    TF_ASSERT_OK(buffer->Push({test::AsScalar<int64_t>(i)}, /*seed=*/i));
+  }
+  EXPECT_EQ(buffer->num_in_memory_elements(), 10);
+  EXPECT_EQ(buffer->num_spilled_elements(), 20);
+  EXPECT_FALSE(ram_budget_manager->RequestLegacyPrefetchBytes(1));
+
+  // The model takes most of the budget, so the buffer spills all but 4
+  // elements on its next call.
+  EXPECT_TRUE(ram_budget_manager->RequestModelAllocation(6 * kElementBytes));
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(buffer->Pop(/*seed=*/0, &element));
+  EXPECT_LE(buffer->num_in_memory_elements(), 4);
+  EXPECT_EQ(ram_budget_manager->SpillableBytesOverBudget(), 0);
+
+  std::vector<int64_t> values = PopAll(*buffer, /*seed=*/1);
+  values.push_back(element[0].scalar<int64_t>()());
+  EXPECT_THAT(values, UnorderedElementsAreArray(Range(30)));
+  // All the bytes are returned once the buffer is empty.
+  EXPECT_TRUE(
+      ram_budget_manager->RequestLegacyPrefetchBytes(4 * kElementBytes));
+}
+
+TEST(SpillingShuffleBufferTest, SaveAndRestore) {
+  SpillingShuffleBuffer::Options options;
+  options.spill_directory = SpillDirectory();
+  options.max_in_memory_elements = 10;
+  options.chunk_size_bytes = 7 * kElementBytes;
+  auto buffer = CreateBuffer(options);
+  for (int64_t i = 0; i < 100; ++i) {
+    TF_ASSERT_OK(buffer->Push({test::AsScalar<int64_t>(i)}, /*seed=*/i));
+  }
+  for (int64_t i = 0; i < 25; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer->Pop(/*seed=*/i, &element));
+  }
+
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(buffer->Save(&writer, "Iterator:buffer"));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> ctx,
+                          TestContext::Create());
+  auto restored_buffer = CreateBuffer(options);
+  TF_ASSERT_OK(
+      restored_buffer->Restore(ctx->iter_ctx(), &reader, "Iterator:buffer"));
+  EXPECT_EQ(restored_buffer->size(), 75);
+  EXPECT_EQ(restored_buffer->num_in_memory_elements(),
+            buffer->num_in_memory_elements());
+
+  std::vector<int64_t> values = PopAll(*buffer, /*seed=*/1000);
+  EXPECT_EQ(PopAll(*restored_buffer, /*seed=*/1000), values);
+}
+
+TEST(SpillingShuffleBufferTest, CheckpointRefersToChunkCopies) {
+  const std::string directory =
+      io::JoinPath(testing::TmpDir(), "spill_checkpoint");
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(directory));
+  SpillingShuffleBuffer::Options options;
+  options.spill_directory = directory;
+  options.max_in_memory_elements = 0;
+  options.chunk_size_bytes = 5 * kElementBytes;
+  auto buffer = CreateBuffer(options);
+  for (int64_t i = 0; i < 50; ++i) {
+    TF_ASSERT_OK(buffer->Push({test::AsScalar<int64_t>(i)}, /*seed=*/i));
+  }
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(buffer->Save(&writer, "Iterator:buffer"));
+  std::vector<int64_t> values = PopAll(*buffer, /*seed=*/1000);
+  buffer.reset();
+
+  // Only the checkpoint's copies of the chunks are left in the directory, and
+  // the checkpoint can be restored more than once from them.
+  std::vector<std::string> checkpoint_directories =
+      SpillDirectoryChildren(directory);
+  ASSERT_THAT(checkpoint_directories, SizeIs(1));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> ctx,
+                          TestContext::Create());
+  for (int i = 0; i < 2; ++i) {
+    VariantTensorDataReader reader(data);
+    auto restored_buffer = CreateBuffer(options);
+    TF_ASSERT_OK(
+        restored_buffer->Restore(ctx->iter_ctx(), &reader, "Iterator:buffer"));
+    EXPECT_EQ(PopAll(*restored_buffer, /*seed=*/1000), values);
+  }
+
+  int64_t undeleted_files = 0;
+  int64_t undeleted_dirs = 0;
+  TF_ASSERT_OK(Env::Default()->DeleteRecursively(
+      io::JoinPath(directory, checkpoint_directories[0]), &undeleted_files,
+      &undeleted_dirs));
+  VariantTensorDataReader reader(data);
+  auto restored_buffer = CreateBuffer(options);
+  EXPECT_EQ(
+      restored_buffer->Restore(ctx->iter_ctx(), &reader, "Iterator:buffer")
+          .code(),
+      absl::StatusCode::kFailedPrecondition);
+}
+
+TEST(SpillingShuffleBufferTest, InvalidOptions) {
+  SpillingShuffleBuffer::Options options;
+  EXPECT_EQ(SpillingShuffleBuffer::Create(Env::Default(), options)
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  options.spill_directory = SpillDirectory();
+  options.chunk_size_bytes = 0;
+  EXPECT_EQ(SpillingShuffleBuffer::Create(Env::Default(), options)
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
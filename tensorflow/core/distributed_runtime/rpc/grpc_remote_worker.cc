@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_remote_worker.h"
 
+#include <algorithm>
+#include <memory>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "grpcpp/generic/generic_stub.h"
 #include "grpcpp/grpcpp.h"
 #include "tensorflow/core/common_runtime/process_util.h"
@@ -33,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/protobuf/transport_options.pb.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
@@ -255,6 +259,14 @@ class GrpcRemoteWorker : public WorkerInterface {
       done(s);
     };
 
+    // Chunks after the first are received straight into the tensor allocated
+    // for the first one, which only works for host memory.
+    const int64_t chunk_bytes = RecvTensorChunkBytes();
+    if (chunk_bytes > 0 && request->request_id() != 0 && response->on_host()) {
+      RecvTensorInChunksAsync(call_opts, request, response, chunk_bytes,
+                              std::move(callback));
+      return;
+    }
     IssueRequest(request, response, recvtensor_, callback, call_opts);
   }
 
@@ -291,6 +303,175 @@ class GrpcRemoteWorker : public WorkerInterface {
         GrpcMaybeParseTensorResponse);
   }
 
+  // State of a tensor that is being received in chunks, shared by the chunk
+  // requests in flight.
+  struct ChunkedRecvTensorState {
+    const RecvTensorRequest* request;
+    // The tensor allocated for the first chunk, into which the other chunks
+    // are received.
+    Tensor tensor;
+    int64_t chunk_bytes;
+    // The caller's call options, on which the transfer registers a
+    // cancellation callback that cancels the chunks in flight. May be null.
+    CallOptions* call_opts;
+    // The time by which the transfer must complete, in Env::NowMicros(), or
+    // 0 if the caller set no timeout.
+    int64_t deadline_micros = 0;
+    StatusCallback done;
+
+    mutex mu;
+    int64_t next_chunk_offset TF_GUARDED_BY(mu);
+    int num_chunks_in_flight TF_GUARDED_BY(mu) = 0;
+    // The call options of each chunk request in flight, by chunk offset.
+    absl::flat_hash_map<int64_t, std::unique_ptr<CallOptions>>
+        chunk_call_opts TF_GUARDED_BY(mu);
+    Status status TF_GUARDED_BY(mu);
+    bool finished TF_GUARDED_BY(mu) = false;
+  };
+
+  // Receives the tensor for `request` in chunks of at most `chunk_bytes`.
+  // The first chunk is received into `response`, which allocates the whole
+  // tensor. The remaining chunks are then requested in parallel, and written
+  // directly into that tensor. Senders that don't support chunking return
+  // the whole tensor in response to the first request.
+  //
+  // The timeout of `call_opts` bounds the whole transfer, and cancelling
+  // `call_opts` cancels the chunks in flight and stops requesting new ones.
+  void RecvTensorInChunksAsync(CallOptions* call_opts,
+                               const RecvTensorRequest* request,
+                               TensorResponse* response, int64_t chunk_bytes,
+                               StatusCallback done) {
+    const int64_t timeout_ms =
+        call_opts != nullptr ? call_opts->GetTimeout() : 0;
+    const int64_t deadline_micros =
+        timeout_ms > 0 ? Env::Default()->NowMicros() + timeout_ms * 1000 : 0;
+    RecvTensorRequest first_chunk_request(*request);
+    first_chunk_request.set_max_chunk_bytes(chunk_bytes);
+    first_chunk_request.set_chunk_offset(0);
+    IssueRequest(
+        &first_chunk_request, response, recvtensor_,
+        [this, call_opts, request, response, chunk_bytes, deadline_micros,
+         done](const Status& s) {
+          if (!s.ok() || response->chunk_bytes() < 0 ||
+              response->chunk_bytes() >=
+                  static_cast<int64_t>(response->tensor().TotalBytes())) {
+            done(s);
+            return;
+          }
+          auto state = std::make_shared<ChunkedRecvTensorState>();
+          state->request = request;
+          state->tensor = response->tensor();
+          state->chunk_bytes = chunk_bytes;
+          state->call_opts = call_opts;
+          state->deadline_micros = deadline_micros;
+          state->done = done;
+          {
+            mutex_lock l(state->mu);
+            state->next_chunk_offset = response->chunk_bytes();
+          }
+          if (call_opts != nullptr) {
+            call_opts->SetCancelCallback([state]() {
+              mutex_lock l(state->mu);
+              state->status.Update(errors::Cancelled(
+                  "RecvTensor of ", state->request->rendezvous_key(),
+                  " was cancelled"));
+              for (auto& chunk_call_opts : state->chunk_call_opts) {
+                chunk_call_opts.second->StartCancel();
+              }
+            });
+          }
+          IssueChunkRequests(state);
+        },
+        call_opts);
+  }
+
+  // Issues requests for the next chunks of `state`, up to the configured
+  // number of chunks in flight. Calls `state->done` once the last chunk
+  // has been received, or once all chunks in flight have returned after the
+  // transfer failed, was cancelled or timed out.
+  void IssueChunkRequests(std::shared_ptr<ChunkedRecvTensorState> state) {
+    const int64_t total_bytes = state->tensor.TotalBytes();
+    const int64_t max_chunks_in_flight = RecvTensorMaxChunksInFlight();
+    while (true) {
+      int64_t chunk_offset;
+      int64_t timeout_ms = 0;
+      CallOptions* chunk_call_opts;
+      bool finished = false;
+      Status status;
+      {
+        mutex_lock l(state->mu);
+        const bool all_requested = state->next_chunk_offset >= total_bytes;
+        if (state->status.ok() && !all_requested &&
+            state->deadline_micros > 0) {
+          const int64_t remaining_micros =
+              state->deadline_micros - Env::Default()->NowMicros();
+          if (remaining_micros <= 0) {
+            state->status = errors::DeadlineExceeded(
+                "Timed out receiving ", state->request->rendezvous_key(),
+                " in chunks");
+          }
+          timeout_ms = (remaining_micros + 999) / 1000;
+        }
+        if (!state->status.ok() || all_requested) {
+          if (state->num_chunks_in_flight > 0 || state->finished) {
+            return;
+          }
+          state->finished = finished = true;
+          status = state->status;
+        } else if (state->num_chunks_in_flight >= max_chunks_in_flight) {
+          return;
+        } else {
+          chunk_offset = state->next_chunk_offset;
+          state->next_chunk_offset += state->chunk_bytes;
+          ++state->num_chunks_in_flight;
+          auto& call_opts = state->chunk_call_opts[chunk_offset];
+          call_opts = std::make_unique<CallOptions>();
+          call_opts->SetTimeout(timeout_ms);
+          chunk_call_opts = call_opts.get();
+        }
+      }
+      if (finished) {
+        // The cancellation callback may still run until it is cleared.
+        if (state->call_opts != nullptr) {
+          state->call_opts->ClearCancelCallback();
+        }
+        state->done(status);
+        return;
+      }
+      const int64_t expected_bytes =
+          std::min(state->chunk_bytes, total_bytes - chunk_offset);
+
+      RecvTensorRequest chunk_request(*state->request);
+      chunk_request.set_max_chunk_bytes(state->chunk_bytes);
+      chunk_request.set_chunk_offset(chunk_offset);
+      TensorResponse* chunk_response = new TensorResponse();
+      chunk_response->InitChunkDestination(state->tensor);
+      IssueRequest(
+          &chunk_request, chunk_response, recvtensor_,
+          [this, state, chunk_response, chunk_offset,
+           expected_bytes](const Status& s) {
+            Status chunk_status = s;
+            if (chunk_status.ok() &&
+                chunk_response->chunk_bytes() != expected_bytes) {
+              chunk_status = errors::Internal(
+                  "Received ", chunk_response->chunk_bytes(),
+                  " bytes for the tensor chunk at offset ", chunk_offset,
+                  " of ", state->request->rendezvous_key(), "; expected ",
+                  expected_bytes);
+            }
+            delete chunk_response;
+            {
+              mutex_lock l(state->mu);
+              state->status.Update(chunk_status);
+              --state->num_chunks_in_flight;
+              state->chunk_call_opts.erase(chunk_offset);
+            }
+            IssueChunkRequests(state);
+          },
+          chunk_call_opts);
+    }
+  }
+
   void IssueMarkRecvFinishedRequest(int64_t request_id) {
     VLOG(2) << "Send MarkRecvFinishedRequest for request " << request_id;
     MarkRecvFinishedRequest request;
@@ -312,6 +493,24 @@ class GrpcRemoteWorker : public WorkerInterface {
     return max_retries;
   }
 
+  // Helper function for configuring the size of the chunks in which large
+  // tensors are received. Defaults to 0 (tensors are received whole).
+  const int64_t RecvTensorChunkBytes() {
+    int64_t chunk_bytes = 0;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_GRPC_RECV_TENSOR_CHUNK_BYTES", 0,
+                                    &chunk_bytes));
+    return chunk_bytes;
+  }
+
+  // Helper function for configuring how many chunks of a tensor may be
+  // requested in parallel. Defaults to 4.
+  const int64_t RecvTensorMaxChunksInFlight() {
+    int64_t max_chunks_in_flight = 4;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_GRPC_RECV_TENSOR_MAX_CHUNKS_IN_FLIGHT",
+                                    4, &max_chunks_in_flight));
+    return std::max<int64_t>(max_chunks_in_flight, 1);
+  }
+
   SharedGrpcChannelPtr channel_;
   ::grpc::GenericStub stub_;
   ::grpc::CompletionQueue* cq_;
@@ -0,0 +1,268 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/rpc/grpc_remote_worker.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "grpcpp/generic/async_generic_service.h"
+#include "grpcpp/grpcpp.h"
+#include "tensorflow/core/distributed_runtime/call_options.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_channel.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_worker_cache.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/worker_interface.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kWorker[] = "/job:worker/replica:0/task:0";
+constexpr int64_t kChunkBytes = 1024;
+constexpr int kMaxChunksInFlight = 2;
+// A float tensor of this many elements is received in 4 chunks.
+constexpr int64_t kNumElements = 1024;
+
+class DummyDevice : public DeviceBase {
+ public:
+  explicit DummyDevice(Env* env) : DeviceBase(env) {
+    attr_.set_device_type("CPU");
+  }
+
+  const DeviceAttributes& attributes() const override { return attr_; }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return cpu_allocator();
+  }
+
+ private:
+  DeviceAttributes attr_;
+};
+
+// A RecvTensor server that replies to the first chunk request of a tensor, and
+// holds every other chunk request until the client cancels it or its deadline
+// expires.
+class StalledChunkServer {
+ public:
+  StalledChunkServer() {
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", ::grpc::InsecureServerCredentials(),
+                             &port_);
+    builder.RegisterAsyncGenericService(&service_);
+    cq_ = builder.AddCompletionQueue();
+    server_ = builder.BuildAndStart();
+    thread_.reset(Env::Default()->StartThread({}, "StalledChunkServer",
+                                              [this] { Serve(); }));
+  }
+
+  ~StalledChunkServer() {
+    server_->Shutdown(std::chrono::system_clock::now());
+    cq_->Shutdown();
+    thread_.reset();
+  }
+
+  int port() const { return port_; }
+
+  void WaitForChunkRequests(int n) {
+    mutex_lock l(mu_);
+    while (num_chunk_requests_ < n) {
+      cond_var_.wait(l);
+    }
+  }
+
+  int num_chunk_requests() {
+    mutex_lock l(mu_);
+    return num_chunk_requests_;
+  }
+
+ private:
+  struct Call;
+
+  struct Tag {
+    enum Kind { kNew, kRead, kDone, kFinish };
+    Call* call;
+    Kind kind;
+  };
+
+  struct Call {
+    Call() : stream(&ctx) {}
+
+    ::grpc::GenericServerContext ctx;
+    ::grpc::GenericServerAsyncReaderWriter stream;
+    ::grpc::ByteBuffer request;
+    bool held = false;
+    Tag new_tag{this, Tag::kNew};
+    Tag read_tag{this, Tag::kRead};
+    Tag done_tag{this, Tag::kDone};
+    Tag finish_tag{this, Tag::kFinish};
+  };
+
+  void RequestCall() {
+    calls_.push_back(std::make_unique<Call>());
+    Call* call = calls_.back().get();
+    call->ctx.AsyncNotifyWhenDone(&call->done_tag);
+    service_.RequestCall(&call->ctx, &call->stream, cq_.get(), cq_.get(),
+                         &call->new_tag);
+  }
+
+  void Serve() {
+    RequestCall();
+    void* tag;
+    bool ok;
+    while (cq_->Next(&tag, &ok)) {
+      Call* call = static_cast<Tag*>(tag)->call;
+      switch (static_cast<Tag*>(tag)->kind) {
+        case Tag::kNew:
+          if (ok) {
+            RequestCall();
+            call->stream.Read(&call->request, &call->read_tag);
+          }
+          break;
+        case Tag::kRead:
+          if (ok) HandleRequest(call);
+          break;
+        case Tag::kDone:
+          if (call->held) {
+            call->stream.Finish(::grpc::Status::CANCELLED, &call->finish_tag);
+          }
+          break;
+        case Tag::kFinish:
+          break;
+      }
+    }
+  }
+
+  void HandleRequest(Call* call) {
+    RecvTensorRequest request;
+    CHECK(tsl::GrpcMaybeParseProto(&call->request, &request));
+    if (request.chunk_offset() > 0) {
+      call->held = true;
+      mutex_lock l(mu_);
+      ++num_chunk_requests_;
+      cond_var_.notify_all();
+      return;
+    }
+    RecvTensorResponse response;
+    response.mutable_tensor()->set_dtype(DT_FLOAT);
+    TensorShape({kNumElements})
+        .AsProto(response.mutable_tensor()->mutable_tensor_shape());
+    response.set_chunk_offset(0);
+    response.set_tensor_chunk(std::string(request.max_chunk_bytes(), '\0'));
+    ::grpc::ByteBuffer buffer;
+    CHECK(tsl::GrpcMaybeUnparseProto(response, &buffer).ok());
+    call->stream.WriteAndFinish(buffer, ::grpc::WriteOptions(),
+                                ::grpc::Status::OK, &call->finish_tag);
+  }
+
+  int port_ = 0;
+  ::grpc::AsyncGenericService service_;
+  std::unique_ptr<::grpc::ServerCompletionQueue> cq_;
+  std::unique_ptr<::grpc::Server> server_;
+  // Only used by the serving thread, and destroyed after it is joined.
+  std::vector<std::unique_ptr<Call>> calls_;
+  std::unique_ptr<Thread> thread_;
+
+  mutex mu_;
+  condition_variable cond_var_;
+  int num_chunk_requests_ TF_GUARDED_BY(mu_) = 0;
+};
+
+class GrpcRemoteWorkerChunkedRecvTensorTest : public ::testing::Test {
+ protected:
+  GrpcRemoteWorkerChunkedRecvTensorTest() : cpu_device_(Env::Default()) {
+    setenv("TF_GRPC_RECV_TENSOR_CHUNK_BYTES",
+           strings::StrCat(kChunkBytes).c_str(), /*overwrite=*/1);
+    setenv("TF_GRPC_RECV_TENSOR_MAX_CHUNKS_IN_FLIGHT",
+           strings::StrCat(kMaxChunksInFlight).c_str(), /*overwrite=*/1);
+    GrpcChannelSpec spec;
+    TF_CHECK_OK(spec.AddHostPortsJob(
+        "worker", {{0, strings::StrCat("localhost:", server_.port())}}));
+    auto channel_cache =
+        std::shared_ptr<GrpcChannelCache>(NewGrpcChannelCache(
+            spec, ConvertToChannelCreationFunction(NewHostPortGrpcChannel)));
+    grpc_worker_env_.reset(CreateGrpcWorkerEnv());
+    worker_cache_.reset(
+        NewGrpcWorkerCache(channel_cache, grpc_worker_env_.get()));
+    worker_ = worker_cache_->GetOrCreateWorker(kWorker);
+  }
+
+  ~GrpcRemoteWorkerChunkedRecvTensorTest() override {
+    worker_cache_->ReleaseWorker(kWorker, worker_);
+    unsetenv("TF_GRPC_RECV_TENSOR_CHUNK_BYTES");
+    unsetenv("TF_GRPC_RECV_TENSOR_MAX_CHUNKS_IN_FLIGHT");
+  }
+
+  // Starts receiving a tensor, and returns once the first chunk has been
+  // received and the other chunk requests are held by the server.
+  void StartRecvTensor(CallOptions* call_opts) {
+    request_.set_step_id(1);
+    request_.set_rendezvous_key("/job:a;0;/job:b;x;0:0");
+    request_.set_request_id(1);
+    response_.InitAlloc(&cpu_device_, AllocatorAttributes());
+    worker_->RecvTensorAsync(call_opts, &request_, &response_,
+                             [this](const Status& s) {
+                               status_ = s;
+                               done_.Notify();
+                             });
+    server_.WaitForChunkRequests(kMaxChunksInFlight);
+  }
+
+  StalledChunkServer server_;
+  DummyDevice cpu_device_;
+  std::unique_ptr<GrpcWorkerEnv> grpc_worker_env_;
+  std::unique_ptr<WorkerCacheInterface> worker_cache_;
+  WorkerInterface* worker_;
+
+  RecvTensorRequest request_;
+  TensorResponse response_;
+  Notification done_;
+  Status status_;
+};
+
+TEST_F(GrpcRemoteWorkerChunkedRecvTensorTest, CancelMidTransfer) {
+  CallOptions call_opts;
+  StartRecvTensor(&call_opts);
+  call_opts.StartCancel();
+  done_.WaitForNotification();
+  EXPECT_EQ(status_.code(), absl::StatusCode::kCancelled);
+  // No chunk is requested after the transfer is cancelled.
+  EXPECT_EQ(server_.num_chunk_requests(), kMaxChunksInFlight);
+}
+
+TEST_F(GrpcRemoteWorkerChunkedRecvTensorTest, TimeoutBoundsTransfer) {
+  CallOptions call_opts;
+  call_opts.SetTimeout(500);
+  StartRecvTensor(&call_opts);
+  done_.WaitForNotification();
+  EXPECT_EQ(status_.code(), absl::StatusCode::kDeadlineExceeded);
+  EXPECT_EQ(server_.num_chunk_requests(), kMaxChunksInFlight);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
@@ -39,6 +42,9 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
   result->Swap(&tmp);
 }
 
+// Tensor data larger than this is shared with the response, not copied.
+static const int kLargeTensorBytes = 1024;
+
 // We generate a RecvTensorResponse protocol buffer encoding into "*result",
 // but where possible, we share the underlying Tensor buffer for "val", to
 // avoid an extra copy.
@@ -134,9 +140,20 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 #endif
 }
 
+// Returns a grpc::Slice for "data", which must point into the backing store of
+// "val", that shares that backing store rather than copying it.
+static ::grpc::Slice SharedTensorDataSlice(const Tensor& val,
+                                           StringPiece data) {
+  const TensorBuffer* buf = DMAHelper::buffer(&val);
+  buf->Ref();
+  return ::grpc::Slice(
+      const_cast<void*>(static_cast<const void*>(data.data())), data.size(),
+      [](void* backing) { static_cast<TensorBuffer*>(backing)->Unref(); },
+      const_cast<TensorBuffer*>(buf));
+}
+
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
                               ::grpc::ByteBuffer* result) {
-  const int kLargeTensorBytes = 1024;
   const int64_t kProtoBufLimitBytes = 1LL << 31;
 
   if (val.TotalBytes() > kProtoBufLimitBytes) {
@@ -230,13 +247,7 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
 
     if (share_tensor_slice_memory) {
       // (E) Encode tensor data, but by sharing backing store
-      const TensorBuffer* buf = DMAHelper::buffer(&val);
-      buf->Ref();
-      slices[1] = ::grpc::Slice(
-          const_cast<void*>(static_cast<const void*>(tdata.data())),
-          tdata.size(),
-          [](void* backing) { static_cast<TensorBuffer*>(backing)->Unref(); },
-          const_cast<TensorBuffer*>(buf));
+      slices[1] = SharedTensorDataSlice(val, tdata);
       num_slices += 1;
     }
     size_t total_bytes = 0;
@@ -250,5 +261,111 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
   }
 }
 
+// The chunked encoding follows the same scheme as EncodeTensorToByteBuffer(),
+// except that R.tensor() only holds the skeleton of "val", and the chunk of
+// tensor data is encoded as R.tensor_chunk() after it:
+//
+// A:   <protocol buffer encoding of fields except R.tensor() and
+//          R.tensor_chunk()>
+// B1:  <tag encoding for RecvTensorResponse::tensor>
+// B2:  <varint32 length of R.tensor() sub message>
+// C:   <protocol buffer encoding of R.tensor()>
+// D1:  <tag encoding for RecvTensorResponse::tensor_chunk>
+// D2:  <varint32 length of the chunk>
+// E:   <actual data for the chunk of val's representation>
+//
+// TensorResponse relies on this order to write E directly into the tensor it
+// allocated from C.
+void EncodeTensorChunkToByteBuffer(bool is_dead, const Tensor& val,
+                                   bool require_ack, int64_t chunk_offset,
+                                   int64_t max_chunk_bytes,
+                                   ::grpc::ByteBuffer* result) {
+  DCHECK(DataTypeCanUseMemcpy(val.dtype()));
+  StringPiece tdata = val.tensor_data();
+  DCHECK_GE(chunk_offset, 0);
+  DCHECK_LE(chunk_offset, static_cast<int64_t>(tdata.size()));
+  DCHECK_GT(max_chunk_bytes, 0);
+  StringPiece chunk = tdata.substr(
+      chunk_offset,
+      std::min<int64_t>(max_chunk_bytes, tdata.size() - chunk_offset));
+
+  RecvTensorResponse response;
+  if (is_dead) {
+    response.set_is_dead(is_dead);
+  }
+  response.set_require_ack(require_ack);
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  response.set_chunk_offset(chunk_offset);
+  string header;  // All of RecvTensorResponse except tensor and tensor_chunk
+  response.AppendToString(&header);
+
+  gtl::InlinedVector<char, 128> skeleton(SkeletonEncodingSizeUpperBound(val));
+  io::ProtoEncodeHelper e_skeleton(skeleton.data(), skeleton.size());
+  EncodeSkeleton(val, &e_skeleton);
+
+  const size_t expected_size =
+      header.size() +
+      VarLengthEncodingSize(RecvTensorResponse::kTensorFieldNumber,
+                            e_skeleton.size()) +
+      VarLengthEncodingSize(RecvTensorResponse::kTensorChunkFieldNumber,
+                            chunk.size());
+  const bool share_tensor_slice_memory = (chunk.size() > kLargeTensorBytes);
+
+  gtl::InlinedVector<char, 1024> space(expected_size - chunk.size());
+  io::ProtoEncodeHelper e(space.data(), space.size());
+  // (A)
+  e.WriteRawBytes(header);
+  // (B1) & (B2)
+  e.WriteVarlengthBeginning(RecvTensorResponse::kTensorFieldNumber,
+                            e_skeleton.size());
+  // (C)
+  e.WriteRawBytes(StringPiece(e_skeleton.data(), e_skeleton.size()));
+  // (D1) & (D2)
+  e.WriteVarlengthBeginning(RecvTensorResponse::kTensorChunkFieldNumber,
+                            chunk.size());
+
+  ::grpc::Slice slices[2];
+  int num_slices = 0;
+  {
+    size_t slice_len =
+        e.size() + (share_tensor_slice_memory ? 0 : chunk.size());
+    slices[0] = ::grpc::Slice(slice_len);
+    memcpy(const_cast<uint8_t*>(slices[0].begin()), e.data(), e.size());
+    if (!share_tensor_slice_memory) {
+      // (E)
+      memcpy(const_cast<uint8_t*>(slices[0].begin()) + e.size(), chunk.data(),
+             chunk.size());
+    }
+    num_slices += 1;
+  }
+  if (share_tensor_slice_memory) {
+    // (E) Encode the chunk, but by sharing backing store
+    slices[1] = SharedTensorDataSlice(val, chunk);
+    num_slices += 1;
+  }
+  size_t total_bytes = 0;
+  for (int i = 0; i < num_slices; i++) {
+    total_bytes += slices[i].size();
+  }
+  CHECK_EQ(total_bytes, expected_size);
+
+  ::grpc::ByteBuffer tmp(&slices[0], num_slices);
+  result->Swap(&tmp);
+}
+
+void EncodeTensorWithWireCodecToByteBuffer(const Tensor& val, bool require_ack,
+                                           TensorWireCodec codec,
+                                           string encoded_content,
+                                           ::grpc::ByteBuffer* result) {
+  RecvTensorResponse response;
+  response.set_require_ack(require_ack);
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  response.mutable_tensor()->set_dtype(val.dtype());
+  val.shape().AsProto(response.mutable_tensor()->mutable_tensor_shape());
+  response.set_wire_codec(codec);
+  *response.mutable_encoded_tensor_content() = std::move(encoded_content);
+  EncodeRecvTensorResponseToByteBuffer(response, result);
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
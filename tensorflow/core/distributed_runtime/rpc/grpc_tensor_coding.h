@@ -17,10 +17,11 @@ limitations under the License.
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 
 #include "grpcpp/impl/codegen/byte_buffer.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
 
 namespace tensorflow {
 class Tensor;
-class RecvTensorResponse;
 
 // TODO(jeff,sanjay): this should not be grpc specific.  Instead of
 // grpc::ByteBuffer*, it should accept an object of an interface type
@@ -49,6 +50,28 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
                               ::grpc::ByteBuffer* result);
 
+// Same as EncodeTensorToByteBuffer, but only encodes the chunk of the contents
+// of "val" that starts at byte "chunk_offset" and is at most "max_chunk_bytes"
+// long, as "RecvTensorResponse::tensor_chunk". The chunk shares the backing
+// store of "val" when it is large.
+//
+// REQUIRES: DataTypeCanUseMemcpy(val.dtype()),
+// 0 <= chunk_offset <= val.TotalBytes(), and max_chunk_bytes > 0.
+void EncodeTensorChunkToByteBuffer(bool is_dead, const Tensor& val,
+                                   bool require_ack, int64_t chunk_offset,
+                                   int64_t max_chunk_bytes,
+                                   ::grpc::ByteBuffer* result);
+
+// Encode a RecvTensorResponse for "val", whose contents were encoded with
+// "codec" into "encoded_content" (see EncodeTensorContent()), into a byte
+// buffer.
+//
+// Discards original contents of *result.
+void EncodeTensorWithWireCodecToByteBuffer(const Tensor& val, bool require_ack,
+                                           TensorWireCodec codec,
+                                           string encoded_content,
+                                           ::grpc::ByteBuffer* result);
+
 }  // namespace grpc
 }  // namespace tensorflow
 
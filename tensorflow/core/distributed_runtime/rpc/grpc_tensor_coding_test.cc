@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -100,4 +103,60 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(GrpcTensorCodingTest, Chunks) {
+  Tensor t(DT_FLOAT, TensorShape({10, 1000}));
+  t.flat<float>().setRandom();
+  const int64_t total_bytes = t.TotalBytes();
+  // Large enough for the chunks to share the tensor's backing store, except
+  // for the last one.
+  const int64_t kChunkBytes = 3000;
+
+  string content;
+  for (int64_t offset = 0; offset < total_bytes; offset += kChunkBytes) {
+    ::grpc::ByteBuffer buf;
+    grpc::EncodeTensorChunkToByteBuffer(false, t, true, offset, kChunkBytes,
+                                        &buf);
+    std::vector<::grpc::Slice> slices;
+    (void)buf.Dump(&slices);
+    string tmp;
+    for (const auto& s : slices) {
+      tmp.append(reinterpret_cast<const char*>(s.begin()), s.size());
+    }
+
+    RecvTensorResponse response;
+    ASSERT_TRUE(response.ParseFromString(tmp));
+    EXPECT_TRUE(response.require_ack());
+    EXPECT_EQ(response.chunk_offset(), offset);
+    EXPECT_EQ(response.tensor_chunk().size(),
+              std::min(kChunkBytes, total_bytes - offset));
+    EXPECT_EQ(response.tensor().dtype(), t.dtype());
+    EXPECT_EQ(TensorShape(response.tensor().tensor_shape()), t.shape());
+    EXPECT_TRUE(response.tensor().tensor_content().empty());
+    content.append(response.tensor_chunk());
+  }
+  EXPECT_EQ(content, t.tensor_data());
+}
+
+TEST_F(GrpcTensorCodingTest, WireCodec) {
+  Tensor t(DT_FLOAT, TensorShape({3, 4}));
+  ::grpc::ByteBuffer buf;
+  grpc::EncodeTensorWithWireCodecToByteBuffer(
+      t, true, TENSOR_WIRE_CODEC_SNAPPY, "encoded content", &buf);
+  std::vector<::grpc::Slice> slices;
+  (void)buf.Dump(&slices);
+  string tmp;
+  for (const auto& s : slices) {
+    tmp.append(reinterpret_cast<const char*>(s.begin()), s.size());
+  }
+
+  RecvTensorResponse response;
+  ASSERT_TRUE(response.ParseFromString(tmp));
+  EXPECT_TRUE(response.require_ack());
+  EXPECT_EQ(response.wire_codec(), TENSOR_WIRE_CODEC_SNAPPY);
+  EXPECT_EQ(response.encoded_tensor_content(), "encoded content");
+  EXPECT_EQ(response.tensor().dtype(), t.dtype());
+  EXPECT_EQ(TensorShape(response.tensor().tensor_shape()), t.shape());
+  EXPECT_TRUE(response.tensor().tensor_content().empty());
+}
+
 }  // namespace tensorflow
@@ -37,11 +37,13 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
 #include "tensorflow/core/distributed_runtime/rpc/rpc_response_cache.h"
+#include "tensorflow/core/distributed_runtime/tensor_wire_codec.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_session.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -446,11 +448,55 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
   const int64_t step_id = request->step_id();
 
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
+  // Chunks after the first are served from the response cache, so chunking
+  // is only possible with the cache enabled.
+  const int64_t max_chunk_bytes =
+      cache_enabled ? request->max_chunk_bytes() : 0;
+  const int64_t chunk_offset = request->chunk_offset();
+  std::vector<TensorWireCodec> wire_codecs;
+  wire_codecs.reserve(request->accepted_wire_codecs_size());
+  for (int codec : request->accepted_wire_codecs()) {
+    wire_codecs.push_back(static_cast<TensorWireCodec>(codec));
+  }
 
-  auto do_response = [response, done, cache_enabled](const Tensor& tensor,
-                                                     bool is_dead,
-                                                     const Status& status) {
-    if (status.ok()) {
+  auto do_response = [response, done, cache_enabled, max_chunk_bytes,
+                      chunk_offset, wire_codecs](const Tensor& tensor,
+                                                 bool is_dead,
+                                                 const Status& status) {
+    if (!status.ok()) {
+      done(status);
+      return;
+    }
+    // An encoded response always holds the whole tensor, so that the receiver
+    // does not ask for further chunks. Later chunks are never encoded.
+    if (!is_dead && chunk_offset == 0) {
+      for (TensorWireCodec codec : wire_codecs) {
+        string encoded;
+        if (!EncodeTensorContent(codec, tensor, &encoded)) continue;
+        metrics::RecordRecvTensorWireCodecBytes(TensorWireCodecName(codec),
+                                                tensor.TotalBytes(),
+                                                encoded.size());
+        grpc::EncodeTensorWithWireCodecToByteBuffer(
+            tensor, cache_enabled, codec, std::move(encoded), response);
+        done(status);
+        return;
+      }
+    }
+    // Only tensors whose content can be sent as raw bytes are split into
+    // chunks. The receiver treats any other response as the whole tensor.
+    if (max_chunk_bytes > 0 && !is_dead &&
+        DataTypeCanUseMemcpy(tensor.dtype())) {
+      if (chunk_offset < 0 ||
+          chunk_offset > static_cast<int64_t>(tensor.TotalBytes())) {
+        done(errors::InvalidArgument("RecvTensor chunk offset ", chunk_offset,
+                                     " is out of range for a tensor of ",
+                                     tensor.TotalBytes(), " bytes"));
+        return;
+      }
+      grpc::EncodeTensorChunkToByteBuffer(is_dead, tensor, cache_enabled,
+                                          chunk_offset, max_chunk_bytes,
+                                          response);
+    } else {
       grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled, response);
     }
     done(status);
@@ -15,12 +15,15 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <vector>
+
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/distributed_runtime/request_id.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/tensor_wire_codec.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
 #include "tensorflow/core/framework/types.h"
@@ -31,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -53,6 +57,27 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
   void operator=(const RpcRemoteRendezvous&) = delete;
 };
 
+// Returns the wire codecs that received tensors may be encoded with, in order
+// of preference, as configured by the comma-separated codec names in
+// TF_RECV_TENSOR_WIRE_CODECS (e.g. "sparse,snappy"). Tensors are received as
+// is by default.
+const std::vector<TensorWireCodec>& AcceptedWireCodecs() {
+  static const std::vector<TensorWireCodec>* codecs = [] {
+    auto* codecs = new std::vector<TensorWireCodec>;
+    string spec;
+    Status s = ReadStringFromEnvVar("TF_RECV_TENSOR_WIRE_CODECS", "", &spec);
+    if (s.ok()) {
+      s = ParseTensorWireCodecs(spec, codecs);
+    }
+    if (!s.ok()) {
+      LOG(ERROR) << "Ignoring TF_RECV_TENSOR_WIRE_CODECS: " << s;
+      codecs->clear();
+    }
+    return codecs;
+  }();
+  return *codecs;
+}
+
 // Used only to retrieve tensors from remote processes.
 class RpcRecvTensorCall : public BaseRecvTensorCall {
  public:
@@ -69,6 +94,9 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
     req_.set_request_id(GetUniqueRequestId());
+    for (TensorWireCodec codec : AcceptedWireCodecs()) {
+      req_.add_accepted_wire_codecs(codec);
+    }
   }
 
   void Reset() {
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include <cstdio>
+#include <cstdlib>
 #include <functional>
 #include <string>
 #include <vector>
@@ -21,6 +22,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_session.h"
 #include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/graph/default_device.h"
@@ -82,6 +84,8 @@ void MakeGRPCCluster(const SessionOptions& options, int n,
       auto config = server.mutable_default_session_config();
       (*config->mutable_device_count())["CPU"] = num_cpus;
       (*config->mutable_device_count())["GPU"] = num_gpus;
+      // Chunked RecvTensor transfers are served from the response cache.
+      config->mutable_rpc_options()->set_cache_rpc_response(true);
 
       std::unique_ptr<ServerInterface> svr;
       TF_CHECK_OK(NewServer(server, &svr));
@@ -241,6 +245,35 @@ static void BM_RPC(::testing::benchmark::State& state) {
 }
 BENCHMARK(BM_RPC)->ArgPair(30, 2)->ArgPair(30, 1000)->ArgPair(30, 100000);
 
+// Sends large tensors between two workers, in chunks of at most
+// `chunk_bytes` (0 sends each tensor in a single response), and reports the
+// peak CPU memory in use.
+static void BM_LargeTensorRPC(::testing::benchmark::State& state) {
+  const int tensor_size = state.range(0);
+  const int chunk_bytes = state.range(1);
+
+  // The chunk size is read on every RecvTensor call.
+  setenv("TF_GRPC_RECV_TENSOR_CHUNK_BYTES",
+         strings::StrCat(chunk_bytes).c_str(), 1);
+  EnableCPUAllocatorStats();
+  cpu_allocator()->ClearStats();
+  BM_Helper(state, 2 /*width*/, 2 /*num_stages*/, tensor_size,
+            true /*multi-device*/);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          tensor_size * sizeof(float));
+  auto stats = cpu_allocator()->GetStats();
+  if (stats) {
+    state.counters["peak_bytes"] = stats->peak_bytes_in_use;
+  }
+  unsetenv("TF_GRPC_RECV_TENSOR_CHUNK_BYTES");
+}
+BENCHMARK(BM_LargeTensorRPC)
+    ->ArgPair(1 << 20, 0)
+    ->ArgPair(1 << 20, 1 << 20)
+    ->ArgPair(1 << 24, 0)
+    ->ArgPair(1 << 24, 1 << 20)
+    ->ArgPair(1 << 24, 4 << 20);
+
 static void BM_SingleDevice(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int num_stages = state.range(1);
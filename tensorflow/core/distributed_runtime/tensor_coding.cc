@@ -18,6 +18,7 @@ limitations under the License.
 #include "google/protobuf/any.pb.h"
 
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/distributed_runtime/tensor_wire_codec.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 
@@ -31,12 +32,14 @@ void TensorResponse::Clear() {
   alloc_attrs_ = AllocatorAttributes();
   allocator_ = nullptr;
   already_used_ = false;
+  chunk_destination_ = Tensor();
   ClearTensor();
 }
 
 void TensorResponse::ClearTensor() {
   meta_.Clear();
   tensor_ = Tensor();
+  chunk_bytes_ = -1;
 }
 
 void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
@@ -50,15 +53,77 @@ void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
   allocator_ = device_->GetAllocator(alloc_attrs_);
 }
 
+void TensorResponse::InitChunkDestination(const Tensor& tensor) {
+  Clear();
+  on_host_ = true;
+  chunk_destination_ = tensor;
+}
+
+bool TensorResponse::AllocateOrReuseTensor(DataType dtype,
+                                           const TensorShape& shape) {
+  if (chunk_destination_.IsInitialized()) {
+    if (chunk_destination_.dtype() != dtype ||
+        chunk_destination_.shape() != shape) {
+      return false;
+    }
+    tensor_ = chunk_destination_;
+    return true;
+  }
+  Tensor t(allocator_, dtype, shape);
+  tensor_ = std::move(t);
+  return true;
+}
+
+bool TensorResponse::CopyChunk(StringPiece chunk) {
+  StringPiece buf = tensor_.tensor_data();
+  const int64_t offset = meta_.chunk_offset();
+  if (offset < 0 ||
+      offset + static_cast<int64_t>(chunk.size()) >
+          static_cast<int64_t>(buf.size())) {
+    return false;
+  }
+  memcpy(const_cast<char*>(buf.data()) + offset, chunk.data(), chunk.size());
+  chunk_bytes_ = chunk.size();
+  return true;
+}
+
+Status TensorResponse::MaybeDecodeTensorContent() {
+  if (meta_.wire_codec() == TENSOR_WIRE_CODEC_NONE) return OkStatus();
+  Status s = DecodeTensorContent(meta_.wire_codec(),
+                                 meta_.encoded_tensor_content(), &tensor_);
+  meta_.clear_encoded_tensor_content();
+  return s;
+}
+
+Status TensorResponse::MaybeDecodeTensorContentToProto() {
+  if (meta_.wire_codec() == TENSOR_WIRE_CODEC_NONE) return OkStatus();
+  const TensorProto& proto = meta_.tensor();
+  if (!DataTypeCanUseMemcpy(proto.dtype()) ||
+      !TensorShape::IsValid(proto.tensor_shape())) {
+    return errors::InvalidArgument("Cannot decode tensor from response");
+  }
+  Tensor decoded(proto.dtype(), TensorShape(proto.tensor_shape()));
+  TF_RETURN_IF_ERROR(DecodeTensorContent(
+      meta_.wire_codec(), meta_.encoded_tensor_content(), &decoded));
+  meta_.clear_encoded_tensor_content();
+  decoded.AsProtoTensorContent(meta_.mutable_tensor());
+  return OkStatus();
+}
+
 Status TensorResponse::InitFrom(RecvTensorResponse* response) {
   Status s;
   meta_.Swap(response);
   if (on_host_) {
     if (!tensor_.FromProto(allocator_, meta_.tensor())) {
       s = errors::InvalidArgument("Cannot parse tensor from response");
+    } else {
+      s = MaybeDecodeTensorContent();
     }
   } else {
-    s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    s = MaybeDecodeTensorContentToProto();
+    if (s.ok()) {
+      s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    }
   }
   {
     TensorProto empty;
@@ -87,8 +152,10 @@ Status TensorResponse::ParseFrom(Source* source) {
     if (!meta_.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
       return errors::InvalidArgument("Cannot parse tensor from response");
     }
-    Status s =
-        device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    Status s = MaybeDecodeTensorContentToProto();
+    if (s.ok()) {
+      s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    }
     // Reduce memory usage for big tensors.
     {
       TensorProto empty;
@@ -101,9 +168,9 @@ Status TensorResponse::ParseFrom(Source* source) {
     ClearTensor();
   }
   already_used_ = true;
-  if (ParseFast(source)) return OkStatus();
+  if (ParseFast(source)) return MaybeDecodeTensorContent();
   meta_.Clear();
-  if (ParseSlow(source)) return OkStatus();
+  if (ParseSlow(source)) return MaybeDecodeTensorContent();
   return errors::InvalidArgument("Cannot parse tensor from response");
 }
 
@@ -153,10 +220,10 @@ bool TensorResponse::ParseTensorSubmessage(
     if (!p.second) {
       bool ok = (tag == 0);
       if (ok && !seen_tensor_content) {
-        // No tensor content: could be because it's a zero-length tensor
+        // No tensor content: could be because it's a zero-length tensor, or
+        // because the content follows in a chunk.
         TensorShape shape(tensor_meta->tensor_shape());
-        Tensor t(allocator_, tensor_meta->dtype(), shape);
-        tensor_ = std::move(t);
+        ok = AllocateOrReuseTensor(tensor_meta->dtype(), shape);
       }
       return ok;
     }
@@ -265,6 +332,50 @@ bool TensorResponse::ParseFast(Source* source) {
         meta_.set_require_ack(v != 0);
         break;
       }
+      case RecvTensorResponse::kChunkOffsetFieldNumber: {
+        protobuf_uint64 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint64(&v)) return false;
+        meta_.set_chunk_offset(static_cast<int64_t>(v));
+        break;
+      }
+      case RecvTensorResponse::kTensorChunkFieldNumber: {
+        // The chunk is read straight into tensor_, so the tensor metadata and
+        // the chunk offset must have been seen first.
+        if (wt != WIRETYPE_LENGTH_DELIMITED || !tensor_.IsInitialized() ||
+            !DataTypeCanUseMemcpy(tensor_.dtype())) {
+          return false;
+        }
+        int num_bytes;
+        if (!ReadVarintSizeAsInt(&input, &num_bytes)) return false;
+        StringPiece buf = tensor_.tensor_data();
+        const int64_t offset = meta_.chunk_offset();
+        if (offset < 0 ||
+            offset + num_bytes > static_cast<int64_t>(buf.size())) {
+          return false;
+        }
+        if (!input.ReadRaw(const_cast<char*>(buf.data()) + offset, num_bytes))
+          return false;
+        chunk_bytes_ = num_bytes;
+        break;
+      }
+      case RecvTensorResponse::kWireCodecFieldNumber: {
+        uint32 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint32(&v)) return false;
+        meta_.set_wire_codec(static_cast<TensorWireCodec>(v));
+        break;
+      }
+      case RecvTensorResponse::kEncodedTensorContentFieldNumber: {
+        // Decoded into tensor_ by ParseFrom() once the whole response has
+        // been parsed.
+        int num_bytes;
+        if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
+            !ReadVarintSizeAsInt(&input, &num_bytes) ||
+            !input.ReadString(meta_.mutable_encoded_tensor_content(),
+                              num_bytes)) {
+          return false;
+        }
+        break;
+      }
       default: {
         // Unknown tag, so don't handle we can't handle on the fast path
         return false;
@@ -280,11 +391,23 @@ bool TensorResponse::ParseSlow(Source* source) {
     return false;
   }
 
-  Tensor parsed(meta_.tensor().dtype());
-  if (!parsed.FromProto(allocator_, meta_.tensor())) {
-    return false;
+  if (chunk_destination_.IsInitialized() || !meta_.tensor_chunk().empty()) {
+    // A chunked response: the tensor content is in tensor_chunk.
+    if (!TensorShape::IsValid(meta_.tensor().tensor_shape()) ||
+        !DataTypeCanUseMemcpy(meta_.tensor().dtype()) ||
+        !AllocateOrReuseTensor(meta_.tensor().dtype(),
+                               TensorShape(meta_.tensor().tensor_shape())) ||
+        !CopyChunk(meta_.tensor_chunk())) {
+      return false;
+    }
+    meta_.clear_tensor_chunk();
+  } else {
+    Tensor parsed(meta_.tensor().dtype());
+    if (!parsed.FromProto(allocator_, meta_.tensor())) {
+      return false;
+    }
+    tensor_ = std::move(parsed);
   }
-  tensor_ = std::move(parsed);
 
   // Reduce memory usage for big tensors.
   {
@@ -45,6 +45,14 @@ class TensorResponse {
   // Initialize memory allocation related members.
   void InitAlloc(DeviceBase* d, const AllocatorAttributes& aa);
 
+  // Prepare to parse a chunked RecvTensorResponse (see
+  // RecvTensorRequest::max_chunk_bytes) whose tensor was allocated by an
+  // earlier response: ParseFrom writes the chunk directly into "tensor", at
+  // the response's chunk_offset, instead of allocating a new tensor.
+  // "tensor" must be a host tensor matching the dtype and shape of the
+  // response.
+  void InitChunkDestination(const Tensor& tensor);
+
   // Source provides a way for a particular RPC implementation to provide
   // received data to ParseFrom.
   class Source {
@@ -90,11 +98,29 @@ class TensorResponse {
   // Return pointer to the device hosting the tensor.
   DeviceBase* device() const { return device_; }
 
+  // Return true if the tensor is parsed into host memory.
+  bool on_host() const { return on_host_; }
+
+  // Return the number of bytes of tensor content carried by the parsed
+  // response if it was chunked, or -1 if it carried the whole tensor.
+  int64_t chunk_bytes() const { return chunk_bytes_; }
+
  private:
   bool ParseTensorSubmessage(protobuf::io::CodedInputStream* input,
                              TensorProto* tensor_meta);
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
+  // Writes "chunk" into tensor_ at meta_.chunk_offset().
+  bool CopyChunk(StringPiece chunk);
+  // Sets tensor_ to chunk_destination_ if initialized, and to a newly
+  // allocated tensor of the given dtype and shape otherwise.
+  bool AllocateOrReuseTensor(DataType dtype, const TensorShape& shape);
+  // If the response was encoded with a wire codec, decodes
+  // meta_.encoded_tensor_content() into tensor_.
+  Status MaybeDecodeTensorContent();
+  // Same as MaybeDecodeTensorContent(), but decodes into meta_.tensor(), for
+  // devices that make tensors from protos.
+  Status MaybeDecodeTensorContentToProto();
 
   bool on_host_ = false;
   DeviceBase* device_ = nullptr;
@@ -103,6 +129,8 @@ class TensorResponse {
   bool already_used_ = false;
   Tensor tensor_;
   RecvTensorResponse meta_;
+  Tensor chunk_destination_;
+  int64_t chunk_bytes_ = -1;
 };
 
 }  // namespace tensorflow
@@ -15,10 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 
+#include "tensorflow/core/distributed_runtime/tensor_wire_codec.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -156,6 +158,81 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(TensorResponseTest, Chunks) {
+  Tensor src(DT_FLOAT, TensorShape({10, 100}));
+  src.flat<float>().setRandom();
+  const StringPiece src_data = src.tensor_data();
+  const int64_t total_bytes = src_data.size();
+  const int64_t kChunkBytes = 1500;
+
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse first_response;
+  first_response.InitAlloc(&cpu_device, AllocatorAttributes());
+  for (int64_t offset = 0; offset < total_bytes; offset += kChunkBytes) {
+    RecvTensorResponse proto;
+    proto.mutable_tensor()->set_dtype(src.dtype());
+    src.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+    proto.set_chunk_offset(offset);
+    proto.set_tensor_chunk(string(src_data.substr(offset, kChunkBytes)));
+    string encoded;
+    proto.AppendToString(&encoded);
+    StringSource source(&encoded, 1024);
+
+    if (offset == 0) {
+      // The first chunk allocates the tensor.
+      TF_EXPECT_OK(first_response.ParseFrom(&source));
+      EXPECT_EQ(first_response.chunk_bytes(), kChunkBytes);
+    } else {
+      // The other chunks are written into it.
+      TensorResponse response;
+      response.InitChunkDestination(first_response.tensor());
+      TF_EXPECT_OK(response.ParseFrom(&source));
+      EXPECT_EQ(response.chunk_bytes(),
+                std::min(kChunkBytes, total_bytes - offset));
+    }
+  }
+  test::ExpectTensorEqual<float>(first_response.tensor(), src);
+}
+
+TEST_F(TensorResponseTest, ChunkOutOfRange) {
+  Tensor src(DT_FLOAT, TensorShape({10}));
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(src.dtype());
+  src.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.set_chunk_offset(32);
+  proto.set_tensor_chunk(string(16, 'x'));
+  string encoded;
+  proto.AppendToString(&encoded);
+  StringSource source(&encoded, 1024);
+
+  TensorResponse response;
+  response.InitChunkDestination(src);
+  EXPECT_FALSE(response.ParseFrom(&source).ok());
+}
+
+TEST_F(TensorResponseTest, WireCodec) {
+  Tensor src(DT_FLOAT, TensorShape({10, 100}));
+  src.flat<float>().setZero();
+  src.flat<float>()(5) = 1.0f;
+  src.flat<float>()(500) = 2.0f;
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(src.dtype());
+  src.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.set_wire_codec(TENSOR_WIRE_CODEC_SPARSE);
+  ASSERT_TRUE(EncodeTensorContent(TENSOR_WIRE_CODEC_SPARSE, src,
+                                  proto.mutable_encoded_tensor_content()));
+  string encoded;
+  proto.AppendToString(&encoded);
+  StringSource source(&encoded, 1024);
+
+  TensorResponse response;
+  DummyDevice cpu_device(Env::Default());
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  TF_EXPECT_OK(response.ParseFrom(&source));
+  test::ExpectTensorEqual<float>(response.tensor(), src);
+  EXPECT_TRUE(response.metadata().encoded_tensor_content().empty());
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
@@ -0,0 +1,202 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_wire_codec.h"
+
+#include <cstring>
+
+#include "absl/strings/str_split.h"
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Returns a pointer to the mutable content of "tensor".
+char* MutableTensorData(Tensor* tensor) {
+  return const_cast<char*>(tensor->tensor_data().data());
+}
+
+bool EncodeBFloat16(const Tensor& tensor, string* encoded) {
+  if (tensor.dtype() != DT_FLOAT) return false;
+  const int64_t num_elements = tensor.NumElements();
+  encoded->resize(num_elements * sizeof(bfloat16));
+  FloatToBFloat16(tensor.flat<float>().data(),
+                  reinterpret_cast<bfloat16*>(&(*encoded)[0]), num_elements);
+  return true;
+}
+
+Status DecodeBFloat16(StringPiece encoded, Tensor* tensor) {
+  const int64_t num_elements = tensor->NumElements();
+  if (tensor->dtype() != DT_FLOAT ||
+      encoded.size() != num_elements * sizeof(bfloat16)) {
+    return errors::InvalidArgument("Invalid bfloat16 encoding of a ",
+                                   DataTypeString(tensor->dtype()),
+                                   " tensor of shape ",
+                                   tensor->shape().DebugString());
+  }
+  BFloat16ToFloat(reinterpret_cast<const bfloat16*>(encoded.data()),
+                  tensor->flat<float>().data(), num_elements);
+  return OkStatus();
+}
+
+bool EncodeSnappy(const Tensor& tensor, string* encoded) {
+  StringPiece content = tensor.tensor_data();
+  return port::Snappy_Compress(content.data(), content.size(), encoded);
+}
+
+Status DecodeSnappy(StringPiece encoded, Tensor* tensor) {
+  StringPiece content = tensor->tensor_data();
+  size_t uncompressed_length;
+  if (!port::Snappy_GetUncompressedLength(encoded.data(), encoded.size(),
+                                          &uncompressed_length) ||
+      uncompressed_length != content.size() ||
+      !port::Snappy_Uncompress(encoded.data(), encoded.size(),
+                               MutableTensorData(tensor))) {
+    return errors::InvalidArgument("Invalid snappy encoding of a tensor of ",
+                                   content.size(), " bytes");
+  }
+  return OkStatus();
+}
+
+bool IsZero(const char* element, int element_size) {
+  for (int i = 0; i < element_size; ++i) {
+    if (element[i] != 0) return false;
+  }
+  return true;
+}
+
+bool EncodeSparse(const Tensor& tensor, string* encoded) {
+  StringPiece content = tensor.tensor_data();
+  const int element_size = DataTypeSize(tensor.dtype());
+  const int64_t num_elements = tensor.NumElements();
+  encoded->clear();
+  int64_t num_zeros = 0;
+  for (int64_t i = 0; i < num_elements; ++i) {
+    const char* element = content.data() + i * element_size;
+    if (IsZero(element, element_size)) {
+      ++num_zeros;
+      continue;
+    }
+    core::PutVarint64(encoded, num_zeros);
+    encoded->append(element, element_size);
+    num_zeros = 0;
+    // Give up as soon as the tensor turns out to be too dense.
+    if (encoded->size() >= content.size()) return false;
+  }
+  return true;
+}
+
+Status DecodeSparse(StringPiece encoded, Tensor* tensor) {
+  StringPiece content = tensor->tensor_data();
+  char* data = MutableTensorData(tensor);
+  const int element_size = DataTypeSize(tensor->dtype());
+  const uint64 num_elements = tensor->NumElements();
+  memset(data, 0, content.size());
+  uint64 next_element = 0;
+  while (!encoded.empty()) {
+    uint64 num_zeros;
+    if (!core::GetVarint64(&encoded, &num_zeros) ||
+        num_zeros >= num_elements - next_element ||
+        encoded.size() < static_cast<size_t>(element_size)) {
+      return errors::InvalidArgument("Invalid sparse encoding of a tensor of ",
+                                     num_elements, " elements");
+    }
+    next_element += num_zeros;
+    memcpy(data + next_element * element_size, encoded.data(), element_size);
+    encoded.remove_prefix(element_size);
+    ++next_element;
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
+bool EncodeTensorContent(TensorWireCodec codec, const Tensor& tensor,
+                         string* encoded) {
+  if (!DataTypeCanUseMemcpy(tensor.dtype())) return false;
+  bool ok = false;
+  switch (codec) {
+    case TENSOR_WIRE_CODEC_BFLOAT16:
+      ok = EncodeBFloat16(tensor, encoded);
+      break;
+    case TENSOR_WIRE_CODEC_SNAPPY:
+      ok = EncodeSnappy(tensor, encoded);
+      break;
+    case TENSOR_WIRE_CODEC_SPARSE:
+      ok = EncodeSparse(tensor, encoded);
+      break;
+    default:
+      break;
+  }
+  return ok && encoded->size() < tensor.TotalBytes();
+}
+
+Status DecodeTensorContent(TensorWireCodec codec, StringPiece encoded,
+                           Tensor* tensor) {
+  if (!DataTypeCanUseMemcpy(tensor->dtype())) {
+    return errors::InvalidArgument("Cannot decode a tensor of type ",
+                                   DataTypeString(tensor->dtype()));
+  }
+  switch (codec) {
+    case TENSOR_WIRE_CODEC_BFLOAT16:
+      return DecodeBFloat16(encoded, tensor);
+    case TENSOR_WIRE_CODEC_SNAPPY:
+      return DecodeSnappy(encoded, tensor);
+    case TENSOR_WIRE_CODEC_SPARSE:
+      return DecodeSparse(encoded, tensor);
+    default:
+      return errors::InvalidArgument("Unsupported tensor wire codec: ",
+                                     static_cast<int>(codec));
+  }
+}
+
+Status ParseTensorWireCodecs(StringPiece spec,
+                             std::vector<TensorWireCodec>* codecs) {
+  codecs->clear();
+  for (StringPiece name : absl::StrSplit(spec, ',', absl::SkipEmpty())) {
+    if (name == "bfloat16") {
+      codecs->push_back(TENSOR_WIRE_CODEC_BFLOAT16);
+    } else if (name == "snappy") {
+      codecs->push_back(TENSOR_WIRE_CODEC_SNAPPY);
+    } else if (name == "sparse") {
+      codecs->push_back(TENSOR_WIRE_CODEC_SPARSE);
+    } else {
+      return errors::InvalidArgument("Unknown tensor wire codec: ", name);
+    }
+  }
+  return OkStatus();
+}
+
+const char* TensorWireCodecName(TensorWireCodec codec) {
+  switch (codec) {
+    case TENSOR_WIRE_CODEC_NONE:
+      return "none";
+    case TENSOR_WIRE_CODEC_BFLOAT16:
+      return "bfloat16";
+    case TENSOR_WIRE_CODEC_SNAPPY:
+      return "snappy";
+    case TENSOR_WIRE_CODEC_SPARSE:
+      return "sparse";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,53 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_WIRE_CODEC_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_WIRE_CODEC_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+
+// Encodes the content of "tensor" with "codec" into "*encoded", to be sent as
+// RecvTensorResponse::encoded_tensor_content. Returns false if "codec" does
+// not apply to the dtype of "tensor", or if it would not make the content
+// smaller, in which case "*encoded" is unspecified and the tensor should be
+// sent as is.
+bool EncodeTensorContent(TensorWireCodec codec, const Tensor& tensor,
+                         string* encoded);
+
+// Decodes "encoded", produced by EncodeTensorContent() with "codec", into
+// "*tensor", which must be an initialized host tensor with the dtype and
+// shape of the encoded tensor.
+Status DecodeTensorContent(TensorWireCodec codec, StringPiece encoded,
+                           Tensor* tensor);
+
+// Parses "spec", a comma-separated list of codec names (see
+// TensorWireCodecName()), into "*codecs".
+Status ParseTensorWireCodecs(StringPiece spec,
+                             std::vector<TensorWireCodec>* codecs);
+
+// Returns a short name for "codec", e.g. "snappy".
+const char* TensorWireCodecName(TensorWireCodec codec);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_WIRE_CODEC_H_
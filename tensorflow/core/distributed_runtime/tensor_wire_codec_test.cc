@@ -0,0 +1,105 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_wire_codec.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Encodes "t" with "codec", expecting it to apply, and returns the decoded
+// tensor.
+Tensor RoundTrip(TensorWireCodec codec, const Tensor& t) {
+  string encoded;
+  EXPECT_TRUE(EncodeTensorContent(codec, t, &encoded));
+  EXPECT_LT(encoded.size(), t.TotalBytes());
+  Tensor decoded(t.dtype(), t.shape());
+  TF_EXPECT_OK(DecodeTensorContent(codec, encoded, &decoded));
+  return decoded;
+}
+
+TEST(TensorWireCodecTest, BFloat16) {
+  Tensor t = test::AsTensor<float>({1.0f, -2.5f, 0.0f, 1.0f / 3},
+                                   TensorShape({2, 2}));
+  Tensor decoded = RoundTrip(TENSOR_WIRE_CODEC_BFLOAT16, t);
+  // Values are truncated to the 8 bits of precision of bfloat16.
+  test::ExpectTensorNear<float>(t, decoded, 1e-2);
+  EXPECT_EQ(decoded.flat<float>()(0), 1.0f);
+  EXPECT_EQ(decoded.flat<float>()(1), -2.5f);
+
+  string encoded;
+  EXPECT_FALSE(EncodeTensorContent(TENSOR_WIRE_CODEC_BFLOAT16,
+                                   test::AsTensor<int32>({1, 2, 3}), &encoded));
+}
+
+TEST(TensorWireCodecTest, Snappy) {
+  string compressed;
+  if (!port::Snappy_Compress("", 0, &compressed)) {
+    GTEST_SKIP() << "Snappy is not available";
+  }
+  Tensor t(DT_INT64, TensorShape({100, 10}));
+  auto flat = t.flat<int64_t>();
+  for (int i = 0; i < flat.size(); ++i) flat(i) = i % 7;
+  test::ExpectTensorEqual<int64_t>(t, RoundTrip(TENSOR_WIRE_CODEC_SNAPPY, t));
+}
+
+TEST(TensorWireCodecTest, Sparse) {
+  Tensor t(DT_FLOAT, TensorShape({50, 20}));
+  t.flat<float>().setZero();
+  t.flat<float>()(0) = 1.0f;
+  t.flat<float>()(17) = -3.0f;
+  t.flat<float>()(999) = 2.0f;
+  test::ExpectTensorEqual<float>(t, RoundTrip(TENSOR_WIRE_CODEC_SPARSE, t));
+
+  // Dense tensors are sent as is.
+  t.flat<float>().setConstant(1.0f);
+  string encoded;
+  EXPECT_FALSE(EncodeTensorContent(TENSOR_WIRE_CODEC_SPARSE, t, &encoded));
+}
+
+TEST(TensorWireCodecTest, InvalidEncoding) {
+  Tensor t(DT_FLOAT, TensorShape({4}));
+  EXPECT_FALSE(
+      DecodeTensorContent(TENSOR_WIRE_CODEC_BFLOAT16, "abc", &t).ok());
+  // 4 zeros, then a value past the end of the tensor.
+  string encoded = "\x04";
+  encoded.append(sizeof(float), 'x');
+  EXPECT_FALSE(DecodeTensorContent(TENSOR_WIRE_CODEC_SPARSE, encoded, &t).ok());
+  // A truncated value.
+  encoded = "\x01";
+  encoded.append(sizeof(float) - 1, 'x');
+  EXPECT_FALSE(DecodeTensorContent(TENSOR_WIRE_CODEC_SPARSE, encoded, &t).ok());
+  EXPECT_FALSE(DecodeTensorContent(TENSOR_WIRE_CODEC_NONE, "", &t).ok());
+}
+
+TEST(TensorWireCodecTest, ParseTensorWireCodecs) {
+  std::vector<TensorWireCodec> codecs;
+  TF_EXPECT_OK(ParseTensorWireCodecs("sparse,snappy", &codecs));
+  EXPECT_EQ(codecs, std::vector<TensorWireCodec>(
+                        {TENSOR_WIRE_CODEC_SPARSE, TENSOR_WIRE_CODEC_SNAPPY}));
+  TF_EXPECT_OK(ParseTensorWireCodecs("", &codecs));
+  EXPECT_TRUE(codecs.empty());
+  EXPECT_FALSE(ParseTensorWireCodecs("bfloat16,lz4", &codecs).ok());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -55,6 +55,7 @@ class EventMgr;
 class OpKernelContext;
 class ResourceMgr;
 class ScopedAllocatorMgr;
+class StepArenaAllocatorMgr;
 class TensorProto;
 
 // A wrapper for an Eigen Gpu Device that includes per-op state. The
@@ -209,6 +210,13 @@ class DeviceBase {
 
   virtual ScopedAllocatorMgr* GetScopedAllocatorMgr() const { return nullptr; }
 
+  // Returns the manager of the per-step arenas from which executors allocate
+  // the intermediate tensors of a step, or nullptr if the device does not use
+  // them.
+  virtual StepArenaAllocatorMgr* GetStepArenaAllocatorMgr() const {
+    return nullptr;
+  }
+
   virtual bool has_eigen_cpu_device() const {
     return !eigen_cpu_devices_.empty();
   }
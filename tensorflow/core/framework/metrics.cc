@@ -52,6 +52,25 @@ auto* graph_pending_queue_length_histogram = tsl::monitoring::Sampler<0>::New(
     // Power of 1.5 with bucket count 30 (> 191k)
     {tsl::monitoring::Buckets::Exponential(1, 1.5, 30)});
 
+auto* static_schedule_step_time_usecs = tsl::monitoring::Sampler<1>::New(
+    {"/tensorflow/core/static_schedule_step_time_usecs",
+     "The wall-clock time of steps of executors that record a static schedule, "
+     "in microseconds.",
+     "schedule"},
+    // Power of 2 with bucket count 30 (> 17 minutes)
+    {tsl::monitoring::Buckets::Exponential(1, 2, 30)});
+
+auto* static_schedule_saving_time_usecs = tsl::monitoring::Counter<0>::New(
+    "/tensorflow/core/static_schedule_saving_time_usecs",
+    "The estimated step time saved by replaying static schedules instead of "
+    "scheduling nodes dynamically, in microseconds.");
+
+auto* static_memory_plan_allocations = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/static_memory_plan_allocations",
+    "The number of output allocations of executors that follow a static "
+    "memory plan, by whether they were served from the planned buffer.",
+    "result");
+
 auto* graph_run_input_tensor_bytes = tsl::monitoring::Sampler<0>::New(
     {"/tensorflow/core/graph_run_input_tensor_bytes",
      "The size of input tensors in bytes."},
@@ -89,6 +108,14 @@ auto* tf_data_bytes_read_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/bytes_read",
     "The number of bytes read by tf.data Dataset sources.", "name");
 
+auto* tf_data_read_bandwidth_sampler = tsl::monitoring::Sampler<1>::New(
+    {"/tensorflow/data/read_bandwidth",
+     "The bandwidth (in MB/s) achieved by tf.data Dataset sources while they "
+     "have reads in flight.",
+     "name"},
+    // Power of 2 with bucket count 14 (from 1 MB/s to about 8 GB/s).
+    {tsl::monitoring::Buckets::Exponential(1, 2, 14)});
+
 auto* tf_data_bytes_fetched_counter = tsl::monitoring::Counter<0>::New(
     "/tensorflow/data/bytes_fetched",
     "The number of bytes fetched from tf.data Dataset iterator.");
@@ -166,6 +193,21 @@ auto* tf_data_buffered_vs_budget_ratio_histogram =
         {tsl::monitoring::Buckets::Explicit(
             {0.0, 0.2, 0.4, 0.6, 0.8, 1.0, 1.2, 1.4, 1.6, 1.8, 2.0})});
 
+auto* tf_data_padded_values_counter = tsl::monitoring::Counter<2>::New(
+    "/tensorflow/data/padded_values",
+    "The number of values in the batches of padding batch transformations, "
+    "before (\"real\") and after (\"padded\") padding.",
+    "name", "kind");
+
+auto* tf_data_padding_efficiency_histogram = tsl::monitoring::Sampler<1>::New(
+    {"/tensorflow/data/padding_efficiency",
+     "Ratio of real values over padded values in the batches of padding "
+     "batch transformations.",
+     "name"},
+    // Uniform linear buckets with count 10 from 0 to 1
+    {tsl::monitoring::Buckets::Explicit(
+        {0.0, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 1.0})});
+
 auto* tf_data_iterator_busy_counter = tsl::monitoring::Counter<0>::New(
     "/tensorflow/data/iterator_busy",
     "The time (in microseconds) during which a "
@@ -391,6 +433,18 @@ auto* test_counters = tsl::monitoring::Counter<2>::New(
     "/tensorflow/core/test_counters", "Counters used for testing.", "name",
     "label");
 
+auto* recv_tensor_wire_codec_encoded_bytes = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/recv_tensor_wire_codec_encoded_bytes",
+    "The number of bytes of tensor content sent in RecvTensor responses after "
+    "encoding with a wire codec.",
+    "codec");
+
+auto* recv_tensor_wire_codec_saved_bytes = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/recv_tensor_wire_codec_saved_bytes",
+    "The number of bytes of tensor content saved in RecvTensor responses by "
+    "encoding with a wire codec.",
+    "codec");
+
 }  // namespace
 
 auto* tpu_op_error_counter = tsl::monitoring::Counter<2>::New(
@@ -464,6 +518,11 @@ tsl::monitoring::CounterCell* GetTFDataBytesReadCounter(const string& name) {
   return tf_data_bytes_read_counter->GetCell(name);
 }
 
+tsl::monitoring::SamplerCell* GetTFDataReadBandwidthSampler(
+    const string& name) {
+  return tf_data_read_bandwidth_sampler->GetCell(name);
+}
+
 tsl::monitoring::CounterCell* GetTFDataElementsCounter(const string& name) {
   return tf_data_elements_counter->GetCell(name);
 }
@@ -532,6 +591,17 @@ void RecordTFDataAutotuneUsedRamBudgetRatio(const double ratio) {
   tf_data_used_vs_budget_ratio_histogram_cell->Add(ratio);
 }
 
+void RecordTFDataPaddingEfficiency(const string& name, int64_t num_values,
+                                   int64_t num_padded_values) {
+  tf_data_padded_values_counter->GetCell(name, "real")->IncrementBy(num_values);
+  tf_data_padded_values_counter->GetCell(name, "padded")
+      ->IncrementBy(num_padded_values);
+  if (num_padded_values > 0) {
+    tf_data_padding_efficiency_histogram->GetCell(name)->Add(
+        static_cast<double>(num_values) / num_padded_values);
+  }
+}
+
 void RecordTFDataAutotuneMaxBufferBudgetRatio(const double ratio) {
   static auto* tf_data_buffered_vs_budget_ratio_histogram_cell =
       tf_data_buffered_vs_budget_ratio_histogram->GetCell();
@@ -700,6 +770,14 @@ void RecordGraphOutputTensors(const size_t size) {
   graph_run_output_tensor_bytes_cell->Add(size);
 }
 
+void RecordRecvTensorWireCodecBytes(const string& codec, int64_t raw_bytes,
+                                    int64_t encoded_bytes) {
+  recv_tensor_wire_codec_encoded_bytes->GetCell(codec)->IncrementBy(
+      encoded_bytes);
+  recv_tensor_wire_codec_saved_bytes->GetCell(codec)->IncrementBy(
+      raw_bytes - encoded_bytes);
+}
+
 void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica) {
   xla_tpu_spmd_cores_per_replica->GetCell(absl::StrCat(cores_per_replica))
       ->IncrementBy(1);
@@ -723,6 +801,30 @@ void UpdateGraphPendingQueueLength(uint64 len) {
   graph_pending_queue_length_cell->Add(len);
 }
 
+void UpdateStaticScheduleStepTime(bool replayed, uint64 running_time_usecs) {
+  static auto* static_cell =
+      static_schedule_step_time_usecs->GetCell("static");
+  static auto* dynamic_cell =
+      static_schedule_step_time_usecs->GetCell("dynamic");
+  (replayed ? static_cell : dynamic_cell)->Add(running_time_usecs);
+}
+
+void UpdateStaticScheduleSavingTime(uint64 saving_time_usecs) {
+  static auto* static_schedule_saving_time_usecs_cell =
+      static_schedule_saving_time_usecs->GetCell();
+  static_schedule_saving_time_usecs_cell->IncrementBy(saving_time_usecs);
+}
+
+void UpdateStaticMemoryPlanAllocations(int64_t num_planned,
+                                       int64_t num_fallback) {
+  static auto* planned_cell =
+      static_memory_plan_allocations->GetCell("planned");
+  static auto* fallback_cell =
+      static_memory_plan_allocations->GetCell("fallback");
+  if (num_planned > 0) planned_cell->IncrementBy(num_planned);
+  if (num_fallback > 0) fallback_cell->IncrementBy(num_fallback);
+}
+
 void UpdateGraphBuildTime(const uint64 running_time_usecs) {
   if (running_time_usecs > 0) {
     static auto* build_graph_calls_cell = build_graph_calls->GetCell();
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/types.h"
@@ -65,6 +66,12 @@ monitoring::CounterCell* GetTFDataBytesProducedCounter(const string& name);
 // TODO(jsimsa): Remove this now that we have GetTFDataBytesConsumedCounter?
 monitoring::CounterCell* GetTFDataBytesReadCounter(const string& name);
 
+// Returns a sampler that can be used to record the bandwidth (in MB/s) that a
+// tf.data.Dataset source achieves while it has reads in flight.
+//
+// The `name` argument identifies the Dataset type (e.g. "TFRecord").
+monitoring::SamplerCell* GetTFDataReadBandwidthSampler(const string& name);
+
 // Returns a counter than can be used to record the number of elements produced
 // by a tf.data.Dataset.
 //
@@ -109,6 +116,12 @@ void RecordTFDataAutotuneUsedRamBudgetRatio(const double ratio);
 // bytes over the ram budget.
 void RecordTFDataAutotuneMaxBufferBudgetRatio(const double ratio);
 
+// Records the number of values of a batch produced by the padding batch
+// transformation `name` before and after padding, to track how much of the
+// batch is padding.
+void RecordTFDataPaddingEfficiency(const string& name, int64_t num_values,
+                                   int64_t num_padded_values);
+
 // Records the number of times each tf.data fingerprint is used
 // to measure duplicate pre-processing.
 //
@@ -234,12 +247,31 @@ void RecordParseRaggedFeature(int64_t num_features);
 void RecordGraphInputTensors(const size_t size);
 void RecordGraphOutputTensors(const size_t size);
 
+// Records the size of the content of a tensor sent in a RecvTensor response
+// before and after encoding it with the wire codec `codec`.
+void RecordRecvTensorWireCodecBytes(const string& codec, int64_t raw_bytes,
+                                    int64_t encoded_bytes);
+
 // Records the number of cores requested by graphs with XLA SPMD enabled.
 void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica);
 
 void UpdateGraphExecTime(const uint64 running_time_usecs);
 void UpdateGraphPendingQueueLength(uint64 len);
 
+// Records the wall-clock time of a step of an executor that records a static
+// schedule. `replayed` is true if the step replayed the schedule and false if
+// it was scheduled dynamically for comparison.
+void UpdateStaticScheduleStepTime(bool replayed, uint64 running_time_usecs);
+
+// Updates the estimated step time saved by replaying static schedules.
+void UpdateStaticScheduleSavingTime(uint64 saving_time_usecs);
+
+// Records the output allocations of a step that follows a static memory plan:
+// `num_planned` were placed in the planned buffer, and `num_fallback` were
+// served by the regular allocator instead.
+void UpdateStaticMemoryPlanAllocations(int64_t num_planned,
+                                       int64_t num_fallback);
+
 // Records that one output of an op of type `op_name` was unused.
 void RecordUnusedOutput(const string& op_name);
 
@@ -1641,6 +1641,7 @@ void Node::FlushMetrics() {
   metrics_.record_bytes_consumed(bytes_consumed_);
   metrics_.record_bytes_produced(bytes_produced_);
   metrics_.record_num_elements(num_elements_);
+  metrics_.record_read_bandwidth(bytes_read_, read_time_);
 }
 
 double Node::OutputTime(Node::NodeValues* input_times,
@@ -2351,6 +2352,10 @@ void Model::Optimize(AutotuneAlgorithm algorithm,
       OptimizeStageBased(snapshot, optimization_params, cancellation_manager,
                          ram_budget_manager);
       break;
+    case AutotuneAlgorithm::MEMORY_AWARE:
+      OptimizeMemoryAware(snapshot, optimization_params, cancellation_manager,
+                          ram_budget_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -3109,6 +3114,111 @@ void Model::OptimizeMaxParallelism(
                           should_stop);
 }
 
+void Model::OptimizeMemoryAware(std::shared_ptr<Node> snapshot,
+                                const OptimizationParams& optimization_params,
+                                CancellationManager* cancellation_manager,
+                                RamBudgetManager& ram_budget_manager) {
+  VLOG(2) << "Starting memory-aware optimization of tunable parameters.";
+  const double processing_time = TotalProcessingTime(snapshot);
+  auto parameters = CollectTunableParameters(snapshot);
+  MaybeSyncStateValuesToValues(&parameters);
+  if (parameters.empty()) {
+    VLOG(2) << "There are no tunable parameters.";
+    return;
+  }
+  VLOG(2) << "Number of tunable parameters: " << parameters.size();
+
+  // A parameter will only be incremented if the output latency improvement is
+  // greater than this constant.
+  constexpr double kMinDelta = 1.0L;
+  // Lower bound of the cost of a step, so that steps which take neither cores
+  // nor memory are ranked by their output latency improvement.
+  constexpr double kMinCost = 1e-6L;
+
+  const double cpu_budget =
+      std::max<double>(optimization_params.cpu_budget(), 1.0);
+  const double ram_budget = optimization_params.ram_budget();
+
+  // Initialize the parameter values to minimal before tuning.
+  double cores = 0.0L;
+  for (auto& pair : parameters) {
+    pair.second->value = pair.second->min;
+    if (pair.second->name == kParallelism) {
+      cores += pair.second->value;
+    }
+  }
+  double buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+  while (!cancellation_manager->IsCancelled()) {
+    const double output_time =
+        OutputTime(snapshot, optimization_params.model_input_time(),
+                   /*gradients=*/nullptr);
+    if (output_time < processing_time / cpu_budget) {
+      metrics::RecordTFDataAutotuneStoppingCriteria("output_time");
+      break;
+    }
+
+    Parameter* best_parameter = nullptr;
+    double best_gain = 0.0L;
+    double best_buffered_bytes = buffered_bytes;
+    bool budget_reached = false;
+    for (auto& pair : parameters) {
+      Parameter* parameter = pair.second.get();
+      if (parameter->value >= parameter->max) {
+        continue;
+      }
+      const double step_cores = parameter->name == kParallelism ? 1.0L : 0.0L;
+      if (cores + step_cores > cpu_budget) {
+        budget_reached = true;
+        continue;
+      }
+      parameter->value++;
+      const double new_output_time =
+          OutputTime(snapshot, optimization_params.model_input_time(),
+                     /*gradients=*/nullptr);
+      const double new_buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+      parameter->value--;
+      if (new_buffered_bytes > ram_budget) {
+        budget_reached = true;
+        continue;
+      }
+      const double delta = output_time - new_output_time;
+      if (delta <= kMinDelta) {
+        continue;
+      }
+      const double cost =
+          std::max(step_cores / cpu_budget +
+                       std::max(new_buffered_bytes - buffered_bytes, 0.0) /
+                           std::max(ram_budget, 1.0),
+                   kMinCost);
+      const double gain = delta / cost;
+      if (gain > best_gain) {
+        best_gain = gain;
+        best_parameter = parameter;
+        best_buffered_bytes = new_buffered_bytes;
+      }
+    }
+    if (!best_parameter) {
+      if (budget_reached) {
+        metrics::RecordTFDataAutotuneStoppingCriteria("budget_reached");
+      } else {
+        metrics::RecordTFDataAutotuneStoppingCriteria("local_maximum_reached");
+      }
+      VLOG(2) << "Failed to find a tunable parameter that would further "
+                 "decrease the output time within the CPU and RAM budgets. The "
+                 "optimization attempt will stop now.";
+      break;
+    }
+    best_parameter->value++;
+    if (best_parameter->name == kParallelism) {
+      cores += 1.0L;
+    }
+    buffered_bytes = best_buffered_bytes;
+  }
+  if (ram_budget_manager.RequestModelAllocation(buffered_bytes)) {
+    UpdateStateValues(&parameters);
+  }
+}
+
 double Model::OutputTime(std::shared_ptr<Node> node, double model_input_time,
                          Model::ParameterGradients* gradients) {
   // To store the input time for each node.
@@ -225,6 +225,37 @@ class RamBudgetManager {
     return true;
   }
 
+  // Requests `delta_bytes` additional bytes for buffers that can move their
+  // contents out of memory, such as a shuffle buffer with a spill directory.
+  // `delta_bytes` can be negative to release bytes.
+  //
+  // Spillable bytes have the lowest priority: they are served from whatever the
+  // model and the legacy prefetch autotuners leave over, and those allocations
+  // do not take them into account. When the other allocations (or a smaller
+  // budget) leave the spillable bytes over budget, the buffers are expected to
+  // spill and release `SpillableBytesOverBudget()` bytes.
+  //
+  // Returns whether there were enough bytes left in the budget to serve the
+  // request. If not, no bytes are allocated.
+  bool RequestSpillableBytes(int64_t delta_bytes) {
+    mutex_lock l(mu_);
+    if (delta_bytes > budget_ - legacy_prefetch_allocated_ - model_allocated_ -
+                          spillable_allocated_) {
+      return false;
+    }
+    spillable_allocated_ += delta_bytes;
+    return true;
+  }
+
+  // The number of spillable bytes that no longer fit in the budget left over by
+  // the model and the legacy prefetch autotuners.
+  int64_t SpillableBytesOverBudget() const {
+    tf_shared_lock l(mu_);
+    const int64_t available = std::max<int64_t>(
+        0, budget_ - legacy_prefetch_allocated_ - model_allocated_);
+    return std::max<int64_t>(0, spillable_allocated_ - available);
+  }
+
   // The total number of bytes that the model could potentially use.
   int64_t AvailableModelRam() const {
     tf_shared_lock l(mu_);
@@ -241,7 +272,8 @@ class RamBudgetManager {
     mutex_lock l(mu_);
     return absl::StrCat("RamBudgetManager: budget_: ", budget_,
                         " prefetch allocated: ", legacy_prefetch_allocated_,
-                        " model allocated: ", model_allocated_);
+                        " model allocated: ", model_allocated_,
+                        " spillable allocated: ", spillable_allocated_);
   }
 
  private:
@@ -251,6 +283,8 @@ class RamBudgetManager {
   int64_t legacy_prefetch_allocated_ TF_GUARDED_BY(mu_) = 0;
   // Number of bytes allocated by the model.
   int64_t model_allocated_ TF_GUARDED_BY(mu_) = 0;
+  // Number of bytes allocated by spillable buffers.
+  int64_t spillable_allocated_ TF_GUARDED_BY(mu_) = 0;
 };
 
 // Abstract representation of a TensorFlow input pipeline node. It collects
@@ -302,6 +336,8 @@ class Node {
         buffered_elements_high_(std::numeric_limits<int64_t>::min()),
         bytes_consumed_(0),
         bytes_produced_(0),
+        bytes_read_(0),
+        read_time_(0),
         num_elements_(0),
         processing_time_(0),
         record_metrics_(true),
@@ -388,6 +424,18 @@ class Node {
     return bytes_produced_;
   }
 
+  // Returns the number of bytes read from storage by the node.
+  int64_t bytes_read() const TF_LOCKS_EXCLUDED(mu_) { return bytes_read_; }
+
+  // Returns the bandwidth (in bytes per second) that the node achieved while it
+  // had reads from storage in flight, or 0 if it has not read anything.
+  double read_bandwidth() const TF_LOCKS_EXCLUDED(mu_) {
+    const int64_t read_time = read_time_;
+    if (read_time <= 0) return 0.0;
+    return static_cast<double>(bytes_read_) * EnvTime::kSecondsToNanos /
+           read_time;
+  }
+
   // Indicates whether the node has tunable parameters.
   bool has_tunable_parameters() const TF_LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
@@ -440,6 +488,13 @@ class Node {
     bytes_produced_ += num_bytes;
   }
 
+  // Records that the node read the given number of bytes from storage, and
+  // had reads in flight for the given time.
+  void record_bytes_read(int64_t num_bytes, int64_t time_nanos) {
+    bytes_read_ += num_bytes;
+    read_time_ += time_nanos;
+  }
+
   // Records the change in this node's buffer.
   void record_buffer_event(int64_t bytes_delta, int64_t elements_delta) {
     buffered_bytes_ += bytes_delta;
@@ -631,12 +686,15 @@ class Node {
   class Metrics {
    public:
     explicit Metrics(const string& name)
-        : bytes_consumed_counter_(metrics::GetTFDataBytesConsumedCounter(name)),
+        : name_(name),
+          bytes_consumed_counter_(metrics::GetTFDataBytesConsumedCounter(name)),
           bytes_produced_counter_(metrics::GetTFDataBytesProducedCounter(name)),
           num_elements_counter_(metrics::GetTFDataElementsCounter(name)),
           recorded_bytes_consumed_(0),
           recorded_bytes_produced_(0),
-          recorded_num_elements_(0) {}
+          recorded_num_elements_(0),
+          recorded_bytes_read_(0),
+          recorded_read_time_(0) {}
 
     // Expects the total number of bytes consumed and records the delta since
     // last invocation.
@@ -662,13 +720,29 @@ class Node {
       num_elements_counter_->IncrementBy(delta);
     }
 
+    // Expects the total number of bytes read and the total time during which
+    // reads were in flight, and records the bandwidth since last invocation.
+    void record_read_bandwidth(int64_t total_bytes, int64_t total_nanos) {
+      const int64_t delta_bytes =
+          total_bytes - recorded_bytes_read_.exchange(total_bytes);
+      const int64_t delta_nanos =
+          total_nanos - recorded_read_time_.exchange(total_nanos);
+      if (delta_bytes <= 0 || delta_nanos <= 0) return;
+      // Bytes per nanosecond to MB/s.
+      metrics::GetTFDataReadBandwidthSampler(name_)->Add(
+          1e3 * static_cast<double>(delta_bytes) / delta_nanos);
+    }
+
    private:
+    const string name_;
     monitoring::CounterCell* const bytes_consumed_counter_;
     monitoring::CounterCell* const bytes_produced_counter_;
     monitoring::CounterCell* const num_elements_counter_;
     std::atomic<int64_t> recorded_bytes_consumed_;
     std::atomic<int64_t> recorded_bytes_produced_;
     std::atomic<int64_t> recorded_num_elements_;
+    std::atomic<int64_t> recorded_bytes_read_;
+    std::atomic<int64_t> recorded_read_time_;
   };
 
   // Computes the exponential moving average of processing time per element.
@@ -825,6 +899,9 @@ class Node {
   std::atomic<int64_t> buffered_elements_high_;
   std::atomic<int64_t> bytes_consumed_;
   std::atomic<int64_t> bytes_produced_;
+  std::atomic<int64_t> bytes_read_;
+  // Time (in nanoseconds) during which the node had reads in flight.
+  std::atomic<int64_t> read_time_;
   std::atomic<int64_t> num_elements_;
   std::atomic<int64_t> processing_time_;
   std::atomic<bool> record_metrics_;
@@ -1100,6 +1177,21 @@ class Model {
                               CancellationManager* cancellation_manager,
                               RamBudgetManager& ram_budget_manager);
 
+  // This optimization algorithm starts by setting all tunable parameters to
+  // the minimum value. It then repeatedly increments the parameter with the
+  // largest decrease in output time per unit of cost, where the cost of a step
+  // is the fraction of the CPU budget taken by the extra parallelism plus the
+  // fraction of the RAM budget taken by the extra buffered bytes. The buffered
+  // bytes of a node are estimated from the average size of the elements that it
+  // produced. Steps that would exceed either budget are not considered, and the
+  // process is repeated until no step decreases the output time or the
+  // projected output time is less than the processing time needed to produce an
+  // element divided by CPU budget.
+  void OptimizeMemoryAware(std::shared_ptr<Node> snapshot,
+                           const OptimizationParams& optimization_params,
+                           CancellationManager* cancellation_manager,
+                           RamBudgetManager& ram_budget_manager);
+
   // This optimization starts by setting all tunable parallelism parameters to
   // their minimum values. It then repeatedly increases the parallelism
   // parameter of the longest stage by 1 until either the longest stage is
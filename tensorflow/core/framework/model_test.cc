@@ -23,6 +23,7 @@ limitations under the License.
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -38,6 +39,7 @@ namespace model {
 namespace {
 
 using ::tensorflow::monitoring::testing::CellReader;
+using ::tensorflow::monitoring::testing::Histogram;
 using ::testing::AllOf;
 using ::testing::HasSubstr;
 
@@ -1358,7 +1360,116 @@ TEST_P(OptimizeZeroRamBudgetTest, Model) {
 }
 
 INSTANTIATE_TEST_SUITE_P(Test, OptimizeZeroRamBudgetTest,
-                         ::testing::Values(0, 1, 2, 3));
+                         ::testing::Values(0, 1, 2, 3, 5));
+
+// A stage of a simulated pipeline, which records the same processing time and
+// element size for each of its elements.
+struct SimulatedStage {
+  // Name of the tunable parameter of the stage, `kParallelism` or
+  // `kBufferSize`.
+  std::string parameter;
+  int64_t processing_time_nsec;
+  int64_t element_bytes;
+};
+
+// Builds a chain of asynchronous nodes from `stages`, the first of which
+// produces the output of the pipeline, optimizes it with the `MEMORY_AWARE`
+// algorithm and returns the tuned parameter values in the order of `stages`.
+// The recorded statistics do not depend on timing, so the result only depends
+// on `stages` and the budgets.
+std::vector<int64_t> OptimizeMemoryAware(
+    const std::vector<SimulatedStage>& stages, int64_t cpu_budget,
+    int64_t ram_budget) {
+  constexpr int kNumElements = 100;
+  model::Model model;
+  std::vector<std::shared_ptr<Node>> nodes;
+  std::shared_ptr<Node> output = nullptr;
+  for (int64_t i = 0; i < stages.size(); ++i) {
+    const SimulatedStage& stage = stages[i];
+    std::shared_ptr<Node> node = model::MakeAsyncKnownRatioNode(
+        {i, strings::StrCat("stage", i), output}, /*ratio=*/1,
+        {model::MakeParameter(
+            stage.parameter,
+            std::make_shared<SharedState>(
+                /*value=*/model::kAutotune, std::make_shared<mutex>(),
+                std::make_shared<condition_variable>()),
+            /*min=*/stage.parameter == kParallelism ? 1 : 0, /*max=*/16)});
+    for (int j = 0; j < kNumElements; ++j) {
+      node->add_processing_time(stage.processing_time_nsec);
+      node->record_bytes_produced(stage.element_bytes);
+      node->record_element();
+    }
+    model.AddNode([&node](model::Node::Args args) { return node; },
+                  node->name(), output, &node);
+    nodes.push_back(node);
+    output = node;
+  }
+
+  CancellationManager cancellation_manager;
+  RamBudgetManager ram_budget_manager(ram_budget);
+  model.Optimize(AutotuneAlgorithm::MEMORY_AWARE, CpuBudgetFunc(cpu_budget),
+                 /*ram_budget_share=*/1.0,
+                 /*fixed_ram_budget=*/ram_budget,
+                 /*model_input_time=*/0, ram_budget_manager,
+                 &cancellation_manager);
+  std::vector<int64_t> values;
+  for (int64_t i = 0; i < stages.size(); ++i) {
+    values.push_back(nodes[i]->parameter_value(stages[i].parameter));
+  }
+  return values;
+}
+
+TEST(OptimizeMemoryAwareTest, CoresGoToTheBottleneck) {
+  std::vector<int64_t> values = OptimizeMemoryAware(
+      {{kParallelism, /*processing_time_nsec=*/100, /*element_bytes=*/1},
+       {kParallelism, /*processing_time_nsec=*/1000, /*element_bytes=*/1}},
+      /*cpu_budget=*/8, /*ram_budget=*/1 << 30);
+  EXPECT_LE(values[0] + values[1], 8);
+  EXPECT_GT(values[1], values[0]);
+}
+
+TEST(OptimizeMemoryAwareTest, RamBudgetBoundsParallelism) {
+  const std::vector<SimulatedStage> stages = {
+      {kParallelism, /*processing_time_nsec=*/100, /*element_bytes=*/1000},
+      {kParallelism, /*processing_time_nsec=*/1000, /*element_bytes=*/1000}};
+  std::vector<int64_t> values =
+      OptimizeMemoryAware(stages, /*cpu_budget=*/16, /*ram_budget=*/1 << 30);
+  EXPECT_LE(values[0] + values[1], 16);
+  EXPECT_GT(values[0] + values[1], 4);
+
+  values = OptimizeMemoryAware(stages, /*cpu_budget=*/16, /*ram_budget=*/4000);
+  EXPECT_LE((values[0] + values[1]) * 1000, 4000);
+  EXPECT_GT(values[1], values[0]);
+}
+
+TEST(OptimizeMemoryAwareTest, BuffersShrinkUnderTightRamBudget) {
+  const std::vector<SimulatedStage> stages = {
+      {kBufferSize, /*processing_time_nsec=*/10, /*element_bytes=*/1000},
+      {kParallelism, /*processing_time_nsec=*/1000, /*element_bytes=*/1000}};
+  std::vector<int64_t> values =
+      OptimizeMemoryAware(stages, /*cpu_budget=*/4, /*ram_budget=*/1 << 30);
+  EXPECT_GE(values[0], 1);
+  EXPECT_EQ(values[1], 4);
+
+  // The memory goes to the parallelism of the bottleneck, which decreases the
+  // output time more than the buffer does.
+  values = OptimizeMemoryAware(stages, /*cpu_budget=*/4, /*ram_budget=*/3000);
+  EXPECT_EQ(values[0], 0);
+  EXPECT_EQ(values[1], 3);
+}
+
+TEST(OptimizeMemoryAwareTest, LargeElementsTakeFewerCores) {
+  std::vector<int64_t> small_elements = OptimizeMemoryAware(
+      {{kParallelism, /*processing_time_nsec=*/100, /*element_bytes=*/10000},
+       {kParallelism, /*processing_time_nsec=*/1000, /*element_bytes=*/10}},
+      /*cpu_budget=*/16, /*ram_budget=*/60000);
+  std::vector<int64_t> large_elements = OptimizeMemoryAware(
+      {{kParallelism, /*processing_time_nsec=*/100, /*element_bytes=*/10},
+       {kParallelism, /*processing_time_nsec=*/1000, /*element_bytes=*/10000}},
+      /*cpu_budget=*/16, /*ram_budget=*/60000);
+  EXPECT_LE(large_elements[0] * 10 + large_elements[1] * 10000, 60000);
+  EXPECT_LT(large_elements[1], small_elements[1]);
+}
 
 TEST(RecordTimeTest, RecordTimeTest) {
   std::shared_ptr<Node> source = model::MakeSourceNode({});
@@ -1369,6 +1480,25 @@ TEST(RecordTimeTest, RecordTimeTest) {
   EXPECT_FALSE(source->is_recording());
 }
 
+TEST(ReadBandwidthTest, Node) {
+  CellReader<Histogram> bandwidth("/tensorflow/data/read_bandwidth");
+  std::shared_ptr<Node> source = model::MakeSourceNode({0, "source", nullptr});
+  EXPECT_EQ(source->read_bandwidth(), 0.0);
+  // 4 MiB in 2 milliseconds.
+  source->record_bytes_read(3 << 20, 1000000);
+  source->record_bytes_read(1 << 20, 1000000);
+  EXPECT_EQ(source->bytes_read(), 4 << 20);
+  EXPECT_DOUBLE_EQ(source->read_bandwidth(), (4 << 20) / 2e-3);
+
+  source->FlushMetrics();
+  Histogram histogram = bandwidth.Delta("source");
+  EXPECT_FLOAT_EQ(histogram.num(), 1.0);
+  EXPECT_FLOAT_EQ(histogram.sum(), (4 << 20) / 2e-3 / 1e6);
+  // Nothing is recorded when there were no reads since the last flush.
+  source->FlushMetrics();
+  EXPECT_FLOAT_EQ(bandwidth.Delta("source").num(), 0.0);
+}
+
 TEST(ModelTest, ModelMetrics) {
   CellReader<std::string> cell_reader("/tensorflow/data/model");
   model::Model model;
@@ -3548,6 +3678,27 @@ TEST(RamBudgetManagerTest, RequestAllocationsWithBudgetAdjustment) {
   EXPECT_TRUE(rbm.RequestLegacyPrefetchBytes(4));
 }
 
+TEST(RamBudgetManagerTest, RequestSpillableBytes) {
+  RamBudgetManager rbm(10);
+  EXPECT_TRUE(rbm.RequestModelAllocation(4));
+  // Over budget 7 > 10 - 4
+  EXPECT_FALSE(rbm.RequestSpillableBytes(7));
+  EXPECT_TRUE(rbm.RequestSpillableBytes(6));
+  EXPECT_EQ(rbm.SpillableBytesOverBudget(), 0);
+  // Spillable bytes do not limit the model, which pushes them over budget.
+  EXPECT_TRUE(rbm.RequestModelAllocation(7));
+  EXPECT_EQ(rbm.SpillableBytesOverBudget(), 3);
+  EXPECT_TRUE(rbm.RequestSpillableBytes(-3));
+  EXPECT_EQ(rbm.SpillableBytesOverBudget(), 0);
+  // A smaller budget also pushes them over budget.
+  rbm.UpdateBudget(8);
+  EXPECT_EQ(rbm.SpillableBytesOverBudget(), 2);
+  rbm.UpdateBudget(5);
+  EXPECT_EQ(rbm.SpillableBytesOverBudget(), 3);
+  EXPECT_TRUE(rbm.RequestSpillableBytes(-3));
+  EXPECT_EQ(rbm.SpillableBytesOverBudget(), 0);
+}
+
 }  // namespace
 }  // namespace model
 }  // namespace data
@@ -760,7 +760,13 @@ Status OpKernelContext::allocate_output(StringPiece name,
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
     AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+  return allocate_tensor(get_allocator(attr), type, shape, out_tensor,
+                         allocation_attr);
+}
+
+Status OpKernelContext::allocate_tensor(
+    Allocator* a, DataType type, const TensorShape& shape, Tensor* out_tensor,
+    const AllocationAttributes& allocation_attr) {
   Tensor new_tensor(
       a, type, shape,
       AllocationAttributes(
@@ -819,7 +825,22 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
       op_kernel().name_view().data(), step_id(), "output", type,
       [&shape]() { return shape.DebugString(); });
   auto output_tensor = std::make_unique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  Allocator* output_allocator = nullptr;
+  if (attr.value == 0 && attr.scope_id == 0 && !track_allocations()) {
+    if (params_->output_allocator_array != nullptr) {
+      output_allocator = params_->output_allocator_array[index];
+    }
+    // Only outputs, whose lifetime the executor tracks, come from the step
+    // arena. Temporary and persistent tensors may be kept in resources beyond
+    // the step, and use the device allocator.
+    if (output_allocator == nullptr) {
+      output_allocator = params_->step_arena_allocator;
+    }
+  }
+  Status s = output_allocator != nullptr
+                 ? allocate_tensor(output_allocator, type, shape,
+                                   output_tensor.get(), AllocationAttributes())
+                 : allocate_tensor(type, shape, output_tensor.get(), attr);
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
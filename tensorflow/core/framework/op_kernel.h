@@ -619,6 +619,16 @@ class OpKernelContext {
     bool track_allocations = false;
     bool log_memory = false;
 
+    // If not null, outputs allocated with default attributes by
+    // allocate_output() are served from this allocator, which lives for the
+    // duration of the step. Not owned.
+    Allocator* step_arena_allocator = nullptr;
+
+    // If not null, an array indexed by output number of the allocators that
+    // place the outputs of this node according to a static memory plan. An
+    // entry is null for an output that is not planned. Not owned.
+    Allocator* const* output_allocator_array = nullptr;
+
     // Array indexed by output number for this node
     const AllocatorAttributes* output_attr_array = nullptr;
 
@@ -1274,6 +1284,9 @@ class OpKernelContext {
   Status allocate_tensor(DataType type, const TensorShape& shape,
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
                          const AllocationAttributes& allocation_attr);
+  Status allocate_tensor(Allocator* a, DataType type, const TensorShape& shape,
+                         Tensor* out_tensor,
+                         const AllocationAttributes& allocation_attr);
 
   // Helpers for `set_output()`.
 
@@ -524,6 +524,51 @@ TEST_F(OpKernelTest, AllocateOutput) {
   EXPECT_THAT(s.message(), ::testing::ContainsRegex("bad index=1"));
 }
 
+// Counts the allocations it forwards to the CPU allocator.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocs;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocs = 0;
+};
+
+TEST_F(OpKernelTest, StepArenaOnlyServesOutputs) {
+  Env* env = Env::Default();
+  OpKernelContext::Params params;
+  DummyDevice device(env);
+  params.device = &device;
+  CountingAllocator step_arena;
+  params.step_arena_allocator = &step_arena;
+  Status status;
+  std::unique_ptr<OpKernel> op(
+      CreateOpKernel(DEVICE_CPU, params.device, cpu_allocator(),
+                     CreateNodeDef("Test1", {DT_FLOAT, DT_INT32}),
+                     TF_GRAPH_DEF_VERSION, &status));
+  EXPECT_TRUE(status.ok());
+  params.op_kernel = op.get();
+  Tensor a(DT_FLOAT, TensorShape({}));
+  Tensor b(DT_INT32, TensorShape({}));
+  gtl::InlinedVector<TensorValue, 4> inputs{TensorValue(&a), TensorValue(&b)};
+  params.inputs = inputs;
+  auto ctx = std::make_unique<OpKernelContext>(&params);
+
+  // Temporary tensors may outlive the step, e.g. in a resource.
+  Tensor temp;
+  TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({4}), &temp));
+  EXPECT_EQ(0, step_arena.num_allocs);
+
+  Tensor* output = nullptr;
+  TF_ASSERT_OK(ctx->allocate_output(0, TensorShape({4}), &output));
+  EXPECT_EQ(1, step_arena.num_allocs);
+}
+
 // A mock device that mimics the behavior of scoped allocator upon calling
 // GetAllocator with a positive scope_id.
 class ScopedAllocatorDevice : public DeviceBase {
@@ -75,7 +75,8 @@ const ConfigList& DefaultPluginConfigs() {
        {"dependency_optimization", RewriterConfig::ON},
        {"auto_parallel", RewriterConfig::ON},
        {"memory_optimization", RewriterConfig::ON},
-       {"scoped_allocator_optimization", RewriterConfig::ON}});
+       {"scoped_allocator_optimization", RewriterConfig::ON},
+       {"elementwise_fusion", RewriterConfig::ON}});
   return *default_plugin_configs;
 }
 
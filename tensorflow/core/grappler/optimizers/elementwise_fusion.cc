@@ -0,0 +1,242 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/elementwise_fusion.h"
+
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/symbolic_shapes.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kFusedElementwise[] = "_FusedElementwise";
+
+// Maximum number of ops fused into one node.
+constexpr int kMaxFusedOps = 32;
+
+// Returns true if the `_FusedElementwise` kernel supports `node`.
+bool IsFusible(const NodeDef& node) {
+  static const auto* ops = new absl::flat_hash_set<string>(
+      {"Add", "AddV2", "Sub", "Mul", "Div", "RealDiv", "Maximum", "Minimum",
+       "SquaredDifference", "Neg", "Abs", "Square", "Sqrt", "Rsqrt", "Exp",
+       "Log", "Tanh", "Sigmoid", "Relu", "Relu6"});
+  if (!ops->contains(node.op()) || !NodeIsOnCpu(&node)) return false;
+  DataType dtype;
+  return TryGetNodeAttr(node, "T", &dtype) &&
+         (dtype == DT_FLOAT || dtype == DT_DOUBLE);
+}
+
+class ElementwiseFuser {
+ public:
+  ElementwiseFuser(const GrapplerItem& item, const GraphProperties& properties,
+                   GraphDef* graph)
+      : properties_(properties),
+        graph_(graph),
+        node_map_(graph),
+        nodes_to_preserve_(item.NodesToPreserve()) {}
+
+  // Fuses the ops that feed `root` into it, if any, and returns true if it
+  // did.
+  bool FuseInto(NodeDef* root) {
+    if (fused_.contains(root->name()) || !IsFusible(*root) ||
+        !properties_.HasOutputProperties(root->name())) {
+      return false;
+    }
+    // The fused ops are the nodes whose only fanout is another fused op, so
+    // they form a tree with `root` at the top.
+    absl::flat_hash_set<string> ops = {root->name()};
+    std::vector<const NodeDef*> stack = {root};
+    while (!stack.empty() && ops.size() < size_t{kMaxFusedOps}) {
+      const NodeDef* node = stack.back();
+      stack.pop_back();
+      for (const string& input : node->input()) {
+        if (IsControlInput(input)) break;
+        const NodeDef* input_node = node_map_.GetNode(input);
+        if (input_node == nullptr || ops.contains(input_node->name()) ||
+            !CanFuse(*input_node, *root)) {
+          continue;
+        }
+        if (ops.size() >= size_t{kMaxFusedOps}) break;
+        ops.insert(input_node->name());
+        stack.push_back(input_node);
+      }
+    }
+    if (ops.size() < 2) return false;
+
+    // Inputs of the fused node, with the ops in evaluation order.
+    args_.clear();
+    arg_indices_.clear();
+    op_indices_.clear();
+    fused_ops_.clear();
+    op_inputs_.clear();
+    AddOp(*root, ops);
+    // Refer to the outputs of the ops after the arguments.
+    const int num_args = args_.size();
+    for (int& input : op_inputs_) {
+      if (input < 0) input = num_args - input - 1;
+    }
+
+    NodeDef fused_node;
+    fused_node.set_name(root->name());
+    fused_node.set_op(kFusedElementwise);
+    fused_node.set_device(root->device());
+    for (const string& arg : args_) fused_node.add_input(arg);
+    std::set<string> control_inputs;
+    for (const string& name : ops) {
+      for (const string& input : node_map_.GetNode(name)->input()) {
+        if (IsControlInput(input) && !ops.contains(NodeName(input))) {
+          control_inputs.insert(input);
+        }
+      }
+    }
+    for (const string& input : control_inputs) fused_node.add_input(input);
+    DataType dtype;
+    TF_CHECK_OK(GetNodeAttr(*root, "T", &dtype));
+    AddNodeAttr("T", dtype, &fused_node);
+    AddNodeAttr("num_args", num_args, &fused_node);
+    AddNodeAttr("fused_ops", fused_ops_, &fused_node);
+    AddNodeAttr("op_inputs", op_inputs_, &fused_node);
+    VLOG(2) << "Fused " << fused_ops_.size() << " elementwise ops into "
+            << root->name();
+
+    for (const string& name : ops) {
+      fused_.insert(name);
+      if (name != root->name()) nodes_to_delete_.insert(name);
+    }
+    *root = std::move(fused_node);
+    return true;
+  }
+
+  // Removes the nodes that were fused into others.
+  void EraseFusedNodes() { EraseNodesFromGraph(nodes_to_delete_, graph_); }
+
+ private:
+  // Returns true if `node` can be computed as part of the fused node that
+  // replaces `root`.
+  bool CanFuse(const NodeDef& node, const NodeDef& root) const {
+    if (fused_.contains(node.name()) ||
+        nodes_to_preserve_.count(node.name()) > 0 || !IsFusible(node) ||
+        node.device() != root.device() ||
+        node.attr().at("T").type() != root.attr().at("T").type() ||
+        node_map_.GetOutputs(node.name()).size() != 1 ||
+        !properties_.HasOutputProperties(node.name())) {
+      return false;
+    }
+    return ShapesSymbolicallyEqual(
+        properties_.GetOutputProperties(node.name())[0].shape(),
+        properties_.GetOutputProperties(root.name())[0].shape());
+  }
+
+  // Appends `node` to the fused ops, after the fused ops that it reads, and
+  // returns its index.
+  int AddOp(const NodeDef& node, const absl::flat_hash_set<string>& ops) {
+    std::vector<int> inputs;
+    for (const string& input : node.input()) {
+      if (IsControlInput(input)) break;
+      const string name = NodeName(input);
+      if (ops.contains(name)) {
+        auto it = op_indices_.find(name);
+        const int op = it != op_indices_.end()
+                           ? it->second
+                           : AddOp(*node_map_.GetNode(name), ops);
+        // Ops are numbered from -1 down until the number of arguments is
+        // known.
+        inputs.push_back(-op - 1);
+      } else {
+        const string arg = ParseTensorName(input).ToString();
+        auto result = arg_indices_.emplace(arg, args_.size());
+        if (result.second) args_.push_back(arg);
+        inputs.push_back(result.first->second);
+      }
+    }
+    const int index = fused_ops_.size();
+    fused_ops_.push_back(node.op());
+    op_inputs_.insert(op_inputs_.end(), inputs.begin(), inputs.end());
+    op_indices_[node.name()] = index;
+    return index;
+  }
+
+  const GraphProperties& properties_;
+  GraphDef* graph_;
+  NodeMap node_map_;
+  const std::unordered_set<string> nodes_to_preserve_;
+  // Nodes that are part of a fused node.
+  absl::flat_hash_set<string> fused_;
+  std::set<string> nodes_to_delete_;
+
+  // The fused node under construction.
+  std::vector<string> args_;
+  absl::flat_hash_map<string, int> arg_indices_;
+  absl::flat_hash_map<string, int> op_indices_;
+  std::vector<string> fused_ops_;
+  std::vector<int> op_inputs_;
+};
+
+}  // namespace
+
+Status ElementwiseFusion::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                   GraphDef* optimized_graph) {
+  // _FusedElementwise has no gradient.
+  if (!item.optimization_options().allow_non_differentiable_rewrites) {
+    return errors::Aborted("Nothing to do.");
+  }
+  bool can_optimize = false;
+  for (const NodeDef& node : item.graph.node()) {
+    if (IsFusible(node)) {
+      can_optimize = true;
+      break;
+    }
+  }
+  if (!can_optimize) {
+    return errors::Aborted("Nothing to do.");
+  }
+
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(/*assume_valid_feeds=*/false));
+  *optimized_graph = item.graph;
+  TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
+
+  // Visit consumers before their inputs, so that every fused node is rooted at
+  // the last op of a chain.
+  ElementwiseFuser fuser(item, properties, optimized_graph);
+  int num_fused = 0;
+  for (int i = optimized_graph->node_size() - 1; i >= 0; --i) {
+    if (fuser.FuseInto(optimized_graph->mutable_node(i))) ++num_fused;
+  }
+  if (num_fused == 0) {
+    return errors::Aborted("Nothing to do.");
+  }
+  fuser.EraseFusedNodes();
+  VLOG(1) << "Created " << num_fused << " " << kFusedElementwise << " nodes";
+  return OkStatus();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,51 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_ELEMENTWISE_FUSION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_ELEMENTWISE_FUSION_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Collapses trees of elementwise ops on CPU into `_FusedElementwise` nodes,
+// which evaluate all of their ops in one pass over the output, instead of
+// writing every intermediate result to memory.
+//
+// A node is fused into its consumer if both are supported elementwise ops on
+// the same CPU device, with the same type, if the consumer is its only fanout,
+// and if its output has the same shape as the output of the fused node.
+// Inputs from outside the fused ops may broadcast to that shape.
+class ElementwiseFusion : public GraphOptimizer {
+ public:
+  ElementwiseFusion() {}
+  explicit ElementwiseFusion(RewriterConfig::Toggle opt_level) {}
+
+  ~ElementwiseFusion() override {}
+
+  string name() const override { return "elementwise_fusion"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_ELEMENTWISE_FUSION_H_
@@ -0,0 +1,202 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/elementwise_fusion.h"
+
+#include <vector>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class ElementwiseFusionTest : public GrapplerTest {
+ protected:
+  // Places all nodes of `item` on CPU.
+  void PlaceOnCpu(GrapplerItem* item) {
+    for (int i = 0; i < item->graph.node_size(); ++i) {
+      item->graph.mutable_node(i)->set_device("/device:CPU:0");
+    }
+  }
+
+  void ExpectSameOutputs(const GrapplerItem& item, const GraphDef& output) {
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+    auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+    ASSERT_EQ(tensors_expected.size(), tensors.size());
+    for (int i = 0; i < tensors.size(); ++i) {
+      test::ExpectClose(tensors[i], tensors_expected[i], 1e-6);
+    }
+  }
+};
+
+TEST_F(ElementwiseFusionTest, FusesChainWithBroadcastArguments) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({8, 16}));
+  auto scale = ops::Placeholder(s.WithOpName("scale"), DT_FLOAT,
+                                ops::Placeholder::Shape({16}));
+  auto mul = ops::Mul(s.WithOpName("mul"), x, scale);
+  auto add = ops::Add(s.WithOpName("add"), mul, x);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), add);
+  auto out = ops::Mul(s.WithOpName("out"), tanh, 0.5f);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({8, 16})},
+               {"scale", GenerateRandomTensor<DT_FLOAT>({16})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  ElementwiseFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("mul", node.name());
+    EXPECT_NE("add", node.name());
+    EXPECT_NE("tanh", node.name());
+    if (node.name() != "out") continue;
+    ++found;
+    EXPECT_EQ("_FusedElementwise", node.op());
+    ASSERT_EQ(3, node.input_size());
+    EXPECT_EQ("x", node.input(0));
+    EXPECT_EQ("scale", node.input(1));
+    EXPECT_EQ(3, node.attr().at("num_args").i());
+    const auto& fused_ops = node.attr().at("fused_ops").list().s();
+    ASSERT_EQ(4, fused_ops.size());
+    EXPECT_EQ("Mul", fused_ops[0]);
+    EXPECT_EQ("Add", fused_ops[1]);
+    EXPECT_EQ("Tanh", fused_ops[2]);
+    EXPECT_EQ("Mul", fused_ops[3]);
+    // mul(x, scale), add(mul, x), tanh(add), out(tanh, <constant>)
+    const auto& op_inputs = node.attr().at("op_inputs").list().i();
+    EXPECT_EQ(std::vector<int64_t>({0, 1, 3, 0, 4, 5, 2}),
+              std::vector<int64_t>(op_inputs.begin(), op_inputs.end()));
+  }
+  EXPECT_EQ(1, found);
+  ExpectSameOutputs(item, output);
+}
+
+TEST_F(ElementwiseFusionTest, KeepsOpsWithSeveralConsumers) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({32}));
+  auto y = ops::Placeholder(s.WithOpName("y"), DT_FLOAT,
+                            ops::Placeholder::Shape({32}));
+  auto mul = ops::Mul(s.WithOpName("mul"), x, y);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), mul);
+  auto exp = ops::Exp(s.WithOpName("exp"), mul);
+  auto out = ops::AddV2(s.WithOpName("out"), tanh, exp);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({32})},
+               {"y", GenerateRandomTensor<DT_FLOAT>({32})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  ElementwiseFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "mul") {
+      EXPECT_EQ("Mul", node.op());
+      ++found;
+    } else if (node.name() == "out") {
+      EXPECT_EQ("_FusedElementwise", node.op());
+      ASSERT_EQ(1, node.input_size());
+      EXPECT_EQ("mul", node.input(0));
+      const auto& op_inputs = node.attr().at("op_inputs").list().i();
+      EXPECT_EQ(std::vector<int64_t>({0, 0, 1, 2}),
+                std::vector<int64_t>(op_inputs.begin(), op_inputs.end()));
+      ++found;
+    }
+  }
+  EXPECT_EQ(2, found);
+  ExpectSameOutputs(item, output);
+}
+
+TEST_F(ElementwiseFusionTest, KeepsFetchedAndDifferentlyShapedOps) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 8}));
+  auto bias = ops::Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                               ops::Placeholder::Shape({8}));
+  // `scaled_bias` has a different shape than the output.
+  auto scaled_bias = ops::Mul(s.WithOpName("scaled_bias"), bias, 2.0f);
+  auto add = ops::AddV2(s.WithOpName("add"), x, scaled_bias);
+  auto relu = ops::Relu(s.WithOpName("relu"), add);
+  auto out = ops::Neg(s.WithOpName("out"), relu);
+
+  GrapplerItem item;
+  item.fetch = {"relu", "out"};
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>({4, 8})},
+               {"bias", GenerateRandomTensor<DT_FLOAT>({8})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  PlaceOnCpu(&item);
+
+  ElementwiseFusion optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "scaled_bias") {
+      EXPECT_EQ("Mul", node.op());
+    } else if (node.name() == "relu") {
+      // The fetched `relu` is the root of a fused node, which `out` reads.
+      EXPECT_EQ("_FusedElementwise", node.op());
+      const auto& fused_ops = node.attr().at("fused_ops").list().s();
+      ASSERT_EQ(2, fused_ops.size());
+      EXPECT_EQ("AddV2", fused_ops[0]);
+      EXPECT_EQ("Relu", fused_ops[1]);
+    } else if (node.name() == "out") {
+      EXPECT_EQ("Neg", node.op());
+    }
+  }
+  ExpectSameOutputs(item, output);
+}
+
+TEST_F(ElementwiseFusionTest, OnlyFusesOpsOnCpu) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({32}));
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), x);
+  auto out = ops::Exp(s.WithOpName("out"), tanh);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:GPU:0");
+  }
+
+  ElementwiseFusion optimizer;
+  GraphDef output;
+  EXPECT_EQ(errors::Aborted("Nothing to do."),
+            optimizer.Optimize(nullptr, item, &output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
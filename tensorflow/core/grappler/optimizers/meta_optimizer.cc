@@ -44,6 +44,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
 #include "tensorflow/core/grappler/optimizers/debug_stripper.h"
 #include "tensorflow/core/grappler/optimizers/dependency_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/elementwise_fusion.h"
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/implementation_selector.h"
@@ -258,6 +259,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
                                       cfg_.scoped_allocator_opts()));
   MK_OPT("pin_to_host", "pin_to_host_optimization",
          new PinToHostOptimizer(cfg_.pin_to_host_optimization()));
+  MK_OPT("elementwise_fusion", "elementwise_fusion",
+         new ElementwiseFusion(cfg_.elementwise_fusion()));
 
   return std::unique_ptr<GraphOptimizer>();
 }
@@ -447,6 +450,14 @@ Status MetaOptimizer::InitializeOptimizers(
           xla_auto_clustering_on_));
     }
   }
+  // Runs after the remapper, which fuses elementwise ops into contractions.
+  if (BOTH_ARE_ON(elementwise_fusion) && !xla_auto_clustering_on_) {
+    optimizers->push_back(
+        std::make_unique<ElementwiseFusion>(cfg_.elementwise_fusion()));
+  } else if (BOTH_ARE_EXPERIMENTAL_MLIR(elementwise_fusion) ||
+             BOTH_ARE_EXPERIMENTAL_BOTH(elementwise_fusion)) {
+    VLOG(2) << "elementwise_fusion is not implemented in TFG yet";
+  }
   if (BOTH_NOT_OFF(loop_optimization)) {
     if (USER_IS_EXPERIMENTAL_MLIR(loop_optimization) ||
         USER_IS_EXPERIMENTAL_BOTH(loop_optimization)) {
@@ -636,6 +647,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
     PRINT_CFG(loop_optimization)
     PRINT_CFG(dependency_optimization)
     PRINT_CFG(scoped_allocator_optimization)
+    PRINT_CFG(elementwise_fusion)
 #undef PRINT_CFG
     user_cfg.toggle_config["auto_mixed_precision"] =
         AutoMixedPrecisionEnabled(cfg_.auto_mixed_precision())
@@ -691,6 +703,7 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
       PRINT_CFG("memory", "memory_optimization")
       PRINT_CFG("autoparallel", "auto_parallel")
       PRINT_CFG("scoped_allocator", "scoped_allocator_optimization")
+      PRINT_CFG("elementwise_fusion", "elementwise_fusion")
 #undef PRINT_CFG
     }
   }
@@ -725,7 +738,8 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
         pair.first == "auto_mixed_precision_mkl" ||
         pair.first == "auto_mixed_precision_cpu" ||
         pair.first == "pin_to_host_optimization" ||
-        pair.first == "scoped_allocator_optimization") {
+        pair.first == "scoped_allocator_optimization" ||
+        pair.first == "elementwise_fusion") {
       // These optimizers are turned off by default.
       // TODO(penporn): Remove the hard-coded length and change it to max length
       // of all option strings.
@@ -22,6 +22,7 @@ limitations under the License.
 #include <string>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
@@ -38,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/batching_util/batch_resource_base.h"
 #include "tensorflow/core/kernels/batching_util/bounded_executor.h"
 #include "tensorflow/core/kernels/batching_util/concat_split_util.h"
+#include "tensorflow/core/kernels/batching_util/deadline_aware_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/periodic_function.h"
 #include "tensorflow/core/kernels/batching_util/warmup.h"
 #include "tensorflow/core/kernels/ops_util.h"
@@ -170,7 +172,10 @@ class BatchResource : public serving::BatchResourceBase {
                   /*low_priority_batch_timeout_micros=*/0,
                   /*low_priority_max_enqueued_batches=*/0,
                   /*low_priority_allowed_batch_sizes=*/{},
-                  enable_large_batch_splitting, resource);
+                  enable_large_batch_splitting,
+                  /*enable_fair_share_scheduling=*/false,
+                  /*fair_share_weight=*/1.0, /*latency_critical=*/false,
+                  resource);
   }
 
   static Status Create(
@@ -182,24 +187,30 @@ class BatchResource : public serving::BatchResourceBase {
       int32_t low_priority_batch_timeout_micros,
       int32_t low_priority_max_enqueued_batches,
       const std::vector<int32>& low_priority_allowed_batch_sizes,
-      bool enable_large_batch_splitting,
+      bool enable_large_batch_splitting, bool enable_fair_share_scheduling,
+      double fair_share_weight, bool latency_critical,
       std::unique_ptr<BatchResource>* resource) {
-    BatcherT::Options batcher_options;
-    batcher_options.num_batch_threads = num_batch_threads;
     std::shared_ptr<BatcherT> batcher;
-    TF_RETURN_IF_ERROR(BatcherT::Create(batcher_options, &batcher));
+    if (enable_fair_share_scheduling) {
+      TF_RETURN_IF_ERROR(GetFairShareBatcher(num_batch_threads, &batcher));
+    } else {
+      BatcherT::Options batcher_options;
+      batcher_options.num_batch_threads = num_batch_threads;
+      TF_RETURN_IF_ERROR(BatcherT::Create(batcher_options, &batcher));
+    }
 
-    resource->reset(new BatchResource(
-        has_process_batch_function, std::move(batcher),
-        GetBatcherQueueOptions(
-            num_batch_threads, max_execution_batch_size, batch_timeout_micros,
-            max_enqueued_batches, allowed_batch_sizes,
-            enable_large_batch_splitting,
-            /*disable_padding=*/false, low_priority_max_batch_size,
-            low_priority_batch_timeout_micros,
-            low_priority_max_enqueued_batches,
-            low_priority_allowed_batch_sizes),
-        allowed_batch_sizes));
+    BatcherT::QueueOptions batcher_queue_options = GetBatcherQueueOptions(
+        num_batch_threads, max_execution_batch_size, batch_timeout_micros,
+        max_enqueued_batches, allowed_batch_sizes, enable_large_batch_splitting,
+        /*disable_padding=*/false, low_priority_max_batch_size,
+        low_priority_batch_timeout_micros, low_priority_max_enqueued_batches,
+        low_priority_allowed_batch_sizes);
+    batcher_queue_options.fair_share_weight = fair_share_weight;
+    batcher_queue_options.latency_critical = latency_critical;
+    resource->reset(new BatchResource(has_process_batch_function,
+                                      std::move(batcher),
+                                      batcher_queue_options,
+                                      allowed_batch_sizes));
     return OkStatus();
   }
 
@@ -224,9 +235,51 @@ class BatchResource : public serving::BatchResourceBase {
     return OkStatus();
   }
 
+  static Status Create(
+      bool has_process_batch_function,
+      const DeadlineBatcherT::Options& deadline_batcher_options,
+      int32_t max_batch_size, int32_t batch_timeout_micros,
+      int32_t max_enqueued_batches,
+      const std::vector<int32>& allowed_batch_sizes,
+      std::unique_ptr<BatchResource>* resource) {
+    std::shared_ptr<DeadlineBatcherT> batcher;
+    TF_RETURN_IF_ERROR(
+        DeadlineBatcherT::Create(deadline_batcher_options, &batcher));
+
+    resource->reset(new BatchResource(
+        has_process_batch_function, std::move(batcher),
+        GetDeadlineBatcherQueueOptions(max_batch_size, batch_timeout_micros,
+                                       max_enqueued_batches,
+                                       allowed_batch_sizes),
+        allowed_batch_sizes));
+    return OkStatus();
+  }
+
   string DebugString() const final { return "BatchResource"; }
 
  private:
+  // Returns the fair share scheduler with `num_batch_threads` threads that is
+  // shared by the resources of the process, creating it if none is alive.
+  static Status GetFairShareBatcher(int32_t num_batch_threads,
+                                    std::shared_ptr<BatcherT>* batcher) {
+    static mutex* mu = new mutex();
+    static auto* batchers =
+        new absl::flat_hash_map<int32_t, std::weak_ptr<BatcherT>>();
+    mutex_lock l(*mu);
+    std::weak_ptr<BatcherT>& shared_batcher = (*batchers)[num_batch_threads];
+    *batcher = shared_batcher.lock();
+    if (*batcher != nullptr) {
+      return OkStatus();
+    }
+    BatcherT::Options batcher_options;
+    batcher_options.thread_pool_name = "fair_share_batch_threads";
+    batcher_options.num_batch_threads = num_batch_threads;
+    batcher_options.enable_fair_share_scheduling = true;
+    TF_RETURN_IF_ERROR(BatcherT::Create(batcher_options, batcher));
+    shared_batcher = *batcher;
+    return OkStatus();
+  }
+
   BatchResource(bool has_process_batch_function,
                 std::shared_ptr<BatcherT> batcher,
                 const BatcherT::QueueOptions& batcher_queue_options,
@@ -243,6 +296,14 @@ class BatchResource : public serving::BatchResourceBase {
                           batcher_queue_options,
                           std::move(allowed_batch_sizes)) {}
 
+  BatchResource(bool has_process_batch_function,
+                std::shared_ptr<DeadlineBatcherT> batcher,
+                const DeadlineBatcherT::QueueOptions& batcher_queue_options,
+                std::vector<int32> allowed_batch_sizes)
+      : BatchResourceBase(has_process_batch_function, std::move(batcher),
+                          batcher_queue_options,
+                          std::move(allowed_batch_sizes)) {}
+
   void ProcessFuncBatchImpl(
       const serving::BatchResourceBase::BatchTask& last_task,
       absl::Span<const Tensor> inputs, std::vector<Tensor>* combined_outputs,
@@ -303,6 +364,32 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
                                  &enable_large_batch_splitting_));
     has_attribute_enable_large_batch_splitting_ = true;
   }
+  if (c->HasAttr("enable_zero_copy_batching")) {
+    OP_REQUIRES_OK(c, c->GetAttr("enable_zero_copy_batching",
+                                 &enable_zero_copy_batching_));
+  }
+  if (c->HasAttr("enable_fair_share_scheduling")) {
+    OP_REQUIRES_OK(c, c->GetAttr("enable_fair_share_scheduling",
+                                 &enable_fair_share_scheduling_));
+    OP_REQUIRES_OK(c, c->GetAttr("fair_share_weight", &fair_share_weight_));
+    OP_REQUIRES_OK(c, c->GetAttr("latency_critical", &latency_critical_));
+    OP_REQUIRES(c, fair_share_weight_ > 0,
+                errors::InvalidArgument(
+                    "fair_share_weight must be positive; was ",
+                    fair_share_weight_));
+  }
+  if (c->HasAttr("enable_deadline_aware_batching")) {
+    OP_REQUIRES_OK(c, c->GetAttr("enable_deadline_aware_batching",
+                                 &enable_deadline_aware_batching_));
+    OP_REQUIRES(c,
+                !enable_deadline_aware_batching_ ||
+                    (!enable_fair_share_scheduling_ &&
+                     !enable_large_batch_splitting_),
+                errors::InvalidArgument(
+                    "enable_deadline_aware_batching can't be combined with "
+                    "enable_fair_share_scheduling or "
+                    "enable_large_batch_splitting."));
+  }
 
   // Helper function `SetAdaptiveBatchSchedulerOptions` calls
   // `OP_REQUIRES_OK`, which exits the current function upon error.
@@ -311,6 +398,13 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
   if (!c->status().ok()) {
     return;
   }
+  OP_REQUIRES(c,
+              !enable_deadline_aware_batching_ ||
+                  !enable_adaptive_batch_threads_,
+              errors::InvalidArgument(
+                  "enable_deadline_aware_batching requires a positive "
+                  "num_batch_threads and can't be combined with adaptive "
+                  "batch scheduling."));
 
   if (enable_adaptive_batch_threads_) {
     // One scheduler instance contains a couple of queue instances,
@@ -410,6 +504,26 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
       if (session_metadata) {
         new_resource->set_session_metadata(*session_metadata);
       }
+      new_resource->set_enable_zero_copy_batching(enable_zero_copy_batching_);
+      *r = new_resource.release();
+      return OkStatus();
+    };
+  } else if (enable_deadline_aware_batching_) {
+    creator = [this,
+               session_metadata = c->session_metadata()](BatchResource** r) {
+      serving::DeadlineAwareBatchScheduler<
+          serving::BatchResourceBase::BatchTask>::Options
+          deadline_batcher_options;
+      deadline_batcher_options.num_batch_threads = num_batch_threads_;
+      std::unique_ptr<BatchResource> new_resource;
+      TF_RETURN_IF_ERROR(BatchResource::Create(
+          /*has_process_batch_function=*/true, deadline_batcher_options,
+          max_batch_size_, batch_timeout_micros_, max_enqueued_batches_,
+          allowed_batch_sizes_, &new_resource));
+      if (session_metadata) {
+        new_resource->set_session_metadata(*session_metadata);
+      }
+      new_resource->set_enable_zero_copy_batching(enable_zero_copy_batching_);
       *r = new_resource.release();
       return OkStatus();
     };
@@ -423,10 +537,12 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
           allowed_batch_sizes_, low_priority_max_batch_size_,
           low_priority_batch_timeout_micros_,
           low_priority_max_enqueued_batches_, low_priority_allowed_batch_sizes_,
-          enable_large_batch_splitting_, &new_resource));
+          enable_large_batch_splitting_, enable_fair_share_scheduling_,
+          fair_share_weight_, latency_critical_, &new_resource));
       if (session_metadata) {
         new_resource->set_session_metadata(*session_metadata);
       }
+      new_resource->set_enable_zero_copy_batching(enable_zero_copy_batching_);
       *r = new_resource.release();
       return OkStatus();
     };
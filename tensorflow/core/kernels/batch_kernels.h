@@ -113,6 +113,11 @@ class BatchFunctionKernel : public AsyncOpKernel {
   absl::optional<FunctionLibraryRuntime::Handle> fhandle_ TF_GUARDED_BY(mu_);
   bool enable_large_batch_splitting_ = false;
   bool has_attribute_enable_large_batch_splitting_ = false;
+  bool enable_zero_copy_batching_ = false;
+  bool enable_fair_share_scheduling_ = false;
+  float fair_share_weight_ = 1.0;
+  bool latency_critical_ = false;
+  bool enable_deadline_aware_batching_ = false;
   bool enable_adaptive_batch_threads_ = false;
 
   mutex mu_;
@@ -276,6 +276,7 @@ BatchResourceBase::BatchTask::CreateSplitTask(
   task->status = this->status;
   task->is_partial = true;
   task->start_time = this->start_time;
+  task->deadline_micros = this->deadline_micros;
   task->request_cost = this->request_cost;
 
   return task;
@@ -329,6 +330,10 @@ Status BatchResourceBase::RegisterInput(
   batch_components->start_time = EnvTime::NowNanos();
   batch_components->guid = guid;
   batch_components->propagated_context = Context(ContextKind::kThread);
+  if (context->deadline().has_value()) {
+    batch_components->deadline_micros =
+        absl::ToUnixMicros(*context->deadline());
+  }
 
   if (batcher_queue_options_.enable_priority_queue) {
     batch_components->criticality = tsl::criticality::GetCriticality();
@@ -377,6 +382,16 @@ Status BatchResourceBase::RegisterInput(
     RecordBatchParamMaxEnqueuedBatches(
         adaptive_batcher_queue_options_.max_enqueued_batches,
         GetModelName(context), context->op_kernel().name());
+  } else if (deadline_batcher_) {
+    RecordBatchParamBatchTimeoutMicros(
+        deadline_batcher_queue_options_.batch_timeout_micros,
+        GetModelName(context), context->op_kernel().name());
+    RecordBatchParamMaxBatchSize(deadline_batcher_queue_options_.max_batch_size,
+                                 GetModelName(context),
+                                 context->op_kernel().name());
+    RecordBatchParamMaxEnqueuedBatches(
+        deadline_batcher_queue_options_.max_enqueued_batches,
+        GetModelName(context), context->op_kernel().name());
   } else {
     return errors::Internal("No batcher defined.");
   }
@@ -548,6 +563,22 @@ BatchResourceBase::GetAdaptiveBatcherQueueOptions(
   return batcher_queue_options;
 }
 
+/*static*/ BatchResourceBase::DeadlineBatcherT::QueueOptions
+BatchResourceBase::GetDeadlineBatcherQueueOptions(
+    int32_t max_batch_size, int32_t batch_timeout_micros,
+    int32_t max_enqueued_batches,
+    const std::vector<int32>& allowed_batch_sizes) {
+  DeadlineBatcherT::QueueOptions batcher_queue_options;
+  batcher_queue_options.max_enqueued_batches = max_enqueued_batches;
+  batcher_queue_options.batch_timeout_micros = batch_timeout_micros;
+  if (allowed_batch_sizes.empty()) {
+    batcher_queue_options.max_batch_size = max_batch_size;
+  } else {
+    batcher_queue_options.max_batch_size = *allowed_batch_sizes.rbegin();
+  }
+  return batcher_queue_options;
+}
+
 /*static*/ Status BatchResourceBase::ValidateBatch(const BatchT& batch) {
   for (int task_idx = 0; task_idx < batch.num_tasks(); ++task_idx) {
     const BatchResourceBase::BatchTask& task = batch.task(task_idx);
@@ -610,6 +641,13 @@ Status BatchResourceBase::ConcatInputTensors(
   RecordBatchSize(batch.size(), GetModelName(context),
                   context->op_kernel().name());
 
+  // The inputs of a lone task that needs no padding already form the batch.
+  if (enable_zero_copy_batching_ && !just_for_warmup &&
+      batch.num_tasks() == 1 && padding_amount == 0) {
+    *concatenated_tensors = batch.task(0).inputs;
+    return OkStatus();
+  }
+
   // All tasks should have the same number of input edges.
   const int num_inputs = batch.task(0).inputs.size();
   concatenated_tensors->reserve(num_inputs);
@@ -797,19 +835,36 @@ Status BatchResourceBase::SplitOutputTensors(
     }
 
     std::vector<Tensor> split_tensor;
-    const Status split_status = tensor::Split(
-        output_tensor, task_sizes_plus_optional_padding, &split_tensor);
-    DCHECK(split_status.ok()) << split_status;
-    if (!split_status.ok()) {
-      return errors::Internal("Tensor split operation failed: ",
-                              split_status.message());
-    }
-    DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
-    if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
-      return errors::Internal(
-          "Tensor split operation did not work as expected; got ",
-          split_tensor.size(), " splits; expected ",
-          task_sizes_plus_optional_padding.size());
+    if (enable_zero_copy_batching_) {
+      // Hand out slices that share the buffer of `output_tensor`. Kernels may
+      // map their inputs with aligned Eigen maps, so slices that are not
+      // aligned are copied instead.
+      split_tensor.reserve(batch->num_tasks());
+      int64_t start = 0;
+      for (int j = 0; j < batch->num_tasks(); ++j) {
+        const int64_t limit = start + task_sizes_plus_optional_padding[j];
+        Tensor slice = output_tensor.Slice(start, limit);
+        if (!slice.IsAligned()) {
+          slice = tensor::DeepCopy(slice);
+        }
+        split_tensor.push_back(std::move(slice));
+        start = limit;
+      }
+    } else {
+      const Status split_status = tensor::Split(
+          output_tensor, task_sizes_plus_optional_padding, &split_tensor);
+      DCHECK(split_status.ok()) << split_status;
+      if (!split_status.ok()) {
+        return errors::Internal("Tensor split operation failed: ",
+                                split_status.message());
+      }
+      DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
+      if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
+        return errors::Internal(
+            "Tensor split operation did not work as expected; got ",
+            split_tensor.size(), " splits; expected ",
+            task_sizes_plus_optional_padding.size());
+      }
     }
 
     // Ignore a possible final split_tensors entry containing the padding.
@@ -1067,6 +1122,9 @@ Status BatchResourceBase::LookupOrCreateBatcherQueue(const string& queue_name,
   } else if (adaptive_batcher_) {
     TF_RETURN_IF_ERROR(adaptive_batcher_->AddQueue(
         adaptive_batcher_queue_options_, process_batch_callback, &new_queue));
+  } else if (deadline_batcher_) {
+    TF_RETURN_IF_ERROR(deadline_batcher_->AddQueue(
+        deadline_batcher_queue_options_, process_batch_callback, &new_queue));
   } else {
     return errors::Internal("No batcher defined.");
   }
@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/batching_util/adaptive_shared_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/deadline_aware_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/threadsafe_status.h"
 #include "tensorflow/core/platform/context.h"
@@ -45,6 +46,10 @@ limitations under the License.
 namespace tensorflow {
 namespace serving {
 
+namespace test_util {
+class BatchResourceBaseTestAccess;
+}  // namespace test_util
+
 // Base class for resource that encapsulating the state and logic for batching
 // tensors.
 class BatchResourceBase : public ResourceBase {
@@ -95,6 +100,10 @@ class BatchResourceBase : public ResourceBase {
 
     uint64 start_time;
 
+    // Absolute deadline of the op invocation, in microseconds since the epoch,
+    // or `kNoBatchTaskDeadline`. Used by DeadlineAwareBatchScheduler.
+    int64_t deadline_micros = kNoBatchTaskDeadline;
+
     size_t size() const override { return inputs[0].shape().dim_size(0); }
 
     // Create a split task from this one. The caller needs to setup the inputs
@@ -131,6 +140,8 @@ class BatchResourceBase : public ResourceBase {
   using BatcherT = SharedBatchScheduler<BatchResourceBase::BatchTask>;
   using AdaptiveBatcherT =
       AdaptiveSharedBatchScheduler<BatchResourceBase::BatchTask>;
+  using DeadlineBatcherT =
+      DeadlineAwareBatchScheduler<BatchResourceBase::BatchTask>;
   using BatcherQueueT = BatchScheduler<BatchResourceBase::BatchTask>;
   using BatchT = Batch<BatchResourceBase::BatchTask>;
 
@@ -154,12 +165,32 @@ class BatchResourceBase : public ResourceBase {
         allowed_batch_sizes_(std::move(allowed_batch_sizes)),
         allowed_batch_sizes_str_(absl::StrJoin(allowed_batch_sizes_, ",")) {}
 
+  BatchResourceBase(bool has_process_batch_function,
+                    std::shared_ptr<DeadlineBatcherT> batcher,
+                    const DeadlineBatcherT::QueueOptions& batcher_queue_options,
+                    std::vector<int32> allowed_batch_sizes)
+      : has_process_batch_function_(has_process_batch_function),
+        deadline_batcher_(std::move(batcher)),
+        deadline_batcher_queue_options_(batcher_queue_options),
+        allowed_batch_sizes_(std::move(allowed_batch_sizes)),
+        allowed_batch_sizes_str_(absl::StrJoin(allowed_batch_sizes_, ",")) {}
+
   void set_session_metadata(tensorflow::SessionMetadata session_metadata) {
     session_metadata_ = std::move(session_metadata);
   }
 
   const SessionMetadata& session_metadata() const { return session_metadata_; }
 
+  // Enables zero-copy batching. A batch made of a single task that needs no
+  // padding is processed on that task's own input tensors, and each task
+  // receives its outputs as slices that alias the batched output tensors
+  // instead of copies of them (slices that are not suitably aligned are still
+  // copied). Note that an aliased slice keeps the whole batched output tensor
+  // alive until every task of the batch has released its outputs.
+  void set_enable_zero_copy_batching(bool enable_zero_copy_batching) {
+    enable_zero_copy_batching_ = enable_zero_copy_batching;
+  }
+
   using CreateBatchTaskFn =
       std::function<StatusOr<std::unique_ptr<BatchTask>>()>;
 
@@ -198,6 +229,11 @@ class BatchResourceBase : public ResourceBase {
       int32_t max_enqueued_batches, bool enable_large_batch_splitting,
       const std::vector<int32>& allowed_batch_sizes, bool disable_padding);
 
+  static DeadlineBatcherT::QueueOptions GetDeadlineBatcherQueueOptions(
+      int32_t max_batch_size, int32_t batch_timeout_micros,
+      int32_t max_enqueued_batches,
+      const std::vector<int32>& allowed_batch_sizes);
+
   // Split 'input' of 'input_task_ptr' along 0th dimension, into a list of
   // 'output_tasks'.
   // Task sizes are determined by
@@ -245,6 +281,8 @@ class BatchResourceBase : public ResourceBase {
       int64_t processed_size, BatchT& batch);
 
  private:
+  friend class test_util::BatchResourceBaseTestAccess;
+
   // Implementation of calling the process batch function.
   virtual void ProcessFuncBatchImpl(
       const BatchResourceBase::BatchTask& last_task,
@@ -301,6 +339,11 @@ class BatchResourceBase : public ResourceBase {
   std::shared_ptr<AdaptiveBatcherT> adaptive_batcher_;
   AdaptiveBatcherT::QueueOptions adaptive_batcher_queue_options_;
 
+  // A batch scheduler that batches by deadline, and options for creating
+  // queues.
+  std::shared_ptr<DeadlineBatcherT> deadline_batcher_;
+  DeadlineBatcherT::QueueOptions deadline_batcher_queue_options_;
+
   // A collection of batcher queues, keyed on queue name.
   // TODO(olston): Garbage-collect unused queues (perhaps simply remove empty
   // ones (with a time delay?); it's okay if they get recreated later).
@@ -312,6 +355,9 @@ class BatchResourceBase : public ResourceBase {
   // A concatenated string of <allowed_batch_sizes_>, separated by ",". This is
   // used to record batching parameter.
   string allowed_batch_sizes_str_;
+
+  // See `set_enable_zero_copy_batching()`.
+  bool enable_zero_copy_batching_ = false;
 };
 
 }  // namespace serving
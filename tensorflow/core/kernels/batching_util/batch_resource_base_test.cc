@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <gmock/gmock.h>
@@ -26,12 +27,43 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/cost_measurement.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
 #include "tensorflow/core/common_runtime/request_cost.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
 namespace serving {
+
+namespace test_util {
+
+class BatchResourceBaseTestAccess {
+ public:
+  static Status ConcatInputTensors(const BatchResourceBase& resource,
+                                   const BatchResourceBase::BatchT& batch,
+                                   OpKernelContext* context,
+                                   std::vector<Tensor>* concatenated_tensors) {
+    return resource.ConcatInputTensors(batch, context, concatenated_tensors);
+  }
+
+  static Status SplitOutputTensors(const BatchResourceBase& resource,
+                                   const std::vector<Tensor>& combined_outputs,
+                                   BatchResourceBase::BatchT* batch) {
+    return resource.SplitOutputTensors(combined_outputs, batch);
+  }
+};
+
+}  // namespace test_util
+
 namespace {
 
 using ::testing::Pair;
@@ -241,6 +273,191 @@ TEST(SplitBatchCostsAndRecordMetricsTest, SplitOnlyNonZeroCostTypes) {
           UnorderedElementsAre(Pair("test_tpu", absl::Milliseconds(100))))));
 }
 
+REGISTER_OP("BatchResourceBaseTestOp").Output("output: float");
+
+class BatchResourceBaseTestOp : public OpKernel {
+ public:
+  using OpKernel::OpKernel;
+  void Compute(OpKernelContext* context) override {}
+};
+REGISTER_KERNEL_BUILDER(Name("BatchResourceBaseTestOp").Device(DEVICE_CPU),
+                        BatchResourceBaseTestOp);
+
+class TestDevice : public DeviceBase {
+ public:
+  explicit TestDevice(Env* env) : DeviceBase(env) {}
+  Allocator* GetAllocator(AllocatorAttributes /*attr*/) override {
+    return cpu_allocator();
+  }
+};
+
+class TestBatchResource : public BatchResourceBase {
+ public:
+  explicit TestBatchResource(std::vector<int32> allowed_batch_sizes)
+      : BatchResourceBase(/*has_process_batch_function=*/true,
+                          std::shared_ptr<BatcherT>(), BatcherT::QueueOptions(),
+                          std::move(allowed_batch_sizes)) {}
+
+  string DebugString() const override { return "TestBatchResource"; }
+
+ private:
+  void ProcessFuncBatchImpl(
+      const BatchResourceBase::BatchTask& last_task,
+      absl::Span<const Tensor> inputs, std::vector<Tensor>* combined_outputs,
+      std::function<void(const Status&)> done) const override {
+    done(OkStatus());
+  }
+};
+
+// Returns a float tensor of shape [num_rows, row_size] holding 0, 1, 2, ...
+Tensor Iota(int64_t num_rows, int64_t row_size) {
+  Tensor tensor(DT_FLOAT, TensorShape({num_rows, row_size}));
+  auto flat = tensor.flat<float>();
+  for (int64_t i = 0; i < flat.size(); ++i) {
+    flat(i) = i;
+  }
+  return tensor;
+}
+
+class ZeroCopyBatchingTest : public ::testing::Test {
+ protected:
+  ZeroCopyBatchingTest()
+      : device_(Env::Default()),
+        thread_pool_(Env::Default(), "zero_copy_batching_test", 2) {
+    worker_threads_.num_threads = 2;
+    worker_threads_.workers = &thread_pool_;
+    device_.set_tensorflow_cpu_worker_threads(&worker_threads_);
+    NodeDef node_def;
+    TF_CHECK_OK(NodeDefBuilder("test", "BatchResourceBaseTestOp")
+                    .Finalize(&node_def));
+    Status status;
+    kernel_ = CreateOpKernel(DEVICE_CPU, &device_, cpu_allocator(), node_def,
+                             TF_GRAPH_DEF_VERSION, &status);
+    TF_CHECK_OK(status);
+    params_.device = &device_;
+    params_.op_kernel = kernel_.get();
+    context_ = std::make_unique<OpKernelContext>(&params_);
+  }
+
+  // Adds a task with `input` to `batch`. The task is a split of a larger
+  // input, so that its outputs are collected in `task.output` rather than in
+  // the shared kernel context.
+  void AddTask(Tensor input, BatchResourceBase::BatchT* batch) {
+    auto task = std::make_unique<BatchResourceBase::BatchTask>();
+    task->inputs.push_back(std::move(input));
+    task->context = context_.get();
+    task->is_partial = true;
+    task->output = std::make_shared<BatchResourceBase::TensorMatrix>(
+        1, std::vector<Tensor>(1));
+    batch->AddTask(std::move(task));
+  }
+
+  static const Tensor& TaskOutput(const BatchResourceBase::BatchT& batch,
+                                  int task_index) {
+    return (*batch.task(task_index).output)[0][0];
+  }
+
+  TestDevice device_;
+  thread::ThreadPool thread_pool_;
+  DeviceBase::CpuWorkerThreads worker_threads_;
+  std::unique_ptr<OpKernel> kernel_;
+  OpKernelContext::Params params_;
+  std::unique_ptr<OpKernelContext> context_;
+};
+
+TEST_F(ZeroCopyBatchingTest, OutputsAliasBatchedOutput) {
+  TestBatchResource resource(/*allowed_batch_sizes=*/{});
+  resource.set_enable_zero_copy_batching(true);
+  // Rows of 64 bytes keep every slice aligned.
+  BatchResourceBase::BatchT batch;
+  AddTask(Iota(1, 16), &batch);
+  AddTask(Iota(2, 16), &batch);
+  AddTask(Iota(1, 16), &batch);
+  batch.Close();
+
+  const Tensor combined = Iota(4, 16);
+  TF_ASSERT_OK(test_util::BatchResourceBaseTestAccess::SplitOutputTensors(
+      resource, {combined}, &batch));
+  int64_t start = 0;
+  for (int i = 0; i < batch.num_tasks(); ++i) {
+    const int64_t limit = start + batch.task(i).size();
+    const Tensor& output = TaskOutput(batch, i);
+    EXPECT_TRUE(output.SharesBufferWith(combined));
+    test::ExpectTensorEqual<float>(output, combined.Slice(start, limit));
+    start = limit;
+  }
+}
+
+TEST_F(ZeroCopyBatchingTest, CopiesUnalignedOutputSlices) {
+  TestBatchResource resource(/*allowed_batch_sizes=*/{});
+  resource.set_enable_zero_copy_batching(true);
+  BatchResourceBase::BatchT batch;
+  AddTask(Iota(1, 1), &batch);
+  AddTask(Iota(1, 1), &batch);
+  batch.Close();
+
+  const Tensor combined = Iota(2, 1);
+  TF_ASSERT_OK(test_util::BatchResourceBaseTestAccess::SplitOutputTensors(
+      resource, {combined}, &batch));
+  EXPECT_TRUE(TaskOutput(batch, 0).SharesBufferWith(combined));
+  test::ExpectTensorEqual<float>(TaskOutput(batch, 0), combined.Slice(0, 1));
+  // The second slice starts 4 bytes into the buffer, so it is aliased only if
+  // Eigen requires no alignment.
+  const Tensor& second = TaskOutput(batch, 1);
+  EXPECT_EQ(second.SharesBufferWith(combined),
+            combined.Slice(1, 2).IsAligned());
+  EXPECT_TRUE(second.IsAligned());
+  test::ExpectTensorEqual<float>(second, combined.Slice(1, 2));
+}
+
+TEST_F(ZeroCopyBatchingTest, DropsPadding) {
+  TestBatchResource resource(/*allowed_batch_sizes=*/{4});
+  resource.set_enable_zero_copy_batching(true);
+  BatchResourceBase::BatchT batch;
+  const Tensor input = Iota(3, 16);
+  AddTask(input, &batch);
+  batch.Close();
+
+  // The lone task needs a row of padding, so its input is concatenated.
+  std::vector<Tensor> concatenated;
+  TF_ASSERT_OK(test_util::BatchResourceBaseTestAccess::ConcatInputTensors(
+      resource, batch, context_.get(), &concatenated));
+  ASSERT_EQ(concatenated.size(), 1);
+  EXPECT_EQ(concatenated[0].dim_size(0), 4);
+  EXPECT_FALSE(concatenated[0].SharesBufferWith(input));
+  test::ExpectTensorEqual<float>(concatenated[0].Slice(0, 3), input);
+
+  const Tensor combined = Iota(4, 16);
+  TF_ASSERT_OK(test_util::BatchResourceBaseTestAccess::SplitOutputTensors(
+      resource, {combined}, &batch));
+  const Tensor& output = TaskOutput(batch, 0);
+  EXPECT_EQ(output.dim_size(0), 3);
+  EXPECT_TRUE(output.SharesBufferWith(combined));
+  test::ExpectTensorEqual<float>(output, combined.Slice(0, 3));
+}
+
+TEST_F(ZeroCopyBatchingTest, SingleTaskBypassesConcat) {
+  TestBatchResource resource(/*allowed_batch_sizes=*/{});
+  BatchResourceBase::BatchT batch;
+  const Tensor input = Iota(2, 16);
+  AddTask(input, &batch);
+  batch.Close();
+
+  std::vector<Tensor> concatenated;
+  TF_ASSERT_OK(test_util::BatchResourceBaseTestAccess::ConcatInputTensors(
+      resource, batch, context_.get(), &concatenated));
+  ASSERT_EQ(concatenated.size(), 1);
+  EXPECT_FALSE(concatenated[0].SharesBufferWith(input));
+
+  resource.set_enable_zero_copy_batching(true);
+  concatenated.clear();
+  TF_ASSERT_OK(test_util::BatchResourceBaseTestAccess::ConcatInputTensors(
+      resource, batch, context_.get(), &concatenated));
+  ASSERT_EQ(concatenated.size(), 1);
+  EXPECT_TRUE(concatenated[0].SharesBufferWith(input));
+  test::ExpectTensorEqual<float>(concatenated[0], input);
+}
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
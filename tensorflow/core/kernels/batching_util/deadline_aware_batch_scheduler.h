@@ -0,0 +1,651 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_DEADLINE_AWARE_BATCH_SCHEDULER_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_DEADLINE_AWARE_BATCH_SCHEDULER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Deadline of a task that doesn't have one.
+constexpr int64_t kNoBatchTaskDeadline = std::numeric_limits<int64_t>::max();
+
+namespace internal {
+template <typename TaskType>
+class DABSBatch;
+
+template <typename TaskType>
+class DABSQueue;
+
+// Estimates the time it takes to process a batch of a given size, from the
+// processing times of previous batches. Thread-safe.
+class BatchProcessingTimeEstimator {
+ public:
+  // `initial_micros` is the estimate for all batch sizes until a batch has been
+  // processed. `smoothing` is the weight of the latest processing time in the
+  // moving average of each batch size.
+  BatchProcessingTimeEstimator(int max_batch_size, int64_t initial_micros,
+                               double smoothing)
+      : initial_micros_(initial_micros),
+        smoothing_(smoothing),
+        average_micros_(max_batch_size + 1, -1) {}
+
+  void Record(int batch_size, int64_t micros) {
+    mutex_lock l(mu_);
+    if (batch_size < 1 || batch_size > max_batch_size()) return;
+    double& average = average_micros_[batch_size];
+    average = average < 0 ? micros
+                          : (1 - smoothing_) * average + smoothing_ * micros;
+  }
+
+  // Sizes that haven't been observed are interpolated linearly between the
+  // nearest observed sizes. Above the largest observed size, the time is
+  // assumed to grow linearly with the batch size.
+  int64_t Estimate(int batch_size) const {
+    mutex_lock l(mu_);
+    batch_size = std::max(1, std::min(batch_size, max_batch_size()));
+    if (average_micros_[batch_size] >= 0) {
+      return average_micros_[batch_size];
+    }
+    int lower = batch_size - 1;
+    while (lower > 0 && average_micros_[lower] < 0) --lower;
+    int upper = batch_size + 1;
+    while (upper <= max_batch_size() && average_micros_[upper] < 0) ++upper;
+    const bool has_lower = lower > 0;
+    const bool has_upper = upper <= max_batch_size();
+    if (has_lower && has_upper) {
+      const double fraction =
+          static_cast<double>(batch_size - lower) / (upper - lower);
+      return average_micros_[lower] +
+             fraction * (average_micros_[upper] - average_micros_[lower]);
+    }
+    if (has_lower) {
+      return average_micros_[lower] * batch_size / lower;
+    }
+    if (has_upper) {
+      return average_micros_[upper];
+    }
+    return initial_micros_;
+  }
+
+ private:
+  int max_batch_size() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return static_cast<int>(average_micros_.size()) - 1;
+  }
+
+  const int64_t initial_micros_;
+  const double smoothing_;
+  mutable mutex mu_;
+  // Moving average of the processing time of each batch size, or -1 if no
+  // batch of that size has been processed.
+  std::vector<double> average_micros_ TF_GUARDED_BY(mu_);
+};
+}  // namespace internal
+
+// EXPERIMENTAL: API MAY BE SUBJECTED TO SUDDEN CHANGES.
+//
+// Shared batch scheduler for tasks with latency deadlines (e.g. derived from
+// a per-request SLO). TaskType must have a public `int64_t deadline_micros`
+// member holding the absolute deadline of the task, in `Env::NowMicros()`
+// time, or `kNoBatchTaskDeadline`.
+//
+// Instead of closing batches after a fixed timeout, the DeadlineAware
+// BatchScheduler (DABS) keeps a batch open as long as the earliest deadline of
+// its tasks allows: a batch is closed once it is full, or once the current
+// time plus the estimated processing time of the batch reaches that deadline
+// (minus `deadline_margin_micros`). Processing times are estimated per queue
+// and batch size, from the batches processed so far.
+//
+// Batch processing threads pick closed batches in earliest-deadline-first
+// order. Batches that can no longer make their deadline are only processed
+// when no other batch is waiting, so that under overload the scheduler spends
+// its capacity on requests that can still be served within their SLO.
+//
+// Tasks larger than the maximum batch size are rejected; they are not split.
+template <typename TaskType>
+class DeadlineAwareBatchScheduler
+    : public std::enable_shared_from_this<
+          DeadlineAwareBatchScheduler<TaskType>> {
+ public:
+  ~DeadlineAwareBatchScheduler();
+
+  struct Options {
+    // The name to use for the pool of batch threads.
+    string thread_pool_name = {"batch_threads"};
+    // Number of batch processing threads.
+    int64_t num_batch_threads = port::NumSchedulableCPUs();
+    // The environment to use (typically only overridden by test code).
+    Env* env = Env::Default();
+    // Processing time assumed for a batch before any batch of the queue has
+    // been processed.
+    int64_t initial_batch_processing_micros = 1000;
+    // Weight of the latest batch in the moving average of the processing time
+    // of each batch size. Must be in (0, 1].
+    double processing_time_smoothing = 0.1;
+    // Extra time reserved before each deadline, to absorb errors in the
+    // processing time estimates and the time spent waiting for a thread.
+    int64_t deadline_margin_micros = 0;
+    // Maximum time an idle batch processing thread waits before checking for
+    // batches to process. Threads are woken up early when a batch is added,
+    // closed or gets an earlier deadline, and when the earliest open batch
+    // becomes ready.
+    int64_t max_idle_sleep_micros = 1000;
+  };
+
+  // Ownership is shared between the caller of Create() and any queues created
+  // via AddQueue().
+  static Status Create(
+      const Options& options,
+      std::shared_ptr<DeadlineAwareBatchScheduler<TaskType>>* scheduler);
+
+  struct QueueOptions {
+    // Maximum size of each batch.
+    int max_batch_size = 1000;
+    // Maximum number of enqueued (i.e. non-scheduled) batches.
+    int max_enqueued_batches = 10;
+    // Maximum time a batch stays open, regardless of the deadlines of its
+    // tasks. This bounds the latency of tasks without a deadline.
+    int64_t batch_timeout_micros = 10 * 1000;
+  };
+
+  using BatchProcessor = std::function<void(std::unique_ptr<Batch<TaskType>>)>;
+
+  // Adds queue (and its callback) to be managed by this scheduler.
+  Status AddQueue(const QueueOptions& options,
+                  BatchProcessor process_batch_callback,
+                  std::unique_ptr<BatchScheduler<TaskType>>* queue);
+
+ private:
+  // access to AddBatch(), BatchUpdated(), RemoveQueue(), env().
+  friend class internal::DABSQueue<TaskType>;
+
+  // Batch processing callback and processing time estimates of a queue.
+  struct QueueState {
+    BatchProcessor callback;
+    std::shared_ptr<internal::BatchProcessingTimeEstimator> estimator;
+  };
+
+  explicit DeadlineAwareBatchScheduler(const Options& options);
+
+  // Continuously retrieves and processes batches.
+  void ProcessBatches();
+
+  // Returns the best batch to process at time `now_micros`, and removes it
+  // from `batches_`. Returns nullptr if no batch is ready, and sets
+  // `next_ready_micros` to the earliest time at which a batch becomes ready.
+  const internal::DABSBatch<TaskType>* TakeBatch(int64_t now_micros,
+                                                 int64_t* next_ready_micros)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the time after which `batch` must not wait for more tasks.
+  int64_t ReadyTimeMicros(const internal::DABSBatch<TaskType>& batch,
+                          int64_t estimated_micros) const;
+
+  // Notifies scheduler of a new batch.
+  void AddBatch(const internal::DABSBatch<TaskType>* batch);
+
+  // Notifies scheduler that a batch was closed or that its deadline was
+  // lowered, which may make it ready earlier.
+  void BatchUpdated();
+
+  // Removes queue from scheduler.
+  void RemoveQueue(const internal::DABSQueue<TaskType>* queue);
+
+  Env* env() const { return options_.env; }
+
+  const Options options_;
+
+  // Collection of batches added by AddBatch. Owned by scheduler until they are
+  // released for processing.
+  std::vector<const internal::DABSBatch<TaskType>*> batches_ TF_GUARDED_BY(mu_);
+
+  // Unowned queues added by AddQueue.
+  std::unordered_map<const internal::DABSQueue<TaskType>*, QueueState> queues_
+      TF_GUARDED_BY(mu_);
+
+  // Responsible for running the batch processing callbacks.
+  std::unique_ptr<thread::ThreadPool> batch_thread_pool_;
+
+  // Set when the scheduler is destroyed, to stop the processing threads.
+  bool stopped_ TF_GUARDED_BY(mu_) = false;
+
+  mutex mu_;
+
+  // Idle batch processing threads wait on this until a batch may have become
+  // ready, or the scheduler is stopped.
+  condition_variable batch_cv_;
+
+  DeadlineAwareBatchScheduler(const DeadlineAwareBatchScheduler&) = delete;
+  void operator=(const DeadlineAwareBatchScheduler&) = delete;
+};
+
+//////////////////////////////////////////////////////////
+// Implementation details follow. API users need not read.
+
+namespace internal {
+// Consolidates tasks into batches, passing them off to the
+// DeadlineAwareBatchScheduler for processing.
+template <typename TaskType>
+class DABSQueue : public BatchScheduler<TaskType> {
+ public:
+  using QueueOptions =
+      typename DeadlineAwareBatchScheduler<TaskType>::QueueOptions;
+
+  DABSQueue(std::shared_ptr<DeadlineAwareBatchScheduler<TaskType>> scheduler,
+            const QueueOptions& options);
+
+  ~DABSQueue() override;
+
+  // Adds task to current batch. Fails if the task size is larger than the batch
+  // size or if the current batch is full and this queue's number of outstanding
+  // batches is at its maximum.
+  Status Schedule(std::unique_ptr<TaskType>* task) override;
+
+  // Number of tasks waiting to be scheduled.
+  size_t NumEnqueuedTasks() const override;
+
+  // Number of size 1 tasks which could currently be scheduled without failing.
+  size_t SchedulingCapacity() const override;
+
+  // Notifies queue that a batch is about to be scheduled; the queue should not
+  // place any more tasks in this batch.
+  void ReleaseBatch(const DABSBatch<TaskType>* batch);
+
+  size_t max_task_size() const override { return options_.max_batch_size; }
+
+  const QueueOptions& options() const { return options_; }
+
+ private:
+  std::shared_ptr<DeadlineAwareBatchScheduler<TaskType>> scheduler_;
+  const QueueOptions options_;
+  // Owned by scheduler_.
+  DABSBatch<TaskType>* current_batch_ TF_GUARDED_BY(mu_) = nullptr;
+  int64_t num_enqueued_batches_ TF_GUARDED_BY(mu_) = 0;
+  int64_t num_enqueued_tasks_ TF_GUARDED_BY(mu_) = 0;
+  mutable mutex mu_;
+  DABSQueue(const DABSQueue&) = delete;
+  void operator=(const DABSQueue&) = delete;
+};
+
+// Batch which remembers when and by whom it was created, and the earliest
+// deadline of its tasks.
+template <typename TaskType>
+class DABSBatch : public Batch<TaskType> {
+ public:
+  DABSBatch(DABSQueue<TaskType>* queue, int64_t creation_time_micros)
+      : queue_(queue), creation_time_micros_(creation_time_micros) {}
+
+  ~DABSBatch() override {}
+
+  DABSQueue<TaskType>* queue() const { return queue_; }
+
+  int64_t creation_time_micros() const { return creation_time_micros_; }
+
+  int64_t deadline_micros() const { return deadline_micros_.load(); }
+
+  // Lowers the deadline of the batch to `deadline_micros` if it is earlier.
+  // Returns whether the deadline was lowered.
+  bool UpdateDeadline(int64_t deadline_micros) {
+    int64_t current = deadline_micros_.load();
+    while (deadline_micros < current) {
+      if (deadline_micros_.compare_exchange_weak(current, deadline_micros)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  DABSQueue<TaskType>* queue_;
+  const int64_t creation_time_micros_;
+  std::atomic<int64_t> deadline_micros_{kNoBatchTaskDeadline};
+  DABSBatch(const DABSBatch&) = delete;
+  void operator=(const DABSBatch&) = delete;
+};
+}  // namespace internal
+
+// ---------------- DeadlineAwareBatchScheduler ----------------
+
+template <typename TaskType>
+Status DeadlineAwareBatchScheduler<TaskType>::Create(
+    const Options& options,
+    std::shared_ptr<DeadlineAwareBatchScheduler<TaskType>>* scheduler) {
+  if (options.num_batch_threads < 1) {
+    return errors::InvalidArgument("num_batch_threads must be positive; was ",
+                                   options.num_batch_threads);
+  }
+  if (options.initial_batch_processing_micros < 0) {
+    return errors::InvalidArgument(
+        "initial_batch_processing_micros can't be negative; was ",
+        options.initial_batch_processing_micros);
+  }
+  if (options.processing_time_smoothing <= 0 ||
+      options.processing_time_smoothing > 1) {
+    return errors::InvalidArgument(
+        "processing_time_smoothing must be in (0, 1]; was ",
+        options.processing_time_smoothing);
+  }
+  if (options.deadline_margin_micros < 0) {
+    return errors::InvalidArgument(
+        "deadline_margin_micros can't be negative; was ",
+        options.deadline_margin_micros);
+  }
+  if (options.max_idle_sleep_micros < 1) {
+    return errors::InvalidArgument(
+        "max_idle_sleep_micros must be positive; was ",
+        options.max_idle_sleep_micros);
+  }
+  scheduler->reset(new DeadlineAwareBatchScheduler<TaskType>(options));
+  return OkStatus();
+}
+
+template <typename TaskType>
+DeadlineAwareBatchScheduler<TaskType>::DeadlineAwareBatchScheduler(
+    const Options& options)
+    : options_(options) {
+  batch_thread_pool_.reset(new thread::ThreadPool(
+      env(), options.thread_pool_name, options.num_batch_threads));
+  for (int i = 0; i < options.num_batch_threads; i++) {
+    batch_thread_pool_->Schedule(std::bind(
+        &DeadlineAwareBatchScheduler<TaskType>::ProcessBatches, this));
+  }
+}
+
+template <typename TaskType>
+DeadlineAwareBatchScheduler<TaskType>::~DeadlineAwareBatchScheduler() {
+  // Signal processing threads to exit.
+  {
+    mutex_lock l(mu_);
+    stopped_ = true;
+    batch_cv_.notify_all();
+  }
+  // Hangs until all threads finish.
+  batch_thread_pool_.reset();
+}
+
+template <typename TaskType>
+Status DeadlineAwareBatchScheduler<TaskType>::AddQueue(
+    const QueueOptions& options, BatchProcessor process_batch_callback,
+    std::unique_ptr<BatchScheduler<TaskType>>* queue) {
+  if (options.max_batch_size <= 0) {
+    return errors::InvalidArgument("max_batch_size must be positive; was ",
+                                   options.max_batch_size);
+  }
+  if (options.max_enqueued_batches <= 0) {
+    return errors::InvalidArgument(
+        "max_enqueued_batches must be positive; was ",
+        options.max_enqueued_batches);
+  }
+  if (options.batch_timeout_micros < 0) {
+    return errors::InvalidArgument(
+        "batch_timeout_micros can't be negative; was ",
+        options.batch_timeout_micros);
+  }
+  internal::DABSQueue<TaskType>* DABS_queue_raw;
+  queue->reset(DABS_queue_raw = new internal::DABSQueue<TaskType>(
+                   this->shared_from_this(), options));
+  mutex_lock l(mu_);
+  queues_[DABS_queue_raw] = {
+      std::move(process_batch_callback),
+      std::make_shared<internal::BatchProcessingTimeEstimator>(
+          options.max_batch_size, options_.initial_batch_processing_micros,
+          options_.processing_time_smoothing)};
+  return OkStatus();
+}
+
+template <typename TaskType>
+void DeadlineAwareBatchScheduler<TaskType>::AddBatch(
+    const internal::DABSBatch<TaskType>* batch) {
+  mutex_lock l(mu_);
+  batches_.push_back(batch);
+  batch_cv_.notify_one();
+}
+
+template <typename TaskType>
+void DeadlineAwareBatchScheduler<TaskType>::BatchUpdated() {
+  // Idle threads hold `mu_` from the time they look for a ready batch until
+  // they wait, so taking it here ensures that they see the update or get the
+  // notification.
+  mutex_lock l(mu_);
+  batch_cv_.notify_one();
+}
+
+template <typename TaskType>
+void DeadlineAwareBatchScheduler<TaskType>::RemoveQueue(
+    const internal::DABSQueue<TaskType>* queue) {
+  mutex_lock l(mu_);
+  queues_.erase(queue);
+}
+
+template <typename TaskType>
+int64_t DeadlineAwareBatchScheduler<TaskType>::ReadyTimeMicros(
+    const internal::DABSBatch<TaskType>& batch,
+    int64_t estimated_micros) const {
+  const int64_t timeout_micros = batch.creation_time_micros() +
+                                 batch.queue()->options().batch_timeout_micros;
+  const int64_t deadline_micros = batch.deadline_micros();
+  if (deadline_micros == kNoBatchTaskDeadline) {
+    return timeout_micros;
+  }
+  return std::min(timeout_micros, deadline_micros - estimated_micros -
+                                      options_.deadline_margin_micros);
+}
+
+template <typename TaskType>
+const internal::DABSBatch<TaskType>*
+DeadlineAwareBatchScheduler<TaskType>::TakeBatch(int64_t now_micros,
+                                                 int64_t* next_ready_micros) {
+  *next_ready_micros = std::numeric_limits<int64_t>::max();
+  auto best_it = batches_.end();
+  bool best_feasible = false;
+  for (auto it = batches_.begin(); it != batches_.end(); ++it) {
+    const internal::DABSBatch<TaskType>& batch = **it;
+    const int64_t estimated_micros =
+        queues_[batch.queue()].estimator->Estimate(batch.size());
+    if (!batch.IsClosed()) {
+      const int64_t ready_micros = ReadyTimeMicros(batch, estimated_micros);
+      if (ready_micros > now_micros) {
+        *next_ready_micros = std::min(*next_ready_micros, ready_micros);
+        continue;
+      }
+    }
+    // Prefer batches that can still make their deadline, then the earliest
+    // deadline, then the oldest batch.
+    const bool feasible =
+        batch.deadline_micros() == kNoBatchTaskDeadline ||
+        now_micros + estimated_micros <= batch.deadline_micros();
+    if (best_it == batches_.end() || (feasible && !best_feasible)) {
+      best_it = it;
+      best_feasible = feasible;
+      continue;
+    }
+    if (feasible != best_feasible) continue;
+    const internal::DABSBatch<TaskType>& best = **best_it;
+    if (batch.deadline_micros() < best.deadline_micros() ||
+        (batch.deadline_micros() == best.deadline_micros() &&
+         batch.creation_time_micros() < best.creation_time_micros())) {
+      best_it = it;
+    }
+  }
+  if (best_it == batches_.end()) {
+    return nullptr;
+  }
+  const internal::DABSBatch<TaskType>* batch = *best_it;
+  batches_.erase(best_it);
+  return batch;
+}
+
+template <typename TaskType>
+void DeadlineAwareBatchScheduler<TaskType>::ProcessBatches() {
+  for (;;) {
+    const internal::DABSBatch<TaskType>* batch = nullptr;
+    QueueState queue_state;
+    {
+      mutex_lock l(mu_);
+      for (;;) {
+        if (stopped_) return;
+        const int64_t now_micros = env()->NowMicros();
+        int64_t next_ready_micros;
+        batch = TakeBatch(now_micros, &next_ready_micros);
+        if (batch != nullptr) break;
+        // Wait until a batch is added or updated, or until the earliest open
+        // batch becomes ready.
+        const int64_t wait_micros =
+            std::max<int64_t>(1, std::min(next_ready_micros - now_micros,
+                                          options_.max_idle_sleep_micros));
+        batch_cv_.wait_for(l, std::chrono::microseconds(wait_micros));
+      }
+      // Queue may destroy itself after ReleaseBatch is called.
+      batch->queue()->ReleaseBatch(batch);
+      queue_state = queues_[batch->queue()];
+    }
+    const int batch_size = batch->size();
+    const int64_t start_time = env()->NowMicros();
+    queue_state.callback(std::unique_ptr<Batch<TaskType>>(
+        const_cast<internal::DABSBatch<TaskType>*>(batch)));
+    queue_state.estimator->Record(batch_size,
+                                  env()->NowMicros() - start_time);
+  }
+}
+
+// ---------------- DABSQueue ----------------
+
+namespace internal {
+template <typename TaskType>
+DABSQueue<TaskType>::DABSQueue(
+    std::shared_ptr<DeadlineAwareBatchScheduler<TaskType>> scheduler,
+    const QueueOptions& options)
+    : scheduler_(scheduler), options_(options) {}
+
+template <typename TaskType>
+DABSQueue<TaskType>::~DABSQueue() {
+  // Make the open batch ready, and wait until last batch has been scheduled.
+  {
+    mutex_lock l(mu_);
+    if (current_batch_) {
+      current_batch_->Close();
+      current_batch_ = nullptr;
+    }
+  }
+  scheduler_->BatchUpdated();
+  const int kSleepMicros = 1000;
+  for (;;) {
+    {
+      mutex_lock l(mu_);
+      if (num_enqueued_batches_ == 0) {
+        break;
+      }
+    }
+    scheduler_->env()->SleepForMicroseconds(kSleepMicros);
+  }
+  scheduler_->RemoveQueue(this);
+}
+
+template <typename TaskType>
+Status DABSQueue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
+  DABSBatch<TaskType>* new_batch = nullptr;
+  // Whether an enqueued batch was closed or got an earlier deadline.
+  bool batch_updated = false;
+  size_t size = (*task)->size();
+  if (size > options_.max_batch_size) {
+    return errors::InvalidArgument("Task size ", size,
+                                   " is larger than maximum batch size ",
+                                   options_.max_batch_size);
+  }
+  {
+    mutex_lock l(mu_);
+    // Current batch is full, create another if allowed.
+    if (current_batch_ &&
+        current_batch_->size() + size > options_.max_batch_size) {
+      current_batch_->Close();
+      current_batch_ = nullptr;
+      batch_updated = true;
+    }
+    if (!current_batch_) {
+      if (num_enqueued_batches_ >= options_.max_enqueued_batches) {
+        return errors::Unavailable("The batch scheduling queue is full");
+      }
+      num_enqueued_batches_++;
+      current_batch_ = new_batch =
+          new DABSBatch<TaskType>(this, scheduler_->env()->NowMicros());
+    }
+    if (current_batch_->UpdateDeadline((*task)->deadline_micros)) {
+      batch_updated = true;
+    }
+    current_batch_->AddTask(std::move(*task));
+    num_enqueued_tasks_++;
+    // A full batch is ready to be processed right away.
+    if (current_batch_->size() == options_.max_batch_size) {
+      current_batch_->Close();
+      current_batch_ = nullptr;
+      batch_updated = true;
+    }
+  }
+  // AddBatch and BatchUpdated must be called outside of lock, since the
+  // scheduler calls ReleaseBatch with its own lock held.
+  if (batch_updated) scheduler_->BatchUpdated();
+  if (new_batch != nullptr) scheduler_->AddBatch(new_batch);
+  return OkStatus();
+}
+
+template <typename TaskType>
+void DABSQueue<TaskType>::ReleaseBatch(const DABSBatch<TaskType>* batch) {
+  mutex_lock l(mu_);
+  num_enqueued_batches_--;
+  num_enqueued_tasks_ -= batch->num_tasks();
+  if (batch == current_batch_) {
+    current_batch_->Close();
+    current_batch_ = nullptr;
+  }
+}
+
+template <typename TaskType>
+size_t DABSQueue<TaskType>::NumEnqueuedTasks() const {
+  mutex_lock l(mu_);
+  return num_enqueued_tasks_;
+}
+
+template <typename TaskType>
+size_t DABSQueue<TaskType>::SchedulingCapacity() const {
+  mutex_lock l(mu_);
+  const int current_batch_capacity =
+      current_batch_ ? options_.max_batch_size - current_batch_->size() : 0;
+  const int spare_batches =
+      options_.max_enqueued_batches - num_enqueued_batches_;
+  return spare_batches * options_.max_batch_size + current_batch_capacity;
+}
+}  // namespace internal
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_DEADLINE_AWARE_BATCH_SCHEDULER_H_
@@ -0,0 +1,224 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Simulation benchmark for DeadlineAwareBatchScheduler. Tasks with a latency
+// SLO arrive at a given rate, and batches take a simulated, size dependent
+// time to process. Time is simulated with a FakeClockEnv, so the results only
+// depend on the scheduling policy and not on the machine running the
+// benchmark. The benchmark reports goodput, i.e. the fraction of tasks that
+// complete within their SLO, with and without deadlines attached to the tasks
+// (in which case batches are only closed when full or on timeout).
+//
+// Batch threads processing a batch sleep on the fake clock. Idle threads wait
+// on a condition variable for at most `max_idle_sleep_micros` of real time and
+// then read the fake clock again, so after each tick the simulation gives them
+// twice that long to pick up the batches that became ready.
+
+#include <iterator>
+#include <memory>
+#include <random>
+#include <set>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/kernels/batching_util/deadline_aware_batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/histogram/histogram.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+using ::tensorflow::histogram::Histogram;
+
+// Parameters of the simulation.
+constexpr int kSimulationDurationMicros = 2 * 1000 * 1000;
+// Granularity of the arrivals, and margin reserved before each deadline.
+constexpr int kTickMicros = 100;
+// Real time an idle batch thread waits before it reads the fake clock again.
+constexpr int kMaxIdleSleepMicros = 50;
+constexpr int kNumBatchThreads = 2;
+constexpr int kMaxBatchSize = 64;
+constexpr int kSloMicros = 20 * 1000;
+// Batch timeout used when tasks carry no deadline.
+constexpr int kBatchTimeoutMicros = 5 * 1000;
+// Simulated batch processing time is kFixedCostMicros + kPerTaskCostMicros *
+// batch size.
+constexpr int kFixedCostMicros = 3000;
+constexpr int kPerTaskCostMicros = 50;
+
+class SimulatedTask : public BatchTask {
+ public:
+  SimulatedTask(int64_t arrival_micros, int64_t deadline)
+      : deadline_micros(deadline), arrival_micros_(arrival_micros) {}
+
+  size_t size() const override { return 1; }
+
+  int64_t arrival_micros() const { return arrival_micros_; }
+
+  const int64_t deadline_micros;
+
+ private:
+  const int64_t arrival_micros_;
+};
+
+// Runs the simulation, and reports goodput, latency and batch sizes.
+class Simulation {
+ public:
+  Simulation(bool use_deadlines, int qps)
+      : env_(Env::Default()), use_deadlines_(use_deadlines), qps_(qps) {}
+
+  void Run() {
+    DeadlineAwareBatchScheduler<SimulatedTask>::Options options;
+    options.env = &env_;
+    options.num_batch_threads = kNumBatchThreads;
+    options.max_idle_sleep_micros = kMaxIdleSleepMicros;
+    options.deadline_margin_micros = kTickMicros;
+    std::shared_ptr<DeadlineAwareBatchScheduler<SimulatedTask>> scheduler;
+    TF_CHECK_OK(DeadlineAwareBatchScheduler<SimulatedTask>::Create(
+        options, &scheduler));
+    DeadlineAwareBatchScheduler<SimulatedTask>::QueueOptions queue_options;
+    queue_options.max_batch_size = kMaxBatchSize;
+    queue_options.max_enqueued_batches = 1000;
+    queue_options.batch_timeout_micros =
+        use_deadlines_ ? kSloMicros : kBatchTimeoutMicros;
+    std::unique_ptr<BatchScheduler<SimulatedTask>> queue;
+    TF_CHECK_OK(scheduler->AddQueue(
+        queue_options,
+        [this](std::unique_ptr<Batch<SimulatedTask>> batch) {
+          ProcessBatch(std::move(batch));
+        },
+        &queue));
+
+    // Poisson arrivals, with a fixed seed so that runs are comparable.
+    std::mt19937 rng(42);
+    std::exponential_distribution<double> interarrival_micros(qps_ / 1e6);
+    double next_arrival_micros = interarrival_micros(rng);
+    while (env_.NowMicros() < kSimulationDurationMicros) {
+      WaitUntilThreadsSettle();
+      while (next_arrival_micros <= env_.NowMicros()) {
+        const int64_t now = env_.NowMicros();
+        auto task = std::make_unique<SimulatedTask>(
+            now, use_deadlines_ ? now + kSloMicros : kNoBatchTaskDeadline);
+        TF_CHECK_OK(queue->Schedule(&task));
+        ++num_tasks_;
+        next_arrival_micros += interarrival_micros(rng);
+      }
+      env_.AdvanceByMicroseconds(kTickMicros);
+    }
+
+    // Let the scheduler drain its queue.
+    Notification done;
+    std::unique_ptr<Thread> clock_thread(Env::Default()->StartThread(
+        {}, "FakeClockAdvancerThread", [this, &done] {
+          while (!done.HasBeenNotified()) {
+            WaitUntilThreadsSettle();
+            env_.AdvanceByMicroseconds(kTickMicros);
+          }
+        }));
+    queue.reset();
+    scheduler.reset();
+    done.Notify();
+  }
+
+  string Report() {
+    mutex_lock l(mu_);
+    return absl::StrCat(
+        "goodput=", static_cast<double>(num_on_time_) / num_tasks_,
+        ",lat_p99=", latency_millis_histogram_.Percentile(99),
+        "ms,batchsz_p50=", batch_size_histogram_.Percentile(50));
+  }
+
+ private:
+  // Waits until the idle batch threads have taken the batches that are ready at
+  // the current fake time, and the busy ones sleep until their batch is done.
+  void WaitUntilThreadsSettle() {
+    Env::Default()->SleepForMicroseconds(2 * kMaxIdleSleepMicros);
+    int num_busy_threads;
+    {
+      mutex_lock l(mu_);
+      const int64_t now = env_.NowMicros();
+      num_busy_threads = std::distance(
+          completion_micros_.upper_bound(now), completion_micros_.end());
+    }
+    env_.BlockUntilThreadsAsleep(num_busy_threads);
+  }
+
+  void ProcessBatch(std::unique_ptr<Batch<SimulatedTask>> batch) {
+    const int64_t cost_micros =
+        kFixedCostMicros + kPerTaskCostMicros * batch->size();
+    // The clock may be advanced past the end of the batch before this thread
+    // wakes up, so the completion time is computed rather than read.
+    const int64_t completion_micros = env_.NowMicros() + cost_micros;
+    {
+      mutex_lock l(mu_);
+      completion_micros_.insert(completion_micros);
+    }
+    env_.SleepForMicroseconds(cost_micros);
+    mutex_lock l(mu_);
+    completion_micros_.erase(completion_micros_.find(completion_micros));
+    batch_size_histogram_.Add(batch->size());
+    for (int i = 0; i < batch->num_tasks(); ++i) {
+      const int64_t latency_micros =
+          completion_micros - batch->task(i).arrival_micros();
+      latency_millis_histogram_.Add(latency_micros / 1000.0);
+      if (latency_micros <= kSloMicros) {
+        ++num_on_time_;
+      }
+    }
+  }
+
+  test_util::FakeClockEnv env_;
+  const bool use_deadlines_;
+  const int qps_;
+  int64_t num_tasks_ = 0;
+
+  mutex mu_;
+  // Completion times of the batches being processed.
+  std::multiset<int64_t> completion_micros_ TF_GUARDED_BY(mu_);
+  int64_t num_on_time_ TF_GUARDED_BY(mu_) = 0;
+  Histogram latency_millis_histogram_ TF_GUARDED_BY(mu_);
+  Histogram batch_size_histogram_ TF_GUARDED_BY(mu_);
+};
+
+void BM_DeadlineSimulation(::testing::benchmark::State& state) {
+  for (auto s : state) {
+    Simulation simulation(/*use_deadlines=*/state.range(0), state.range(1));
+    simulation.Run();
+    state.SetLabel(simulation.Report());
+  }
+}
+BENCHMARK(BM_DeadlineSimulation)
+    ->UseRealTime()
+    ->Iterations(1)
+    ->ArgNames({"deadlines", "qps"})
+    ->ArgsProduct({{0, 1}, {1000, 4000, 8000, 12000}});
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  tensorflow::port::InitMain(argv[0], &argc, &argv);
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
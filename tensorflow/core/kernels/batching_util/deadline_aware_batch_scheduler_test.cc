@@ -0,0 +1,379 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/deadline_aware_batch_scheduler.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+namespace anonymous {
+
+class FakeTask : public BatchTask {
+ public:
+  explicit FakeTask(size_t size, int64_t deadline = kNoBatchTaskDeadline)
+      : deadline_micros(deadline), size_(size) {}
+
+  ~FakeTask() override = default;
+
+  size_t size() const override { return size_; }
+
+  const int64_t deadline_micros;
+
+ private:
+  const size_t size_;
+
+  FakeTask(const FakeTask&) = delete;
+  void operator=(const FakeTask&) = delete;
+};
+
+// Creates a FakeTask of size 'task_size' and deadline 'deadline_micros', and
+// calls 'scheduler->Schedule()' on that task. Returns the resulting status.
+Status ScheduleTask(size_t task_size, int64_t deadline_micros,
+                    BatchScheduler<FakeTask>* scheduler) {
+  std::unique_ptr<FakeTask> task(new FakeTask(task_size, deadline_micros));
+  Status status = scheduler->Schedule(&task);
+  // Schedule() should have consumed 'task' iff it returned Status::OK.
+  CHECK_EQ(status.ok(), task == nullptr);
+  return status;
+}
+
+// Creates a thread that waits on 'start' and then advances the fake clock in
+// 'env' in a loop until 'stop' is notified. Useful for allowing objects that
+// use the clock to be destroyed.
+std::unique_ptr<Thread> CreateFakeClockAdvancerThread(
+    test_util::FakeClockEnv* env, Notification* start, Notification* stop) {
+  return std::unique_ptr<Thread>(Env::Default()->StartThread(
+      {}, "FakeClockAdvancerThread", [env, start, stop] {
+        start->WaitForNotification();
+        while (!stop->HasBeenNotified()) {
+          env->AdvanceByMicroseconds(10);
+          Env::Default()->SleepForMicroseconds(10);
+        }
+      }));
+}
+
+using Scheduler = DeadlineAwareBatchScheduler<FakeTask>;
+
+// Keeps the single batch thread of a scheduler busy with a batch of its own
+// queue until destroyed, so that the batches scheduled meanwhile are all
+// enqueued when the thread picks the next one.
+class BatchThreadBlocker {
+ public:
+  explicit BatchThreadBlocker(Scheduler* scheduler) {
+    Scheduler::QueueOptions queue_options;
+    queue_options.max_batch_size = 1;
+    TF_CHECK_OK(scheduler->AddQueue(
+        queue_options,
+        [this](std::unique_ptr<Batch<FakeTask>> batch) {
+          started_.Notify();
+          release_.WaitForNotification();
+          finished_.Notify();
+        },
+        &queue_));
+    TF_CHECK_OK(ScheduleTask(1, kNoBatchTaskDeadline, queue_.get()));
+    started_.WaitForNotification();
+  }
+
+  ~BatchThreadBlocker() {
+    release_.Notify();
+    finished_.WaitForNotification();
+  }
+
+ private:
+  Notification started_;
+  Notification release_;
+  Notification finished_;
+  std::unique_ptr<BatchScheduler<FakeTask>> queue_;
+};
+
+TEST(DeadlineAwareBatchSchedulerTest, BadOptions) {
+  std::shared_ptr<Scheduler> scheduler;
+  Scheduler::Options options;
+  options.num_batch_threads = 0;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+  options = Scheduler::Options();
+  options.initial_batch_processing_micros = -1;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+  options = Scheduler::Options();
+  options.processing_time_smoothing = 0;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+  options = Scheduler::Options();
+  options.processing_time_smoothing = 1.5;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+  options = Scheduler::Options();
+  options.deadline_margin_micros = -1;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+  options = Scheduler::Options();
+  options.max_idle_sleep_micros = 0;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, BadQueueOptions) {
+  std::shared_ptr<Scheduler> scheduler;
+  TF_ASSERT_OK(Scheduler::Create({}, &scheduler));
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {};
+  std::unique_ptr<BatchScheduler<FakeTask>> queue;
+  Scheduler::QueueOptions queue_options;
+  queue_options.max_batch_size = 0;
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+  queue_options = Scheduler::QueueOptions();
+  queue_options.max_enqueued_batches = 0;
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+  queue_options = Scheduler::QueueOptions();
+  queue_options.batch_timeout_micros = -1;
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, ProcessingTimeEstimator) {
+  internal::BatchProcessingTimeEstimator estimator(
+      /*max_batch_size=*/10, /*initial_micros=*/100, /*smoothing=*/0.5);
+  EXPECT_EQ(estimator.Estimate(4), 100);
+  estimator.Record(2, 200);
+  // Only smaller sizes observed: scale linearly.
+  EXPECT_EQ(estimator.Estimate(4), 400);
+  // Only larger sizes observed: use the nearest one.
+  EXPECT_EQ(estimator.Estimate(1), 200);
+  estimator.Record(6, 600);
+  estimator.Record(6, 200);
+  // Moving average of 600 and 200.
+  EXPECT_EQ(estimator.Estimate(6), 400);
+  // Interpolated between sizes 2 and 6.
+  EXPECT_EQ(estimator.Estimate(4), 300);
+  // Out of range sizes are clamped.
+  EXPECT_EQ(estimator.Estimate(20), 400 * 10 / 6);
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, TaskLargerThanBatch) {
+  std::shared_ptr<Scheduler> scheduler;
+  TF_ASSERT_OK(Scheduler::Create({}, &scheduler));
+  std::unique_ptr<BatchScheduler<FakeTask>> queue;
+  Scheduler::QueueOptions queue_options;
+  queue_options.max_batch_size = 10;
+  TF_ASSERT_OK(scheduler->AddQueue(
+      queue_options, [](std::unique_ptr<Batch<FakeTask>> batch) {}, &queue));
+  EXPECT_EQ(ScheduleTask(11, kNoBatchTaskDeadline, queue.get()).code(),
+            error::INVALID_ARGUMENT);
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, BatchClosedBeforeDeadline) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    options.initial_batch_processing_micros = 100;
+    options.deadline_margin_micros = 50;
+    options.max_idle_sleep_micros = 10;
+    mutex mu;
+    std::vector<int64_t> processing_times;
+    std::vector<int> batch_sizes;
+    Notification processed;
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      mutex_lock l(mu);
+      processing_times.push_back(env.NowMicros());
+      batch_sizes.push_back(batch->size());
+      processed.Notify();
+    };
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(scheduler->AddQueue({}, callback, &queue));
+
+    TF_ASSERT_OK(ScheduleTask(1, /*deadline_micros=*/1000, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(2, /*deadline_micros=*/2000, queue.get()));
+    env.AdvanceByMicroseconds(840);
+    {
+      mutex_lock l(mu);
+      EXPECT_TRUE(processing_times.empty());
+    }
+    // The batch must start by 1000 - 100 - 50 = 850 to make the earliest
+    // deadline.
+    env.AdvanceByMicroseconds(10);
+    processed.WaitForNotification();
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(processing_times, std::vector<int64_t>({850}));
+      EXPECT_EQ(batch_sizes, std::vector<int>({3}));
+    }
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, BatchTimeoutWithoutDeadline) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    options.max_idle_sleep_micros = 10;
+    mutex mu;
+    std::vector<int64_t> processing_times;
+    Notification processed;
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      mutex_lock l(mu);
+      processing_times.push_back(env.NowMicros());
+      processed.Notify();
+    };
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options;
+    queue_options.batch_timeout_micros = 100;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue));
+
+    TF_ASSERT_OK(ScheduleTask(1, kNoBatchTaskDeadline, queue.get()));
+    env.AdvanceByMicroseconds(90);
+    {
+      mutex_lock l(mu);
+      EXPECT_TRUE(processing_times.empty());
+    }
+    env.AdvanceByMicroseconds(10);
+    processed.WaitForNotification();
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(processing_times, std::vector<int64_t>({100}));
+    }
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, EarliestFeasibleDeadlineFirst) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    options.initial_batch_processing_micros = 100;
+    options.max_idle_sleep_micros = 10;
+    mutex mu;
+    std::vector<int64_t> processed_deadlines;
+    BlockingCounter processed(3);
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      mutex_lock l(mu);
+      processed_deadlines.push_back(batch->task(0).deadline_micros);
+      processed.DecrementCount();
+    };
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options;
+    queue_options.max_batch_size = 1;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue1;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue2;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue3;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue1));
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue2));
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue3));
+
+    // Full batches are ready right away. The batch with deadline 50 can't be
+    // processed in time, so it goes last.
+    {
+      BatchThreadBlocker blocker(scheduler.get());
+      TF_ASSERT_OK(ScheduleTask(1, /*deadline_micros=*/5000, queue1.get()));
+      TF_ASSERT_OK(ScheduleTask(1, /*deadline_micros=*/50, queue2.get()));
+      TF_ASSERT_OK(ScheduleTask(1, /*deadline_micros=*/2000, queue3.get()));
+    }
+    processed.Wait();
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(processed_deadlines, std::vector<int64_t>({2000, 5000, 50}));
+    }
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, FullBatchWakesUpIdleThread) {
+  Scheduler::Options options;
+  options.num_batch_threads = 1;
+  // Long enough that the test times out if the thread is not woken up.
+  options.max_idle_sleep_micros = 1000 * 1000 * 1000;
+  Notification processed;
+  std::shared_ptr<Scheduler> scheduler;
+  TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+  Scheduler::QueueOptions queue_options;
+  queue_options.max_batch_size = 2;
+  queue_options.batch_timeout_micros = 1000 * 1000 * 1000;
+  std::unique_ptr<BatchScheduler<FakeTask>> queue;
+  TF_ASSERT_OK(scheduler->AddQueue(
+      queue_options,
+      [&](std::unique_ptr<Batch<FakeTask>> batch) {
+        EXPECT_EQ(batch->size(), 2);
+        processed.Notify();
+      },
+      &queue));
+
+  TF_ASSERT_OK(ScheduleTask(1, kNoBatchTaskDeadline, queue.get()));
+  // Let the thread go back to waiting on the open batch.
+  Env::Default()->SleepForMicroseconds(1000);
+  TF_ASSERT_OK(ScheduleTask(1, kNoBatchTaskDeadline, queue.get()));
+  processed.WaitForNotification();
+}
+
+TEST(DeadlineAwareBatchSchedulerTest, QueueCapacity) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    options.max_idle_sleep_micros = 10;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options;
+    queue_options.max_batch_size = 10;
+    queue_options.max_enqueued_batches = 2;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(scheduler->AddQueue(
+        queue_options, [](std::unique_ptr<Batch<FakeTask>> batch) {}, &queue));
+    // The full batch would otherwise be processed right away.
+    BatchThreadBlocker blocker(scheduler.get());
+
+    EXPECT_EQ(queue->SchedulingCapacity(), 20);
+    TF_ASSERT_OK(ScheduleTask(10, kNoBatchTaskDeadline, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(4, kNoBatchTaskDeadline, queue.get()));
+    EXPECT_EQ(queue->NumEnqueuedTasks(), 2);
+    EXPECT_EQ(queue->SchedulingCapacity(), 6);
+    EXPECT_EQ(ScheduleTask(7, kNoBatchTaskDeadline, queue.get()).code(),
+              error::UNAVAILABLE);
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+}  // namespace anonymous
+}  // namespace serving
+}  // namespace tensorflow
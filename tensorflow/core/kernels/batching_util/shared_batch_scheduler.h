@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <deque>
 #include <functional>
 #include <list>
@@ -97,9 +98,13 @@ namespace serving {
 // For bulk processing jobs and throughput-oriented benchmarks, you may want to
 // set the maximum queue size to a large value.
 //
-// TODO(b/26539183): Support queue servicing policies other than round-robin.
-// E.g. let each queue specify a "share" (an int >= 1), so e.g. with queues A
-// and B having shares 1 and 2 respectively, the servicing pattern is ABBABB...
+// Round-robin servicing gives each queue the same number of batches, no matter
+// how long its batches take to process, so a model with expensive batches can
+// take most of the batch threads away from the others. Setting
+// `Options.enable_fair_share_scheduling` instead divides the batch threads'
+// time between the queues in proportion to their
+// `QueueOptions.fair_share_weight`, and serves queues marked
+// `QueueOptions.latency_critical` ahead of the rest.
 //
 //
 // PERFORMANCE TUNING: See README.md.
@@ -125,6 +130,19 @@ class SharedBatchScheduler
     // The environment to use.
     // (Typically only overridden by test code.)
     Env* env = Env::Default();
+
+    // If true, the batch threads serve the queues by weighted fair share
+    // rather than round-robin. Each queue is charged for the time batch
+    // threads spend processing its batches, divided by its
+    // `QueueOptions.fair_share_weight`, and among the queues that have a batch
+    // ready the one with the smallest charge is served first. A queue is
+    // charged the average processing time of its batches when a batch is
+    // scheduled, and the difference from the actual time once it has been
+    // processed, so that a queue with long batches in flight is not served
+    // again before it has paid for them. Queues with
+    // `QueueOptions.latency_critical` set are always served before the other
+    // queues (batches already being processed are not interrupted).
+    bool enable_fair_share_scheduling = false;
   };
   // Ownership is shared between the caller of Create() and any queues created
   // via AddQueue().
@@ -243,6 +261,18 @@ class SharedBatchScheduler
     PriorityQueueOptions high_priority_queue_options;
     // A subset of queue options for low priority input.
     PriorityQueueOptions low_priority_queue_options;
+
+    // The share of the batch threads' time this queue is entitled to,
+    // relative to the other queues. Must be positive.
+    //
+    // Used iff `Options.enable_fair_share_scheduling` is true.
+    double fair_share_weight = 1.0;
+
+    // If true, a batch thread that frees up takes a ready batch from this
+    // queue before looking at queues that are not latency critical.
+    //
+    // Used iff `Options.enable_fair_share_scheduling` is true.
+    bool latency_critical = false;
   };
   Status AddQueue(const QueueOptions& options,
                   std::function<void(std::unique_ptr<Batch<TaskType>>)>
@@ -252,10 +282,20 @@ class SharedBatchScheduler
  private:
   explicit SharedBatchScheduler(const Options& options);
 
+  // Sets `fair_share_charge_micros_out` to the processing time the queue was
+  // charged in advance for the batch, if any.
   void GetNextWorkItem_Locked(internal::Queue<TaskType>** queue_for_batch_out,
-                              BatchUniquePtr* batch_to_process_out)
+                              BatchUniquePtr* batch_to_process_out,
+                              double* fair_share_charge_micros_out)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Same as GetNextWorkItem_Locked(), but serves the queues by weighted fair
+  // share. See `Options.enable_fair_share_scheduling`.
+  void GetNextFairShareWorkItem_Locked(
+      internal::Queue<TaskType>** queue_for_batch_out,
+      BatchUniquePtr* batch_to_process_out,
+      double* fair_share_charge_micros_out) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // The code executed in 'batch_threads_'. Obtains a batch to process from the
   // queue pointed to by 'next_queue_to_schedule_', and processes it. If that
   // queue declines to provide a batch to process, moves onto the next queue. If
@@ -289,6 +329,13 @@ class SharedBatchScheduler
   // available batch thread should grab work.
   typename QueueList::iterator next_queue_to_schedule_ TF_GUARDED_BY(mu_);
 
+  // The fair share virtual time of the queue that was served last. Used iff
+  // `options_.enable_fair_share_scheduling` is true. A queue whose virtual
+  // time lags behind it (e.g. because it was idle, or was just added) is
+  // treated as if it was at this virtual time, so that it can't monopolize
+  // the batch threads to catch up.
+  double fair_share_virtual_time_ TF_GUARDED_BY(mu_) = 0;
+
   // Used by idle batch threads to wait for work to enter the system. Notified
   // whenever a batch becomes schedulable.
   condition_variable schedulable_batch_cv_;
@@ -381,7 +428,10 @@ class Queue {
   std::unique_ptr<Batch<TaskType>> ScheduleBatchWithEagerSplit();
 
   // Processes a batch that has been returned earlier by ScheduleBatch().
-  void ProcessBatch(std::unique_ptr<Batch<TaskType>> batch);
+  // `fair_share_charge_micros` is the processing time the queue was charged
+  // for the batch by ChargeFairShareVirtualTime().
+  void ProcessBatch(std::unique_ptr<Batch<TaskType>> batch,
+                    double fair_share_charge_micros = 0);
 
   // Determines whether the queue is empty, i.e. has no tasks waiting or being
   // processed.
@@ -392,6 +442,23 @@ class Queue {
 
   bool closed() const TF_NO_THREAD_SAFETY_ANALYSIS { return closed_.load(); }
 
+  // Returns the fair share virtual time of the queue, i.e. the time batch
+  // threads spent processing its batches divided by its fair share weight,
+  // possibly moved forward by AdvanceFairShareVirtualTime().
+  double fair_share_virtual_time() const;
+
+  // Moves the fair share virtual time of the queue forward to `virtual_time`,
+  // if it is behind.
+  void AdvanceFairShareVirtualTime(double virtual_time);
+
+  // Charges the queue for a batch it is about to process: moves its fair
+  // share virtual time forward to `virtual_time`, if it is behind, and then
+  // by the average processing time of its batches. Returns the processing
+  // time charged, in microseconds, which ProcessBatch() corrects.
+  double ChargeFairShareVirtualTime(double virtual_time);
+
+  bool latency_critical() const { return options_.latency_critical; }
+
  private:
   // Computes the max_execution_batch_size of the queue based on queue options.
   static size_t GetMaxExecutionBatchSize(
@@ -528,6 +595,13 @@ class Queue {
   // 'empty_notification_->Notify()'.
   Notification* empty_notification_ TF_GUARDED_BY(mu_) = nullptr;
 
+  // See fair_share_virtual_time().
+  double fair_share_virtual_time_ TF_GUARDED_BY(mu_) = 0;
+
+  // Moving average of the time batch threads spend processing a batch of the
+  // queue, or 0 before the first batch has been processed.
+  double average_batch_processing_micros_ TF_GUARDED_BY(mu_) = 0;
+
   Queue(const Queue&) = delete;
   void operator=(const Queue&) = delete;
 };
@@ -649,6 +723,11 @@ Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
         "enable_large_batch_splitting is enabled.");
   }
 
+  if (options.fair_share_weight <= 0) {
+    return errors::InvalidArgument("fair_share_weight must be positive; was ",
+                                   options.fair_share_weight);
+  }
+
   if (options.enable_large_batch_splitting &&
       (options.input_batch_size_limit < options.max_execution_batch_size)) {
     return errors::InvalidArgument(
@@ -672,6 +751,7 @@ Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
                                           internal_queue.get()));
   {
     mutex_lock l(mu_);
+    internal_queue->AdvanceFairShareVirtualTime(fair_share_virtual_time_);
     queues_.push_back(std::move(internal_queue));
     if (next_queue_to_schedule_ == queues_.end()) {
       next_queue_to_schedule_ = queues_.begin();
@@ -708,7 +788,14 @@ bool SharedBatchScheduler<TaskType>::BatchExists(
 template <typename TaskType>
 void SharedBatchScheduler<TaskType>::GetNextWorkItem_Locked(
     internal::Queue<TaskType>** queue_for_batch_out,
-    BatchUniquePtr* batch_to_process_out) {
+    BatchUniquePtr* batch_to_process_out,
+    double* fair_share_charge_micros_out) {
+  if (options_.enable_fair_share_scheduling) {
+    GetNextFairShareWorkItem_Locked(queue_for_batch_out, batch_to_process_out,
+                                    fair_share_charge_micros_out);
+    return;
+  }
+  *fair_share_charge_micros_out = 0;
   BatchUniquePtr batch_to_process;
   internal::Queue<TaskType>* queue_for_batch = nullptr;
   const int num_queues = queues_.size();
@@ -748,16 +835,84 @@ void SharedBatchScheduler<TaskType>::GetNextWorkItem_Locked(
   *batch_to_process_out = std::move(batch_to_process);
 }
 
+template <typename TaskType>
+void SharedBatchScheduler<TaskType>::GetNextFairShareWorkItem_Locked(
+    internal::Queue<TaskType>** queue_for_batch_out,
+    BatchUniquePtr* batch_to_process_out,
+    double* fair_share_charge_micros_out) {
+  struct Candidate {
+    typename QueueList::iterator queue;
+    bool latency_critical;
+    double virtual_time;
+  };
+  // List the queues starting from 'next_queue_to_schedule_', so that queues
+  // that tie are still served round-robin.
+  std::vector<Candidate> candidates;
+  const int num_queues = queues_.size();
+  candidates.reserve(num_queues);
+  auto queue_iter = next_queue_to_schedule_;
+  for (int i = 0; i < num_queues; ++i) {
+    candidates.push_back(
+        {queue_iter, (*queue_iter)->latency_critical(),
+         std::max((*queue_iter)->fair_share_virtual_time(),
+                  fair_share_virtual_time_)});
+    if (++queue_iter == queues_.end()) {
+      queue_iter = queues_.begin();
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     if (a.latency_critical != b.latency_critical) {
+                       return a.latency_critical;
+                     }
+                     return a.virtual_time < b.virtual_time;
+                   });
+
+  BatchUniquePtr batch_to_process;
+  internal::Queue<TaskType>* queue_for_batch = nullptr;
+  *fair_share_charge_micros_out = 0;
+  for (const Candidate& candidate : candidates) {
+    internal::Queue<TaskType>* queue = candidate.queue->get();
+    // See GetNextWorkItem_Locked() for why closedness is read first.
+    const bool queue_closed = queue->closed();
+    batch_to_process = queue->ScheduleBatch();
+    if (BatchExists(batch_to_process)) {
+      queue_for_batch = queue;
+      *fair_share_charge_micros_out =
+          queue->ChargeFairShareVirtualTime(candidate.virtual_time);
+      fair_share_virtual_time_ =
+          std::max(fair_share_virtual_time_, candidate.virtual_time);
+      next_queue_to_schedule_ = std::next(candidate.queue);
+      break;
+    }
+    if (queue_closed && queue->IsEmpty()) {
+      // We've encountered a closed queue with no work to do. Drop it.
+      if (next_queue_to_schedule_ == candidate.queue) {
+        ++next_queue_to_schedule_;
+      }
+      queues_.erase(candidate.queue);
+    }
+  }
+  if (next_queue_to_schedule_ == queues_.end()) {
+    next_queue_to_schedule_ = queues_.begin();
+  }
+  *queue_for_batch_out = queue_for_batch;
+  *batch_to_process_out = std::move(batch_to_process);
+}
+
 template <typename TaskType>
 void SharedBatchScheduler<TaskType>::ThreadLogic() {
   // A batch to process next (or nullptr if no work to do).
   BatchUniquePtr batch_to_process;
   // The queue with which 'batch_to_process' is associated.
   internal::Queue<TaskType>* queue_for_batch = nullptr;
+  // The processing time 'queue_for_batch' was charged for 'batch_to_process'.
+  double fair_share_charge_micros = 0;
   {
     mutex_lock l(mu_);
     while (true) {
-      GetNextWorkItem_Locked(&queue_for_batch, &batch_to_process);
+      GetNextWorkItem_Locked(&queue_for_batch, &batch_to_process,
+                             &fair_share_charge_micros);
       if (BatchExists(batch_to_process)) break;
       // We couldn't find any work to do. Wait until a new batch becomes
       // schedulable, or some time has elapsed, before checking again.
@@ -793,7 +948,8 @@ void SharedBatchScheduler<TaskType>::ThreadLogic() {
         std::move(absl::get<BatchTaskUniqueptr>(batch_to_process));
   }
 
-  queue_for_batch->ProcessBatch(std::move(batch_to_schedule));
+  queue_for_batch->ProcessBatch(std::move(batch_to_schedule),
+                                fair_share_charge_micros);
 }
 
 namespace internal {
@@ -1127,7 +1283,8 @@ Queue<TaskType>::ScheduleBatch() {
 }
 
 template <typename TaskType>
-void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
+void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch,
+                                   double fair_share_charge_micros) {
   profiler::TraceMeConsumer trace_me(
       [&] {
         return profiler::TraceMeEncode(
@@ -1136,10 +1293,23 @@ void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
       },
       profiler::ContextType::kSharedBatchScheduler,
       batch->traceme_context_id());
+  const uint64 start_time_micros = env_->NowMicros();
   process_batch_callback_(std::move(batch));
+  const uint64 processing_time_micros = env_->NowMicros() - start_time_micros;
 
   {
     mutex_lock l(mu_);
+    // Weight of the last batch in the moving average of the processing time.
+    constexpr double kBatchProcessingTimeSmoothing = 0.2;
+    fair_share_virtual_time_ +=
+        (processing_time_micros - fair_share_charge_micros) /
+        options_.fair_share_weight;
+    average_batch_processing_micros_ =
+        average_batch_processing_micros_ == 0
+            ? processing_time_micros
+            : kBatchProcessingTimeSmoothing * processing_time_micros +
+                  (1 - kBatchProcessingTimeSmoothing) *
+                      average_batch_processing_micros_;
     --num_batches_being_processed_;
     if (empty_notification_ != nullptr && IsEmptyInternal()) {
       empty_notification_->Notify();
@@ -1147,6 +1317,27 @@ void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
   }
 }
 
+template <typename TaskType>
+double Queue<TaskType>::fair_share_virtual_time() const {
+  mutex_lock l(mu_);
+  return fair_share_virtual_time_;
+}
+
+template <typename TaskType>
+void Queue<TaskType>::AdvanceFairShareVirtualTime(double virtual_time) {
+  mutex_lock l(mu_);
+  fair_share_virtual_time_ = std::max(fair_share_virtual_time_, virtual_time);
+}
+
+template <typename TaskType>
+double Queue<TaskType>::ChargeFairShareVirtualTime(double virtual_time) {
+  mutex_lock l(mu_);
+  fair_share_virtual_time_ = std::max(fair_share_virtual_time_, virtual_time);
+  fair_share_virtual_time_ +=
+      average_batch_processing_micros_ / options_.fair_share_weight;
+  return average_batch_processing_micros_;
+}
+
 template <typename TaskType>
 bool Queue<TaskType>::IsEmpty() const {
   mutex_lock l(mu_);
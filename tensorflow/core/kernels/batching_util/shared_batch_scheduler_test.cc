@@ -20,6 +20,7 @@ limitations under the License.
 #include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "absl/base/call_once.h"
 #include "absl/container/fixed_array.h"
@@ -92,10 +93,12 @@ std::unique_ptr<Thread> CreateFakeClockAdvancerThread(
 
 // Creates a shared-batch-scheduler.
 std::shared_ptr<Scheduler> CreateSharedBatchScheduler(
-    int num_batch_threads, Env* env = Env::Default()) {
+    int num_batch_threads, Env* env = Env::Default(),
+    bool enable_fair_share_scheduling = false) {
   Scheduler::Options options;
   options.num_batch_threads = num_batch_threads;
   options.env = env;
+  options.enable_fair_share_scheduling = enable_fair_share_scheduling;
 
   std::shared_ptr<Scheduler> shared_batch_scheduler;
   TF_CHECK_OK(Scheduler::Create(options, &shared_batch_scheduler));
@@ -547,6 +550,249 @@ TEST_P(SharedBatchSchedulerTest, Fairness) {
   stop_teardown.Notify();
 }
 
+// Tests that with fair share scheduling, a queue whose batches are cheap to
+// process is served ahead of a queue whose batches are expensive, rather than
+// alternating between the two.
+TEST_P(SharedBatchSchedulerTest, FairShareSchedulingFavorsCheaperQueue) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    const int kNumTasksPerQueue = 4;
+    mutex mu;
+    std::vector<int> processed_queues;
+    Notification first_batch_scheduled, first_batch_proceed,
+        all_batches_processed;
+    auto make_callback = [&](int queue_index, int64_t processing_micros) {
+      return [&, queue_index,
+              processing_micros](std::unique_ptr<Batch<FakeTask>> batch) {
+        if (!first_batch_scheduled.HasBeenNotified()) {
+          first_batch_scheduled.Notify();
+          first_batch_proceed.WaitForNotification();
+        }
+        env.AdvanceByMicroseconds(processing_micros);
+        mutex_lock l(mu);
+        processed_queues.push_back(queue_index);
+        if (processed_queues.size() == 2 * kNumTasksPerQueue + 1) {
+          all_batches_processed.Notify();
+        }
+      };
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(
+        1, &env, /*enable_fair_share_scheduling=*/true);
+    QueueOptions queue_options =
+        CreateQueueOptions(1 /* max_execution_batch_size */,
+                           1 /* input_batch_size_limit */,
+                           0 /* batch_timeout_micros */, 100);
+    std::vector<std::unique_ptr<BatchScheduler<FakeTask>>> queues(2);
+    TF_ASSERT_OK(scheduler->AddQueue(
+        queue_options, make_callback(0, /*processing_micros=*/1000),
+        &queues[0]));
+    TF_ASSERT_OK(scheduler->AddQueue(
+        queue_options, make_callback(1, /*processing_micros=*/10),
+        &queues[1]));
+
+    // Occupy the batch thread with a batch of queue 0 while both queues fill
+    // up.
+    TF_ASSERT_OK(ScheduleTask(1, queues[0].get()));
+    first_batch_scheduled.WaitForNotification();
+    for (int i = 0; i < kNumTasksPerQueue; ++i) {
+      TF_ASSERT_OK(ScheduleTask(1, queues[0].get()));
+      TF_ASSERT_OK(ScheduleTask(1, queues[1].get()));
+    }
+    first_batch_proceed.Notify();
+    all_batches_processed.WaitForNotification();
+
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(processed_queues,
+                std::vector<int>({0, 1, 1, 1, 1, 0, 0, 0, 0}));
+    }
+
+    // Shut everything down.
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+// Tests that with fair share scheduling, a latency critical queue is served
+// ahead of the other queues.
+TEST_P(SharedBatchSchedulerTest, FairShareServesLatencyCriticalQueueFirst) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    mutex mu;
+    std::vector<int> processed_queues;
+    Notification first_batch_scheduled, first_batch_proceed,
+        all_batches_processed;
+    auto make_callback = [&](int queue_index) {
+      return [&, queue_index](std::unique_ptr<Batch<FakeTask>> batch) {
+        if (!first_batch_scheduled.HasBeenNotified()) {
+          first_batch_scheduled.Notify();
+          first_batch_proceed.WaitForNotification();
+        }
+        mutex_lock l(mu);
+        processed_queues.push_back(queue_index);
+        if (processed_queues.size() == 3) {
+          all_batches_processed.Notify();
+        }
+      };
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(
+        1, &env, /*enable_fair_share_scheduling=*/true);
+    QueueOptions queue_options =
+        CreateQueueOptions(1 /* max_execution_batch_size */,
+                           1 /* input_batch_size_limit */,
+                           0 /* batch_timeout_micros */, 100);
+    QueueOptions latency_critical_queue_options = queue_options;
+    latency_critical_queue_options.latency_critical = true;
+    std::vector<std::unique_ptr<BatchScheduler<FakeTask>>> queues(3);
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, make_callback(0), &queues[0]));
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, make_callback(1), &queues[1]));
+    TF_ASSERT_OK(scheduler->AddQueue(latency_critical_queue_options,
+                                     make_callback(2), &queues[2]));
+
+    // Occupy the batch thread while queues 1 and 2 get a batch each. Round
+    // robin would serve queue 1 next.
+    TF_ASSERT_OK(ScheduleTask(1, queues[0].get()));
+    first_batch_scheduled.WaitForNotification();
+    TF_ASSERT_OK(ScheduleTask(1, queues[1].get()));
+    TF_ASSERT_OK(ScheduleTask(1, queues[2].get()));
+    first_batch_proceed.Notify();
+    all_batches_processed.WaitForNotification();
+
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(processed_queues, std::vector<int>({0, 2, 1}));
+    }
+
+    // Shut everything down.
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+// Tests that with fair share scheduling, a queue is charged for a batch when
+// the batch is scheduled, so that a batch thread that frees up while the batch
+// is being processed serves another queue first.
+TEST_P(SharedBatchSchedulerTest, FairShareChargesBatchesBeingProcessed) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    mutex mu;
+    condition_variable started_cv;
+    std::vector<int> started_queues;
+    bool warming_up = true;
+    Notification warm_up_batch_processed, release_blocker, proceed;
+    auto make_callback = [&](int queue_index, int64_t processing_micros) {
+      return [&, queue_index,
+              processing_micros](std::unique_ptr<Batch<FakeTask>> batch) {
+        bool warm_up;
+        {
+          mutex_lock l(mu);
+          started_queues.push_back(queue_index);
+          started_cv.notify_all();
+          warm_up = warming_up;
+        }
+        if (queue_index == 2) {
+          release_blocker.WaitForNotification();
+        } else if (warm_up) {
+          env.AdvanceByMicroseconds(processing_micros);
+        } else {
+          proceed.WaitForNotification();
+        }
+      };
+    };
+    auto wait_until_started = [&](size_t num_batches) {
+      mutex_lock l(mu);
+      while (started_queues.size() < num_batches) {
+        started_cv.wait(l);
+      }
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(
+        2, &env, /*enable_fair_share_scheduling=*/true);
+    QueueOptions queue_options =
+        CreateQueueOptions(1 /* max_execution_batch_size */,
+                           1 /* input_batch_size_limit */,
+                           0 /* batch_timeout_micros */, 100);
+    std::vector<std::unique_ptr<BatchScheduler<FakeTask>>> queues(3);
+    TF_ASSERT_OK(scheduler->AddQueue(
+        queue_options, make_callback(0, /*processing_micros=*/1000),
+        &queues[0]));
+    TF_ASSERT_OK(scheduler->AddQueue(
+        queue_options, make_callback(1, /*processing_micros=*/1500),
+        &queues[1]));
+    TF_ASSERT_OK(scheduler->AddQueue(
+        queue_options, make_callback(2, /*processing_micros=*/0), &queues[2]));
+
+    // Process one batch of queue 0 and then one of queue 1, so that they are
+    // charged 1000 and 1500 microseconds, and take those times as the
+    // estimates of their next batches.
+    TF_ASSERT_OK(ScheduleTask(1, queues[0].get()));
+    wait_until_started(1);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    TF_ASSERT_OK(ScheduleTask(1, queues[1].get()));
+    wait_until_started(2);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    {
+      mutex_lock l(mu);
+      warming_up = false;
+    }
+
+    // Occupy one batch thread with queue 2, and the other with queue 0, which
+    // is now charged 2000 microseconds in advance.
+    TF_ASSERT_OK(ScheduleTask(1, queues[2].get()));
+    wait_until_started(3);
+    TF_ASSERT_OK(ScheduleTask(1, queues[0].get()));
+    wait_until_started(4);
+    TF_ASSERT_OK(ScheduleTask(1, queues[0].get()));
+    TF_ASSERT_OK(ScheduleTask(1, queues[1].get()));
+
+    // Without the advance charge, queue 0 would be served first again.
+    release_blocker.Notify();
+    wait_until_started(5);
+    proceed.Notify();
+    wait_until_started(6);
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(started_queues, std::vector<int>({0, 1, 2, 0, 1, 0}));
+    }
+
+    // Shut everything down.
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST_P(SharedBatchSchedulerTest, InvalidFairShareWeight) {
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {
+    // do nothing.
+  };
+
+  auto scheduler = CreateSharedBatchScheduler(2);
+
+  QueueOptions queue_options = CreateQueueOptions(10, 10, 0, 2);
+  queue_options.fair_share_weight = 0;
+  std::unique_ptr<Queue> queue;
+  EXPECT_THAT(
+      scheduler->AddQueue(queue_options, callback, &queue),
+      testing::StatusIs(error::INVALID_ARGUMENT,
+                        HasSubstr("fair_share_weight must be positive")));
+}
+
 TEST_P(SharedBatchSchedulerTest, ConstMethods) {
   for (const int max_enqueued_batches : {1, 2, 5}) {
     Notification processing, proceed;
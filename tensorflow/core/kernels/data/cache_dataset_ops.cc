@@ -14,27 +14,38 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/data/bounded_memory_cache.h"
+#include "tensorflow/core/data/hash_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/kernels/data/iterator_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/hash.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
@@ -50,6 +61,7 @@ namespace data {
 /* static */ constexpr const char* const CacheDatasetOp::kFileName;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const CacheDatasetOp::kMemoryBudgetBytes;
 
 namespace {
 
@@ -66,6 +78,10 @@ constexpr char kMemoryDatasetPrefix[] = "Memory";
 constexpr char kMemoryCache[] = "MemoryCache";
 constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
+constexpr char kInputIndex[] = "input_index";
+constexpr char kProducer[] = "Producer";
+constexpr char kProducerIndex[] = "producer_index";
+constexpr char kBoundedMemoryDatasetPrefix[] = "BoundedMemory";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
 constexpr char kIncompleteCacheErrorMessage[] =
@@ -74,6 +90,77 @@ constexpr char kIncompleteCacheErrorMessage[] =
     "contents of the dataset  will be discarded. This can happen if you have "
     "an input pipeline similar to `dataset.cache().take(k).repeat()`. You "
     "should use `dataset.take(k).cache().repeat()` instead.";
+constexpr char kConstOp[] = "Const";
+constexpr char kValue[] = "value";
+constexpr char kReshuffleEachIteration[] = "reshuffle_each_iteration";
+constexpr char kSeed[] = "seed";
+constexpr char kSeed2[] = "seed2";
+constexpr char kSeedGenerator[] = "seed_generator";
+
+// Combines into `hash` the seeds of the ops of `graph_def`, which `HashGraph`
+// ignores, so that inputs shuffled with different seeds do not share a bounded
+// memory cache. Sets `shareable` to false when the graph does not fix the
+// order of the elements, i.e. when an op draws random seeds or gets them from
+// a seed generator resource. Returns an error for ops that reshuffle each
+// iteration, since the cache would mix the elements of different iterations.
+Status HashSeeds(const GraphDef& graph_def, uint64* hash, bool* shareable) {
+  absl::flat_hash_map<absl::string_view, const NodeDef*> node_by_name;
+  for (const NodeDef& node : graph_def.node()) {
+    node_by_name[node.name()] = &node;
+  }
+  for (const NodeDef& node : graph_def.node()) {
+    bool reshuffle_each_iteration = false;
+    const bool has_reshuffle_each_iteration = TryGetNodeAttr(
+        node, kReshuffleEachIteration, &reshuffle_each_iteration);
+    if (reshuffle_each_iteration) {
+      return errors::InvalidArgument(
+          "`", CacheDatasetOp::kMemoryBudgetBytes,
+          "` requires an input that produces the same elements in the same "
+          "order every iteration, but ",
+          node.op(), " reshuffles each iteration.");
+    }
+    const OpRegistrationData* reg;
+    if (!OpRegistry::Global()->LookUp(node.op(), &reg).ok()) {
+      continue;
+    }
+    bool has_seeds = false;
+    bool random_seeds = true;
+    for (int i = 0;
+         i < node.input_size() && i < reg->op_def.input_arg_size(); ++i) {
+      const string& arg_name = reg->op_def.input_arg(i).name();
+      if (arg_name == kSeedGenerator) {
+        // Ops that do not reshuffle create their seed generator from their
+        // seeds, which are hashed below.
+        if (!has_reshuffle_each_iteration) {
+          *shareable = false;
+        }
+        continue;
+      }
+      if (arg_name != kSeed && arg_name != kSeed2) {
+        continue;
+      }
+      has_seeds = true;
+      absl::string_view input_name = node.input(i);
+      const NodeDef* input_node = gtl::FindPtrOrNull(
+          node_by_name, input_name.substr(0, input_name.find(':')));
+      Tensor seed;
+      if (input_node == nullptr || input_node->op() != kConstOp ||
+          !GetNodeAttr(*input_node, kValue, &seed).ok() ||
+          seed.dtype() != DT_INT64 || seed.NumElements() != 1) {
+        *shareable = false;
+        continue;
+      }
+      const int64_t seed_value = seed.flat<int64_t>()(0);
+      random_seeds = random_seeds && seed_value == 0;
+      *hash = Hash64Combine(*hash, seed_value);
+    }
+    // Both seeds set to 0 select random seeds.
+    if (has_seeds && random_seeds) {
+      *shareable = false;
+    }
+  }
+  return OkStatus();
+}
 }  // namespace
 
 class PartialCache {
@@ -1112,15 +1199,340 @@ class CacheDatasetOp::MemoryDatasetV2
   ResourceMgr* const resource_mgr_;  // Not owned.
 };
 
+// This version of memory dataset holds at most `memory_budget_bytes` of
+// elements, evicting the others, and serves the elements it has cached while
+// it is being filled. Its cache is shared by all the datasets of the process
+// that cache the same input with the same budget, as identified by the hash of
+// the input's graph and seeds, so that concurrent jobs do not each produce the
+// same elements. Inputs with random seeds or external state are not shared.
+// The input must produce the same elements in the same order every time it is
+// iterated, since evicted elements are produced again by the iterator that
+// needs them.
+class CacheDatasetOp::BoundedMemoryDataset : public DatasetBase {
+ public:
+  BoundedMemoryDataset(OpKernelContext* ctx, const DatasetBase* input,
+                       std::shared_ptr<BoundedMemoryCache> cache,
+                       std::optional<Tensor> resource_handle)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        cache_(std::move(cache)),
+        resource_handle_(std::move(resource_handle)) {
+    input_->Ref();
+  }
+
+  ~BoundedMemoryDataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    name_utils::IteratorPrefixParams params;
+    params.dataset_prefix = kBoundedMemoryDatasetPrefix;
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix, params)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.dataset_prefix = kBoundedMemoryDatasetPrefix;
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return input_->Cardinality(options);
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
+    Node* filename_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(tstring(""), &filename_node));
+    std::vector<Node*> inputs = {input_node, filename_node};
+    if (resource_handle_.has_value()) {
+      Node* resource_handle_node = nullptr;
+      TF_RETURN_IF_ERROR(
+          b->AddTensor(resource_handle_.value(), &resource_handle_node));
+      inputs.push_back(resource_handle_node);
+    }
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(cache_->budget_bytes(), &memory_budget_bytes);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, inputs, {{kMemoryBudgetBytes, memory_budget_bytes}}, output));
+    return OkStatus();
+  }
+
+ private:
+  // Produces the elements of the input in order for all the iterators of the
+  // dataset, so that an iterator that misses the cache after reading elements
+  // produced by another one does not produce them again. The producer is owned
+  // by the iterator that created it and runs in that iterator's context, which
+  // its input iterator must not outlive.
+  struct Producer {
+    std::unique_ptr<IteratorContext> ctx;
+    std::unique_ptr<IteratorBase> input_impl;
+    // Index of the next element of `input_impl`.
+    int64_t index = 0;
+  };
+
+  // Reads the element at `index_` from the cache when it is there, and from
+  // the dataset's producer otherwise. An element that was evicted after the
+  // producer passed it is produced again by the iterator's own input
+  // iterator, which is only created on the first such miss.
+  class Iterator : public DatasetIterator<BoundedMemoryDataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<BoundedMemoryDataset>(params) {}
+
+    ~Iterator() override {
+      mutex_lock l(dataset()->producer_mu_);
+      if (dataset()->producer_ == producer_.get()) {
+        dataset()->producer_ = nullptr;
+      }
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      BoundedMemoryCache& cache = *dataset()->cache_;
+      const int64_t num_elements = cache.num_elements();
+      if (num_elements != kUnknownCardinality && index_ >= num_elements) {
+        *end_of_sequence = true;
+        return OkStatus();
+      }
+      if (cache.Lookup(index_, out_tensors)) {
+        ++index_;
+        *end_of_sequence = false;
+        return OkStatus();
+      }
+      bool produced;
+      TF_RETURN_IF_ERROR(
+          GetNextFromProducer(ctx, out_tensors, end_of_sequence, &produced));
+      if (produced) {
+        if (!*end_of_sequence) {
+          ++index_;
+        }
+        return OkStatus();
+      }
+      if (!input_impl_) {
+        TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+            ctx, this, prefix(), &input_impl_));
+        input_index_ = 0;
+      }
+      TF_RETURN_IF_ERROR(
+          ProduceElement(ctx, input_impl_.get(), &input_index_, out_tensors,
+                         end_of_sequence));
+      if (!*end_of_sequence) {
+        ++index_;
+      }
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kIndex, index_));
+      if (input_impl_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(prefix(), kInputIndex, input_index_));
+        TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      }
+      if (producer_) {
+        mutex_lock producer_l(dataset()->producer_mu_);
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(prefix(), kProducerIndex, producer_->index));
+        TF_RETURN_IF_ERROR(SaveInput(ctx, writer, producer_->input_impl));
+      }
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kIndex, &index_));
+      input_impl_.reset();
+      if (reader->Contains(prefix(), kInputIndex)) {
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(prefix(), kInputIndex, &input_index_));
+        TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+            ctx, this, prefix(), &input_impl_));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+      }
+      mutex_lock producer_l(dataset()->producer_mu_);
+      if (dataset()->producer_ == producer_.get()) {
+        dataset()->producer_ = nullptr;
+      }
+      producer_.reset();
+      if (reader->Contains(prefix(), kProducerIndex)) {
+        producer_ = std::make_unique<Producer>();
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(prefix(), kProducerIndex, &producer_->index));
+        producer_->ctx = std::make_unique<IteratorContext>(*ctx);
+        TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+            ctx, this, full_name(kProducer), &producer_->input_impl));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, producer_->input_impl));
+        if (dataset()->producer_ == nullptr) {
+          dataset()->producer_ = producer_.get();
+        }
+      }
+      return OkStatus();
+    }
+
+   private:
+    // Produces the element at `index_` with the dataset's producer, creating
+    // one owned by this iterator if there is none. Sets `produced` to false if
+    // the producer has already passed `index_`.
+    Status GetNextFromProducer(IteratorContext* ctx,
+                               std::vector<Tensor>* out_tensors,
+                               bool* end_of_sequence, bool* produced)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      mutex_lock l(dataset()->producer_mu_);
+      if (dataset()->producer_ == nullptr) {
+        if (!producer_) {
+          auto producer = std::make_unique<Producer>();
+          producer->ctx = std::make_unique<IteratorContext>(*ctx);
+          TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+              ctx, this, full_name(kProducer), &producer->input_impl));
+          producer_ = std::move(producer);
+        }
+        dataset()->producer_ = producer_.get();
+      }
+      Producer* producer = dataset()->producer_;
+      *produced = producer->index <= index_;
+      if (!*produced) {
+        return OkStatus();
+      }
+      return ProduceElement(producer->ctx.get(), producer->input_impl.get(),
+                            &producer->index, out_tensors, end_of_sequence);
+    }
+
+    // Produces the element at `index_` with `input_impl`, whose next element
+    // is at `*input_index`, and caches it.
+    Status ProduceElement(IteratorContext* ctx, IteratorBase* input_impl,
+                          int64_t* input_index,
+                          std::vector<Tensor>* out_tensors,
+                          bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      BoundedMemoryCache& cache = *dataset()->cache_;
+      while (*input_index < index_) {
+        int num_skipped;
+        TF_RETURN_IF_ERROR(input_impl->Skip(
+            ctx,
+            static_cast<int>(std::min<int64_t>(
+                index_ - *input_index, std::numeric_limits<int>::max())),
+            end_of_sequence, &num_skipped));
+        *input_index += num_skipped;
+        if (*end_of_sequence) {
+          cache.SetNumElements(*input_index);
+          return OkStatus();
+        }
+      }
+      TF_RETURN_IF_ERROR(input_impl->GetNext(ctx, out_tensors, end_of_sequence));
+      if (*end_of_sequence) {
+        cache.SetNumElements(*input_index);
+        return OkStatus();
+      }
+      cache.Insert(index_, *out_tensors);
+      ++*input_index;
+      return OkStatus();
+    }
+
+    mutex mu_;
+    // Index of the next element to produce.
+    int64_t index_ TF_GUARDED_BY(mu_) = 0;
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    // Index of the next element of `input_impl_`, which is at most `index_`.
+    int64_t input_index_ TF_GUARDED_BY(mu_) = 0;
+    // The dataset's producer, if this iterator created it. Other iterators use
+    // it while it is registered with the dataset, under its `producer_mu_`.
+    std::unique_ptr<Producer> producer_ TF_GUARDED_BY(mu_);
+  };
+
+  const DatasetBase* const input_;
+  const std::shared_ptr<BoundedMemoryCache> cache_;
+  // The `cache` input of `CacheDatasetV2`, which is unused by this dataset.
+  const std::optional<Tensor> resource_handle_;
+  mutable mutex producer_mu_;
+  // The producer used by the iterators of the dataset, if any.
+  mutable Producer* producer_ TF_GUARDED_BY(producer_mu_) = nullptr;
+};
+
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {
+  if (ctx->HasAttr(kMemoryBudgetBytes)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+    OP_REQUIRES(ctx, memory_budget_bytes_ >= 0,
+                errors::InvalidArgument("`", kMemoryBudgetBytes,
+                                        "` must be non-negative, but got ",
+                                        memory_budget_bytes_, "."));
+  }
+}
 
 void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                                  DatasetBase** output) {
   // Parse out the filenames tensor.
   tstring filename;
   OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, kFileName, &filename));
+  if (memory_budget_bytes_ > 0) {
+    OP_REQUIRES(ctx, filename.empty(),
+                errors::InvalidArgument(
+                    "`", kMemoryBudgetBytes,
+                    "` is only supported when caching in memory, but got "
+                    "filename ",
+                    filename, "."));
+    // Computes the hash of the input, which identifies the cache to share.
+    GraphDef graph_def;
+    SerializationContext::Params params(ctx);
+    std::vector<std::pair<string, Tensor>> input_list;
+    params.input_list = &input_list;
+    params.external_state_policy = ExternalStatePolicy::POLICY_IGNORE;
+    OP_REQUIRES_OK(ctx,
+                   AsGraphDef(input, SerializationContext(params), &graph_def));
+    uint64 hash;
+    OP_REQUIRES_OK(ctx, HashGraph(graph_def, &hash));
+    bool shareable = input->CheckExternalState().ok();
+    OP_REQUIRES_OK(ctx, HashSeeds(graph_def, &hash, &shareable));
+    // An input whose elements are not fixed by its graph gets a cache of its
+    // own.
+    std::shared_ptr<BoundedMemoryCache> cache =
+        shareable
+            ? BoundedMemoryCache::GetOrCreate(hash, memory_budget_bytes_)
+            : std::make_shared<BoundedMemoryCache>(memory_budget_bytes_);
+    std::optional<Tensor> resource_handle;
+    if (op_version_ == 2) {
+      resource_handle = ctx->input(2);
+    }
+    *output = new BoundedMemoryDataset(ctx, input, std::move(cache),
+                                       std::move(resource_handle));
+    return;
+  }
   if (filename.empty()) {
     static std::atomic<int64_t> resource_id_counter(0);
     const string& container = ctx->resource_manager()->default_container();
@@ -17,6 +17,7 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 #include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
@@ -26,6 +27,7 @@ namespace {
 constexpr char kNodeName[] = "cache_dataset";
 constexpr char kFileDatasetPrefix[] = "File";
 constexpr char kMemoryDatasetPrefix[] = "Memory";
+constexpr char kBoundedMemoryDatasetPrefix[] = "BoundedMemory";
 
 class CacheDatasetParams : public DatasetParams {
  public:
@@ -33,10 +35,11 @@ class CacheDatasetParams : public DatasetParams {
   CacheDatasetParams(T input_dataset_params, string filename,
                      DataTypeVector output_dtypes,
                      std::vector<PartialTensorShape> output_shapes,
-                     string node_name)
+                     string node_name, int64_t memory_budget_bytes = 0)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
-        filename_(filename) {
+        filename_(filename),
+        memory_budget_bytes_(memory_budget_bytes) {
     input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -58,6 +61,10 @@ class CacheDatasetParams : public DatasetParams {
     *attr_vector = {{"output_types", output_dtypes_},
                     {"output_shapes", output_shapes_},
                     {"metadata", ""}};
+    if (memory_budget_bytes_ > 0) {
+      attr_vector->emplace_back(CacheDatasetOp::kMemoryBudgetBytes,
+                                memory_budget_bytes_);
+    }
     return OkStatus();
   }
 
@@ -67,6 +74,64 @@ class CacheDatasetParams : public DatasetParams {
 
  private:
   string filename_;
+  int64_t memory_budget_bytes_;
+};
+
+// Shuffles the input, which the bounded memory cache tests cache.
+class ShuffleDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  ShuffleDatasetParams(T input_dataset_params, int64_t buffer_size,
+                       int64_t seed, int64_t seed2,
+                       bool reshuffle_each_iteration,
+                       DataTypeVector output_dtypes,
+                       std::vector<PartialTensorShape> output_shapes,
+                       string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        buffer_size_(buffer_size),
+        seed_(seed),
+        seed2_(seed2),
+        reshuffle_each_iteration_(reshuffle_each_iteration) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64_t>(TensorShape({}), {buffer_size_}),
+            CreateTensor<int64_t>(TensorShape({}), {seed_}),
+            CreateTensor<int64_t>(TensorShape({}), {seed2_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {
+        ShuffleDatasetOpBase::kInputDataset, ShuffleDatasetOpBase::kBufferSize,
+        ShuffleDatasetOpBase::kSeed, ShuffleDatasetOpBase::kSeed2};
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {
+        {"output_types", output_dtypes_},
+        {"output_shapes", output_shapes_},
+        {"reshuffle_each_iteration", reshuffle_each_iteration_},
+        {"metadata", ""},
+        {ShuffleDatasetOp::kSpillDirectory, ""},
+        {ShuffleDatasetOp::kInMemoryBufferSize, int64_t{-1}}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return ShuffleDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64_t buffer_size_;
+  int64_t seed_;
+  int64_t seed2_;
+  bool reshuffle_each_iteration_;
 };
 
 class CacheDatasetOpTest : public DatasetOpsTestBase {
@@ -97,6 +162,21 @@ class CacheDatasetOpTest : public DatasetOpsTestBase {
   }
 
  protected:
+  // Creates an iterator over `dataset` and returns all its elements.
+  Status GetAllOutputs(const DatasetParams& dataset_params,
+                       const TestDataset& dataset,
+                       std::vector<Tensor>* outputs) {
+    std::unique_ptr<TestIterator> iterator;
+    TF_RETURN_IF_ERROR(MakeIterator(dataset_params, dataset, &iterator));
+    bool end_of_sequence = false;
+    while (!end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_RETURN_IF_ERROR(iterator->GetNext(&next, &end_of_sequence));
+      outputs->insert(outputs->end(), next.begin(), next.end());
+    }
+    return OkStatus();
+  }
+
   tstring cache_filename_;
 };
 
@@ -150,6 +230,57 @@ CacheDatasetParams CacheDatasetParams4() {
                             kNodeName);
 }
 
+// Test case 5: cache data in memory, with room for 2 of the 3 elements.
+CacheDatasetParams CacheDatasetParams5() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{3, 3, 1},
+                                            {0, 1, 2, 3, 4, 5, 6, 7, 8})},
+      /*node_name=*/"tensor_slice");
+  return CacheDatasetParams(std::move(tensor_slice_dataset_params),
+                            /*filename=*/"",
+                            /*output_dtypes=*/{DT_INT64},
+                            /*output_shapes=*/{PartialTensorShape({3, 1})},
+                            kNodeName, /*memory_budget_bytes=*/48);
+}
+
+// Test case 6: cache empty data in memory, with a memory budget.
+CacheDatasetParams CacheDatasetParams6() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{0}, {})},
+      /*node_name=*/"tensor_slice");
+  return CacheDatasetParams(std::move(tensor_slice_dataset_params),
+                            /*filename=*/"",
+                            /*output_dtypes=*/{DT_INT64},
+                            /*output_shapes=*/{PartialTensorShape({})},
+                            kNodeName, /*memory_budget_bytes=*/48);
+}
+
+// Shuffles 10 elements with the given seeds.
+ShuffleDatasetParams ShuffleDatasetParams10(int64_t seed, int64_t seed2,
+                                            bool reshuffle_each_iteration) {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{10},
+                                            {0, 1, 2, 3, 4, 5, 6, 7, 8, 9})},
+      /*node_name=*/"tensor_slice");
+  return ShuffleDatasetParams(std::move(tensor_slice_dataset_params),
+                              /*buffer_size=*/10, seed, seed2,
+                              reshuffle_each_iteration,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/"shuffle");
+}
+
+// Caches 10 shuffled elements in memory, with room for all of them.
+CacheDatasetParams BoundedMemoryShuffleDatasetParams(
+    int64_t seed, int64_t seed2, bool reshuffle_each_iteration = false) {
+  return CacheDatasetParams(
+      ShuffleDatasetParams10(seed, seed2, reshuffle_each_iteration),
+      /*filename=*/"",
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({})}, kNodeName,
+      /*memory_budget_bytes=*/1024);
+}
+
 std::vector<GetNextTestCase<CacheDatasetParams>> GetNextTestCases() {
   return {{/*dataset_params=*/CacheDatasetParams1(),
            /*expected_outputs=*/
@@ -162,6 +293,12 @@ std::vector<GetNextTestCase<CacheDatasetParams>> GetNextTestCases() {
            CreateTensors<int64_t>(TensorShape({3, 1}),
                                   {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
           {/*dataset_params=*/CacheDatasetParams4(),
+           /*expected_outputs=*/{}},
+          {/*dataset_params=*/CacheDatasetParams5(),
+           /*expected_outputs=*/
+           CreateTensors<int64_t>(TensorShape({3, 1}),
+                                  {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
+          {/*dataset_params=*/CacheDatasetParams6(),
            /*expected_outputs=*/{}}};
 }
 
@@ -247,7 +384,9 @@ std::vector<CardinalityTestCase<CacheDatasetParams>> CardinalityTestCases() {
           {/*dataset_params=*/CacheDatasetParams3(),
            /*expected_cardinality=*/3},
           {/*dataset_params=*/CacheDatasetParams4(),
-           /*expected_cardinality=*/0}};
+           /*expected_cardinality=*/0},
+          {/*dataset_params=*/CacheDatasetParams5(),
+           /*expected_cardinality=*/3}};
 }
 
 DATASET_CARDINALITY_TEST_P(CacheDatasetOpTest, CacheDatasetParams,
@@ -286,6 +425,142 @@ TEST_F(CacheDatasetOpTest, IteratorPrefix) {
       iterator_prefix_params)));
 }
 
+TEST_F(CacheDatasetOpTest, BoundedMemoryIteratorPrefix) {
+  auto dataset_params = CacheDatasetParams5();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  name_utils::IteratorPrefixParams iterator_prefix_params;
+  iterator_prefix_params.dataset_prefix = kBoundedMemoryDatasetPrefix;
+  TF_ASSERT_OK(CheckIteratorPrefix(name_utils::IteratorPrefix(
+      CacheDatasetOp::kDatasetType, dataset_params.iterator_prefix(),
+      iterator_prefix_params)));
+}
+
+// Iterators of a bounded memory cache read the elements cached by each other
+// while the cache is being filled.
+TEST_F(CacheDatasetOpTest, BoundedMemoryConcurrentIterators) {
+  auto dataset_params = CacheDatasetParams5();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::unique_ptr<IteratorBase> other_iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &other_iterator));
+  std::vector<Tensor> out_tensors;
+  std::vector<Tensor> other_out_tensors;
+  bool end_of_sequence = false;
+  bool other_end_of_sequence = false;
+  while (!end_of_sequence || !other_end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    std::vector<Tensor> other_next;
+    TF_ASSERT_OK(other_iterator->GetNext(iterator_ctx_.get(), &other_next,
+                                         &other_end_of_sequence));
+    other_out_tensors.insert(other_out_tensors.end(), other_next.begin(),
+                             other_next.end());
+  }
+  std::vector<Tensor> expected_outputs = CreateTensors<int64_t>(
+      TensorShape({3, 1}), {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}});
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+  TF_EXPECT_OK(ExpectEqual(other_out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
+// The iterators of a bounded memory cache keep reading the input after the
+// iterator that created the shared producer is destroyed.
+TEST_F(CacheDatasetOpTest, BoundedMemoryProducerOwnerDestroyed) {
+  auto dataset_params = CacheDatasetParams5();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> out_tensors;
+  bool end_of_sequence = false;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  std::unique_ptr<IteratorBase> other_iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &other_iterator));
+  std::vector<Tensor> other_out_tensors;
+  TF_ASSERT_OK(other_iterator->GetNext(iterator_ctx_.get(), &other_out_tensors,
+                                       &end_of_sequence));
+  iterator_.reset();
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(other_iterator->GetNext(iterator_ctx_.get(), &next,
+                                         &end_of_sequence));
+    other_out_tensors.insert(other_out_tensors.end(), next.begin(),
+                             next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(
+      other_out_tensors,
+      CreateTensors<int64_t>(TensorShape({3, 1}),
+                             {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}}),
+      /*compare_order=*/true));
+}
+
+TEST_F(CacheDatasetOpTest, InvalidMemoryBudget) {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{3, 3, 1},
+                                            {0, 1, 2, 3, 4, 5, 6, 7, 8})},
+      /*node_name=*/"tensor_slice");
+  auto dataset_params = CacheDatasetParams(
+      std::move(tensor_slice_dataset_params),
+      /*filename=*/io::JoinPath(testing::TmpDir(), "cache_data"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({3, 1})}, kNodeName,
+      /*memory_budget_bytes=*/48);
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+// Inputs shuffled with different seeds do not share a bounded memory cache.
+TEST_F(CacheDatasetOpTest, BoundedMemoryDifferentSeeds) {
+  auto dataset_params = BoundedMemoryShuffleDatasetParams(/*seed=*/1,
+                                                          /*seed2=*/2);
+  auto other_dataset_params = BoundedMemoryShuffleDatasetParams(/*seed=*/3,
+                                                                /*seed2=*/4);
+  TF_ASSERT_OK(InitializeRuntime(dataset_params));
+  // Both caches are alive while they are filled.
+  std::unique_ptr<TestDataset> dataset;
+  TF_ASSERT_OK(MakeDataset(dataset_params, &dataset));
+  std::unique_ptr<TestDataset> other_dataset;
+  TF_ASSERT_OK(MakeDataset(other_dataset_params, &other_dataset));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(GetAllOutputs(dataset_params, *dataset, &outputs));
+  std::vector<Tensor> other_outputs;
+  TF_ASSERT_OK(
+      GetAllOutputs(other_dataset_params, *other_dataset, &other_outputs));
+
+  auto shuffle_params = ShuffleDatasetParams10(
+      /*seed=*/1, /*seed2=*/2, /*reshuffle_each_iteration=*/false);
+  std::unique_ptr<TestDataset> shuffle;
+  TF_ASSERT_OK(MakeDataset(shuffle_params, &shuffle));
+  std::vector<Tensor> expected_outputs;
+  TF_ASSERT_OK(GetAllOutputs(shuffle_params, *shuffle, &expected_outputs));
+  auto other_shuffle_params = ShuffleDatasetParams10(
+      /*seed=*/3, /*seed2=*/4, /*reshuffle_each_iteration=*/false);
+  std::unique_ptr<TestDataset> other_shuffle;
+  TF_ASSERT_OK(MakeDataset(other_shuffle_params, &other_shuffle));
+  std::vector<Tensor> other_expected_outputs;
+  TF_ASSERT_OK(GetAllOutputs(other_shuffle_params, *other_shuffle,
+                             &other_expected_outputs));
+
+  EXPECT_FALSE(ExpectEqual(expected_outputs, other_expected_outputs,
+                           /*compare_order=*/true)
+                   .ok());
+  TF_EXPECT_OK(ExpectEqual(outputs, expected_outputs,
+                           /*compare_order=*/true));
+  TF_EXPECT_OK(ExpectEqual(other_outputs, other_expected_outputs,
+                           /*compare_order=*/true));
+}
+
+TEST_F(CacheDatasetOpTest, BoundedMemoryReshuffleEachIteration) {
+  auto dataset_params = BoundedMemoryShuffleDatasetParams(
+      /*seed=*/1, /*seed2=*/2, /*reshuffle_each_iteration=*/true);
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
 std::vector<IteratorSaveAndRestoreTestCase<CacheDatasetParams>>
 IteratorSaveAndRestoreTestCases() {
   return {{/*dataset_params=*/CacheDatasetParams1(),
@@ -302,6 +577,14 @@ IteratorSaveAndRestoreTestCases() {
            CreateTensors<int64_t>(TensorShape({3, 1}),
                                   {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
           {/*dataset_params=*/CacheDatasetParams4(),
+           /*breakpoints=*/{0, 2, 4, 11},
+           /*expected_outputs=*/{}},
+          {/*dataset_params=*/CacheDatasetParams5(),
+           /*breakpoints=*/{0, 2, 4, 11},
+           /*expected_outputs=*/
+           CreateTensors<int64_t>(TensorShape({3, 1}),
+                                  {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
+          {/*dataset_params=*/CacheDatasetParams6(),
            /*breakpoints=*/{0, 2, 4, 11},
            /*expected_outputs=*/{}}};
 }
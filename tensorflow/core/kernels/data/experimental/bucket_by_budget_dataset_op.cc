@@ -0,0 +1,629 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/bucket_by_budget_dataset_op.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/stringprintf.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kDatasetType;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kInputDataset;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kWindowSize;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kBudget;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kPaddedShapes;
+/* static */ constexpr const char* const
+    BucketByBudgetDatasetOp::kPaddingValues;
+/* static */ constexpr const char* const
+    BucketByBudgetDatasetOp::kLengthComponent;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kBudgetUnit;
+/* static */ constexpr const char* const
+    BucketByBudgetDatasetOp::kShuffleBatches;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kSeed;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kSeed2;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kToutputTypes;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const
+    BucketByBudgetDatasetOp::kNumPaddedShapes;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kTokens;
+/* static */ constexpr const char* const BucketByBudgetDatasetOp::kBytes;
+
+namespace {
+
+constexpr char kExhausted[] = "exhausted";
+constexpr char kNumBatches[] = "num_batches";
+constexpr char kBatch[] = "batch";
+constexpr char kWindow[] = "window";
+constexpr char kNumRandomSamples[] = "num_random_samples";
+
+// Returns the number of bytes a value of `dtype` takes in a batch. Types
+// without a fixed size, such as strings, are counted by the size of their
+// handle.
+int64_t ValueSizeBytes(DataType dtype) {
+  const int64_t size = DataTypeSize(dtype);
+  return size > 0 ? size : sizeof(tstring);
+}
+
+}  // namespace
+
+class BucketByBudgetDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, int64_t window_size, int64_t budget,
+          int64_t length_component, std::string budget_unit,
+          bool shuffle_batches, int64_t seed, int64_t seed2,
+          std::vector<PartialTensorShape> padded_shapes,
+          std::vector<Tensor> padding_values, const DatasetBase* input)
+      : DatasetBase(DatasetContext(ctx)),
+        window_size_(window_size),
+        budget_(budget),
+        length_component_(length_component),
+        budget_unit_(std::move(budget_unit)),
+        shuffle_batches_(shuffle_batches),
+        seeds_(seed, seed2),
+        padded_shapes_(std::move(padded_shapes)),
+        padding_values_(std::move(padding_values)),
+        input_(input),
+        traceme_metadata_(
+            {{"window_size",
+              strings::Printf("%lld", static_cast<long long>(window_size))},
+             {"budget",
+              strings::Printf("%lld", static_cast<long long>(budget))},
+             {"budget_unit", budget_unit_}}) {
+    input_->Ref();
+    output_shapes_.reserve(padded_shapes_.size());
+    for (const PartialTensorShape& padded_shape : padded_shapes_) {
+      output_shapes_.push_back(
+          PartialTensorShape({-1}).Concatenate(padded_shape));
+    }
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.set_args(window_size_, budget_, budget_unit_);
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    int64_t n = input_->Cardinality(options);
+    if (n == kInfiniteCardinality || n == 0) {
+      return n;
+    }
+    return kUnknownCardinality;
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* window_size = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(window_size_, &window_size));
+    Node* budget = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(budget_, &budget));
+
+    std::vector<Node*> padded_shapes;
+    padded_shapes.reserve(padded_shapes_.size());
+    for (const PartialTensorShape& padded_shape : padded_shapes_) {
+      Node* node;
+      Tensor t(DT_INT64, TensorShape({padded_shape.dims()}));
+      for (int j = 0; j < padded_shape.dims(); ++j) {
+        t.vec<int64_t>()(j) = padded_shape.dim_size(j);
+      }
+      TF_RETURN_IF_ERROR(b->AddTensor(t, &node));
+      padded_shapes.emplace_back(node);
+    }
+
+    std::vector<Node*> padding_values;
+    padding_values.reserve(padding_values_.size());
+    for (const Tensor& t : padding_values_) {
+      Node* node;
+      TF_RETURN_IF_ERROR(b->AddTensor(t, &node));
+      padding_values.emplace_back(node);
+    }
+
+    AttrValue length_component;
+    b->BuildAttrValue(length_component_, &length_component);
+    AttrValue budget_unit;
+    b->BuildAttrValue(budget_unit_, &budget_unit);
+    AttrValue shuffle_batches;
+    b->BuildAttrValue(shuffle_batches_, &shuffle_batches);
+    AttrValue seed;
+    b->BuildAttrValue(seeds_.first, &seed);
+    AttrValue seed2;
+    b->BuildAttrValue(seeds_.second, &seed2);
+    AttrValue output_types;
+    b->BuildAttrValue(output_dtypes(), &output_types);
+    AttrValue N;
+    b->BuildAttrValue<int64_t>(padded_shapes_.size(), &N);
+
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {{0, input_graph_node}, {1, window_size}, {2, budget}},
+        {{3, padded_shapes}, {4, padding_values}},
+        {{kLengthComponent, length_component},
+         {kBudgetUnit, budget_unit},
+         {kShuffleBatches, shuffle_batches},
+         {kSeed, seed},
+         {kSeed2, seed2},
+         {kToutputTypes, output_types},
+         {kNumPaddedShapes, N}},
+        output));
+    return OkStatus();
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params),
+          seeds_(MaybeOverrideSeeds(params.dataset->seeds_)),
+          parent_generator_(seeds_.first, seeds_.second),
+          generator_(&parent_generator_) {}
+
+    Status Initialize(IteratorContext* ctx) override {
+      return dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      std::vector<std::vector<Tensor>> batch_elements;
+      {
+        mutex_lock l(mu_);
+        if (batches_.empty()) {
+          TF_RETURN_IF_ERROR(FillWindow(ctx));
+        }
+        if (batches_.empty()) {
+          *end_of_sequence = true;
+          return OkStatus();
+        }
+        batch_elements = std::move(batches_.front());
+        batches_.pop_front();
+      }
+      TF_RETURN_IF_ERROR(CopyBatch(ctx, batch_elements, out_tensors));
+      *end_of_sequence = false;
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeUnknownRatioNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          prefix(), kExhausted, static_cast<int64_t>(!input_impl_)));
+      if (input_impl_) {
+        TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      }
+      TF_RETURN_IF_ERROR(
+          WriteElementsToCheckpoint(writer, WindowKeyPrefix(), window_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kNumBatches, batches_.size()));
+      for (int64_t i = 0; i < batches_.size(); ++i) {
+        TF_RETURN_IF_ERROR(
+            WriteElementsToCheckpoint(writer, BatchKeyPrefix(i), batches_[i]));
+      }
+      // Saves the state needed to restore the random number generators.
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kNumRandomSamples,
+                                             num_random_samples_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kSeed, seeds_.first));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kSeed2, seeds_.second));
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      int64_t input_exhausted;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kExhausted, &input_exhausted));
+      if (static_cast<bool>(input_exhausted)) {
+        input_impl_.reset();
+      } else {
+        TF_RETURN_IF_ERROR(
+            dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+      }
+      window_.clear();
+      TF_RETURN_IF_ERROR(
+          ReadElementsFromCheckpoint(ctx, reader, WindowKeyPrefix(), &window_));
+      int64_t num_batches;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kNumBatches, &num_batches));
+      batches_.clear();
+      for (int64_t i = 0; i < num_batches; ++i) {
+        std::vector<std::vector<Tensor>> batch_elements;
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+            ctx, reader, BatchKeyPrefix(i), &batch_elements));
+        batches_.push_back(std::move(batch_elements));
+      }
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kNumRandomSamples,
+                                            &num_random_samples_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kSeed, &seeds_.first));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kSeed2, &seeds_.second));
+      ResetRngs();
+      return OkStatus();
+    }
+
+    TraceMeMetadata GetTraceMeMetadata() const override {
+      return dataset()->traceme_metadata_;
+    }
+
+   private:
+    // Padded shape of each component of a batch, without the batch dimension.
+    using PaddedDims = std::vector<std::vector<int64_t>>;
+
+    std::string BatchKeyPrefix(int64_t index) const {
+      return absl::StrCat(prefix(), kColon, kBatch, "[", index, "]");
+    }
+
+    std::string WindowKeyPrefix() const {
+      return absl::StrCat(prefix(), kColon, kWindow);
+    }
+
+    // Reads up to `window_size` elements from the input, sorts them by length,
+    // and splits them into batches that fit in the budget. If the input fails,
+    // the elements read so far stay in `window_`, and the next call continues
+    // filling it.
+    Status FillWindow(IteratorContext* ctx) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      bool end_of_sequence = false;
+      while (input_impl_ &&
+             static_cast<int64_t>(window_.size()) < dataset()->window_size_) {
+        std::vector<Tensor> element;
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, &element, &end_of_sequence));
+        if (end_of_sequence) {
+          input_impl_.reset();
+          break;
+        }
+        TF_RETURN_IF_ERROR(CheckElement(element));
+        window_.push_back(std::move(element));
+      }
+      std::vector<std::vector<Tensor>> window;
+      window.swap(window_);
+      const int64_t length_component = dataset()->length_component_;
+      std::stable_sort(window.begin(), window.end(),
+                       [length_component](const std::vector<Tensor>& a,
+                                          const std::vector<Tensor>& b) {
+                         return a[length_component].dim_size(0) <
+                                b[length_component].dim_size(0);
+                       });
+
+      // Since the elements are sorted, each batch only pads its elements to
+      // lengths close to their own.
+      std::vector<std::vector<Tensor>> batch_elements;
+      PaddedDims dims;
+      for (std::vector<Tensor>& element : window) {
+        PaddedDims new_dims = batch_elements.empty() ? InitialDims() : dims;
+        UpdateDims(element, new_dims);
+        // An element that exceeds the budget on its own is batched alone.
+        if (!batch_elements.empty() &&
+            Cost(batch_elements.size() + 1, new_dims) > dataset()->budget_) {
+          batches_.push_back(std::move(batch_elements));
+          batch_elements.clear();
+          new_dims = InitialDims();
+          UpdateDims(element, new_dims);
+        }
+        batch_elements.push_back(std::move(element));
+        dims = std::move(new_dims);
+      }
+      if (!batch_elements.empty()) {
+        batches_.push_back(std::move(batch_elements));
+      }
+      if (dataset()->shuffle_batches_) {
+        for (int64_t i = batches_.size() - 1; i > 0; --i) {
+          std::swap(batches_[i], batches_[Random() % (i + 1)]);
+        }
+      }
+      return OkStatus();
+    }
+
+    void ResetRngs() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      parent_generator_ = random::PhiloxRandom(seeds_.first, seeds_.second);
+      generator_ =
+          random::SingleSampleAdapter<random::PhiloxRandom>(&parent_generator_);
+      generator_.Skip(num_random_samples_);
+    }
+
+    uint32 Random() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      ++num_random_samples_;
+      return generator_();
+    }
+
+    Status CheckElement(const std::vector<Tensor>& element) const {
+      for (size_t i = 0; i < element.size(); ++i) {
+        const PartialTensorShape& padded_shape = dataset()->padded_shapes_[i];
+        if (element[i].dims() != padded_shape.dims()) {
+          return errors::InvalidArgument(
+              "All elements must have the same rank as the padded shape for "
+              "component ",
+              i, ": expected rank ", padded_shape.dims(),
+              " but got element with rank ", element[i].dims());
+        }
+      }
+      return OkStatus();
+    }
+
+    // Returns the padded dimensions of an empty batch: the known dimensions of
+    // the padded shapes, and 0 for the unknown ones.
+    PaddedDims InitialDims() const {
+      PaddedDims dims;
+      dims.reserve(dataset()->padded_shapes_.size());
+      for (const PartialTensorShape& padded_shape : dataset()->padded_shapes_) {
+        std::vector<int64_t>& component_dims = dims.emplace_back();
+        for (int d = 0; d < padded_shape.dims(); ++d) {
+          component_dims.push_back(
+              std::max<int64_t>(padded_shape.dim_size(d), 0));
+        }
+      }
+      return dims;
+    }
+
+    // Grows the unknown dimensions of `dims` to fit `element`.
+    void UpdateDims(const std::vector<Tensor>& element,
+                    PaddedDims& dims) const {
+      for (size_t i = 0; i < element.size(); ++i) {
+        const PartialTensorShape& padded_shape = dataset()->padded_shapes_[i];
+        for (int d = 0; d < padded_shape.dims(); ++d) {
+          if (padded_shape.dim_size(d) == -1) {
+            dims[i][d] = std::max(dims[i][d], element[i].dim_size(d));
+          }
+        }
+      }
+    }
+
+    // Returns the cost of a batch of `num_elements` padded to `dims`, in the
+    // unit of the budget.
+    int64_t Cost(int64_t num_elements, const PaddedDims& dims) const {
+      if (!dataset()->budget_in_bytes()) {
+        return num_elements * dims[dataset()->length_component_][0];
+      }
+      int64_t element_bytes = 0;
+      for (size_t i = 0; i < dims.size(); ++i) {
+        int64_t num_values = 1;
+        for (int64_t dim : dims[i]) {
+          num_values *= dim;
+        }
+        element_bytes +=
+            num_values * ValueSizeBytes(dataset()->output_dtypes()[i]);
+      }
+      return num_elements * element_bytes;
+    }
+
+    // Copies the batch elements into one padded tensor per component, and
+    // records the fraction of padding in the length component.
+    Status CopyBatch(IteratorContext* ctx,
+                     const std::vector<std::vector<Tensor>>& batch_elements,
+                     std::vector<Tensor>* out_tensors) {
+      const int64_t num_batch_elements = batch_elements.size();
+      PaddedDims dims = InitialDims();
+      for (const std::vector<Tensor>& element : batch_elements) {
+        UpdateDims(element, dims);
+      }
+      for (size_t component_index = 0; component_index < dims.size();
+           ++component_index) {
+        TensorShape batch_component_shape({num_batch_elements});
+        for (int64_t dim : dims[component_index]) {
+          TF_RETURN_IF_ERROR(batch_component_shape.AddDimWithStatus(dim));
+        }
+        out_tensors->emplace_back(ctx->allocator({}),
+                                  output_dtypes()[component_index],
+                                  batch_component_shape);
+        Tensor& batch_component = out_tensors->back();
+        TF_RETURN_IF_ERROR(batch_util::SetElementZero(
+            &batch_component, dataset()->padding_values_[component_index]));
+        TensorShape component_shape;
+        TF_RETURN_IF_ERROR(
+            TensorShape::BuildTensorShape(dims[component_index],
+                                          &component_shape));
+        for (int64_t i = 0; i < num_batch_elements; ++i) {
+          const Tensor& element = batch_elements[i][component_index];
+          for (int d = 0; d < element.dims(); ++d) {
+            if (element.dim_size(d) > component_shape.dim_size(d)) {
+              return errors::DataLoss(
+                  "Attempted to pad to a smaller size than the input "
+                  "element.");
+            }
+          }
+          // Take the fast path if possible.
+          if (element.shape() == component_shape) {
+            TF_RETURN_IF_ERROR(
+                batch_util::CopyElementToSlice(element, &batch_component, i));
+          } else {
+            TF_RETURN_IF_ERROR(batch_util::CopyElementToLargerSlice(
+                element, &batch_component, i));
+          }
+        }
+      }
+
+      int64_t num_values = 0;
+      for (const std::vector<Tensor>& element : batch_elements) {
+        num_values += element[dataset()->length_component_].dim_size(0);
+      }
+      metrics::RecordTFDataPaddingEfficiency(
+          kDatasetType, num_values,
+          num_batch_elements * dims[dataset()->length_component_][0]);
+      return OkStatus();
+    }
+
+    mutex mu_;
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    // Elements of the next window read so far.
+    std::vector<std::vector<Tensor>> window_ TF_GUARDED_BY(mu_);
+    // Batches of the current window that have not been produced yet.
+    std::deque<std::vector<std::vector<Tensor>>> batches_ TF_GUARDED_BY(mu_);
+    // Generates the order of the batches of each window if `shuffle_batches`
+    // is set.
+    std::pair<int64_t, int64_t> seeds_ TF_GUARDED_BY(mu_);
+    random::PhiloxRandom parent_generator_ TF_GUARDED_BY(mu_);
+    random::SingleSampleAdapter<random::PhiloxRandom> generator_
+        TF_GUARDED_BY(mu_);
+    int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
+  };
+
+  bool budget_in_bytes() const { return budget_unit_ == kBytes; }
+
+  const int64_t window_size_;
+  const int64_t budget_;
+  const int64_t length_component_;
+  const std::string budget_unit_;
+  const bool shuffle_batches_;
+  const std::pair<int64_t, int64_t> seeds_;
+  const std::vector<PartialTensorShape> padded_shapes_;
+  const std::vector<Tensor> padding_values_;
+  const DatasetBase* const input_;
+  std::vector<PartialTensorShape> output_shapes_;
+  const TraceMeMetadata traceme_metadata_;
+};
+
+BucketByBudgetDatasetOp::BucketByBudgetDatasetOp(OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kLengthComponent, &length_component_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kBudgetUnit, &budget_unit_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kShuffleBatches, &shuffle_batches_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kSeed, &seed_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kSeed2, &seed2_));
+}
+
+void BucketByBudgetDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                          DatasetBase* input,
+                                          DatasetBase** output) {
+  int64_t window_size;
+  OP_REQUIRES_OK(ctx,
+                 ParseScalarArgument<int64_t>(ctx, kWindowSize, &window_size));
+  OP_REQUIRES(
+      ctx, window_size > 0,
+      errors::InvalidArgument("Window size must be greater than zero."));
+  int64_t budget;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kBudget, &budget));
+  OP_REQUIRES(ctx, budget > 0,
+              errors::InvalidArgument("Budget must be greater than zero."));
+
+  OpInputList padded_shape_tensors;
+  OP_REQUIRES_OK(ctx, ctx->input_list(kPaddedShapes, &padded_shape_tensors));
+  OP_REQUIRES(ctx, padded_shape_tensors.size() == input->output_shapes().size(),
+              errors::InvalidArgument("Number of padded shapes (",
+                                      padded_shape_tensors.size(),
+                                      ") must match the number of components "
+                                      "in the input dataset's elements (",
+                                      input->output_shapes().size(), ")"));
+  std::vector<PartialTensorShape> padded_shapes;
+  padded_shapes.reserve(padded_shape_tensors.size());
+  for (const Tensor& padded_shape_t : padded_shape_tensors) {
+    OP_REQUIRES(ctx, TensorShapeUtils::IsVector(padded_shape_t.shape()),
+                errors::InvalidArgument("All padded shapes must be vectors"));
+    PartialTensorShape padded_shape;
+    OP_REQUIRES_OK(ctx, PartialTensorShape::MakePartialShape(
+                            padded_shape_t.vec<int64_t>().data(),
+                            padded_shape_t.NumElements(), &padded_shape));
+    padded_shapes.push_back(std::move(padded_shape));
+  }
+  OP_REQUIRES(ctx,
+              length_component_ < static_cast<int64_t>(padded_shapes.size()),
+              errors::InvalidArgument(
+                  "Length component ", length_component_,
+                  " is out of range for elements with ", padded_shapes.size(),
+                  " components"));
+  OP_REQUIRES(ctx, padded_shapes[length_component_].dims() > 0,
+              errors::InvalidArgument(
+                  "The length component must have a rank of at least 1"));
+
+  OpInputList padding_values_list;
+  OP_REQUIRES_OK(ctx, ctx->input_list(kPaddingValues, &padding_values_list));
+  OP_REQUIRES(ctx, padding_values_list.size() == input->output_shapes().size(),
+              errors::InvalidArgument(
+                  "Number of padding values (", padding_values_list.size(),
+                  ") must match the number of components in the input "
+                  "dataset's elements (",
+                  input->output_shapes().size(), ")"));
+  std::vector<Tensor> padding_values;
+  for (int i = 0; i < padding_values_list.size(); ++i) {
+    const Tensor& padding_value_t = padding_values_list[i];
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(padding_value_t.shape()),
+                errors::InvalidArgument("All padding values must be scalars"));
+    OP_REQUIRES(ctx, padding_value_t.dtype() == input->output_dtypes()[i],
+                errors::InvalidArgument(
+                    "Mismatched type between padding value ", i,
+                    " and input dataset's component ", i, ": ",
+                    DataTypeString(padding_value_t.dtype()), " vs. ",
+                    DataTypeString(input->output_dtypes()[i])));
+    padding_values.push_back(tensor::DeepCopy(padding_value_t));
+  }
+
+  *output = new Dataset(ctx, window_size, budget, length_component_,
+                        budget_unit_, shuffle_batches_, seed_, seed2_,
+                        std::move(padded_shapes),
+                        std::move(padding_values), input);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(Name("BucketByBudgetDataset").Device(DEVICE_CPU),
+                        BucketByBudgetDatasetOp);
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,431 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/bucket_by_budget_dataset_op.h"
+
+#include "tensorflow/core/data/dataset_test_base.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "bucket_by_budget_dataset";
+
+class BucketByBudgetDatasetOpTest : public DatasetOpsTestBase {};
+
+class BucketByBudgetDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  BucketByBudgetDatasetParams(T input_dataset_params, int64_t window_size,
+                              int64_t budget, std::vector<Tensor> padded_shapes,
+                              std::vector<Tensor> padded_values,
+                              int64_t length_component, string budget_unit,
+                              DataTypeVector output_dtypes,
+                              std::vector<PartialTensorShape> output_shapes,
+                              string node_name, bool shuffle_batches = false,
+                              int64_t seed = 0, int64_t seed2 = 0)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        window_size_(window_size),
+        budget_(budget),
+        padded_shapes_(std::move(padded_shapes)),
+        padded_values_(std::move(padded_values)),
+        length_component_(length_component),
+        budget_unit_(std::move(budget_unit)),
+        shuffle_batches_(shuffle_batches),
+        seed_(seed),
+        seed2_(seed2) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    std::vector<Tensor> input_tensors;
+    input_tensors.emplace_back(
+        CreateTensor<int64_t>(TensorShape({}), {window_size_}));
+    input_tensors.emplace_back(
+        CreateTensor<int64_t>(TensorShape({}), {budget_}));
+    for (auto& padded_shape : padded_shapes_) {
+      input_tensors.emplace_back(padded_shape);
+    }
+    for (auto& padded_value : padded_values_) {
+      input_tensors.emplace_back(padded_value);
+    }
+    return input_tensors;
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {BucketByBudgetDatasetOp::kInputDataset,
+                    BucketByBudgetDatasetOp::kWindowSize,
+                    BucketByBudgetDatasetOp::kBudget};
+    for (int i = 0; i < padded_shapes_.size(); ++i) {
+      input_names->emplace_back(
+          strings::StrCat(BucketByBudgetDatasetOp::kPaddedShapes, "_", i));
+    }
+    for (int j = 0; j < padded_values_.size(); ++j) {
+      input_names->emplace_back(
+          strings::StrCat(BucketByBudgetDatasetOp::kPaddingValues, "_", j));
+    }
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {
+        {BucketByBudgetDatasetOp::kLengthComponent, length_component_},
+        {BucketByBudgetDatasetOp::kBudgetUnit, budget_unit_},
+        {BucketByBudgetDatasetOp::kShuffleBatches, shuffle_batches_},
+        {BucketByBudgetDatasetOp::kSeed, seed_},
+        {BucketByBudgetDatasetOp::kSeed2, seed2_},
+        {BucketByBudgetDatasetOp::kToutputTypes, output_dtypes_},
+        {BucketByBudgetDatasetOp::kOutputShapes, output_shapes_},
+        {BucketByBudgetDatasetOp::kNumPaddedShapes,
+         static_cast<int64_t>(padded_shapes_.size())},
+        {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return BucketByBudgetDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64_t window_size_;
+  int64_t budget_;
+  std::vector<Tensor> padded_shapes_;
+  std::vector<Tensor> padded_values_;
+  int64_t length_component_;
+  string budget_unit_;
+  bool shuffle_batches_;
+  int64_t seed_;
+  int64_t seed2_;
+};
+
+// Produces the elements [1, 2, 3], [4, 5, 6], [7], [8], [9].
+ConcatenateDatasetParams VariableLengthDatasetParams() {
+  auto tensor_slice_dataset_params_0 = TensorSliceDatasetParams(
+      /*components=*/CreateTensors<int64_t>(TensorShape{2, 3},
+                                            {{1, 2, 3, 4, 5, 6}}),
+      /*node_name=*/"tensor_slice_0");
+  auto tensor_slice_dataset_params_1 = TensorSliceDatasetParams(
+      /*components=*/CreateTensors<int64_t>(TensorShape{3, 1}, {{7, 8, 9}}),
+      /*node_name=*/"tensor_slice_1");
+  return ConcatenateDatasetParams(std::move(tensor_slice_dataset_params_0),
+                                  std::move(tensor_slice_dataset_params_1),
+                                  /*output_dtypes=*/{DT_INT64},
+                                  /*output_shapes=*/{PartialTensorShape({-1})},
+                                  /*node_name=*/"concatenate");
+}
+
+BucketByBudgetDatasetParams MakeDatasetParams(int64_t window_size,
+                                              int64_t budget,
+                                              string budget_unit = "tokens",
+                                              int64_t padded_length = -1,
+                                              bool shuffle_batches = false) {
+  return BucketByBudgetDatasetParams(
+      VariableLengthDatasetParams(), window_size, budget,
+      /*padded_shapes=*/
+      {CreateTensor<int64_t>(TensorShape{1}, {padded_length})},
+      /*padded_values=*/{CreateTensor<int64_t>(TensorShape{}, {0})},
+      /*length_component=*/0, std::move(budget_unit),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1, padded_length})},
+      /*node_name=*/kNodeName, shuffle_batches, /*seed=*/1, /*seed2=*/2);
+}
+
+// Test case 1: the window holds all the elements, which are sorted by length
+// and batched up to 6 tokens.
+BucketByBudgetDatasetParams BucketByBudgetDatasetParams1() {
+  return MakeDatasetParams(/*window_size=*/5, /*budget=*/6);
+}
+
+// Test case 2: elements are only sorted within windows of 3 elements.
+BucketByBudgetDatasetParams BucketByBudgetDatasetParams2() {
+  return MakeDatasetParams(/*window_size=*/3, /*budget=*/6);
+}
+
+// Test case 3: batches of up to 24 bytes, or 3 int64 values.
+BucketByBudgetDatasetParams BucketByBudgetDatasetParams3() {
+  return MakeDatasetParams(/*window_size=*/5, /*budget=*/24,
+                           /*budget_unit=*/"bytes");
+}
+
+// Test case 4: elements longer than the budget are batched alone.
+BucketByBudgetDatasetParams BucketByBudgetDatasetParams4() {
+  return MakeDatasetParams(/*window_size=*/5, /*budget=*/2);
+}
+
+// Test case 5: elements are padded to a fixed length, which is also the length
+// used for the budget.
+BucketByBudgetDatasetParams BucketByBudgetDatasetParams5() {
+  return MakeDatasetParams(/*window_size=*/5, /*budget=*/8,
+                           /*budget_unit=*/"tokens", /*padded_length=*/4);
+}
+
+// Test case 6: like test case 4, but the batches are produced in a random
+// order.
+BucketByBudgetDatasetParams BucketByBudgetDatasetParams6() {
+  return MakeDatasetParams(/*window_size=*/5, /*budget=*/2,
+                           /*budget_unit=*/"tokens", /*padded_length=*/-1,
+                           /*shuffle_batches=*/true);
+}
+
+std::vector<GetNextTestCase<BucketByBudgetDatasetParams>> GetNextTestCases() {
+  return {
+      {/*dataset_params=*/BucketByBudgetDatasetParams1(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{3, 1}, {7, 8, 9}),
+        CreateTensor<int64_t>(TensorShape{2, 3}, {1, 2, 3, 4, 5, 6})}},
+      {/*dataset_params=*/BucketByBudgetDatasetParams2(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 3}, {7, 0, 0, 1, 2, 3}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6}),
+        CreateTensor<int64_t>(TensorShape{2, 1}, {8, 9})}},
+      {/*dataset_params=*/BucketByBudgetDatasetParams3(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{3, 1}, {7, 8, 9}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {1, 2, 3}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6})}},
+      {/*dataset_params=*/BucketByBudgetDatasetParams4(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 1}, {7, 8}),
+        CreateTensor<int64_t>(TensorShape{1, 1}, {9}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {1, 2, 3}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6})}},
+      {/*dataset_params=*/BucketByBudgetDatasetParams5(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 4}, {7, 0, 0, 0, 8, 0, 0, 0}),
+        CreateTensor<int64_t>(TensorShape{2, 4}, {9, 0, 0, 0, 1, 2, 3, 0}),
+        CreateTensor<int64_t>(TensorShape{1, 4}, {4, 5, 6, 0})}},
+      {/*dataset_params=*/BucketByBudgetDatasetParams6(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 1}, {7, 8}),
+        CreateTensor<int64_t>(TensorShape{1, 1}, {9}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {1, 2, 3}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6})},
+       /*compare_order=*/false}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(BucketByBudgetDatasetOpTest,
+                         BucketByBudgetDatasetParams, GetNextTestCases())
+
+TEST_F(BucketByBudgetDatasetOpTest, DatasetNodeName) {
+  auto dataset_params = BucketByBudgetDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetNodeName(dataset_params.node_name()));
+}
+
+TEST_F(BucketByBudgetDatasetOpTest, DatasetTypeString) {
+  auto dataset_params = BucketByBudgetDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetTypeString(
+      name_utils::OpName(BucketByBudgetDatasetOp::kDatasetType)));
+}
+
+TEST_F(BucketByBudgetDatasetOpTest, DatasetOutputDtypes) {
+  auto dataset_params = BucketByBudgetDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetOutputDtypes({DT_INT64}));
+}
+
+std::vector<DatasetOutputShapesTestCase<BucketByBudgetDatasetParams>>
+DatasetOutputShapesTestCases() {
+  return {{/*dataset_params=*/BucketByBudgetDatasetParams1(),
+           /*expected_output_shapes=*/{PartialTensorShape({-1, -1})}},
+          {/*dataset_params=*/BucketByBudgetDatasetParams5(),
+           /*expected_output_shapes=*/{PartialTensorShape({-1, 4})}}};
+}
+
+DATASET_OUTPUT_SHAPES_TEST_P(BucketByBudgetDatasetOpTest,
+                             BucketByBudgetDatasetParams,
+                             DatasetOutputShapesTestCases())
+
+TEST_F(BucketByBudgetDatasetOpTest, Cardinality) {
+  auto dataset_params = BucketByBudgetDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetCardinality(kUnknownCardinality));
+}
+
+TEST_F(BucketByBudgetDatasetOpTest, IteratorOutputDtypes) {
+  auto dataset_params = BucketByBudgetDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorOutputDtypes({DT_INT64}));
+}
+
+TEST_F(BucketByBudgetDatasetOpTest, IteratorOutputShapes) {
+  auto dataset_params = BucketByBudgetDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorOutputShapes({PartialTensorShape({-1, -1})}));
+}
+
+TEST_F(BucketByBudgetDatasetOpTest, IteratorPrefix) {
+  auto dataset_params = BucketByBudgetDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorPrefix(
+      name_utils::IteratorPrefix(BucketByBudgetDatasetOp::kDatasetType,
+                                 dataset_params.iterator_prefix())));
+}
+
+std::vector<IteratorSaveAndRestoreTestCase<BucketByBudgetDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {{/*dataset_params=*/BucketByBudgetDatasetParams2(),
+           /*breakpoints=*/{0, 1, 2, 5},
+           /*expected_outputs=*/
+           {CreateTensor<int64_t>(TensorShape{2, 3}, {7, 0, 0, 1, 2, 3}),
+            CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6}),
+            CreateTensor<int64_t>(TensorShape{2, 1}, {8, 9})}},
+          {/*dataset_params=*/BucketByBudgetDatasetParams4(),
+           /*breakpoints=*/{0, 1, 3, 5},
+           /*expected_outputs=*/
+           {CreateTensor<int64_t>(TensorShape{2, 1}, {7, 8}),
+            CreateTensor<int64_t>(TensorShape{1, 1}, {9}),
+            CreateTensor<int64_t>(TensorShape{1, 3}, {1, 2, 3}),
+            CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6})}},
+          {/*dataset_params=*/BucketByBudgetDatasetParams6(),
+           /*breakpoints=*/{0, 1, 3, 5},
+           /*expected_outputs=*/
+           {CreateTensor<int64_t>(TensorShape{2, 1}, {7, 8}),
+            CreateTensor<int64_t>(TensorShape{1, 1}, {9}),
+            CreateTensor<int64_t>(TensorShape{1, 3}, {1, 2, 3}),
+            CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6})},
+           /*compare_order=*/false}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(BucketByBudgetDatasetOpTest,
+                                 BucketByBudgetDatasetParams,
+                                 IteratorSaveAndRestoreTestCases())
+
+// Iterators of a dataset with the same seeds produce the batches in the same
+// order.
+TEST_F(BucketByBudgetDatasetOpTest, ShuffledOrderDependsOnSeeds) {
+  auto dataset_params = BucketByBudgetDatasetParams6();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::unique_ptr<IteratorBase> other_iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &other_iterator));
+  std::vector<Tensor> out_tensors;
+  std::vector<Tensor> other_out_tensors;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  end_of_sequence = false;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(other_iterator->GetNext(iterator_ctx_.get(),
+                                         &other_out_tensors, &end_of_sequence));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, other_out_tensors,
+                           /*compare_order=*/true));
+}
+
+// Produces the elements [1, 2, 3], [[9]], [7], [8]. The second element does
+// not match the rank of the padded shape.
+ConcatenateDatasetParams MixedRankDatasetParams() {
+  auto concatenate_0 = ConcatenateDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/CreateTensors<int64_t>(TensorShape{1, 3}, {{1, 2, 3}}),
+          /*node_name=*/"tensor_slice_0"),
+      TensorSliceDatasetParams(
+          /*components=*/CreateTensors<int64_t>(TensorShape{1, 1, 1}, {{9}}),
+          /*node_name=*/"tensor_slice_1"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape()},
+      /*node_name=*/"concatenate_0");
+  auto concatenate_1 = ConcatenateDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/CreateTensors<int64_t>(TensorShape{1, 1}, {{7}}),
+          /*node_name=*/"tensor_slice_2"),
+      TensorSliceDatasetParams(
+          /*components=*/CreateTensors<int64_t>(TensorShape{1, 1}, {{8}}),
+          /*node_name=*/"tensor_slice_3"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1})},
+      /*node_name=*/"concatenate_1");
+  return ConcatenateDatasetParams(std::move(concatenate_0),
+                                  std::move(concatenate_1),
+                                  /*output_dtypes=*/{DT_INT64},
+                                  /*output_shapes=*/{PartialTensorShape()},
+                                  /*node_name=*/"concatenate_2");
+}
+
+TEST_F(BucketByBudgetDatasetOpTest, InputErrorKeepsWindow) {
+  auto dataset_params = BucketByBudgetDatasetParams(
+      MixedRankDatasetParams(), /*window_size=*/5, /*budget=*/6,
+      /*padded_shapes=*/{CreateTensor<int64_t>(TensorShape{1}, {-1})},
+      /*padded_values=*/{CreateTensor<int64_t>(TensorShape{}, {0})},
+      /*length_component=*/0, /*budget_unit=*/"tokens",
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1, -1})}, kNodeName);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      absl::StatusCode::kInvalidArgument);
+  // The element read before the error is batched with the rest of the window.
+  TF_ASSERT_OK(CheckIteratorGetNext(
+      {CreateTensor<int64_t>(TensorShape{2, 1}, {7, 8}),
+       CreateTensor<int64_t>(TensorShape{1, 3}, {1, 2, 3})},
+      /*compare_order=*/true));
+}
+
+TEST_F(BucketByBudgetDatasetOpTest, PaddedShapeTooShort) {
+  auto dataset_params =
+      MakeDatasetParams(/*window_size=*/5, /*budget=*/8,
+                        /*budget_unit=*/"tokens", /*padded_length=*/2);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      absl::StatusCode::kDataLoss);
+}
+
+class ParameterizedInvalidArgumentTest
+    : public BucketByBudgetDatasetOpTest,
+      public ::testing::WithParamInterface<BucketByBudgetDatasetParams> {};
+
+TEST_P(ParameterizedInvalidArgumentTest, InvalidArgument) {
+  auto dataset_params = GetParam();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    BucketByBudgetDatasetOpTest, ParameterizedInvalidArgumentTest,
+    ::testing::ValuesIn(
+        {MakeDatasetParams(/*window_size=*/0, /*budget=*/6),
+         MakeDatasetParams(/*window_size=*/5, /*budget=*/0),
+         BucketByBudgetDatasetParams(
+             VariableLengthDatasetParams(), /*window_size=*/5, /*budget=*/6,
+             /*padded_shapes=*/{CreateTensor<int64_t>(TensorShape{1}, {-1})},
+             /*padded_values=*/{CreateTensor<int64_t>(TensorShape{}, {0})},
+             /*length_component=*/1, /*budget_unit=*/"tokens",
+             /*output_dtypes=*/{DT_INT64},
+             /*output_shapes=*/{PartialTensorShape({-1, -1})}, kNodeName),
+         BucketByBudgetDatasetParams(
+             VariableLengthDatasetParams(), /*window_size=*/5, /*budget=*/6,
+             /*padded_shapes=*/{CreateTensor<int64_t>(TensorShape{1}, {-1})},
+             /*padded_values=*/{CreateTensor<int32>(TensorShape{}, {0})},
+             /*length_component=*/0, /*budget_unit=*/"tokens",
+             /*output_dtypes=*/{DT_INT64},
+             /*output_shapes=*/{PartialTensorShape({-1, -1})}, kNodeName)}));
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
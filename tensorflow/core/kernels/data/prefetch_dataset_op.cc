@@ -17,11 +17,16 @@ limitations under the License.
 #include <algorithm>
 #include <deque>
 #include <limits>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/stats_utils.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
@@ -29,9 +34,11 @@ limitations under the License.
 #include "tensorflow/core/framework/stats_aggregator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/prefetch_autotuner.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
@@ -52,6 +59,7 @@ namespace data {
 /* static */ constexpr const char* const PrefetchDatasetOp::kSlackPeriod;
 /* static */ constexpr const char* const PrefetchDatasetOp::kLegacyAutotune;
 /* static */ constexpr const char* const PrefetchDatasetOp::kBufferSizeMin;
+/* static */ constexpr const char* const PrefetchDatasetOp::kBufferPoolSize;
 
 namespace {
 
@@ -63,18 +71,153 @@ constexpr char kSizeSuffix[] = ".size";
 constexpr char kCodeSuffix[] = ".code";
 constexpr char kErrorMessageSuffix[] = ".error_message";
 
+// An allocator that recycles a bounded number of buffers of the sizes of the
+// components of the prefetched elements. The prefetch thread reads its input
+// with an iterator context that hands out this allocator, so that input ops
+// which allocate their outputs through the context (e.g. batching) write each
+// element straight into a recycled buffer, and prefetching in steady state
+// does not allocate output memory. Other allocations are forwarded to the
+// wrapped allocator.
+//
+// The buffers are allocated as GPU-compatible host memory, so that they are
+// pinned when a GPU is present and can be copied to the device directly.
+//
+// Tensors allocated from it may outlive the iterator, so every allocation
+// holds a reference on the allocator.
+class RecyclingAllocator : public Allocator, public core::RefCounted {
+ public:
+  // Returns nullptr if no component of elements with the given types and
+  // shapes has a fixed size, or if the buffers can't be allocated.
+  static RecyclingAllocator* Create(
+      Allocator* allocator, const DataTypeVector& dtypes,
+      const std::vector<PartialTensorShape>& shapes, int64_t num_buffers) {
+    absl::flat_hash_map<size_t, size_t> capacity;
+    for (size_t i = 0; i < shapes.size(); ++i) {
+      TensorShape shape;
+      if (!DataTypeCanUseMemcpy(dtypes[i]) ||
+          !shapes[i].AsTensorShape(&shape)) {
+        VLOG(2) << "Not recycling prefetch buffers for component " << i
+                << " of type " << DataTypeString(dtypes[i]) << " and shape "
+                << shapes[i].DebugString();
+        continue;
+      }
+      const size_t bytes = shape.num_elements() * DataTypeSize(dtypes[i]);
+      if (bytes > 0) {
+        capacity[bytes] += num_buffers;
+      }
+    }
+    if (capacity.empty()) {
+      return nullptr;
+    }
+    core::RefCountPtr<RecyclingAllocator> recycling_allocator(
+        new RecyclingAllocator(allocator, std::move(capacity)));
+    mutex_lock l(recycling_allocator->mu_);
+    for (const auto& [bytes, num_free] : recycling_allocator->capacity_) {
+      std::vector<void*>& free = recycling_allocator->free_[bytes];
+      for (size_t j = 0; j < num_free; ++j) {
+        void* data = allocator->AllocateRaw(kAllocatorAlignment, bytes);
+        if (data == nullptr) {
+          LOG(WARNING) << "Failed to allocate " << bytes
+                       << " bytes for the prefetch buffer pool.";
+          return nullptr;
+        }
+        free.push_back(data);
+      }
+    }
+    return recycling_allocator.release();
+  }
+
+  std::string Name() override { return "prefetch_recycling_allocator"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    void* data = nullptr;
+    const bool recycle =
+        alignment <= kAllocatorAlignment && capacity_.contains(num_bytes);
+    if (recycle) {
+      mutex_lock l(mu_);
+      std::vector<void*>& free = free_[num_bytes];
+      if (!free.empty()) {
+        data = free.back();
+        free.pop_back();
+      }
+    }
+    if (data == nullptr) {
+      data = allocator_->AllocateRaw(std::max(alignment, kAllocatorAlignment),
+                                     num_bytes);
+      if (data == nullptr) {
+        return nullptr;
+      }
+    }
+    if (recycle) {
+      mutex_lock l(mu_);
+      recycled_bytes_[data] = num_bytes;
+    }
+    Ref();
+    return data;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    bool recycled = false;
+    {
+      mutex_lock l(mu_);
+      auto it = recycled_bytes_.find(ptr);
+      if (it != recycled_bytes_.end()) {
+        std::vector<void*>& free = free_[it->second];
+        if (free.size() < capacity_.at(it->second)) {
+          free.push_back(ptr);
+          recycled = true;
+        }
+        recycled_bytes_.erase(it);
+      }
+    }
+    if (!recycled) {
+      allocator_->DeallocateRaw(ptr);
+    }
+    Unref();
+  }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return allocator_->GetMemoryType();
+  }
+
+ private:
+  RecyclingAllocator(Allocator* allocator,
+                     absl::flat_hash_map<size_t, size_t> capacity)
+      : allocator_(allocator), capacity_(std::move(capacity)) {}
+
+  ~RecyclingAllocator() override {
+    mutex_lock l(mu_);
+    for (const auto& [bytes, free] : free_) {
+      for (void* data : free) {
+        allocator_->DeallocateRaw(data);
+      }
+    }
+  }
+
+  Allocator* const allocator_;
+  // The maximum number of free buffers kept for each recycled size in bytes.
+  const absl::flat_hash_map<size_t, size_t> capacity_;
+  mutex mu_;
+  // The free buffers of each recycled size.
+  absl::flat_hash_map<size_t, std::vector<void*>> free_ TF_GUARDED_BY(mu_);
+  // The size of each outstanding allocation of a recycled size.
+  absl::flat_hash_map<void*, size_t> recycled_bytes_ TF_GUARDED_BY(mu_);
+};
+
 }  // namespace
 
 class PrefetchDatasetOp::Dataset : public DatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
-          int64_t slack_period, bool legacy_autotune, int64_t buffer_size_min)
+          int64_t slack_period, bool legacy_autotune, int64_t buffer_size_min,
+          int64_t buffer_pool_size)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         slack_period_(slack_period),
         legacy_autotune_(legacy_autotune),
-        buffer_size_min_(buffer_size_min) {
+        buffer_size_min_(buffer_size_min),
+        buffer_pool_size_(buffer_pool_size) {
     input_->Ref();
   }
 
@@ -130,12 +273,15 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     b->BuildAttrValue(legacy_autotune_, &legacy_autotune_attr);
     AttrValue buffer_size_min_attr;
     b->BuildAttrValue(buffer_size_min_, &buffer_size_min_attr);
+    AttrValue buffer_pool_size_attr;
+    b->BuildAttrValue(buffer_pool_size_, &buffer_pool_size_attr);
 
     TF_RETURN_IF_ERROR(
         b->AddDataset(this, {input_graph_node, buffer_size},
                       {std::make_pair(kSlackPeriod, slack_period_attr),
                        std::make_pair(kLegacyAutotune, legacy_autotune_attr),
-                       std::make_pair(kBufferSizeMin, buffer_size_min_attr)},
+                       std::make_pair(kBufferSizeMin, buffer_size_min_attr),
+                       std::make_pair(kBufferPoolSize, buffer_pool_size_attr)},
                       output));
     return OkStatus();
   }
@@ -175,12 +321,20 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       if (buffer_size_->value == model::kAutotune) {
         buffer_size_->value = buffer_size_min_;
       }
+      if (dataset()->buffer_pool_size_ > 0) {
+        AllocatorAttributes attr;
+        attr.set_gpu_compatible(true);
+        buffer_pool_.reset(RecyclingAllocator::Create(
+            ctx->allocator(attr), dataset()->output_dtypes(),
+            dataset()->output_shapes(), dataset()->buffer_pool_size_));
+      }
       cancellation_manager_ = std::make_unique<CancellationManager>();
       TF_RETURN_IF_ERROR(RegisterCancellationCallback(
           ctx->cancellation_manager(), [this]() { CancelThreads(); },
           &deregister_fn_));
       IteratorContext::Params params(ctx);
       params.cancellation_manager = cancellation_manager_.get();
+      SetBufferPoolAllocator(&params);
       IteratorContext iter_ctx(params);
       TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
           &iter_ctx, this, prefix(), &input_impl_));
@@ -337,6 +491,12 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
             "slack",
             strings::Printf("%lld", static_cast<long long>(slack_us_.load()))));
       }
+      if (buffer_pool_) {
+        result.push_back(std::make_pair(
+            "buffer_pool_size",
+            strings::Printf("%lld", static_cast<long long>(
+                                        dataset()->buffer_pool_size_))));
+      }
       result.push_back(std::make_pair(
           "interleave_depth",
           strings::Printf("%lld", static_cast<long long>(interleave_depth_))));
@@ -487,14 +647,30 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     Status EnsureThreadsStarted(IteratorContext* ctx)
         TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       if (!prefetch_thread_) {
-        std::shared_ptr<IteratorContext> new_ctx =
-            std::make_shared<IteratorContext>(*ctx);
+        std::shared_ptr<IteratorContext> new_ctx;
+        if (buffer_pool_) {
+          IteratorContext::Params params(ctx);
+          SetBufferPoolAllocator(&params);
+          new_ctx = std::make_shared<IteratorContext>(std::move(params));
+        } else {
+          new_ctx = std::make_shared<IteratorContext>(*ctx);
+        }
         prefetch_thread_ = ctx->StartThread(
             "tf_data_prefetch", [this, new_ctx]() { PrefetchThread(new_ctx); });
       }
       return OkStatus();
     }
 
+    // If the buffer pool is set, makes the input allocate from it.
+    void SetBufferPoolAllocator(IteratorContext::Params* params) {
+      if (buffer_pool_) {
+        params->allocator_getter =
+            [buffer_pool = buffer_pool_.get()](AllocatorAttributes attrs) {
+              return buffer_pool;
+            };
+      }
+    }
+
     // Prefetches elements of the input, storing results in an internal buffer.
     //
     // It owns the iterator context passed to it.
@@ -553,7 +729,6 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           cond_var_->notify_all();
           return;
         }
-
         // 3. Signal that the element has been produced.
         {
           mutex_lock l(*mu_);
@@ -613,6 +788,11 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     // accessing the input iterator. We keep this separate from `mu_` to allow
     // prefetching to run in parallel with GetNext calls.
     mutex input_mu_ TF_ACQUIRED_BEFORE(*mu_);
+    // If set, the input allocates its outputs from this allocator, which
+    // recycles their buffers. Set in `Initialize`, and ordered before
+    // `input_impl_` and `prefetch_thread_` so that it outlives the iterator
+    // contexts that refer to it.
+    core::RefCountPtr<RecyclingAllocator> buffer_pool_;
     // Controls cancellation of `input_impl_`. Must be ordered before
     // `input_impl_` so that `input_impl_` is destroyed first.
     std::unique_ptr<CancellationManager> cancellation_manager_;
@@ -655,6 +835,10 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
   // parameter.
   const int64_t buffer_size_min_ = 0;
 
+  // If positive, the number of preallocated buffers to recycle for the
+  // prefetched elements.
+  const int64_t buffer_pool_size_ = 0;
+
   TraceMeMetadata traceme_metadata_;
 };
 
@@ -669,6 +853,9 @@ PrefetchDatasetOp::PrefetchDatasetOp(OpKernelConstruction* ctx)
   if (ctx->HasAttr(kBufferSizeMin)) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr(kBufferSizeMin, &buffer_size_min_));
   }
+  if (ctx->HasAttr(kBufferPoolSize)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kBufferPoolSize, &buffer_pool_size_));
+  }
   if (GetExperiments().contains("autotune_buffer_optimization")) {
     legacy_autotune_ = false;
     buffer_size_min_ = std::max(static_cast<int64_t>(1), buffer_size_min_);
@@ -690,7 +877,7 @@ void PrefetchDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   }
 
   *output = new Dataset(ctx, input, buffer_size, slack_period_,
-                        legacy_autotune_, buffer_size_min_);
+                        legacy_autotune_, buffer_size_min_, buffer_pool_size_);
 }
 
 namespace {
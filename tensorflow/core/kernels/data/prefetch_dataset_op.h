@@ -33,6 +33,7 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
   static constexpr const char* const kSlackPeriod = "slack_period";
   static constexpr const char* const kLegacyAutotune = "legacy_autotune";
   static constexpr const char* const kBufferSizeMin = "buffer_size_min";
+  static constexpr const char* const kBufferPoolSize = "buffer_pool_size";
 
   explicit PrefetchDatasetOp(OpKernelConstruction* ctx);
 
@@ -45,6 +46,7 @@ class PrefetchDatasetOp : public UnaryDatasetOpKernel {
   int64_t slack_period_ = 0;
   bool legacy_autotune_ = true;
   int64_t buffer_size_min_ = 0;
+  int64_t buffer_pool_size_ = 0;
 };
 
 }  // namespace data
@@ -12,6 +12,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/data/prefetch_dataset_op.h"
 
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/data/dataset_test_base.h"
 
 namespace tensorflow {
@@ -29,13 +30,15 @@ class PrefetchDatasetParams : public DatasetParams {
                         DataTypeVector output_dtypes,
                         std::vector<PartialTensorShape> output_shapes,
                         int64_t slack_period, bool legacy_autotune,
-                        int64_t buffer_size_min, string node_name)
+                        int64_t buffer_size_min, int64_t buffer_pool_size,
+                        string node_name)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
         buffer_size_(buffer_size),
         slack_period_(slack_period),
         legacy_autotune_(legacy_autotune),
-        buffer_size_min_(buffer_size_min) {
+        buffer_size_min_(buffer_size_min),
+        buffer_pool_size_(buffer_pool_size) {
     input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -60,6 +63,7 @@ class PrefetchDatasetParams : public DatasetParams {
     attr_vector->emplace_back("slack_period", slack_period_);
     attr_vector->emplace_back("legacy_autotune", legacy_autotune_);
     attr_vector->emplace_back("buffer_size_min", buffer_size_min_);
+    attr_vector->emplace_back("buffer_pool_size", buffer_pool_size_);
     attr_vector->emplace_back("metadata", "");
     return OkStatus();
   }
@@ -73,6 +77,7 @@ class PrefetchDatasetParams : public DatasetParams {
   int64_t slack_period_;
   bool legacy_autotune_;
   int64_t buffer_size_min_;
+  int64_t buffer_pool_size_;
 };
 
 // Test case 1: positive buffer size.
@@ -89,6 +94,7 @@ PrefetchDatasetParams PrefetchDatasetParams1() {
       /*slack_period=*/0,
       /*legacy_autotune=*/true,
       /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/0,
       /*node_name=*/kNodeName);
 }
 
@@ -106,6 +112,7 @@ PrefetchDatasetParams PrefetchDatasetParams2() {
       /*slack_period=*/0,
       /*legacy_autotune=*/true,
       /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/0,
       /*node_name=*/kNodeName);
 }
 
@@ -123,6 +130,7 @@ PrefetchDatasetParams PrefetchDatasetParams3() {
       /*slack_period=*/0,
       /*legacy_autotune=*/true,
       /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/0,
       /*node_name=*/kNodeName);
 }
 
@@ -140,6 +148,7 @@ PrefetchDatasetParams PrefetchDatasetParams4() {
       /*slack_period=*/5,
       /*legacy_autotune=*/true,
       /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/0,
       /*node_name=*/kNodeName);
 }
 
@@ -157,6 +166,7 @@ PrefetchDatasetParams PrefetchDatasetParams5() {
       /*slack_period=*/5,
       /*legacy_autotune=*/false,
       /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/0,
       /*node_name=*/kNodeName);
 }
 
@@ -174,6 +184,67 @@ PrefetchDatasetParams PrefetchDatasetParams6() {
       /*slack_period=*/0,
       /*legacy_autotune=*/true,
       /*buffer_size_min=*/3,
+      /*buffer_pool_size=*/0,
+      /*node_name=*/kNodeName);
+}
+
+// Test case 7: buffer_pool_size > 0.
+PrefetchDatasetParams PrefetchDatasetParams7() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{10, 1},
+                                            {0, 1, 2, 3, 4, 5, 6, 7, 8, 9})},
+      /*node_name=*/"tensor_slice");
+  return PrefetchDatasetParams(
+      /*input_dataset_params=*/tensor_slice_dataset_params,
+      /*buffer_size=*/1,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({1})},
+      /*slack_period=*/0,
+      /*legacy_autotune=*/true,
+      /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/2,
+      /*node_name=*/kNodeName);
+}
+
+// Test case 8: buffer_pool_size > 0 with a partially defined output shape, in
+// which case elements are not pooled.
+PrefetchDatasetParams PrefetchDatasetParams8() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{10, 1},
+                                            {0, 1, 2, 3, 4, 5, 6, 7, 8, 9})},
+      /*node_name=*/"tensor_slice");
+  return PrefetchDatasetParams(
+      /*input_dataset_params=*/tensor_slice_dataset_params,
+      /*buffer_size=*/1,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1})},
+      /*slack_period=*/0,
+      /*legacy_autotune=*/true,
+      /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/2,
+      /*node_name=*/kNodeName);
+}
+
+// Test case 9: buffer_pool_size > 0 with an input that allocates its outputs
+// through the iterator context, and so from the pool.
+PrefetchDatasetParams PrefetchDatasetParams9() {
+  auto batch_dataset_params = BatchDatasetParams(
+      RangeDatasetParams(0, 20, 1),
+      /*batch_size=*/2,
+      /*drop_remainder=*/true,
+      /*parallel_copy=*/false,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({2})},
+      /*node_name=*/"batch");
+  return PrefetchDatasetParams(
+      /*input_dataset_params=*/batch_dataset_params,
+      /*buffer_size=*/1,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({2})},
+      /*slack_period=*/0,
+      /*legacy_autotune=*/true,
+      /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/3,
       /*node_name=*/kNodeName);
 }
 
@@ -190,6 +261,7 @@ PrefetchDatasetParams InvalidBufferSizePrefetchDatasetParams() {
       /*slack_period=*/0,
       /*legacy_autotune=*/true,
       /*buffer_size_min=*/0,
+      /*buffer_pool_size=*/0,
       /*node_name=*/kNodeName);
 }
 
@@ -221,6 +293,16 @@ std::vector<GetNextTestCase<PrefetchDatasetParams>> GetNextTestCases() {
       {/*dataset_params=*/
        PrefetchDatasetParams6(),
        /*expected_outputs=*/
+       CreateTensors<int64_t>(
+           TensorShape{1}, {{0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}, {8}, {9}})},
+      {/*dataset_params=*/
+       PrefetchDatasetParams7(),
+       /*expected_outputs=*/
+       CreateTensors<int64_t>(
+           TensorShape{1}, {{0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}, {8}, {9}})},
+      {/*dataset_params=*/
+       PrefetchDatasetParams8(),
+       /*expected_outputs=*/
        CreateTensors<int64_t>(
            TensorShape{1},
            {{0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}, {8}, {9}})}};
@@ -318,6 +400,12 @@ IteratorSaveAndRestoreTestCases() {
        PrefetchDatasetParams5(),
        /*breakpoints=*/{0, 4, 11},
        /*expected_outputs=*/
+       CreateTensors<int64_t>(
+           TensorShape{1}, {{0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}, {8}, {9}})},
+      {/*dataset_params=*/
+       PrefetchDatasetParams7(),
+       /*breakpoints=*/{0, 4, 11},
+       /*expected_outputs=*/
        CreateTensors<int64_t>(
            TensorShape{1},
            {{0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}, {8}, {9}})}};
@@ -326,6 +414,31 @@ IteratorSaveAndRestoreTestCases() {
 ITERATOR_SAVE_AND_RESTORE_TEST_P(PrefetchDatasetOpTest, PrefetchDatasetParams,
                                  IteratorSaveAndRestoreTestCases())
 
+TEST_F(PrefetchDatasetOpTest, BufferPoolReusesBuffers) {
+  auto dataset_params = PrefetchDatasetParams9();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  absl::flat_hash_set<const void*> buffers;
+  bool end_of_sequence = false;
+  for (int64_t i = 0; i < 10; ++i) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    ASSERT_FALSE(end_of_sequence);
+    ASSERT_EQ(next.size(), 1);
+    TF_EXPECT_OK(ExpectEqual(
+        next[0], CreateTensor<int64_t>(TensorShape{2}, {2 * i, 2 * i + 1})));
+    buffers.insert(next[0].tensor_data().data());
+  }
+  std::vector<Tensor> next;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+  EXPECT_TRUE(end_of_sequence);
+  // The batch op writes each element into a pooled buffer. At most one
+  // element is buffered, one is being produced and one is held by the
+  // consumer, so every element fits in one of the three pooled buffers.
+  EXPECT_LE(buffers.size(), 3);
+}
+
 TEST_F(PrefetchDatasetOpTest, InvalidBufferSize) {
   auto dataset_params = InvalidBufferSizePrefetchDatasetParams();
   EXPECT_EQ(Initialize(dataset_params).code(), error::INVALID_ARGUMENT);
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/spilling_shuffle_buffer.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
@@ -38,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/stringprintf.h"
 
 namespace tensorflow {
@@ -56,6 +58,9 @@ namespace data {
     ShuffleDatasetOpBase::kReshuffleEachIteration;
 
 /* static */ constexpr const char* const ShuffleDatasetOp::kDatasetType;
+/* static */ constexpr const char* const ShuffleDatasetOp::kSpillDirectory;
+/* static */ constexpr const char* const
+    ShuffleDatasetOp::kInMemoryBufferSize;
 
 /* static */ constexpr const char* const
     ShuffleAndRepeatDatasetOp::kDatasetType;
@@ -90,12 +95,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   ShuffleDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
                      int64_t buffer_size,
                      std::shared_ptr<SeedGenerator> seed_generator,
-                     int64_t count)
+                     int64_t count, std::string spill_directory = "",
+                     int64_t in_memory_buffer_size = -1)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        spill_directory_(std::move(spill_directory)),
+        in_memory_buffer_size_(in_memory_buffer_size),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
@@ -160,6 +168,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
       const string& prefix) const override {
+    if (!spill_directory_.empty()) {
+      return std::make_unique<SpillingIterator>(
+          SpillingIterator::Params{
+              this, name_utils::IteratorPrefix(op_type(), prefix)},
+          seed_generator_.get());
+    }
     return std::make_unique<Iterator>(
         Iterator::Params{this, name_utils::IteratorPrefix(op_type(), prefix)},
         seed_generator_.get());
@@ -581,6 +595,146 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
   };
 
+  // Iterator for datasets with a `spill_directory_`. It shuffles a single epoch
+  // of the input through a `SpillingShuffleBuffer` that holds up to
+  // `buffer_size_` elements, of which at most `in_memory_buffer_size_` (and as
+  // many as the RAM budget allows) are kept in memory.
+  class SpillingIterator : public DatasetIterator<ShuffleDatasetBase> {
+   public:
+    explicit SpillingIterator(const Params& params,
+                              SeedGenerator* seed_generator)
+        : DatasetIterator<ShuffleDatasetBase>(params),
+          seed_generator_(seed_generator),
+          parent_generator_(seed_generator->seed(), seed_generator->seed2()),
+          generator_(&parent_generator_) {}
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      ResetRngs();
+      TF_RETURN_IF_ERROR(CreateBuffer(ctx));
+      return dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      while (input_impl_ && buffer_->size() < dataset()->buffer_size_) {
+        std::vector<Tensor> input_element;
+        bool end_of_input_sequence = false;
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, &input_element, &end_of_input_sequence));
+        if (end_of_input_sequence) {
+          input_impl_.reset();
+          break;
+        }
+        TF_RETURN_IF_ERROR(buffer_->Push(std::move(input_element), Random()));
+      }
+      if (buffer_->size() == 0) {
+        *end_of_sequence = true;
+        return OkStatus();
+      }
+      *end_of_sequence = false;
+      return buffer_->Pop(Random(), out_tensors);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kEpochNumRandomSamples,
+                              seed_generator_->num_random_samples()));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kNumRandomSamples,
+                                             num_random_samples_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kSeed, seed_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kSeed2, seed2_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          prefix(), kEndOfInputSequence, static_cast<int64_t>(!input_impl_)));
+      if (input_impl_) {
+        TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      }
+      return buffer_->Save(writer, absl::StrCat(prefix(), kColon, "buffer"));
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      int64_t num_random_samples;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kEpochNumRandomSamples,
+                                            &num_random_samples));
+      seed_generator_->set_num_random_samples(num_random_samples);
+      seed_generator_->Reset();
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kNumRandomSamples,
+                                            &num_random_samples_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kSeed, &seed_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kSeed2, &seed2_));
+      ResetRngs();
+
+      int64_t input_empty;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kEndOfInputSequence, &input_empty));
+      if (static_cast<bool>(!input_empty)) {
+        TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+            ctx, this, prefix(), &input_impl_));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+      } else {
+        input_impl_.reset();
+      }
+      TF_RETURN_IF_ERROR(CreateBuffer(ctx));
+      return buffer_->Restore(ctx, reader,
+                              absl::StrCat(prefix(), kColon, "buffer"));
+    }
+
+    TraceMeMetadata GetTraceMeMetadata() const override {
+      return dataset()->traceme_metadata_;
+    }
+
+   private:
+    Status CreateBuffer(IteratorContext* ctx) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      SpillingShuffleBuffer::Options options;
+      options.spill_directory = dataset()->spill_directory_;
+      options.max_in_memory_elements = dataset()->in_memory_buffer_size_;
+      options.ram_budget_manager = ctx->ram_budget_manager();
+      // Release the previous buffer's memory before the new buffer asks for it.
+      buffer_.reset();
+      TF_ASSIGN_OR_RETURN(buffer_,
+                          SpillingShuffleBuffer::Create(ctx->env(), options));
+      return OkStatus();
+    }
+
+    void ResetRngs() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      parent_generator_ = random::PhiloxRandom(seed_, seed2_);
+      generator_ =
+          random::SingleSampleAdapter<random::PhiloxRandom>(&parent_generator_);
+      generator_.Skip(num_random_samples_);
+    }
+
+    random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      num_random_samples_++;
+      return generator_();
+    }
+
+    mutex mu_;
+    SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
+    std::unique_ptr<SpillingShuffleBuffer> buffer_ TF_GUARDED_BY(mu_);
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    int64_t seed_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed2_ TF_GUARDED_BY(mu_) = 0;
+    random::PhiloxRandom parent_generator_ TF_GUARDED_BY(mu_);
+    random::SingleSampleAdapter<random::PhiloxRandom> generator_
+        TF_GUARDED_BY(mu_);
+    int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
+  };
+
   const DatasetBase* const input_;
   const int64_t buffer_size_;
   const std::shared_ptr<SeedGenerator> seed_generator_;
@@ -588,6 +742,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  // If non-empty, the buffer spills the elements that do not fit in memory to
+  // this directory. Only used with `count_` == 1.
+  const std::string spill_directory_;
+  // The maximum number of buffered elements kept in memory when spilling, or
+  // -1 if only the RAM budget limits it.
+  const int64_t in_memory_buffer_size_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
@@ -601,8 +761,10 @@ class ShuffleDatasetOp::Dataset : public ShuffleDatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
           int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-          ResourceHandle&& resource_handle)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+          ResourceHandle&& resource_handle, std::string spill_directory,
+          int64_t in_memory_buffer_size)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           std::move(spill_directory), in_memory_buffer_size),
         manager_(manager),
         resource_handle_(std::move(resource_handle)),
         resource_mgr_(ctx->resource_manager()),
@@ -635,11 +797,16 @@ class ShuffleDatasetOp::Dataset : public ShuffleDatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(seeds_.input_seed2(), &seed2_node));
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
+    AttrValue spill_directory;
+    b->BuildAttrValue(spill_directory_, &spill_directory);
+    AttrValue in_memory_buffer_size;
+    b->BuildAttrValue(in_memory_buffer_size_, &in_memory_buffer_size);
     TF_RETURN_IF_ERROR(b->AddDataset(
         this,
         {input_graph_node, buffer_size_node, seed_node, seed2_node},  // Inputs
-        {std::make_pair(kReshuffleEachIteration,
-                        reshuffle_each_iteration)},  // Attrs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kSpillDirectory, spill_directory),
+         std::make_pair(kInMemoryBufferSize, in_memory_buffer_size)},  // Attrs
         output));
     return OkStatus();
   }
@@ -713,8 +880,10 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
  public:
   DatasetV3(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
             int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            ResourceHandle&& resource_handle, bool owns_resource,
+            std::string spill_directory, int64_t in_memory_buffer_size)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           std::move(spill_directory), in_memory_buffer_size),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -753,13 +922,18 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
-    TF_RETURN_IF_ERROR(
-        b->AddDataset(this,
-                      {input_graph_node, buffer_size_node, seed_node,
-                       seed2_node, resource_handle_node},  // Inputs
-                      {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
-                      output));
+    AttrValue spill_directory;
+    b->BuildAttrValue(spill_directory_, &spill_directory);
+    AttrValue in_memory_buffer_size;
+    b->BuildAttrValue(in_memory_buffer_size_, &in_memory_buffer_size);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {input_graph_node, buffer_size_node, seed_node, seed2_node,
+         resource_handle_node},  // Inputs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kSpillDirectory, spill_directory),
+         std::make_pair(kInMemoryBufferSize, in_memory_buffer_size)},  // Attrs
+        output));
     return OkStatus();
   }
 
@@ -785,6 +959,13 @@ ShuffleDatasetOp::ShuffleDatasetOp(OpKernelConstruction* ctx)
     OP_REQUIRES_OK(
         ctx, ctx->GetAttr(kReshuffleEachIteration, &reshuffle_each_iteration_));
   }
+  if (ctx->HasAttr(kSpillDirectory)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kSpillDirectory, &spill_directory_));
+  }
+  if (ctx->HasAttr(kInMemoryBufferSize)) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr(kInMemoryBufferSize, &in_memory_buffer_size_));
+  }
 }
 
 void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
@@ -796,6 +977,10 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
       ctx, buffer_size > 0 || buffer_size == kUnknownCardinality,
       errors::InvalidArgument(
           "buffer_size must be greater than zero or UNKNOWN_CARDINALITY"));
+  OP_REQUIRES(ctx, spill_directory_.empty() || buffer_size > 0,
+              errors::InvalidArgument(
+                  "Spilling the shuffle buffer to `", kSpillDirectory,
+                  "` requires a buffer_size greater than zero."));
 
   int64_t count = 1;
   static std::atomic<int64_t> resource_id_counter(0);
@@ -836,9 +1021,10 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     }
 
     // Ownership of manager is transferred onto `DatasetV3`.
-    *output = new ShuffleDatasetOp::DatasetV3(ctx, input, buffer_size, count,
-                                              std::move(seeds), manager,
-                                              std::move(handle), owns_resource);
+    *output = new ShuffleDatasetOp::DatasetV3(
+        ctx, input, buffer_size, count, std::move(seeds), manager,
+        std::move(handle), owns_resource, spill_directory_,
+        in_memory_buffer_size_);
   } else if (op_version_ == 2) {
     auto handle = HandleFromInput(ctx, 2);
     SeedGeneratorManager* manager = nullptr;
@@ -898,9 +1084,9 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
         MakeResourceHandle<SeedGeneratorManager>(ctx, container, name);
 
     // Ownership of manager is transferred onto `Dataset`.
-    *output = new ShuffleDatasetOp::Dataset(ctx, input, buffer_size, count,
-                                            std::move(seeds), manager,
-                                            std::move(handle));
+    *output = new ShuffleDatasetOp::Dataset(
+        ctx, input, buffer_size, count, std::move(seeds), manager,
+        std::move(handle), spill_directory_, in_memory_buffer_size_);
   }
 }
 
@@ -15,6 +15,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_SHUFFLE_DATASET_OP_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_SHUFFLE_DATASET_OP_H_
 
+#include <cstdint>
+#include <string>
+
 #include "tensorflow/core/framework/dataset.h"
 
 namespace tensorflow {
@@ -40,6 +43,9 @@ class ShuffleDatasetOpBase : public UnaryDatasetOpKernel {
 class ShuffleDatasetOp : public ShuffleDatasetOpBase {
  public:
   static constexpr const char* const kDatasetType = "Shuffle";
+  static constexpr const char* const kSpillDirectory = "spill_directory";
+  static constexpr const char* const kInMemoryBufferSize =
+      "in_memory_buffer_size";
 
   explicit ShuffleDatasetOp(OpKernelConstruction* ctx);
 
@@ -53,6 +59,8 @@ class ShuffleDatasetOp : public ShuffleDatasetOpBase {
   class DatasetV3;
   int op_version_ = 0;
   bool reshuffle_each_iteration_ = true;
+  std::string spill_directory_;
+  int64_t in_memory_buffer_size_ = -1;
 };
 
 class ShuffleAndRepeatDatasetOp : public ShuffleDatasetOpBase {
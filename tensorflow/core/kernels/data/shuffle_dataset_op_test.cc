@@ -33,14 +33,17 @@ class ShuffleDatasetParams : public DatasetParams {
                        bool reshuffle_each_iteration,
                        DataTypeVector output_dtypes,
                        std::vector<PartialTensorShape> output_shapes,
-                       string node_name)
+                       string node_name, string spill_directory = "",
+                       int64_t in_memory_buffer_size = -1)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
         buffer_size_(buffer_size),
         seed_(seed),
         seed2_(seed2),
         count_(count),
-        reshuffle_each_iteration_(reshuffle_each_iteration) {
+        reshuffle_each_iteration_(reshuffle_each_iteration),
+        spill_directory_(std::move(spill_directory)),
+        in_memory_buffer_size_(in_memory_buffer_size) {
     input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -78,6 +81,12 @@ class ShuffleDatasetParams : public DatasetParams {
     attr_vector->emplace_back("reshuffle_each_iteration",
                               reshuffle_each_iteration_);
     attr_vector->emplace_back("metadata", "");
+    if (count_ == 1) {
+      attr_vector->emplace_back(ShuffleDatasetOp::kSpillDirectory,
+                                spill_directory_);
+      attr_vector->emplace_back(ShuffleDatasetOp::kInMemoryBufferSize,
+                                in_memory_buffer_size_);
+    }
     return OkStatus();
   }
 
@@ -96,6 +105,8 @@ class ShuffleDatasetParams : public DatasetParams {
   int64_t seed2_;
   int64_t count_;
   bool reshuffle_each_iteration_;
+  string spill_directory_;
+  int64_t in_memory_buffer_size_;
 };
 
 class ShuffleDatasetOpTest : public DatasetOpsTestBase {};
@@ -221,6 +232,22 @@ ShuffleDatasetParams ShuffleDatasetParamsWithUnknownCardinality() {
                               /*node_name=*/kShuffleNodeName);
 }
 
+// Test case 9: test shuffle_dataset with a buffer that keeps 5 of its 30
+// elements in memory and spills the others.
+ShuffleDatasetParams ShuffleDatasetParamsWithSpilling() {
+  return ShuffleDatasetParams(RangeDatasetParams(0, 100, 1),
+                              /*buffer_size=*/30,
+                              /*seed=*/1,
+                              /*seed2=*/2,
+                              /*count=*/1,
+                              /*reshuffle_each_iteration=*/false,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/kShuffleNodeName,
+                              /*spill_directory=*/testing::TmpDir(),
+                              /*in_memory_buffer_size=*/5);
+}
+
 ShuffleDatasetParams ShuffleDatasetParamsWithInvalidBufferSize() {
   return ShuffleDatasetParams(RangeDatasetParams(0, 0, 1),
                               /*buffer_size=*/-1,
@@ -233,6 +260,19 @@ ShuffleDatasetParams ShuffleDatasetParamsWithInvalidBufferSize() {
                               /*node_name=*/kShuffleNodeName);
 }
 
+ShuffleDatasetParams ShuffleDatasetParamsWithSpillingAndUnknownBufferSize() {
+  return ShuffleDatasetParams(RangeDatasetParams(0, 10, 1),
+                              /*buffer_size=*/-2,
+                              /*seed=*/1,
+                              /*seed2=*/2,
+                              /*count=*/1,
+                              /*reshuffle_each_iteration=*/false,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/kShuffleNodeName,
+                              /*spill_directory=*/testing::TmpDir());
+}
+
 ShuffleDatasetParams ShuffleAndRepeatDatasetParamsWithInvalidBufferSize() {
   return ShuffleDatasetParams(RangeDatasetParams(0, 0, 1),
                               /*buffer_size=*/-1,
@@ -586,6 +626,7 @@ INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
 TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   std::vector<ShuffleDatasetParams> dataset_params_vec(
       {ShuffleDatasetParamsWithInvalidBufferSize(),
+       ShuffleDatasetParamsWithSpillingAndUnknownBufferSize(),
        ShuffleAndRepeatDatasetParamsWithInvalidBufferSize(),
        ShuffleAndRepeatDatasetParamsWithInvalidCount()});
   for (const auto& dataset_params : dataset_params_vec) {
@@ -594,6 +635,69 @@ TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   }
 }
 
+TEST_F(ShuffleDatasetOpTest, SpillingGetNext) {
+  auto dataset_params = ShuffleDatasetParamsWithSpilling();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> out_tensors;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+
+  std::vector<Tensor> range;
+  for (int64_t i = 0; i < 100; ++i) {
+    range.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, range, /*compare_order=*/false));
+  EXPECT_FALSE(ExpectEqual(out_tensors, range, /*compare_order=*/true).ok());
+}
+
+TEST_F(ShuffleDatasetOpTest, SpillingIteratorSaveAndRestore) {
+  auto dataset_params = ShuffleDatasetParamsWithSpilling();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> expected_outputs;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    expected_outputs.insert(expected_outputs.end(), next.begin(), next.end());
+  }
+
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  int cur_iteration = 0;
+  for (int breakpoint : {0, 10, 45, 101}) {
+    VariantTensorDataWriter writer;
+    TF_EXPECT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+    std::vector<const VariantTensorData*> data;
+    writer.GetData(&data);
+    VariantTensorDataReader reader(data);
+    TF_EXPECT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                                 dataset_params.iterator_prefix(), *dataset_,
+                                 &iterator_));
+
+    while (cur_iteration <= breakpoint) {
+      std::vector<Tensor> next;
+      TF_EXPECT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+      cur_iteration++;
+    }
+  }
+  EXPECT_TRUE(end_of_sequence);
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -14,7 +14,13 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+
 #include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/read_ahead_file.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -25,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace data {
@@ -37,6 +44,7 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
 /* static */ constexpr const char* const TFRecordDatasetOp::kByteOffsets;
+/* static */ constexpr const char* const TFRecordDatasetOp::kReadAheadBlocks;
 
 constexpr char kTFRecordDataset[] = "TFRecordDataset";
 constexpr char kCurrentFileIndex[] = "current_file_index";
@@ -45,6 +53,8 @@ constexpr char kGcsFsPrefix[] = "gs://";
 constexpr char kS3FsPrefix[] = "s3://";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
+// Size of the blocks that are read ahead when `buffer_size` is 0.
+constexpr int64_t kDefaultReadAheadBlockSize = 256 << 10;  // 256KB.
 
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
@@ -58,13 +68,15 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
                    const string& compression_type, int64_t buffer_size,
-                   std::vector<int64_t> byte_offsets, int op_version)
+                   std::vector<int64_t> byte_offsets, int64_t read_ahead_blocks,
+                   int op_version)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
             compression_type)),
         byte_offsets_(std::move(byte_offsets)),
+        read_ahead_blocks_(read_ahead_blocks),
         op_version_(op_version) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
@@ -112,8 +124,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
+    AttrValue read_ahead_blocks;
+    b->BuildAttrValue(read_ahead_blocks_, &read_ahead_blocks);
+    TF_RETURN_IF_ERROR(
+        b->AddDataset(this, {filenames, compression_type, buffer_size},
+                      {{kReadAheadBlocks, read_ahead_blocks}}, output));
     Node* byte_offsets = nullptr;
     TF_RETURN_IF_ERROR(b->AddVector(byte_offsets_, &byte_offsets));
     return OkStatus();
@@ -125,29 +140,46 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     explicit Iterator(const Params& params)
         : DatasetIterator<Dataset>(params) {}
 
+    ~Iterator() override {
+      CancelThreads();
+      StopReaderThread();
+      if (deregister_fn_) deregister_fn_();
+    }
+
     bool SymbolicCheckpointCompatible() const override { return true; }
 
+    Status Initialize(IteratorContext* ctx) override {
+      if (dataset()->read_ahead_blocks_ == 0) {
+        return OkStatus();
+      }
+      io_thread_pool_ = ctx->CreateThreadPool("tf_data_tf_record_read_ahead",
+                                              dataset()->read_ahead_blocks_);
+      return RegisterCancellationCallback(
+          ctx->cancellation_manager(), [this]() { CancelThreads(); },
+          &deregister_fn_);
+    }
+
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
       out_tensors->reserve(1);
       mutex_lock l(mu_);
+      if (dataset()->read_ahead_blocks_ > 0) {
+        return GetNextFromBufferLocked(ctx, l, out_tensors, end_of_sequence);
+      }
       do {
         // We are currently processing a file, so try to read the next record.
         if (reader_) {
-          out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
-                                    TensorShape({}));
-          Status s =
-              reader_->ReadRecord(&out_tensors->back().scalar<tstring>()());
+          io::RecordView record;
+          Status s = reader_->ReadRecord(&record);
           if (s.ok()) {
             static monitoring::CounterCell* bytes_counter =
                 metrics::GetTFDataBytesReadCounter(kDatasetType);
-            bytes_counter->IncrementBy(
-                out_tensors->back().scalar<tstring>()().size());
+            bytes_counter->IncrementBy(record.data.size());
+            out_tensors->push_back(RecordTensor(ctx, std::move(record)));
             *end_of_sequence = false;
             return OkStatus();
           }
-          out_tensors->pop_back();
           if (!errors::IsOutOfRange(s)) {
             // In case of other errors e.g., DataLoss, we still move forward
             // the file index so that it works with ignore_errors.
@@ -175,6 +207,12 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
     Status SkipInternal(IteratorContext* ctx, int num_to_skip,
                         bool* end_of_sequence, int* num_skipped) override {
+      if (dataset()->read_ahead_blocks_ > 0) {
+        // The records are parsed in the background anyway, so skipping them
+        // saves nothing over returning them.
+        return DatasetIterator<Dataset>::SkipInternal(
+            ctx, num_to_skip, end_of_sequence, num_skipped);
+      }
       *num_skipped = 0;
       mutex_lock l(mu_);
       do {
@@ -226,6 +264,14 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kCurrentFileIndex,
                                              current_file_index_));
 
+      if (dataset()->read_ahead_blocks_ > 0) {
+        // The records that are buffered are read again after restoring.
+        if (current_offset_ >= 0) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(prefix(), kOffset, current_offset_));
+        }
+        return OkStatus();
+      }
       if (reader_) {
         TF_RETURN_IF_ERROR(
             writer->WriteScalar(prefix(), kOffset, reader_->TellOffset()));
@@ -235,15 +281,22 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
+      StopReaderThread();
       mutex_lock l(mu_);
       ResetStreamsLocked();
       int64_t current_file_index;
       TF_RETURN_IF_ERROR(
           reader->ReadScalar(prefix(), kCurrentFileIndex, &current_file_index));
       current_file_index_ = size_t(current_file_index);
+      current_offset_ = -1;
       if (reader->Contains(prefix(), kOffset)) {
         int64_t offset;
         TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kOffset, &offset));
+        if (dataset()->read_ahead_blocks_ > 0) {
+          // The background thread seeks to the offset when it starts.
+          current_offset_ = offset;
+          return OkStatus();
+        }
         TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
         TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
       }
@@ -278,6 +331,227 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       file_.reset();
     }
 
+    // Returns a scalar string tensor that holds `record`. Records that the
+    // reader read into a buffer of their own are moved into the tensor rather
+    // than copied.
+    static Tensor RecordTensor(IteratorContext* ctx, io::RecordView record) {
+      Tensor tensor(ctx->allocator({}), DT_STRING, TensorShape({}));
+      tstring& value = tensor.scalar<tstring>()();
+      tstring* contents = record.buffer->mutable_contents();
+      if (record.buffer->RefCountIsOne() &&
+          record.data.data() == contents->data() &&
+          record.data.size() == contents->size()) {
+        value = std::move(*contents);
+      } else {
+        value.assign(record.data.data(), record.data.size());
+      }
+      return tensor;
+    }
+
+    // A record read by the background thread, or the error that it hit.
+    struct BufferedRecord {
+      Status status;
+      io::RecordView value;
+      // Position of the iterator once the record is returned. The offset is
+      // -1 at the start of a file.
+      size_t file_index = 0;
+      int64_t offset = -1;
+    };
+
+    // Returns the memory that `record` takes up in `buffer_`.
+    static int64_t BufferedBytes(const BufferedRecord& record) {
+      return sizeof(BufferedRecord) + record.value.data.size();
+    }
+
+    // Returns the next record from `buffer_`, after starting the background
+    // thread if needed.
+    Status GetNextFromBufferLocked(IteratorContext* ctx, mutex_lock& l,
+                                   std::vector<Tensor>* out_tensors,
+                                   bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      // Iteration ends when there are no more files to process.
+      if (current_file_index_ == dataset()->filenames_.size()) {
+        *end_of_sequence = true;
+        return OkStatus();
+      }
+      // The background thread buffers an error or the end of the sequence as
+      // its last record. Once that record is taken, e.g. after an error that
+      // the caller retries, a new thread reads on from the current position.
+      while (true) {
+        EnsureReaderThreadStartedLocked(ctx);
+        while (!cancelled_ && buffer_.empty() && !reader_finished_) {
+          cond_var_.wait(l);
+        }
+        if (cancelled_) {
+          return errors::Cancelled("Iterator was cancelled");
+        }
+        if (!buffer_.empty()) break;
+      }
+      BufferedRecord record = std::move(buffer_.front());
+      buffer_.pop_front();
+      buffered_bytes_ -= BufferedBytes(record);
+      cond_var_.notify_all();
+
+      current_file_index_ = record.file_index;
+      current_offset_ = record.offset;
+      if (!record.status.ok()) {
+        return record.status;
+      }
+      if (current_file_index_ == dataset()->filenames_.size()) {
+        *end_of_sequence = true;
+        return OkStatus();
+      }
+      static monitoring::CounterCell* bytes_counter =
+          metrics::GetTFDataBytesReadCounter(kDatasetType);
+      bytes_counter->IncrementBy(record.value.data.size());
+      out_tensors->push_back(RecordTensor(ctx, std::move(record.value)));
+      *end_of_sequence = false;
+      return OkStatus();
+    }
+
+    // Starts a background thread that reads the records that follow the
+    // last record returned, unless the current one may still produce them.
+    void EnsureReaderThreadStartedLocked(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (reader_thread_ && !(reader_finished_ && buffer_.empty())) {
+        return;
+      }
+      // Joins the finished thread, if any.
+      reader_thread_.reset();
+      reader_finished_ = false;
+      auto new_ctx = std::make_shared<IteratorContext>(*ctx);
+      reader_thread_ = ctx->StartThread(
+          "tf_data_tf_record_reader",
+          [this, new_ctx, file_index = current_file_index_,
+           offset = current_offset_]() {
+            // Marks the reader as finished with its last record, unless it
+            // is stopped first. Finished threads are joined with `mu_` held,
+            // so they must not take it afterwards.
+            ReadRecords(new_ctx.get(), file_index, offset);
+          });
+    }
+
+    // Stops the background thread, and drops the records that it buffered.
+    void StopReaderThread() TF_LOCKS_EXCLUDED(mu_) {
+      std::unique_ptr<Thread> reader_thread;
+      {
+        mutex_lock l(mu_);
+        stop_reader_ = true;
+        cond_var_.notify_all();
+        reader_thread = std::move(reader_thread_);
+      }
+      // Joins the thread.
+      reader_thread.reset();
+      mutex_lock l(mu_);
+      stop_reader_ = false;
+      reader_finished_ = false;
+      buffer_.clear();
+      buffered_bytes_ = 0;
+    }
+
+    void CancelThreads() TF_LOCKS_EXCLUDED(mu_) {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      cond_var_.notify_all();
+    }
+
+    // Reads the records of the files from `file_index` on into `buffer_`,
+    // starting at `offset` in the first file, or at its byte offset if
+    // `offset` is -1.
+    void ReadRecords(IteratorContext* ctx, size_t file_index, int64_t offset)
+        TF_LOCKS_EXCLUDED(mu_) {
+      const size_t num_files = dataset()->filenames_.size();
+      for (; file_index < num_files; ++file_index, offset = -1) {
+        // `reader` borrows `file`, so it is declared, and destroyed, last.
+        std::unique_ptr<RandomAccessFile> file;
+        std::unique_ptr<io::SequentialRecordReader> reader;
+        Status s = OpenReadAheadFile(ctx, file_index, &file, &reader);
+        if (!s.ok()) {
+          // As when reading synchronously, the same file is opened again by
+          // the next call.
+          PushRecord({s, {}, file_index, -1}, /*last=*/true);
+          return;
+        }
+        if (offset >= 0) {
+          s = reader->SeekOffset(offset);
+        } else if (!dataset()->byte_offsets_.empty()) {
+          s = reader->SeekOffset(dataset()->byte_offsets_[file_index]);
+        }
+        while (s.ok()) {
+          BufferedRecord record;
+          s = reader->ReadRecord(&record.value);
+          if (!s.ok()) break;
+          record.file_index = file_index;
+          record.offset = reader->TellOffset();
+          if (!PushRecord(std::move(record))) return;
+        }
+        if (!errors::IsOutOfRange(s)) {
+          // In case of other errors e.g., DataLoss, we still move forward
+          // the file index so that it works with ignore_errors.
+          if (!PushRecord({s, {}, file_index + 1, -1})) return;
+        }
+      }
+      PushRecord({OkStatus(), {}, num_files, -1}, /*last=*/true);
+    }
+
+    // Opens the file at `file_index` to read it with `read_ahead_blocks`
+    // reads in flight.
+    Status OpenReadAheadFile(
+        IteratorContext* ctx, size_t file_index,
+        std::unique_ptr<RandomAccessFile>* file,
+        std::unique_ptr<io::SequentialRecordReader>* reader)
+        TF_LOCKS_EXCLUDED(mu_) {
+      std::unique_ptr<RandomAccessFile> base_file;
+      TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
+          TranslateFileName(dataset()->filenames_[file_index]), &base_file));
+      const int64_t block_size = dataset()->options_.buffer_size > 0
+                                     ? dataset()->options_.buffer_size
+                                     : kDefaultReadAheadBlockSize;
+      ReadAheadFile::ReadCallback read_callback;
+      if (std::shared_ptr<model::Node> node = model_node()) {
+        read_callback = [node](int64_t num_bytes, int64_t busy_nanos) {
+          node->record_bytes_read(num_bytes, busy_nanos);
+        };
+      }
+      *file = std::make_unique<ReadAheadFile>(
+          std::move(base_file), block_size, dataset()->read_ahead_blocks_,
+          [this](std::function<void()> fn) {
+            io_thread_pool_->Schedule(std::move(fn));
+          },
+          std::move(read_callback));
+      *reader = std::make_unique<io::SequentialRecordReader>(
+          file->get(), dataset()->options_);
+      return OkStatus();
+    }
+
+    // Appends `record` to `buffer_` once there is room for it. If `last` is
+    // true, also marks the reader as finished, so that the consumer never sees
+    // the record taken while the reader still looks like it is running.
+    // Returns false if the iterator is cancelled or restored first.
+    bool PushRecord(BufferedRecord record, bool last = false)
+        TF_LOCKS_EXCLUDED(mu_) {
+      const int64_t max_buffered_bytes =
+          (dataset()->options_.buffer_size > 0
+               ? dataset()->options_.buffer_size
+               : kDefaultReadAheadBlockSize) *
+          dataset()->read_ahead_blocks_;
+      mutex_lock l(mu_);
+      while (!cancelled_ && !stop_reader_ &&
+             buffered_bytes_ >= max_buffered_bytes) {
+        cond_var_.wait(l);
+      }
+      if (cancelled_ || stop_reader_) {
+        return false;
+      }
+      buffered_bytes_ += BufferedBytes(record);
+      buffer_.push_back(std::move(record));
+      if (last) {
+        reader_finished_ = true;
+      }
+      cond_var_.notify_all();
+      return true;
+    }
+
     mutex mu_;
     size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
 
@@ -285,18 +559,38 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     // we must destroy `reader_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ TF_GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
+
+    // The following are only used when `read_ahead_blocks` is positive, in
+    // which case a background thread reads the records into `buffer_`.
+    //
+    // Offset in the current file of the next record to return, or -1 at the
+    // start of the file.
+    int64_t current_offset_ TF_GUARDED_BY(mu_) = -1;
+    condition_variable cond_var_;
+    std::deque<BufferedRecord> buffer_ TF_GUARDED_BY(mu_);
+    int64_t buffered_bytes_ TF_GUARDED_BY(mu_) = 0;
+    bool reader_finished_ TF_GUARDED_BY(mu_) = false;
+    bool stop_reader_ TF_GUARDED_BY(mu_) = false;
+    bool cancelled_ TF_GUARDED_BY(mu_) = false;
+    std::function<void()> deregister_fn_;
+    // Runs the reads of the blocks that are read ahead.
+    std::unique_ptr<thread::ThreadPool> io_thread_pool_;
+    std::unique_ptr<Thread> reader_thread_ TF_GUARDED_BY(mu_);
   };
 
   const std::vector<string> filenames_;
   const tstring compression_type_;
   io::RecordReaderOptions options_;
   const std::vector<int64_t> byte_offsets_;
+  const int64_t read_ahead_blocks_;
   const int op_version_;
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
     : DatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kTFRecordDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kTFRecordDataset ? 1 : 2) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kReadAheadBlocks, &read_ahead_blocks_));
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -361,7 +655,8 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
   }
 
   *output = new Dataset(ctx, std::move(filenames), compression_type,
-                        buffer_size, std::move(byte_offsets), op_version_);
+                        buffer_size, std::move(byte_offsets),
+                        read_ahead_blocks_, op_version_);
 }
 
 namespace {
@@ -15,6 +15,7 @@ limitations under the License.
 #include <string>
 
 #include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
@@ -46,13 +47,15 @@ class TFRecordDatasetParams : public DatasetParams {
  public:
   TFRecordDatasetParams(std::vector<tstring> filenames,
                         CompressionType compression_type, int64_t buffer_size,
-                        std::vector<int64_t> byte_offsets, string node_name)
+                        std::vector<int64_t> byte_offsets, string node_name,
+                        int64_t read_ahead_blocks = 0)
       : DatasetParams({DT_STRING}, {PartialTensorShape({})},
                       std::move(node_name)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         buffer_size_(buffer_size),
-        byte_offsets_(std::move(byte_offsets)) {
+        byte_offsets_(std::move(byte_offsets)),
+        read_ahead_blocks_(read_ahead_blocks) {
     op_version_ = 2;
   }
 
@@ -80,6 +83,8 @@ class TFRecordDatasetParams : public DatasetParams {
   Status GetAttributes(AttributeVector* attr_vector) const override {
     attr_vector->clear();
     attr_vector->emplace_back("metadata", "");
+    attr_vector->emplace_back(TFRecordDatasetOp::kReadAheadBlocks,
+                              read_ahead_blocks_);
     return OkStatus();
   }
 
@@ -92,6 +97,7 @@ class TFRecordDatasetParams : public DatasetParams {
   CompressionType compression_type_;
   int64_t buffer_size_;
   std::vector<int64_t> byte_offsets_;
+  int64_t read_ahead_blocks_;
 };
 
 class TFRecordDatasetOpTest : public DatasetOpsTestBase {};
@@ -208,6 +214,49 @@ TFRecordDatasetParams InvalidByteOffsets() {
                                /*node_name=*/kNodeName);
 }
 
+// Test case 6: multiple files with ZLIB compression, read ahead in blocks
+// that are smaller than the records.
+TFRecordDatasetParams ReadAheadDatasetParams1() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_ZLIB_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_ZLIB_2")};
+  std::vector<std::vector<string>> contents = {{"1", "22", "333"},
+                                               {"a", "bb", "ccc"}};
+  CompressionType compression_type = CompressionType::ZLIB;
+  absl::Status status = CreateTestFiles(filenames, contents, compression_type);
+  TF_CHECK_OK(status) << "Failed to create the test files: "
+                      << absl::StrJoin(filenames, ", ") << ": " << status;
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/compression_type,
+                               /*buffer_size=*/10,
+                               /*byte_offsets=*/{},
+                               /*node_name=*/kNodeName,
+                               /*read_ahead_blocks=*/3);
+}
+
+// Test case 7: byte_offsets for records, read ahead in blocks of the default
+// size.
+TFRecordDatasetParams ReadAheadDatasetParams2() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_2"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_3")};
+  std::vector<std::vector<string>> contents = {
+      {"1", "22", "333"}, {"a", "bb", "ccc"}, {"x", "yy", "zzz"}};
+  CompressionType compression_type = CompressionType::UNCOMPRESSED;
+  absl::Status status = CreateTestFiles(filenames, contents, compression_type);
+  TF_CHECK_OK(status) << "Failed to create the test files: "
+                      << absl::StrJoin(filenames, ", ") << ": " << status;
+  std::vector<int64_t> byte_offsets = {GetOffset(filenames[0], 0),
+                                       GetOffset(filenames[1], 1),
+                                       GetOffset(filenames[2], 2)};
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/compression_type,
+                               /*buffer_size=*/0, byte_offsets,
+                               /*node_name=*/kNodeName,
+                               /*read_ahead_blocks=*/2);
+}
+
 std::vector<GetNextTestCase<TFRecordDatasetParams>> GetNextTestCases() {
   return {
       {/*dataset_params=*/TFRecordDatasetParams1(),
@@ -221,6 +270,13 @@ std::vector<GetNextTestCase<TFRecordDatasetParams>> GetNextTestCases() {
        CreateTensors<tstring>(
            TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
       {/*dataset_params=*/TFRecordDatasetParams4(),
+       CreateTensors<tstring>(
+           TensorShape({}),
+           {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})},
+      {/*dataset_params=*/ReadAheadDatasetParams1(),
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/ReadAheadDatasetParams2(),
        CreateTensors<tstring>(
            TensorShape({}),
            {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})}};
@@ -261,6 +317,13 @@ std::vector<SkipTestCase<TFRecordDatasetParams>> SkipTestCases() {
            /*expected_outputs=*/
            CreateTensors<tstring>(TensorShape({}), {{"bb"}})},
           {/*dataset_params=*/TFRecordDatasetParams3(),
+           /*num_to_skip*/ 7, /*expected_num_skipped*/ 6},
+
+          {/*dataset_params=*/ReadAheadDatasetParams1(),
+           /*num_to_skip*/ 4, /*expected_num_skipped*/ 4, /*get_next*/ true,
+           /*expected_outputs=*/
+           CreateTensors<tstring>(TensorShape({}), {{"bb"}})},
+          {/*dataset_params=*/ReadAheadDatasetParams1(),
            /*num_to_skip*/ 7, /*expected_num_skipped*/ 6}};
 }
 
@@ -333,6 +396,72 @@ TEST_F(TFRecordDatasetOpTest, InvalidByteOffsetsToSeek) {
       absl::StatusCode::kDataLoss);
 }
 
+TEST_F(TFRecordDatasetOpTest, ReadAheadRecordsReadBandwidth) {
+  auto dataset_params = ReadAheadDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  // Iterates with a model, so that the iterator records its reads.
+  IteratorContext::Params params(iterator_ctx_.get());
+  params.model = std::make_shared<model::Model>();
+  IteratorContext ctx(params);
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(&ctx, /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(iterator->GetNext(&ctx, &out_tensors, &end_of_sequence));
+  }
+  EXPECT_EQ(6, out_tensors.size());
+  std::shared_ptr<model::Node> node = params.model->output();
+  ASSERT_NE(nullptr, node);
+  EXPECT_GT(node->bytes_read(), 0);
+  EXPECT_GT(node->read_bandwidth(), 0.0);
+}
+
+TEST_F(TFRecordDatasetOpTest, ReadAheadRetriesUnreadableFile) {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_retry_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_retry_2"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_read_ahead_retry_3")};
+  // The file in the middle of the list does not exist yet.
+  Env::Default()->DeleteFile(filenames[1]).IgnoreError();
+  TF_ASSERT_OK(CreateTestFiles({filenames[0], filenames[2]},
+                               {{"1", "22"}, {"x", "yy"}},
+                               CompressionType::UNCOMPRESSED));
+  auto dataset_params =
+      TFRecordDatasetParams(filenames,
+                            /*compression_type=*/CompressionType::UNCOMPRESSED,
+                            /*buffer_size=*/0, /*byte_offsets=*/{},
+                            /*node_name=*/kNodeName,
+                            /*read_ahead_blocks=*/2);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  // Every call retries the file that can't be opened, as without read-ahead.
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(iterator_
+                  ->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+                  .code(),
+              absl::StatusCode::kNotFound);
+  }
+  TF_ASSERT_OK(CreateTestFiles({filenames[1]}, {{"a"}},
+                               CompressionType::UNCOMPRESSED));
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  TF_EXPECT_OK(ExpectEqual(
+      out_tensors,
+      CreateTensors<tstring>(TensorShape({}),
+                             {{"1"}, {"22"}, {"a"}, {"x"}, {"yy"}}),
+      /*compare_order=*/true));
+}
+
 std::vector<IteratorSaveAndRestoreTestCase<TFRecordDatasetParams>>
 IteratorSaveAndRestoreTestCases() {
   return {
@@ -348,7 +477,16 @@ IteratorSaveAndRestoreTestCases() {
       {/*dataset_params=*/TFRecordDatasetParams3(),
        /*breakpoints=*/{0, 2, 7},
        CreateTensors<tstring>(
-           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})}};
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/ReadAheadDatasetParams1(),
+       /*breakpoints=*/{0, 2, 3, 7},
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/ReadAheadDatasetParams2(),
+       /*breakpoints=*/{0, 1, 4, 7},
+       CreateTensors<tstring>(
+           TensorShape({}),
+           {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})}};
 }
 
 ITERATOR_SAVE_AND_RESTORE_TEST_P(TFRecordDatasetOpTest, TFRecordDatasetParams,
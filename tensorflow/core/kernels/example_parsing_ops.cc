@@ -51,6 +51,10 @@ class ParseExampleOp : public OpKernel {
   explicit ParseExampleOp(OpKernelConstruction* ctx)
       : OpKernel(ctx), op_version_(ctx->def().op() == kParseExampleV2 ? 2 : 1) {
     OP_REQUIRES_OK(ctx, attrs_.Init(ctx, op_version_));
+    if (ctx->HasAttr("use_columnar_parser")) {
+      OP_REQUIRES_OK(
+          ctx, ctx->GetAttr("use_columnar_parser", &use_columnar_parser_));
+    }
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -251,9 +255,13 @@ class ParseExampleOp : public OpKernel {
     auto names_t = names->flat<tstring>();
     gtl::ArraySlice<tstring> slice(serialized_t.data(), serialized_t.size());
     gtl::ArraySlice<tstring> names_slice(names_t.data(), names_t.size());
-    return FastParseExample(
-        config, slice, names_slice,
-        ctx->device()->tensorflow_cpu_worker_threads()->workers, result);
+    thread::ThreadPool* thread_pool =
+        ctx->device()->tensorflow_cpu_worker_threads()->workers;
+    if (use_columnar_parser_) {
+      return FastParseExampleColumnar(config, slice, names_slice, thread_pool,
+                                      result);
+    }
+    return FastParseExample(config, slice, names_slice, thread_pool, result);
   }
 
   Status WriteOutput(const example::Result& result,
@@ -289,6 +297,8 @@ class ParseExampleOp : public OpKernel {
 
   ParseExampleAttrs attrs_;
   int op_version_;
+  // Whether vectors of examples are parsed with FastParseExampleColumnar().
+  bool use_columnar_parser_ = false;
   absl::once_flag flag_;
 };
 
@@ -19,14 +19,18 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/test.h"
@@ -202,7 +206,8 @@ static Graph* ParseExample(int batch_size, int num_keys, int feature_size) {
 }
 
 template <typename Options>
-static Graph* ParseExampleV2(int batch_size, int num_keys, int feature_size) {
+static Graph* ParseExampleV2(int batch_size, int num_keys, int feature_size,
+                             bool use_columnar_parser = false) {
   bool scalar_input = (batch_size == 0);
   Graph* g = new Graph(OpRegistry::Global());
   Tensor& serialized_batch =
@@ -272,6 +277,7 @@ static Graph* ParseExampleV2(int batch_size, int num_keys, int feature_size) {
                    .Attr("ragged_value_types", ragged_value_types)
                    .Attr("ragged_split_types", ragged_split_types)
                    .Attr("dense_shapes", dense_shapes)
+                   .Attr("use_columnar_parser", use_columnar_parser)
                    .Finalize(g, &ret));
 
   FixupSourceAndSinkEdges(g);
@@ -437,6 +443,42 @@ BM_AllParseExampleV2(DenseFloat);
 BM_AllParseExampleV2(VarLenDenseFloat);
 BM_AllParseExampleV2(RaggedFloat);
 
+#define BM_ParseExampleV2Columnar(TYPE, B, K, F)                          \
+  static void BM_ParseExampleV2Columnar##_##TYPE##_##B##_##K##_##F(       \
+      ::testing::benchmark::State& state) {                               \
+    int64_t items_per_iter = static_cast<int64_t>(B) * K * F;             \
+    test::Benchmark("cpu",                                                \
+                    ParseExampleV2<TYPE>(B, K, F,                         \
+                                         /*use_columnar_parser=*/true),   \
+                    nullptr, nullptr, nullptr,                            \
+                    "SINGLE_THREADED_EXECUTOR",                           \
+                    /*old_benchmark_api=*/false)                          \
+        .Run(state);                                                      \
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *    \
+                            items_per_iter);                              \
+  }                                                                       \
+  BENCHMARK(BM_ParseExampleV2Columnar##_##TYPE##_##B##_##K##_##F)         \
+      ->UseRealTime();
+
+// The columnar parser only applies to vector inputs.
+#define BM_AllParseExampleV2Columnar(Type)       \
+  BM_ParseExampleV2Columnar(Type, 128, 10, 1);   \
+  BM_ParseExampleV2Columnar(Type, 512, 10, 1);   \
+  BM_ParseExampleV2Columnar(Type, 128, 100, 1);  \
+  BM_ParseExampleV2Columnar(Type, 512, 100, 1);  \
+  BM_ParseExampleV2Columnar(Type, 512, 1000, 1); \
+  BM_ParseExampleV2Columnar(Type, 1, 1, 1000000);
+
+BM_AllParseExampleV2Columnar(SparseString);
+BM_AllParseExampleV2Columnar(VarLenDenseString);
+BM_AllParseExampleV2Columnar(RaggedString);
+BM_AllParseExampleV2Columnar(SparseInt64);
+BM_AllParseExampleV2Columnar(VarLenDenseInt64);
+BM_AllParseExampleV2Columnar(RaggedInt64);
+BM_AllParseExampleV2Columnar(SparseFloat);
+BM_AllParseExampleV2Columnar(VarLenDenseFloat);
+BM_AllParseExampleV2Columnar(RaggedFloat);
+
 // K == num_keys. F == feature_size.
 // K must be one of 10, 100, 1000
 #define BM_ParseSingleExample(TYPE, K, F)                                    \
@@ -476,4 +518,91 @@ BM_AllParseSingleExample(SparseFloat);
 BM_AllParseSingleExample(DenseFloat);
 BM_AllParseSingleExample(VarLenDenseFloat);
 
+// ParseExampleV2 with one sparse, one variable-length dense and one ragged
+// feature, run with each of the two batch parsers.
+class ParseExampleV2OpTest : public OpsTestBase,
+                             public ::testing::WithParamInterface<bool> {
+ protected:
+  void MakeOp() {
+    TF_ASSERT_OK(NodeDefBuilder("parse", "ParseExampleV2")
+                     .Input(FakeInput(DT_STRING))  // serialized
+                     .Input(FakeInput(DT_STRING))  // names
+                     .Input(FakeInput(DT_STRING))  // sparse_keys
+                     .Input(FakeInput(DT_STRING))  // dense_keys
+                     .Input(FakeInput(DT_STRING))  // ragged_keys
+                     .Input(FakeInput({DT_FLOAT}))  // dense_defaults
+                     .Attr("num_sparse", 1)
+                     .Attr("sparse_types", {DT_INT64})
+                     .Attr("ragged_value_types", {DT_STRING})
+                     .Attr("ragged_split_types", {DT_INT64})
+                     .Attr("dense_shapes", {PartialTensorShape({-1})})
+                     .Attr("use_columnar_parser", GetParam())
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_P(ParseExampleV2OpTest, ParsesVectorOfExamples) {
+  MakeOp();
+  std::vector<Example> examples(3);
+  auto& features_0 = *examples[0].mutable_features()->mutable_feature();
+  features_0["sparse"].mutable_int64_list()->add_value(1);
+  features_0["sparse"].mutable_int64_list()->add_value(2);
+  features_0["dense"].mutable_float_list()->add_value(1.5f);
+  features_0["ragged"].mutable_bytes_list()->add_value("a");
+  auto& features_2 = *examples[2].mutable_features()->mutable_feature();
+  features_2["sparse"].mutable_int64_list()->add_value(3);
+  features_2["dense"].mutable_float_list()->add_value(2.5f);
+  features_2["dense"].mutable_float_list()->add_value(3.5f);
+  features_2["ragged"].mutable_bytes_list()->add_value("b");
+  features_2["ragged"].mutable_bytes_list()->add_value("c");
+  std::vector<tstring> serialized;
+  for (const Example& example : examples) {
+    serialized.push_back(example.SerializeAsString());
+  }
+
+  AddInputFromArray<tstring>(TensorShape({3}), serialized);
+  AddInputFromArray<tstring>(TensorShape({0}), {});
+  AddInputFromArray<tstring>(TensorShape({1}), {"sparse"});
+  AddInputFromArray<tstring>(TensorShape({1}), {"dense"});
+  AddInputFromArray<tstring>(TensorShape({1}), {"ragged"});
+  AddInputFromArray<float>(TensorShape({}), {-1.0f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  test::ExpectTensorEqual<int64_t>(
+      *GetOutput(0),
+      test::AsTensor<int64_t>({0, 0, 0, 1, 2, 0}, TensorShape({3, 2})));
+  test::ExpectTensorEqual<int64_t>(*GetOutput(1),
+                                   test::AsTensor<int64_t>({1, 2, 3}));
+  test::ExpectTensorEqual<int64_t>(*GetOutput(2),
+                                   test::AsTensor<int64_t>({3, 2}));
+  test::ExpectTensorEqual<float>(
+      *GetOutput(3),
+      test::AsTensor<float>({1.5f, -1.0f, -1.0f, -1.0f, 2.5f, 3.5f},
+                            TensorShape({3, 2})));
+  test::ExpectTensorEqual<tstring>(*GetOutput(4),
+                                   test::AsTensor<tstring>({"a", "b", "c"}));
+  test::ExpectTensorEqual<int64_t>(*GetOutput(5),
+                                   test::AsTensor<int64_t>({0, 1, 1, 3}));
+}
+
+TEST_P(ParseExampleV2OpTest, InvalidExample) {
+  MakeOp();
+  Example example;
+  (*example.mutable_features()->mutable_feature())["sparse"]
+      .mutable_float_list()
+      ->add_value(1.0f);
+  AddInputFromArray<tstring>(TensorShape({2}),
+                             {example.SerializeAsString(), "not an example"});
+  AddInputFromArray<tstring>(TensorShape({0}), {});
+  AddInputFromArray<tstring>(TensorShape({1}), {"sparse"});
+  AddInputFromArray<tstring>(TensorShape({1}), {"dense"});
+  AddInputFromArray<tstring>(TensorShape({1}), {"ragged"});
+  AddInputFromArray<float>(TensorShape({}), {-1.0f});
+  EXPECT_FALSE(RunOpKernel().ok());
+}
+
+INSTANTIATE_TEST_SUITE_P(ParseExampleV2OpTests, ParseExampleV2OpTest,
+                         ::testing::Bool());
+
 }  // end namespace tensorflow
@@ -0,0 +1,364 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements _FusedElementwise, which evaluates a chain of elementwise ops
+// that Grappler's ElementwiseFusion optimizer collapsed into a single node.
+//
+// The output is computed in blocks that fit in the L1/L2 caches. For every
+// block, each op is evaluated in turn by Eigen's TensorExecutor, with the
+// intermediate results kept in per-thread scratch buffers, so that only the
+// arguments and the final output go through main memory.
+//
+// Currently supported only on CPU device.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/kernels/broadcast_to_op.h"
+#include "tensorflow/core/kernels/cwise_ops.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/util/bcast.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+namespace {
+
+enum class FusedOp {
+  kAdd,
+  kSub,
+  kMul,
+  kDiv,
+  kMaximum,
+  kMinimum,
+  kSquaredDifference,
+  kNeg,
+  kAbs,
+  kSquare,
+  kSqrt,
+  kRsqrt,
+  kExp,
+  kLog,
+  kTanh,
+  kSigmoid,
+  kRelu,
+  kRelu6,
+};
+
+struct FusedOpInfo {
+  FusedOp op;
+  int arity;
+  // Rough cost of evaluating the op for one element, in cycles.
+  int cost;
+};
+
+// Returns the op with the given TF op name, or nullptr if it is not
+// supported.
+const FusedOpInfo* FindFusedOp(const string& name) {
+  static const auto* ops = new absl::flat_hash_map<string, FusedOpInfo>({
+      {"Add", {FusedOp::kAdd, 2, 1}},
+      {"AddV2", {FusedOp::kAdd, 2, 1}},
+      {"Sub", {FusedOp::kSub, 2, 1}},
+      {"Mul", {FusedOp::kMul, 2, 1}},
+      {"Div", {FusedOp::kDiv, 2, 5}},
+      {"RealDiv", {FusedOp::kDiv, 2, 5}},
+      {"Maximum", {FusedOp::kMaximum, 2, 1}},
+      {"Minimum", {FusedOp::kMinimum, 2, 1}},
+      {"SquaredDifference", {FusedOp::kSquaredDifference, 2, 2}},
+      {"Neg", {FusedOp::kNeg, 1, 1}},
+      {"Abs", {FusedOp::kAbs, 1, 1}},
+      {"Square", {FusedOp::kSquare, 1, 1}},
+      {"Sqrt", {FusedOp::kSqrt, 1, 5}},
+      {"Rsqrt", {FusedOp::kRsqrt, 1, 5}},
+      {"Exp", {FusedOp::kExp, 1, 20}},
+      {"Log", {FusedOp::kLog, 1, 20}},
+      {"Tanh", {FusedOp::kTanh, 1, 20}},
+      {"Sigmoid", {FusedOp::kSigmoid, 1, 20}},
+      {"Relu", {FusedOp::kRelu, 1, 1}},
+      {"Relu6", {FusedOp::kRelu6, 1, 1}},
+  });
+  auto it = ops->find(name);
+  return it == ops->end() ? nullptr : &it->second;
+}
+
+// One op of the chain. `inputs` are value indices, as in `op_inputs`.
+struct Step {
+  FusedOp op;
+  int inputs[2];
+};
+
+// Evaluates `step` for `size` elements, reading its inputs from `values` and
+// writing to `out`, which may be one of them.
+template <typename T>
+void EvaluateStep(const Step& step, const T* const* values, int64_t size,
+                  T* out) {
+  typename TTypes<T>::UnalignedFlat o(out, size);
+  typename TTypes<T>::UnalignedConstFlat x(values[step.inputs[0]], size);
+  switch (step.op) {
+    case FusedOp::kNeg:
+      o = x.unaryExpr(typename functor::neg<T>::func());
+      return;
+    case FusedOp::kAbs:
+      o = x.unaryExpr(typename functor::abs<T>::func());
+      return;
+    case FusedOp::kSquare:
+      o = x.unaryExpr(typename functor::square<T>::func());
+      return;
+    case FusedOp::kSqrt:
+      o = x.unaryExpr(typename functor::sqrt<T>::func());
+      return;
+    case FusedOp::kRsqrt:
+      o = x.unaryExpr(typename functor::rsqrt<T>::func());
+      return;
+    case FusedOp::kExp:
+      o = x.unaryExpr(typename functor::exp<T>::func());
+      return;
+    case FusedOp::kLog:
+      o = x.unaryExpr(typename functor::log<T>::func());
+      return;
+    case FusedOp::kTanh:
+      o = x.unaryExpr(typename functor::tanh<T>::func());
+      return;
+    case FusedOp::kSigmoid:
+      o = x.unaryExpr(typename functor::sigmoid<T>::func());
+      return;
+    case FusedOp::kRelu:
+      o = x.cwiseMax(static_cast<T>(0));
+      return;
+    case FusedOp::kRelu6:
+      o = x.cwiseMax(static_cast<T>(0)).cwiseMin(static_cast<T>(6));
+      return;
+    default:
+      break;
+  }
+  typename TTypes<T>::UnalignedConstFlat y(values[step.inputs[1]], size);
+  switch (step.op) {
+    case FusedOp::kAdd:
+      o = x.binaryExpr(y, typename functor::add<T>::func());
+      return;
+    case FusedOp::kSub:
+      o = x.binaryExpr(y, typename functor::sub<T>::func());
+      return;
+    case FusedOp::kMul:
+      o = x.binaryExpr(y, typename functor::mul<T>::func());
+      return;
+    case FusedOp::kDiv:
+      o = x.binaryExpr(y, typename functor::div<T>::func());
+      return;
+    case FusedOp::kMaximum:
+      o = x.binaryExpr(y, typename functor::maximum<T>::func());
+      return;
+    case FusedOp::kMinimum:
+      o = x.binaryExpr(y, typename functor::minimum<T>::func());
+      return;
+    case FusedOp::kSquaredDifference:
+      o = x.binaryExpr(y, typename functor::squared_difference<T>::func());
+      return;
+    default:
+      LOG(FATAL) << "Unexpected fused op";  // Crash OK
+  }
+}
+
+// Returns true if `shape`, without its leading dimensions of size 1, matches
+// the innermost dimensions of `output_shape`, i.e. if element i of the output
+// reads element i % shape.num_elements() of the argument.
+bool IsInnerBroadcast(const TensorShape& shape,
+                      const TensorShape& output_shape) {
+  int skip = 0;
+  while (skip < shape.dims() && shape.dim_size(skip) == 1) ++skip;
+  const int dims = shape.dims() - skip;
+  if (dims > output_shape.dims()) return false;
+  for (int i = 0; i < dims; ++i) {
+    if (shape.dim_size(skip + i) !=
+        output_shape.dim_size(output_shape.dims() - dims + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+template <typename T>
+class FusedElementwiseOp : public OpKernel {
+ public:
+  explicit FusedElementwiseOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::vector<string> fused_ops;
+    std::vector<int> op_inputs;
+    OP_REQUIRES_OK(context, context->GetAttr("num_args", &num_args_));
+    OP_REQUIRES_OK(context, context->GetAttr("fused_ops", &fused_ops));
+    OP_REQUIRES_OK(context, context->GetAttr("op_inputs", &op_inputs));
+
+    const int num_ops = fused_ops.size();
+    size_t next_input = 0;
+    for (int i = 0; i < num_ops; ++i) {
+      const FusedOpInfo* info = FindFusedOp(fused_ops[i]);
+      OP_REQUIRES(context, info != nullptr,
+                  errors::Unimplemented("Unsupported fused op: ",
+                                        fused_ops[i]));
+      OP_REQUIRES(
+          context, next_input + info->arity <= op_inputs.size(),
+          errors::InvalidArgument("op_inputs has too few entries for ",
+                                  num_ops, " fused ops"));
+      Step step;
+      step.op = info->op;
+      step.inputs[1] = -1;
+      for (int j = 0; j < info->arity; ++j) {
+        const int input = op_inputs[next_input++];
+        OP_REQUIRES(context, input >= 0 && input < num_args_ + i,
+                    errors::InvalidArgument(
+                        "Input ", j, " of fused op ", i, " (", fused_ops[i],
+                        ") refers to value ", input, ", but only ",
+                        num_args_ + i, " values are defined"));
+        step.inputs[j] = input;
+      }
+      steps_.push_back(step);
+      cost_per_element_ += info->cost;
+    }
+    OP_REQUIRES(context, next_input == op_inputs.size(),
+                errors::InvalidArgument("op_inputs has ", op_inputs.size(),
+                                        " entries, but the fused ops have ",
+                                        next_input, " inputs"));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    TensorShape output_shape = context->input(0).shape();
+    for (int i = 1; i < num_args_; ++i) {
+      const TensorShape& shape = context->input(i).shape();
+      if (shape == output_shape) continue;
+      BCast bcast(BCast::FromShape(output_shape), BCast::FromShape(shape));
+      OP_REQUIRES(context, bcast.IsValid(),
+                  errors::InvalidArgument(
+                      "Incompatible shapes: ", output_shape.DebugString(),
+                      " vs. ", shape.DebugString()));
+      output_shape = BCast::ToShape(bcast.output_shape());
+    }
+
+    // Arguments are either read in place, repeated, or broadcast to the
+    // output shape beforehand.
+    const int64_t size = output_shape.num_elements();
+    std::vector<const T*> arg_data(num_args_);
+    std::vector<int64_t> arg_sizes(num_args_);
+    std::vector<int> forwardable_inputs;
+    std::vector<Tensor> broadcast_args;
+    for (int i = 0; i < num_args_ && size > 0; ++i) {
+      const Tensor& arg = context->input(i);
+      if (arg.shape() == output_shape) {
+        forwardable_inputs.push_back(i);
+      } else if (!IsInnerBroadcast(arg.shape(), output_shape)) {
+        Tensor broadcast_arg;
+        OP_REQUIRES_OK(context, context->allocate_temp(
+                                    DataTypeToEnum<T>::value, output_shape,
+                                    &broadcast_arg));
+        BCast bcast(BCast::FromShape(arg.shape()),
+                    BCast::FromShape(output_shape),
+                    /*fewer_dims_optimization=*/true);
+        functor::BroadcastTo<CPUDevice, T>()(
+            context->eigen_device<CPUDevice>(), context, broadcast_arg,
+            output_shape, arg, arg.shape(), bcast);
+        broadcast_args.push_back(broadcast_arg);
+        arg_data[i] = broadcast_arg.flat<T>().data();
+        arg_sizes[i] = size;
+        continue;
+      }
+      arg_data[i] = arg.flat<T>().data();
+      arg_sizes[i] = arg.NumElements();
+    }
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
+                                forwardable_inputs, 0, output_shape, &output));
+    if (size == 0) return;
+    T* output_data = output->flat<T>().data();
+
+    const int num_steps = steps_.size();
+    const int num_values = num_args_ + num_steps;
+    auto compute_blocks = [&](int64_t begin_block, int64_t end_block) {
+      // One block of scratch space for every argument that is repeated, and
+      // for every intermediate result.
+      std::unique_ptr<T[]> scratch(new T[num_values * kBlockSize]);
+      std::vector<const T*> values(num_values);
+      // Arguments whose size divides the block size look the same in every
+      // block.
+      std::vector<bool> filled(num_args_, false);
+      for (int64_t block = begin_block; block < end_block; ++block) {
+        const int64_t start = block * kBlockSize;
+        const int64_t block_size = std::min(kBlockSize, size - start);
+        for (int i = 0; i < num_args_; ++i) {
+          if (arg_sizes[i] == size) {
+            values[i] = arg_data[i] + start;
+            continue;
+          }
+          T* buffer = scratch.get() + i * kBlockSize;
+          values[i] = buffer;
+          if (filled[i]) continue;
+          const int64_t arg_size = arg_sizes[i];
+          int64_t offset = start % arg_size;
+          for (int64_t j = 0; j < block_size;) {
+            const int64_t n = std::min(block_size - j, arg_size - offset);
+            std::copy_n(arg_data[i] + offset, n, buffer + j);
+            j += n;
+            offset = 0;
+          }
+          filled[i] = kBlockSize % arg_size == 0;
+        }
+        for (int s = 0; s < num_steps; ++s) {
+          T* out = s + 1 == num_steps
+                       ? output_data + start
+                       : scratch.get() + (num_args_ + s) * kBlockSize;
+          EvaluateStep(steps_[s], values.data(), block_size, out);
+          values[num_args_ + s] = out;
+        }
+      }
+    };
+    const int64_t num_blocks = (size + kBlockSize - 1) / kBlockSize;
+    context->device()->tensorflow_cpu_worker_threads()->workers->ParallelFor(
+        num_blocks, kBlockSize * cost_per_element_, compute_blocks);
+  }
+
+ private:
+  // Number of elements of a block, small enough for the scratch buffers of a
+  // chain of a few ops to stay in the L2 cache.
+  static constexpr int64_t kBlockSize = 2048;
+
+  int num_args_;
+  std::vector<Step> steps_;
+  int64_t cost_per_element_ = 0;
+};
+
+#define REGISTER_CPU(T)                                                    \
+  REGISTER_KERNEL_BUILDER(                                                 \
+      Name("_FusedElementwise").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedElementwiseOp<T>);
+
+TF_CALL_float(REGISTER_CPU);
+TF_CALL_double(REGISTER_CPU);
+
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
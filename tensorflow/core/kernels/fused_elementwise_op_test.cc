@@ -0,0 +1,176 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedElementwiseOpTest : public OpsTestBase {
+ protected:
+  Status MakeOp(int num_args, const std::vector<string>& fused_ops,
+                const std::vector<int>& op_inputs) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("fused", "_FusedElementwise")
+                           .Input(FakeInput(num_args, DT_FLOAT))
+                           .Attr("fused_ops", fused_ops)
+                           .Attr("op_inputs", op_inputs)
+                           .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(FusedElementwiseOpTest, SameShapes) {
+  // tanh(x * y) + x
+  TF_ASSERT_OK(MakeOp(2, {"Mul", "Tanh", "AddV2"}, {0, 1, 2, 3, 0}));
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<float>(TensorShape({2, 3}), {0.1, 0.2, 0.3, -0.1, 0, 1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(
+      &expected, {std::tanh(0.1f) + 1, std::tanh(0.4f) + 2,
+                  std::tanh(0.9f) + 3, std::tanh(-0.4f) + 4, 5,
+                  std::tanh(6.0f) + 6});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedElementwiseOpTest, BroadcastsScalarsAndInnerDimensions) {
+  // relu(x * bias + scalar)
+  TF_ASSERT_OK(MakeOp(3, {"Mul", "Add", "Relu"}, {0, 1, 3, 2, 4}));
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<float>(TensorShape({3}), {1, -1, 2});
+  AddInputFromArray<float>(TensorShape({}), {-3});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&expected, {0, 0, 3, 1, 0, 9});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedElementwiseOpTest, BroadcastsOuterDimensions) {
+  // square(x - column)
+  TF_ASSERT_OK(MakeOp(2, {"Sub", "Square"}, {1, 0, 2}));
+  AddInputFromArray<float>(TensorShape({2, 1}), {1, 2});
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&expected, {0, 1, 4, 4, 9, 16});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedElementwiseOpTest, SpansSeveralBlocks) {
+  // maximum(x * bias, 1) / 4, with rows that straddle block boundaries.
+  constexpr int kRows = 1500;
+  constexpr int kCols = 7;
+  TF_ASSERT_OK(
+      MakeOp(4, {"Mul", "Maximum", "RealDiv"}, {0, 1, 4, 2, 5, 3}));
+  std::vector<float> x(kRows * kCols);
+  for (int i = 0; i < kRows * kCols; ++i) x[i] = (i % 11) - 5;
+  AddInputFromArray<float>(TensorShape({kRows, kCols}), x);
+  AddInputFromArray<float>(TensorShape({1, kCols}), {1, 2, 3, 4, 5, 6, 7});
+  AddInputFromArray<float>(TensorShape({}), {1});
+  AddInputFromArray<float>(TensorShape({}), {4});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape({kRows, kCols}));
+  auto expected_flat = expected.flat<float>();
+  for (int i = 0; i < kRows * kCols; ++i) {
+    expected_flat(i) = std::max(x[i] * (i % kCols + 1), 1.0f) / 4;
+  }
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedElementwiseOpTest, InvalidPrograms) {
+  EXPECT_TRUE(absl::StrContains(
+      MakeOp(1, {"MatMul"}, {0, 0}).message(), "Unsupported fused op"));
+  // The first op cannot read its own output.
+  EXPECT_TRUE(absl::StrContains(MakeOp(1, {"Neg"}, {1}).message(),
+                                "only 1 values are defined"));
+  EXPECT_TRUE(absl::StrContains(MakeOp(2, {"Add"}, {0}).message(),
+                                "too few entries"));
+  EXPECT_TRUE(absl::StrContains(MakeOp(1, {"Neg"}, {0, 0}).message(),
+                                "op_inputs has 2 entries"));
+}
+
+TEST_F(FusedElementwiseOpTest, IncompatibleShapes) {
+  TF_ASSERT_OK(MakeOp(2, {"Add"}, {0, 1}));
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  AddInputFromArray<float>(TensorShape({2}), {1, 2});
+  EXPECT_TRUE(
+      absl::StrContains(RunOpKernel().message(), "Incompatible shapes"));
+}
+
+// Builds tanh(x * y + x) * y, either from separate ops or as one fused op.
+Graph* ElementwiseChain(int num, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor x_t(DT_FLOAT, TensorShape({num}));
+  x_t.flat<float>().setRandom();
+  Tensor y_t(DT_FLOAT, TensorShape({num}));
+  y_t.flat<float>().setRandom();
+  Node* x = test::graph::Constant(g, x_t);
+  Node* y = test::graph::Constant(g, y_t);
+  if (fused) {
+    Node* out;
+    TF_CHECK_OK(NodeBuilder(g->NewName("fused"), "_FusedElementwise")
+                    .Input(std::vector<NodeBuilder::NodeOut>({x, y}))
+                    .Attr("fused_ops", {"Mul", "AddV2", "Tanh", "Mul"})
+                    .Attr("op_inputs", {0, 1, 2, 0, 3, 4, 1})
+                    .Finalize(g, &out));
+  } else {
+    Node* n = test::graph::Binary(g, "Mul", x, y);
+    n = test::graph::Binary(g, "AddV2", n, x);
+    n = test::graph::Unary(g, "Tanh", n);
+    test::graph::Binary(g, "Mul", n, y);
+  }
+  return g;
+}
+
+static void BM_ElementwiseChain(::testing::benchmark::State& state) {
+  const int num = state.range(0);
+  const bool fused = state.range(1);
+  test::Benchmark("cpu", ElementwiseChain(num, fused),
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * num);
+  state.SetLabel(fused ? "fused" : "unfused");
+}
+
+BENCHMARK(BM_ElementwiseChain)
+    ->UseRealTime()
+    ->ArgPair(1 << 14, 0)
+    ->ArgPair(1 << 14, 1)
+    ->ArgPair(1 << 20, 0)
+    ->ArgPair(1 << 20, 1)
+    ->ArgPair(1 << 24, 0)
+    ->ArgPair(1 << 24, 1);
+
+}  // namespace
+}  // namespace tensorflow
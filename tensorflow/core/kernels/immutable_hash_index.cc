@@ -0,0 +1,289 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/immutable_hash_index.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/platform/byte_order.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/strcat.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+// Smallest power of two that keeps the load factor at or below 3/4.
+uint64 NumSlotsFor(int64_t num_entries) {
+  uint64 num_slots = 1;
+  while (num_slots * 3 < static_cast<uint64>(num_entries) * 4 + 4) {
+    num_slots <<= 1;
+  }
+  return num_slots;
+}
+
+uint64 HashOf(const tstring& key) {
+  return ImmutableHashIndex::HashKey(key);
+}
+
+template <typename K>
+uint64 HashOf(const K& key) {
+  return ImmutableHashIndex::HashWord(ImmutableHashIndex::EncodeScalar(key));
+}
+
+uint64 Encode(const tstring& s, std::string* blob) {
+  const uint64 offset = blob->size();
+  const uint32 length = static_cast<uint32>(s.size());
+  blob->append(reinterpret_cast<const char*>(&length), sizeof(length));
+  blob->append(s.data(), s.size());
+  return offset;
+}
+
+template <typename T>
+uint64 Encode(const T& value, std::string* blob) {
+  return ImmutableHashIndex::EncodeScalar(value);
+}
+
+bool TooLong(const tstring& s) {
+  return s.size() > std::numeric_limits<uint32>::max();
+}
+
+template <typename T>
+bool TooLong(const T& value) {
+  return false;
+}
+
+template <class K, class V>
+Status BuildIndex(const Tensor& keys, const Tensor& values,
+                  ImmutableHashIndex::Header* header,
+                  std::vector<ImmutableHashIndex::Slot>* slots,
+                  std::string* blob) {
+  const auto key_values = keys.flat<K>();
+  const auto value_values = values.flat<V>();
+  const uint64 num_slots = NumSlotsFor(key_values.size());
+  const uint64 mask = num_slots - 1;
+
+  // Place keys first, remembering which input element occupies each slot, so
+  // that duplicate keys can be compared against the original tensors and
+  // only unique strings end up in the blob.
+  std::vector<int64_t> source(num_slots, -1);
+  std::vector<uint64> hashes(num_slots, 0);
+  int64_t num_entries = 0;
+  for (int64_t i = 0; i < key_values.size(); ++i) {
+    const K& key = key_values(i);
+    if (TooLong(key) || TooLong(value_values(i))) {
+      return errors::InvalidArgument(
+          "Strings stored in a hash index must be shorter than 4GiB");
+    }
+    const uint64 hash = HashOf(key);
+    uint64 s = hash & mask;
+    while (source[s] >= 0) {
+      const int64_t j = source[s];
+      if (hashes[s] == hash && key_values(j) == key) break;
+      s = (s + 1) & mask;
+    }
+    if (source[s] >= 0) {
+      const int64_t j = source[s];
+      if (value_values(j) != value_values(i)) {
+        return errors::FailedPrecondition(
+            "HashTable has different value for same key. Key ", key, " has ",
+            value_values(j), " and trying to add value ", value_values(i));
+      }
+      continue;
+    }
+    source[s] = i;
+    hashes[s] = hash;
+    ++num_entries;
+  }
+
+  slots->assign(num_slots, ImmutableHashIndex::Slot{0, 0, 0});
+  for (uint64 s = 0; s < num_slots; ++s) {
+    if (source[s] < 0) continue;
+    ImmutableHashIndex::Slot& slot = (*slots)[s];
+    slot.hash = hashes[s];
+    slot.key = Encode(key_values(source[s]), blob);
+    slot.value = Encode(value_values(source[s]), blob);
+  }
+
+  std::memset(header, 0, sizeof(*header));
+  std::memcpy(header->magic, ImmutableHashIndex::kMagic, sizeof(header->magic));
+  header->version = ImmutableHashIndex::kVersion;
+  header->key_dtype = DataTypeToEnum<K>::value;
+  header->value_dtype = DataTypeToEnum<V>::value;
+  header->num_entries = num_entries;
+  header->num_slots = num_slots;
+  header->blob_size = blob->size();
+  return OkStatus();
+}
+
+template <class K>
+Status BuildIndexForKey(const Tensor& keys, const Tensor& values,
+                        ImmutableHashIndex::Header* header,
+                        std::vector<ImmutableHashIndex::Slot>* slots,
+                        std::string* blob) {
+  switch (values.dtype()) {
+#define HANDLE_TYPE(V)           \
+  case DataTypeToEnum<V>::value: \
+    return BuildIndex<K, V>(keys, values, header, slots, blob);
+    HANDLE_TYPE(bool);
+    HANDLE_TYPE(int32);
+    HANDLE_TYPE(int64_t);
+    HANDLE_TYPE(float);
+    HANDLE_TYPE(double);
+    HANDLE_TYPE(tstring);
+#undef HANDLE_TYPE
+    default:
+      return errors::Unimplemented(
+          "Hash index does not support values of type ",
+          DataTypeString(values.dtype()));
+  }
+}
+
+}  // namespace
+
+bool ImmutableHashIndex::IsSupportedKeyType(DataType dtype) {
+  return dtype == DT_INT32 || dtype == DT_INT64 || dtype == DT_STRING;
+}
+
+bool ImmutableHashIndex::IsSupportedValueType(DataType dtype) {
+  return dtype == DT_BOOL || dtype == DT_INT32 || dtype == DT_INT64 ||
+         dtype == DT_FLOAT || dtype == DT_DOUBLE || dtype == DT_STRING;
+}
+
+Status ImmutableHashIndex::Write(Env* env, const std::string& filename,
+                                 const Tensor& keys, const Tensor& values) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Hash index files are only supported on little-endian hosts");
+  }
+  if (keys.NumElements() != values.NumElements()) {
+    return errors::InvalidArgument(
+        "Expected keys and values to have the same number of elements, got ",
+        keys.NumElements(), " and ", values.NumElements());
+  }
+
+  Header header;
+  std::vector<Slot> slots;
+  std::string blob;
+  switch (keys.dtype()) {
+    case DT_INT32:
+      TF_RETURN_IF_ERROR(
+          BuildIndexForKey<int32>(keys, values, &header, &slots, &blob));
+      break;
+    case DT_INT64:
+      TF_RETURN_IF_ERROR(
+          BuildIndexForKey<int64_t>(keys, values, &header, &slots, &blob));
+      break;
+    case DT_STRING:
+      TF_RETURN_IF_ERROR(
+          BuildIndexForKey<tstring>(keys, values, &header, &slots, &blob));
+      break;
+    default:
+      return errors::Unimplemented("Hash index does not support keys of type ",
+                                   DataTypeString(keys.dtype()));
+  }
+
+  // Write to a temporary file and rename it into place so that readers never
+  // map a partially written index.
+  const std::string tmp_filename =
+      strings::StrCat(filename, ".tempstate", random::New64());
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(tmp_filename, &file));
+  TF_RETURN_IF_ERROR(file->Append(
+      StringPiece(reinterpret_cast<const char*>(&header), sizeof(header))));
+  TF_RETURN_IF_ERROR(
+      file->Append(StringPiece(reinterpret_cast<const char*>(slots.data()),
+                               slots.size() * sizeof(Slot))));
+  TF_RETURN_IF_ERROR(file->Append(blob));
+  TF_RETURN_IF_ERROR(file->Close());
+  return env->RenameFile(tmp_filename, filename);
+}
+
+Status ImmutableHashIndex::Open(Env* env, const std::string& filename,
+                                std::unique_ptr<ImmutableHashIndex>* index) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Hash index files are only supported on little-endian hosts");
+  }
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_RETURN_IF_ERROR(env->NewReadOnlyMemoryRegionFromFile(filename, &region));
+  const uint64 length = region->length();
+  if (length < sizeof(Header)) {
+    return errors::DataLoss("Hash index file ", filename,
+                            " is too short: ", length, " bytes");
+  }
+  const char* data = static_cast<const char*>(region->data());
+  Header header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    return errors::DataLoss("File ", filename, " is not a hash index");
+  }
+  if (header.version != kVersion) {
+    return errors::Unimplemented("Hash index file ", filename,
+                                 " has unsupported version ", header.version);
+  }
+  const DataType key_dtype = static_cast<DataType>(header.key_dtype);
+  const DataType value_dtype = static_cast<DataType>(header.value_dtype);
+  if (!IsSupportedKeyType(key_dtype) || !IsSupportedValueType(value_dtype)) {
+    return errors::DataLoss("Hash index file ", filename,
+                            " has unsupported key or value type");
+  }
+  const uint64 num_slots = header.num_slots;
+  if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0 ||
+      header.num_entries > num_slots ||
+      num_slots > (length - sizeof(Header)) / sizeof(Slot) ||
+      header.blob_size !=
+          length - sizeof(Header) - num_slots * sizeof(Slot)) {
+    return errors::DataLoss("Hash index file ", filename, " is corrupted");
+  }
+
+  index->reset(new ImmutableHashIndex);
+  ImmutableHashIndex* result = index->get();
+  result->filename_ = filename;
+  result->key_dtype_ = key_dtype;
+  result->value_dtype_ = value_dtype;
+  result->num_entries_ = header.num_entries;
+  result->num_slots_ = num_slots;
+  result->slots_ = reinterpret_cast<const Slot*>(data + sizeof(Header));
+  result->blob_ = data + sizeof(Header) + num_slots * sizeof(Slot);
+  result->blob_size_ = header.blob_size;
+  result->region_length_ = length;
+  result->region_ = std::move(region);
+  return OkStatus();
+}
+
+Status ImmutableHashIndex::GetString(uint64 offset, StringPiece* s) const {
+  uint32 length;
+  if (offset > blob_size_ || blob_size_ - offset < sizeof(length)) {
+    return errors::DataLoss("Hash index file ", filename_,
+                            " is corrupted: string offset ", offset,
+                            " is out of range");
+  }
+  std::memcpy(&length, blob_ + offset, sizeof(length));
+  if (blob_size_ - offset - sizeof(length) < length) {
+    return errors::DataLoss("Hash index file ", filename_,
+                            " is corrupted: string at offset ", offset,
+                            " is out of range");
+  }
+  *s = StringPiece(blob_ + offset + sizeof(length), length);
+  return OkStatus();
+}
+
+}  // namespace lookup
+}  // namespace tensorflow
@@ -0,0 +1,229 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_IMMUTABLE_HASH_INDEX_H_
+#define TENSORFLOW_CORE_KERNELS_IMMUTABLE_HASH_INDEX_H_
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+
+namespace tensorflow {
+namespace lookup {
+
+// An immutable key-value hash index stored in a single file. The file is built
+// once (see Write) and then memory-mapped through
+// Env::NewReadOnlyMemoryRegionFromFile and queried in place, so loading it
+// costs no parsing or heap allocation and processes opening the same file
+// share its pages through the page cache.
+//
+// File layout (integers are little-endian):
+//
+//   Header  64 bytes, see `Header` below.
+//   Slots   `num_slots` x {uint64 hash, uint64 key, uint64 value}, an
+//           open-addressing table with linear probing. `num_slots` is a power
+//           of two and unused slots have hash 0.
+//   Blob    String data. Each string is a uint32 length followed by its bytes.
+//
+// Keys and values of fixed-width types are stored inline in their 64-bit slot
+// words. For string keys and values the word is the offset of the string in
+// the blob.
+class ImmutableHashIndex {
+ public:
+  static constexpr char kMagic[8] = {'T', 'F', 'H', 'I', 'D', 'X', 0, 0};
+  static constexpr uint32 kVersion = 1;
+
+  struct Header {
+    char magic[8];
+    uint32 version;
+    uint32 key_dtype;
+    uint32 value_dtype;
+    uint32 reserved0;
+    uint64 num_entries;
+    uint64 num_slots;
+    uint64 blob_size;
+    uint64 reserved1[3];
+  };
+  static_assert(sizeof(Header) == 64, "Header must be 64 bytes");
+
+  struct Slot {
+    uint64 hash;
+    uint64 key;
+    uint64 value;
+  };
+  static_assert(sizeof(Slot) == 24, "Slot must be 24 bytes");
+
+  // Builds an index holding the entries `keys[i] -> values[i]` and writes it
+  // to `filename`. `keys` and `values` must have the same number of elements.
+  // Repeated keys are allowed as long as they map to the same value.
+  static Status Write(Env* env, const std::string& filename, const Tensor& keys,
+                      const Tensor& values);
+
+  // Memory-maps the index in `filename` and validates its header.
+  static Status Open(Env* env, const std::string& filename,
+                     std::unique_ptr<ImmutableHashIndex>* index);
+
+  // Returns true if `dtype` can be used for keys (resp. values) of an index.
+  static bool IsSupportedKeyType(DataType dtype);
+  static bool IsSupportedValueType(DataType dtype);
+
+  const std::string& filename() const { return filename_; }
+  DataType key_dtype() const { return key_dtype_; }
+  DataType value_dtype() const { return value_dtype_; }
+  int64_t size() const { return num_entries_; }
+
+  // Number of bytes of the mapped file. These are backed by the page cache
+  // rather than the process heap.
+  uint64 mapped_bytes() const { return region_length_; }
+
+  // For every element of `keys`, writes the value stored for it, or
+  // `default_value` if it is absent, to the same position of `values`.
+  template <class K, class V>
+  Status Find(typename TTypes<K>::ConstFlat keys,
+              typename TTypes<V>::Flat values, const V& default_value) const {
+    for (int64_t i = 0; i < keys.size(); ++i) {
+      const Slot* slot;
+      TF_RETURN_IF_ERROR(FindSlot(keys(i), &slot));
+      if (slot == nullptr) {
+        values(i) = default_value;
+      } else {
+        TF_RETURN_IF_ERROR(Decode(slot->value, &values(i)));
+      }
+    }
+    return OkStatus();
+  }
+
+  // Writes all entries, in slot order, to `keys` and `values`, which must both
+  // have size() elements.
+  template <class K, class V>
+  Status Export(typename TTypes<K>::Flat keys,
+                typename TTypes<V>::Flat values) const {
+    int64_t i = 0;
+    for (uint64 s = 0; s < num_slots_ && i < num_entries_; ++s) {
+      const Slot& slot = slots_[s];
+      if (slot.hash == 0) continue;
+      TF_RETURN_IF_ERROR(Decode(slot.key, &keys(i)));
+      TF_RETURN_IF_ERROR(Decode(slot.value, &values(i)));
+      ++i;
+    }
+    return OkStatus();
+  }
+
+  // Hash of a key as stored in its slot. Never 0, which marks empty slots.
+  static uint64 HashKey(StringPiece key) {
+    return Hash64(key.data(), key.size()) | kOccupiedBit;
+  }
+  static uint64 HashWord(uint64 word) {
+    char bytes[sizeof(word)];
+    std::memcpy(bytes, &word, sizeof(word));
+    return Hash64(bytes, sizeof(bytes)) | kOccupiedBit;
+  }
+
+  // Encodes a fixed-width scalar in a 64-bit slot word.
+  template <typename T>
+  static uint64 EncodeScalar(const T& value) {
+    static_assert(sizeof(T) <= sizeof(uint64), "Scalar does not fit a word");
+    uint64 word = 0;
+    std::memcpy(&word, &value, sizeof(T));
+    return word;
+  }
+
+ private:
+  static constexpr uint64 kOccupiedBit = 1ULL << 63;
+
+  ImmutableHashIndex() = default;
+
+  // Sets `slot` to the slot holding `key`, or nullptr if it is absent.
+  Status FindSlot(const tstring& key, const Slot** slot) const {
+    const uint64 hash = HashKey(key);
+    const uint64 mask = num_slots_ - 1;
+    uint64 s = hash & mask;
+    for (uint64 n = 0; n < num_slots_; ++n, s = (s + 1) & mask) {
+      const Slot& candidate = slots_[s];
+      if (candidate.hash == 0) break;
+      if (candidate.hash != hash) continue;
+      StringPiece stored;
+      TF_RETURN_IF_ERROR(GetString(candidate.key, &stored));
+      if (stored == StringPiece(key)) {
+        *slot = &candidate;
+        return OkStatus();
+      }
+    }
+    *slot = nullptr;
+    return OkStatus();
+  }
+
+  template <typename K>
+  Status FindSlot(const K& key, const Slot** slot) const {
+    const uint64 word = EncodeScalar(key);
+    const uint64 hash = HashWord(word);
+    const uint64 mask = num_slots_ - 1;
+    uint64 s = hash & mask;
+    for (uint64 n = 0; n < num_slots_; ++n, s = (s + 1) & mask) {
+      const Slot& candidate = slots_[s];
+      if (candidate.hash == 0) break;
+      if (candidate.hash == hash && candidate.key == word) {
+        *slot = &candidate;
+        return OkStatus();
+      }
+    }
+    *slot = nullptr;
+    return OkStatus();
+  }
+
+  Status Decode(uint64 word, tstring* value) const {
+    StringPiece s;
+    TF_RETURN_IF_ERROR(GetString(word, &s));
+    value->assign(s.data(), s.size());
+    return OkStatus();
+  }
+
+  template <typename T>
+  Status Decode(uint64 word, T* value) const {
+    std::memcpy(value, &word, sizeof(T));
+    return OkStatus();
+  }
+
+  // Sets `s` to the string stored at `offset` in the blob.
+  Status GetString(uint64 offset, StringPiece* s) const;
+
+  std::string filename_;
+  std::unique_ptr<ReadOnlyMemoryRegion> region_;
+  uint64 region_length_ = 0;
+  DataType key_dtype_ = DT_INVALID;
+  DataType value_dtype_ = DT_INVALID;
+  int64_t num_entries_ = 0;
+  uint64 num_slots_ = 0;
+  const Slot* slots_ = nullptr;
+  const char* blob_ = nullptr;
+  uint64 blob_size_ = 0;
+
+  ImmutableHashIndex(const ImmutableHashIndex&) = delete;
+  void operator=(const ImmutableHashIndex&) = delete;
+};
+
+}  // namespace lookup
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_IMMUTABLE_HASH_INDEX_H_
@@ -0,0 +1,123 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/immutable_hash_index.h"
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+std::string IndexPath(const std::string& name) {
+  return io::JoinPath(testing::TmpDir(), name);
+}
+
+TEST(ImmutableHashIndexTest, Int64Keys) {
+  const std::string filename = IndexPath("int64_keys");
+  Tensor keys = test::AsTensor<int64_t>({3, 1, 4, 1, 5});
+  Tensor values = test::AsTensor<float>({0.3f, 0.1f, 0.4f, 0.1f, 0.5f});
+  TF_ASSERT_OK(
+      ImmutableHashIndex::Write(Env::Default(), filename, keys, values));
+
+  std::unique_ptr<ImmutableHashIndex> index;
+  TF_ASSERT_OK(ImmutableHashIndex::Open(Env::Default(), filename, &index));
+  EXPECT_EQ(DT_INT64, index->key_dtype());
+  EXPECT_EQ(DT_FLOAT, index->value_dtype());
+  EXPECT_EQ(4, index->size());
+
+  Tensor queries = test::AsTensor<int64_t>({1, 2, 3, 4, 5, -1});
+  Tensor results(DT_FLOAT, TensorShape({6}));
+  TF_ASSERT_OK((index->Find<int64_t, float>(queries.flat<int64_t>(),
+                                            results.flat<float>(), -1.0f)));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0.1f, -1.0f, 0.3f, 0.4f, 0.5f, -1.0f}), results);
+}
+
+TEST(ImmutableHashIndexTest, StringKeysAndValues) {
+  const std::string filename = IndexPath("string_keys");
+  Tensor keys = test::AsTensor<tstring>({"apple", "banana", "", "cherry"});
+  Tensor values = test::AsTensor<tstring>({"red", "yellow", "none", ""});
+  TF_ASSERT_OK(
+      ImmutableHashIndex::Write(Env::Default(), filename, keys, values));
+
+  std::unique_ptr<ImmutableHashIndex> index;
+  TF_ASSERT_OK(ImmutableHashIndex::Open(Env::Default(), filename, &index));
+  EXPECT_EQ(4, index->size());
+
+  Tensor queries = test::AsTensor<tstring>({"cherry", "", "durian", "apple"});
+  Tensor results(DT_STRING, TensorShape({4}));
+  TF_ASSERT_OK((index->Find<tstring, tstring>(queries.flat<tstring>(),
+                                              results.flat<tstring>(), "?")));
+  test::ExpectTensorEqual<tstring>(
+      test::AsTensor<tstring>({"", "none", "?", "red"}), results);
+
+  Tensor exported_keys(DT_STRING, TensorShape({4}));
+  Tensor exported_values(DT_STRING, TensorShape({4}));
+  TF_ASSERT_OK((index->Export<tstring, tstring>(
+      exported_keys.flat<tstring>(), exported_values.flat<tstring>())));
+  for (int i = 0; i < 4; ++i) {
+    Tensor query = test::AsTensor<tstring>({exported_keys.flat<tstring>()(i)});
+    Tensor result(DT_STRING, TensorShape({1}));
+    TF_ASSERT_OK((index->Find<tstring, tstring>(query.flat<tstring>(),
+                                                result.flat<tstring>(), "?")));
+    EXPECT_EQ(exported_values.flat<tstring>()(i), result.flat<tstring>()(0));
+  }
+}
+
+TEST(ImmutableHashIndexTest, ConflictingDuplicateKeys) {
+  Tensor keys = test::AsTensor<int32>({1, 2, 1});
+  Tensor values = test::AsTensor<int32>({10, 20, 30});
+  EXPECT_TRUE(errors::IsFailedPrecondition(ImmutableHashIndex::Write(
+      Env::Default(), IndexPath("duplicates"), keys, values)));
+}
+
+TEST(ImmutableHashIndexTest, RejectsCorruptFiles) {
+  const std::string filename = IndexPath("corrupt");
+  std::unique_ptr<ImmutableHashIndex> index;
+
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, "not an index"));
+  EXPECT_TRUE(errors::IsDataLoss(
+      ImmutableHashIndex::Open(Env::Default(), filename, &index)));
+
+  Tensor keys = test::AsTensor<tstring>({"a", "b"});
+  Tensor values = test::AsTensor<int64_t>({1, 2});
+  TF_ASSERT_OK(
+      ImmutableHashIndex::Write(Env::Default(), filename, keys, values));
+  std::string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), filename, &contents));
+  contents.resize(contents.size() - 1);
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, contents));
+  EXPECT_TRUE(errors::IsDataLoss(
+      ImmutableHashIndex::Open(Env::Default(), filename, &index)));
+}
+
+TEST(ImmutableHashIndexTest, UnsupportedTypes) {
+  Tensor keys = test::AsTensor<float>({1.0f});
+  Tensor values = test::AsTensor<int64_t>({1});
+  EXPECT_TRUE(errors::IsUnimplemented(ImmutableHashIndex::Write(
+      Env::Default(), IndexPath("unsupported"), keys, values)));
+}
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
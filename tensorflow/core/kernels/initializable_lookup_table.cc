@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 
 #include "tensorflow/core/graph/graph_def_builder.h"
+#include "tensorflow/core/kernels/immutable_hash_index.h"
 #include "tensorflow/core/lib/core/errors.h"
 
 namespace tensorflow {
@@ -101,6 +102,56 @@ Status InitializableLookupTable::Initialize(
   return OkStatus();
 }
 
+Status InitializableLookupTable::InitializeFromIndexFile(
+    Env* env, const std::string& filename) {
+  mutex_lock l(mu_);
+  std::unique_ptr<ImmutableHashIndex> index;
+  TF_RETURN_IF_ERROR(ImmutableHashIndex::Open(env, filename, &index));
+  if (index->key_dtype() != key_dtype() ||
+      index->value_dtype() != value_dtype()) {
+    return errors::InvalidArgument(
+        "Conflicting key/value types in hash index file ", filename, ": ",
+        DataTypeString(index->key_dtype()), "->",
+        DataTypeString(index->value_dtype()), " vs. table ",
+        DataTypeString(key_dtype()), "->", DataTypeString(value_dtype()));
+  }
+  if (is_initialized()) {
+    // As for the iterator based initialization, only check that the table
+    // holds as many entries as the index.
+    if (static_cast<size_t>(index->size()) != size()) {
+      return errors::FailedPrecondition(
+          "Table was already initialized with "
+          "different data.");
+    }
+    return OkStatus();
+  }
+  TF_RETURN_IF_ERROR(DoInitializeFromIndex(std::move(index)));
+
+  initializer_serializer_ = std::make_unique<InitializerSerializer>(
+      [filename](GraphDefBuilder* builder, Node* table, Node** out) {
+        Tensor filename_tensor(DT_STRING, TensorShape({}));
+        filename_tensor.scalar<tstring>()() = filename;
+        Node* filename_node =
+            ops::SourceOp("Const", builder->opts()
+                                       .WithAttr("dtype", DT_STRING)
+                                       .WithAttr("value", filename_tensor));
+        Node* init_table =
+            ops::BinaryOp("InitializeTableFromIndexFileV2", table,
+                          filename_node, builder->opts());
+        *out = ops::UnaryOp("Identity", table,
+                            builder->opts().WithControlInput(init_table));
+        return OkStatus();
+      });
+  is_initialized_.store(true, std::memory_order_release);
+  return OkStatus();
+}
+
+Status InitializableLookupTable::DoInitializeFromIndex(
+    std::unique_ptr<ImmutableHashIndex> index) {
+  return errors::Unimplemented(
+      "Initialization from a hash index file is not supported by this table");
+}
+
 Status InitializableLookupTable::AreEntriesSame(const InitTableIterator& iter,
                                                 bool* result) {
   *result = static_cast<size_t>(iter.total_size()) == size();
@@ -17,13 +17,18 @@ limitations under the License.
 #define TENSORFLOW_CORE_KERNELS_INITIALIZABLE_LOOKUP_TABLE_H_
 
 #include <atomic>
+#include <memory>
+#include <string>
 
 #include "tensorflow/core/framework/lookup_interface.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/macros.h"
 
 namespace tensorflow {
 namespace lookup {
 
+class ImmutableHashIndex;
+
 // Base class for lookup tables that require initialization.
 class InitializableLookupTable : public LookupInterface {
  public:
@@ -100,6 +105,20 @@ class InitializableLookupTable : public LookupInterface {
   Status Initialize(InitTableIterator& iter,
                     std::unique_ptr<InitializerSerializer> serializer);
 
+  // Initializes the table by memory-mapping the prebuilt hash index in
+  // `filename` (see ImmutableHashIndex). The entries are served directly from
+  // the mapped file instead of being copied into the table.
+  //
+  // Returns the following statuses:
+  // - OK: when the initialization was successful.
+  // - InvalidArgument: if the key or value type of the index does not match
+  //   the table.
+  // - FailedPrecondition: if the table is already initialized with a different
+  //   number of entries.
+  // - Unimplemented: if the table does not support serving from an index.
+  // - In addition, errors opening or validating the index file.
+  Status InitializeFromIndexFile(Env* env, const std::string& filename);
+
   // Basic iterator to initialize lookup tables.
   // It yields a sequence of pairs of `keys()` and `values()` Tensors, so that
   // the consumer may insert key-value pairs in batches.
@@ -201,6 +220,11 @@ class InitializableLookupTable : public LookupInterface {
 
   virtual Status AreEntriesSame(const InitTableIterator& iter, bool* result);
 
+  // Makes the table serve its entries from `index`, whose key and value types
+  // match the table. Returns errors::Unimplemented by default.
+  virtual Status DoInitializeFromIndex(
+      std::unique_ptr<ImmutableHashIndex> index);
+
   mutex mu_;
 
  protected:
@@ -15,16 +15,22 @@ limitations under the License.
 
 // Tests kernels of lookup ops.
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -100,5 +106,116 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+// Number of keys looked up per LookupTableFindV2 call in the benchmarks below.
+constexpr int64_t kDenseHashTableLookups = 1 << 17;
+
+template <typename K>
+K BenchmarkKey(int64_t i);
+
+template <>
+int64_t BenchmarkKey<int64_t>(int64_t i) {
+  return i;
+}
+
+template <>
+tstring BenchmarkKey<tstring>(int64_t i) {
+  return strings::StrCat("feature_", i);
+}
+
+template <typename K>
+Tensor BenchmarkKeys(const std::vector<int64_t>& ids) {
+  Tensor keys(DataTypeToEnum<K>::value,
+              TensorShape({static_cast<int64_t>(ids.size())}));
+  auto keys_flat = keys.flat<K>();
+  for (int64_t i = 0; i < ids.size(); ++i) {
+    keys_flat(i) = BenchmarkKey<K>(ids[i]);
+  }
+  return keys;
+}
+
+template <typename K>
+Node* DenseHashTable(Graph* g, int64_t num_buckets) {
+  Tensor empty_key(DataTypeToEnum<K>::value, TensorShape({}));
+  empty_key.scalar<K>()() = BenchmarkKey<K>(-1);
+  Tensor deleted_key(DataTypeToEnum<K>::value, TensorShape({}));
+  deleted_key.scalar<K>()() = BenchmarkKey<K>(-2);
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableDenseHashTableV2")
+                  .Input(test::graph::Constant(g, empty_key))
+                  .Input(test::graph::Constant(g, deleted_key))
+                  .Attr("shared_name", "dense_hash_table_benchmark")
+                  .Attr("key_dtype", DataTypeToEnum<K>::value)
+                  .Attr("value_dtype", DT_INT64)
+                  .Attr("initial_num_buckets", num_buckets)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+// Builds an init graph that fills a MutableDenseHashTableV2 with
+// `num_entries` keys, and a graph that looks up kDenseHashTableLookups random
+// keys, about half of which are present.
+template <typename K>
+void DenseHashTableFind(int64_t num_entries, Graph** init_g, Graph** run_g) {
+  int64_t num_buckets = 4;
+  while (num_entries > num_buckets * 0.8) num_buckets <<= 1;
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    std::vector<int64_t> ids(num_entries);
+    Tensor values(DT_INT64, TensorShape({num_entries}));
+    for (int64_t i = 0; i < num_entries; ++i) {
+      ids[i] = i;
+      values.flat<int64_t>()(i) = i;
+    }
+    TF_CHECK_OK(NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+                    .Input(DenseHashTable<K>(g, num_buckets))
+                    .Input(test::graph::Constant(g, BenchmarkKeys<K>(ids)))
+                    .Input(test::graph::Constant(g, values))
+                    .Finalize(g, nullptr));
+    *init_g = g;
+  }
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    random::PhiloxRandom philox(301, 17);
+    random::SimplePhilox rnd(&philox);
+    std::vector<int64_t> ids(kDenseHashTableLookups);
+    for (int64_t i = 0; i < kDenseHashTableLookups; ++i) {
+      ids[i] = rnd.Uniform64(2 * num_entries);
+    }
+    Tensor default_value(DT_INT64, TensorShape({}));
+    default_value.scalar<int64_t>()() = -1;
+    TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                    .Input(DenseHashTable<K>(g, num_buckets))
+                    .Input(test::graph::Constant(g, BenchmarkKeys<K>(ids)))
+                    .Input(test::graph::Constant(g, default_value))
+                    .Finalize(g, nullptr));
+    *run_g = g;
+  }
+}
+
+template <typename K>
+void BM_DenseHashTableFind(::testing::benchmark::State& state) {
+  const int64_t num_entries = state.range(0);
+  Graph* init;
+  Graph* run;
+  DenseHashTableFind<K>(num_entries, &init, &run);
+  test::Benchmark("cpu", run, /*options=*/nullptr, init, /*rendez=*/nullptr,
+                  /*executor_type=*/"", /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kDenseHashTableLookups);
+}
+
+BENCHMARK_TEMPLATE(BM_DenseHashTableFind, int64_t)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20)
+    ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_DenseHashTableFind, tstring)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+
 }  // namespace
 }  // namespace tensorflow
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
+#include "tensorflow/core/kernels/immutable_hash_index.h"
 #include "tensorflow/core/kernels/lookup_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -198,4 +199,79 @@ REGISTER_KERNEL_BUILDER(Name("InitializeTableFromTextFile").Device(DEVICE_CPU),
 REGISTER_KERNEL_BUILDER(
     Name("InitializeTableFromTextFileV2").Device(DEVICE_CPU),
     InitializeTableFromTextFileOp);
+
+// Kernel to initialize a lookup table from a prebuilt hash index file, which
+// is memory-mapped and served in place.
+//
+// After this operation, the table becomes read-only.
+class InitializeTableFromIndexFileOp : public OpKernel {
+ public:
+  explicit InitializeTableFromIndexFileOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    mutex_lock l(mu_);
+    lookup::InitializableLookupTable* table;
+    OP_REQUIRES_OK(ctx,
+                   GetInitializableLookupTable("table_handle", ctx, &table));
+    core::ScopedUnref unref_me(table);
+
+    DataTypeVector expected_inputs = {DT_RESOURCE, DT_STRING};
+    DataTypeVector expected_outputs = {};
+    OP_REQUIRES_OK(ctx, ctx->MatchSignature(expected_inputs, expected_outputs));
+
+    const Tensor& filename_tensor = ctx->input(1);
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsScalar(filename_tensor.shape()),
+        errors::InvalidArgument("filename should be a single string, but got ",
+                                filename_tensor.shape().DebugString()));
+    const string& filename = filename_tensor.scalar<tstring>()();
+    OP_REQUIRES(ctx, !filename.empty(),
+                errors::InvalidArgument("filename cannot be empty."));
+
+    OP_REQUIRES_OK(ctx, table->InitializeFromIndexFile(ctx->env(), filename));
+  }
+
+ private:
+  mutex mu_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("InitializeTableFromIndexFileV2").Device(DEVICE_CPU),
+    InitializeTableFromIndexFileOp);
+
+// Kernel to build a hash index file from key and value tensors, to be loaded
+// later with InitializeTableFromIndexFileV2.
+class WriteHashTableIndexFileOp : public OpKernel {
+ public:
+  explicit WriteHashTableIndexFileOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor& filename_tensor = ctx->input(0);
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsScalar(filename_tensor.shape()),
+        errors::InvalidArgument("filename should be a single string, but got ",
+                                filename_tensor.shape().DebugString()));
+    const string& filename = filename_tensor.scalar<tstring>()();
+    OP_REQUIRES(ctx, !filename.empty(),
+                errors::InvalidArgument("filename cannot be empty."));
+
+    const Tensor& keys = ctx->input(1);
+    const Tensor& values = ctx->input(2);
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(keys.shape()),
+        errors::InvalidArgument("Keys must be a vector, but received shape",
+                                keys.shape().DebugString()));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(values.shape()),
+        errors::InvalidArgument("Values must be a vector, but received shape",
+                                values.shape().DebugString()));
+    OP_REQUIRES_OK(ctx, lookup::ImmutableHashIndex::Write(ctx->env(), filename,
+                                                          keys, values));
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("WriteHashTableIndexFile").Device(DEVICE_CPU),
+                        WriteHashTableIndexFileOp);
 }  // namespace tensorflow
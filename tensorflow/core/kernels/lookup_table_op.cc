@@ -16,10 +16,18 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "absl/base/prefetch.h"
+#include "absl/numeric/bits.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
@@ -36,11 +44,185 @@ std::string UniqueNodeName(const std::string& base) {
   return strings::StrCat(base, "/", counter.fetch_add(1), "/", random::New64());
 }
 
+namespace {
+
+template <typename T>
+inline uint64 HashScalar(const T& key) {
+  return static_cast<uint64>(key);
+}
+
+inline uint64 HashScalar(const tstring& key) { return Hash64(key); }
+
+// Returns the value of the optional "num_shards" attr of `kernel`, or 1 if the
+// op does not define it (e.g. the legacy ref-typed table ops). The op
+// definitions constrain the attr to be at least 1.
+int64_t GetNumShards(OpKernel* kernel) {
+  int64_t num_shards = 1;
+  TryGetNodeAttr(kernel->def(), "num_shards", &num_shards);
+  return std::max<int64_t>(num_shards, 1);
+}
+
+// Sets the "num_shards" attr in `opts` only for sharded tables, so that the
+// graphs of unsharded tables can still be loaded by binaries without the attr.
+GraphDefBuilder::Options WithNumShards(const GraphDefBuilder::Options& opts,
+                                       int64_t num_shards) {
+  return num_shards == 1 ? opts : opts.WithAttr("num_shards", num_shards);
+}
+
+}  // namespace
+
+// A hash map whose keys are partitioned across `num_shards` independently
+// locked std::unordered_maps. Readers and writers touching different shards
+// never contend, and batched accesses take each shard lock at most once.
+//
+// With a single shard this behaves exactly like one unordered_map guarded by
+// one reader/writer mutex.
+template <class K, class Mapped>
+class ShardedHashMap {
+ public:
+  typedef std::unordered_map<K, Mapped> Map;
+
+  explicit ShardedHashMap(int64_t num_shards)
+      : num_shards_(num_shards), shards_(num_shards) {}
+
+  int64_t num_shards() const { return num_shards_; }
+
+  size_t size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      total += shard.map.size();
+    }
+    return total;
+  }
+
+  // Calls `fn(map, i)` for each `i` in [0, n), where `map` is the shard that
+  // owns `key(i)`, holding that shard's lock in shared mode. Indices are
+  // visited grouped by shard, in increasing order within each shard.
+  template <typename KeyFn, typename Fn>
+  void VisitShared(int64_t n, const KeyFn& key, const Fn& fn) const {
+    if (num_shards_ == 1) {
+      const Shard& shard = shards_[0];
+      tf_shared_lock l(shard.mu);
+      for (int64_t i = 0; i < n; ++i) fn(shard.map, i);
+      return;
+    }
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    GroupByShard(n, key, &order, &offsets);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      const Shard& shard = shards_[s];
+      tf_shared_lock l(shard.mu);
+      for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+        fn(shard.map, order[j]);
+      }
+    }
+  }
+
+  // Like VisitShared, but holds each shard lock exclusively and passes a
+  // mutable map. Since the relative order of indices within a shard is
+  // preserved, repeated keys in one batch keep last-writer-wins semantics.
+  template <typename KeyFn, typename Fn>
+  void VisitExclusive(int64_t n, const KeyFn& key, const Fn& fn) {
+    if (num_shards_ == 1) {
+      Shard& shard = shards_[0];
+      mutex_lock l(shard.mu);
+      for (int64_t i = 0; i < n; ++i) fn(&shard.map, i);
+      return;
+    }
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    GroupByShard(n, key, &order, &offsets);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      Shard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+        fn(&shard.map, order[j]);
+      }
+    }
+  }
+
+  // Calls `fn(maps)` while holding every shard lock in shared mode, so `fn`
+  // observes a consistent snapshot of the whole table. Used for export and
+  // serialization, which must agree on the total number of entries.
+  template <typename Fn>
+  Status WithAllShardsShared(const Fn& fn) const TF_NO_THREAD_SAFETY_ANALYSIS {
+    std::vector<const Map*> maps;
+    maps.reserve(num_shards_);
+    for (const Shard& shard : shards_) {
+      shard.mu.lock_shared();
+      maps.push_back(&shard.map);
+    }
+    Status s = fn(maps);
+    for (auto it = shards_.rbegin(); it != shards_.rend(); ++it) {
+      it->mu.unlock_shared();
+    }
+    return s;
+  }
+
+  // Calls `fn(maps)` while holding every shard lock exclusively.
+  template <typename Fn>
+  Status WithAllShardsExclusive(const Fn& fn) TF_NO_THREAD_SAFETY_ANALYSIS {
+    std::vector<Map*> maps;
+    maps.reserve(num_shards_);
+    for (Shard& shard : shards_) {
+      shard.mu.lock();
+      maps.push_back(&shard.map);
+    }
+    Status s = fn(maps);
+    for (auto it = shards_.rbegin(); it != shards_.rend(); ++it) {
+      it->mu.unlock();
+    }
+    return s;
+  }
+
+  int64_t ShardOf(const K& key) const {
+    // Integral keys hash to themselves, so mix the bits before reducing to
+    // avoid mapping strided ids onto the same shard.
+    return ((HashScalar(key) * 0x9E3779B97F4A7C15ULL) >> 32) % num_shards_;
+  }
+
+ private:
+  struct Shard {
+    mutable mutex mu;
+    Map map TF_GUARDED_BY(mu);
+  };
+
+  // Computes a stable permutation `order` of [0, n) sorted by shard, such that
+  // the indices of shard `s` are order[offsets[s]] ... order[offsets[s+1]-1].
+  template <typename KeyFn>
+  void GroupByShard(int64_t n, const KeyFn& key, std::vector<int64_t>* order,
+                    std::vector<int64_t>* offsets) const {
+    std::vector<int64_t> shard_ids(n);
+    offsets->assign(num_shards_ + 1, 0);
+    for (int64_t i = 0; i < n; ++i) {
+      shard_ids[i] = ShardOf(key(i));
+      ++(*offsets)[shard_ids[i] + 1];
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      (*offsets)[s + 1] += (*offsets)[s];
+    }
+    std::vector<int64_t> next(offsets->begin(), offsets->end() - 1);
+    order->resize(n);
+    for (int64_t i = 0; i < n; ++i) {
+      (*order)[next[shard_ids[i]]++] = i;
+    }
+  }
+
+  const int64_t num_shards_;
+  std::vector<Shard> shards_;
+};
+
 // Lookup table that wraps an unordered_map, where the key and value data type
 // is specified. Each individual value must be a scalar. If vector values are
 // required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// If the op sets `num_shards` > 1, keys are partitioned across that many
+// independently locked maps to reduce lock contention between concurrent
+// lookups and inserts.
 //
 // Sample use case:
 //
@@ -53,12 +235,10 @@ std::string UniqueNodeName(const std::string& base) {
 template <class K, class V>
 class MutableHashTableOfScalars final : public LookupInterface {
  public:
-  MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
+  MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel)
+      : table_(GetNumShards(kernel)) {}
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -70,18 +250,20 @@ class MutableHashTableOfScalars final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      // is_full_size_default is true:
-      //   Each key has an independent default value, key_values(i)
-      //   corresponding uses default_flat(i) as its default value.
-      //
-      // is_full_size_default is false:
-      //   All keys will share the default_flat(0) as default value.
-      value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyIfIntegral(key_values(i)),
-          is_full_size_default ? default_flat(i) : default_flat(0));
-    }
+    table_.VisitShared(
+        key_values.size(),
+        [&](int64_t i) -> const K& { return key_values(i); },
+        [&](const Map& map, int64_t i) {
+          // is_full_size_default is true:
+          //   Each key has an independent default value, key_values(i)
+          //   corresponding uses default_flat(i) as its default value.
+          //
+          // is_full_size_default is false:
+          //   All keys will share the default_flat(0) as default value.
+          value_values(i) = gtl::FindWithDefault(
+              map, SubtleMustCopyIfIntegral(key_values(i)),
+              is_full_size_default ? default_flat(i) : default_flat(0));
+        });
 
     return OkStatus();
   }
@@ -90,14 +272,26 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
     if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          SubtleMustCopyIfIntegral(value_values(i)));
+      return table_.WithAllShardsExclusive([&](const std::vector<Map*>& maps) {
+        for (Map* map : maps) {
+          map->clear();
+        }
+        for (int64_t i = 0; i < key_values.size(); ++i) {
+          const K key = SubtleMustCopyIfIntegral(key_values(i));
+          gtl::InsertOrUpdate(maps[table_.ShardOf(key)], key,
+                              SubtleMustCopyIfIntegral(value_values(i)));
+        }
+        return OkStatus();
+      });
     }
+    table_.VisitExclusive(
+        key_values.size(),
+        [&](int64_t i) -> const K& { return key_values(i); },
+        [&](Map* map, int64_t i) {
+          gtl::InsertOrUpdate(map, SubtleMustCopyIfIntegral(key_values(i)),
+                              SubtleMustCopyIfIntegral(value_values(i)));
+        });
     return OkStatus();
   }
 
@@ -109,10 +303,12 @@ class MutableHashTableOfScalars final : public LookupInterface {
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.VisitExclusive(
+        key_values.size(),
+        [&](int64_t i) -> const K& { return key_values(i); },
+        [&](Map* map, int64_t i) {
+          map->erase(SubtleMustCopyIfIntegral(key_values(i)));
+        });
     return OkStatus();
   }
 
@@ -122,17 +318,18 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("values", TensorShape({size}), &values));
-    ExportKeysAndValues(keys, values);
-    return OkStatus();
+    return table_.WithAllShardsShared([&](const std::vector<const Map*>& maps) {
+      int64_t size = TotalSize(maps);
+
+      Tensor* keys;
+      Tensor* values;
+      TF_RETURN_IF_ERROR(
+          ctx->allocate_output("keys", TensorShape({size}), &keys));
+      TF_RETURN_IF_ERROR(
+          ctx->allocate_output("values", TensorShape({size}), &values));
+      ExportKeysAndValues(maps, keys, values);
+      return OkStatus();
+    });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -145,24 +342,33 @@ class MutableHashTableOfScalars final : public LookupInterface {
 
   int64_t MemoryUsed() const override {
     int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
+    table_.WithAllShardsShared([&](const std::vector<const Map*>& maps) {
+      for (const Map* map : maps) {
+        for (unsigned i = 0; i < map->bucket_count(); ++i) {
+          size_t bucket_size = map->bucket_size(i);
+          if (bucket_size == 0) {
+            ret++;
+          } else {
+            ret += bucket_size;
+          }
+        }
       }
-    }
+      return OkStatus();
+    }).IgnoreError();
     return sizeof(MutableHashTableOfScalars) + ret;
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    TF_RETURN_IF_ERROR(
+        table_.WithAllShardsShared([&](const std::vector<const Map*>& maps) {
+          int64_t size = TotalSize(maps);
+          keys = Tensor(key_dtype(), TensorShape({size}));
+          values = Tensor(value_dtype(), TensorShape({size}));
+          ExportKeysAndValues(maps, &keys, &values);
+          return OkStatus();
+        }));
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableV2 kernel. This means that the lifetime
@@ -172,11 +378,13 @@ class MutableHashTableOfScalars final : public LookupInterface {
     // earlier when appropriate.
     Node* table = ops::SourceOp(
         "MutableHashTableV2",
-        builder->opts()
-            .WithName(UniqueNodeName("MutableHashTableFromGraphDef"))
-            .WithAttr("use_node_name_sharing", true)
-            .WithAttr("key_dtype", key_dtype())
-            .WithAttr("value_dtype", value_dtype()));
+        WithNumShards(
+            builder->opts()
+                .WithName(UniqueNodeName("MutableHashTableFromGraphDef"))
+                .WithAttr("use_node_name_sharing", true)
+                .WithAttr("key_dtype", key_dtype())
+                .WithAttr("value_dtype", value_dtype()),
+            table_.num_shards()));
     Node* keys_node = ops::SourceOp(
         "Const",
         builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
@@ -195,21 +403,32 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef typename ShardedHashMap<K, V>::Map Map;
+
+  static int64_t TotalSize(const std::vector<const Map*>& maps) {
+    int64_t size = 0;
+    for (const Map* map : maps) {
+      size += map->size();
+    }
+    return size;
+  }
+
+  // Writes all keys and values into `keys` and `values`, shard by shard.
+  // `keys` and `values` must point to tensors of size `TotalSize(maps)`.
+  void ExportKeysAndValues(const std::vector<const Map*>& maps, Tensor* keys,
+                           Tensor* values) const {
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
+    for (const Map* map : maps) {
+      for (auto it = map->begin(); it != map->end(); ++it, ++i) {
+        keys_data(i) = it->first;
+        values_data(i) = it->second;
+      }
     }
   }
 
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, V> table_;
 };
 
 // Lookup table that wraps an unordered_map. Behaves identical to
@@ -217,7 +436,8 @@ class MutableHashTableOfScalars final : public LookupInterface {
 template <class K, class V>
 class MutableHashTableOfTensors final : public LookupInterface {
  public:
-  MutableHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel) {
+  MutableHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel)
+      : table_(GetNumShards(kernel)) {
     OP_REQUIRES_OK(ctx,
                    GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
     OP_REQUIRES(
@@ -226,10 +446,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
                                 value_shape_.DebugString()));
   }
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -242,27 +459,29 @@ class MutableHashTableOfTensors final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec =
-          gtl::FindOrNull(table_, SubtleMustCopyIfIntegral(key_values(i)));
-      if (value_vec != nullptr) {
-        for (int64_t j = 0; j < value_dim; j++) {
-          value_values(i, j) = value_vec->at(j);
-        }
-      } else {
-        // is_full_size_default is true:
-        //   Each key has an independent default value, key_values(i)
-        //   corresponding uses default_flat(i) as its default value.
-        //
-        // is_full_size_default is false:
-        //   All keys will share the default_flat(0) as default value.
-        for (int64_t j = 0; j < value_dim; j++) {
-          value_values(i, j) =
-              is_full_size_default ? default_flat(i, j) : default_flat(0, j);
-        }
-      }
-    }
+    table_.VisitShared(
+        key_values.size(),
+        [&](int64_t i) -> const K& { return key_values(i); },
+        [&](const Map& map, int64_t i) {
+          const ValueArray* value_vec =
+              gtl::FindOrNull(map, SubtleMustCopyIfIntegral(key_values(i)));
+          if (value_vec != nullptr) {
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(i, j) = value_vec->at(j);
+            }
+          } else {
+            // is_full_size_default is true:
+            //   Each key has an independent default value, key_values(i)
+            //   corresponding uses default_flat(i) as its default value.
+            //
+            // is_full_size_default is false:
+            //   All keys will share the default_flat(0) as default value.
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(i, j) = is_full_size_default ? default_flat(i, j)
+                                                        : default_flat(0, j);
+            }
+          }
+        });
 
     return OkStatus();
   }
@@ -272,19 +491,34 @@ class MutableHashTableOfTensors final : public LookupInterface {
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64_t value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
+    auto make_value = [&](int64_t i) {
       ValueArray value_vec;
       for (int64_t j = 0; j < value_dim; j++) {
         V value = value_values(i, j);
         value_vec.push_back(value);
       }
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          value_vec);
+      return value_vec;
+    };
+
+    if (clear) {
+      return table_.WithAllShardsExclusive([&](const std::vector<Map*>& maps) {
+        for (Map* map : maps) {
+          map->clear();
+        }
+        for (int64_t i = 0; i < key_values.size(); ++i) {
+          const K key = SubtleMustCopyIfIntegral(key_values(i));
+          gtl::InsertOrUpdate(maps[table_.ShardOf(key)], key, make_value(i));
+        }
+        return OkStatus();
+      });
     }
+    table_.VisitExclusive(
+        key_values.size(),
+        [&](int64_t i) -> const K& { return key_values(i); },
+        [&](Map* map, int64_t i) {
+          gtl::InsertOrUpdate(map, SubtleMustCopyIfIntegral(key_values(i)),
+                              make_value(i));
+        });
     return OkStatus();
   }
 
@@ -296,10 +530,12 @@ class MutableHashTableOfTensors final : public LookupInterface {
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.VisitExclusive(
+        key_values.size(),
+        [&](int64_t i) -> const K& { return key_values(i); },
+        [&](Map* map, int64_t i) {
+          map->erase(SubtleMustCopyIfIntegral(key_values(i)));
+        });
     return OkStatus();
   }
 
@@ -309,18 +545,19 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    int64_t value_dim = value_shape_.dim_size(0);
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(ctx->allocate_output(
-        "values", TensorShape({size, value_dim}), &values));
-    ExportKeysAndValues(keys, values);
-    return OkStatus();
+    return table_.WithAllShardsShared([&](const std::vector<const Map*>& maps) {
+      int64_t size = TotalSize(maps);
+      int64_t value_dim = value_shape_.dim_size(0);
+
+      Tensor* keys;
+      Tensor* values;
+      TF_RETURN_IF_ERROR(
+          ctx->allocate_output("keys", TensorShape({size}), &keys));
+      TF_RETURN_IF_ERROR(ctx->allocate_output(
+          "values", TensorShape({size, value_dim}), &values));
+      ExportKeysAndValues(maps, keys, values);
+      return OkStatus();
+    });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -333,24 +570,34 @@ class MutableHashTableOfTensors final : public LookupInterface {
 
   int64_t MemoryUsed() const override {
     int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
+    table_.WithAllShardsShared([&](const std::vector<const Map*>& maps) {
+      for (const Map* map : maps) {
+        for (unsigned i = 0; i < map->bucket_count(); ++i) {
+          size_t bucket_size = map->bucket_size(i);
+          if (bucket_size == 0) {
+            ret++;
+          } else {
+            ret += bucket_size;
+          }
+        }
       }
-    }
+      return OkStatus();
+    }).IgnoreError();
     return sizeof(MutableHashTableOfTensors) + ret;
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    TF_RETURN_IF_ERROR(
+        table_.WithAllShardsShared([&](const std::vector<const Map*>& maps) {
+          int64_t size = TotalSize(maps);
+          keys = Tensor(key_dtype(), TensorShape({size}));
+          values = Tensor(value_dtype(),
+                          TensorShape({size, value_shape_.dim_size(0)}));
+          ExportKeysAndValues(maps, &keys, &values);
+          return OkStatus();
+        }));
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableOfTensorsV2 kernel. This means that the
@@ -358,14 +605,15 @@ class MutableHashTableOfTensors final : public LookupInterface {
     // manager it is created in.
     // TODO(b/181695913): Provide a mechanism for deleting this resource
     // earlier when appropriate.
-    Node* table =
-        ops::SourceOp("MutableHashTableOfTensorsV2",
-                      builder->opts()
+    Node* table = ops::SourceOp(
+        "MutableHashTableOfTensorsV2",
+        WithNumShards(builder->opts()
                           .WithName(UniqueNodeName("MutableHashTableOfTensors"))
                           .WithAttr("use_node_name_sharing", true)
                           .WithAttr("key_dtype", key_dtype())
                           .WithAttr("value_dtype", value_dtype())
-                          .WithAttr("value_shape", value_shape_));
+                          .WithAttr("value_shape", value_shape_),
+                      table_.num_shards()));
     Node* keys_node = ops::SourceOp(
         "Const",
         builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
@@ -384,39 +632,43 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+  typedef typename ShardedHashMap<K, ValueArray>::Map Map;
+
+  static int64_t TotalSize(const std::vector<const Map*>& maps) {
+    int64_t size = 0;
+    for (const Map* map : maps) {
+      size += map->size();
+    }
+    return size;
+  }
+
+  // Writes all keys and values into `keys` and `values`, shard by shard.
+  // `keys` and `values` must point to tensors of size `TotalSize(maps)`.
+  void ExportKeysAndValues(const std::vector<const Map*>& maps, Tensor* keys,
+                           Tensor* values) const {
     int64_t value_dim = value_shape_.dim_size(0);
     auto keys_data = keys->flat<K>();
     auto values_data = values->matrix<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      K key = it->first;
-      ValueArray value = it->second;
-      keys_data(i) = key;
-      for (int64_t j = 0; j < value_dim; j++) {
-        values_data(i, j) = value[j];
+    for (const Map* map : maps) {
+      for (auto it = map->begin(); it != map->end(); ++it, ++i) {
+        K key = it->first;
+        const ValueArray& value = it->second;
+        keys_data(i) = key;
+        for (int64_t j = 0; j < value_dim; j++) {
+          values_data(i, j) = value[j];
+        }
       }
     }
   }
 
   TensorShape value_shape_;
-  mutable mutex mu_;
-  typedef gtl::InlinedVector<V, 4> ValueArray;
-  std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, ValueArray> table_;
 };
 
 namespace {
 
-template <typename T>
-inline uint64 HashScalar(const T& key) {
-  return static_cast<uint64>(key);
-}
-
-inline uint64 HashScalar(const tstring& key) { return Hash64(key); }
-
 // If the given shape is a scalar return {1} instead. Otherwise leave it alone.
 TensorShape MaybeVectorizeShape(const TensorShape& shape) {
   if (shape.dims() == 0) {
@@ -425,9 +677,90 @@ TensorShape MaybeVectorizeShape(const TensorShape& shape) {
   return shape;
 }
 
+// Control bytes used by MutableDenseHashTable, one per bucket. A full bucket
+// stores the low 7 bits of its key's hash (0..127); the special states all
+// have the sign bit set so they never match a hash tag.
+constexpr int8_t kCtrlEmpty = -128;
+constexpr int8_t kCtrlDeleted = -2;
+// Pads the control array of tables with fewer than kCtrlGroupWidth buckets.
+constexpr int8_t kCtrlSentinel = -1;
+
+// Number of control bytes inspected at once during probing.
+constexpr int64_t kCtrlGroupWidth = 16;
+
+// Number of keys ahead of the current one whose buckets are prefetched by the
+// batched lookup.
+constexpr int64_t kFindPrefetchDistance = 16;
+
+// Spreads the bits of a key hash. Integral keys hash to themselves, which
+// would otherwise put runs of consecutive ids into the same probe group.
+inline uint64 MixHash(uint64 hash) {
+  hash *= 0x9E3779B97F4A7C15ULL;
+  return hash ^ (hash >> 32);
+}
+
+// A group of kCtrlGroupWidth consecutive control bytes. Match* return a bit
+// mask with bit `i` set if the `i`th control byte of the group satisfies the
+// predicate.
+class CtrlGroup {
+ public:
+  explicit CtrlGroup(const int8_t* ctrl)
+#if defined(__SSE2__)
+      : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {
+  }
+#else
+      : ctrl_(ctrl) {
+  }
+#endif
+
+  uint32 Match(int8_t h2) const {
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_));
+#else
+    uint32 mask = 0;
+    for (int64_t i = 0; i < kCtrlGroupWidth; ++i) {
+      mask |= static_cast<uint32>(ctrl_[i] == h2) << i;
+    }
+    return mask;
+#endif
+  }
+
+  uint32 MatchEmpty() const { return Match(kCtrlEmpty); }
+
+  uint32 MatchEmptyOrDeleted() const {
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(
+        _mm_cmpgt_epi8(_mm_set1_epi8(kCtrlSentinel), ctrl_));
+#else
+    uint32 mask = 0;
+    for (int64_t i = 0; i < kCtrlGroupWidth; ++i) {
+      mask |= static_cast<uint32>(ctrl_[i] < kCtrlSentinel) << i;
+    }
+    return mask;
+#endif
+  }
+
+ private:
+#if defined(__SSE2__)
+  __m128i ctrl_;
+#else
+  const int8_t* ctrl_;
+#endif
+};
+
 }  // namespace
 
 // Modeled after densehashtable in https://github.com/sparsehash/sparsehash
+//
+// Keys and values live in `key_buckets_` and `value_buckets_`: unused buckets
+// hold `empty_key_` and removed ones `deleted_key_`. The exported (and
+// checkpointed) tensors have the same format, but lay the entries out in the
+// quadratic probing order of earlier versions of the table. In addition, a
+// Swiss-table style array of control bytes records the state and a 7 bit hash
+// tag for every bucket. Probing scans the control bytes a group of 16 at a
+// time (using SSE2 where available) and only touches the key tensor for
+// buckets whose tag matches, which keeps lookups of large batches from being
+// dominated by cache misses on the key data.
 template <class K, class V>
 class MutableDenseHashTable final : public LookupInterface {
  public:
@@ -512,51 +845,34 @@ class MutableDenseHashTable final : public LookupInterface {
     auto value_matrix = value->shaped<V, 2>({num_elements, value_size});
     const auto default_flat = default_value.flat<V>();
 
+    // Hash the whole batch up front so that the buckets of upcoming keys can
+    // be prefetched while earlier keys are being probed.
+    std::vector<uint64> hashes(num_elements);
+    for (int64_t i = 0; i < num_elements; ++i) {
+      TF_RETURN_IF_ERROR(CheckKey(key_matrix, i, &hashes[i]));
+    }
+
     tf_shared_lock l(mu_);
     const auto key_buckets_matrix = key_buckets_.template matrix<K>();
     const auto value_buckets_matrix = value_buckets_.template matrix<V>();
-    const auto empty_key_matrix =
-        empty_key_.template shaped<K, 2>({1, key_size});
-    const auto deleted_key_matrix =
-        deleted_key_.template shaped<K, 2>({1, key_size});
-    const int64_t bit_mask = num_buckets_ - 1;
     // TODO(andreasst): parallelize using work_sharder
     for (int64_t i = 0; i < num_elements; ++i) {
-      const uint64 key_hash = HashKey(key_matrix, i);
-      if (empty_key_hash_ == key_hash &&
-          IsEqualKey(empty_key_matrix, 0, key_matrix, i)) {
-        return errors::InvalidArgument(
-            "Using the empty_key as a table key is not allowed");
-      }
-      if (deleted_key_hash_ == key_hash &&
-          IsEqualKey(deleted_key_matrix, 0, key_matrix, i)) {
-        return errors::InvalidArgument(
-            "Using the deleted_key as a table key is not allowed");
+      if (i + kFindPrefetchDistance < num_elements) {
+        PrefetchGroup(hashes[i + kFindPrefetchDistance]);
       }
-      int64_t bucket_index = key_hash & bit_mask;
-      int64_t num_probes = 0;
-      while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
-          for (int64_t j = 0; j < value_size; ++j) {
-            // TODO(andreasst): check if we can get rid of SubtleMustCopy
-            // here and elsewhere in this file.
-            value_matrix(i, j) =
-                SubtleMustCopyIfIntegral(value_buckets_matrix(bucket_index, j));
-          }
-          break;
-        }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_matrix, 0)) {
-          for (int64_t j = 0; j < value_size; ++j) {
-            value_matrix(i, j) = SubtleMustCopyIfIntegral(default_flat(j));
-          }
-          break;
+      int64_t bucket_index;
+      TF_RETURN_IF_ERROR(FindBucket(key_buckets_matrix, key_matrix, i,
+                                    hashes[i], &bucket_index));
+      if (bucket_index >= 0) {
+        for (int64_t j = 0; j < value_size; ++j) {
+          // TODO(andreasst): check if we can get rid of SubtleMustCopy
+          // here and elsewhere in this file.
+          value_matrix(i, j) =
+              SubtleMustCopyIfIntegral(value_buckets_matrix(bucket_index, j));
         }
-        ++num_probes;
-        bucket_index =
-            (bucket_index + num_probes) & bit_mask;  // quadratic probing
-        if (num_probes >= num_buckets_) {
-          return errors::Internal(
-              "Internal error in MutableDenseHashTable lookup");
+      } else {
+        for (int64_t j = 0; j < value_size; ++j) {
+          value_matrix(i, j) = SubtleMustCopyIfIntegral(default_flat(j));
         }
       }
     }
@@ -605,31 +921,91 @@ class MutableDenseHashTable final : public LookupInterface {
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override TF_LOCKS_EXCLUDED(mu_) {
     mutex_lock l(mu_);
-    num_buckets_ = keys.dim_size(0);
-    key_buckets_ = keys;
-    value_buckets_ = values;
-    // Count the number of keys that are not the empty_key or deleted_key.
-    // This requires iterating through the whole table but that is OK as we
-    // only execute it during checkpoint restore.
-    num_entries_ = 0;
-    const auto empty_key_tensor =
-        empty_key_.template shaped<K, 2>({1, key_shape_.num_elements()});
-    const auto deleted_key_tensor =
-        deleted_key_.template shaped<K, 2>({1, key_shape_.num_elements()});
-    const auto key_buckets_tensor = key_buckets_.template matrix<K>();
-    for (int64_t i = 0; i < num_buckets_; ++i) {
-      if (!IsEqualKey(key_buckets_tensor, i, empty_key_tensor, 0) &&
-          !IsEqualKey(key_buckets_tensor, i, deleted_key_tensor, 0)) {
-        ++num_entries_;
+    // The exported buckets follow the quadratic probing layout (see
+    // ExportValues()) rather than the control-byte groups, so rather than
+    // adopting the tensors as-is the entries are re-inserted, which also
+    // rebuilds the control bytes. This requires iterating through the whole
+    // table but that is OK as we only execute it during checkpoint restore.
+    const int64_t key_size = key_shape_.num_elements();
+    const int64_t num_imported_buckets = keys.dim_size(0);
+    const auto keys_matrix =
+        keys.shaped<K, 2>({num_imported_buckets, key_size});
+    const auto empty_key_matrix =
+        empty_key_.template shaped<K, 2>({1, key_size});
+    const auto deleted_key_matrix =
+        deleted_key_.template shaped<K, 2>({1, key_size});
+    int64_t num_imported_entries = 0;
+    for (int64_t i = 0; i < num_imported_buckets; ++i) {
+      if (!IsEqualKey(keys_matrix, i, empty_key_matrix, 0) &&
+          !IsEqualKey(keys_matrix, i, deleted_key_matrix, 0)) {
+        ++num_imported_entries;
       }
     }
-    return OkStatus();
+    // Keep the exported number of buckets unless it is not a valid size or
+    // would exceed the maximum load factor.
+    int64_t new_num_buckets = 4;
+    while (new_num_buckets < num_imported_buckets ||
+           num_imported_entries > new_num_buckets * max_load_factor_) {
+      new_num_buckets <<= 1;
+    }
+    TF_RETURN_IF_ERROR(AllocateBuckets(ctx, new_num_buckets));
+    return DoInsert(ctx, keys, values, true);
   }
 
+  // Exports the entries in the bucket layout of the quadratic probing table
+  // that preceded the control bytes: each key is placed at the first free
+  // bucket of its probe sequence from `hash & (num_buckets - 1)`. Older
+  // binaries adopt imported buckets as-is and probe them in that order, so
+  // exporting `key_buckets_` directly would make them miss keys. Removed
+  // entries are not exported.
   Status ExportValues(OpKernelContext* ctx) override TF_LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
-    TF_RETURN_IF_ERROR(ctx->set_output("keys", key_buckets_));
-    TF_RETURN_IF_ERROR(ctx->set_output("values", value_buckets_));
+    const int64_t key_size = key_shape_.num_elements();
+    const int64_t value_size = value_shape_.num_elements();
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", key_buckets_.shape(), &keys));
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("values", value_buckets_.shape(), &values));
+    auto keys_matrix = keys->matrix<K>();
+    auto values_matrix = values->matrix<V>();
+    const auto empty_key_flat = empty_key_.template flat<K>();
+    for (int64_t i = 0; i < num_buckets_; ++i) {
+      for (int64_t j = 0; j < key_size; ++j) {
+        keys_matrix(i, j) = empty_key_flat(j);
+      }
+      for (int64_t j = 0; j < value_size; ++j) {
+        values_matrix(i, j) = V();
+      }
+    }
+
+    const Tensor& key_buckets = key_buckets_;
+    const auto key_buckets_matrix = key_buckets.matrix<K>();
+    const Tensor& value_buckets = value_buckets_;
+    const auto value_buckets_matrix = value_buckets.matrix<V>();
+    const auto empty_key_matrix =
+        empty_key_.template shaped<K, 2>({1, key_size});
+    const int64_t bit_mask = num_buckets_ - 1;
+    for (int64_t i = 0; i < num_buckets_; ++i) {
+      if (ctrl_[i] < 0) continue;
+      int64_t bucket_index = HashKey(key_buckets_matrix, i) & bit_mask;
+      int64_t num_probes = 0;
+      while (!IsEqualKey(keys_matrix, bucket_index, empty_key_matrix, 0)) {
+        ++num_probes;
+        bucket_index = (bucket_index + num_probes) & bit_mask;
+        if (num_probes >= num_buckets_) {
+          return errors::Internal(
+              "Internal error in MutableDenseHashTable export");
+        }
+      }
+      for (int64_t j = 0; j < key_size; ++j) {
+        keys_matrix(bucket_index, j) = key_buckets_matrix(i, j);
+      }
+      for (int64_t j = 0; j < value_size; ++j) {
+        values_matrix(bucket_index, j) = value_buckets_matrix(i, j);
+      }
+    }
     return OkStatus();
   }
 
@@ -669,10 +1045,88 @@ class MutableDenseHashTable final : public LookupInterface {
   int64_t MemoryUsed() const override TF_LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
     return sizeof(MutableDenseHashTable) + key_buckets_.AllocatedBytes() +
-           value_buckets_.AllocatedBytes() + empty_key_.AllocatedBytes();
+           value_buckets_.AllocatedBytes() + empty_key_.AllocatedBytes() +
+           ctrl_.capacity();
   }
 
  private:
+  // Rejects the empty and deleted keys and stores the mixed hash of the
+  // `index`th key in `hash`.
+  Status CheckKey(typename TTypes<K>::ConstMatrix key, int64_t index,
+                  uint64* hash) const {
+    const int64_t key_size = key_shape_.num_elements();
+    const uint64 key_hash = HashKey(key, index);
+    if (empty_key_hash_ == key_hash &&
+        IsEqualKey(empty_key_.template shaped<K, 2>({1, key_size}), 0, key,
+                   index)) {
+      return errors::InvalidArgument(
+          "Using the empty_key as a table key is not allowed");
+    }
+    if (deleted_key_hash_ == key_hash &&
+        IsEqualKey(deleted_key_.template shaped<K, 2>({1, key_size}), 0, key,
+                   index)) {
+      return errors::InvalidArgument(
+          "Using the deleted_key as a table key is not allowed");
+    }
+    *hash = MixHash(key_hash);
+    return OkStatus();
+  }
+
+  int64_t FirstGroup(uint64 hash) const TF_SHARED_LOCKS_REQUIRED(mu_) {
+    return (hash >> 7) & (num_groups_ - 1);
+  }
+
+  static int8_t HashTag(uint64 hash) {
+    return static_cast<int8_t>(hash & 0x7F);
+  }
+
+  // Probes the groups in triangular order, which visits every group exactly
+  // once since the number of groups is a power of two.
+  int64_t NextGroup(int64_t group, int64_t num_probes) const
+      TF_SHARED_LOCKS_REQUIRED(mu_) {
+    return (group + num_probes) & (num_groups_ - 1);
+  }
+
+  void PrefetchGroup(uint64 hash) const TF_SHARED_LOCKS_REQUIRED(mu_) {
+    const int64_t bucket_index = FirstGroup(hash) * kCtrlGroupWidth;
+    absl::PrefetchToLocalCache(ctrl_.data() + bucket_index);
+    absl::PrefetchToLocalCache(key_buckets_.template flat<K>().data() +
+                               bucket_index * key_shape_.num_elements());
+  }
+
+  // Sets `bucket_index` to the bucket holding the `index`th key of `key`, or
+  // to -1 if the key is not in the table.
+  template <typename MT>
+  Status FindBucket(MT key_buckets_matrix,
+                    typename TTypes<K>::ConstMatrix key, int64_t index,
+                    uint64 hash, int64_t* bucket_index) const
+      TF_SHARED_LOCKS_REQUIRED(mu_) {
+    const int8_t tag = HashTag(hash);
+    int64_t group = FirstGroup(hash);
+    int64_t num_probes = 0;
+    while (true) {
+      const int64_t base = group * kCtrlGroupWidth;
+      const CtrlGroup ctrl(ctrl_.data() + base);
+      for (uint32 match = ctrl.Match(tag); match != 0; match &= match - 1) {
+        const int64_t candidate = base + absl::countr_zero(match);
+        if (IsEqualKey(key_buckets_matrix, candidate, key, index)) {
+          *bucket_index = candidate;
+          return OkStatus();
+        }
+      }
+      if (ctrl.MatchEmpty() != 0) {
+        *bucket_index = -1;
+        return OkStatus();
+      }
+      ++num_probes;
+      group = NextGroup(group, num_probes);
+      if (num_probes >= num_groups_) {
+        return errors::Internal(
+            "Internal error in MutableDenseHashTable lookup");
+      }
+    }
+  }
+
   Status DoInsert(OpKernelContext* ctx, const Tensor& key, const Tensor& value,
                   bool ignore_empty_and_deleted_key)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -684,60 +1138,60 @@ class MutableDenseHashTable final : public LookupInterface {
 
     auto key_buckets_matrix = key_buckets_.template matrix<K>();
     auto value_buckets_matrix = value_buckets_.template matrix<V>();
-    const auto empty_key_tensor =
-        empty_key_.template shaped<K, 2>({1, key_size});
-    const auto deleted_key_tensor =
-        deleted_key_.template shaped<K, 2>({1, key_size});
-    const int64_t bit_mask = num_buckets_ - 1;
     for (int64_t i = 0; i < num_elements; ++i) {
-      const uint64 key_hash = HashKey(key_matrix, i);
-      if (empty_key_hash_ == key_hash &&
-          IsEqualKey(empty_key_tensor, 0, key_matrix, i)) {
+      uint64 hash;
+      Status s = CheckKey(key_matrix, i, &hash);
+      if (!s.ok()) {
         if (ignore_empty_and_deleted_key) {
           continue;
         }
-        return errors::InvalidArgument(
-            "Using the empty_key as a table key is not allowed");
+        return s;
       }
-      if (deleted_key_hash_ == key_hash &&
-          IsEqualKey(deleted_key_tensor, 0, key_matrix, i)) {
-        if (ignore_empty_and_deleted_key) {
-          continue;
-        }
-        return errors::InvalidArgument(
-            "Using the deleted_key as a table key is not allowed");
-      }
-      int64_t bucket_index = key_hash & bit_mask;
+      const int8_t tag = HashTag(hash);
+      int64_t group = FirstGroup(hash);
       int64_t num_probes = 0;
+      int64_t target = -1;
+      bool updated = false;
       while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
-          for (int64_t j = 0; j < value_size; ++j) {
-            value_buckets_matrix(bucket_index, j) =
-                SubtleMustCopyIfIntegral(value_matrix(i, j));
+        const int64_t base = group * kCtrlGroupWidth;
+        const CtrlGroup ctrl(ctrl_.data() + base);
+        for (uint32 match = ctrl.Match(tag); match != 0; match &= match - 1) {
+          const int64_t candidate = base + absl::countr_zero(match);
+          if (IsEqualKey(key_buckets_matrix, candidate, key_matrix, i)) {
+            for (int64_t j = 0; j < value_size; ++j) {
+              value_buckets_matrix(candidate, j) =
+                  SubtleMustCopyIfIntegral(value_matrix(i, j));
+            }
+            updated = true;
+            break;
           }
-          break;
         }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_tensor, 0) ||
-            IsEqualKey(key_buckets_matrix, bucket_index, deleted_key_tensor,
-                       0)) {
-          ++num_entries_;
-          for (int64_t j = 0; j < key_size; ++j) {
-            key_buckets_matrix(bucket_index, j) =
-                SubtleMustCopyIfIntegral(key_matrix(i, j));
-          }
-          for (int64_t j = 0; j < value_size; ++j) {
-            value_buckets_matrix(bucket_index, j) =
-                SubtleMustCopyIfIntegral(value_matrix(i, j));
-          }
-          break;
+        if (updated) break;
+        // Remember the first free bucket along the probe sequence, but keep
+        // probing until an empty bucket proves the key is not further along.
+        const uint32 available = ctrl.MatchEmptyOrDeleted();
+        if (target < 0 && available != 0) {
+          target = base + absl::countr_zero(available);
         }
+        if (ctrl.MatchEmpty() != 0) break;
         ++num_probes;
-        bucket_index =
-            (bucket_index + num_probes) & bit_mask;  // quadratic probing
-        if (num_probes >= num_buckets_) {
-          return errors::Internal(
-              "Internal error in MutableDenseHashTable insert");
-        }
+        group = NextGroup(group, num_probes);
+        if (num_probes >= num_groups_) break;
+      }
+      if (updated) continue;
+      if (target < 0) {
+        return errors::Internal(
+            "Internal error in MutableDenseHashTable insert");
+      }
+      ++num_entries_;
+      ctrl_[target] = tag;
+      for (int64_t j = 0; j < key_size; ++j) {
+        key_buckets_matrix(target, j) =
+            SubtleMustCopyIfIntegral(key_matrix(i, j));
+      }
+      for (int64_t j = 0; j < value_size; ++j) {
+        value_buckets_matrix(target, j) =
+            SubtleMustCopyIfIntegral(value_matrix(i, j));
       }
     }
     return OkStatus();
@@ -750,45 +1204,19 @@ class MutableDenseHashTable final : public LookupInterface {
     const auto key_matrix = key.shaped<K, 2>({num_elements, key_size});
 
     auto key_buckets_matrix = key_buckets_.template matrix<K>();
-    const auto empty_key_tensor =
-        empty_key_.template shaped<K, 2>({1, key_size});
-    const auto deleted_key_tensor =
-        deleted_key_.template shaped<K, 2>({1, key_size});
     const auto deleted_key_flat = deleted_key_.template flat<K>();
-    const int64_t bit_mask = num_buckets_ - 1;
     for (int64_t i = 0; i < num_elements; ++i) {
-      const uint64 key_hash = HashKey(key_matrix, i);
-      if (empty_key_hash_ == key_hash &&
-          IsEqualKey(empty_key_tensor, 0, key_matrix, i)) {
-        return errors::InvalidArgument(
-            "Using the empty_key as a table key is not allowed");
-      }
-      if (deleted_key_hash_ == key_hash &&
-          IsEqualKey(deleted_key_tensor, 0, key_matrix, i)) {
-        return errors::InvalidArgument(
-            "Using the deleted_key as a table key is not allowed");
-      }
-      int64_t bucket_index = key_hash & bit_mask;
-      int64_t num_probes = 0;
-      while (true) {
-        if (IsEqualKey(key_buckets_matrix, bucket_index, key_matrix, i)) {
-          --num_entries_;
-          for (int64_t j = 0; j < key_size; ++j) {
-            key_buckets_matrix(bucket_index, j) =
-                SubtleMustCopyIfIntegral(deleted_key_flat(j));
-          }
-          break;
-        }
-        if (IsEqualKey(key_buckets_matrix, bucket_index, empty_key_tensor, 0)) {
-          break;
-        }
-        ++num_probes;
-        bucket_index =
-            (bucket_index + num_probes) & bit_mask;  // quadratic probing
-        if (num_probes >= num_buckets_) {
-          return errors::Internal(
-              "Internal error in MutableDenseHashTable remove");
-        }
+      uint64 hash;
+      TF_RETURN_IF_ERROR(CheckKey(key_matrix, i, &hash));
+      int64_t bucket_index;
+      TF_RETURN_IF_ERROR(
+          FindBucket(key_buckets_matrix, key_matrix, i, hash, &bucket_index));
+      if (bucket_index < 0) continue;
+      --num_entries_;
+      ctrl_[bucket_index] = kCtrlDeleted;
+      for (int64_t j = 0; j < key_size; ++j) {
+        key_buckets_matrix(bucket_index, j) =
+            SubtleMustCopyIfIntegral(deleted_key_flat(j));
       }
     }
     return OkStatus();
@@ -805,6 +1233,12 @@ class MutableDenseHashTable final : public LookupInterface {
     num_buckets_ = new_num_buckets;
     num_entries_ = 0;
 
+    // Tables smaller than one group use a single group whose trailing control
+    // bytes are sentinels that never match and are never free.
+    num_groups_ = std::max<int64_t>(num_buckets_ / kCtrlGroupWidth, 1);
+    ctrl_.assign(num_groups_ * kCtrlGroupWidth, kCtrlEmpty);
+    std::fill(ctrl_.begin() + num_buckets_, ctrl_.end(), kCtrlSentinel);
+
     const int64_t key_size = key_shape_.num_elements();
     TF_RETURN_IF_ERROR(ctx->allocate_temp(
         key_dtype(), TensorShape({num_buckets_, key_size}), &key_buckets_));
@@ -853,9 +1287,9 @@ class MutableDenseHashTable final : public LookupInterface {
 
   // Use a template to allow this function to be used both with Matrix and
   // ConstMatrix types.
-  template <typename MT2>
-  bool IsEqualKey(typename TTypes<K>::Matrix tensor1, int64_t index1,
-                  MT2 tensor2, int64_t index2) const {
+  template <typename MT1, typename MT2>
+  bool IsEqualKey(MT1 tensor1, int64_t index1, MT2 tensor2,
+                  int64_t index2) const {
     for (int64_t i = 0; i < key_shape_.num_elements(); ++i) {
       if (tensor1(index1, i) != tensor2(index2, i)) {
         return false;
@@ -870,6 +1304,9 @@ class MutableDenseHashTable final : public LookupInterface {
   mutable mutex mu_;
   int64_t num_entries_ TF_GUARDED_BY(mu_);
   int64_t num_buckets_ TF_GUARDED_BY(mu_);
+  int64_t num_groups_ TF_GUARDED_BY(mu_);
+  // Control byte of every bucket, padded to a whole number of groups.
+  std::vector<int8_t> ctrl_ TF_GUARDED_BY(mu_);
   Tensor key_buckets_ TF_GUARDED_BY(mu_);
   Tensor value_buckets_ TF_GUARDED_BY(mu_);
   Tensor empty_key_;
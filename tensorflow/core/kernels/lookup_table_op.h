@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
+#include "tensorflow/core/kernels/immutable_hash_index.h"
 #include "tensorflow/core/kernels/lookup_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -234,7 +235,7 @@ class HashTable : public InitializableLookupTable {
                            .WithAttr("key_dtype", key_dtype())
                            .WithAttr("value_dtype", value_dtype())
                            .WithAttr("use_node_name_sharing", true));
-    if (table_.empty()) {
+    if (table_.empty() && index_ == nullptr) {
       *out = hash_table_node;
       return OkStatus();
     }
@@ -257,6 +258,8 @@ class HashTable : public InitializableLookupTable {
   size_t size() const override {
     if (!is_initialized())
       return 0;
+    else if (index_ != nullptr)
+      return index_->size();
     else
       return table_.size();
   }
@@ -266,7 +269,7 @@ class HashTable : public InitializableLookupTable {
       return errors::Aborted("HashTable is not initialized.");
     }
 
-    const int64_t size = table_.size();
+    const int64_t size = this->size();
 
     Tensor* keys;
     Tensor* values;
@@ -277,6 +280,9 @@ class HashTable : public InitializableLookupTable {
 
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
+    if (index_ != nullptr) {
+      return index_->Export<K, V>(keys_data, values_data);
+    }
     int64_t i = 0;
     for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
       keys_data(i) = it->first;
@@ -326,6 +332,9 @@ class HashTable : public InitializableLookupTable {
     const auto key_values = key.flat<K>();
     auto value_values = value->flat<V>();
 
+    if (index_ != nullptr) {
+      return index_->Find<K, V>(key_values, value_values, default_val);
+    }
     for (int64_t i = 0; i < key_values.size(); ++i) {
       value_values(i) = gtl::FindWithDefault(
           table_, SubtleMustCopyIfIntegral(key_values(i)), default_val);
@@ -337,12 +346,25 @@ class HashTable : public InitializableLookupTable {
     if (!is_initialized()) {
       return 0;
     }
+    // Entries served from an index live in the page cache, not the heap.
+    if (index_ != nullptr) {
+      return sizeof(*index_);
+    }
     const int64_t num_elements = table_.size();
     return num_elements * (sizeof(K) + sizeof(V));
   }
 
+  Status DoInitializeFromIndex(
+      std::unique_ptr<ImmutableHashIndex> index) override {
+    index_ = std::move(index);
+    return OkStatus();
+  }
+
  private:
   absl::flat_hash_map<K, V> table_;
+  // When set, the table entries are served from this memory-mapped index and
+  // `table_` is empty.
+  std::unique_ptr<ImmutableHashIndex> index_;
 };
 
 }  // namespace lookup
@@ -250,8 +250,11 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
 
-// A restore operation for a single tensor.  Small tensors may be restored
-// directly from the op thread to improve read locality.  Large tensors can be
+// Number of threads that read full tensors when the caller does not choose.
+const int kDefaultRestoreThreads = 8;
+
+// A restore operation for a single tensor slice.  Small slices may be restored
+// directly from the op thread to improve read locality.  Large slices can be
 // restored from a thread pool: this requires creating a separate BundleReader
 // for each restore.
 struct RestoreOp {
@@ -300,34 +303,25 @@ struct RestoreOp {
 
     VLOG(1) << "Restoring tensor " << idx << " : " << tensor_name << " : "
             << restored_full_shape.num_elements();
-    Tensor* restored_tensor;
-    if (shape_and_slice.empty()) {
-      // Lookup the full tensor.
-      TF_RETURN_IF_ERROR(
-          context->allocate_output(idx, restored_full_shape, &restored_tensor));
-      TF_RETURN_IF_ERROR(reader->Lookup(tensor_name, restored_tensor));
-    } else {
-      // Lookup the slice.
-      TensorShape parsed_full_shape;
-      TensorSlice parsed_slice;
-      TensorShape parsed_slice_shape;
-
-      TF_RETURN_IF_ERROR(
-          checkpoint::ParseShapeAndSlice(shape_and_slice, &parsed_full_shape,
-                                         &parsed_slice, &parsed_slice_shape));
-
-      if (!restored_full_shape.IsSameSize(parsed_full_shape)) {
-        return errors::InvalidArgument(
-            "tensor_name = ", tensor_name, "; shape in shape_and_slice spec ",
-            parsed_full_shape.DebugString(),
-            " does not match the shape stored in checkpoint: ",
-            restored_full_shape.DebugString());
-      }
-      TF_RETURN_IF_ERROR(
-          context->allocate_output(idx, parsed_slice_shape, &restored_tensor));
-      TF_RETURN_IF_ERROR(
-          reader->LookupSlice(tensor_name, parsed_slice, restored_tensor));
+    TensorShape parsed_full_shape;
+    TensorSlice parsed_slice;
+    TensorShape parsed_slice_shape;
+    TF_RETURN_IF_ERROR(
+        checkpoint::ParseShapeAndSlice(shape_and_slice, &parsed_full_shape,
+                                       &parsed_slice, &parsed_slice_shape));
+
+    if (!restored_full_shape.IsSameSize(parsed_full_shape)) {
+      return errors::InvalidArgument(
+          "tensor_name = ", tensor_name, "; shape in shape_and_slice spec ",
+          parsed_full_shape.DebugString(),
+          " does not match the shape stored in checkpoint: ",
+          restored_full_shape.DebugString());
     }
+    Tensor* restored_tensor;
+    TF_RETURN_IF_ERROR(
+        context->allocate_output(idx, parsed_slice_shape, &restored_tensor));
+    TF_RETURN_IF_ERROR(
+        reader->LookupSlice(tensor_name, parsed_slice, restored_tensor));
     if (VLOG_IS_ON(5)) {
       if (restored_tensor->dtype() == DT_FLOAT) {
         const float* t_data = restored_tensor->flat<float>().data();
@@ -364,7 +358,7 @@ struct RestoreOp {
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                         const Tensor& tensor_names,
                         const Tensor& shape_and_slices,
-                        gtl::ArraySlice<DataType> dtypes) {
+                        gtl::ArraySlice<DataType> dtypes, int num_threads) {
   const string& prefix_string = prefix.scalar<tstring>()();
 
   const auto& tensor_names_flat = tensor_names.flat<tstring>();
@@ -384,11 +378,14 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
       restore_ops, [](const RestoreOp& op) { return op.tensor_name; }));
 
   std::vector<string> mismatched_errors;
+  std::vector<TensorShape> restored_full_shapes;
+  restored_full_shapes.reserve(restore_ops.size());
   for (const RestoreOp& restore_op : restore_ops) {
     TensorShape restored_full_shape;
     DataType original_dtype;
     TF_RETURN_IF_ERROR(default_reader.LookupDtypeAndShape(
         restore_op.tensor_name, &original_dtype, &restored_full_shape));
+    restored_full_shapes.push_back(restored_full_shape);
     if (restore_op.dtype != original_dtype) {
       string error_msg = strings::StrCat(
           "tensor_name = ", restore_op.tensor_name, "; expected dtype ",
@@ -402,10 +399,21 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
+  // Full tensors are allocated up front, and the reader fills their buffers
+  // concurrently.
+  std::vector<string> full_tensor_names;
+  std::vector<Tensor*> full_tensors;
   std::vector<RestoreOp*> pool_restore_ops;
   std::vector<RestoreOp*> direct_restore_ops;
-  for (RestoreOp& restore_op : restore_ops) {
-    if (restore_op.should_run_in_pool(&default_reader)) {
+  for (int i = 0; i < restore_ops.size(); ++i) {
+    RestoreOp& restore_op = restore_ops[i];
+    if (restore_op.shape_and_slice.empty()) {
+      Tensor* restored_tensor;
+      TF_RETURN_IF_ERROR(context->allocate_output(
+          restore_op.idx, restored_full_shapes[i], &restored_tensor));
+      full_tensor_names.push_back(restore_op.tensor_name);
+      full_tensors.push_back(restored_tensor);
+    } else if (restore_op.should_run_in_pool(&default_reader)) {
       pool_restore_ops.push_back(&restore_op);
     } else {
       direct_restore_ops.push_back(&restore_op);
@@ -424,7 +432,13 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
       }
     }
 
-    // Read small tensors from the op thread
+    if (num_threads == 0) num_threads = kDefaultRestoreThreads;
+    VLOG(1) << "Restoring " << full_tensors.size() << " tensors with "
+            << num_threads << " threads";
+    TF_RETURN_IF_ERROR(default_reader.LookupMany(full_tensor_names,
+                                                 full_tensors, num_threads));
+
+    // Read small slices from the op thread
     for (auto* op : direct_restore_ops) {
       TF_RETURN_IF_ERROR(op->run(&default_reader));
     }
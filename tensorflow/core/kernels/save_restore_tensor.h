@@ -59,14 +59,19 @@ void RestoreTensor(OpKernelContext* context,
 //
 // "context" is only used for allocating outputs.  In particular, the inputs are
 // explicitly provided and not accessed via the "input(i)" methods.
+//
+// Tensors that are restored in full are read concurrently by up to
+// "num_threads" threads, directly into the allocated outputs.  0 picks a
+// default, and 1 reads them sequentially.
 // REQUIRES:
 //   * "prefix" has 1 element, DT_STRING.
 //   * "tensor_names" and "shape_and_slices" shaped {N}, both DT_STRING.
 //   * "dtypes" has N elements, the datatypes of the to-restore tensors.
+//   * "num_threads" >= 0.
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                         const Tensor& tensor_names,
                         const Tensor& shape_and_slices,
-                        gtl::ArraySlice<DataType> dtypes);
+                        gtl::ArraySlice<DataType> dtypes, int num_threads);
 
 }  // namespace tensorflow
 
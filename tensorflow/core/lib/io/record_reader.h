@@ -30,8 +30,10 @@ limitations under the License.
 namespace tensorflow {
 namespace io {
 // NOLINTBEGIN(misc-unused-using-decls)
+using tsl::io::RecordBuffer;
 using tsl::io::RecordReader;
 using tsl::io::RecordReaderOptions;
+using tsl::io::RecordView;
 using tsl::io::SequentialRecordReader;
 // NOLINTEND(misc-unused-using-decls)
 }  // namespace io
@@ -60,6 +60,22 @@ REGISTER_OP("BatchFunction")
     // NOTE: Support for `enable_large_batch_splitting == true` is still
     // developed in progress.
     .Attr("enable_large_batch_splitting: bool = false")
+    // If 'enable_zero_copy_batching' is true, outputs are returned as slices
+    // of the batched outputs instead of copies.
+    .Attr("enable_zero_copy_batching: bool = false")
+    // If 'enable_fair_share_scheduling' is true, the op's queue is served by a
+    // batch scheduler shared with the other ops that set it and have the same
+    // 'num_batch_threads', which divides its threads' time between the queues
+    // in proportion to their 'fair_share_weight'. Queues with
+    // 'latency_critical' set are served first.
+    .Attr("enable_fair_share_scheduling: bool = false")
+    .Attr("fair_share_weight: float = 1.0")
+    .Attr("latency_critical: bool = false")
+    // If 'enable_deadline_aware_batching' is true, the op's batches are closed
+    // in time for the deadline of the earliest request they hold, and are
+    // processed earliest deadline first. 'batch_timeout_micros' still bounds
+    // requests without a deadline.
+    .Attr("enable_deadline_aware_batching: bool = false")
     // TODO(apassos): Fix this shape inference function. It requires shape
     // inference of function calls.
     .SetShapeFn(shape_inference::UnknownShape)
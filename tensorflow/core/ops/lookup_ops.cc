@@ -401,6 +401,7 @@ REGISTER_OP("MutableHashTableV2")
     .Attr("use_node_name_sharing: bool = false")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
+    .Attr("num_shards: int >= 1 = 1")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
@@ -408,6 +409,7 @@ REGISTER_OP("AnonymousMutableHashTable")
     .Output("table_handle: resource")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
+    .Attr("num_shards: int >= 1 = 1")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
@@ -430,6 +432,7 @@ REGISTER_OP("MutableHashTableOfTensorsV2")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
     .Attr("value_shape: shape = {}")
+    .Attr("num_shards: int >= 1 = 1")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableOfTensorsShapeFn);
 
@@ -438,6 +441,7 @@ REGISTER_OP("AnonymousMutableHashTableOfTensors")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
     .Attr("value_shape: shape = {}")
+    .Attr("num_shards: int >= 1 = 1")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableOfTensorsShapeFn);
 
@@ -550,4 +554,32 @@ REGISTER_OP("InitializeTableFromTextFileV2")
       return OkStatus();
     });
 
+REGISTER_OP("InitializeTableFromIndexFileV2")
+    .Input("table_handle: resource")
+    .Input("filename: string")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle handle;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &handle));
+
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &handle));
+      return OkStatus();
+    });
+
+REGISTER_OP("WriteHashTableIndexFile")
+    .Input("filename: string")
+    .Input("keys: Tkey")
+    .Input("values: Tval")
+    .Attr("Tkey: {int32, int64, string}")
+    .Attr("Tval: {bool, int32, int64, float, double, string}")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+
+      ShapeHandle keys;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &keys));
+      TF_RETURN_IF_ERROR(c->Merge(keys, c->input(2), &keys));
+      return OkStatus();
+    });
+
 }  // namespace tensorflow
@@ -1033,6 +1033,43 @@ _FusedConv2D output.
 expected to create these operators.
 )doc");
 
+REGISTER_OP("_FusedElementwise")
+    .Input("args: num_args * T")
+    .Output("output: T")
+    .Attr("T: {float, double}")
+    .Attr("num_args: int >= 1")
+    .Attr("fused_ops: list(string) >= 1")
+    .Attr("op_inputs: list(int) >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle out = c->input(0);
+      for (int i = 1; i < c->num_inputs(); ++i) {
+        TF_RETURN_IF_ERROR(BroadcastBinaryOpOutputShapeFnHelper(
+            c, out, c->input(i), /*incompatible_shape_error=*/true, &out));
+      }
+      c->set_output(0, out);
+      return OkStatus();
+    })
+    .Doc(R"doc(
+Evaluates a chain of elementwise ops in a single pass over its output.
+
+The ops are specified by `fused_ops`, which is a list of TF op names (e.g.
+"Mul" or "Tanh"), in the order in which they are evaluated. Their inputs are
+specified by `op_inputs`, which holds one value index for every input of every
+op, in order. Indices 0 to `num_args` - 1 refer to `args`, and index
+`num_args` + i refers to the output of `fused_ops[i]`. The output of the last
+op is the output of _FusedElementwise.
+
+`args` are broadcast to the shape of the output, which is the broadcast shape
+of all `args`.
+
+Supported ops are Add, AddV2, Sub, Mul, Div, RealDiv, Maximum, Minimum,
+SquaredDifference, Neg, Abs, Square, Sqrt, Rsqrt, Exp, Log, Tanh, Sigmoid, Relu
+and Relu6.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+)doc");
+
 // --------------------------------------------------------------------------
 
 // For operations where the output is a reduction function along some
@@ -202,6 +202,7 @@ REGISTER_OP("ParseExampleV2")
     .Attr("ragged_value_types: list({float,int64,string}) >= 0")
     .Attr("ragged_split_types: list({int32,int64}) >= 0")
     .Attr("dense_shapes: list(shape) >= 0")
+    .Attr("use_columnar_parser: bool = false")
 
     .SetShapeFn([](InferenceContext* c) {
       ParseExampleAttrs attrs;
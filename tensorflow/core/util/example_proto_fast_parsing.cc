@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
 #include <optional>
 #include <utility>
@@ -22,6 +23,7 @@ limitations under the License.
 
 #include "absl/base/casts.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/numeric/bits.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
 #include "tensorflow/core/framework/allocator.h"
@@ -117,6 +119,64 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+// The high bit of each byte of a word, which is set in all but the last byte
+// of a varint.
+constexpr uint64 kVarintContinuationBits = 0x8080808080808080ULL;
+
+// Returns the number of varints in the packed buffer [begin, end), i.e. the
+// number of bytes that end a varint, counting 8 bytes at a time.
+inline size_t CountPackedVarints(const uint8* begin, const uint8* end) {
+  size_t count = 0;
+  const uint8* p = begin;
+  for (; end - p >= 8; p += 8) {
+    uint64 word;
+    memcpy(&word, p, sizeof(word));
+    count += 8 - absl::popcount(word & kVarintContinuationBits);
+  }
+  for (; p < end; ++p) {
+    if ((*p & 0x80) == 0) ++count;
+  }
+  return count;
+}
+
+// Decodes the packed varints in [begin, end) and appends them to `result`.
+// Each 8 bytes are tested for continuation bits at once, and the single-byte
+// varints that lead them, which are the common case for small ids and counts,
+// are copied out without decoding them one at a time.
+// Returns false if the buffer does not hold a sequence of valid varints.
+template <typename Result>
+bool ParsePackedVarints(const uint8* begin, const uint8* end,
+                        Result* result) {
+  const uint8* p = begin;
+  while (p < end) {
+    if (end - p >= 8) {
+      uint64 word;
+      memcpy(&word, p, sizeof(word));
+      const uint64 continuation = word & kVarintContinuationBits;
+      int num_single_bytes = 0;
+      if (continuation == 0) {
+        num_single_bytes = 8;
+      } else if (port::kLittleEndian) {
+        num_single_bytes = absl::countr_zero(continuation) / 8;
+      }
+      for (int i = 0; i < num_single_bytes; ++i) {
+        result->push_back(static_cast<int64_t>(p[i]));
+      }
+      p += num_single_bytes;
+      if (num_single_bytes == 8) continue;
+    }
+    uint64 value = 0;
+    for (int shift = 0;; shift += 7) {
+      if (p == end || shift >= 64) return false;
+      const uint8 byte = *p++;
+      value |= static_cast<uint64>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) break;
+    }
+    result->push_back(static_cast<int64_t>(value));
+  }
+  return true;
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -303,21 +363,71 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
+        const uint8* packed;
+        if (!GetPackedBuffer(&stream, packed_length, &packed)) return false;
+        if (!ParsePackedVarints(packed, packed + packed_length, int64_list)) {
+          return false;
+        }
+        if (!stream.Skip(packed_length)) return false;
+      } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
+          if (!stream.ExpectTag(kVarintTag(1))) return false;
           protobuf_uint64 n;  // There is no API for int64
           if (!stream.ReadVarint64(&n)) return false;
           int64_list->push_back(static_cast<int64_t>(n));
         }
+      }
+    }
+    stream.PopLimit(limit);
+    return true;
+  }
 
-        stream.PopLimit(packed_limit);
+  bool GetNumElementsInFloatList(int* num_elements) {
+    protobuf::io::CodedInputStream stream(
+        reinterpret_cast<const uint8*>(serialized_.data()), serialized_.size());
+    EnableAliasing(&stream);
+    uint32 length = 0;
+    if (!stream.ReadVarint32(&length)) return false;
+    auto limit = stream.PushLimit(length);
+    *num_elements = 0;
+    if (!stream.ExpectAtEnd()) {
+      constexpr int32_t kNumFloatBytes = 4;
+      if (stream.ExpectTag(kDelimitedTag(1))) {  // packed
+        uint32 packed_length;
+        if (!stream.ReadVarint32(&packed_length)) return false;
+        *num_elements = packed_length / kNumFloatBytes;
+      } else if (PeekTag(&stream) == kFixed32Tag(1)) {  // non-packed
+        // Same as in ParseFloatList().
+        *num_elements = stream.BytesUntilLimit() / (1 + kNumFloatBytes);
+      } else {
+        return false;
+      }
+    }
+    stream.PopLimit(limit);
+    return true;
+  }
+
+  bool GetNumElementsInInt64List(int* num_elements) {
+    protobuf::io::CodedInputStream stream(
+        reinterpret_cast<const uint8*>(serialized_.data()), serialized_.size());
+    EnableAliasing(&stream);
+    uint32 length = 0;
+    if (!stream.ReadVarint32(&length)) return false;
+    auto limit = stream.PushLimit(length);
+    *num_elements = 0;
+    if (!stream.ExpectAtEnd()) {
+      if (stream.ExpectTag(kDelimitedTag(1))) {  // packed
+        uint32 packed_length;
+        if (!stream.ReadVarint32(&packed_length)) return false;
+        const uint8* packed;
+        if (!GetPackedBuffer(&stream, packed_length, &packed)) return false;
+        *num_elements = CountPackedVarints(packed, packed + packed_length);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
-          protobuf_uint64 n;  // There is no API for int64
+          protobuf_uint64 n;
           if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64_t>(n));
+          ++*num_elements;
         }
       }
     }
@@ -328,6 +438,20 @@ class Feature {
   StringPiece GetSerialized() const { return serialized_; }
 
  private:
+  // Points `packed` at the next `packed_length` bytes of `stream`, which must
+  // all be in its buffer.
+  static bool GetPackedBuffer(protobuf::io::CodedInputStream* stream,
+                              uint32 packed_length, const uint8** packed) {
+    *packed = nullptr;
+    if (packed_length == 0) return true;
+    const void* data;
+    int size;
+    if (!stream->GetDirectBufferPointer(&data, &size)) return false;
+    if (static_cast<uint32>(size) < packed_length) return false;
+    *packed = static_cast<const uint8*>(data);
+    return true;
+  }
+
   // TODO(lew): Pair of uint8* would be more natural.
   StringPiece serialized_;
 };
@@ -948,6 +1072,67 @@ Status FastParseSerializedExample(
   return OkStatus();
 }
 
+// Builds the index from the hashes of the feature names in `config` to the
+// position and type of each feature, changing the seed of `hasher` until the
+// hashes do not collide.
+Status BuildConfigIndex(
+    const Config& config, SeededHasher* hasher,
+    PresizedCuckooMap<std::pair<size_t, Type>>* config_index) {
+  const size_t config_size =
+      config.dense.size() + config.sparse.size() + config.ragged.size();
+  bool ok = true;
+  for (size_t i = 0; i < 1000; ++i) {
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(config.dense[d].feature_name),
+                                       {d, Type::Dense});
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(config.sparse[d].feature_name),
+                                       {d, Type::Sparse});
+    }
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(config.ragged[d].feature_name),
+                                       {d, Type::Ragged});
+    }
+    if (ok) break;
+    LOG(WARNING) << "Collision found. This should happen only if you have "
+                    "around 2^32 entries in your config.";
+    hasher->seed++;
+    config_index->Clear(config_size);
+    ok = true;
+  }
+  if (!ok) {
+    return errors::Internal(
+        "Could not avoid collision. This should not happen.");
+  }
+  return OkStatus();
+}
+
+// Calculates the number of minibatches that `serialized` is split into.
+// In main regime make each minibatch around kMiniBatchSizeBytes bytes.
+// Apply 'special logic' below for small and big regimes.
+size_t ComputeNumMinibatches(gtl::ArraySlice<tstring> serialized) {
+  // This parameter affects performance in a big and data-dependent way.
+  const size_t kMiniBatchSizeBytes = 50000;
+
+  size_t result = 0;
+  size_t minibatch_bytes = 0;
+  for (size_t i = 0; i < serialized.size(); i++) {
+    if (minibatch_bytes == 0) {  // start minibatch
+      result++;
+    }
+    minibatch_bytes += serialized[i].size() + 1;
+    if (minibatch_bytes > kMiniBatchSizeBytes) {
+      minibatch_bytes = 0;
+    }
+  }
+  // 'special logic'
+  const size_t min_minibatches = std::min<size_t>(8, serialized.size());
+  const size_t max_minibatches = 64;
+  return std::max<size_t>(min_minibatches,
+                          std::min<size_t>(max_minibatches, result));
+}
+
 Status CheckConfigDataType(DataType dtype) {
   switch (dtype) {
     case DT_INT64:
@@ -1148,31 +1333,7 @@ Status FastParseExample(const Config& config,
   SeededHasher hasher;
   // Build config index.
   PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    for (size_t d = 0; d < config.ragged.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
-                                      {d, Type::Ragged});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config, &hasher, &config_index));
 
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse and ragged have to be buffered).
@@ -1187,30 +1348,7 @@ Status FastParseExample(const Config& config,
     fixed_dense_values[d] = Tensor(config.dense[d].dtype, out_shape);
   }
 
-  // This parameter affects performance in a big and data-dependent way.
-  const size_t kMiniBatchSizeBytes = 50000;
-
-  // Calculate number of minibatches.
-  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
-  // Apply 'special logic' below for small and big regimes.
-  const size_t num_minibatches = [&] {
-    size_t result = 0;
-    size_t minibatch_bytes = 0;
-    for (size_t i = 0; i < serialized.size(); i++) {
-      if (minibatch_bytes == 0) {  // start minibatch
-        result++;
-      }
-      minibatch_bytes += serialized[i].size() + 1;
-      if (minibatch_bytes > kMiniBatchSizeBytes) {
-        minibatch_bytes = 0;
-      }
-    }
-    // 'special logic'
-    const size_t min_minibatches = std::min<size_t>(8, serialized.size());
-    const size_t max_minibatches = 64;
-    return std::max<size_t>(min_minibatches,
-                            std::min<size_t>(max_minibatches, result));
-  }();
+  const size_t num_minibatches = ComputeNumMinibatches(serialized);
 
   auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
     return (serialized.size() * minibatch) / num_minibatches;
@@ -1445,6 +1583,471 @@ Status FastParseExample(const Config& config,
   return OkStatus();
 }
 
+namespace {
+
+// The features of a batch of examples, by column. There is one column for
+// each feature of the config: config.dense, then config.sparse, then
+// config.ragged.
+struct ColumnarBatch {
+  ColumnarBatch(size_t num_columns, size_t num_examples)
+      : num_examples(num_examples),
+        features(num_columns * num_examples),
+        splits(num_columns * (num_examples + 1), 0) {}
+
+  // Returns the feature of column `c` in example `e`, which is empty if the
+  // example does not have the feature.
+  parsed::Feature& feature(size_t c, size_t e) {
+    return features[c * num_examples + e];
+  }
+
+  // Returns the `num_examples + 1` row splits of the values of column `c`.
+  // Until MergeSplits(c) is called, element `e + 1` holds the number of values
+  // of example `e` instead.
+  int64_t* splits_of(size_t c) { return &splits[c * (num_examples + 1)]; }
+
+  // Turns the numbers of values of column `c` into its row splits. Returns the
+  // total number of values, and stores the largest number of values of an
+  // example in `max_num_values`.
+  int64_t MergeSplits(size_t c, int64_t* max_num_values) {
+    int64_t* column_splits = splits_of(c);
+    *max_num_values = 0;
+    for (size_t e = 1; e <= num_examples; ++e) {
+      *max_num_values = std::max(*max_num_values, column_splits[e]);
+      column_splits[e] += column_splits[e - 1];
+    }
+    return column_splits[num_examples];
+  }
+
+  const size_t num_examples;
+  std::vector<parsed::Feature> features;
+  std::vector<int64_t> splits;
+};
+
+StringPiece ExampleNameOrUnknown(gtl::ArraySlice<tstring> example_names,
+                                 size_t e) {
+  return example_names.empty() ? StringPiece("<unknown>")
+                               : StringPiece(example_names[e]);
+}
+
+// Returns the name of the values of `dtype` used in error messages.
+const char* ValuesTypeName(DataType dtype) {
+  switch (dtype) {
+    case DT_INT64:
+      return "int64";
+    case DT_FLOAT:
+      return "float";
+    case DT_STRING:
+      return "bytes";
+    default:
+      ReportUnexpectedDataType(dtype);
+      return "";
+  }
+}
+
+bool GetNumElements(DataType dtype, parsed::Feature* feature,
+                    int* num_elements) {
+  switch (dtype) {
+    case DT_INT64:
+      return feature->GetNumElementsInInt64List(num_elements);
+    case DT_FLOAT:
+      return feature->GetNumElementsInFloatList(num_elements);
+    case DT_STRING:
+      return feature->GetNumElementsInBytesList(num_elements);
+    default:
+      ReportUnexpectedDataType(dtype);
+      return false;
+  }
+}
+
+template <typename T>
+bool ParseValues(parsed::Feature* feature, LimitedArraySlice<T>* values);
+
+template <>
+bool ParseValues<int64_t>(parsed::Feature* feature,
+                          LimitedArraySlice<int64_t>* values) {
+  return feature->ParseInt64List(values);
+}
+template <>
+bool ParseValues<float>(parsed::Feature* feature,
+                        LimitedArraySlice<float>* values) {
+  return feature->ParseFloatList(values);
+}
+template <>
+bool ParseValues<tstring>(parsed::Feature* feature,
+                          LimitedArraySlice<tstring>* values) {
+  return feature->ParseBytesList(values);
+}
+
+// Decodes the values of column `c` of `batch` for examples [start, end) into
+// `values`, and writes the indices of a sparse feature to `indices`.
+// `dense` is the config of a dense feature, and null otherwise.
+template <typename T>
+Status FillColumn(ColumnarBatch* batch, size_t c, size_t start, size_t end,
+                  Type type, StringPiece feature_name,
+                  const FastParseExampleConfig::Dense* dense,
+                  gtl::ArraySlice<tstring> example_names, Tensor* values,
+                  Tensor* indices) {
+  T* data = values->flat<T>().data();
+  const int64_t* splits = batch->splits_of(c);
+  const size_t row_size = batch->num_examples == 0
+                              ? 0
+                              : values->NumElements() / batch->num_examples;
+  for (size_t e = start; e < end; ++e) {
+    parsed::Feature& feature = batch->feature(c, e);
+    auto example_error = [&](StringPiece suffix) {
+      return errors::InvalidArgument(
+          "Name: ", ExampleNameOrUnknown(example_names, e),
+          ", Key: ", feature_name, ", Index: ", e, ".  ", suffix);
+    };
+
+    if (type == Type::Dense && !dense->variable_length) {
+      T* out = data + e * row_size;
+      if (feature.GetSerialized().empty()) {
+        std::copy_n(dense->default_value.flat<T>().data(), row_size, out);
+        continue;
+      }
+      LimitedArraySlice<T> slice(out, row_size);
+      if (!ParseValues(&feature, &slice)) {
+        return example_error("Can't parse serialized Example.");
+      }
+      if (slice.EndDistance() != 0) {
+        return example_error(strings::StrCat(
+            "Number of ", ValuesTypeName(dense->dtype),
+            " values != expected.  "
+            "Values size: ",
+            row_size - slice.EndDistance(),
+            " but output shape: ", dense->shape.DebugString()));
+      }
+      continue;
+    }
+
+    // Sparse, ragged and variable-length dense features.
+    const size_t num_values = splits[e + 1] - splits[e];
+    T* out = type == Type::Dense ? data + e * row_size : data + splits[e];
+    if (num_values > 0) {
+      LimitedArraySlice<T> slice(out, num_values);
+      if (!ParseValues(&feature, &slice) || slice.EndDistance() != 0) {
+        return example_error("Can't parse serialized Example.");
+      }
+    }
+    if (type == Type::Dense && num_values < row_size) {
+      std::fill(out + num_values, out + row_size,
+                dense->default_value.flat<T>()(0));
+    }
+    if (type == Type::Sparse) {
+      int64_t* ix_p = indices->flat<int64_t>().data() + 2 * splits[e];
+      for (size_t i = 0; i < num_values; ++i) {
+        // Column 0: example index
+        *ix_p = e;
+        // Column 1: the feature index in the example
+        *(ix_p + 1) = i;
+        ix_p += 2;
+      }
+    }
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
+Status FastParseExampleColumnar(const Config& config,
+                                gtl::ArraySlice<tstring> serialized,
+                                gtl::ArraySlice<tstring> example_names,
+                                thread::ThreadPool* thread_pool,
+                                Result* result) {
+  DCHECK(result != nullptr);
+  // Check config so we can safely CHECK(false) in switches on config.*.dtype
+  TF_RETURN_IF_ERROR(CheckConfigDataTypes(config));
+
+  if (config.collect_feature_stats) {
+    result->feature_stats.resize(serialized.size());
+  }
+
+  const size_t num_dense = config.dense.size();
+  const size_t num_sparse = config.sparse.size();
+  const size_t num_ragged = config.ragged.size();
+  const size_t num_columns = num_dense + num_sparse + num_ragged;
+  SeededHasher hasher;
+  PresizedCuckooMap<std::pair<size_t, Type>> config_index(num_columns);
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config, &hasher, &config_index));
+
+  auto column_of = [&](Type type, size_t d) -> size_t {
+    if (type == Type::Dense) return d;
+    if (type == Type::Sparse) return num_dense + d;
+    return num_dense + num_sparse + d;
+  };
+
+  const size_t num_examples = serialized.size();
+  ColumnarBatch batch(num_columns, num_examples);
+
+  const size_t num_minibatches = ComputeNumMinibatches(serialized);
+  auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
+    return (num_examples * minibatch) / num_minibatches;
+  };
+
+  // First pass: find the features of each example, check them against the
+  // config and count their values.
+  auto ScanMiniBatch = [&](size_t minibatch) -> Status {
+    parsed::Example parsed_example;
+    // The last example of the minibatch in which each column was found.
+    std::vector<int64_t> last_example(num_columns, -1);
+    const size_t end = first_example_of_minibatch(minibatch + 1);
+    for (size_t e = first_example_of_minibatch(minibatch); e < end; ++e) {
+      parsed_example.clear();
+      if (!ParseExample(serialized[e], &parsed_example)) {
+        return errors::InvalidArgument(
+            "Could not parse example input, value: '", serialized[e], "'");
+      }
+      PerExampleFeatureStats* stats = nullptr;
+      if (config.collect_feature_stats) {
+        stats = &result->feature_stats[e];
+        stats->features_count = parsed_example.size();
+      }
+
+      // As in FastParseSerializedExample(), the last entry in the map
+      // overwrites all the previous ones.
+      for (size_t i = parsed_example.size(); i-- > 0;) {
+        const StringPiece feature_name = parsed_example[i].first;
+        parsed::Feature& feature = parsed_example[i].second;
+
+        std::pair<size_t, Type> d_and_type;
+        if (!config_index.Find(hasher(feature_name), &d_and_type)) continue;
+        const size_t d = d_and_type.first;
+        const Type type = d_and_type.second;
+        const size_t c = column_of(type, d);
+
+        DataType dtype;
+        StringPiece config_feature_name;
+        if (type == Type::Dense) {
+          dtype = config.dense[d].dtype;
+          config_feature_name = config.dense[d].feature_name;
+        } else if (type == Type::Sparse) {
+          dtype = config.sparse[d].dtype;
+          config_feature_name = config.sparse[d].feature_name;
+        } else {
+          dtype = config.ragged[d].dtype;
+          config_feature_name = config.ragged[d].feature_name;
+        }
+        // Testing for PresizedCuckooMap collision.
+        if (feature_name != config_feature_name) continue;
+
+        auto example_error = [&](StringPiece suffix) {
+          return errors::InvalidArgument(
+              "Name: ", ExampleNameOrUnknown(example_names, e),
+              ", Key: ", feature_name, ", Index: ", e, ".  ", suffix);
+        };
+
+        DataType example_dtype;
+        TF_RETURN_IF_ERROR(feature.ParseDataType(&example_dtype));
+        if (type == Type::Dense && example_dtype == DT_INVALID) continue;
+
+        if (last_example[c] == static_cast<int64_t>(e)) {
+          if (type == Type::Dense) {
+            LogDenseFeatureDataLoss(feature_name);
+          } else {
+            LogSparseFeatureDataLoss(feature_name);
+          }
+          continue;
+        }
+        last_example[c] = e;
+
+        if (type == Type::Dense && example_dtype != dtype) {
+          return example_error(strings::StrCat(
+              "Data types don't match. Data type: ",
+              DataTypeString(example_dtype),
+              " but expected type: ", DataTypeString(dtype)));
+        }
+        if (example_dtype != DT_INVALID && example_dtype != dtype) {
+          return example_error(strings::StrCat(
+              "Data types don't match. ",
+              "Expected type: ", DataTypeString(dtype),
+              ", Actual type: ", DataTypeString(example_dtype)));
+        }
+
+        batch.feature(c, e) = feature;
+        if (type == Type::Dense && !config.dense[d].variable_length) {
+          if (stats) {
+            stats->feature_values_count += config.dense[d].elements_per_stride;
+          }
+          continue;
+        }
+
+        int num_values = 0;
+        if (example_dtype != DT_INVALID &&
+            !GetNumElements(dtype, &feature, &num_values)) {
+          return example_error("Can't parse serialized Example.");
+        }
+        if (type == Type::Dense &&
+            num_values % config.dense[d].elements_per_stride != 0) {
+          return example_error(strings::StrCat(
+              "Number of ", ValuesTypeName(dtype),
+              " values is not a multiple of stride length. Saw ", num_values,
+              " values but output shape is: ",
+              config.dense[d].shape.DebugString()));
+        }
+        batch.splits_of(c)[e + 1] = num_values;
+        if (stats) {
+          stats->feature_values_count += num_values;
+        }
+      }
+
+      // Check that the missing dense features for fixed strides have defaults.
+      for (size_t d = 0; d < num_dense; ++d) {
+        if (config.dense[d].variable_length) continue;
+        if (last_example[d] == static_cast<int64_t>(e)) continue;
+        if (config.dense[d].default_value.NumElements() == 0) {
+          return errors::InvalidArgument(
+              "Name: ", ExampleNameOrUnknown(example_names, e),
+              ", Feature: ", config.dense[d].feature_name,
+              " (data type: ", DataTypeString(config.dense[d].dtype), ")",
+              " is required but could not be found.");
+        }
+      }
+    }
+    return OkStatus();
+  };
+
+  std::vector<Status> status_of_minibatch(num_minibatches);
+  ParallelFor(
+      [&](size_t minibatch) {
+        status_of_minibatch[minibatch] = ScanMiniBatch(minibatch);
+      },
+      num_minibatches, thread_pool);
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  // Merge the counts of values into row splits, and allocate the outputs of
+  // the whole batch.
+  result->sparse_indices.reserve(num_sparse);
+  result->sparse_values.reserve(num_sparse);
+  result->sparse_shapes.reserve(num_sparse);
+  result->dense_values.reserve(num_dense);
+  result->ragged_values.reserve(num_ragged);
+  result->ragged_splits.reserve(num_ragged);
+
+  for (size_t d = 0; d < num_dense; ++d) {
+    TensorShape values_shape;
+    values_shape.AddDim(num_examples);
+    if (config.dense[d].variable_length) {
+      int64_t max_num_features = 0;
+      batch.MergeSplits(column_of(Type::Dense, d), &max_num_features);
+      DCHECK_EQ(max_num_features % config.dense[d].elements_per_stride, 0);
+      values_shape.AddDim(max_num_features /
+                          config.dense[d].elements_per_stride);
+      for (int i = 1; i < config.dense[d].shape.dims(); ++i) {
+        values_shape.AddDim(config.dense[d].shape.dim_size(i));
+      }
+    } else {
+      for (const int64_t dim : config.dense[d].shape.dim_sizes()) {
+        values_shape.AddDim(dim);
+      }
+    }
+    result->dense_values.emplace_back(config.dense[d].dtype, values_shape);
+  }
+
+  for (size_t d = 0; d < num_sparse; ++d) {
+    int64_t max_num_features = 0;
+    const int64_t total_num_features =
+        batch.MergeSplits(column_of(Type::Sparse, d), &max_num_features);
+    result->sparse_indices.emplace_back(DT_INT64,
+                                        TensorShape({total_num_features, 2}));
+    result->sparse_values.emplace_back(config.sparse[d].dtype,
+                                       TensorShape({total_num_features}));
+    result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
+    auto shapes_shape_t = result->sparse_shapes.back().vec<int64_t>();
+    shapes_shape_t(0) = num_examples;
+    shapes_shape_t(1) = max_num_features;
+  }
+
+  for (size_t d = 0; d < num_ragged; ++d) {
+    const size_t c = column_of(Type::Ragged, d);
+    int64_t max_num_features = 0;
+    const int64_t total_num_features = batch.MergeSplits(c, &max_num_features);
+    result->ragged_values.emplace_back(config.ragged[d].dtype,
+                                       TensorShape({total_num_features}));
+    const int64_t num_splits = num_examples + 1;
+    result->ragged_splits.emplace_back(config.ragged[d].splits_dtype,
+                                       TensorShape({num_splits}));
+    Tensor& row_splits = result->ragged_splits.back();
+    if (config.ragged[d].splits_dtype == DT_INT64) {
+      std::copy_n(batch.splits_of(c), num_splits,
+                  row_splits.flat<int64_t>().data());
+    } else {
+      std::copy_n(batch.splits_of(c), num_splits,
+                  row_splits.flat<int32>().data());
+    }
+  }
+
+  // Second pass: decode the values of each example into place.
+  auto FillMiniBatch = [&](size_t minibatch) -> Status {
+    const size_t start = first_example_of_minibatch(minibatch);
+    const size_t end = first_example_of_minibatch(minibatch + 1);
+    for (size_t c = 0; c < num_columns; ++c) {
+      Type type;
+      StringPiece feature_name;
+      DataType dtype;
+      const Config::Dense* dense = nullptr;
+      Tensor* values;
+      Tensor* indices = nullptr;
+      if (c < num_dense) {
+        type = Type::Dense;
+        dense = &config.dense[c];
+        feature_name = dense->feature_name;
+        dtype = dense->dtype;
+        values = &result->dense_values[c];
+      } else if (c < num_dense + num_sparse) {
+        const size_t d = c - num_dense;
+        type = Type::Sparse;
+        feature_name = config.sparse[d].feature_name;
+        dtype = config.sparse[d].dtype;
+        values = &result->sparse_values[d];
+        indices = &result->sparse_indices[d];
+      } else {
+        const size_t d = c - num_dense - num_sparse;
+        type = Type::Ragged;
+        feature_name = config.ragged[d].feature_name;
+        dtype = config.ragged[d].dtype;
+        values = &result->ragged_values[d];
+      }
+      switch (dtype) {
+        case DT_INT64:
+          TF_RETURN_IF_ERROR(FillColumn<int64_t>(&batch, c, start, end, type,
+                                                 feature_name, dense,
+                                                 example_names, values,
+                                                 indices));
+          break;
+        case DT_FLOAT:
+          TF_RETURN_IF_ERROR(FillColumn<float>(&batch, c, start, end, type,
+                                               feature_name, dense,
+                                               example_names, values,
+                                               indices));
+          break;
+        case DT_STRING:
+          TF_RETURN_IF_ERROR(FillColumn<tstring>(&batch, c, start, end, type,
+                                                 feature_name, dense,
+                                                 example_names, values,
+                                                 indices));
+          break;
+        default:
+          ReportUnexpectedDataType(dtype);
+      }
+    }
+    return OkStatus();
+  };
+
+  ParallelFor(
+      [&](size_t minibatch) {
+        status_of_minibatch[minibatch] = FillMiniBatch(minibatch);
+      },
+      num_minibatches, thread_pool);
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  return OkStatus();
+}
+
 Status FastParseSingleExample(const Config& config, StringPiece serialized,
                               Result* result) {
   DCHECK(result != nullptr);
@@ -139,6 +139,19 @@ Status FastParseExample(const FastParseExampleConfig& config,
                         gtl::ArraySlice<tstring> example_names,
                         thread::ThreadPool* thread_pool, Result* result);
 
+// Like FastParseExample, but decodes the values straight into the output
+// tensors. A first parallel pass over the examples finds each configured
+// feature and counts its values; the counts are merged into the offsets of
+// each example in the outputs, which are allocated once for the whole batch;
+// a second parallel pass decodes the values into place. This avoids the
+// per-minibatch buffers and the final copy of sparse, ragged and
+// variable-length dense values, at the cost of reading each feature twice.
+Status FastParseExampleColumnar(const FastParseExampleConfig& config,
+                                gtl::ArraySlice<tstring> serialized,
+                                gtl::ArraySlice<tstring> example_names,
+                                thread::ThreadPool* thread_pool,
+                                Result* result);
+
 // TODO(mrry): Move the hash table construction into the config object.
 typedef FastParseExampleConfig FastParseSingleExampleConfig;
 
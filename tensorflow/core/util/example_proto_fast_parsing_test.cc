@@ -15,14 +15,18 @@ limitations under the License.
 
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <limits>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -172,6 +176,25 @@ TEST(FastParse, Packed) {
       "\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x08\x0d");
 }
 
+TEST(FastParse, PackedInt64Varints) {
+  Example example;
+  Int64List* int64_list =
+      (*example.mutable_features()->mutable_feature())["ids"]
+          .mutable_int64_list();
+  // Runs of single-byte varints interleaved with longer ones, and values at
+  // the boundaries of the varint lengths.
+  for (int64_t i = 0; i < 100; ++i) {
+    int64_list->add_value(i % 19);
+    if (i % 13 == 0) int64_list->add_value(int64_t{1} << (i % 63));
+  }
+  for (int64_t value : {int64_t{127}, int64_t{128}, int64_t{16383},
+                        int64_t{16384}, std::numeric_limits<int64_t>::max(),
+                        std::numeric_limits<int64_t>::min(), int64_t{-1}}) {
+    int64_list->add_value(value);
+  }
+  TestCorrectness(Serialize(example));
+}
+
 TEST(FastParse, ValueBeforeKeyInMap) {
   TestCorrectness("\x0a\x12\x0a\x10\x12\x09\x0a\x07\x0a\x05value\x0a\x03key");
 }
@@ -419,6 +442,220 @@ TEST(FastParse, FuzzTest) {
   }
 }
 
+static void AddRaggedFeature(const char* feature_name, DataType dtype,
+                             DataType splits_dtype,
+                             FastParseExampleConfig* out_config) {
+  out_config->ragged.emplace_back();
+  auto& new_feature = out_config->ragged.back();
+  new_feature.feature_name = feature_name;
+  new_feature.dtype = dtype;
+  new_feature.splits_dtype = splits_dtype;
+}
+
+void ExpectTensorsEqual(const std::vector<Tensor>& expected,
+                        const std::vector<Tensor>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    test::ExpectEqual(expected[i], actual[i], test::Tolerance::kNone);
+  }
+}
+
+// Tests that `serialized` gets parsed identically by FastParseExample(..) and
+// FastParseExampleColumnar(..).
+void TestColumnarCorrectness(const FastParseExampleConfig& config,
+                             const std::vector<tstring>& serialized,
+                             thread::ThreadPool* thread_pool = nullptr) {
+  Result expected;
+  Status expected_status =
+      FastParseExample(config, serialized, {}, thread_pool, &expected);
+  Result actual;
+  Status actual_status =
+      FastParseExampleColumnar(config, serialized, {}, thread_pool, &actual);
+  EXPECT_EQ(expected_status, actual_status);
+  if (!expected_status.ok() || !actual_status.ok()) return;
+
+  ExpectTensorsEqual(expected.sparse_indices, actual.sparse_indices);
+  ExpectTensorsEqual(expected.sparse_values, actual.sparse_values);
+  ExpectTensorsEqual(expected.sparse_shapes, actual.sparse_shapes);
+  ExpectTensorsEqual(expected.dense_values, actual.dense_values);
+  ExpectTensorsEqual(expected.ragged_values, actual.ragged_values);
+  ExpectTensorsEqual(expected.ragged_splits, actual.ragged_splits);
+  ASSERT_EQ(expected.feature_stats.size(), actual.feature_stats.size());
+  for (size_t i = 0; i < expected.feature_stats.size(); ++i) {
+    EXPECT_EQ(expected.feature_stats[i].features_count,
+              actual.feature_stats[i].features_count);
+    EXPECT_EQ(expected.feature_stats[i].feature_values_count,
+              actual.feature_stats[i].feature_values_count);
+  }
+}
+
+TEST(FastParseColumnar, SomeFeatures) {
+  std::vector<tstring> serialized(13, ExampleWithSomeFeatures());
+
+  FastParseExampleConfig config;
+  AddDenseFeature("bytes_list", DT_STRING, {2}, false, 2, &config);
+  AddDenseFeature("empty_int64_list", DT_INT64, {-1}, true, 1, &config);
+  AddSparseFeature("int64_list", DT_INT64, &config);
+  AddSparseFeature("empty_bytes_list", DT_STRING, &config);
+  AddSparseFeature("missing", DT_FLOAT, &config);
+  AddRaggedFeature("float_list", DT_FLOAT, DT_INT32, &config);
+  AddRaggedFeature("empty_float_list", DT_FLOAT, DT_INT64, &config);
+  config.collect_feature_stats = true;
+
+  TestColumnarCorrectness(config, serialized);
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  TestColumnarCorrectness(config, serialized, &thread_pool);
+}
+
+TEST(FastParseColumnar, Errors) {
+  std::vector<tstring> serialized(3, ExampleWithSomeFeatures());
+
+  // Required dense feature is missing.
+  FastParseExampleConfig config_required;
+  AddDenseFeature("missing", DT_INT64, {1}, false, 1, &config_required);
+  config_required.dense.back().default_value =
+      Tensor(DT_INT64, TensorShape({0}));
+  TestColumnarCorrectness(config_required, serialized);
+
+  // Data types don't match.
+  FastParseExampleConfig config_dense_type;
+  AddDenseFeature("float_list", DT_INT64, {-1}, true, 1, &config_dense_type);
+  TestColumnarCorrectness(config_dense_type, serialized);
+  FastParseExampleConfig config_sparse_type;
+  AddSparseFeature("int64_list", DT_STRING, &config_sparse_type);
+  TestColumnarCorrectness(config_sparse_type, serialized);
+
+  // Wrong number of values.
+  FastParseExampleConfig config_shape;
+  AddDenseFeature("int64_list", DT_INT64, {2}, false, 2, &config_shape);
+  TestColumnarCorrectness(config_shape, serialized);
+  FastParseExampleConfig config_stride;
+  AddDenseFeature("int64_list", DT_INT64, {-1, 2}, true, 2, &config_stride);
+  TestColumnarCorrectness(config_stride, serialized);
+
+  // Not an Example.
+  FastParseExampleConfig config_sparse;
+  AddSparseFeature("int64_list", DT_INT64, &config_sparse);
+  serialized[1] = "\xff";
+  TestColumnarCorrectness(config_sparse, serialized);
+}
+
+TEST(FastParseColumnar, FuzzTest) {
+  random::PhiloxRandom philox(1337);
+  random::SimplePhilox rng(&philox);
+  const std::vector<std::pair<string, DataType>> keys = {
+      {"int64_0", DT_INT64}, {"int64_1", DT_INT64}, {"float_0", DT_FLOAT},
+      {"float_1", DT_FLOAT}, {"bytes_0", DT_STRING}, {"bytes_1", DT_STRING}};
+
+  FastParseExampleConfig config;
+  AddSparseFeature("int64_0", DT_INT64, &config);
+  AddRaggedFeature("int64_1", DT_INT64, DT_INT32, &config);
+  AddDenseFeature("float_0", DT_FLOAT, {-1}, true, 1, &config);
+  config.dense.back().default_value = test::AsScalar<float>(-1.0);
+  AddRaggedFeature("float_1", DT_FLOAT, DT_INT64, &config);
+  AddSparseFeature("bytes_0", DT_STRING, &config);
+  AddDenseFeature("bytes_1", DT_STRING, {-1}, true, 1, &config);
+  config.collect_feature_stats = true;
+
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  for (int run = 0; run < 20; ++run) {
+    std::vector<tstring> serialized(1 + rng.Rand32() % 300);
+    for (tstring& s : serialized) {
+      Example example;
+      auto& features = *example.mutable_features()->mutable_feature();
+      for (const auto& key_and_dtype : keys) {
+        if (rng.Rand32() % 4 == 0) continue;
+        const int num_values = rng.Rand32() % 40;
+        Feature& feature = features[key_and_dtype.first];
+        switch (key_and_dtype.second) {
+          case DT_INT64: {
+            Int64List* list = feature.mutable_int64_list();
+            for (int i = 0; i < num_values; ++i) {
+              list->add_value(rng.Rand32() % 2 ? rng.Rand32() % 128
+                                               : rng.Rand64());
+            }
+            break;
+          }
+          case DT_FLOAT: {
+            FloatList* list = feature.mutable_float_list();
+            for (int i = 0; i < num_values; ++i) {
+              list->add_value(rng.RandFloat());
+            }
+            break;
+          }
+          default: {
+            BytesList* list = feature.mutable_bytes_list();
+            for (int i = 0; i < num_values; ++i) {
+              list->add_value(RandStr(&rng));
+            }
+            break;
+          }
+        }
+      }
+      s = Serialize(example);
+    }
+    TestColumnarCorrectness(config, serialized, &thread_pool);
+  }
+}
+
+// Parses batches of `state.range(0)` examples, each with `state.range(1)`
+// small int64 ids, floats and strings as sparse features, and 16 floats as a
+// dense feature.
+void BenchmarkParseExample(
+    ::testing::benchmark::State& state,
+    decltype(&FastParseExample) parse_example) {
+  const int batch_size = state.range(0);
+  const int num_values = state.range(1);
+
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  for (int i = 0; i < num_values; ++i) {
+    features["ids"].mutable_int64_list()->add_value(i * 7 % 100);
+    features["weights"].mutable_float_list()->add_value(i * 0.5);
+    features["tokens"].mutable_bytes_list()->add_value(
+        strings::StrCat("token", i));
+  }
+  for (int i = 0; i < 16; ++i) {
+    features["embedding"].mutable_float_list()->add_value(i);
+  }
+  std::vector<tstring> serialized(batch_size, Serialize(example));
+
+  FastParseExampleConfig config;
+  AddSparseFeature("ids", DT_INT64, &config);
+  AddSparseFeature("weights", DT_FLOAT, &config);
+  AddSparseFeature("tokens", DT_STRING, &config);
+  AddDenseFeature("embedding", DT_FLOAT, {16}, false, 16, &config);
+
+  thread::ThreadPool thread_pool(Env::Default(), "benchmark", 4);
+  for (auto s : state) {
+    Result result;
+    TF_CHECK_OK(
+        parse_example(config, serialized, {}, &thread_pool, &result));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          batch_size);
+}
+
+void BM_FastParseExample(::testing::benchmark::State& state) {
+  BenchmarkParseExample(state, &FastParseExample);
+}
+BENCHMARK(BM_FastParseExample)
+    ->UseRealTime()
+    ->ArgPair(128, 10)
+    ->ArgPair(128, 100)
+    ->ArgPair(1024, 10)
+    ->ArgPair(1024, 100);
+
+void BM_FastParseExampleColumnar(::testing::benchmark::State& state) {
+  BenchmarkParseExample(state, &FastParseExampleColumnar);
+}
+BENCHMARK(BM_FastParseExampleColumnar)
+    ->UseRealTime()
+    ->ArgPair(128, 10)
+    ->ArgPair(128, 100)
+    ->ArgPair(1024, 10)
+    ->ArgPair(1024, 100);
+
 TEST(TestFastParseExample, Empty) {
   Result result;
   FastParseExampleConfig config;
@@ -429,6 +666,14 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(TestFastParseExample, EmptyColumnar) {
+  FastParseExampleConfig config;
+  AddDenseFeature("dense", DT_FLOAT, {-1}, true, 1, &config);
+  AddSparseFeature("sparse", DT_STRING, &config);
+  AddRaggedFeature("ragged", DT_INT64, DT_INT32, &config);
+  TestColumnarCorrectness(config, {});
+}
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
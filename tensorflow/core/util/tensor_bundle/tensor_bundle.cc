@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <utility>
 
@@ -41,6 +44,7 @@ limitations under the License.
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
@@ -79,9 +83,25 @@ const int64_t kLargeTensorThreshold = static_cast<int64_t>(1) << 32;
 const int kMaxFileReadThreads = 8;
 // Minimum size of a file section handled by each thread.
 const int64_t kMinSectionSize = static_cast<int64_t>(1) << 31;
+// Size of the file sections that "LookupMany()" reads concurrently.
+const int64_t kParallelReadSectionSize = static_cast<int64_t>(16) << 20;
 
 namespace {
 
+// Returns a DataLoss error if "actual_crc32c", computed on the restored bytes
+// of "entry", differs from the checksum stored in "entry".
+Status VerifyChecksum(StringPiece prefix, const BundleEntryProto& entry,
+                      uint32 actual_crc32c) {
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "TensorBundle at ", prefix, " shard ", entry.shard_id(), " (",
+        entry.size(), " bytes): Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the restored bytes ", actual_crc32c);
+  }
+  return OkStatus();
+}
+
 // Reads "num_elements" string elements from file[offset, offset+size) into the
 // length-N "destination".  Discards the original content of "destination".
 //
@@ -869,6 +889,20 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return OkStatus();
 }
 
+Status BundleReader::OpenDataFile(int32_t shard_id,
+                                  io::InputBuffer** buffered_file) {
+  io::InputBuffer*& data_file = data_[shard_id];
+  if (data_file == nullptr) {
+    std::unique_ptr<RandomAccessFile> file = nullptr;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+        DataFilename(prefix_, shard_id, num_shards_), &file));
+    // The InputBuffer and RandomAccessFile objects are both released in dtor.
+    data_file = new io::InputBuffer(file.release(), kBufferSize);
+  }
+  *buffered_file = data_file;
+  return OkStatus();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
@@ -898,17 +932,8 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     }
   }
 
-  // Open the data file if it has not been opened.
-  io::InputBuffer* buffered_file = data_[entry.shard_id()];
-  if (buffered_file == nullptr) {
-    std::unique_ptr<RandomAccessFile> file = nullptr;
-    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
-        DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file = new io::InputBuffer(file.release(), kBufferSize);
-    // The InputBuffer and RandomAccessFile objects are both released in dtor.
-    data_[entry.shard_id()] = buffered_file;
-  }
-  CHECK(buffered_file != nullptr);
+  io::InputBuffer* buffered_file;
+  TF_RETURN_IF_ERROR(OpenDataFile(entry.shard_id(), &buffered_file));
 
   TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   uint32 actual_crc32c = 0;
@@ -997,13 +1022,7 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
         buffered_file, ret->NumElements(), entry.offset(), entry.size(),
         GetStringBackingBuffer(*ret), &actual_crc32c, need_to_swap_bytes_));
   }
-  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
-    return errors::DataLoss(
-        "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
-        entry.size(), " bytes): Checksum does not match: stored ",
-        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
-        " vs. calculated on the restored bytes ", actual_crc32c);
-  }
+  TF_RETURN_IF_ERROR(VerifyChecksum(prefix_, entry, actual_crc32c));
 
   *val = *ret;
   if (ret != val) delete ret;
@@ -1024,6 +1043,146 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMany(absl::Span<const string> keys,
+                                absl::Span<Tensor* const> vals,
+                                int num_threads) {
+  CHECK_EQ(keys.size(), vals.size());
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      TF_RETURN_IF_ERROR(Lookup(keys[i], vals[i]));
+    }
+    return OkStatus();
+  }
+
+  // A tensor whose contents are read in sections on the thread pool.
+  struct ParallelRead {
+    BundleEntryProto entry;
+    Tensor* val;
+    RandomAccessFile* file;
+    // The last thread to finish a section validates the whole tensor.
+    std::atomic<int64_t> remaining_sections{0};
+  };
+  struct Section {
+    ParallelRead* read;
+    // Position of the section within the contents of the tensor.
+    int64_t offset;
+    int64_t size;
+  };
+  std::vector<std::unique_ptr<ParallelRead>> reads;
+  std::vector<size_t> other_lookups;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    BundleEntryProto entry;
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &entry));
+    if (!entry.slices().empty() || !DataTypeCanUseMemcpy(entry.dtype()) ||
+        vals[i]->NumElements() == 0) {
+      other_lookups.push_back(i);
+      continue;
+    }
+    if (entry.size() != vals[i]->TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", keys[i],
+                              "; stored size ", entry.size(),
+                              "; expected size ", vals[i]->TotalBytes());
+    }
+    // Files are opened here, as only the calling thread may modify "data_".
+    // The pool threads share them, since positional reads are thread-safe.
+    io::InputBuffer* buffered_file;
+    TF_RETURN_IF_ERROR(OpenDataFile(entry.shard_id(), &buffered_file));
+    auto read = std::make_unique<ParallelRead>();
+    read->entry.Swap(&entry);
+    read->val = vals[i];
+    read->file = buffered_file->file();
+    reads.push_back(std::move(read));
+  }
+
+  // Splits the tensors into sections, in file order within each shard.
+  absl::c_sort(reads, [](const std::unique_ptr<ParallelRead>& a,
+                         const std::unique_ptr<ParallelRead>& b) {
+    return std::make_pair(a->entry.shard_id(), a->entry.offset()) <
+           std::make_pair(b->entry.shard_id(), b->entry.offset());
+  });
+  std::map<int32_t, std::vector<Section>> shard_sections;
+  size_t num_sections = 0;
+  for (const std::unique_ptr<ParallelRead>& read : reads) {
+    const int64_t size = read->entry.size();
+    std::vector<Section>& sections = shard_sections[read->entry.shard_id()];
+    for (int64_t offset = 0; offset < size;
+         offset += kParallelReadSectionSize) {
+      sections.push_back(
+          {read.get(), offset,
+           std::min(kParallelReadSectionSize, size - offset)});
+      ++read->remaining_sections;
+      ++num_sections;
+    }
+  }
+  // Interleaves the shards, so that concurrent reads go to different files.
+  std::vector<Section> schedule;
+  schedule.reserve(num_sections);
+  for (size_t i = 0; schedule.size() < num_sections; ++i) {
+    for (const auto& shard_and_sections : shard_sections) {
+      const std::vector<Section>& sections = shard_and_sections.second;
+      if (i < sections.size()) schedule.push_back(sections[i]);
+    }
+  }
+
+  auto read_section = [this](const Section& section) -> Status {
+    ParallelRead* read = section.read;
+    char* buffer =
+        const_cast<char*>(read->val->tensor_data().data()) + section.offset;
+    StringPiece sp;
+    TF_RETURN_IF_ERROR(read->file->Read(read->entry.offset() + section.offset,
+                                        section.size, &sp, buffer));
+    if (sp.data() != buffer) {
+      memmove(buffer, sp.data(), section.size);
+    }
+    if (read->remaining_sections.fetch_sub(1) > 1) return OkStatus();
+
+    // All sections have been read, so the contents of the tensor are
+    // complete.  As in "GetValue()", the checksum is computed before
+    // byte-swapping.
+    TF_RETURN_IF_ERROR(VerifyChecksum(
+        prefix_, read->entry,
+        crc32c::Value(read->val->tensor_data().data(), read->entry.size())));
+    if (need_to_swap_bytes_) {
+      TF_RETURN_IF_ERROR(ByteSwapTensor(read->val));
+    }
+    return OkStatus();
+  };
+
+  mutex mu;
+  Status status;
+  std::atomic<bool> failed(false);
+  auto record_error = [&](const Status& s) {
+    failed = true;
+    mutex_lock l(mu);
+    status.Update(s);
+  };
+  {
+    std::unique_ptr<thread::ThreadPool> reader_pool;
+    if (!schedule.empty()) {
+      reader_pool = std::make_unique<thread::ThreadPool>(
+          env_, "lookup_tensors",
+          std::min<int64_t>(num_threads, schedule.size()));
+      for (const Section& section : schedule) {
+        reader_pool->Schedule([&, section]() {
+          if (failed) return;
+          Status s = read_section(section);
+          if (!s.ok()) record_error(s);
+        });
+      }
+    }
+
+    // Looks up the other tensors while the pool reads.
+    for (size_t i : other_lookups) {
+      Status s = Lookup(keys[i], vals[i]);
+      if (!s.ok()) {
+        record_error(s);
+        break;
+      }
+    }
+  }  // Waits for the pool to finish.
+  return status;
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
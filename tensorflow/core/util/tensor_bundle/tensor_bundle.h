@@ -72,6 +72,7 @@ limitations under the License.
 #include "absl/container/flat_hash_map.h"
 #include "absl/functional/function_ref.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
@@ -251,6 +252,24 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(absl::string_view key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensors keyed by "keys" into "vals", like calling "Lookup()"
+  // on each pair, but reads them concurrently on up to "num_threads" threads.
+  //
+  // As for "Lookup()", each "vals[i]" must already have the dtype and shape of
+  // the stored tensor, and its buffer is filled in place.  Callers can thus
+  // restore directly into buffers that they own, such as those of variables.
+  //
+  // The contents of non-partitioned tensors whose dtype can be memcpy'ed are
+  // read in sections, with positional reads interleaved across the data
+  // shards.  The thread that reads the last section of a tensor validates its
+  // checksum while the other sections are still being read.  The remaining
+  // tensors are looked up on the calling thread in the meantime.
+  //
+  // REQUIRES: status().ok() && keys.size() == vals.size()
+  Status LookupMany(absl::Span<const std::string> keys,
+                    absl::Span<Tensor* const> vals,
+                    int num_threads) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -304,6 +323,10 @@ class BundleReader {
   Status GetBundleEntryProto(absl::string_view key,
                              BundleEntryProto* entry) TF_MUST_USE_RESULT;
 
+  // Opens the data file of shard "shard_id", unless it is already open.
+  Status OpenDataFile(int32_t shard_id,
+                      io::InputBuffer** buffered_file) TF_MUST_USE_RESULT;
+
   // Reads the tensor value described by the metadata proto "entry".
   // Usage for "val" follows the comment of "Lookup()".
   Status GetValue(const BundleEntryProto& entry,
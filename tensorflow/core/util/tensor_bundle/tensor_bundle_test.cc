@@ -1148,6 +1148,84 @@ TEST(TensorBundleTest, LargeVariableLoadingTest) {
   }
 }
 
+TEST(TensorBundleTest, LookupMany) {
+  Env* env = Env::Default();
+  // Spans two sections of "LookupMany()".
+  const Tensor large =
+      Constant(static_cast<int8>(7), TensorShape({(16 << 20) + 3}));
+  const Tensor strings = test::AsTensor<tstring>({"hello", "world"});
+  {
+    BundleWriter writer(env, Prefix("lookup_many0"));
+    TF_EXPECT_OK(writer.Add("float", Constant_2x3<float>(1.)));
+    TF_EXPECT_OK(writer.Add("large", large));
+    TF_EXPECT_OK(writer.Add("strings", strings));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    BundleWriter writer(env, Prefix("lookup_many1"));
+    TF_EXPECT_OK(writer.Add("double", Constant_2x3<double>(2.)));
+    TF_EXPECT_OK(writer.AddSlice("sliced", TensorShape({2, 3}),
+                                 TensorSlice::ParseOrDie("0,1:-"),
+                                 Constant<int32>(3, TensorShape({1, 3}))));
+    TF_EXPECT_OK(writer.AddSlice("sliced", TensorShape({2, 3}),
+                                 TensorSlice::ParseOrDie("1,1:-"),
+                                 Constant<int32>(3, TensorShape({1, 3}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_ASSERT_OK(MergeBundles(
+      env, {Prefix("lookup_many0"), Prefix("lookup_many1")},
+      Prefix("lookup_many")));
+
+  for (int num_threads : {1, 4}) {
+    BundleReader reader(env, Prefix("lookup_many"));
+    TF_ASSERT_OK(reader.status());
+    Tensor float_val(DT_FLOAT, TensorShape({2, 3}));
+    Tensor large_val(DT_INT8, large.shape());
+    Tensor strings_val(DT_STRING, TensorShape({2}));
+    Tensor double_val(DT_DOUBLE, TensorShape({2, 3}));
+    Tensor sliced_val(DT_INT32, TensorShape({2, 3}));
+    TF_ASSERT_OK(reader.LookupMany(
+        {"sliced", "large", "double", "strings", "float"},
+        {&sliced_val, &large_val, &double_val, &strings_val, &float_val},
+        num_threads));
+    test::ExpectTensorEqual<float>(Constant_2x3<float>(1.), float_val);
+    test::ExpectTensorEqual<int8>(large, large_val);
+    test::ExpectTensorEqual<tstring>(strings, strings_val);
+    test::ExpectTensorEqual<double>(Constant_2x3<double>(2.), double_val);
+    test::ExpectTensorEqual<int32>(Constant_2x3<int32>(3), sliced_val);
+  }
+}
+
+TEST(TensorBundleTest, LookupManyValidatesContents) {
+  Env* env = Env::Default();
+  {
+    BundleWriter writer(env, Prefix("lookup_many_corrupt"));
+    TF_EXPECT_OK(writer.Add("a", Constant_2x3<float>(1.)));
+    TF_EXPECT_OK(writer.Add("b", Constant_2x3<float>(2.)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(env, Prefix("lookup_many_corrupt"));
+  TF_ASSERT_OK(reader.status());
+  Tensor a(DT_FLOAT, TensorShape({2, 3}));
+  Tensor b(DT_FLOAT, TensorShape({3, 3}));
+  Status status = reader.LookupMany({"a", "b"}, {&a, &b}, /*num_threads=*/4);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(absl::StrContains(status.ToString(), "Invalid size"));
+
+  // Flips a byte of "b".
+  const string datafile = DataFilename(Prefix("lookup_many_corrupt"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(env, datafile, &data));
+  data.back() = ~data.back();
+  TF_ASSERT_OK(WriteStringToFile(env, datafile, data));
+  BundleReader corrupt_reader(env, Prefix("lookup_many_corrupt"));
+  TF_ASSERT_OK(corrupt_reader.status());
+  b = Tensor(DT_FLOAT, TensorShape({2, 3}));
+  status = corrupt_reader.LookupMany({"a", "b"}, {&a, &b}, /*num_threads=*/4);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(absl::StrContains(status.ToString(), "Checksum does not match"));
+}
+
 class TensorBundleAlignmentTest : public ::testing::Test {
  protected:
   template <typename T>
@@ -1252,4 +1330,49 @@ static void BM_BundleWriterLargeTensor(::testing::benchmark::State& state) {
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(1 << 10);
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(4 << 10);
 
+// Restores "num_tensors" float tensors of "tensor_bytes" bytes each, stored in
+// four data shards, with "LookupMany()" on "num_threads" threads.
+static void BM_BundleLookupMany(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const int num_tensors = state.range(1);
+  const int64_t tensor_bytes = state.range(2);
+  const TensorShape shape({tensor_bytes / 4});
+  constexpr int kNumShards = 4;
+  Env* env = Env::Default();
+  std::vector<tstring> shard_prefixes;
+  for (int shard = 0; shard < kNumShards; ++shard) {
+    shard_prefixes.push_back(Prefix(strings::StrCat("lookup_many_bm", shard)));
+    BundleWriter writer(env, shard_prefixes.back());
+    for (int i = shard; i < num_tensors; i += kNumShards) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("t", i), Constant(1.f, shape)));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  TF_CHECK_OK(MergeBundles(env, shard_prefixes, Prefix("lookup_many_bm")));
+
+  std::vector<string> keys;
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < num_tensors; ++i) {
+    keys.push_back(strings::StrCat("t", i));
+    tensors.emplace_back(DT_FLOAT, shape);
+  }
+  std::vector<Tensor*> vals;
+  for (Tensor& tensor : tensors) vals.push_back(&tensor);
+  for (auto s : state) {
+    BundleReader reader(env, Prefix("lookup_many_bm"));
+    TF_CHECK_OK(reader.status());
+    TF_CHECK_OK(reader.LookupMany(keys, vals, num_threads));
+  }
+  state.SetBytesProcessed(state.iterations() * num_tensors * tensor_bytes);
+}
+
+BENCHMARK(BM_BundleLookupMany)
+    ->UseRealTime()
+    ->Args({1, 1024, 4 << 10})
+    ->Args({8, 1024, 4 << 10})
+    ->Args({1, 64, 16 << 20})
+    ->Args({8, 64, 16 << 20})
+    ->Args({1, 8, 64 << 20})
+    ->Args({8, 8, 64 << 20});
+
 }  // namespace tensorflow
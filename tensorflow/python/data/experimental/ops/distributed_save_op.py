@@ -21,7 +21,11 @@ from tensorflow.python.saved_model import nested_structure_coder
 
 
 # TODO(b/250921378): Add example to docstring and export to TF API.
-def distributed_save(dataset, path, dispatcher_address, compression="AUTO"):
+def distributed_save(dataset,
+                     path,
+                     dispatcher_address,
+                     compression="AUTO",
+                     columnar=False):
   """Initiates the process of distributedly saving a dataset to disk.
 
   Args:
@@ -34,6 +38,9 @@ def distributed_save(dataset, path, dispatcher_address, compression="AUTO"):
       `dataset` materialization.  If `"AUTO"`, the tf.data runtime decides which
       algorithm to use.  If `"GZIP"` or `"SNAPPY"`, that specific algorithm is
       used.  If `None`, the `dataset` materialization is not compressed.
+    columnar: (Optional.) If `True`, the chunks of the snapshot store each
+      component of the elements as a separately compressed column, so readers
+      can memory-map uncompressed columns. `compression` is then ignored.
 
   Returns:
     An operation which when executed performs the distributed save.
@@ -51,6 +58,7 @@ def distributed_save(dataset, path, dispatcher_address, compression="AUTO"):
       element_spec=nested_structure_coder.encode_structure(
           dataset.element_spec).SerializeToString(),
       compression=compression,
+      columnar_chunks=columnar,
   )
 
   return gen_experimental_dataset_ops.distributed_save(
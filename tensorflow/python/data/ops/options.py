@@ -45,12 +45,17 @@ class AutotuneAlgorithm(enum.Enum):
 
   STAGE_BASED: In each optimization step, this algorithm chooses the worst
   bottleneck parameter and increases its value by 1.
+
+  MEMORY_AWARE: Similar to HILL_CLIMB but weighs the decrease in output time of
+  each step against the CPU cores and the memory that it takes, and only takes
+  steps that fit in both the CPU budget and the RAM budget.
   """
   DEFAULT = 0
   HILL_CLIMB = 1
   GRADIENT_DESCENT = 2
   MAX_PARALLELISM = 3
   STAGE_BASED = 4
+  MEMORY_AWARE = 5
 
   @classmethod
   def _to_proto(cls, obj):
@@ -64,9 +69,12 @@ class AutotuneAlgorithm(enum.Enum):
       return model_pb2.AutotuneAlgorithm.MAX_PARALLELISM
     if obj == cls.STAGE_BASED:
       return model_pb2.AutotuneAlgorithm.STAGE_BASED
+    if obj == cls.MEMORY_AWARE:
+      return model_pb2.AutotuneAlgorithm.MEMORY_AWARE
     raise ValueError(
         f"Invalid `obj.` Supported values include `DEFAULT`, `HILL_CLIMB` "
-        f"`GRADIENT_DESCENT`, and `STAGE_BASED`. Got {obj.name}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED`, and `MEMORY_AWARE`. Got "
+        f"{obj.name}.")
 
   @classmethod
   def _from_proto(cls, pb):
@@ -80,9 +88,11 @@ class AutotuneAlgorithm(enum.Enum):
       return cls.MAX_PARALLELISM
     if pb == model_pb2.AutotuneAlgorithm.STAGE_BASED:
       return cls.STAGE_BASED
+    if pb == model_pb2.AutotuneAlgorithm.MEMORY_AWARE:
+      return cls.MEMORY_AWARE
     raise ValueError(
         f"Invalid `pb.` Supported values include `DEFAULT`, `HILL_CLIMB`, "
-        f"`GRADIENT_DESCENT` and `STAGE_BASED`. Got {pb}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED` and `MEMORY_AWARE`. Got {pb}.")
 
 
 @tf_export("data.experimental.AutoShardPolicy")
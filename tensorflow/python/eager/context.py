@@ -1207,6 +1207,7 @@ class Context:
     rewriter_bool("disable_meta_optimizer")
     rewriter_toggle("auto_mixed_precision_onednn_bfloat16")
     rewriter_toggle("auto_mixed_precision_mkl")
+    rewriter_toggle("elementwise_fusion")
     nodes = self._optimizer_experimental_options.get("min_graph_nodes", None)
     if nodes is not None:
       config.graph_options.rewrite_options.min_graph_nodes = nodes
@@ -1984,6 +1985,7 @@ class Context:
     rewriter_bool("disable_meta_optimizer")
     rewriter_toggle("auto_mixed_precision_onednn_bfloat16")
     rewriter_toggle("auto_mixed_precision_mkl")
+    rewriter_toggle("elementwise_fusion")
 
     if rewrite_options.min_graph_nodes != 0:
       options["min_graph_nodes"] = rewrite_options.min_graph_nodes
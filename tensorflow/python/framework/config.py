@@ -250,6 +250,8 @@ def set_optimizer_experimental_options(options):
         For smaller graphs, optimization is skipped.
       - auto_parallel: Automatically parallelizes graphs by splitting along
         the batch dimension
+      - elementwise_fusion: Collapse chains of elementwise ops on CPU into
+        single ops that do not write intermediate results to memory.
   """
   context.context().set_optimizer_experimental_options(options)
 
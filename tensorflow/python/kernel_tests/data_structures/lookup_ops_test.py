@@ -1083,6 +1083,67 @@ class InitializeTableFromFileOpTest(BaseLookupTableTest):
       self.assertEqual(vocab_size, self.evaluate(table.size()))
 
 
+@parameterized.named_parameters(
+    (f"_{is_anonymous}", is_anonymous) for is_anonymous in [False, True])
+class InitializeTableFromIndexFileOpTest(BaseLookupTableTest):
+
+  def _createIndexFile(self, basename, keys, values):
+    index_file = os.path.join(self.get_temp_dir(), basename)
+    self.evaluate(
+        lookup_ops.write_hash_table_index_file(index_file, keys, values))
+    return index_file
+
+  def testInitializeStringTable(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    index_file = self._createIndexFile(
+        "string_int64.idx", constant_op.constant(["brain", "salad", "surgery"]),
+        constant_op.constant([0, 1, 2], dtypes.int64))
+    init = lookup_ops.IndexFileInitializer(index_file, dtypes.string,
+                                           dtypes.int64)
+    table = self.getHashTable()(
+        init, default_value=-1, experimental_is_anonymous=is_anonymous)
+    self.initialize_table(table)
+
+    output = table.lookup(constant_op.constant(["brain", "salad", "tank"]))
+    self.assertAllEqual([0, 1, -1], self.evaluate(output))
+    self.assertEqual(3, self.evaluate(table.size()))
+
+    exported_keys, exported_values = self.evaluate(table.export())
+    self.assertAllEqual([b"brain", b"salad", b"surgery"],
+                        sorted(exported_keys))
+    self.assertAllEqual([0, 1, 2], sorted(exported_values))
+
+  def testInitializeInt64ToStringTable(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    index_file = self._createIndexFile(
+        "int64_string.idx", constant_op.constant([42, 1, -1000], dtypes.int64),
+        constant_op.constant(["a", "b", "c"]))
+    init = lookup_ops.IndexFileInitializer(index_file, dtypes.int64,
+                                           dtypes.string)
+    table = self.getHashTable()(
+        init, default_value="n/a", experimental_is_anonymous=is_anonymous)
+    self.initialize_table(table)
+
+    output = table.lookup(
+        constant_op.constant([42, 11, -1000], dtype=dtypes.int64))
+    self.assertAllEqual([b"a", b"n/a", b"c"], self.evaluate(output))
+
+  def testMismatchedTypes(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    index_file = self._createIndexFile(
+        "int32_int32.idx", constant_op.constant([1, 2]),
+        constant_op.constant([3, 4]))
+    init = lookup_ops.IndexFileInitializer(index_file, dtypes.int64,
+                                           dtypes.int64)
+    with self.assertRaises(errors_impl.OpError):
+      table = self.getHashTable()(
+          init, default_value=-1, experimental_is_anonymous=is_anonymous)
+      self.initialize_table(table)
+
+
 @parameterized.named_parameters(
     (f"_{is_anonymous}", is_anonymous) for is_anonymous in [False, True])
 class StaticVocabularyTableTest(BaseLookupTableTest):
@@ -1802,6 +1863,71 @@ class DenseHashTableOpTest(test.TestCase):
     output = table.lookup(keys4)
     self.assertAllEqual([-1, 0, -1, 3, 4, 5, 6, 7, -1], self.evaluate(output))
 
+  def testManyKeysRemoveAndReinsert(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    table = lookup_ops.DenseHashTable(
+        dtypes.int64,
+        dtypes.int64,
+        default_value=-1,
+        empty_key=-1,
+        deleted_key=-2,
+        initial_num_buckets=64,
+        experimental_is_anonymous=is_anonymous)
+    keys = np.arange(1000, dtype=np.int64) * 128
+    self.evaluate(
+        table.insert(
+            constant_op.constant(keys), constant_op.constant(keys + 1)))
+    self.assertAllEqual(1000, self.evaluate(table.size()))
+
+    self.evaluate(table.remove(constant_op.constant(keys[::2])))
+    self.assertAllEqual(500, self.evaluate(table.size()))
+    expected = np.where(np.arange(1000) % 2 == 0, -1, keys + 1)
+    self.assertAllEqual(
+        expected, self.evaluate(table.lookup(constant_op.constant(keys))))
+
+    # Reinsert the removed keys and update the remaining ones.
+    self.evaluate(
+        table.insert(
+            constant_op.constant(keys), constant_op.constant(keys + 2)))
+    self.assertAllEqual(1000, self.evaluate(table.size()))
+    self.assertAllEqual(
+        keys + 2, self.evaluate(table.lookup(constant_op.constant(keys))))
+
+    # Exported buckets can be imported into a fresh table.
+    exported_keys, exported_values = self.evaluate(table.export())
+    # Older binaries import the buckets as-is and find every key with
+    # quadratic probing from `key % num_buckets`.
+    flat_keys = exported_keys.flatten()
+    bit_mask = len(flat_keys) - 1
+    for key in keys:
+      bucket = key & bit_mask
+      num_probes = 0
+      while flat_keys[bucket] != key:
+        self.assertNotEqual(-1, flat_keys[bucket])
+        num_probes += 1
+        bucket = (bucket + num_probes) & bit_mask
+    table2 = lookup_ops.DenseHashTable(
+        dtypes.int64,
+        dtypes.int64,
+        default_value=-1,
+        empty_key=-1,
+        deleted_key=-2,
+        initial_num_buckets=4,
+        experimental_is_anonymous=is_anonymous)
+    self.evaluate(
+        gen_lookup_ops.lookup_table_import_v2(table2.resource_handle,
+                                              exported_keys, exported_values))
+    self.assertAllEqual(1000, self.evaluate(table2.size()))
+    self.assertAllEqual(
+        len(exported_keys), len(self.evaluate(table2.export()[0])))
+    self.assertAllEqual(
+        keys + 2, self.evaluate(table2.lookup(constant_op.constant(keys))))
+    self.assertAllEqual([-1],
+                        self.evaluate(
+                            table2.lookup(
+                                constant_op.constant([7], dtypes.int64))))
+
   def testExport(self, is_anonymous):
     if is_anonymous and not tf2.enabled():
       self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
@@ -1832,12 +1958,12 @@ class DenseHashTableOpTest(test.TestCase):
     self.assertAllEqual(8, len(np_keys))
     self.assertAllEqual(8, len(np_values))
 
-    # pair up keys and values, drop extra added dimension
-    pairs = np.dstack((np_keys.flatten(), np_values.flatten()))[0]
-    # sort by key
-    pairs = pairs[pairs[:, 0].argsort()]
-    self.assertAllEqual([[11, 1], [13, 3], [14, 4], [100, 0], [100, 0],
-                         [100, 0], [100, 0], [200, 2]], pairs)
+    # Each key is exported at the first free bucket of its quadratic probe
+    # sequence from `key % 8`, which older binaries probe after importing the
+    # buckets as-is. Removed keys are not exported.
+    self.assertAllEqual([100, 100, 100, 11, 100, 13, 14, 100],
+                        np_keys.flatten())
+    self.assertAllEqual([0, 0, 0, 1, 0, 3, 4, 0], np_values.flatten())
 
   @test_util.run_v1_only("Saver V1 only")
   def testSaveRestore(self, is_anonymous):
@@ -3369,6 +3495,58 @@ class MutableHashTableOpTest(test.TestCase):
     self.assertAllEqual([b"brain", b"salad", b"surgery"], sorted_keys)
     self.assertAllEqual([0, 1, 2], sorted_values)
 
+  def testShardedMutableHashTable(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    default_val = -1
+    keys = constant_op.constant(np.arange(100), dtypes.int64)
+    values = constant_op.constant(np.arange(100) * 10, dtypes.int64)
+    table = lookup_ops.MutableHashTable(
+        dtypes.int64,
+        dtypes.int64,
+        default_val,
+        experimental_is_anonymous=is_anonymous,
+        experimental_num_shards=8)
+    self.evaluate(table.insert(keys, values))
+    self.assertAllEqual(100, self.evaluate(table.size()))
+
+    # Later values win for repeated keys within one batch.
+    self.evaluate(
+        table.insert(
+            constant_op.constant([5, 5, 200], dtypes.int64),
+            constant_op.constant([1, 2, 3], dtypes.int64)))
+    self.assertAllEqual(101, self.evaluate(table.size()))
+
+    self.evaluate(table.remove(constant_op.constant([0, 1], dtypes.int64)))
+    self.assertAllEqual(99, self.evaluate(table.size()))
+
+    output = table.lookup(
+        constant_op.constant([0, 5, 7, 99, 200, 300], dtypes.int64))
+    self.assertAllEqual([-1, 2, 70, 990, 3, -1], self.evaluate(output))
+
+    exported_keys, exported_values = table.export()
+    exported_keys = self.evaluate(exported_keys)
+    exported_values = self.evaluate(exported_values)
+    self.assertEqual(99, len(exported_keys))
+    exported = dict(zip(exported_keys, exported_values))
+    self.assertEqual(2, exported[5])
+    self.assertEqual(3, exported[200])
+    self.assertNotIn(0, exported)
+
+    # Importing into a table with a different number of shards round-trips.
+    table2 = lookup_ops.MutableHashTable(
+        dtypes.int64,
+        dtypes.int64,
+        default_val,
+        experimental_is_anonymous=is_anonymous,
+        experimental_num_shards=3)
+    self.evaluate(
+        gen_lookup_ops.lookup_table_import_v2(table2.resource_handle,
+                                              exported_keys, exported_values))
+    self.assertAllEqual(99, self.evaluate(table2.size()))
+    output = table2.lookup(constant_op.constant([5, 7, 1], dtypes.int64))
+    self.assertAllEqual([2, 70, -1], self.evaluate(output))
+
   # TODO(https://github.com/tensorflow/tensorflow/issues/24439): remove exepectedFailure when fixed
   @unittest.expectedFailure
   @test_util.run_v2_only
@@ -3719,6 +3897,34 @@ class MutableHashTableOpTest(test.TestCase):
     sorted_expected_values = np.sort([[4, 5], [2, 3], [0, 1]], axis=0)
     self.assertAllEqual(sorted_expected_values, sorted_values)
 
+  def testShardedMutableHashTableOfTensors(self, is_anonymous):
+    if is_anonymous and not tf2.enabled():
+      self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
+    default_val = constant_op.constant([-1, -1], dtypes.int64)
+    keys = constant_op.constant(["brain", "salad", "surgery", "tarkus"])
+    values = constant_op.constant([[0, 1], [2, 3], [4, 5], [6, 7]],
+                                  dtypes.int64)
+    table = lookup_ops.MutableHashTable(
+        dtypes.string,
+        dtypes.int64,
+        default_val,
+        experimental_is_anonymous=is_anonymous,
+        experimental_num_shards=4)
+    self.evaluate(table.insert(keys, values))
+    self.assertAllEqual(4, self.evaluate(table.size()))
+
+    self.evaluate(table.remove(constant_op.constant(["tarkus", "tank"])))
+    self.assertAllEqual(3, self.evaluate(table.size()))
+
+    output = table.lookup(constant_op.constant(["brain", "salad", "tank"]))
+    self.assertAllEqual([[0, 1], [2, 3], [-1, -1]], self.evaluate(output))
+
+    exported_keys, exported_values = table.export()
+    sorted_keys = np.sort(self.evaluate(exported_keys))
+    sorted_values = np.sort(self.evaluate(exported_values), axis=0)
+    self.assertAllEqual([b"brain", b"salad", b"surgery"], sorted_keys)
+    self.assertAllEqual([[0, 1], [2, 3], [4, 5]], sorted_values)
+
   def testMutableHashTableExportInsert(self, is_anonymous):
     if is_anonymous and not tf2.enabled():
       self.skipTest(SKIP_ANONYMOUS_IN_TF1_REASON)
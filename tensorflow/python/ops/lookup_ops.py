@@ -917,6 +917,87 @@ class TextFileIdTableInitializer(TextFileInitializer):
         name=name)
 
 
+def write_hash_table_index_file(filename, keys, values, name=None):
+  """Writes `keys` and `values` to a hash index file.
+
+  The file can be loaded by `IndexFileInitializer`, which memory-maps it and
+  serves lookups from it without copying the entries into the table.
+
+  Args:
+    filename: The name of the index file to write.
+    keys: A 1-D tensor of keys, of type `int32`, `int64` or `string`.
+    values: A 1-D tensor of values with as many elements as `keys`, of type
+      `bool`, `int32`, `int64`, `float32`, `float64` or `string`.
+    name: A name for the operation (optional).
+
+  Returns:
+    The operation that writes the file.
+  """
+  with ops.name_scope(name, "write_hash_table_index_file",
+                      (filename, keys, values)):
+    keys = ops.convert_to_tensor(keys, name="keys")
+    values = ops.convert_to_tensor(values, name="values")
+    return gen_lookup_ops.write_hash_table_index_file(filename, keys, values)
+
+
+class IndexFileInitializer(TableInitializerBase):
+  """Table initializer from a hash index file.
+
+  The file is written with `write_hash_table_index_file`. It is memory-mapped
+  by the table, so initialization does not depend on the number of entries and
+  tables loading the same file share its memory through the page cache.
+  Only `StaticHashTable` supports this initializer.
+  """
+
+  def __init__(self, filename, key_dtype, value_dtype, name=None):
+    """Constructs an initializer for a table from a hash index file.
+
+    Args:
+      filename: The name of the index file.
+      key_dtype: The key data type of the index.
+      value_dtype: The value data type of the index.
+      name: A name for the operation (optional).
+
+    Raises:
+      ValueError: when the filename is empty.
+    """
+    if not isinstance(filename, tensor_lib.Tensor) and not filename:
+      raise ValueError("`filename` argument required for IndexFileInitializer")
+    self._filename_arg = filename
+    self._name = name
+    self._filename = self._track_trackable(asset.Asset(filename), "_filename")
+    super(IndexFileInitializer, self).__init__(key_dtype, value_dtype)
+
+  def initialize(self, table):
+    """Initializes the table from the index file.
+
+    Args:
+      table: The table to be initialized.
+
+    Returns:
+      The operation that initializes the table.
+
+    Raises:
+      TypeError: when the keys and values data types do not match the table
+      key and value data types.
+    """
+    check_table_dtypes(table, self.key_dtype, self.value_dtype)
+    with ops.name_scope(self._name, "index_file_init",
+                        (table.resource_handle,)):
+      filename = ops.convert_to_tensor(
+          self._filename, dtypes.string, name="asset_filepath")
+      init_op = gen_lookup_ops.initialize_table_from_index_file_v2(
+          table.resource_handle, filename)
+    ops.add_to_collection(ops.GraphKeys.TABLE_INITIALIZERS, init_op)
+    if not context.executing_eagerly() and constant_op.is_constant(filename):
+      ops.add_to_collection(ops.GraphKeys.ASSET_FILEPATHS, filename)
+    return init_op
+
+  @property
+  def _shared_name(self):
+    return "hash_table_index_%s" % self._filename_arg
+
+
 class HasherSpec(collections.namedtuple("HasherSpec", ["hasher", "key"])):
   """A structure for the spec of the hashing function to use for hash buckets.
 
@@ -1832,7 +1913,8 @@ class MutableHashTable(LookupInterface):
                default_value,
                name="MutableHashTable",
                checkpoint=True,
-               experimental_is_anonymous=False):
+               experimental_is_anonymous=False,
+               experimental_num_shards=1):
     """Creates an empty `MutableHashTable` object.
 
     Creates a table, the type of its keys and values are specified by key_dtype
@@ -1852,6 +1934,11 @@ class MutableHashTable(LookupInterface):
         be looked up by a name. When all resource handles pointing to
         that resource are gone, the resource will be deleted
         automatically.
+      experimental_num_shards: The number of independently locked partitions
+        the keys are spread across (default is 1). Values greater than 1
+        reduce lock contention when many threads look up or insert into the
+        table concurrently. The exported and checkpointed contents do not
+        depend on this value.
 
     Returns:
       A `MutableHashTable` object.
@@ -1867,6 +1954,7 @@ class MutableHashTable(LookupInterface):
     self._value_dtype = value_dtype
     self._name = name
     self._is_anonymous = experimental_is_anonymous
+    self._num_shards = experimental_num_shards
     if not self._is_anonymous:
       self._shared_name = None
       if context.executing_eagerly():
@@ -1888,12 +1976,14 @@ class MutableHashTable(LookupInterface):
         table_ref = gen_lookup_ops.anonymous_mutable_hash_table(
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
+            num_shards=self._num_shards,
             name=self._name)
       else:
         table_ref = gen_lookup_ops.anonymous_mutable_hash_table_of_tensors(
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
             value_shape=self._default_value.get_shape(),
+            num_shards=self._num_shards,
             name=self._name)
     else:
       # The table must be shared if checkpointing is requested for multi-worker
@@ -1906,6 +1996,7 @@ class MutableHashTable(LookupInterface):
             use_node_name_sharing=use_node_name_sharing,
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
+            num_shards=self._num_shards,
             name=self._name)
       else:
         table_ref = gen_lookup_ops.mutable_hash_table_of_tensors_v2(
@@ -1914,6 +2005,7 @@ class MutableHashTable(LookupInterface):
             key_dtype=self._key_dtype,
             value_dtype=self._value_dtype,
             value_shape=self._default_value.get_shape(),
+            num_shards=self._num_shards,
             name=self._name)
 
     if context.executing_eagerly():
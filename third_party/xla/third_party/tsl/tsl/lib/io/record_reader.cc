@@ -17,6 +17,10 @@ limitations under the License.
 
 #include <limits.h>
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 #include "tsl/lib/hash/crc32c.h"
 #include "tsl/lib/io/buffered_inputstream.h"
 #include "tsl/lib/io/compression.h"
@@ -57,6 +61,7 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
 RecordReader::RecordReader(RandomAccessFile* file,
                            const RecordReaderOptions& options)
     : options_(options),
+      file_(file),
       input_stream_(new RandomAccessInputStream(file)),
       last_read_failed_(false) {
   if (options.buffer_size > 0) {
@@ -92,6 +97,27 @@ inline const char* GetChecksumErrorSuffix(uint64 offset) {
   }
   return "";
 }
+
+// Verifies that `data`, the bytes read at `offset`, holds n+4 bytes, and that
+// the checksum of the first n bytes is stored in the last 4 bytes.
+Status VerifyChecksummed(uint64 offset, size_t n, StringPiece data) {
+  const size_t expected = n + sizeof(uint32);
+  if (data.size() != expected) {
+    if (data.empty()) {
+      return errors::OutOfRange("eof", GetChecksumErrorSuffix(offset));
+    } else {
+      return errors::DataLoss("truncated record at ", offset,
+                              GetChecksumErrorSuffix(offset));
+    }
+  }
+
+  const uint32 masked_crc = core::DecodeFixed32(data.data() + n);
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(data.data(), n)) {
+    return errors::DataLoss("corrupted record at ", offset,
+                            GetChecksumErrorSuffix(offset));
+  }
+  return OkStatus();
+}
 }  // namespace
 
 // Read n+4 bytes from file, verify that checksum of first n bytes is
@@ -109,21 +135,7 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result) {
 
   const size_t expected = n + sizeof(uint32);
   TF_RETURN_IF_ERROR(input_stream_->ReadNBytes(expected, result));
-
-  if (result->size() != expected) {
-    if (result->empty()) {
-      return errors::OutOfRange("eof", GetChecksumErrorSuffix(offset));
-    } else {
-      return errors::DataLoss("truncated record at ", offset,
-                              GetChecksumErrorSuffix(offset));
-    }
-  }
-
-  const uint32 masked_crc = core::DecodeFixed32(result->data() + n);
-  if (crc32c::Unmask(masked_crc) != crc32c::Value(result->data(), n)) {
-    return errors::DataLoss("corrupted record at ", offset,
-                            GetChecksumErrorSuffix(offset));
-  }
+  TF_RETURN_IF_ERROR(VerifyChecksummed(offset, n, *result));
   result->resize(n);
   return OkStatus();
 }
@@ -223,6 +235,111 @@ Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   return OkStatus();
 }
 
+Status RecordReader::ReadRecord(uint64* offset, RecordView* record) {
+  if (options_.compression_type != RecordReaderOptions::NONE) {
+    core::RefCountPtr<RecordBuffer> buffer(new RecordBuffer);
+    TF_RETURN_IF_ERROR(ReadRecord(offset, buffer->mutable_contents()));
+    record->data = buffer->contents();
+    record->buffer = std::move(buffer);
+    return OkStatus();
+  }
+
+  // Read header data.
+  StringPiece header;
+  TF_RETURN_IF_ERROR(ReadFromChunk(*offset, kHeaderSize, &header));
+  TF_RETURN_IF_ERROR(VerifyChecksummed(*offset, sizeof(uint64), header));
+  const uint64 length = core::DecodeFixed64(header.data());
+  if (length >= SIZE_MAX - kHeaderSize - kFooterSize) {
+    return errors::DataLoss("record size too large",
+                            GetChecksumErrorSuffix(*offset));
+  }
+
+  // Read data
+  const uint64 data_offset = *offset + kHeaderSize;
+  const size_t n = length + kFooterSize;
+  const bool in_chunk =
+      chunk_ && data_offset + n <= chunk_offset_ + chunk_->contents().size();
+  // Records that do not fit in the chunk, and are at least as large as a new
+  // one, are read into a buffer of their own.
+  const bool own_buffer =
+      !in_chunk && n >= static_cast<size_t>(options_.buffer_size);
+  core::RefCountPtr<RecordBuffer> buffer;
+  StringPiece data;
+  if (own_buffer) {
+    TF_RETURN_IF_ERROR(ReadBuffer(data_offset, n, &buffer));
+    data = buffer->contents();
+  } else {
+    TF_RETURN_IF_ERROR(ReadFromChunk(data_offset, n, &data));
+    buffer = core::GetNewRef(chunk_.get());
+  }
+  Status s = VerifyChecksummed(data_offset, length, data);
+  if (!s.ok()) {
+    if (errors::IsOutOfRange(s)) {
+      s = errors::DataLoss("truncated record at ", *offset, "' failed with ",
+                           s.message());
+    }
+    return s;
+  }
+  if (own_buffer) {
+    // Drop the footer, so that the buffer holds nothing but the record.
+    buffer->mutable_contents()->resize(length);
+    data = buffer->contents();
+  }
+
+  record->data = StringPiece(data.data(), length);
+  record->buffer = std::move(buffer);
+  *offset = data_offset + n;
+  return OkStatus();
+}
+
+Status RecordReader::ReadFromChunk(uint64 offset, size_t n,
+                                   StringPiece* result) {
+  if (!chunk_ || offset < chunk_offset_ ||
+      offset + n > chunk_offset_ + chunk_->contents().size()) {
+    TF_RETURN_IF_ERROR(ReadBuffer(
+        offset, std::max<size_t>(n, options_.buffer_size), &chunk_));
+    chunk_offset_ = offset;
+  }
+  const tstring& contents = chunk_->contents();
+  const size_t start = offset - chunk_offset_;
+  *result = StringPiece(contents.data() + start,
+                        std::min(n, contents.size() - start));
+  return OkStatus();
+}
+
+Status RecordReader::ReadBuffer(uint64 offset, size_t n,
+                                core::RefCountPtr<RecordBuffer>* buffer) {
+  core::RefCountPtr<RecordBuffer> new_buffer(new RecordBuffer);
+  tstring* contents = new_buffer->mutable_contents();
+  contents->resize_uninitialized(n);
+
+  // Copy the bytes that are already read, typically the start of a record
+  // that straddles the end of `chunk_`.
+  size_t num_copied = 0;
+  if (chunk_ && offset >= chunk_offset_ &&
+      offset < chunk_offset_ + chunk_->contents().size()) {
+    const size_t start = offset - chunk_offset_;
+    num_copied = std::min(n, chunk_->contents().size() - start);
+    memcpy(contents->mdata(), chunk_->contents().data() + start, num_copied);
+  }
+
+  StringPiece data;
+  if (num_copied < n) {
+    char* scratch = contents->mdata() + num_copied;
+    Status s = file_->Read(offset + num_copied, n - num_copied, &data, scratch);
+    // A short read is expected at the end of the file.
+    if (!s.ok() && !errors::IsOutOfRange(s)) {
+      return s;
+    }
+    if (data.data() != scratch) {
+      memmove(scratch, data.data(), data.size());
+    }
+  }
+  contents->resize(num_copied + data.size());
+  *buffer = std::move(new_buffer);
+  return OkStatus();
+}
+
 Status RecordReader::SkipRecords(uint64* offset, int num_to_skip,
                                  int* num_skipped) {
   TF_RETURN_IF_ERROR(PositionInputStream(*offset));
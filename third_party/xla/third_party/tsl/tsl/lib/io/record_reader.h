@@ -26,6 +26,7 @@ limitations under the License.
 #include "tsl/lib/io/zlib_inputstream.h"
 #endif  // IS_SLIM_BUILD
 #include "tsl/platform/macros.h"
+#include "tsl/platform/refcount.h"
 #include "tsl/platform/types.h"
 
 namespace tsl {
@@ -56,6 +57,25 @@ struct RecordReaderOptions {
 #endif  // IS_SLIM_BUILD
 };
 
+// A refcounted buffer of file contents that records read by `RecordReader`
+// point into.
+class RecordBuffer : public core::RefCounted {
+ public:
+  const tstring& contents() const { return contents_; }
+  tstring* mutable_contents() { return &contents_; }
+
+ private:
+  tstring contents_;
+};
+
+// A record read without copying it out of the reader's buffers. `data` stays
+// valid for as long as `buffer` is referenced, also after the reader is
+// destroyed.
+struct RecordView {
+  StringPiece data;
+  core::RefCountPtr<RecordBuffer> buffer;
+};
+
 // Low-level interface to read TFRecord files.
 //
 // If using compression or buffering, consider using SequentialRecordReader.
@@ -96,6 +116,20 @@ class RecordReader {
   // OUT_OF_RANGE for end of file, or something else for an error.
   Status ReadRecord(uint64* offset, tstring* record);
 
+  // Like above, but returns a view of the record in one of the reader's
+  // buffers instead of copying it.
+  //
+  // For uncompressed files, the file is read in chunks of `buffer_size`
+  // bytes that the records point into, and each record that is at least as
+  // large as `buffer_size` is read into a buffer of its own, which holds
+  // nothing but the record. Compressed records are decompressed into a buffer
+  // of their own.
+  //
+  // Views are read through buffers that are separate from the ones that the
+  // other methods use, so interleaving them with the other methods is
+  // supported but may read parts of the file twice.
+  Status ReadRecord(uint64* offset, RecordView* record);
+
   // Skip num_to_skip record starting at "*offset" and update *offset
   // to point to the offset of the next num_to_skip + 1 record.
   // Return OK on success, OUT_OF_RANGE for end of file, or something
@@ -118,12 +152,28 @@ class RecordReader {
   Status ReadChecksummed(uint64 offset, size_t n, tstring* result);
   Status PositionInputStream(uint64 offset);
 
+  // Returns in `*result` the bytes [offset, offset + n) of the file, or the
+  // part of them that precedes the end of the file, after reading them into
+  // `chunk_` if needed.
+  Status ReadFromChunk(uint64 offset, size_t n, StringPiece* result);
+
+  // Reads the bytes [offset, offset + n) of the file into a new buffer,
+  // reusing the ones that `chunk_` holds. The buffer is short at the end of
+  // the file.
+  Status ReadBuffer(uint64 offset, size_t n,
+                    core::RefCountPtr<RecordBuffer>* buffer);
+
   RecordReaderOptions options_;
+  tsl::RandomAccessFile* const file_;
   std::unique_ptr<InputStreamInterface> input_stream_;
   bool last_read_failed_;
 
   std::unique_ptr<Metadata> cached_metadata_;
 
+  // The chunk of the file that record views are read from, and its offset.
+  core::RefCountPtr<RecordBuffer> chunk_;
+  uint64 chunk_offset_ = 0;
+
   RecordReader(const RecordReader&) = delete;
   void operator=(const RecordReader&) = delete;
 };
@@ -147,6 +197,12 @@ class SequentialRecordReader {
     return underlying_.ReadRecord(&offset_, record);
   }
 
+  // Like above, but returns a view of the record in one of the reader's
+  // buffers. See `RecordReader::ReadRecord(uint64*, RecordView*)`.
+  Status ReadRecord(RecordView* record) {
+    return underlying_.ReadRecord(&offset_, record);
+  }
+
   // Skip the next num_to_skip record in the file. Return OK on success,
   // OUT_OF_RANGE for end of file, or something else for an error.
   // "*num_skipped" records the number of records that are actually skipped.
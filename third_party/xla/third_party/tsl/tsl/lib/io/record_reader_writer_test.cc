@@ -21,6 +21,7 @@ limitations under the License.
 #include <zlib.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "tsl/lib/core/status_test_util.h"
@@ -30,6 +31,7 @@ limitations under the License.
 #include "tsl/platform/status.h"
 #include "tsl/platform/strcat.h"
 #include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
 
 namespace tsl {
 
@@ -343,6 +345,54 @@ TEST(RecordReaderWriterTest, TestZlib) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestRecordViews) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_views_test";
+  const std::vector<string> records = {"abc", "defg", string(100, 'x'), "",
+                                       "hij"};
+
+  for (const char* compression_type : {"", "ZLIB"}) {
+    {
+      std::unique_ptr<WritableFile> file;
+      TF_CHECK_OK(env->NewWritableFile(fname, &file));
+      io::RecordWriter writer(
+          file.get(),
+          io::RecordWriterOptions::CreateRecordWriterOptions(compression_type));
+      for (const string& record : records) {
+        TF_EXPECT_OK(writer.WriteRecord(record));
+      }
+      TF_CHECK_OK(writer.Flush());
+    }
+
+    for (auto buf_size : BufferSizes()) {
+      std::vector<io::RecordView> views;
+      {
+        std::unique_ptr<RandomAccessFile> read_file;
+        TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+        io::RecordReaderOptions options =
+            io::RecordReaderOptions::CreateRecordReaderOptions(
+                compression_type);
+        options.buffer_size = buf_size;
+        io::SequentialRecordReader reader(read_file.get(), options);
+        for (size_t i = 0; i < records.size(); ++i) {
+          views.emplace_back();
+          TF_CHECK_OK(reader.ReadRecord(&views.back()));
+          if (views.back().data.size() >= static_cast<size_t>(buf_size)) {
+            // Large records are read into a buffer of their own.
+            EXPECT_EQ(views.back().buffer->contents(), views.back().data);
+          }
+        }
+        io::RecordView view;
+        EXPECT_EQ(error::OUT_OF_RANGE, reader.ReadRecord(&view).code());
+      }
+      // The views outlive the reader.
+      for (size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i], views[i].data);
+      }
+    }
+  }
+}
+
 TEST(RecordReaderWriterTest, TestUseAfterClose) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_flush_close_test";
@@ -366,4 +416,51 @@ TEST(RecordReaderWriterTest, TestUseAfterClose) {
   }
 }
 
+// Reads a file of 64MB of records of `state.range(0)` bytes with a 256KB
+// buffer, as views when `state.range(1)` is true, or else as copies.
+void BM_ReadRecords(::testing::benchmark::State& state) {
+  const int64_t record_size = state.range(0);
+  const bool views = state.range(1);
+  const int64_t num_records = (64 << 20) / record_size;
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_benchmark";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    const string record(record_size, 'x');
+    for (int64_t i = 0; i < num_records; ++i) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Close());
+  }
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+  io::RecordReaderOptions options;
+  options.buffer_size = 256 << 10;
+
+  for (auto s : state) {
+    io::SequentialRecordReader reader(read_file.get(), options);
+    for (int64_t i = 0; i < num_records; ++i) {
+      if (views) {
+        io::RecordView view;
+        TF_CHECK_OK(reader.ReadRecord(&view));
+      } else {
+        tstring record;
+        TF_CHECK_OK(reader.ReadRecord(&record));
+      }
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_records * record_size);
+  state.SetLabel(views ? "views" : "copies");
+}
+BENCHMARK(BM_ReadRecords)
+    ->ArgPair(4 << 10, 0)
+    ->ArgPair(4 << 10, 1)
+    ->ArgPair(64 << 10, 0)
+    ->ArgPair(64 << 10, 1)
+    ->ArgPair(1 << 20, 0)
+    ->ArgPair(1 << 20, 1);
+
 }  // namespace tsl
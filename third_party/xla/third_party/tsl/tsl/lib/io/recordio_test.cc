@@ -160,6 +160,21 @@ class RecordioTest : public ::testing::Test {
     }
   }
 
+  string ReadView() {
+    if (!reading_) {
+      reading_ = true;
+    }
+    RecordView record;
+    Status s = reader_->ReadRecord(&readpos_, &record);
+    if (s.ok()) {
+      return string(record.data);
+    } else if (errors::IsOutOfRange(s)) {
+      return "EOF";
+    } else {
+      return s.ToString();
+    }
+  }
+
   void IncrementByte(int offset, int delta) { contents_[offset] += delta; }
 
   void SetByte(int offset, char new_byte) { contents_[offset] = new_byte; }
@@ -368,6 +383,29 @@ TEST_F(RecordioTest, CorruptDataCrc) {
   AssertHasSubstr(Read(), "corrupted record");
 }
 
+TEST_F(RecordioTest, ReadWriteViews) {
+  Write("foo");
+  Write(BigString("bar", 10000));
+  Write("");
+  ASSERT_EQ("foo", ReadView());
+  ASSERT_EQ(BigString("bar", 10000), ReadView());
+  ASSERT_EQ("", ReadView());
+  ASSERT_EQ("EOF", ReadView());
+  ASSERT_EQ("EOF", ReadView());
+}
+
+TEST_F(RecordioTest, CorruptDataView) {
+  Write("foo");
+  IncrementByte(14, 10);
+  AssertHasSubstr(ReadView(), "corrupted record");
+}
+
+TEST_F(RecordioTest, TruncatedDataView) {
+  Write("foo");
+  ShrinkSize(2);
+  AssertHasSubstr(ReadView(), "truncated record");
+}
+
 TEST_F(RecordioTest, ReadEnd) { CheckOffsetPastEndReturnsNoRecords(0); }
 
 TEST_F(RecordioTest, ReadPastEnd) { CheckOffsetPastEndReturnsNoRecords(5); }